@@ -0,0 +1,439 @@
+#include "AnimationClip.h"
+#include "VectorInterpolator.h"
+#include "QuaternionInterpolator.h"
+#include "Quat.h"
+#include <lang/String.h>
+#include <lang/Exception.h>
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+#include "config.h"
+
+//-----------------------------------------------------------------------------
+
+using namespace lang;
+using namespace util;
+
+//-----------------------------------------------------------------------------
+
+namespace anim
+{
+
+
+/**
+ * Samples track at specified time. Time is limited to key range of the track
+ * so that track behaviours have no effect on resampled data.
+ */
+static int sampleTrack( const Interpolator* track, float time, float* value, int size, int hint )
+{
+	int last = track->keys() - 1;
+	if ( time >= track->getKeyTime(last) )
+	{
+		track->getKeyValue( last, value, size );
+		return last;
+	}
+	if ( time < track->getKeyTime(0) )
+		time = track->getKeyTime(0);
+	return track->getValue( time, value, size, hint );
+}
+
+/**
+ * Returns true if line from sample a to sample b approximates
+ * samples between them within tolerance.
+ */
+static bool fitsLine( const float* samples, const float* values, int a, int b, float tolerance )
+{
+	float va = values[a];
+	float dv = (values[b] - va) / float(b-a);
+	for ( int i = a+1 ; i < b ; ++i )
+	{
+		float v = va + dv * float(i-a);
+		if ( fabsf(v-samples[i]) > tolerance )
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Decodes consecutive channels of a segment at specified frame.
+ * Key values and frames of the channels are stored one after another,
+ * so decoding advances them past the decoded channels.
+ * @param frame Frame index relative to the start of the segment.
+ */
+static void decodeChannels( const float* bases, const float* scales, const uint8_t* counts,
+	const uint16_t*& values, const uint8_t*& frames, int channels, float frame, float* out )
+{
+	const uint16_t* kv = values;
+	const uint8_t* kf = frames;
+	int iframe = (int)frame;
+	for ( int i = 0 ; i < channels ; ++i )
+	{
+		int keys = counts[i];
+		if ( 0 == keys )
+		{
+			out[i] = bases[i];
+			continue;
+		}
+
+		int k = 0;
+		while ( k+2 < keys && kf[k+1] <= iframe )
+			++k;
+
+		float u = (frame - float(kf[k])) / float(kf[k+1]-kf[k]);
+		float v0 = float(kv[k]);
+		float v1 = float(kv[k+1]);
+		out[i] = bases[i] + scales[i] * (v0 + (v1-v0)*u);
+		kv += keys;
+		kf += keys;
+	}
+	values = kv;
+	frames = kf;
+}
+
+//-----------------------------------------------------------------------------
+
+AnimationClip::AnimationClip( int bones,
+	const VectorInterpolator* const* positions,
+	const QuaternionInterpolator* const* rotations,
+	float sampleRate, float positionTolerance, float rotationTolerance ) :
+	m_bones( bones ),
+	m_startTime( 0.f ),
+	m_endTime( 0.f ),
+	m_frameRate( 0.f ),
+	m_segments( Allocator<Segment>(__FILE__,__LINE__) ),
+	m_data( Allocator<uint8_t>(__FILE__,__LINE__) ),
+	m_endBehaviour( Interpolator::BEHAVIOUR_REPEAT ),
+	m_preBehaviour( Interpolator::BEHAVIOUR_CONSTANT )
+{
+	if ( bones < 1 || bones > MAX_BONES )
+		throw Exception( Format("Invalid number of bones ({0}) in animation clip", bones) );
+	assert( sampleRate > 0.f );
+
+	// find time range of the tracks
+	bool first = true;
+	for ( int i = 0 ; i < bones ; ++i )
+	{
+		const Interpolator* tracks[2] = { positions ? positions[i] : 0, rotations ? rotations[i] : 0 };
+		for ( int k = 0 ; k < 2 ; ++k )
+		{
+			const Interpolator* track = tracks[k];
+			if ( !track || track->keys() == 0 )
+				continue;
+			if ( k == 0 && track->channels() != 3 )
+				throw Exception( Format("Position track of bone {0} has {1} channels, expected 3", i, track->channels()) );
+
+			float start = track->getKeyTime( 0 );
+			float end = track->getKeyTime( track->keys()-1 );
+			if ( first || start < m_startTime )
+				m_startTime = start;
+			if ( first || end > m_endTime )
+				m_endTime = end;
+			first = false;
+		}
+	}
+
+	// resample tracks, channel by channel
+	float length = m_endTime - m_startTime;
+	int frames = 1;
+	if ( length > 1e-6f )
+	{
+		frames = (int)ceilf( length*sampleRate ) + 1;
+		m_frameRate = float(frames-1) / length;
+	}
+
+	int channels = bones * 7;
+	Vector<float> samples( Allocator<float>(__FILE__,__LINE__) );
+	samples.setSize( channels * frames, 0.f );
+	float* px = samples.begin();
+	float* py = px + bones*frames;
+	float* pz = py + bones*frames;
+	float* qx = pz + bones*frames;
+	float* qy = qx + bones*frames;
+	float* qz = qy + bones*frames;
+	float* qw = qz + bones*frames;
+
+	for ( int i = 0 ; i < bones ; ++i )
+	{
+		const VectorInterpolator* pos = positions ? positions[i] : 0;
+		const QuaternionInterpolator* rot = rotations ? rotations[i] : 0;
+		if ( pos && pos->keys() == 0 )
+			pos = 0;
+		if ( rot && rot->keys() == 0 )
+			rot = 0;
+
+		int poshint = 0;
+		int rothint = 0;
+		float prev[4] = {0,0,0,1};
+		for ( int j = 0 ; j < frames ; ++j )
+		{
+			float time = m_endTime;
+			if ( j+1 < frames )
+				time = m_startTime + float(j) / m_frameRate;
+			int s = i*frames + j;
+
+			float p[3] = {0,0,0};
+			if ( pos )
+				poshint = sampleTrack( pos, time, p, 3, poshint );
+			px[s] = p[0];
+			py[s] = p[1];
+			pz[s] = p[2];
+
+			// keep consecutive rotations on the same hemisphere so that they can be fitted linearly
+			float q[4] = {0,0,0,1};
+			if ( rot )
+				rothint = sampleTrack( rot, time, q, 4, rothint );
+			if ( Quat::dot(prev,q) < 0.f )
+				Quat::negate( q, q );
+			Quat::copy( prev, q );
+			qx[s] = q[0];
+			qy[s] = q[1];
+			qz[s] = q[2];
+			qw[s] = q[3];
+		}
+	}
+
+	compress( samples.begin(), frames, positionTolerance, rotationTolerance );
+}
+
+AnimationClip::~AnimationClip()
+{
+}
+
+void AnimationClip::compress( const float* samples, int frames, float positionTolerance, float rotationTolerance )
+{
+	int channels = m_bones * 7;
+	int segments = (frames - 1 + SEGMENT_FRAMES - 1) / SEGMENT_FRAMES;
+	if ( segments < 1 )
+		segments = 1;
+	m_segments.setSize( segments );
+
+	Vector<uint16_t> keyValues( Allocator<uint16_t>(__FILE__,__LINE__) );
+	Vector<uint8_t> keyFrames( Allocator<uint8_t>(__FILE__,__LINE__) );
+	Vector<float> bases( Allocator<float>(__FILE__,__LINE__) );
+	Vector<float> scales( Allocator<float>(__FILE__,__LINE__) );
+	Vector<uint8_t> counts( Allocator<uint8_t>(__FILE__,__LINE__) );
+	bases.setSize( channels );
+	scales.setSize( channels );
+	counts.setSize( channels );
+
+	for ( int s = 0 ; s < segments ; ++s )
+	{
+		int firstFrame = s * SEGMENT_FRAMES;
+		int segframes = frames - firstFrame;
+		if ( segframes > SEGMENT_FRAMES+1 )
+			segframes = SEGMENT_FRAMES+1;
+
+		keyValues.clear();
+		keyFrames.clear();
+		for ( int c = 0 ; c < channels ; ++c )
+		{
+			const float* v = samples + c*frames + firstFrame;
+			float tolerance = c < m_bones*3 ? positionTolerance : rotationTolerance;
+
+			float minv = v[0];
+			float maxv = v[0];
+			for ( int i = 1 ; i < segframes ; ++i )
+			{
+				if ( v[i] < minv )
+					minv = v[i];
+				if ( v[i] > maxv )
+					maxv = v[i];
+			}
+
+			// constant channel?
+			counts[c] = 0;
+			scales[c] = 0.f;
+			bases[c] = (minv + maxv) * .5f;
+			if ( maxv-minv <= 2.f*tolerance )
+				continue;
+
+			// quantize samples to segment range
+			float base = minv;
+			float scale = (maxv - minv) / 65535.f;
+			uint16_t quantized[SEGMENT_FRAMES+1];
+			float dequantized[SEGMENT_FRAMES+1];
+			for ( int i = 0 ; i < segframes ; ++i )
+			{
+				int q = (int)( (v[i]-base) / scale + .5f );
+				if ( q > 65535 )
+					q = 65535;
+				quantized[i] = (uint16_t)q;
+				dequantized[i] = base + scale * float(q);
+			}
+
+			// greedy piecewise linear fit, error measured against original samples
+			int first = keyValues.size();
+			int a = 0;
+			keyValues.add( quantized[0] );
+			keyFrames.add( 0 );
+			while ( a+1 < segframes )
+			{
+				int b = a + 1;
+				while ( b+1 < segframes && fitsLine(v, dequantized, a, b+1, tolerance) )
+					++b;
+				keyValues.add( quantized[b] );
+				keyFrames.add( (uint8_t)b );
+				a = b;
+			}
+			bases[c] = base;
+			scales[c] = scale;
+			counts[c] = (uint8_t)( keyValues.size() - first );
+		}
+
+		// store segment: bases, scales, key counts, key values, key frames
+		int keys = keyValues.size();
+		int offset = m_data.size();
+		int valueOffset = (channels*(sizeof(float)*2+1) + 1) & ~1;
+		int size = (valueOffset + keys*(sizeof(uint16_t)+1) + 3) & ~3;
+		m_data.setSize( offset + size, 0 );
+		uint8_t* data = m_data.begin() + offset;
+		memcpy( data, bases.begin(), channels*sizeof(float) );
+		memcpy( data + channels*sizeof(float), scales.begin(), channels*sizeof(float) );
+		memcpy( data + channels*sizeof(float)*2, counts.begin(), channels );
+		if ( keys > 0 )
+		{
+			memcpy( data + valueOffset, keyValues.begin(), keys*sizeof(uint16_t) );
+			memcpy( data + valueOffset + keys*sizeof(uint16_t), keyFrames.begin(), keys );
+		}
+
+		Segment& seg = m_segments[s];
+		seg.offset = offset;
+		seg.frames = segframes;
+		seg.keys = keys;
+	}
+}
+
+void AnimationClip::setEndBehaviour( Interpolator::BehaviourType behaviour )
+{
+	m_endBehaviour = behaviour;
+}
+
+void AnimationClip::setPreBehaviour( Interpolator::BehaviourType behaviour )
+{
+	m_preBehaviour = behaviour;
+}
+
+void AnimationClip::evaluate( float time, float* positions, float* rotations ) const
+{
+	assert( m_segments.size() > 0 );
+
+	// find segment and frame within the segment
+	float frame = (getNormalizedTime(time) - m_startTime) * m_frameRate;
+	int s = (int)( frame * (1.f/SEGMENT_FRAMES) );
+	if ( s >= m_segments.size() )
+		s = m_segments.size() - 1;
+	else if ( s < 0 )
+		s = 0;
+	const Segment& seg = m_segments[s];
+	frame -= float( s*SEGMENT_FRAMES );
+	if ( frame > float(seg.frames-1) )
+		frame = float(seg.frames-1);
+	else if ( frame < 0.f )
+		frame = 0.f;
+
+	// decode all channels of the segment
+	int channels = m_bones * 7;
+	const uint8_t* data = m_data.begin() + seg.offset;
+	const float* bases = reinterpret_cast<const float*>( data );
+	const float* scales = bases + channels;
+	const uint8_t* counts = reinterpret_cast<const uint8_t*>( scales + channels );
+	const uint16_t* values = reinterpret_cast<const uint16_t*>( data + ((channels*(sizeof(float)*2+1) + 1) & ~1) );
+	const uint8_t* frames = reinterpret_cast<const uint8_t*>( values + seg.keys );
+	int posChannels = m_bones * 3;
+	decodeChannels( bases, scales, counts, values, frames, posChannels, frame, positions );
+	decodeChannels( bases+posChannels, scales+posChannels, counts+posChannels, values, frames, channels-posChannels, frame, rotations );
+
+	// normalize rotations
+	float* qx = rotations;
+	float* qy = qx + m_bones;
+	float* qz = qy + m_bones;
+	float* qw = qz + m_bones;
+	for ( int i = 0 ; i < m_bones ; ++i )
+	{
+		float len2 = qx[i]*qx[i] + qy[i]*qy[i] + qz[i]*qz[i] + qw[i]*qw[i];
+		float inv = 1.f / sqrtf( len2 );
+		qx[i] *= inv;
+		qy[i] *= inv;
+		qz[i] *= inv;
+		qw[i] *= inv;
+	}
+}
+
+float AnimationClip::getNormalizedTime( float time ) const
+{
+	float startTime = m_startTime;
+	float endTime = m_endTime;
+	float length = endTime - startTime;
+	if ( length <= 1e-6f )
+		return startTime;
+
+	// start behaviour
+	if ( time < startTime )
+	{
+		switch ( m_preBehaviour )
+		{
+		case Interpolator::BEHAVIOUR_RESET:
+			time = endTime;
+			break;
+		case Interpolator::BEHAVIOUR_CONSTANT:
+			time = startTime;
+			break;
+		case Interpolator::BEHAVIOUR_REPEAT:
+			time = endTime - fmodf( startTime-time, length );
+			break;
+		case Interpolator::BEHAVIOUR_OSCILLATE:
+			time = -fmodf( startTime-time, 2.f*length );
+			if ( time >= length )
+				time = 2.f*length - time;
+			time += startTime;
+			break;
+		}
+	}
+	// end behaviour
+	switch ( m_endBehaviour )
+	{
+	case Interpolator::BEHAVIOUR_RESET:
+		if ( time >= endTime )
+			time = startTime;
+		break;
+
+	case Interpolator::BEHAVIOUR_CONSTANT:
+		if ( time > endTime )
+			time = endTime;
+		break;
+
+	case Interpolator::BEHAVIOUR_REPEAT:
+		time = startTime + fmodf( time-startTime, length );
+		break;
+
+	case Interpolator::BEHAVIOUR_OSCILLATE:
+		time = fmodf( time-startTime, 2.f*length );
+		if ( time >= length )
+			time = 2.f*length - time;
+		time += startTime;
+		break;
+	}
+
+	// ensure limits
+	if ( time < startTime )
+		time = startTime;
+	else if ( time > endTime )
+		time = endTime;
+	return time;
+}
+
+int AnimationClip::keys() const
+{
+	int count = 0;
+	for ( int i = 0 ; i < m_segments.size() ; ++i )
+		count += m_segments[i].keys;
+	return count;
+}
+
+int AnimationClip::bytes() const
+{
+	return m_data.size() + m_segments.size()*sizeof(Segment);
+}
+
+
+} // anim
@@ -0,0 +1,132 @@
+#ifndef _ANIM_ANIMATIONCLIP_H
+#define _ANIM_ANIMATIONCLIP_H
+
+
+#include <anim/Interpolator.h>
+#include <lang/Object.h>
+#include <util/Vector.h>
+#include <stdint.h>
+
+
+namespace anim
+{
+
+
+class VectorInterpolator;
+class QuaternionInterpolator;
+
+
+/**
+ * Compressed multi-bone key-frame animation.
+ * Clip is built from position and rotation interpolators of each bone
+ * by resampling the tracks at fixed rate, fitting piecewise linear curves
+ * to the samples within given tolerance and quantizing key values to 16 bits.
+ * Keys of all bones are stored per time segment so that evaluating
+ * a pose touches only one small contiguous block of memory.
+ * Interpolators remain the authoring and reference representation.
+ */
+class AnimationClip :
+	public lang::Object
+{
+public:
+	/** Compression parameters. */
+	enum Constants
+	{
+		/** Number of resampled frames in a time segment. */
+		SEGMENT_FRAMES	= 32,
+		/** Maximum number of bones in a clip. */
+		MAX_BONES		= 512,
+	};
+
+	/**
+	 * Compresses bone animation tracks.
+	 * @param bones Number of bones in the clip.
+	 * @param positions Position track (3 channels) of each bone. Null entries (or null array) mean zero position.
+	 * @param rotations Rotation track of each bone. Null entries (or null array) mean identity rotation.
+	 * @param sampleRate Number of samples per second used to resample the tracks.
+	 * @param positionTolerance Maximum allowed curve fitting error of position components.
+	 * @param rotationTolerance Maximum allowed curve fitting error of quaternion components.
+	 * @exception Exception If number of bones is invalid.
+	 */
+	AnimationClip( int bones,
+		const VectorInterpolator* const* positions,
+		const QuaternionInterpolator* const* rotations,
+		float sampleRate=30.f, float positionTolerance=1e-3f, float rotationTolerance=1e-3f );
+
+	///
+	~AnimationClip();
+
+	/** Sets end behaviour of the clip. Default is BEHAVIOUR_REPEAT. */
+	void	setEndBehaviour( Interpolator::BehaviourType behaviour );
+
+	/** Sets pre behaviour of the clip. Default is BEHAVIOUR_CONSTANT. */
+	void	setPreBehaviour( Interpolator::BehaviourType behaviour );
+
+	/**
+	 * Evaluates pose of all bones at specified time.
+	 * Output is stored in structure-of-arrays order:
+	 * positions receives bones() x-components followed by y- and z-components,
+	 * rotations receives bones() x-components followed by y-, z- and w-components.
+	 * Rotations are normalized.
+	 * @param time Time of the pose.
+	 * @param positions [out] Receives 3*bones() floats.
+	 * @param rotations [out] Receives 4*bones() floats.
+	 */
+	void	evaluate( float time, float* positions, float* rotations ) const;
+
+	/** Returns clip time after pre/end behaviours. */
+	float	getNormalizedTime( float time ) const;
+
+	/** Returns number of bones in the clip. */
+	int		bones() const															{return m_bones;}
+
+	/** Returns time of the first frame. */
+	float	startTime() const														{return m_startTime;}
+
+	/** Returns time of the last frame. */
+	float	endTime() const															{return m_endTime;}
+
+	/** Returns number of time segments. */
+	int		segments() const														{return m_segments.size();}
+
+	/** Returns total number of stored keys. */
+	int		keys() const;
+
+	/** Returns size of compressed data in bytes. */
+	int		bytes() const;
+
+	/** Returns end behaviour of the clip. */
+	Interpolator::BehaviourType	endBehaviour() const								{return m_endBehaviour;}
+
+	/** Returns pre behaviour of the clip. */
+	Interpolator::BehaviourType	preBehaviour() const								{return m_preBehaviour;}
+
+private:
+	class Segment
+	{
+	public:
+		int		offset;
+		int		frames;
+		int		keys;
+	};
+
+	int							m_bones;
+	float						m_startTime;
+	float						m_endTime;
+	float						m_frameRate;
+	util::Vector<Segment>		m_segments;
+	util::Vector<uint8_t>		m_data;
+	Interpolator::BehaviourType	m_endBehaviour;
+	Interpolator::BehaviourType	m_preBehaviour;
+
+	void	compress( const float* samples, int frames, float positionTolerance, float rotationTolerance );
+
+	AnimationClip( const AnimationClip& );
+	AnimationClip& operator=( const AnimationClip& );
+};
+
+
+} // anim
+
+
+#endif // _ANIM_ANIMATIONCLIP_H
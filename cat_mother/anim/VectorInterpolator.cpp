@@ -4,6 +4,11 @@
 
 //-----------------------------------------------------------------------------
 
+/** Maximum number of channels interpolated without the shared temporary buffer. */
+#define MAX_STACK_CHANNELS 4
+
+//-----------------------------------------------------------------------------
+
 using namespace lang;
 
 //-----------------------------------------------------------------------------
@@ -73,9 +78,13 @@ int	VectorInterpolator::getValue( float time, float* value, int size, int hint )
 		break;}
 
 	case INTERPOLATE_CATMULLROM:{
-		// outgoing/incoming tangents
+		// outgoing/incoming tangents, on stack for common channel counts
+		// so that shared interpolators can be evaluated from multiple threads
 		int channels = this->channels();
-		float* buf = getTempBuffer(channels*2);
+		float stackbuf[MAX_STACK_CHANNELS*2];
+		float* buf = stackbuf;
+		if ( channels > MAX_STACK_CHANNELS )
+			buf = getTempBuffer(channels*2);
 		float* out = buf;
 		float* in = buf+channels;
 
@@ -41,6 +41,8 @@ public:
 
 	/** 
 	 * Gets value of the controller at specified time. 
+	 * Can be called from multiple threads at the same time
+	 * if the interpolator has at most 4 channels.
 	 * @param time Time of value to retrieve.
 	 * @param value [out] Receives controller value.
 	 * @param size Number of floats in the controller value.
@@ -89,6 +89,10 @@ SOURCE=.\Animatable.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\AnimationClip.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\Control.cpp
 # End Source File
 # Begin Source File
@@ -113,6 +117,10 @@ SOURCE=.\Animatable.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\AnimationClip.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Control.h
 # End Source File
 # Begin Source File
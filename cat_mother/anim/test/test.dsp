@@ -85,6 +85,10 @@ LINK32=link.exe
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=.\test_AnimationClip.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\test_VectorInterpolator.cpp
 # End Source File
 # End Group
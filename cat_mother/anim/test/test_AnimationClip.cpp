@@ -0,0 +1,155 @@
+#include <anim/AnimationClip.h>
+#include <anim/VectorInterpolator.h>
+#include <anim/QuaternionInterpolator.h>
+#include <dev/Profile.h>
+#include <lang/Math.h>
+#include <tester/Test.h>
+#include <util/Vector.h>
+#include <assert.h>
+#include <stdio.h>
+#include <math.h>
+#include <anim/internal/config.h>
+
+//-----------------------------------------------------------------------------
+
+using namespace dev;
+using namespace lang;
+using namespace util;
+using namespace anim;
+
+//-----------------------------------------------------------------------------
+
+static int test()
+{
+	const int		BONES = 40;
+	const float		LENGTH = 4.f;
+	const int		POSITION_KEYS = 121;
+	const int		ROTATION_KEYS = 121;
+	const int		POSES = 1000;
+
+	// create reference tracks, keyed at 30 frames per second like exported bone animation
+	Vector<P(VectorInterpolator)> positions( Allocator<P(VectorInterpolator)>(__FILE__,__LINE__) );
+	Vector<P(QuaternionInterpolator)> rotations( Allocator<P(QuaternionInterpolator)>(__FILE__,__LINE__) );
+	VectorInterpolator* postracks[BONES];
+	QuaternionInterpolator* rottracks[BONES];
+	for ( int i = 0 ; i < BONES ; ++i )
+	{
+		P(VectorInterpolator) pos = new VectorInterpolator( 3 );
+		pos->setInterpolation( VectorInterpolator::INTERPOLATE_CATMULLROM );
+		pos->setKeys( POSITION_KEYS );
+		for ( int k = 0 ; k < POSITION_KEYS ; ++k )
+		{
+			float t = LENGTH * k / (POSITION_KEYS-1);
+			float v[3] = { Math::sin(t*1.3f+i), .5f*Math::cos(t*2.1f-i), (i&1) ? 1.f : t*.1f };
+			pos->setKeyTime( k, t );
+			pos->setKeyValue( k, v, 3 );
+		}
+
+		P(QuaternionInterpolator) rot = new QuaternionInterpolator;
+		rot->setKeys( ROTATION_KEYS );
+		for ( int k = 0 ; k < ROTATION_KEYS ; ++k )
+		{
+			float t = LENGTH * k / (ROTATION_KEYS-1);
+			float a = Math::sin(t*1.7f+i*.3f) * 1.5f;
+			float axis[3] = { Math::cos(i*.7f), Math::sin(i*.7f), .5f };
+			float len = Math::sqrt( axis[0]*axis[0]+axis[1]*axis[1]+axis[2]*axis[2] );
+			float s = Math::sin(a*.5f) / len;
+			float q[4] = { axis[0]*s, axis[1]*s, axis[2]*s, Math::cos(a*.5f) };
+			rot->setKeyTime( k, t );
+			rot->setKeyValue( k, q, 4 );
+		}
+
+		positions.add( pos );
+		rotations.add( rot );
+		postracks[i] = pos;
+		rottracks[i] = rot;
+	}
+
+	// compress
+	P(AnimationClip) clip = new AnimationClip( BONES, postracks, rottracks, 30.f, 1e-3f, 1e-3f );
+	assert( clip->bones() == BONES );
+	assert( Math::abs(clip->startTime()) < 1e-6f );
+	assert( Math::abs(clip->endTime()-LENGTH) < 1e-6f );
+	int rawbytes = BONES * (POSITION_KEYS*4*4 + ROTATION_KEYS*5*4);
+	printf( "AnimationClip: %d segments, %d keys, %d bytes (interpolators %d bytes)\n", clip->segments(), clip->keys(), clip->bytes(), rawbytes );
+
+	// accuracy against reference tracks
+	float pose[BONES*7];
+	float maxPosError = 0.f;
+	float maxRotError = 0.f;
+	for ( int n = 0 ; n < POSES ; ++n )
+	{
+		float time = LENGTH * n / POSES;
+		clip->evaluate( time, pose, pose+BONES*3 );
+		for ( int i = 0 ; i < BONES ; ++i )
+		{
+			float p[3];
+			postracks[i]->getValue( time, p, 3, 0 );
+			for ( int k = 0 ; k < 3 ; ++k )
+			{
+				float err = Math::abs( pose[k*BONES+i] - p[k] );
+				if ( err > maxPosError )
+					maxPosError = err;
+			}
+
+			float q[4];
+			rottracks[i]->getValue( time, q, 4, 0 );
+			float dot = 0.f;
+			for ( int k = 0 ; k < 4 ; ++k )
+				dot += pose[(3+k)*BONES+i] * q[k];
+			float err = 1.f - Math::abs(dot);
+			if ( err > maxRotError )
+				maxRotError = err;
+		}
+	}
+	printf( "AnimationClip: max position error %g, max rotation error (1-|dot|) %g\n", maxPosError, maxRotError );
+	assert( maxPosError < 5e-3f );
+	assert( maxRotError < 1e-4f );
+
+	// end behaviours
+	float pose2[BONES*7];
+	clip->evaluate( LENGTH+.5f, pose, pose+BONES*3 );
+	clip->evaluate( .5f, pose2, pose2+BONES*3 );
+	for ( int i = 0 ; i < BONES*7 ; ++i )
+		assert( Math::abs(pose[i]-pose2[i]) < 1e-4f );
+	clip->setEndBehaviour( Interpolator::BEHAVIOUR_CONSTANT );
+	clip->evaluate( LENGTH+.5f, pose, pose+BONES*3 );
+	clip->evaluate( LENGTH, pose2, pose2+BONES*3 );
+	for ( int i = 0 ; i < BONES*7 ; ++i )
+		assert( Math::abs(pose[i]-pose2[i]) < 1e-4f );
+
+	// speed against reference tracks
+	float checksum = 0.f;
+	{Profile pr( "interpolators" );
+	int poshints[BONES] = {0};
+	int rothints[BONES] = {0};
+	for ( int n = 0 ; n < POSES ; ++n )
+	{
+		float time = LENGTH * n / POSES;
+		for ( int i = 0 ; i < BONES ; ++i )
+		{
+			poshints[i] = postracks[i]->getValue( time, pose+i*7, 3, poshints[i] );
+			rothints[i] = rottracks[i]->getValue( time, pose+i*7+3, 4, rothints[i] );
+		}
+		checksum += pose[0];
+	}}
+
+	{Profile pr( "clip" );
+	for ( int n = 0 ; n < POSES ; ++n )
+	{
+		float time = LENGTH * n / POSES;
+		clip->evaluate( time, pose, pose+BONES*3 );
+		checksum += pose[0];
+	}}
+
+	for ( int k = 0 ; k < Profile::count() ; ++k )
+	{
+		Profile::BlockInfo* b = Profile::get( k );
+		printf( "%s: %g ms for %d poses of %d bones\n", b->name(), b->time()*1e3f, POSES, BONES );
+	}
+	return checksum != checksum;
+}
+
+//-----------------------------------------------------------------------------
+
+static tester::Test reg( test, __FILE__ );
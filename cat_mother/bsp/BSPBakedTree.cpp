@@ -0,0 +1,110 @@
+#include "BSPBakedTree.h"
+#include "BSPTree.h"
+#include "BSPNode.h"
+#include "BSPPolygon.h"
+#include <assert.h>
+#include "config.h"
+
+//-----------------------------------------------------------------------------
+
+using namespace lang;
+using namespace util;
+using namespace math;
+
+//-----------------------------------------------------------------------------
+
+namespace bsp
+{
+
+
+BSPBakedTree::BSPBakedTree( BSPTree* tree ) :
+	m_nodes( Allocator<Node>(__FILE__,__LINE__) ),
+	m_polys( Allocator<Polygon>(__FILE__,__LINE__) ),
+	m_vertices( Allocator<Vector3>(__FILE__,__LINE__) ),
+	m_edgePlanes( Allocator<Vector4>(__FILE__,__LINE__) ),
+	m_sources( Allocator<const BSPPolygon*>(__FILE__,__LINE__) ),
+	m_tree( tree )
+{
+	assert( tree );
+
+	if ( tree->nodes() > 0 )
+	{
+		// reserve exact sizes to avoid reallocation while baking
+		int nodePolys = 0;
+		int polyVerts = 0;
+		for ( int i = 0 ; i < tree->nodes() ; ++i )
+		{
+			const BSPNode* node = tree->getNode(i);
+			for ( int k = 0 ; k < node->polygons() ; ++k )
+				polyVerts += node->getPolygon(k).vertices();
+			nodePolys += node->polygons();
+		}
+		m_nodes.setSize( tree->nodes() );
+		m_polys.setSize( nodePolys );
+		m_sources.setSize( nodePolys );
+		m_vertices.setSize( polyVerts );
+		m_edgePlanes.setSize( polyVerts );
+		m_nodes.clear();
+		m_polys.clear();
+		m_sources.clear();
+		m_vertices.clear();
+		m_edgePlanes.clear();
+
+		bake( tree->root() );
+	}
+}
+
+BSPBakedTree::~BSPBakedTree()
+{
+}
+
+BSPTree* BSPBakedTree::tree() const
+{
+	return m_tree;
+}
+
+int BSPBakedTree::bake( const BSPNode* node )
+{
+	if ( !node )
+		return NULL_NODE;
+
+	int index = m_nodes.size();
+	Node n;
+	n.plane = node->plane();
+	n.pos = NULL_NODE;
+	n.neg = NULL_NODE;
+	n.firstPoly = m_polys.size();
+	n.polyCount = node->polygons();
+	m_nodes.add( n );
+
+	for ( int i = 0 ; i < node->polygons() ; ++i )
+	{
+		const BSPPolygon& src = node->getPolygon(i);
+		Vector3 center = src.boundSphereCenter();
+
+		Polygon p;
+		p.plane = src.plane();
+		p.boundSphere = Vector4( center.x, center.y, center.z, src.boundSphereRadiusSquared() );
+		p.firstVertex = m_vertices.size();
+		p.vertices = src.vertices();
+		p.collisionMask = src.collisionMask();
+		m_polys.add( p );
+		m_sources.add( &src );
+
+		for ( int k = 0 ; k < src.vertices() ; ++k )
+		{
+			m_vertices.add( src.getVertex(k) );
+			m_edgePlanes.add( src.getEdgePlane(k) );
+		}
+	}
+
+	// positive subtree follows its parent directly
+	int pos = bake( node->positive() );
+	int neg = bake( node->negative() );
+	m_nodes[index].pos = pos;
+	m_nodes[index].neg = neg;
+	return index;
+}
+
+
+} // bsp
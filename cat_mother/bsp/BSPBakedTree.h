@@ -0,0 +1,164 @@
+#ifndef _BSP_BSPBAKEDTREE_H
+#define _BSP_BSPBAKEDTREE_H
+
+
+#include <lang/Object.h>
+#include <util/Vector.h>
+#include <math/Vector3.h>
+#include <math/Vector4.h>
+
+
+namespace bsp
+{
+
+
+class BSPNode;
+class BSPTree;
+class BSPPolygon;
+
+
+/**
+ * Immutable BSP tree in compact form for fast collision queries.
+ * Nodes are stored in a contiguous array in depth-first order
+ * (positive child follows its parent) and referenced by index.
+ * Polygon planes, bounding spheres, vertices and edge planes
+ * are stored in packed arrays, so traversal doesn't need to
+ * follow pointers across the heap.
+ * Use BSPCollisionUtil to perform queries against the tree.
+ */
+class BSPBakedTree :
+	public lang::Object
+{
+public:
+	/** Index of a missing child node. */
+	enum { NULL_NODE = -1 };
+
+	/** Node reference type. */
+	typedef int		NodeType;
+
+	/** Polygon reference type. */
+	typedef int		PolygonType;
+
+	/** Bakes specified BSP tree. Keeps reference to the source tree. */
+	explicit BSPBakedTree( BSPTree* tree );
+
+	///
+	~BSPBakedTree();
+
+	/** Returns index of the root node or NULL_NODE if the tree is empty. */
+	int						root() const											{return m_nodes.size() > 0 ? 0 : NULL_NODE;}
+
+	/** Returns number of nodes in the tree. */
+	int						nodes() const											{return m_nodes.size();}
+
+	/** Returns number of polygon references in the nodes. */
+	int						polygons() const										{return m_polys.size();}
+
+	/** Returns true if the node index refers to a node. */
+	bool					validNode( int node ) const								{return node >= 0;}
+
+	/** Returns separating plane of the node. */
+	const math::Vector4&	nodePlane( int node ) const								{return m_nodes[node].plane;}
+
+	/** Returns positive child of the node or NULL_NODE if none. */
+	int						positive( int node ) const								{return m_nodes[node].pos;}
+
+	/** Returns negative child of the node or NULL_NODE if none. */
+	int						negative( int node ) const								{return m_nodes[node].neg;}
+
+	/** Returns true if the node has no children. */
+	bool					leaf( int node ) const									{return m_nodes[node].pos < 0 && m_nodes[node].neg < 0;}
+
+	/** Returns number of polygons on the node plane. */
+	int						nodePolygons( int node ) const							{return m_nodes[node].polyCount;}
+
+	/** Returns index of ith polygon on the node plane. */
+	int						getNodePolygon( int node, int i ) const					{return m_nodes[node].firstPoly + i;}
+
+	/** Returns plane of the polygon. */
+	const math::Vector4&	polygonPlane( int poly ) const							{return m_polys[poly].plane;}
+
+	/** Returns collision mask of the polygon. */
+	int						polygonCollisionMask( int poly ) const					{return m_polys[poly].collisionMask;}
+
+	/** Returns number of vertices in the polygon. */
+	int						polygonVertices( int poly ) const						{return m_polys[poly].vertices;}
+
+	/** Returns ith vertex of the polygon. */
+	const math::Vector3&	getPolygonVertex( int poly, int i ) const				{return m_vertices[m_polys[poly].firstVertex+i];}
+
+	/** Returns distance to polygon bounding sphere squared. */
+	float					getPolygonDistanceSquared( int poly, const math::Vector3& point ) const;
+
+	/**
+	 * Returns true if specified point is inside the polygon (inclusive).
+	 * Assumes that the point is on the polygon plane.
+	 */
+	bool					isPointInPolygon( int poly, const math::Vector3& point ) const;
+
+	/** Returns source tree polygon of the baked polygon. */
+	const BSPPolygon*		getPolygon( int poly ) const							{return m_sources[poly];}
+
+	/** Returns source tree. */
+	BSPTree*				tree() const;
+
+private:
+	struct Node
+	{
+		math::Vector4	plane;
+		int				pos;
+		int				neg;
+		int				firstPoly;
+		int				polyCount;
+	};
+
+	struct Polygon
+	{
+		math::Vector4	plane;
+		math::Vector4	boundSphere;
+		int				firstVertex;
+		int				vertices;
+		int				collisionMask;
+	};
+
+	util::Vector<Node>				m_nodes;
+	util::Vector<Polygon>			m_polys;
+	util::Vector<math::Vector3>		m_vertices;
+	util::Vector<math::Vector4>		m_edgePlanes;
+	util::Vector<const BSPPolygon*>	m_sources;
+	P(BSPTree)						m_tree;
+
+	int		bake( const BSPNode* node );
+
+	BSPBakedTree( const BSPBakedTree& );
+	BSPBakedTree& operator=( const BSPBakedTree& );
+};
+
+
+inline float BSPBakedTree::getPolygonDistanceSquared( int poly, const math::Vector3& point ) const
+{
+	const math::Vector4& s = m_polys[poly].boundSphere;
+	float dx = s.x-point.x;
+	float dy = s.y-point.y;
+	float dz = s.z-point.z;
+	return dx*dx+dy*dy+dz*dz-s.w;
+}
+
+inline bool BSPBakedTree::isPointInPolygon( int poly, const math::Vector3& point ) const
+{
+	const Polygon& p = m_polys[poly];
+	const math::Vector4* ep = m_edgePlanes.begin() + p.firstVertex;
+	for ( int i = 0 ; i < p.vertices ; ++i )
+	{
+		float d = point.x*ep[i].x + point.y*ep[i].y + point.z*ep[i].z + ep[i].w;
+		if ( d > 0.f )
+			return false;
+	}
+	return true;
+}
+
+
+} // bsp
+
+
+#endif // _BSP_BSPBAKEDTREE_H
@@ -1,6 +1,7 @@
 #include "BSPCollisionUtil.h"
 #include "BSPNode.h"
 #include "BSPPolygon.h"
+#include "BSPBakedTree.h"
 #include <dev/Profile.h>
 #include <lang/Float.h>
 #include <lang/Math.h>
@@ -10,6 +11,9 @@
 #include <assert.h>
 #include <functional>
 #include "config.h"
+#ifdef BSP_SSE
+#include <xmmintrin.h>
+#endif
 
 //-----------------------------------------------------------------------------
 
@@ -38,12 +42,85 @@ public:
 
 //-----------------------------------------------------------------------------
 
+/** 
+ * Adapts pointer based BSPNode tree to the interface of BSPBakedTree 
+ * so that the same collision checking code works for both.
+ */
+class BSPNodeTree
+{
+public:
+	typedef BSPNode*			NodeType;
+	typedef const BSPPolygon*	PolygonType;
+
+	bool					validNode( BSPNode* node ) const										{return node != 0;}
+	const Vector4&			nodePlane( BSPNode* node ) const										{return node->plane();}
+	BSPNode*				positive( BSPNode* node ) const											{return node->positive();}
+	BSPNode*				negative( BSPNode* node ) const											{return node->negative();}
+	bool					leaf( BSPNode* node ) const												{return node->leaf();}
+	int						nodePolygons( BSPNode* node ) const										{return node->polygons();}
+	const BSPPolygon*		getNodePolygon( BSPNode* node, int i ) const							{return &node->getPolygon(i);}
+	const Vector4&			polygonPlane( const BSPPolygon* poly ) const							{return poly->plane();}
+	int						polygonCollisionMask( const BSPPolygon* poly ) const					{return poly->collisionMask();}
+	int						polygonVertices( const BSPPolygon* poly ) const							{return poly->vertices();}
+	const Vector3&			getPolygonVertex( const BSPPolygon* poly, int i ) const					{return poly->getVertex(i);}
+	float					getPolygonDistanceSquared( const BSPPolygon* poly, const Vector3& point ) const	{return poly->getDistanceSquared(point);}
+	bool					isPointInPolygon( const BSPPolygon* poly, const Vector3& point ) const	{return poly->isPointInPolygon(point);}
+	const BSPPolygon*		getPolygon( const BSPPolygon* poly ) const								{return poly;}
+};
+
+//-----------------------------------------------------------------------------
+
 static BSPCollisionUtil::Statistics s_statistics;
 
 //-----------------------------------------------------------------------------
 
+/**
+ * Finds intersection of a line segment against single polygon.
+ * @param tree BSP tree (BSPNodeTree or BSPBakedTree).
+ * @param poly Polygon of the BSP tree.
+ * @param startDist Distance of the line segment start to the polygon plane.
+ * @param endDist Distance of the line segment end to the polygon plane.
+ * @param start Start of the line segment.
+ * @param delta Vector from start to end of the line segment.
+ * @param t [in/out] Receives relative length to intersection IF there is an intersection closer than initial value. (see cmp parameter)
+ * @param cpoly [out] Receives pointer to the collision polygon.
+ * @param cmp Binary function to compare if current intersection is closer than initial collision.
+ */
+template <class Tree, class Cmp> static void intersectLinePolygon( const Tree& tree, typename Tree::PolygonType poly,
+	float startDist, float endDist, const Vector3& start, const Vector3& delta,
+	float* t, const BSPPolygon** cpoly, Cmp cmp )
+{
+	if ( startDist > -BSPNode::PLANE_THICKNESS )
+	{
+		if ( endDist < BSPNode::PLANE_THICKNESS )
+		{
+			// +-
+			float deltaDist = startDist - endDist;
+			if ( deltaDist > Float::MIN_VALUE )
+			{
+				float u = startDist / deltaDist;
+				if ( cmp(u,*t) )
+				{
+					Vector3 planePoint = start + delta * u;
+					if ( tree.isPointInPolygon(poly,planePoint) )
+					{
+						*t = u;
+						*cpoly = tree.getPolygon(poly);
+					}
+				}
+			}
+			else
+			{
+				// line goes along the plane
+				// (ignore the case for now)
+			}
+		}
+	}
+}
+
 /** 
  * Finds the first intersection of a line segment against node polygons.
+ * @param tree BSP tree (BSPNodeTree or BSPBakedTree).
  * @param node Node of the BSP tree.
  * @param start Start of the line segment.
  * @param end End of the line segment.
@@ -53,7 +130,7 @@ static BSPCollisionUtil::Statistics s_statistics;
  * @param cpoly [out] Receives pointer to the collision polygon.
  * @param cmp Binary function to compare if current intersection is closer than initial collision.
  */
-template <class Cmp> static void findLineIntersectionPolygon( BSPNode* node, 
+template <class Tree, class Cmp> static void findLineIntersectionPolygon( const Tree& tree, typename Tree::NodeType node, 
 	const Vector3& start, const Vector3& end, 
 	const Vector3& delta, int collisionMask,
 	float* t, const BSPPolygon** cpoly, Cmp cmp )
@@ -61,44 +138,17 @@ template <class Cmp> static void findLineIntersectionPolygon( BSPNode* node,
 	assert( t );
 	assert( cpoly );
 
-	if ( node )
+	if ( tree.validNode(node) )
 	{
-		for ( int i = 0 ; i < node->polygons() ; ++i )
+		for ( int i = 0 ; i < tree.nodePolygons(node) ; ++i )
 		{
-			const BSPPolygon* poly = &node->getPolygon(i);
-			if ( poly->collisionMask() & collisionMask )
+			typename Tree::PolygonType poly = tree.getNodePolygon( node, i );
+			if ( tree.polygonCollisionMask(poly) & collisionMask )
 			{
-				const Vector4&	plane		= poly->plane();
+				const Vector4&	plane		= tree.polygonPlane(poly);
 				float			startDist	= plane.x*start.x + plane.y*start.y + plane.z*start.z + plane.w;
 				float			endDist		= plane.x*end.x + plane.y*end.y + plane.z*end.z + plane.w;
-
-				if ( startDist > -BSPNode::PLANE_THICKNESS )
-				{
-					if ( endDist < BSPNode::PLANE_THICKNESS )
-					{
-						// +-
-						float deltaDist = startDist - endDist;
-						if ( deltaDist > Float::MIN_VALUE )
-						{
-							float u = startDist / deltaDist;
-							if ( cmp(u,*t) )
-							{
-								Vector3 planePoint = start + delta * u;
-								if ( poly->isPointInPolygon(planePoint) )
-								{
-									*t = u;
-									*cpoly = poly;
-								}
-							}
-						}
-						else
-						{
-							// line goes along the plane
-							// (ignore the case for now)
-						}
-					}
-				}
-
+				intersectLinePolygon( tree, poly, startDist, endDist, start, delta, t, cpoly, cmp );
 				++s_statistics.linePolygonTests;
 			}
 		}
@@ -107,6 +157,7 @@ template <class Cmp> static void findLineIntersectionPolygon( BSPNode* node,
 
 /** 
  * Finds the first intersection of the line segment against BSP node tree. 
+ * @param tree BSP tree (BSPNodeTree or BSPBakedTree).
  * @param root Root node of the BSP tree.
  * @param start Start of the line segment.
  * @param end End of the line segment.
@@ -115,17 +166,17 @@ template <class Cmp> static void findLineIntersectionPolygon( BSPNode* node,
  * @param t [in/out] Receives relative length to intersection IF there is an intersection closer than initial value.
  * @param cpoly [out] Receives pointer to the collision polygon.
  */
-static void findLineIntersectionRecurse( BSPNode* root, 
+template <class Tree> static void findLineIntersectionRecurse( const Tree& tree, typename Tree::NodeType root, 
 	const Vector3& start, const Vector3& end, 
 	const Vector3& delta, int collisionMask, float* t, const BSPPolygon** cpoly )
 {
 	assert( t );
 	assert( cpoly );
 
-	if ( !root )
+	if ( !tree.validNode(root) )
 		return;
 
-	const Vector4&		plane		= root->plane();
+	const Vector4&		plane		= tree.nodePlane(root);
 	float				startDist	= plane.x*start.x + plane.y*start.y + plane.z*start.z + plane.w;
 	float				endDist		= plane.x*end.x + plane.y*end.y + plane.z*end.z + plane.w;
 	std::less<float>	cmp;
@@ -135,20 +186,20 @@ static void findLineIntersectionRecurse( BSPNode* root,
 		if ( endDist > 0.f )
 		{
 			// ++
-			findLineIntersectionRecurse( root->positive(), start, end, delta, collisionMask, t, cpoly );
+			findLineIntersectionRecurse( tree, tree.positive(root), start, end, delta, collisionMask, t, cpoly );
 			if ( startDist <= BSPNode::PLANE_THICKNESS || endDist <= BSPNode::PLANE_THICKNESS ||
-				root->leaf() )
-				findLineIntersectionPolygon( root, start, end, delta, collisionMask, t, cpoly, cmp );
+				tree.leaf(root) )
+				findLineIntersectionPolygon( tree, root, start, end, delta, collisionMask, t, cpoly, cmp );
 		}
 		else
 		{
 			// +-
 			float t0 = *t;
-			findLineIntersectionRecurse( root->positive(), start, end, delta, collisionMask, t, cpoly );
+			findLineIntersectionRecurse( tree, tree.positive(root), start, end, delta, collisionMask, t, cpoly );
 			if ( *t == t0 )
 			{
-				findLineIntersectionPolygon( root, start, end, delta, collisionMask, t, cpoly, cmp );
-				findLineIntersectionRecurse( root->negative(), start, end, delta, collisionMask, t, cpoly );
+				findLineIntersectionPolygon( tree, root, start, end, delta, collisionMask, t, cpoly, cmp );
+				findLineIntersectionRecurse( tree, tree.negative(root), start, end, delta, collisionMask, t, cpoly );
 			}
 		}
 	}
@@ -158,26 +209,27 @@ static void findLineIntersectionRecurse( BSPNode* root,
 		{
 			// -+
 			float t0 = *t;
-			findLineIntersectionRecurse( root->negative(), start, end, delta, collisionMask, t, cpoly );
+			findLineIntersectionRecurse( tree, tree.negative(root), start, end, delta, collisionMask, t, cpoly );
 			if ( *t == t0 )
 			{
-				findLineIntersectionPolygon( root, start, end, delta, collisionMask, t, cpoly, cmp );
-				findLineIntersectionRecurse( root->positive(), start, end, delta, collisionMask, t, cpoly );
+				findLineIntersectionPolygon( tree, root, start, end, delta, collisionMask, t, cpoly, cmp );
+				findLineIntersectionRecurse( tree, tree.positive(root), start, end, delta, collisionMask, t, cpoly );
 			}
 		}
 		else
 		{
 			// --
-			findLineIntersectionRecurse( root->negative(), start, end, delta, collisionMask, t, cpoly );
+			findLineIntersectionRecurse( tree, tree.negative(root), start, end, delta, collisionMask, t, cpoly );
 			if ( -startDist <= BSPNode::PLANE_THICKNESS || -endDist <= BSPNode::PLANE_THICKNESS ||
-				root->leaf() )
-				findLineIntersectionPolygon( root, start, end, delta, collisionMask, t, cpoly, cmp );
+				tree.leaf(root) )
+				findLineIntersectionPolygon( tree, root, start, end, delta, collisionMask, t, cpoly, cmp );
 		}
 	}
 }
 
 /** 
  * Finds the last intersection of the line segment against BSP node tree. 
+ * @param tree BSP tree (BSPNodeTree or BSPBakedTree).
  * @param root Root node of the BSP tree.
  * @param start Start of the line segment.
  * @param end End of the line segment.
@@ -186,17 +238,17 @@ static void findLineIntersectionRecurse( BSPNode* root,
  * @param t [in/out] Receives relative length to intersection IF there is an intersection closer than initial value.
  * @param cpoly [out] Receives pointer to the collision polygon.
  */
-static void findLastLineIntersectionRecurse( BSPNode* root, 
+template <class Tree> static void findLastLineIntersectionRecurse( const Tree& tree, typename Tree::NodeType root, 
 	const Vector3& start, const Vector3& end, 
 	const Vector3& delta, int collisionMask, float* t, const BSPPolygon** cpoly )
 {
 	assert( t );
 	assert( cpoly );
 
-	if ( !root )
+	if ( !tree.validNode(root) )
 		return;
 
-	const Vector4&		plane		= root->plane();
+	const Vector4&		plane		= tree.nodePlane(root);
 	float				startDist	= plane.x*start.x + plane.y*start.y + plane.z*start.z + plane.w;
 	float				endDist		= plane.x*end.x + plane.y*end.y + plane.z*end.z + plane.w;
 	std::greater<float>	cmp;
@@ -206,20 +258,20 @@ static void findLastLineIntersectionRecurse( BSPNode* root,
 		if ( endDist > 0.f )
 		{
 			// ++
-			findLastLineIntersectionRecurse( root->positive(), start, end, delta, collisionMask, t, cpoly );
+			findLastLineIntersectionRecurse( tree, tree.positive(root), start, end, delta, collisionMask, t, cpoly );
 			if ( startDist <= BSPNode::PLANE_THICKNESS || endDist <= BSPNode::PLANE_THICKNESS ||
-				root->leaf() )
-				findLineIntersectionPolygon( root, start, end, delta, collisionMask, t, cpoly, cmp );
+				tree.leaf(root) )
+				findLineIntersectionPolygon( tree, root, start, end, delta, collisionMask, t, cpoly, cmp );
 		}
 		else
 		{
 			// +-
 			float t0 = *t;
-			findLastLineIntersectionRecurse( root->negative(), start, end, delta, collisionMask, t, cpoly );
+			findLastLineIntersectionRecurse( tree, tree.negative(root), start, end, delta, collisionMask, t, cpoly );
 			if ( *t == t0 )
 			{
-				findLineIntersectionPolygon( root, start, end, delta, collisionMask, t, cpoly, cmp );
-				findLastLineIntersectionRecurse( root->positive(), start, end, delta, collisionMask, t, cpoly );
+				findLineIntersectionPolygon( tree, root, start, end, delta, collisionMask, t, cpoly, cmp );
+				findLastLineIntersectionRecurse( tree, tree.positive(root), start, end, delta, collisionMask, t, cpoly );
 			}
 		}
 	}
@@ -229,20 +281,20 @@ static void findLastLineIntersectionRecurse( BSPNode* root,
 		{
 			// -+
 			float t0 = *t;
-			findLastLineIntersectionRecurse( root->positive(), start, end, delta, collisionMask, t, cpoly );
+			findLastLineIntersectionRecurse( tree, tree.positive(root), start, end, delta, collisionMask, t, cpoly );
 			if ( *t == t0 )
 			{
-				findLineIntersectionPolygon( root, start, end, delta, collisionMask, t, cpoly, cmp );
-				findLastLineIntersectionRecurse( root->negative(), start, end, delta, collisionMask, t, cpoly );
+				findLineIntersectionPolygon( tree, root, start, end, delta, collisionMask, t, cpoly, cmp );
+				findLastLineIntersectionRecurse( tree, tree.negative(root), start, end, delta, collisionMask, t, cpoly );
 			}
 		}
 		else
 		{
 			// --
-			findLastLineIntersectionRecurse( root->negative(), start, end, delta, collisionMask, t, cpoly );
+			findLastLineIntersectionRecurse( tree, tree.negative(root), start, end, delta, collisionMask, t, cpoly );
 			if ( -startDist <= BSPNode::PLANE_THICKNESS || -endDist <= BSPNode::PLANE_THICKNESS ||
-				root->leaf() )
-				findLineIntersectionPolygon( root, start, end, delta, collisionMask, t, cpoly, cmp );
+				tree.leaf(root) )
+				findLineIntersectionPolygon( tree, root, start, end, delta, collisionMask, t, cpoly, cmp );
 		}
 	}
 }
@@ -276,8 +328,109 @@ inline static void setMovingSphereCollisionInfo( const Vector3& start, const Vec
 	}
 }
 
+/**
+ * Finds intersection of a moving sphere against single polygon.
+ * @param tree BSP tree (BSPNodeTree or BSPBakedTree).
+ * @param poly Polygon of the BSP tree.
+ * @param start Start of the line segment.
+ * @param end End of the line segment.
+ * @param delta Vector from start to end of the line segment.
+ * @param r Radius of the sphere.
+ * @param t [in/out] Receives relative length to intersection IF there is an intersection closer than initial value.
+ * @param cinfo [out] Collision check results.
+ */
+template <class Tree> static void intersectMovingSpherePolygon( const Tree& tree, typename Tree::PolygonType poly, const Vector3& start,
+	const Vector3& end, const Vector3& delta, float r, float* t,
+	BSPCollisionInfo* cinfo )
+{
+	const Vector4&	plane		= tree.polygonPlane(poly);
+	float			startDist	= plane.x*start.x + plane.y*start.y + plane.z*start.z + plane.w;
+	float			endDist		= plane.x*end.x + plane.y*end.y + plane.z*end.z + plane.w;
+
+	// some part of sphere movement in node plane thickness range?
+	if ( !( (startDist-r > BSPNode::PLANE_THICKNESS && endDist-r > BSPNode::PLANE_THICKNESS) ||
+		(-startDist-r > BSPNode::PLANE_THICKNESS && -endDist-r > BSPNode::PLANE_THICKNESS) ) )
+	{
+		// test line segment against r-shifted polygon
+		Vector3 planeNormal( plane.x, plane.y, plane.z );
+		Vector3 shiftDelta = planeNormal * -r;
+		Vector3 startShifted = start + shiftDelta;
+		float u;
+		if ( Intersection::findLinePlaneIntersection(start, shiftDelta, plane, &u) )
+		{
+			// already inside polygon
+			Vector3 ipoint = start + shiftDelta*u;
+			if ( tree.isPointInPolygon(poly,ipoint) )
+			{
+				setMovingSphereCollisionInfo( start, delta, 0.f, tree.getPolygon(poly), planeNormal, ipoint, cinfo, t );
+				return;
+			}
+		}
+		else if ( Intersection::findLinePlaneIntersection(startShifted, delta, plane, &u) && u <= *t )
+		{
+			Vector3 ipoint = startShifted + delta*u;
+			if ( tree.isPointInPolygon(poly,ipoint) )
+			{
+				setMovingSphereCollisionInfo( start, delta, u, tree.getPolygon(poly), planeNormal, ipoint, cinfo, t );
+				return;
+			}
+		}
+
+		// test line segment against vertex r-spheres
+		for ( int i = 0 ; i < tree.polygonVertices(poly) ; ++i )
+		{
+			const Vector3& vert = tree.getPolygonVertex(poly,i);
+			if ( Intersection::findLineSphereIntersection(start, delta, vert, r, &u) && u <= *t )
+			{
+				Vector3 iposition = start + delta*u;
+				Vector3 inormal = (iposition - vert).normalize();
+				Vector3 ipoint; 
+				if ( u == 0.f )
+					ipoint = vert;
+				else
+					ipoint = iposition - inormal*r;
+				setMovingSphereCollisionInfo( start, delta, u, tree.getPolygon(poly), inormal, ipoint, cinfo, t );
+			}
+		}
+
+		// test line segment against edge (k,i) r-cylinders
+		const float MIN_EDGE_LEN = 1e-12f;
+		int k = tree.polygonVertices(poly) - 1;
+		for ( int i = 0 ; i < tree.polygonVertices(poly) ; k = i++ )
+		{
+			Vector3 e0 = tree.getPolygonVertex(poly,k);
+			Vector3 e1 = tree.getPolygonVertex(poly,i);
+			Vector3 cylCenter = (e0+e1)*.5f;
+			Vector3 cylAxis (e1-e0);
+			float cylLen = cylAxis.length();
+			if ( cylLen > MIN_EDGE_LEN )
+			{
+				Vector3 inormal(0,0,0);
+				cylAxis *= 1.f / cylLen;
+				if ( Intersection::findLineCylinderIntersection(start, delta, cylCenter, cylAxis, r, cylLen*.5f, &u, &inormal) && u <= *t )
+				{ 
+					Vector3 iposition = start + delta*u;
+					Vector3 ipoint;
+					float ndotp;
+					if ( u == 0.f )
+					{
+						ndotp = inormal.dot(iposition-cylCenter);
+						ipoint = iposition - inormal*ndotp;
+					}
+					else
+					{
+						ipoint = iposition - inormal*r;
+					}
+					setMovingSphereCollisionInfo( start, delta, u, tree.getPolygon(poly), inormal, ipoint, cinfo, t );
+				}
+			}
+		}
+	}
+}
+
 /** 
  * Finds the first intersection of a moving sphere against node polygons.
+ * @param tree BSP tree (BSPNodeTree or BSPBakedTree).
  * @param node Node of the BSP tree.
  * @param start Start of the line segment.
  * @param end End of the line segment.
@@ -287,109 +440,26 @@ inline static void setMovingSphereCollisionInfo( const Vector3& start, const Vec
  * @param t [in/out] Receives relative length to intersection IF there is an intersection closer than initial value. (see cmp parameter)
  * @param cinfo [out] Collision check results.
  */
-static void findMovingSphereIntersectionPolygon( BSPNode* node, const Vector3& start, 
+template <class Tree> static void findMovingSphereIntersectionPolygon( const Tree& tree, typename Tree::NodeType node, const Vector3& start, 
 	const Vector3& end, const Vector3& delta, float r, int collisionMask, float* t,
 	BSPCollisionInfo* cinfo )
 {
 	assert( t );
 	assert( cinfo );
 
-	if ( node )
+	if ( tree.validNode(node) )
 	{
 		Vector3 moveCenter = start + delta * 0.5f;
 		float moveRadius = (end-start).length() + r*2.f;
 		float moveRadiusSqr = moveRadius * moveRadius;
-		for ( int i = 0 ; i < node->polygons() ; ++i )
+		for ( int i = 0 ; i < tree.nodePolygons(node) ; ++i )
 		{
-			const BSPPolygon* poly = &node->getPolygon(i);
-			if ( collisionMask & poly->collisionMask() )
+			typename Tree::PolygonType poly = tree.getNodePolygon( node, i );
+			if ( collisionMask & tree.polygonCollisionMask(poly) )
 			{
-				if ( poly->getDistanceSquared(moveCenter) < moveRadiusSqr )
+				if ( tree.getPolygonDistanceSquared(poly,moveCenter) < moveRadiusSqr )
 				{
-					const Vector4&	plane		= poly->plane();
-					float			startDist	= plane.x*start.x + plane.y*start.y + plane.z*start.z + plane.w;
-					float			endDist		= plane.x*end.x + plane.y*end.y + plane.z*end.z + plane.w;
-
-					// some part of sphere movement in node plane thickness range?
-					if ( !( (startDist-r > BSPNode::PLANE_THICKNESS && endDist-r > BSPNode::PLANE_THICKNESS) ||
-						(-startDist-r > BSPNode::PLANE_THICKNESS && -endDist-r > BSPNode::PLANE_THICKNESS) ) )
-					{
-						// test line segment against r-shifted polygon
-						Vector3 planeNormal( plane.x, plane.y, plane.z );
-						Vector3 shiftDelta = planeNormal * -r;
-						Vector3 startShifted = start + shiftDelta;
-						float u;
-						if ( Intersection::findLinePlaneIntersection(start, shiftDelta, plane, &u) )
-						{
-							// already inside polygon
-							Vector3 ipoint = start + shiftDelta*u;
-							if ( poly->isPointInPolygon(ipoint) )
-							{
-								setMovingSphereCollisionInfo( start, delta, 0.f, poly, planeNormal, ipoint, cinfo, t );
-								continue;
-							}
-						}
-						else if ( Intersection::findLinePlaneIntersection(startShifted, delta, plane, &u) && u <= *t )
-						{
-							Vector3 ipoint = startShifted + delta*u;
-							if ( poly->isPointInPolygon(ipoint) )
-							{
-								setMovingSphereCollisionInfo( start, delta, u, poly, planeNormal, ipoint, cinfo, t );
-								continue;
-							}
-						}
-
-						// test line segment against vertex r-spheres
-						for ( int i = 0 ; i < poly->vertices() ; ++i )
-						{
-							const Vector3& vert = poly->getVertex(i);
-							if ( Intersection::findLineSphereIntersection(start, delta, vert, r, &u) && u <= *t )
-							{
-								Vector3 iposition = start + delta*u;
-								Vector3 inormal = (iposition - vert).normalize();
-								Vector3 ipoint; 
-								if ( u == 0.f )
-									ipoint = vert;
-								else
-									ipoint = iposition - inormal*r;
-								setMovingSphereCollisionInfo( start, delta, u, poly, inormal, ipoint, cinfo, t );
-							}
-						}
-
-						// test line segment against edge (k,i) r-cylinders
-						const float MIN_EDGE_LEN = 1e-12f;
-						int k = poly->vertices() - 1;
-						for ( int i = 0 ; i < poly->vertices() ; k = i++ )
-						{
-							Vector3 e0 = poly->getVertex(k);
-							Vector3 e1 = poly->getVertex(i);
-							Vector3 cylCenter = (e0+e1)*.5f;
-							Vector3 cylAxis (e1-e0);
-							float cylLen = cylAxis.length();
-							if ( cylLen > MIN_EDGE_LEN )
-							{
-								Vector3 inormal(0,0,0);
-								cylAxis *= 1.f / cylLen;
-								if ( Intersection::findLineCylinderIntersection(start, delta, cylCenter, cylAxis, r, cylLen*.5f, &u, &inormal) && u <= *t )
-								{ 
-									Vector3 iposition = start + delta*u;
-									Vector3 ipoint;
-									float ndotp;
-									if ( u == 0.f )
-									{
-										ndotp = inormal.dot(iposition-cylCenter);
-										ipoint = iposition - inormal*ndotp;
-									}
-									else
-									{
-										ipoint = iposition - inormal*r;
-									}
-									setMovingSphereCollisionInfo( start, delta, u, poly, inormal, ipoint, cinfo, t );
-								}
-							}
-						}
-					}
-
+					intersectMovingSpherePolygon( tree, poly, start, end, delta, r, t, cinfo );
 					++s_statistics.movingSpherePolygonTests;
 				}
 			}
@@ -399,6 +469,7 @@ static void findMovingSphereIntersectionPolygon( BSPNode* node, const Vector3& s
 
 /**
  * Finds the first moving sphere intersection against BSP tree.
+ * @param tree BSP tree (BSPNodeTree or BSPBakedTree).
  * @param root The root node of the BSP tree.
  * @param start Sphere start position.
  * @param end Sphere end position.
@@ -408,14 +479,14 @@ static void findMovingSphereIntersectionPolygon( BSPNode* node, const Vector3& s
  * @param t [in/out] Receives relative length to intersection IF there is an intersection closer than initial value.
  * @param cinfo [out] Collision check results.
  */
-static void findMovingSphereIntersectionRecurse( BSPNode* root, const Vector3& start, 
+template <class Tree> static void findMovingSphereIntersectionRecurse( const Tree& tree, typename Tree::NodeType root, const Vector3& start, 
 	const Vector3& end, const Vector3& delta, float r, int collisionMask, float* t,
 	BSPCollisionInfo* cinfo )
 {
-	if ( !root )
+	if ( !tree.validNode(root) )
 		return;
 	
-	const Vector4&		plane		= root->plane();
+	const Vector4&		plane		= tree.nodePlane(root);
 	float				startDist	= plane.x*start.x + plane.y*start.y + plane.z*start.z + plane.w;
 	float				endDist		= plane.x*end.x + plane.y*end.y + plane.z*end.z + plane.w;
 
@@ -424,23 +495,23 @@ static void findMovingSphereIntersectionRecurse( BSPNode* root, const Vector3& s
 		if ( endDist > 0.f )
 		{
 			// ++
-			findMovingSphereIntersectionRecurse( root->positive(), start, end, delta, r, collisionMask, t, cinfo );
+			findMovingSphereIntersectionRecurse( tree, tree.positive(root), start, end, delta, r, collisionMask, t, cinfo );
 			if ( startDist-r <= BSPNode::PLANE_THICKNESS || endDist-r <= BSPNode::PLANE_THICKNESS )
 			{
-				findMovingSphereIntersectionPolygon( root, start, end, delta, r, collisionMask, t, cinfo );
-				findMovingSphereIntersectionRecurse( root->negative(), start, end, delta, r, collisionMask, t, cinfo );
+				findMovingSphereIntersectionPolygon( tree, root, start, end, delta, r, collisionMask, t, cinfo );
+				findMovingSphereIntersectionRecurse( tree, tree.negative(root), start, end, delta, r, collisionMask, t, cinfo );
 			}
-			else if ( root->leaf() )
+			else if ( tree.leaf(root) )
 			{
-				findMovingSphereIntersectionPolygon( root, start, end, delta, r, collisionMask, t, cinfo );
+				findMovingSphereIntersectionPolygon( tree, root, start, end, delta, r, collisionMask, t, cinfo );
 			}
 		}
 		else
 		{
 			// +-
-			findMovingSphereIntersectionRecurse( root->positive(), start, end, delta, r, collisionMask, t, cinfo );
-			findMovingSphereIntersectionPolygon( root, start, end, delta, r, collisionMask, t, cinfo );
-			findMovingSphereIntersectionRecurse( root->negative(), start, end, delta, r, collisionMask, t, cinfo );
+			findMovingSphereIntersectionRecurse( tree, tree.positive(root), start, end, delta, r, collisionMask, t, cinfo );
+			findMovingSphereIntersectionPolygon( tree, root, start, end, delta, r, collisionMask, t, cinfo );
+			findMovingSphereIntersectionRecurse( tree, tree.negative(root), start, end, delta, r, collisionMask, t, cinfo );
 		}
 	}
 	else
@@ -448,22 +519,22 @@ static void findMovingSphereIntersectionRecurse( BSPNode* root, const Vector3& s
 		if ( endDist > 0.f )
 		{
 			// -+
-			findMovingSphereIntersectionRecurse( root->negative(), start, end, delta, r, collisionMask, t, cinfo );
-			findMovingSphereIntersectionPolygon( root, start, end, delta, r, collisionMask, t, cinfo );
-			findMovingSphereIntersectionRecurse( root->positive(), start, end, delta, r, collisionMask, t, cinfo );
+			findMovingSphereIntersectionRecurse( tree, tree.negative(root), start, end, delta, r, collisionMask, t, cinfo );
+			findMovingSphereIntersectionPolygon( tree, root, start, end, delta, r, collisionMask, t, cinfo );
+			findMovingSphereIntersectionRecurse( tree, tree.positive(root), start, end, delta, r, collisionMask, t, cinfo );
 		}
 		else
 		{
 			// --
-			findMovingSphereIntersectionRecurse( root->negative(), start, end, delta, r, collisionMask, t, cinfo );
+			findMovingSphereIntersectionRecurse( tree, tree.negative(root), start, end, delta, r, collisionMask, t, cinfo );
 			if ( -startDist-r <= BSPNode::PLANE_THICKNESS || -endDist-r <= BSPNode::PLANE_THICKNESS )
 			{
-				findMovingSphereIntersectionPolygon( root, start, end, delta, r, collisionMask, t, cinfo );
-				findMovingSphereIntersectionRecurse( root->positive(), start, end, delta, r, collisionMask, t, cinfo );
+				findMovingSphereIntersectionPolygon( tree, root, start, end, delta, r, collisionMask, t, cinfo );
+				findMovingSphereIntersectionRecurse( tree, tree.positive(root), start, end, delta, r, collisionMask, t, cinfo );
 			}
-			else if ( root->leaf() )
+			else if ( tree.leaf(root) )
 			{
-				findMovingSphereIntersectionPolygon( root, start, end, delta, r, collisionMask, t, cinfo );
+				findMovingSphereIntersectionPolygon( tree, root, start, end, delta, r, collisionMask, t, cinfo );
 			}
 		}
 	}
@@ -471,8 +542,339 @@ static void findMovingSphereIntersectionRecurse( BSPNode* root, const Vector3& s
 
 //-----------------------------------------------------------------------------
 
-bool BSPCollisionUtil::findLineIntersection( BSPNode* root, const Vector3& start, 
-	const Vector3& delta, int collisionMask, float* t, const BSPPolygon** cpoly )
+/** 
+ * Packet of rays or moving spheres traced through the tree together. 
+ * Unused lanes duplicate the first ray so that SIMD plane tests 
+ * always operate on valid values.
+ */
+class BSPPacket
+{
+public:
+	enum { SIZE = 4 };
+
+	float				startX[SIZE];
+	float				startY[SIZE];
+	float				startZ[SIZE];
+	float				endX[SIZE];
+	float				endY[SIZE];
+	float				endZ[SIZE];
+	Vector3				start[SIZE];
+	Vector3				end[SIZE];
+	Vector3				delta[SIZE];
+	Vector3				moveCenter[SIZE];
+	float				moveRadiusSqr[SIZE];
+	float				r[SIZE];
+	float				t[SIZE];
+	BSPCollisionInfo	cinfo[SIZE];
+
+	void	set( int i, const Vector3& start0, const Vector3& delta0, float r0 )
+	{
+		start[i] = start0;
+		delta[i] = delta0;
+		end[i] = start0 + delta0;
+		startX[i] = start[i].x;
+		startY[i] = start[i].y;
+		startZ[i] = start[i].z;
+		endX[i] = end[i].x;
+		endY[i] = end[i].y;
+		endZ[i] = end[i].z;
+		moveCenter[i] = start0 + delta0 * 0.5f;
+		float moveRadius = (end[i]-start0).length() + r0*2.f;
+		moveRadiusSqr[i] = moveRadius * moveRadius;
+		r[i] = r0;
+		t[i] = 1.f;
+	}
+};
+
+/** Extra margin used when packet plane tests reject polygons before exact per ray tests. */
+const float PACKET_REJECT_MARGIN = BSPNode::PLANE_THICKNESS;
+
+/** Returns number of bits set in packet lane mask. */
+inline static int countLanes( int mask )
+{
+	return (mask&1) + (mask>>1&1) + (mask>>2&1) + (mask>>3&1);
+}
+
+/** 
+ * Computes distances of four points to the plane. 
+ * @return Mask of points on positive side of the plane.
+ */
+inline static int getPlaneDistances( const Vector4& plane, 
+	const float* x, const float* y, const float* z, float* dist )
+{
+#ifdef BSP_SSE
+	__m128 d = _mm_mul_ps( _mm_set1_ps(plane.x), _mm_loadu_ps(x) );
+	d = _mm_add_ps( d, _mm_mul_ps(_mm_set1_ps(plane.y),_mm_loadu_ps(y)) );
+	d = _mm_add_ps( d, _mm_mul_ps(_mm_set1_ps(plane.z),_mm_loadu_ps(z)) );
+	d = _mm_add_ps( d, _mm_set1_ps(plane.w) );
+	_mm_storeu_ps( dist, d );
+	return _mm_movemask_ps( _mm_cmpgt_ps(d,_mm_setzero_ps()) );
+#else
+	int mask = 0;
+	for ( int i = 0 ; i < BSPPacket::SIZE ; ++i )
+	{
+		dist[i] = plane.x*x[i] + plane.y*y[i] + plane.z*z[i] + plane.w;
+		if ( dist[i] > 0.f )
+			mask |= 1<<i;
+	}
+	return mask;
+#endif
+}
+
+/** Returns mask of lanes where a <= maxValue or b <= maxValue. */
+inline static int getEitherLessEqualMask( const float* a, const float* b, float maxValue )
+{
+#ifdef BSP_SSE
+	__m128 v = _mm_set1_ps( maxValue );
+	return _mm_movemask_ps( _mm_or_ps(_mm_cmple_ps(_mm_loadu_ps(a),v), _mm_cmple_ps(_mm_loadu_ps(b),v)) );
+#else
+	int mask = 0;
+	for ( int i = 0 ; i < BSPPacket::SIZE ; ++i )
+	{
+		if ( a[i] <= maxValue || b[i] <= maxValue )
+			mask |= 1<<i;
+	}
+	return mask;
+#endif
+}
+
+/** Returns mask of lanes where a >= minValue or b >= minValue. */
+inline static int getEitherGreaterEqualMask( const float* a, const float* b, float minValue )
+{
+#ifdef BSP_SSE
+	__m128 v = _mm_set1_ps( minValue );
+	return _mm_movemask_ps( _mm_or_ps(_mm_cmpge_ps(_mm_loadu_ps(a),v), _mm_cmpge_ps(_mm_loadu_ps(b),v)) );
+#else
+	int mask = 0;
+	for ( int i = 0 ; i < BSPPacket::SIZE ; ++i )
+	{
+		if ( a[i] >= minValue || b[i] >= minValue )
+			mask |= 1<<i;
+	}
+	return mask;
+#endif
+}
+
+/** Returns mask of lanes where a == b. */
+inline static int getEqualMask( const float* a, const float* b )
+{
+#ifdef BSP_SSE
+	return _mm_movemask_ps( _mm_cmpeq_ps(_mm_loadu_ps(a),_mm_loadu_ps(b)) );
+#else
+	int mask = 0;
+	for ( int i = 0 ; i < BSPPacket::SIZE ; ++i )
+	{
+		if ( a[i] == b[i] )
+			mask |= 1<<i;
+	}
+	return mask;
+#endif
+}
+
+/** 
+ * Finds the first intersections of a packet of line segments against node polygons.
+ * Polygon plane distances are computed for all segments at once.
+ * @param tree BSP tree (BSPNodeTree or BSPBakedTree).
+ * @param node Node of the BSP tree.
+ * @param packet Line segments to test. Receives intersections.
+ * @param mask Mask of active segments in the packet.
+ * @param collisionMask Mask for which collision polygons to take into account. Pass -1 for all collision polygons.
+ */
+template <class Tree> static void findLineIntersectionPacketPolygon( const Tree& tree, typename Tree::NodeType node, 
+	BSPPacket& packet, int mask, int collisionMask )
+{
+	std::less<float> cmp;
+	float startDist[BSPPacket::SIZE];
+	float endDist[BSPPacket::SIZE];
+
+	for ( int i = 0 ; i < tree.nodePolygons(node) ; ++i )
+	{
+		typename Tree::PolygonType poly = tree.getNodePolygon( node, i );
+		if ( tree.polygonCollisionMask(poly) & collisionMask )
+		{
+			const Vector4& plane = tree.polygonPlane(poly);
+			getPlaneDistances( plane, packet.startX, packet.startY, packet.startZ, startDist );
+			getPlaneDistances( plane, packet.endX, packet.endY, packet.endZ, endDist );
+
+			for ( int k = 0 ; k < BSPPacket::SIZE ; ++k )
+			{
+				if ( mask & (1<<k) )
+					intersectLinePolygon( tree, poly, startDist[k], endDist[k], packet.start[k], packet.delta[k], 
+						&packet.t[k], &packet.cinfo[k].cpoly, cmp );
+			}
+
+			s_statistics.linePolygonTests += countLanes( mask );
+		}
+	}
+}
+
+/** 
+ * Finds the first intersections of a packet of line segments against BSP node tree. 
+ * Visits nodes in the same order for each segment as findLineIntersectionRecurse 
+ * so the results are identical to single segment queries.
+ * @param tree BSP tree (BSPNodeTree or BSPBakedTree).
+ * @param root Root node of the BSP tree.
+ * @param packet Line segments to test. Receives intersections.
+ * @param mask Mask of active segments in the packet.
+ * @param collisionMask Mask for which collision polygons to take into account. Pass -1 for all collision polygons.
+ */
+template <class Tree> static void findLineIntersectionPacketRecurse( const Tree& tree, typename Tree::NodeType root, 
+	BSPPacket& packet, int mask, int collisionMask )
+{
+	if ( !mask || !tree.validNode(root) )
+		return;
+
+	++s_statistics.packetNodeVisits;
+	s_statistics.packetActiveRays += countLanes( mask );
+
+	const Vector4&	plane = tree.nodePlane(root);
+	float			startDist[BSPPacket::SIZE];
+	float			endDist[BSPPacket::SIZE];
+	int				startPos	= getPlaneDistances( plane, packet.startX, packet.startY, packet.startZ, startDist ) & mask;
+	int				endPos		= getPlaneDistances( plane, packet.endX, packet.endY, packet.endZ, endDist ) & mask;
+	int				startNeg	= mask & ~startPos;
+	int				crossMask	= startPos ^ endPos;
+	bool			leaf		= tree.leaf(root);
+
+	// ++ and -- segments test node polygons only if touching node plane
+	int polyMask;
+	if ( leaf )
+	{
+		polyMask = mask & ~crossMask;
+	}
+	else
+	{
+		polyMask = startPos & endPos & getEitherLessEqualMask( startDist, endDist, BSPNode::PLANE_THICKNESS );
+		polyMask |= startNeg & ~endPos & getEitherGreaterEqualMask( startDist, endDist, -BSPNode::PLANE_THICKNESS );
+	}
+
+	// near side first
+	float t0[BSPPacket::SIZE];
+	for ( int i = 0 ; i < BSPPacket::SIZE ; ++i )
+		t0[i] = packet.t[i];
+	findLineIntersectionPacketRecurse( tree, tree.positive(root), packet, startPos, collisionMask );
+	findLineIntersectionPacketRecurse( tree, tree.negative(root), packet, startNeg, collisionMask );
+
+	// +- and -+ segments continue to far side if no intersection on near side
+	int farMask = crossMask & getEqualMask( packet.t, t0 );
+	polyMask |= farMask;
+
+	if ( polyMask )
+		findLineIntersectionPacketPolygon( tree, root, packet, polyMask, collisionMask );
+	findLineIntersectionPacketRecurse( tree, tree.negative(root), packet, farMask & startPos, collisionMask );
+	findLineIntersectionPacketRecurse( tree, tree.positive(root), packet, farMask & startNeg, collisionMask );
+}
+
+/** 
+ * Finds the first intersections of a packet of moving spheres against node polygons.
+ * @param tree BSP tree (BSPNodeTree or BSPBakedTree).
+ * @param node Node of the BSP tree.
+ * @param packet Moving spheres to test. Receives intersections.
+ * @param mask Mask of active spheres in the packet.
+ * @param collisionMask Mask for which collision polygons to take into account. Pass -1 for all collision polygons.
+ */
+template <class Tree> static void findMovingSphereIntersectionPacketPolygon( const Tree& tree, typename Tree::NodeType node, 
+	BSPPacket& packet, int mask, int collisionMask )
+{
+	float startDist[BSPPacket::SIZE];
+	float endDist[BSPPacket::SIZE];
+
+	for ( int i = 0 ; i < tree.nodePolygons(node) ; ++i )
+	{
+		typename Tree::PolygonType poly = tree.getNodePolygon( node, i );
+		if ( collisionMask & tree.polygonCollisionMask(poly) )
+		{
+			const Vector4& plane = tree.polygonPlane(poly);
+			getPlaneDistances( plane, packet.startX, packet.startY, packet.startZ, startDist );
+			getPlaneDistances( plane, packet.endX, packet.endY, packet.endZ, endDist );
+
+			for ( int k = 0 ; k < BSPPacket::SIZE ; ++k )
+			{
+				if ( !(mask & (1<<k)) )
+					continue;
+
+				// whole sphere movement clearly on one side of the polygon plane?
+				float maxDist = BSPNode::PLANE_THICKNESS + PACKET_REJECT_MARGIN + packet.r[k];
+				if ( (startDist[k] > maxDist && endDist[k] > maxDist) ||
+					(startDist[k] < -maxDist && endDist[k] < -maxDist) )
+					continue;
+
+				if ( tree.getPolygonDistanceSquared(poly,packet.moveCenter[k]) < packet.moveRadiusSqr[k] )
+				{
+					intersectMovingSpherePolygon( tree, poly, packet.start[k], packet.end[k], packet.delta[k], 
+						packet.r[k], &packet.t[k], &packet.cinfo[k] );
+					++s_statistics.movingSpherePolygonTests;
+				}
+			}
+		}
+	}
+}
+
+/** 
+ * Finds the first intersections of a packet of moving spheres against BSP node tree. 
+ * Visits nodes in the same order for each sphere as findMovingSphereIntersectionRecurse 
+ * so the results are identical to single sphere queries.
+ * @param tree BSP tree (BSPNodeTree or BSPBakedTree).
+ * @param root Root node of the BSP tree.
+ * @param packet Moving spheres to test. Receives intersections.
+ * @param mask Mask of active spheres in the packet.
+ * @param collisionMask Mask for which collision polygons to take into account. Pass -1 for all collision polygons.
+ */
+template <class Tree> static void findMovingSphereIntersectionPacketRecurse( const Tree& tree, typename Tree::NodeType root, 
+	BSPPacket& packet, int mask, int collisionMask )
+{
+	if ( !mask || !tree.validNode(root) )
+		return;
+
+	++s_statistics.packetNodeVisits;
+	s_statistics.packetActiveRays += countLanes( mask );
+
+	const Vector4&	plane = tree.nodePlane(root);
+	float			startDist[BSPPacket::SIZE];
+	float			endDist[BSPPacket::SIZE];
+	int				startPos	= getPlaneDistances( plane, packet.startX, packet.startY, packet.startZ, startDist ) & mask;
+	int				endPos		= getPlaneDistances( plane, packet.endX, packet.endY, packet.endZ, endDist ) & mask;
+	int				startNeg	= mask & ~startPos;
+	int				crossMask	= startPos ^ endPos;
+	bool			leaf		= tree.leaf(root);
+
+	// ++ and -- spheres continue to far side only if touching node plane
+	int farMask = crossMask;
+	int polyMask = crossMask;
+	for ( int i = 0 ; i < BSPPacket::SIZE ; ++i )
+	{
+		int bit = 1 << i;
+		float r = packet.r[i];
+		if ( startPos & endPos & bit )
+		{
+			if ( startDist[i]-r <= BSPNode::PLANE_THICKNESS || endDist[i]-r <= BSPNode::PLANE_THICKNESS )
+				farMask |= bit;
+			else if ( leaf )
+				polyMask |= bit;
+		}
+		else if ( startNeg & ~endPos & bit )
+		{
+			if ( -startDist[i]-r <= BSPNode::PLANE_THICKNESS || -endDist[i]-r <= BSPNode::PLANE_THICKNESS )
+				farMask |= bit;
+			else if ( leaf )
+				polyMask |= bit;
+		}
+	}
+	polyMask |= farMask;
+
+	findMovingSphereIntersectionPacketRecurse( tree, tree.positive(root), packet, startPos, collisionMask );
+	findMovingSphereIntersectionPacketRecurse( tree, tree.negative(root), packet, startNeg, collisionMask );
+	if ( polyMask )
+		findMovingSphereIntersectionPacketPolygon( tree, root, packet, polyMask, collisionMask );
+	findMovingSphereIntersectionPacketRecurse( tree, tree.negative(root), packet, farMask & startPos, collisionMask );
+	findMovingSphereIntersectionPacketRecurse( tree, tree.positive(root), packet, farMask & startNeg, collisionMask );
+}
+
+//-----------------------------------------------------------------------------
+
+/** Finds the first line segment intersection against BSP tree. */
+template <class Tree> static bool findLineIntersection( const Tree& tree, typename Tree::NodeType root, 
+	const Vector3& start, const Vector3& delta, int collisionMask, float* t, const BSPPolygon** cpoly )
 {
 	dev::Profile pr( "BSP line checks" );
 
@@ -480,7 +882,7 @@ bool BSPCollisionUtil::findLineIntersection( BSPNode* root, const Vector3& start
 	float u = 1.f;
 	Vector3 end = start + delta;
 	
-	findLineIntersectionRecurse( root, start, end, delta, collisionMask, &u, &poly );
+	findLineIntersectionRecurse( tree, root, start, end, delta, collisionMask, &u, &poly );
 
 	if ( t ) 
 		*t = u;
@@ -489,9 +891,9 @@ bool BSPCollisionUtil::findLineIntersection( BSPNode* root, const Vector3& start
 	return u < 1.f;
 }
 
-bool BSPCollisionUtil::findLastLineIntersection( BSPNode* root, 
-	const Vector3& start, const Vector3& delta, int collisionMask,
-	float* t, const BSPPolygon** cpoly )
+/** Finds the last line segment intersection against BSP tree. */
+template <class Tree> static bool findLastLineIntersection( const Tree& tree, typename Tree::NodeType root, 
+	const Vector3& start, const Vector3& delta, int collisionMask, float* t, const BSPPolygon** cpoly )
 {
 	dev::Profile pr( "BSP line checks" );
 
@@ -499,7 +901,7 @@ bool BSPCollisionUtil::findLastLineIntersection( BSPNode* root,
 	float u = 0.f;
 	Vector3 end = start + delta;
 	
-	findLastLineIntersectionRecurse( root, start, end, delta, collisionMask, &u, &poly );
+	findLastLineIntersectionRecurse( tree, root, start, end, delta, collisionMask, &u, &poly );
 
 	if ( t ) 
 		*t = u;
@@ -508,8 +910,9 @@ bool BSPCollisionUtil::findLastLineIntersection( BSPNode* root,
 	return u > 0.f;
 }
 
-bool BSPCollisionUtil::findMovingSphereIntersection( BSPNode* root, const Vector3& start, 
-	const Vector3& delta, float r, int collisionMask,
+/** Finds the first moving sphere intersection against BSP tree. */
+template <class Tree> static bool findMovingSphereIntersection( const Tree& tree, typename Tree::NodeType root, 
+	const Vector3& start, const Vector3& delta, float r, int collisionMask,
 	float* t, const BSPPolygon** cpoly, Vector3* cnormal, Vector3* cpoint )
 {
 	dev::Profile pr( "BSP sphere checks" );
@@ -518,7 +921,7 @@ bool BSPCollisionUtil::findMovingSphereIntersection( BSPNode* root, const Vector
 	Vector3 end = start + delta;
 	BSPCollisionInfo cinfo;
 	
-	findMovingSphereIntersectionRecurse( root, start, end, delta, r, collisionMask, &u, &cinfo );
+	findMovingSphereIntersectionRecurse( tree, root, start, end, delta, r, collisionMask, &u, &cinfo );
 
 	if ( t )
 		*t = u;
@@ -531,6 +934,155 @@ bool BSPCollisionUtil::findMovingSphereIntersection( BSPNode* root, const Vector
 	return u < 1.f;
 }
 
+/** Finds the first line segment intersections against BSP tree in packets. */
+template <class Tree> static int findLineIntersections( const Tree& tree, typename Tree::NodeType root, 
+	const Vector3* starts, const Vector3* deltas, int count, int collisionMask, 
+	float* t, const BSPPolygon** cpoly, Vector3* cnormal )
+{
+	dev::Profile pr( "BSP line packets" );
+
+	int hits = 0;
+	for ( int first = 0 ; first < count ; first += BSPPacket::SIZE )
+	{
+		int n = count - first;
+		if ( n > BSPPacket::SIZE )
+			n = BSPPacket::SIZE;
+
+		BSPPacket packet;
+		for ( int i = 0 ; i < BSPPacket::SIZE ; ++i )
+		{
+			int k = first + (i < n ? i : 0);
+			packet.set( i, starts[k], deltas[k], 0.f );
+		}
+		++s_statistics.packets;
+
+		findLineIntersectionPacketRecurse( tree, root, packet, (1<<n)-1, collisionMask );
+
+		for ( int i = 0 ; i < n ; ++i )
+		{
+			const BSPPolygon* poly = packet.cinfo[i].cpoly;
+			if ( t )
+				t[first+i] = packet.t[i];
+			if ( cpoly )
+				cpoly[first+i] = poly;
+			if ( cnormal )
+				cnormal[first+i] = poly ? Vector3(poly->plane().x, poly->plane().y, poly->plane().z) : Vector3(0,0,0);
+			if ( packet.t[i] < 1.f )
+				++hits;
+		}
+	}
+	return hits;
+}
+
+/** Finds the first moving sphere intersections against BSP tree in packets. */
+template <class Tree> static int findMovingSphereIntersections( const Tree& tree, typename Tree::NodeType root, 
+	const Vector3* starts, const Vector3* deltas, const float* r, int count, int collisionMask, 
+	float* t, const BSPPolygon** cpoly, Vector3* cnormal )
+{
+	dev::Profile pr( "BSP sphere packets" );
+
+	int hits = 0;
+	for ( int first = 0 ; first < count ; first += BSPPacket::SIZE )
+	{
+		int n = count - first;
+		if ( n > BSPPacket::SIZE )
+			n = BSPPacket::SIZE;
+
+		BSPPacket packet;
+		for ( int i = 0 ; i < BSPPacket::SIZE ; ++i )
+		{
+			int k = first + (i < n ? i : 0);
+			packet.set( i, starts[k], deltas[k], r[k] );
+		}
+		++s_statistics.packets;
+
+		findMovingSphereIntersectionPacketRecurse( tree, root, packet, (1<<n)-1, collisionMask );
+
+		for ( int i = 0 ; i < n ; ++i )
+		{
+			if ( t )
+				t[first+i] = packet.t[i];
+			if ( cpoly )
+				cpoly[first+i] = packet.cinfo[i].cpoly;
+			if ( cnormal )
+				cnormal[first+i] = packet.cinfo[i].cnormal;
+			if ( packet.t[i] < 1.f )
+				++hits;
+		}
+	}
+	return hits;
+}
+
+//-----------------------------------------------------------------------------
+
+bool BSPCollisionUtil::findLineIntersection( BSPNode* root, const Vector3& start, 
+	const Vector3& delta, int collisionMask, float* t, const BSPPolygon** cpoly )
+{
+	return bsp::findLineIntersection( BSPNodeTree(), root, start, delta, collisionMask, t, cpoly );
+}
+
+bool BSPCollisionUtil::findLineIntersection( const BSPBakedTree* tree, const Vector3& start, 
+	const Vector3& delta, int collisionMask, float* t, const BSPPolygon** cpoly )
+{
+	return bsp::findLineIntersection( *tree, tree->root(), start, delta, collisionMask, t, cpoly );
+}
+
+bool BSPCollisionUtil::findLastLineIntersection( BSPNode* root, 
+	const Vector3& start, const Vector3& delta, int collisionMask,
+	float* t, const BSPPolygon** cpoly )
+{
+	return bsp::findLastLineIntersection( BSPNodeTree(), root, start, delta, collisionMask, t, cpoly );
+}
+
+bool BSPCollisionUtil::findLastLineIntersection( const BSPBakedTree* tree, 
+	const Vector3& start, const Vector3& delta, int collisionMask,
+	float* t, const BSPPolygon** cpoly )
+{
+	return bsp::findLastLineIntersection( *tree, tree->root(), start, delta, collisionMask, t, cpoly );
+}
+
+bool BSPCollisionUtil::findMovingSphereIntersection( BSPNode* root, const Vector3& start, 
+	const Vector3& delta, float r, int collisionMask,
+	float* t, const BSPPolygon** cpoly, Vector3* cnormal, Vector3* cpoint )
+{
+	return bsp::findMovingSphereIntersection( BSPNodeTree(), root, start, delta, r, collisionMask, t, cpoly, cnormal, cpoint );
+}
+
+bool BSPCollisionUtil::findMovingSphereIntersection( const BSPBakedTree* tree, const Vector3& start, 
+	const Vector3& delta, float r, int collisionMask,
+	float* t, const BSPPolygon** cpoly, Vector3* cnormal, Vector3* cpoint )
+{
+	return bsp::findMovingSphereIntersection( *tree, tree->root(), start, delta, r, collisionMask, t, cpoly, cnormal, cpoint );
+}
+
+int BSPCollisionUtil::findLineIntersections( BSPNode* root, const Vector3* starts, 
+	const Vector3* deltas, int count, int collisionMask, 
+	float* t, const BSPPolygon** cpoly, Vector3* cnormal )
+{
+	return bsp::findLineIntersections( BSPNodeTree(), root, starts, deltas, count, collisionMask, t, cpoly, cnormal );
+}
+
+int BSPCollisionUtil::findLineIntersections( const BSPBakedTree* tree, const Vector3* starts, 
+	const Vector3* deltas, int count, int collisionMask, 
+	float* t, const BSPPolygon** cpoly, Vector3* cnormal )
+{
+	return bsp::findLineIntersections( *tree, tree->root(), starts, deltas, count, collisionMask, t, cpoly, cnormal );
+}
+
+int BSPCollisionUtil::findMovingSphereIntersections( BSPNode* root, const Vector3* starts, 
+	const Vector3* deltas, const float* r, int count, int collisionMask, 
+	float* t, const BSPPolygon** cpoly, Vector3* cnormal )
+{
+	return bsp::findMovingSphereIntersections( BSPNodeTree(), root, starts, deltas, r, count, collisionMask, t, cpoly, cnormal );
+}
+
+int BSPCollisionUtil::findMovingSphereIntersections( const BSPBakedTree* tree, const Vector3* starts, 
+	const Vector3* deltas, const float* r, int count, int collisionMask, 
+	float* t, const BSPPolygon** cpoly, Vector3* cnormal )
+{
+	return bsp::findMovingSphereIntersections( *tree, tree->root(), starts, deltas, r, count, collisionMask, t, cpoly, cnormal );
+}
+
 BSPCollisionUtil::Statistics&	BSPCollisionUtil::statistics()
 {
 	return s_statistics;
@@ -547,6 +1099,16 @@ void BSPCollisionUtil::Statistics::clear()
 {
 	linePolygonTests			= 0;
 	movingSpherePolygonTests	= 0;
+	packets						= 0;
+	packetNodeVisits			= 0;
+	packetActiveRays			= 0;
+}
+
+float BSPCollisionUtil::Statistics::packetEfficiency() const
+{
+	if ( packetNodeVisits == 0 )
+		return 1.f;
+	return (float)packetActiveRays / (float)(packetNodeVisits*BSPPacket::SIZE);
 }
 
 
@@ -12,6 +12,7 @@ namespace bsp
 
 class BSPNode;
 class BSPPolygon;
+class BSPBakedTree;
 
 
 /** 
@@ -29,12 +30,24 @@ public:
 		int		linePolygonTests;
 		/** Number of moving sphere-polygon intersection tests. */
 		int		movingSpherePolygonTests;
+		/** Number of ray or sphere packets traced. */
+		int		packets;
+		/** Number of BSP nodes visited by packets. */
+		int		packetNodeVisits;
+		/** Sum of active rays in the packets over all packet node visits. */
+		int		packetActiveRays;
 
 		/** Resets statistics. */
 		Statistics();
 
 		/** Resets statistics. */
 		void	clear();
+
+		/** 
+		 * Returns average fraction [0,1] of packet rays active per visited node.
+		 * Low efficiency means that the rays in the packets are not coherent.
+		 */
+		float	packetEfficiency() const;
 	};
 
 	/** 
@@ -51,6 +64,11 @@ public:
 					const math::Vector3& delta, int collisionMask,
 					float* t, const BSPPolygon** cpoly=0 );
 
+	/** Finds the first line segment intersection against baked BSP tree. See above. */
+	static bool	findLineIntersection( const BSPBakedTree* tree, const math::Vector3& start, 
+					const math::Vector3& delta, int collisionMask,
+					float* t, const BSPPolygon** cpoly=0 );
+
 	/** 
 	 * Finds the last line segment intersection against BSP tree.
 	 * @param root The root node of the BSP tree.
@@ -65,6 +83,11 @@ public:
 					const math::Vector3& delta, int collisionMask,
 					float* t, const BSPPolygon** cpoly=0 );
 
+	/** Finds the last line segment intersection against baked BSP tree. See above. */
+	static bool	findLastLineIntersection( const BSPBakedTree* tree, const math::Vector3& start, 
+					const math::Vector3& delta, int collisionMask,
+					float* t, const BSPPolygon** cpoly=0 );
+
 	/**
 	 * Finds the first moving sphere intersection against BSP tree.
 	 * @param root The root node of the BSP tree.
@@ -82,6 +105,60 @@ public:
 					const math::Vector3& delta, float r, int collisionMask,
 					float* t, const BSPPolygon** cpoly=0, math::Vector3* cnormal=0, math::Vector3* cpoint=0 );
 
+	/** Finds the first moving sphere intersection against baked BSP tree. See above. */
+	static bool	findMovingSphereIntersection( const BSPBakedTree* tree, const math::Vector3& start, 
+					const math::Vector3& delta, float r, int collisionMask,
+					float* t, const BSPPolygon** cpoly=0, math::Vector3* cnormal=0, math::Vector3* cpoint=0 );
+
+	/**
+	 * Finds the first line segment intersections against BSP tree.
+	 * Segments are traced in packets of four, so consecutive segments 
+	 * should be coherent (e.g. start from the same point to similar directions).
+	 * Results are identical to separate findLineIntersection queries.
+	 * @param root The root node of the BSP tree.
+	 * @param starts Line segment start positions.
+	 * @param deltas Distance vectors to the end positions.
+	 * @param count Number of line segments.
+	 * @param collisionMask Mask for which collision polygons to take into account. Pass -1 for all collision polygons.
+	 * @param t [out] Receives relative length [0,1] to intersection or 1 if none, for each segment.
+	 * @param cpoly [out] Receives pointer to the collision polygon or 0 if none, for each segment.
+	 * @param cnormal [out] Receives collision plane normal or zero vector if none, for each segment.
+	 * @return Number of line segments which intersect some BSP tree polygon.
+	 */
+	static int	findLineIntersections( BSPNode* root, const math::Vector3* starts, 
+					const math::Vector3* deltas, int count, int collisionMask,
+					float* t, const BSPPolygon** cpoly=0, math::Vector3* cnormal=0 );
+
+	/** Finds the first line segment intersections against baked BSP tree. See above. */
+	static int	findLineIntersections( const BSPBakedTree* tree, const math::Vector3* starts, 
+					const math::Vector3* deltas, int count, int collisionMask,
+					float* t, const BSPPolygon** cpoly=0, math::Vector3* cnormal=0 );
+
+	/**
+	 * Finds the first moving sphere intersections against BSP tree.
+	 * Spheres are traced in packets of four, so consecutive spheres 
+	 * should move close to each other.
+	 * Results are identical to separate findMovingSphereIntersection queries.
+	 * @param root The root node of the BSP tree.
+	 * @param starts Sphere start positions.
+	 * @param deltas Distance vectors to the end positions.
+	 * @param r Radius of each sphere.
+	 * @param count Number of spheres.
+	 * @param collisionMask Mask for which collision polygons to take into account. Pass -1 for all collision polygons.
+	 * @param t [out] Receives relative length [0,1] to intersection or 1 if none, for each sphere.
+	 * @param cpoly [out] Receives pointer to the collision polygon or 0 if none, for each sphere.
+	 * @param cnormal [out] Receives collision plane normal if any, for each sphere.
+	 * @return Number of spheres which intersect some BSP tree polygon.
+	 */
+	static int	findMovingSphereIntersections( BSPNode* root, const math::Vector3* starts, 
+					const math::Vector3* deltas, const float* r, int count, int collisionMask,
+					float* t, const BSPPolygon** cpoly=0, math::Vector3* cnormal=0 );
+
+	/** Finds the first moving sphere intersections against baked BSP tree. See above. */
+	static int	findMovingSphereIntersections( const BSPBakedTree* tree, const math::Vector3* starts, 
+					const math::Vector3* deltas, const float* r, int count, int collisionMask,
+					float* t, const BSPPolygon** cpoly=0, math::Vector3* cnormal=0 );
+
 	/** Returns collision checking statistics. */
 	static Statistics&	statistics();
 };
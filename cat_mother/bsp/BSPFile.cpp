@@ -91,12 +91,8 @@ void BSPFile::read( io::InputStream* in )
 		
 		int nvertices = input.readInt();
 		m_tree->vertexData.setSize( nvertices );
-		for ( int i = 0 ; i < nvertices ; ++i )
-		{
-			float v[3];
-			input.readFloatArray( v, 3 );
-			m_tree->vertexData[i] = Vector3(v[0],v[1],v[2]);
-		}
+		if ( nvertices > 0 )
+			input.readFloatArray( &m_tree->vertexData[0].x, nvertices*3 );
 
 		input.endChunk( end );
 	}
@@ -180,10 +176,7 @@ BSPNode* BSPFile::readNode( ChunkInputStream* in )
 
 	Vector4 plane = Vector4(0,0,0,1);
 
-	plane.x = in->readFloat();
-	plane.y = in->readFloat();
-	plane.z = in->readFloat();
-	plane.w = in->readFloat();
+	in->readFloatArray( &plane.x, 4 );
 
 	BSPNode* pos = 0;
 	BSPNode* neg = 0;
@@ -62,6 +62,12 @@ public:
 	/** Returns bounding sphere radius squared. */
 	float					boundSphereRadiusSquared() const						{return m_boundSphereRadiusSqr;}
 
+	/** Returns bounding sphere center. */
+	math::Vector3			boundSphereCenter() const								{return math::Vector3(m_boundSphereCenter[0],m_boundSphereCenter[1],m_boundSphereCenter[2]);}
+
+	/** Returns plane of the edge from vertex i-1 to vertex i. Edge plane normals point outside of the polygon. */
+	const math::Vector4&	getEdgePlane( int i ) const								{return m_storage->edgePlaneData.get( m_firstEdgePlane+i );}
+
 	/** Returns shared polygon data storage. */
 	BSPStorage*				storage() const											{return m_storage;}
 
@@ -9,16 +9,31 @@
 #include <lang/Math.h>
 #include <lang/Debug.h>
 #include <lang/System.h>
+#include <lang/Thread.h>
 #include <util/Vector.h>
 #include <math/Vector3.h>
 #include <assert.h>
 #include <stdlib.h>
+
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
 #include "config.h"
 
 //-----------------------------------------------------------------------------
 
 #define MAX_ZERO_VERTEX_DISTANCE 1e-5f
 
+/** Size of vertex welding grid cell. */
+#define WELD_GRID_CELL_SIZE 0.25f
+
+/** Default minimum number of polygons in a subtree built as separate task. */
+#define DEFAULT_MIN_TASK_POLYGONS 500
+
 //-----------------------------------------------------------------------------
 
 using namespace lang;
@@ -31,13 +46,101 @@ namespace bsp
 {
 
 
+/** Returns number of processors in the system. */
+static int processorCount()
+{
+#ifdef WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	int n = (int)info.dwNumberOfProcessors;
+#else
+	int n = (int)sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+	return n > 0 ? n : 1;
+}
+
+//-----------------------------------------------------------------------------
+
+/** 
+ * Node of BSP tree under construction. 
+ * Subtrees are built in parallel so final BSPNodes are
+ * created only after the whole tree has been built,
+ * in the same order as in serial build.
+ */
+class BSPBuildNode
+{
+public:
+	Vector4				plane;
+	Vector<BSPPolygon*>	polys;
+	BSPBuildNode*		pos;
+	BSPBuildNode*		neg;
+
+	BSPBuildNode() :
+		plane(0,0,0,0),
+		polys( Allocator<BSPPolygon*>(__FILE__,__LINE__) ),
+		pos(0),
+		neg(0)
+	{
+	}
+
+private:
+	BSPBuildNode( const BSPBuildNode& );
+	BSPBuildNode& operator=( const BSPBuildNode& );
+};
+
+/** Subtree waiting to be built. */
+class BSPBuildTask
+{
+public:
+	BSPBuildNode*		node;
+	Vector<BSPPolygon*>	polys;
+
+	BSPBuildTask( BSPBuildNode* node0, const Vector<BSPPolygon*>& polys0 ) :
+		node(node0),
+		polys(polys0)
+	{
+	}
+
+private:
+	BSPBuildTask( const BSPBuildTask& );
+	BSPBuildTask& operator=( const BSPBuildTask& );
+};
+
+/** 
+ * Task queue of a build thread. 
+ * Owner thread adds and removes tasks at the end,
+ * other threads steal from the beginning (larger subtrees).
+ */
+class BSPBuildQueue :
+	public Object
+{
+public:
+	Vector<BSPBuildTask*>	tasks;
+
+	BSPBuildQueue() :
+		Object( OBJECT_INITMUTEX ),
+		tasks( Allocator<BSPBuildTask*>(__FILE__,__LINE__) )
+	{
+	}
+};
+
+//-----------------------------------------------------------------------------
+
 class BSPTreeBuilder::BSPTreeBuilderImpl :
 	public Object, public ProgressIndicator
 {
 public:
 	BSPTreeBuilderImpl() :
 		m_progressMutex( Object::OBJECT_INITMUTEX ),
-		m_tempIndexBuffer( Allocator<int>(__FILE__) )
+		m_tempIndexBuffer( Allocator<int>(__FILE__) ),
+		m_weldBuckets( Allocator<int>(__FILE__) ),
+		m_weldNext( Allocator<int>(__FILE__) ),
+		m_threads( 0 ),
+		m_minTaskPolygons( DEFAULT_MIN_TASK_POLYGONS ),
+		m_queues( Allocator<P(BSPBuildQueue)>(__FILE__) ),
+		m_taskMutex( Object::OBJECT_INITMUTEX ),
+		m_pendingTasks( 0 ),
+		m_splitSel( 0 )
 	{
 		reset();
 	}
@@ -54,6 +157,9 @@ public:
 		m_lastPrintedProgress	= 0.f;
 		m_workDone				= 0;
 		m_workTotal				= 0;
+
+		m_weldBuckets.clear();
+		m_weldNext.clear();
 	}
 
 	void addPolygon( const Vector3* v, int n, int id, int collisionMask )
@@ -65,27 +171,15 @@ public:
 		m_tempIndexBuffer.setSize( 0 );
 		for ( int i = 0 ; i < n ; ++i )
 		{
-			const Vector3* vert = m_tree->vertexData.begin();
-			int vertc = m_tree->vertexData.size();
-			for ( int k = 0 ; k < vertc ; ++k )
+			int k = findVertex( v[i] );
+			if ( k < 0 )
 			{
-				float dsqr = ( vert[k] - v[i]  ).lengthSquared();
-				if ( dsqr < Float::MIN_VALUE )
-				{
-					// found old identical vertex position
-					m_tempIndexBuffer.add( k );
-					vert = 0;
-					break;
-				}
-			}
-
-			// add new vertex?
-			assert( m_tempIndexBuffer.size() >= i );
-			if ( m_tempIndexBuffer.size() == i )
-			{
-				m_tempIndexBuffer.add( m_tree->vertexData.size() );
+				// add new vertex
+				k = m_tree->vertexData.size();
 				m_tree->vertexData.add( v[i] );
+				addWeldVertex( k );
 			}
+			m_tempIndexBuffer.add( k );
 		}
 
 		BSPPolygon* poly = m_tree->createPolygon();
@@ -108,7 +202,13 @@ public:
 
 		// build tree
 		long time = System::currentTimeMillis();
-		BSPNode* root = buildTree( m_polygons, splitSel );
+		BSPBuildNode* buildRoot = 0;
+		if ( m_polygons->size() > 0 )
+		{
+			buildRoot = new BSPBuildNode;
+			buildParallel( buildRoot, splitSel );
+		}
+		BSPNode* root = createNodes( buildRoot );
 		if ( !root )
 		{
 			Vector<BSPPolygon*> polys( Allocator<BSPPolygon*>(__FILE__) );
@@ -142,22 +242,92 @@ public:
 		return m_progress;
 	}
 
+	void setThreads( int count )
+	{
+		assert( count >= 0 );
+		m_threads = count;
+	}
+
+	int threads() const
+	{
+		return m_threads > 0 ? m_threads : processorCount();
+	}
+
+	void setMinTaskPolygons( int polygons )
+	{
+		m_minTaskPolygons = polygons > 1 ? polygons : 1;
+	}
+
+	/** Executes build tasks until the whole tree has been built. */
+	void work( int queue )
+	{
+		for (;;)
+		{
+			BSPBuildTask* task = popTask( queue );
+			if ( task )
+			{
+				buildTree( task->node, task->polys, queue );
+				delete task;
+				finishTask();
+			}
+			else if ( pendingTasks() == 0 )
+			{
+				break;
+			}
+			else
+			{
+				Thread::sleep( 1 );
+			}
+		}
+	}
+
 private:
+	/** Build thread which executes tasks from its own queue or steals from others. */
+	class BuildThread :
+		public Thread
+	{
+	public:
+		BuildThread( BSPTreeBuilderImpl* impl, int queue ) :
+			m_impl(impl), m_queue(queue)
+		{
+		}
+
+		void run()
+		{
+			m_impl->work( m_queue );
+		}
+
+	private:
+		BSPTreeBuilderImpl*		m_impl;
+		int						m_queue;
+
+		BuildThread( const BuildThread& );
+		BuildThread& operator=( const BuildThread& );
+	};
+
 	void addProgress( double work )
 	{
 		assert( m_workTotal > 0 );
 
+		// called by split selectors from all build threads
+		synchronized( m_progressMutex );
 		m_workDone += work;
 		if ( m_workDone > m_workTotal )
 			m_workDone = m_workTotal;
-		setProgress( (float)(m_workDone/m_workTotal) );
+		m_progress = (float)(m_workDone/m_workTotal);
+		printProgress();
 	}
 
 	void setProgress( float progress )
 	{
 		synchronized( m_progressMutex );
 		m_progress = progress;
-		
+		printProgress();
+	}
+
+	/** Prints progress if changed enough. Progress mutex must be locked. */
+	void printProgress()
+	{
 		// DEBUG: print progress
 		if ( m_progress-m_lastPrintedProgress > 0.01f )
 		{
@@ -166,45 +336,237 @@ private:
 		}
 	}
 
+	/** 
+	 * Builds the tree from all polygons to specified root. 
+	 * Uses calling thread and threads()-1 build threads.
+	 */
+	void buildParallel( BSPBuildNode* root, BSPSplitSelector* splitSel )
+	{
+		int threads = this->threads();
+		m_splitSel = splitSel;
+		m_queues.clear();
+		for ( int i = 0 ; i < threads ; ++i )
+			m_queues.add( new BSPBuildQueue );
+
+		// root subtree is built by the calling thread
+		m_pendingTasks = 1;
+		Vector< P(BuildThread) > workers( Allocator< P(BuildThread) >(__FILE__,__LINE__) );
+		for ( int i = 1 ; i < threads ; ++i )
+		{
+			P(BuildThread) worker = new BuildThread( this, i );
+			try
+			{
+				worker->start();
+			}
+			catch ( ... )
+			{
+				// tasks of the queue are stolen by the other threads
+				break;
+			}
+			workers.add( worker );
+		}
+
+		buildTree( root, *m_polygons, 0 );
+		finishTask();
+		work( 0 );
+
+		for ( int i = 0 ; i < workers.size() ; ++i )
+			workers[i]->join();
+		m_queues.clear();
+		m_splitSel = 0;
+	}
+
 	/**
 	 * Builds BSP tree recursively.
+	 * Large enough positive subtrees are built as separate tasks.
+	 * @param node [out] Receives the root node of the (sub)tree.
 	 * @param polys Polygons in this space.
-	 * @param scoreFunc Score function to rank split planes.
-	 * @return Root node.
+	 * @param queue Task queue of the calling thread.
 	 */
-	BSPNode* buildTree( const Vector<BSPPolygon*>* polys, BSPSplitSelector* splitSel )
+	void buildTree( BSPBuildNode* node, const Vector<BSPPolygon*>& polys, int queue )
 	{
-		if ( 0 == polys->size() )
-			return 0;
+		assert( polys.size() > 0 );
 
 		Vector4 splitPlane(0,0,0,0);
-		if ( polys->size() > 1 && splitSel->getSplitPlane( *polys, this, &splitPlane ) )
+		if ( polys.size() > 1 && m_splitSel->getSplitPlane( polys, this, &splitPlane ) )
 		{
 			Vector<BSPPolygon*> neg( Allocator<BSPPolygon*>(__FILE__,__LINE__) );
-			Vector<BSPPolygon*> on( Allocator<BSPPolygon*>(__FILE__,__LINE__) );
 			Vector<BSPPolygon*> pos( Allocator<BSPPolygon*>(__FILE__,__LINE__) );
 
-			if ( partitionPolygons( polys, splitPlane, &neg, &on, &pos ) )
+			if ( partitionPolygons( &polys, splitPlane, &neg, &node->polys, &pos ) )
 			{
-				BSPNode* posNode = buildTree( &pos, splitSel );
-				pos.clear(); pos.trimToSize();
+				node->plane = splitPlane;
 
-				BSPNode* negNode = buildTree( &neg, splitSel );
-				neg.clear(); neg.trimToSize();
+				if ( pos.size() > 0 )
+				{
+					node->pos = new BSPBuildNode;
+					if ( pos.size() >= m_minTaskPolygons && m_queues.size() > 1 )
+						pushTask( queue, new BSPBuildTask(node->pos,pos) );
+					else
+						buildTree( node->pos, pos, queue );
+					pos.clear(); pos.trimToSize();
+				}
 
-				return m_tree->createNode( splitPlane, on, posNode, negNode );
+				if ( neg.size() > 0 )
+				{
+					node->neg = new BSPBuildNode;
+					buildTree( node->neg, neg, queue );
+					neg.clear(); neg.trimToSize();
+				}
+				return;
 			}
-			else
+		}
+
+		node->plane = splitPlane;
+		node->polys = polys;
+	}
+
+	/** 
+	 * Creates BSP nodes for the built tree and deletes the build nodes. 
+	 * Nodes are created in the same order as by serial recursive build.
+	 */
+	BSPNode* createNodes( BSPBuildNode* node )
+	{
+		if ( !node )
+			return 0;
+
+		BSPNode* posNode = createNodes( node->pos );
+		BSPNode* negNode = createNodes( node->neg );
+		BSPNode* result = m_tree->createNode( node->plane, node->polys, posNode, negNode );
+		delete node;
+		return result;
+	}
+
+	void pushTask( int queue, BSPBuildTask* task )
+	{
+		{synchronized( m_taskMutex );
+		++m_pendingTasks;}
+
+		BSPBuildQueue* q = m_queues[queue];
+		synchronized( q );
+		q->tasks.add( task );
+	}
+
+	/** Returns last task of own queue or steals first task from other queue. */
+	BSPBuildTask* popTask( int queue )
+	{
+		{BSPBuildQueue* q = m_queues[queue];
+		synchronized( q );
+		if ( q->tasks.size() > 0 )
+		{
+			BSPBuildTask* task = q->tasks.lastElement();
+			q->tasks.setSize( q->tasks.size()-1 );
+			return task;
+		}}
+
+		for ( int i = 1 ; i < m_queues.size() ; ++i )
+		{
+			BSPBuildQueue* q = m_queues[ (queue+i) % m_queues.size() ];
+			synchronized( q );
+			if ( q->tasks.size() > 0 )
 			{
-				return m_tree->createNode( splitPlane, *polys, 0, 0 );
+				BSPBuildTask* task = q->tasks.firstElement();
+				q->tasks.remove( 0 );
+				return task;
 			}
 		}
+		return 0;
+	}
+
+	void finishTask()
+	{
+		synchronized( m_taskMutex );
+		--m_pendingTasks;
+	}
+
+	int pendingTasks() const
+	{
+		synchronized( m_taskMutex );
+		return m_pendingTasks;
+	}
+
+	/** Returns vertex welding grid cell of a coordinate. */
+	static int getWeldCell( float x )
+	{
+		return (int)Math::floor( x * (1.f/WELD_GRID_CELL_SIZE) );
+	}
+
+	/** Returns vertex welding hash bucket of a grid cell. */
+	int getWeldBucket( int x, int y, int z ) const
+	{
+		unsigned h = (unsigned)x*73856093u ^ (unsigned)y*19349663u ^ (unsigned)z*83492791u;
+		return (int)( h & (unsigned)(m_weldBuckets.size()-1) );
+	}
+
+	/** 
+	 * Returns index of the first identical vertex or -1 if none. 
+	 * Vertices are hashed by grid cells so only neighbourhood needs to be checked.
+	 */
+	int findVertex( const Vector3& v ) const
+	{
+		if ( m_weldBuckets.size() == 0 )
+			return -1;
+
+		const Vector3* vert = m_tree->vertexData.begin();
+		const int x0 = getWeldCell( v.x-MAX_ZERO_VERTEX_DISTANCE );
+		const int x1 = getWeldCell( v.x+MAX_ZERO_VERTEX_DISTANCE );
+		const int y0 = getWeldCell( v.y-MAX_ZERO_VERTEX_DISTANCE );
+		const int y1 = getWeldCell( v.y+MAX_ZERO_VERTEX_DISTANCE );
+		const int z0 = getWeldCell( v.z-MAX_ZERO_VERTEX_DISTANCE );
+		const int z1 = getWeldCell( v.z+MAX_ZERO_VERTEX_DISTANCE );
+		int found = -1;
+
+		for ( int x = x0 ; x <= x1 ; ++x )
+		{
+			for ( int y = y0 ; y <= y1 ; ++y )
+			{
+				for ( int z = z0 ; z <= z1 ; ++z )
+				{
+					for ( int k = m_weldBuckets[getWeldBucket(x,y,z)] ; k >= 0 ; k = m_weldNext[k] )
+					{
+						float dsqr = ( vert[k] - v  ).lengthSquared();
+						if ( dsqr < Float::MIN_VALUE && (found < 0 || k < found) )
+							found = k;
+					}
+				}
+			}
+		}
+		return found;
+	}
+
+	/** Adds vertex to welding hash. */
+	void addWeldVertex( int index )
+	{
+		assert( index == m_weldNext.size() );
+		m_weldNext.add( -1 );
+
+		if ( m_weldBuckets.size() < m_weldNext.size()*2 )
+		{
+			// rehash
+			int buckets = m_weldBuckets.size() > 0 ? m_weldBuckets.size()*2 : 1024;
+			while ( buckets < m_weldNext.size()*2 )
+				buckets *= 2;
+			m_weldBuckets.setSize( buckets );
+			for ( int i = 0 ; i < buckets ; ++i )
+				m_weldBuckets[i] = -1;
+			for ( int i = 0 ; i < m_weldNext.size() ; ++i )
+				linkWeldVertex( i );
+		}
 		else
 		{
-			return m_tree->createNode( splitPlane, *polys, 0, 0 );
+			linkWeldVertex( index );
 		}
 	}
 
+	/** Links vertex to hash bucket of its grid cell. */
+	void linkWeldVertex( int index )
+	{
+		const Vector3& v = m_tree->vertexData[index];
+		int bucket = getWeldBucket( getWeldCell(v.x), getWeldCell(v.y), getWeldCell(v.z) );
+		m_weldNext[index] = m_weldBuckets[bucket];
+		m_weldBuckets[bucket] = index;
+	}
+
 	/** 
 	 * Partitions polygons by a plane. 
 	 * @param polys List of all polygons.
@@ -292,12 +654,21 @@ private:
 	P(Vector<BSPPolygon*>)	m_polygons;
 	P(BSPTree)				m_tree;
 	Vector<int>				m_tempIndexBuffer;	// see addPolygon
+	Vector<int>				m_weldBuckets;		// first vertex of each hash bucket or -1
+	Vector<int>				m_weldNext;			// next vertex of the same hash bucket or -1
 
 	Object					m_progressMutex;
 	float					m_progress;
 	float					m_lastPrintedProgress;
 	double					m_workDone;
 	double					m_workTotal;
+
+	int						m_threads;
+	int						m_minTaskPolygons;
+	Vector<P(BSPBuildQueue)> m_queues;
+	Object					m_taskMutex;
+	int						m_pendingTasks;
+	BSPSplitSelector*		m_splitSel;
 };
 
 //-----------------------------------------------------------------------------
@@ -331,6 +702,21 @@ float BSPTreeBuilder::progress() const
 	return m_this->progress();
 }
 
+void BSPTreeBuilder::setThreads( int count )
+{
+	m_this->setThreads( count );
+}
+
+int BSPTreeBuilder::threads() const
+{
+	return m_this->threads();
+}
+
+void BSPTreeBuilder::setMinTaskPolygons( int polygons )
+{
+	m_this->setMinTaskPolygons( polygons );
+}
+
 void BSPTreeBuilder::removePolygons()
 {
 	m_this->reset();
@@ -52,9 +52,25 @@ public:
 	/** 
 	 * Builds the BSP tree from added source polygons. 
 	 * Uses specified split plane selector.
+	 * Subtrees are built in parallel, see setThreads().
 	 */
 	BSPTree*	build( BSPSplitSelector* splitSel );
 
+	/**
+	 * Sets number of threads used to build the tree.
+	 * 1 builds the tree serially on the calling thread.
+	 * 0 (default) uses one thread per processor.
+	 * Resulting tree is identical regardless of the number of threads.
+	 */
+	void		setThreads( int count );
+
+	/**
+	 * Sets minimum number of polygons in a subtree 
+	 * for it to be built as a separate task by any thread.
+	 * Smaller subtrees are built by the thread which split their parent.
+	 */
+	void		setMinTaskPolygons( int polygons );
+
 	/**
 	 * Returns relative amount of build work done.
 	 * This method is synchronized so that you can have another thread
@@ -66,6 +82,9 @@ public:
 	/** Returns number of source polygons in the BSP tree. */
 	int			polygons() const;
 
+	/** Returns number of threads used to build the tree. */
+	int			threads() const;
+
 private:
 	class BSPTreeBuilderImpl;
 	P(BSPTreeBuilderImpl)	m_this;
@@ -85,6 +85,10 @@ LIB32=link.exe -lib
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=.\BSPBakedTree.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\BSPBalanceSplitSelector.cpp
 # End Source File
 # Begin Source File
@@ -137,6 +141,10 @@ SOURCE=.\BSPTreeBuilder.cpp
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=.\BSPBakedTree.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\BSPBalanceSplitSelector.h
 # End Source File
 # Begin Source File
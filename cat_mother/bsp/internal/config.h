@@ -1,3 +1,8 @@
 #ifdef _MSC_VER
 #include <config_msvc.h>
 #endif
+
+// Use SSE packet plane tests if the compiler generates SSE code
+#if !defined(BSP_NO_SSE) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define BSP_SSE
+#endif
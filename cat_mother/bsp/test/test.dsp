@@ -87,6 +87,14 @@ LINK32=link.exe
 
 SOURCE=.\test_bsp.cpp
 # End Source File
+# Begin Source File
+
+SOURCE=.\test_BSPBakedTree.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\test_BSPTreeBuilder.cpp
+# End Source File
 # End Group
 # Begin Group "Header Files"
 
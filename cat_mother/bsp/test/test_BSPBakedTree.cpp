@@ -0,0 +1,185 @@
+#include <tester/Test.h>
+#include <io/FileInputStream.h>
+#include <bsp/BSPFile.h>
+#include <bsp/BSPNode.h>
+#include <bsp/BSPTree.h>
+#include <bsp/BSPBakedTree.h>
+#include <bsp/BSPCollisionUtil.h>
+#include <lang/Math.h>
+#include <math/Vector3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef _MSC_VER
+#include <config_msvc.h>
+#endif // _MSC_VER
+
+//-----------------------------------------------------------------------------
+
+using namespace io;
+using namespace bsp;
+using namespace lang;
+using namespace math;
+
+//-----------------------------------------------------------------------------
+
+/** Returns pseudo-random value in range [minv,maxv]. */
+static float random( float minv, float maxv )
+{
+	return minv + (maxv-minv) * (float)rand() / (float)RAND_MAX;
+}
+
+/** Returns pseudo-random point inside the box. */
+static Vector3 random( const Vector3& minv, const Vector3& maxv )
+{
+	return Vector3( random(minv.x,maxv.x), random(minv.y,maxv.y), random(minv.z,maxv.z) );
+}
+
+static double milliseconds( clock_t t0, clock_t t1 )
+{
+	return (double)(t1-t0) * 1e3 / CLOCKS_PER_SEC;
+}
+
+//-----------------------------------------------------------------------------
+
+static int test()
+{
+	// BSP_BENCHMARK_FILE can be used to benchmark a real level
+	const char* fname = getenv( "BSP_BENCHMARK_FILE" );
+	if ( !fname )
+		fname = "test.bsp";
+
+	P(FileInputStream) in = new FileInputStream( fname );
+	BSPFile file( in );
+	P(BSPTree) tree = file.tree();
+	in->close();
+
+	clock_t t0 = clock();
+	P(BSPBakedTree) baked = new BSPBakedTree( tree );
+	clock_t t1 = clock();
+	printf( "%s: %i nodes, %i node polygons, baked in %g ms\n", fname, baked->nodes(), baked->polygons(), milliseconds(t0,t1) );
+	assert( baked->nodes() == tree->nodes() );
+
+	// random queries inside the (slightly enlarged) tree bounding box
+	Vector3 minv = tree->vertexData[0];
+	Vector3 maxv = minv;
+	for ( int i = 1 ; i < tree->vertexData.size() ; ++i )
+	{
+		const Vector3& v = tree->vertexData[i];
+		for ( int k = 0 ; k < 3 ; ++k )
+		{
+			minv[k] = Math::min( minv[k], v[k] );
+			maxv[k] = Math::max( maxv[k], v[k] );
+		}
+	}
+	Vector3 margin = (maxv - minv) * .1f;
+	minv -= margin;
+	maxv += margin;
+
+	const int QUERIES = 20000;
+	Vector3* starts = new Vector3[QUERIES];
+	Vector3* deltas = new Vector3[QUERIES];
+	srand( 1234 );
+	for ( int i = 0 ; i < QUERIES ; ++i )
+	{
+		starts[i] = random( minv, maxv );
+		deltas[i] = random( minv, maxv ) - starts[i];
+	}
+
+	// line queries
+	int hits = 0;
+	float* t = new float[QUERIES];
+	const BSPPolygon** cpoly = new const BSPPolygon*[QUERIES];
+	t0 = clock();
+	for ( int i = 0 ; i < QUERIES ; ++i )
+		hits += BSPCollisionUtil::findLineIntersection( tree->root(), starts[i], deltas[i], -1, &t[i], &cpoly[i] );
+	t1 = clock();
+	for ( int i = 0 ; i < QUERIES ; ++i )
+	{
+		float u;
+		const BSPPolygon* poly;
+		BSPCollisionUtil::findLineIntersection( baked, starts[i], deltas[i], -1, &u, &poly );
+		assert( u == t[i] && poly == cpoly[i] );
+	}
+	clock_t t2 = clock();
+	printf( "  %i line queries (%i hits): tree %g ms, baked %g ms\n", QUERIES, hits, milliseconds(t0,t1), milliseconds(t1,t2) );
+
+	// moving sphere queries
+	const float r = (maxv-minv).length() * .01f;
+	hits = 0;
+	t0 = clock();
+	for ( int i = 0 ; i < QUERIES ; ++i )
+		hits += BSPCollisionUtil::findMovingSphereIntersection( tree->root(), starts[i], deltas[i], r, -1, &t[i], &cpoly[i] );
+	t1 = clock();
+	for ( int i = 0 ; i < QUERIES ; ++i )
+	{
+		float u;
+		const BSPPolygon* poly;
+		BSPCollisionUtil::findMovingSphereIntersection( baked, starts[i], deltas[i], r, -1, &u, &poly );
+		assert( u == t[i] && poly == cpoly[i] );
+	}
+	t2 = clock();
+	printf( "  %i moving sphere queries (%i hits): tree %g ms, baked %g ms\n", QUERIES, hits, milliseconds(t0,t1), milliseconds(t1,t2) );
+
+	// coherent packets of four line segments and moving spheres
+	const Vector3 jitter = (maxv - minv) * .005f;
+	float* radius = new float[QUERIES];
+	for ( int i = 0 ; i < QUERIES ; i += 4 )
+	{
+		Vector3 start = random( minv, maxv );
+		Vector3 end = random( minv, maxv );
+		for ( int k = i ; k < i+4 && k < QUERIES ; ++k )
+		{
+			starts[k] = start + random( -jitter, jitter );
+			deltas[k] = end + random( -jitter, jitter ) - starts[k];
+			radius[k] = r;
+		}
+	}
+
+	float* packetT = new float[QUERIES];
+	const BSPPolygon** packetPoly = new const BSPPolygon*[QUERIES];
+	Vector3* cnormal = new Vector3[QUERIES];
+	Vector3* packetNormal = new Vector3[QUERIES];
+
+	hits = 0;
+	t0 = clock();
+	for ( int i = 0 ; i < QUERIES ; ++i )
+		hits += BSPCollisionUtil::findLineIntersection( baked, starts[i], deltas[i], -1, &t[i], &cpoly[i] );
+	t1 = clock();
+	BSPCollisionUtil::statistics().clear();
+	int packetHits = BSPCollisionUtil::findLineIntersections( baked, starts, deltas, QUERIES, -1, packetT, packetPoly, packetNormal );
+	t2 = clock();
+	assert( packetHits == hits );
+	for ( int i = 0 ; i < QUERIES ; ++i )
+		assert( packetT[i] == t[i] && packetPoly[i] == cpoly[i] );
+	printf( "  %i coherent line queries (%i hits): single %g ms, packets %g ms (%g%% efficiency)\n", QUERIES, hits, milliseconds(t0,t1), milliseconds(t1,t2), BSPCollisionUtil::statistics().packetEfficiency()*100.f );
+
+	hits = 0;
+	t0 = clock();
+	for ( int i = 0 ; i < QUERIES ; ++i )
+		hits += BSPCollisionUtil::findMovingSphereIntersection( baked, starts[i], deltas[i], radius[i], -1, &t[i], &cpoly[i], &cnormal[i] );
+	t1 = clock();
+	BSPCollisionUtil::statistics().clear();
+	packetHits = BSPCollisionUtil::findMovingSphereIntersections( baked, starts, deltas, radius, QUERIES, -1, packetT, packetPoly, packetNormal );
+	t2 = clock();
+	assert( packetHits == hits );
+	for ( int i = 0 ; i < QUERIES ; ++i )
+		assert( packetT[i] == t[i] && packetPoly[i] == cpoly[i] && packetNormal[i] == cnormal[i] );
+	printf( "  %i coherent moving sphere queries (%i hits): single %g ms, packets %g ms (%g%% efficiency)\n", QUERIES, hits, milliseconds(t0,t1), milliseconds(t1,t2), BSPCollisionUtil::statistics().packetEfficiency()*100.f );
+
+	delete[] packetNormal;
+	delete[] cnormal;
+	delete[] packetPoly;
+	delete[] packetT;
+	delete[] radius;
+	delete[] cpoly;
+	delete[] t;
+	delete[] deltas;
+	delete[] starts;
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+static tester::Test reg( test, __FILE__ );
@@ -0,0 +1,128 @@
+#include <tester/Test.h>
+#include <bsp/BSPNode.h>
+#include <bsp/BSPTree.h>
+#include <bsp/BSPPolygon.h>
+#include <bsp/BSPTreeBuilder.h>
+#include <bsp/BSPBalanceSplitSelector.h>
+#include <math/Vector3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef _MSC_VER
+#include <config_msvc.h>
+#endif // _MSC_VER
+
+//-----------------------------------------------------------------------------
+
+using namespace bsp;
+using namespace lang;
+using namespace math;
+
+//-----------------------------------------------------------------------------
+
+/** Returns pseudo-random value in range [minv,maxv]. */
+static float random( float minv, float maxv )
+{
+	return minv + (maxv-minv) * (float)rand() / (float)RAND_MAX;
+}
+
+/** Adds height field grid with shared vertices and random quads. */
+static void addPolygons( BSPTreeBuilder& builder, int grid )
+{
+	for ( int y = 0 ; y < grid ; ++y )
+	{
+		for ( int x = 0 ; x < grid ; ++x )
+		{
+			Vector3 quad[4];
+			for ( int k = 0 ; k < 4 ; ++k )
+			{
+				int vx = x + (k == 1 || k == 2);
+				int vy = y + (k >= 2);
+				quad[k] = Vector3( (float)vx, (float)((vx*7+vy*13)%5)*.3f, (float)vy );
+			}
+			builder.addPolygon( quad, 4, y*grid+x, -1 );
+		}
+	}
+
+	srand( 1234 );
+	for ( int i = 0 ; i < grid*5 ; ++i )
+	{
+		Vector3 c( random(0.f,(float)grid), random(0.f,5.f), random(0.f,(float)grid) );
+		Vector3 a( random(-2.f,2.f), random(-2.f,2.f), random(-2.f,2.f) );
+		Vector3 b( random(-2.f,2.f), random(-2.f,2.f), random(-2.f,2.f) );
+		Vector3 quad[] = { c, c+a, c+a+b, c+b };
+		builder.addPolygon( quad, 4, grid*grid+i, -1 );
+	}
+}
+
+/** Returns index of the node in the tree or -1 if none. */
+static int getNodeIndex( const BSPTree* tree, const BSPNode* node )
+{
+	for ( int i = 0 ; i < tree->nodes() ; ++i )
+	{
+		if ( tree->getNode(i) == node )
+			return i;
+	}
+	return -1;
+}
+
+/** Asserts that the trees have identical nodes, polygons and vertices. */
+static void assertIdentical( const BSPTree* a, const BSPTree* b )
+{
+	assert( a->vertexData.size() == b->vertexData.size() );
+	for ( int i = 0 ; i < a->vertexData.size() ; ++i )
+		assert( a->vertexData[i] == b->vertexData[i] );
+
+	assert( a->polygons() == b->polygons() );
+	assert( a->nodes() == b->nodes() );
+	for ( int i = 0 ; i < a->nodes() ; ++i )
+	{
+		const BSPNode* na = a->getNode(i);
+		const BSPNode* nb = b->getNode(i);
+		assert( na->plane() == nb->plane() );
+		assert( getNodeIndex(a,na->positive()) == getNodeIndex(b,nb->positive()) );
+		assert( getNodeIndex(a,na->negative()) == getNodeIndex(b,nb->negative()) );
+		assert( na->polygons() == nb->polygons() );
+		for ( int k = 0 ; k < na->polygons() ; ++k )
+			assert( a->getPolygonIndex(&na->getPolygon(k)) == b->getPolygonIndex(&nb->getPolygon(k)) );
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+static int test()
+{
+	const int GRID = 30;
+	BSPBalanceSplitSelector splitsel(0);
+
+	BSPTreeBuilder serial;
+	serial.setThreads( 1 );
+	clock_t t0 = clock();
+	addPolygons( serial, GRID );
+	clock_t t1 = clock();
+	P(BSPTree) serialTree = serial.build( &splitsel );
+	clock_t t2 = clock();
+	assert( serial.progress() == 1.f );
+	printf( "  serial: %i polygons added in %g ms, built in %g ms\n", serial.polygons(), (double)(t1-t0)*1e3/CLOCKS_PER_SEC, (double)(t2-t1)*1e3/CLOCKS_PER_SEC );
+
+	// shared grid vertices must be welded
+	assert( serialTree->vertexData.size() <= (GRID+1)*(GRID+1) + GRID*5*4 );
+
+	BSPTreeBuilder parallel;
+	parallel.setThreads( 4 );
+	parallel.setMinTaskPolygons( 16 );
+	addPolygons( parallel, GRID );
+	t0 = clock();
+	P(BSPTree) parallelTree = parallel.build( &splitsel );
+	t1 = clock();
+	assert( parallel.progress() == 1.f );
+	printf( "  %i threads: built in %g ms\n", parallel.threads(), (double)(t1-t0)*1e3/CLOCKS_PER_SEC );
+
+	assertIdentical( serialTree, parallelTree );
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+static tester::Test reg( test, __FILE__ );
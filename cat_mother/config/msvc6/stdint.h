@@ -16,5 +16,8 @@ typedef unsigned __int32	uint32_t;
 typedef unsigned __int64	uint64_t;
 typedef unsigned __int64	uint64_t;
 
+#define INT64_C(x)			x##i64
+#define UINT64_C(x)			x##ui64
+
 
 #endif // _STDINT_H
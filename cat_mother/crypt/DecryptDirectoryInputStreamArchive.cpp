@@ -26,7 +26,6 @@ class DecryptDirectoryInputStreamArchive::DecryptDirectoryInputStreamArchiveImpl
 {
 public:
 	P(DirectoryInputStreamArchive)	arch;
-	P(DecryptInputStream)			din;
 };
 
 //-----------------------------------------------------------------------------
@@ -66,8 +65,7 @@ InputStream* DecryptDirectoryInputStreamArchive::getInputStream( const String& n
 	/*try
 	{*/
 		P(InputStream) in = m_this->arch->getInputStream( name );
-		m_this->din = new DecryptInputStream( in );
-		return m_this->din;
+		return new DecryptInputStream( in );
 	/*}
 	catch ( FileNotFoundException& )
 	{
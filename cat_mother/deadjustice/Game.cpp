@@ -65,7 +65,7 @@
 #include <script/ScriptException.h>
 #include <music/MusicManager.h>
 #include <assert.h>
-#include <algorithm>
+#include <string.h>
 #include "config.h"
 
 //-----------------------------------------------------------------------------
@@ -141,6 +141,8 @@ public:
 		m_cfg->setBoolean( "Game.FlyCamera", false );
 		m_cfg->setBoolean( "Debug.ManualFrameAdvance", false );
 		dev::Profile::setEnabled( m_cfg->getBoolean("Debug.Profiling") );
+		if ( m_cfg->getBoolean("Debug.Profiling") )
+			dev::Profile::setTraceFrames( 120 );
 
 		// set controller global
 		m_vm->pushTable( m_gameCtrl );
@@ -244,6 +246,7 @@ public:
 
 	void update( float dt )
 	{
+		dev::Profile::endFrame();
 		m_fps = (dt >= Float::MIN_VALUE ? 1.f / dt : 0.f);
 
 		// notice still active?
@@ -332,8 +335,8 @@ public:
 					focusLost();
 				m_wasActiveCutScene = m_level->isActiveCutScene();
 
-				for ( int i = 0; i < m_level->characters(); ++i )
-					m_level->getCharacter(i)->update( dt, updatesInThisFrame==0 );
+				// characters: gameplay, AI, scripts and collisions, serially
+				m_level->updateCharacters( dt, updatesInThisFrame==0 );
 
 				{dev::Profile pr( "update.weapons" );
 				for ( int i = 0; i < m_level->weapons(); ++i )
@@ -374,6 +377,9 @@ public:
 			}
 		}
 
+		// character poses of the last update, in parallel
+		m_level->evaluateCharacterPoses();
+
 		if ( totalDt > Float::MIN_VALUE )
 		{
 			//Profile pr("Onscreen & Manager update"); 
@@ -1052,16 +1058,21 @@ public:
 		{
 			if ( m_timeProfiled > 1.f )
 			{
+				// scope tree with per-frame times in milliseconds
 				m_profiles.clear();
 				for ( int i = 0 ; i < Profile::count() ; ++i ) 
 				{ 
 					Profile::BlockInfo* block = Profile::get(i);
-					float time = (float)block->time() * 100.f;
-					if ( time > 1.f )
-						m_profiles.add( Format("\"{0}\" ({2,#}x) CPU usage {1,#}%", block->name(), time, block->count()/m_fps).format() );
+					float maxTime = (float)block->percentile(100) * 1000.f;
+					if ( maxTime > .1f )
+					{
+						char indent[32];
+						int depth = block->depth() < 15 ? block->depth() : 15;
+						memset( indent, ' ', depth*2 );
+						indent[depth*2] = 0;
+						m_profiles.add( Format("{0}\"{1}\" median {2,#.##} ms, 95% {3,#.##} ms, max {4,#.##} ms", indent, block->name(), (float)block->percentile(50)*1000.f, (float)block->percentile(95)*1000.f, maxTime).format() );
+					}
 				}
-				std::sort( m_profiles.begin(), m_profiles.end() );
-				Profile::reset();
 				m_timeProfiled = 0;
 			}
 
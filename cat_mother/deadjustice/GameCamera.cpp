@@ -16,6 +16,7 @@
 #include <sg/Material.h>
 #include <sg/ViewFrustum.h>
 #include <sgu/NodeUtil.h>
+#include <sgu/ShadowUtil.h>
 #include <sgu/SceneManager.h>
 #include <bsp/BSPPolygon.h>
 #include <bsp/BSPCollisionUtil.h>
@@ -622,6 +623,10 @@ void GameCamera::render( Context* context, Scene* root )
 	{dev::Profile pr( "render.prepare" );
 	prepareRender( context, root, camera );}
 
+	// build shadows of the linked objects in parallel, rendering uploads them
+	{dev::Profile pr( "render.shadows" );
+	ShadowUtil::buildDynamicShadows( root );}
+
 	// render background
 	while ( m_background->firstChild() )
 		m_background->firstChild()->unlink();
@@ -42,6 +42,7 @@
 #include <lang/Character.h>
 #include <math/lerp.h>
 #include <math/Intersection.h>
+#include <anim/Control.h>
 #include <anim/VectorInterpolator.h>
 #include <script/VM.h>
 #include <script/ScriptException.h>
@@ -73,6 +74,35 @@ static const float CHARACTER_FACING_AWAY_FROM_CAMERA_ANGLE = Math::toRadians(90.
 
 //-----------------------------------------------------------------------------
 
+/** 
+ * Returns weighted blend of animation node positions.
+ * Only reads the animation nodes, which are shared by all characters
+ * of the level and might be accessed from several threads at the same time.
+ */
+static Vector3 blendPosition( Animatable** anims, const float* times, const float* weights, int n )
+{
+	Vector3 pos( 0.f, 0.f, 0.f );
+	for ( int i = 0 ; i < n ; ++i )
+	{
+		assert( dynamic_cast<Node*>( anims[i] ) );
+		Node* anim = static_cast<Node*>( anims[i] );
+		Control* ctrl = anim->positionController();
+		if ( ctrl )
+		{
+			float v[3];
+			ctrl->getValue( times[i], v, 3 );
+			pos += Vector3( v[0], v[1], v[2] ) * weights[i];
+		}
+		else
+		{
+			pos += anim->position() * weights[i];
+		}
+	}
+	return pos;
+}
+
+//-----------------------------------------------------------------------------
+
 ScriptMethod<GameCharacter> GameCharacter::sm_methods[] =
 {
 	//ScriptMethod<GameCharacter>( "funcName", script_funcName ),
@@ -367,7 +397,8 @@ GameCharacter::GameCharacter( VM* vm, io::InputStreamArchive* arch, sgu::NodeGro
 	m_timeSinceLastProjectile( 0  ),
 	m_timeSinceLastTaunt( 0  ),
 	m_worldAnim( 0 ),
-	m_worldAnimTime( 0 )
+	m_worldAnimTime( 0 ),
+	m_poseValid( false )
 {
 	m_computerControl = new ComputerControl( vm, arch, this );
 	m_userControl = new UserControl( vm, arch, this );
@@ -633,6 +664,7 @@ void GameCharacter::update( float dt, bool firstUpdateInFrame )
 		return;
 
 	GameObject::update( dt );
+	m_poseValid = false;
 
 	if ( !m_worldAnim )
 	{
@@ -668,6 +700,20 @@ void GameCharacter::update( float dt, bool firstUpdateInFrame )
 	m_timeSinceLastProjectile += dt;
 }
 
+void GameCharacter::evaluatePose()
+{
+	if ( poseDirty() )
+	{
+		applyTransformAnimations( 0 );
+		m_poseValid = true;
+	}
+}
+
+bool GameCharacter::poseDirty() const
+{
+	return !m_poseValid && m_mesh && !m_worldAnim && !hidden() && cell() && cell()->visible();
+}
+
 GameCharacter::PrimaryState GameCharacter::evaluatePrimaryState()
 {
 	PrimaryState state = m_primaryState;
@@ -1162,7 +1208,8 @@ void GameCharacter::applyTransformAnimations( Camera* /*camera*/ )
 	m_animParamBuffer.setSize( animsrunning );
 	animsrunning = m_primaryBlender->getResult( m_animParamBuffer.size(), m_animParamBuffer.begin(), 0.f );
 
-	Node* parent = 0;
+	bool master = false;
+	Vector3 masterpos( 0.f, 0.f, 0.f );
 
 	if ( animsrunning > 0 )
 	{
@@ -1183,10 +1230,11 @@ void GameCharacter::applyTransformAnimations( Camera* /*camera*/ )
 			}
 		}
 
+		// blend to local, MASTER_CTRL nodes are shared by the characters of the level
 		if ( m_nodeBuffer.size() > 0 )
 		{
-			parent = (Node*)m_nodeBuffer[0];
-			parent->blendState( m_nodeBuffer.begin(), m_timeBuffer.begin(), m_weightBuffer.begin(), m_nodeBuffer.size() );
+			master = true;
+			masterpos = blendPosition( m_nodeBuffer.begin(), m_timeBuffer.begin(), m_weightBuffer.begin(), m_nodeBuffer.size() );
 		}
 		
 		// Blend all bones
@@ -1222,10 +1270,10 @@ void GameCharacter::applyTransformAnimations( Camera* /*camera*/ )
 	}
 
 	// Apply translation of MASTER_CTRL (if any) to mesh 
-	if ( parent )
+	if ( master )
 	{
 		Vector3 rotatedoffset(0,0,0);
-		m_mesh->rotation().rotate( parent->position(), &rotatedoffset );
+		m_mesh->rotation().rotate( masterpos, &rotatedoffset );
 		m_mesh->setPosition( m_mesh->position() + rotatedoffset );
 	}
 
@@ -2469,8 +2517,12 @@ Node* GameCharacter::getRenderObject( Camera* camera )
 		}
 
 		// NOTE !! applyTransformAnimations modifies transformations of m_mesh hierarchy!
-		if ( !m_worldAnim )
+		// Pose is usually evaluated already by GameLevel::evaluateCharacterPoses
+		if ( !m_worldAnim && !m_poseValid )
+		{
 			applyTransformAnimations( camera );
+			m_poseValid = true;
+		}
 
 		// apply morph animations if highest LOD level in use
 		if ( m_lod->level() == 0 )
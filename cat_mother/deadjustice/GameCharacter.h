@@ -209,6 +209,17 @@ public:
 	 */
 	void		update( float dt, bool firstUpdateInFrame );
 
+	/** 
+	 * Blends animations to the bones of the character mesh if the pose
+	 * is not up to date after update(). Modifies only the character's own
+	 * mesh hierarchy and reads shared animation data, so poses of different
+	 * characters can be evaluated in parallel. No scripts are called.
+	 */
+	void		evaluatePose();
+
+	/** Returns true if evaluatePose() has work to do. */
+	bool		poseDirty() const;
+
 	/** Returns object to be used in rendering. */
 	sg::Node*	getRenderObject( sg::Camera* camera );
 
@@ -761,6 +772,9 @@ private:
 	P(sg::Node)					m_worldAnim;
 	float						m_worldAnimTime;
 
+	// true if mesh hierarchy has the pose of current blender state
+	bool						m_poseValid;
+
 	// anim
 	float	animLength( const lang::String& animationName ) const;
 
@@ -13,6 +13,7 @@
 #include "GameBoxTrigger.h"
 #include "ScriptUtil.h"
 #include <anim/Control.h>
+#include <dev/Profile.h>
 #include <io/File.h>
 #include <io/InputStream.h>
 #include <io/InputStreamArchive.h>
@@ -30,6 +31,7 @@
 #include <lang/String.h>
 #include <lang/Float.h>
 #include <lang/Character.h>
+#include <lang/Thread.h>
 #include <math/lerp.h>
 #include <math/Vector3.h>
 #include <music/MusicManager.h>
@@ -41,10 +43,23 @@
 #include <snd/SoundManager.h>
 #include <util/Vector.h>
 #include <algorithm>
+
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
 #include "config.h"
 
 //-----------------------------------------------------------------------------
 
+/** Minimum number of character poses to evaluate per thread. */
+#define MIN_POSES_PER_THREAD 2
+
+//-----------------------------------------------------------------------------
+
 ScriptMethod<GameLevel> GameLevel::sm_methods[] =
 {
 	ScriptMethod<GameLevel>( "createBoxTrigger", script_createBoxTrigger ),
@@ -90,6 +105,73 @@ using namespace script;
 
 //-----------------------------------------------------------------------------
 
+/** Returns number of processors in the system. */
+static int processorCount()
+{
+#ifdef WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	int n = (int)info.dwNumberOfProcessors;
+#else
+	int n = (int)sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+	return n > 0 ? n : 1;
+}
+
+//-----------------------------------------------------------------------------
+
+/** 
+ * Evaluates poses of every nth character of the list. 
+ * Errors are stored and rethrown by the calling thread.
+ */
+class PoseEvaluationThread :
+	public Thread
+{
+public:
+	PoseEvaluationThread() :
+		m_characters(0), m_first(0), m_step(1)
+	{
+	}
+
+	void setWork( const Vector<GameCharacter*>* characters, int first, int step )
+	{
+		m_characters = characters;
+		m_first = first;
+		m_step = step;
+		m_error = "";
+	}
+
+	void run()
+	{
+		const Vector<GameCharacter*>& characters = *m_characters;
+		try
+		{
+			for ( int i = m_first ; i < characters.size() ; i += m_step )
+				characters[i]->evaluatePose();
+		}
+		catch ( Throwable& e )
+		{
+			m_error = e.getMessage().format();
+		}
+	}
+
+	const String& error() const
+	{
+		return m_error;
+	}
+
+private:
+	const Vector<GameCharacter*>*	m_characters;
+	int								m_first;
+	int								m_step;
+	String							m_error;
+
+	PoseEvaluationThread( const PoseEvaluationThread& );
+	PoseEvaluationThread& operator=( const PoseEvaluationThread& );
+};
+
+//-----------------------------------------------------------------------------
+
 GameLevel::GameLevel( script::VM* vm, io::InputStreamArchive* arch, 
 	snd::SoundManager* soundMgr, ps::ParticleSystemManager* particleMgr, 
 	sgu::SceneManager* sceneMgr, music::MusicManager* musicMgr,
@@ -122,7 +204,10 @@ GameLevel::GameLevel( script::VM* vm, io::InputStreamArchive* arch,
 	m_flareSetList( Allocator<P(GameFlareSet)>(__FILE__) ),
 	m_mainCharacter( 0 ),
 	m_cutScene( 0 ),
-	m_removed( Allocator<P(GameObject)>(__FILE__) )
+	m_removed( Allocator<P(GameObject)>(__FILE__) ),
+	m_posedCharacters( Allocator<GameCharacter*>(__FILE__) ),
+	m_poseWorkers( Allocator<P(PoseEvaluationThread)>(__FILE__) ),
+	m_poseThreads( 0 )
 {
 	m_methodBase = ScriptUtil<GameLevel,GameScriptable>::addMethods( this, sm_methods, sizeof(sm_methods)/sizeof(sm_methods[0]) );
 
@@ -179,7 +264,8 @@ GameDynamicObject* GameLevel::createDynamicObject( sg::Node* node, const lang::S
 
 void GameLevel::loadFile( const String& filename ) 
 {
-	String path = File(m_arch->getInputStream( filename )->toString()).getParent();
+	P(InputStream) sceneIn = m_arch->getInputStream( filename );
+	String path = File(sceneIn->toString()).getParent();
 	P(sg::Node) scene = m_sceneMgr->getScene( filename )->clone();
 
 	replaceLightmapMaterialsWithShader( scene, m_lightmapShader );
@@ -239,7 +325,8 @@ void GameLevel::loadFile( const String& filename )
 			
 			// create cell object
 			String name = cellScene->name();
-			String path = File(m_arch->getInputStream( filename )->toString()).getParent();
+			P(InputStream) sceneIn = m_arch->getInputStream( filename );
+			String path = File(sceneIn->toString()).getParent();
 			String bspFileName = path + "/" + name + ".bsp";
 			P(GameCell) cell = new GameCell( m_vm, m_arch, m_soundMgr, m_particleMgr, name, cellScene, bspFileName, m_bspBuildPolySkip, m_collisionMaterialTypes );
 			cell->m_level = this;
@@ -441,6 +528,88 @@ void GameLevel::update( float dt )
 	}
 }
 
+void GameLevel::updateCharacters( float dt, bool firstUpdateInFrame )
+{
+	dev::Profile pr( "update.characters.gameplay" );
+
+	for ( int i = 0 ; i < m_characterList.size() ; ++i )
+		m_characterList[i]->update( dt, firstUpdateInFrame );
+}
+
+void GameLevel::evaluateCharacterPoses()
+{
+	dev::Profile pr( "update.characters.pose" );
+
+	m_posedCharacters.clear();
+	for ( int i = 0 ; i < m_characterList.size() ; ++i )
+	{
+		GameCharacter* obj = m_characterList[i];
+		if ( obj->poseDirty() )
+			m_posedCharacters.add( obj );
+	}
+
+	// evaluate, calling thread takes the first share
+	int threads = poseThreads();
+	if ( threads > m_posedCharacters.size()/MIN_POSES_PER_THREAD )
+		threads = m_posedCharacters.size()/MIN_POSES_PER_THREAD;
+	if ( threads < 1 )
+		threads = 1;
+	while ( m_poseWorkers.size() < threads-1 )
+		m_poseWorkers.add( new PoseEvaluationThread );
+
+	int started = 0;
+	for ( ; started < threads-1 ; ++started )
+	{
+		PoseEvaluationThread* worker = m_poseWorkers[started];
+		worker->setWork( &m_posedCharacters, started+1, threads );
+		try
+		{
+			worker->start();
+		}
+		catch ( ... )
+		{
+			break;
+		}
+	}
+
+	// shares of the workers which failed to start are evaluated here too
+	String error = "";
+	try
+	{
+		for ( int i = 0 ; i < m_posedCharacters.size() ; ++i )
+		{
+			int share = i % threads;
+			if ( 0 == share || share > started )
+				m_posedCharacters[i]->evaluatePose();
+		}
+	}
+	catch ( Throwable& e )
+	{
+		error = e.getMessage().format();
+	}
+
+	for ( int k = 0 ; k < started ; ++k )
+	{
+		m_poseWorkers[k]->join();
+		if ( error.length() == 0 )
+			error = m_poseWorkers[k]->error();
+	}
+
+	if ( error.length() > 0 )
+		throw Exception( Format("Failed to evaluate character pose: {0}", error) );
+}
+
+void GameLevel::setPoseThreads( int count )
+{
+	assert( count >= 0 );
+	m_poseThreads = count;
+}
+
+int GameLevel::poseThreads() const
+{
+	return m_poseThreads > 0 ? m_poseThreads : processorCount();
+}
+
 void GameLevel::removeObject( GameObject* obj )
 {
 	P(GameObject) o = obj;
@@ -692,7 +861,8 @@ int GameLevel::script_loadDynamicObjects( script::VM* vm, const char* funcName )
 		throw ScriptException( Format("{0} expects level scene file name", funcName) );
 
 	String filename = vm->toString(1);
-	String path = File(m_arch->getInputStream( filename )->toString()).getParent();
+	P(InputStream) sceneIn = m_arch->getInputStream( filename );
+	String path = File(sceneIn->toString()).getParent();
 	P(Node) scene = m_sceneMgr->getScene( filename )->clone();
 
 	Table names( vm );
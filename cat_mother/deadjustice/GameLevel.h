@@ -53,6 +53,7 @@ class GameObject;
 class GameWeapon;
 class GameNoiseManager;
 class ProjectileManager;
+class PoseEvaluationThread;
 
 
 /** 
@@ -79,6 +80,26 @@ public:
 	/** Updates level. */
 	void			update( float dt );
 
+	/** 
+	 * Updates gameplay, AI and collisions of the characters serially.
+	 * Scripts are called from this phase.
+	 */
+	void			updateCharacters( float dt, bool firstUpdateInFrame );
+
+	/** 
+	 * Evaluates skeletal poses of the characters updated since the last call.
+	 * Poses are evaluated in parallel by worker threads, see setPoseThreads().
+	 * Returns after all poses have been evaluated.
+	 */
+	void			evaluateCharacterPoses();
+
+	/** 
+	 * Sets number of threads used to evaluate character poses.
+	 * 1 evaluates all poses on the calling thread.
+	 * 0 (default) uses one thread per processor.
+	 */
+	void			setPoseThreads( int count );
+
 	/** Removes all non-main characters from the level. Debug feature. */
 	void			removeNonMainCharacters();
 
@@ -163,6 +184,9 @@ public:
 	/** Returns number of flare sets. */
 	int				flareSets() const												{return m_flareSetList.size();}
 
+	/** Returns number of threads used to evaluate character poses. */
+	int				poseThreads() const;
+
 private:
 	enum NodeClass
 	{
@@ -211,6 +235,11 @@ private:
 	P(GameCutScene)						m_cutScene;
 	util::Vector<P(GameObject)>			m_removed;
 
+	// Pose evaluation
+	util::Vector<GameCharacter*>			m_posedCharacters;
+	util::Vector<P(PoseEvaluationThread)>	m_poseWorkers;
+	int										m_poseThreads;
+
 	/** Helper func for removing object from cell and adding it to m_removed list for to be removed in next update. */
 	void				removeObject( GameObject* obj );
 
@@ -278,6 +278,7 @@ void GameWindow::handleKeyDown( int key )
 			case 'F':			m_cfg->setBoolean( "Game.FlyCamera", !m_cfg->getBoolean("Game.FlyCamera") ); if ( !m_cfg->getBoolean("Game.FlyCamera") )  m_game->resetInputState(); break;
 			case VK_F9:			m_grabScreen=true; break;
 			case VK_PAUSE:		m_cfg->setBoolean( "Game.Pause", !m_cfg->getBoolean("Game.Pause") ); break;
+			case 'P':			if ( dev::Profile::saveChromeTrace("profile.json") ) Debug::println( "Profiled frames saved to profile.json" ); break;
 			}
 		}
 	}
@@ -63,7 +63,7 @@ OverlayBitmap::OverlayBitmap( VM* vm, io::InputStreamArchive* arch, const String
 
 	// load bitmap
 	P(InputStream) imgin = m_arch->getInputStream( filename );
-	P(Texture) tex = new Texture( m_arch->getInputStream(filename) );
+	P(Texture) tex = new Texture( imgin );
 	imgin->close();
 
 	// create sprite bitmap
@@ -1,8 +1,11 @@
 #include "Profile.h"
 #include <lang/Object.h>
+#include <lang/Thread.h>
 #include <util/Vector.h>
+#include <algorithm>
 #include <assert.h>
 #include <string.h>
+#include <stdio.h>
 
 #if defined(_DEBUG) && defined(WIN32) && defined(_MSC_VER)
 #define WIN32_LEAN_AND_MEAN
@@ -12,6 +15,22 @@
 
 #include "config.h"
 
+#ifdef _MSC_VER
+	#define PROFILE_THREAD_LOCAL __declspec(thread)
+#else
+	#define PROFILE_THREAD_LOCAL __thread
+#endif
+
+// keeps compiler from moving memory accesses across the barrier,
+// MSVC doesn't move memory accesses over volatile writes anyway
+#ifdef __GNUC__
+	#define PROFILE_COMPILER_BARRIER() __asm__ __volatile__( "" ::: "memory" )
+#else
+	#define PROFILE_COMPILER_BARRIER()
+#endif
+
+#ifndef DEV_NOPROFILE
+
 //-----------------------------------------------------------------------------
 
 using namespace util;
@@ -22,36 +41,160 @@ namespace dev
 {
 
 
+/** Number of events in ring buffer of a thread. Must be power of two. */
+const int EVENT_BUFFER_SIZE = 8192;
+
+/** Maximum profiled scope nesting depth. */
+const int MAX_DEPTH = 64;
+
+//-----------------------------------------------------------------------------
+
+/** Scope begin or end event. */
+struct ProfileEvent
+{
+	const char*		name;
+	unsigned long	timeLow;
+	unsigned long	timeHigh;
+	int				depth;		// positive for begin and negative for end of scope
+};
+
+/** Scope which has begun but not ended. */
+struct ProfileScope
+{
+	Profile::BlockInfo*	block;
+	unsigned long		timeLow;
+	unsigned long		timeHigh;
+};
+
+/**
+ * Single producer single consumer event ring buffer of a thread.
+ * Events are written by the owner thread and read by
+ * the thread which collects statistics.
+ */
+struct ProfileThread
+{
+	// written by the owner thread
+	ProfileEvent			events[EVENT_BUFFER_SIZE];
+	volatile unsigned long	head;
+	int						depth;
+
+	// written by the collecting thread
+	volatile unsigned long	tail;
+	ProfileScope			scopes[MAX_DEPTH];
+	int						scopeCount;
+	Profile::BlockInfo*		root;
+	int						index;
+	ProfileThread*			next;
+
+	// owner thread has exited and the buffer can be reused, protected by the collector lock
+	bool					released;
+
+	ProfileThread() :
+		head(0), depth(0), tail(0), scopeCount(0), root(0), index(0), next(0), released(false)
+	{
+	}
+};
+
+/** Completed scope kept for Chrome trace. */
+struct ProfileTraceEvent
+{
+	const char*		name;
+	int				thread;
+	unsigned long	timeLow;
+	unsigned long	timeHigh;
+	double			duration;
+};
+
+/** End of frame marker kept for Chrome trace. */
+struct ProfileTraceFrame
+{
+	int				end;		// index of the first event after the frame
+	unsigned long	timeLow;
+	unsigned long	timeHigh;
+};
+
+//-----------------------------------------------------------------------------
+
+static PROFILE_THREAD_LOCAL ProfileThread*	s_thread = 0;
+
+//-----------------------------------------------------------------------------
+
+static void releaseThread();
+
+//-----------------------------------------------------------------------------
+
 /**
- * Profiling info implementation.
+ * Profiling info implementation, node of a call tree.
  */
-class Profile::BlockInfoImpl : 
+class Profile::BlockInfoImpl :
 	public Profile::BlockInfo
 {
 public:
-	BlockInfoImpl*		m_next;
-	int					m_refs;
-	char				m_name[64];
-	TimeStamp			m_ticks;
-	int					m_count;
-
-	BlockInfoImpl()																
+	const char*		m_name;
+	BlockInfoImpl*	m_parent;
+	BlockInfoImpl*	m_child;
+	BlockInfoImpl*	m_next;
+	int				m_depth;
+	int				m_thread;
+	TimeStamp		m_ticks;
+	int				m_count;
+	TimeStamp		m_frameTicks;
+	float			m_history[HISTORY_FRAMES];
+	int				m_frames;
+	int				m_lastFrame;
+
+	BlockInfoImpl( const char* name, BlockInfoImpl* parent, int thread ) :
+		m_name( name ),
+		m_parent( parent ),
+		m_child( 0 ),
+		m_next( 0 ),
+		m_depth( parent ? parent->m_depth+1 : -1 ),
+		m_thread( thread ),
+		m_ticks( 0, 0 ),
+		m_frameTicks( 0, 0 )
 	{
-		m_next = 0;
+		clear();
 	}
 
-	void create( const char* name )
+	/** Clears statistics. */
+	void clear()
 	{
-		m_refs	= 1;
-		strncpy( m_name, name, sizeof(m_name)-1 );
-		m_name[sizeof(m_name)-1] = 0;
 		m_ticks = TimeStamp(0,0);
-		m_count = 1;
+		m_count = 0;
+		m_frameTicks = TimeStamp(0,0);
+		m_frames = 0;
+		m_lastFrame = HISTORY_FRAMES-1;
+	}
+
+	/** Adds frame time to history. */
+	void endFrame()
+	{
+		m_lastFrame = (m_lastFrame+1) % HISTORY_FRAMES;
+		m_history[m_lastFrame] = (float)m_frameTicks.seconds();
+		m_frameTicks = TimeStamp(0,0);
+		if ( m_frames < HISTORY_FRAMES )
+			++m_frames;
+	}
+
+	double percentile( int percent ) const
+	{
+		assert( percent >= 0 && percent <= 100 );
+
+		if ( 0 == m_frames )
+			return 0.0;
+
+		float sorted[HISTORY_FRAMES];
+		memcpy( sorted, m_history, sizeof(float)*m_frames );
+		std::sort( sorted, sorted+m_frames );
+		return sorted[ (percent*(m_frames-1)+50)/100 ];
 	}
 
 	double			time() const													{return m_ticks.seconds();}
 	int				count() const													{return m_count;}
 	const char*		name() const													{return m_name;}
+	int				depth() const													{return m_depth;}
+	int				thread() const													{return m_thread;}
+	double			frameTime() const												{return m_frames > 0 ? m_history[m_lastFrame] : 0.0;}
 
 private:
 	BlockInfoImpl( const BlockInfoImpl& );
@@ -66,10 +209,17 @@ static class Profile::ProfileStaticData :
 public:
 	ProfileStaticData() :
 		Object( OBJECT_INITMUTEX ),
-		m_free( Allocator<BlockInfoImpl*>(__FILE__,__LINE__) ),
-		m_blockInfoAlloc(__FILE__,__LINE__)
+		m_blocks( Allocator<BlockInfoImpl*>(__FILE__,__LINE__) ),
+		m_trace( Allocator<ProfileTraceEvent>(__FILE__,__LINE__) ),
+		m_traceFrames( Allocator<ProfileTraceFrame>(__FILE__,__LINE__) )
 	{
-		m_active = 0;
+		m_threads = 0;
+		m_threadCount = 0;
+		m_blocksDirty = false;
+		m_maxTraceFrames = 0;
+
+		// threads restarted every frame reuse buffers of exited threads
+		lang::Thread::addExitHook( releaseThread );
 
 		// enable exit-time leak check
 		#if defined(_DEBUG) && defined(_MSC_VER) && defined(WIN32)
@@ -79,144 +229,395 @@ public:
 
 	~ProfileStaticData()
 	{
-		reset();
-
 		synchronized( this );
-		while ( m_free.size() > 0 )
+
+		while ( m_threads )
 		{
-			m_blockInfoAlloc.deallocate( m_free[m_free.size()-1], 1 );
-			m_free.setSize( m_free.size()-1 );
+			ProfileThread* next = m_threads->next;
+			destroyTree( static_cast<BlockInfoImpl*>(m_threads->root) );
+			delete m_threads;
+			m_threads = next;
 		}
 	}
 
-	BlockInfoImpl* enterBlock( const char* name )
+	/** 
+	 * Returns event buffer for the calling thread.
+	 * Buffer released by an exited thread is reused if any,
+	 * so the new thread also continues its call tree and index.
+	 */
+	ProfileThread* registerThread()
 	{
+		assert( !s_thread );
+
 		synchronized( this );
 
-		// try to find existing block
-		BlockInfoImpl* info;
-		if ( m_active )
-		{
-			for ( info = m_active ; info ; info = info->m_next )
-			{
-				if ( !strcmp(info->m_name,name) )
-				{
-					info->m_count++;
-					info->m_refs++;
-
-					assert( info->m_refs > 0 );
-					return info;
-				}
-			}
-		}
+		ProfileThread** link = &m_threads;
+		while ( *link && !(*link)->released )
+			link = &(*link)->next;
 
-		// create block
-		if ( 0 == m_free.size() )
+		ProfileThread* thread = *link;
+		if ( thread )
 		{
-			info = m_blockInfoAlloc.allocate(1);
+			thread->released = false;
 		}
 		else
 		{
-			info = m_free[m_free.size()-1];
-			m_free.setSize( m_free.size()-1 );
+			// keep threads in creation order
+			thread = new ProfileThread;
+			thread->index = m_threadCount++;
+			thread->root = new BlockInfoImpl( "", 0, thread->index );
+			*link = thread;
 		}
-		info->create( name );
 
-		// link to list of active blocks
-		info->m_next = m_active;
-		m_active = info;
+		s_thread = thread;
+		return thread;
+	}
 
-		assert( 1 == info->m_refs );
-		return info;
+	/** Releases event buffer of the calling thread for reuse. */
+	void release()
+	{
+		ProfileThread* thread = s_thread;
+		if ( thread )
+		{
+			synchronized( this );
+			assert( 0 == thread->depth );
+			thread->released = true;
+			s_thread = 0;
+		}
 	}
 
-	void leaveBlock( BlockInfoImpl* info, TimeStamp ticks )
+	/** Moves recorded events of all threads to the call trees. */
+	void collect()
 	{
 		synchronized( this );
-
-		info->m_ticks += ticks; 
-		info->m_refs--;
-
-		assert( info->m_refs >= 0 );
+		collectEvents();
 	}
 
-	void reset()
+	void endFrame()
 	{
 		synchronized( this );
 
-		// discard all info blocks
-		if ( m_active )
+		collectEvents();
+		updateBlockList();
+		int i;
+		for ( i = 0 ; i < m_blocks.size() ; ++i )
+			m_blocks[i]->endFrame();
+
+		if ( m_maxTraceFrames > 0 )
 		{
-			BlockInfoImpl* nextInfo;
-			for ( BlockInfoImpl* info = m_active ; info ; info = nextInfo )
+			TimeStamp time;
+			ProfileTraceFrame frame;
+			frame.end = m_trace.size();
+			frame.timeLow = time.low;
+			frame.timeHigh = time.high;
+			m_traceFrames.add( frame );
+
+			// discard oldest frame
+			if ( m_traceFrames.size() > m_maxTraceFrames )
 			{
-				// reset() can't be called while profiling is in progress
-				assert( 0 == info->m_refs );
-
-				nextInfo = info->m_next;
-				info->m_next = 0;
-				m_free.add( info );
+				int count = m_traceFrames[0].end;
+				m_trace.remove( 0, count );
+				m_traceFrames.remove( 0 );
+				for ( i = 0 ; i < m_traceFrames.size() ; ++i )
+					m_traceFrames[i].end -= count;
 			}
-			m_active = 0;
 		}
 	}
 
+	void reset()
+	{
+		synchronized( this );
+
+		collectEvents();
+		updateBlockList();
+		for ( int i = 0 ; i < m_blocks.size() ; ++i )
+			m_blocks[i]->clear();
+
+		m_trace.clear();
+		m_traceFrames.clear();
+	}
+
 	int	count()
 	{
 		synchronized( this );
 
-		int count = 0;
-		for ( BlockInfoImpl* info = m_active ; info ; info = info->m_next )
-			++count;
+		collectEvents();
+		updateBlockList();
+		return m_blocks.size();
+	}
+
+	Profile::BlockInfo* get( int index )
+	{
+		synchronized( this );
 
-		return count;
+		assert( index >= 0 && index < m_blocks.size() );
+		return m_blocks[index];
 	}
 
-	Profile::BlockInfo* first()
+	void setTraceFrames( int frames )
 	{
-		return m_active ? static_cast<BlockInfoImpl*>(m_active) : 0;
+		assert( frames >= 0 );
+
+		synchronized( this );
+
+		collectEvents();
+		m_maxTraceFrames = frames;
+		m_trace.clear();
+		m_traceFrames.clear();
 	}
 
-	Profile::BlockInfo* getNext( const Profile::BlockInfo* next )
+	bool saveChromeTrace( const char* filename )
 	{
-		assert( next );
+		synchronized( this );
 
-		const BlockInfoImpl* nextImpl = static_cast<const BlockInfoImpl*>(next);
-		if ( nextImpl )
-			return static_cast<BlockInfoImpl*>( nextImpl->m_next );
-		else
-			return 0;
+		collectEvents();
+		FILE* fh = fopen( filename, "wt" );
+		if ( !fh )
+			return false;
+
+		// time stamps relative to the first event
+		double t0 = 0.0;
+		int i;
+		for ( i = 0 ; i < m_trace.size() ; ++i )
+		{
+			double t = TimeStamp(m_trace[i].timeLow,m_trace[i].timeHigh).seconds();
+			if ( 0 == i || t < t0 )
+				t0 = t;
+		}
+
+		fprintf( fh, "{\"traceEvents\":[\n" );
+		for ( ProfileThread* thread = m_threads ; thread ; thread = thread->next )
+			fprintf( fh, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"thread %i\"}},\n", thread->index, thread->index );
+
+		for ( i = 0 ; i < m_trace.size() ; ++i )
+		{
+			const ProfileTraceEvent& ev = m_trace[i];
+			double t = TimeStamp(ev.timeLow,ev.timeHigh).seconds();
+			fprintf( fh, "{\"name\":\"" );
+			writeEscaped( fh, ev.name );
+			fprintf( fh, "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%i},\n", (t-t0)*1e6, ev.duration*1e6, ev.thread );
+		}
+
+		for ( i = 0 ; i < m_traceFrames.size() ; ++i )
+		{
+			const ProfileTraceFrame& frame = m_traceFrames[i];
+			double t = TimeStamp(frame.timeLow,frame.timeHigh).seconds();
+			fprintf( fh, "{\"name\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":1,\"tid\":0},\n", (t-t0)*1e6 );
+		}
+
+		fprintf( fh, "{}],\"displayTimeUnit\":\"ms\"}\n" );
+		bool ok = !ferror( fh );
+		fclose( fh );
+		return ok;
 	}
 
 private:
-	BlockInfoImpl*				m_active;	// List of active profiling blocks.
-	Vector<BlockInfoImpl*>		m_free;
-	Allocator<BlockInfoImpl>	m_blockInfoAlloc;
+	ProfileThread*				m_threads;
+	int							m_threadCount;
+	Vector<BlockInfoImpl*>		m_blocks;		// depth-first order
+	bool						m_blocksDirty;
+	Vector<ProfileTraceEvent>	m_trace;
+	Vector<ProfileTraceFrame>	m_traceFrames;
+	int							m_maxTraceFrames;
+
+	/** Moves recorded events of all threads to the call trees. Must be synchronized. */
+	void collectEvents()
+	{
+		for ( ProfileThread* thread = m_threads ; thread ; thread = thread->next )
+		{
+			unsigned long head = thread->head;
+			PROFILE_COMPILER_BARRIER();
+			for ( unsigned long i = thread->tail ; i != head ; ++i )
+				process( thread, thread->events[i & (EVENT_BUFFER_SIZE-1)] );
+			PROFILE_COMPILER_BARRIER();
+			thread->tail = head;
+		}
+	}
+
+	/** Adds event to call tree of the thread. */
+	void process( ProfileThread* thread, const ProfileEvent& ev )
+	{
+		if ( ev.depth > 0 )
+		{
+			int depth = ev.depth;
+			if ( depth > MAX_DEPTH || thread->scopeCount < depth-1 )
+				return;
+
+			// parent scope is either open scope one level up or the thread itself
+			thread->scopeCount = depth-1;
+			BlockInfoImpl* parent = static_cast<BlockInfoImpl*>( thread->root );
+			if ( depth > 1 )
+				parent = static_cast<BlockInfoImpl*>( thread->scopes[depth-2].block );
+
+			ProfileScope& scope = thread->scopes[thread->scopeCount++];
+			scope.block = getChild( parent, ev.name );
+			scope.timeLow = ev.timeLow;
+			scope.timeHigh = ev.timeHigh;
+		}
+		else
+		{
+			int depth = -ev.depth;
+			if ( depth > MAX_DEPTH || thread->scopeCount < depth )
+				return;
+
+			thread->scopeCount = depth-1;
+			ProfileScope& scope = thread->scopes[depth-1];
+			BlockInfoImpl* block = static_cast<BlockInfoImpl*>( scope.block );
+
+			TimeStamp ticks = TimeStamp(ev.timeLow,ev.timeHigh) - TimeStamp(scope.timeLow,scope.timeHigh);
+			block->m_ticks += ticks;
+			block->m_frameTicks += ticks;
+			block->m_count += 1;
+
+			if ( m_maxTraceFrames > 0 )
+			{
+				ProfileTraceEvent trace;
+				trace.name = block->m_name;
+				trace.thread = thread->index;
+				trace.timeLow = scope.timeLow;
+				trace.timeHigh = scope.timeHigh;
+				trace.duration = ticks.seconds();
+				m_trace.add( trace );
+			}
+		}
+	}
+
+	/** Returns child scope of specified name. Creates the child if not found. */
+	BlockInfoImpl* getChild( BlockInfoImpl* parent, const char* name )
+	{
+		BlockInfoImpl* last = 0;
+		for ( BlockInfoImpl* child = parent->m_child ; child ; child = child->m_next )
+		{
+			if ( child->m_name == name || !strcmp(child->m_name,name) )
+				return child;
+			last = child;
+		}
+
+		// keep children in order of appearance
+		BlockInfoImpl* child = new BlockInfoImpl( name, parent, parent->m_thread );
+		if ( last )
+			last->m_next = child;
+		else
+			parent->m_child = child;
+		m_blocksDirty = true;
+		return child;
+	}
+
+	/** Lists scopes of all threads in depth-first order. */
+	void updateBlockList()
+	{
+		if ( m_blocksDirty )
+		{
+			m_blocks.clear();
+			for ( ProfileThread* thread = m_threads ; thread ; thread = thread->next )
+				addBlocks( static_cast<BlockInfoImpl*>(thread->root) );
+			m_blocksDirty = false;
+		}
+	}
+
+	void addBlocks( BlockInfoImpl* parent )
+	{
+		for ( BlockInfoImpl* child = parent->m_child ; child ; child = child->m_next )
+		{
+			m_blocks.add( child );
+			addBlocks( child );
+		}
+	}
+
+	static void destroyTree( BlockInfoImpl* block )
+	{
+		while ( block->m_child )
+		{
+			BlockInfoImpl* child = block->m_child;
+			block->m_child = child->m_next;
+			destroyTree( child );
+		}
+		delete block;
+	}
+
+	/** Writes string with JSON escapes. */
+	static void writeEscaped( FILE* fh, const char* str )
+	{
+		for ( ; *str ; ++str )
+		{
+			int c = (unsigned char)*str;
+			if ( '"' == c || '\\' == c )
+				fprintf( fh, "\\%c", c );
+			else if ( c < 0x20 || c >= 0x7F )
+				fprintf( fh, "\\u%04x", c );
+			else
+				fputc( c, fh );
+		}
+	}
 
 } s_data;
 
 //----------------------------------------------------------------------------
 
+/** Called by lang::Thread before a thread exits. */
+static void releaseThread()
+{
+	s_data.release();
+}
+
+//----------------------------------------------------------------------------
+
+/** Adds event to ring buffer of the calling thread. */
+static void record( ProfileThread* thread, const char* name, int depth )
+{
+	// buffer full, collect events synchronously
+	unsigned long head = thread->head;
+	if ( head - thread->tail >= (unsigned long)EVENT_BUFFER_SIZE )
+		s_data.collect();
+
+	TimeStamp time;
+
+	ProfileEvent& ev = thread->events[head & (EVENT_BUFFER_SIZE-1)];
+	ev.name = name;
+	ev.timeLow = time.low;
+	ev.timeHigh = time.high;
+	ev.depth = depth;
+
+	PROFILE_COMPILER_BARRIER();
+	thread->head = head+1;
+}
+
+//----------------------------------------------------------------------------
+
 bool Profile::sm_enabled = true;
 
 //-----------------------------------------------------------------------------
 
 Profile::Profile( const char* name ) :
-	m_info( sm_enabled ? s_data.enterBlock(name) : 0 ),
-	m_ticks()
+	m_name( 0 )
 {
+	if ( sm_enabled )
+	{
+		ProfileThread* thread = s_thread;
+		if ( !thread )
+			thread = s_data.registerThread();
+
+		m_name = name;
+		thread->depth += 1;
+		record( thread, name, thread->depth );
+	}
 }
 
 Profile::~Profile()
 {
-	if ( m_info )
+	if ( m_name )
 	{
-		TimeStamp ticks;
-		ticks -= m_ticks;
-		s_data.leaveBlock( m_info, ticks );
+		ProfileThread* thread = s_thread;
+		record( thread, m_name, -thread->depth );
+		thread->depth -= 1;
 	}
 }
 
+void Profile::endFrame()
+{
+	s_data.endFrame();
+}
+
 void Profile::reset()
 {
 	s_data.reset();
@@ -229,18 +630,7 @@ int	Profile::count()
 
 Profile::BlockInfo* Profile::get( int index )
 {
-	assert( index >= 0 && index < count() );
-
-	synchronized( s_data );
-
-	BlockInfo* it = s_data.first();
-	for ( int i = 0 ; i != index && it ; ++i )
-	{
-		it = s_data.getNext(it);
-	}
-
-	assert( it );
-	return it;
+	return s_data.get( index );
 }
 
 void Profile::setEnabled( bool enabled )
@@ -248,5 +638,18 @@ void Profile::setEnabled( bool enabled )
 	sm_enabled = enabled;
 }
 
+void Profile::setTraceFrames( int frames )
+{
+	s_data.setTraceFrames( frames );
+}
+
+bool Profile::saveChromeTrace( const char* filename )
+{
+	return s_data.saveChromeTrace( filename );
+}
+
 
 } // dev
+
+
+#endif // DEV_NOPROFILE
@@ -9,39 +9,48 @@ namespace dev
 {
 
 
-/** 
- * Class for profiling code. Thread-safe.
+/**
+ * Hierarchical class for profiling code. Thread-safe.
  *
- * High resolution timer is started in the constructor of the profile object 
- * and stopped automatically in the destructor when the code scope is exited.
- * The statistics of Profile objects with identical scope names are merged together.
+ * Profile object records begin and end events of a code scope
+ * to a ring buffer of the calling thread. Recording does not need locking
+ * and the name is not looked up, so profile objects are cheap enough
+ * to leave in shipping builds. The events are collected to a call tree
+ * (one tree per thread) when statistics are requested or
+ * when endFrame() is called. Scopes with identical name and
+ * identical parent scope are merged together.
  *
- * After all blocks of code have been profiled, the class functions can 
- * then be used to report statistics. Statistics include for example number of
- * times scope executed and time spend in the code.
+ * Statistics include total time and count since last reset,
+ * and per-frame times over the last HISTORY_FRAMES frames
+ * (e.g. median, 95th percentile and maximum). Optionally last
+ * frames can be saved in Chrome trace format (chrome://tracing)
+ * for inspecting spikes.
+ *
+ * Defining DEV_NOPROFILE removes profiling code completely.
  *
  * Usage example:
  * <pre>
-    void func1() 
-    { 
-        Profile profileFunc1( "func1" ); 
+    void func1()
+    {
+        Profile profileFunc1( "func1" );
         ...
-    } 
+    }
 
-    void func1() 
-    { 
-        Profile profileFunc2( "func2" ); 
-        ...
+    void func2()
+    {
+        Profile profileFunc2( "func2" );
+        func1();
     }
 
     // report execution times of the functions to console
     func1();
     func2();
-    for ( int i = 0 ; i < Profile::count() ; ++i ) 
-    { 
+    Profile::endFrame();
+    for ( int i = 0 ; i < Profile::count() ; ++i )
+    {
 		Profile::BlockInfo* block = Profile::get(i);
-        cout << block->name() << ": " << block->time() << "\n"; 
-    }   
+        cout << block->name() << ": " << block->time() << "\n";
+    }
 	</pre>
  *
  * @author Jani Kajala (jani.kajala@helsinki.fi)
@@ -49,6 +58,13 @@ namespace dev
 class Profile
 {
 public:
+	/** Profiling constants. */
+	enum Constants
+	{
+		/** Number of frames used in per-frame time statistics. */
+		HISTORY_FRAMES	= 128,
+	};
+
 	/** Interface to information about profiled scope. */
 	class BlockInfo
 	{
@@ -61,48 +77,101 @@ public:
 
 		/** Returns number of times the scope has been profiled since last reset. */
 		virtual int				count() const = 0;
+
+		/** Returns nesting level of the scope. Top level scopes are at depth 0. */
+		virtual int				depth() const = 0;
+
+		/** 
+		 * Returns index of the thread which executed the scope, in order of first profiled scope.
+		 * Index of a lang::Thread which has exited is reused by the next thread to profile a scope.
+		 */
+		virtual int				thread() const = 0;
+
+		/** Returns time (in seconds) spend in the scope during the last completed frame. */
+		virtual double			frameTime() const = 0;
+
+		/**
+		 * Returns percentile of per-frame times (in seconds) over the last HISTORY_FRAMES frames.
+		 * @param percent Percentile in range [0,100], 50 is median and 100 is maximum.
+		 */
+		virtual double			percentile( int percent ) const = 0;
 	};
 
-	/** 
-	 * Starts profiling current scope. 
-	 * All profile objects with the same scope name 
-	 * will contribute to the same result.
+#ifndef DEV_NOPROFILE
+
+	/**
+	 * Starts profiling current scope.
 	 *
 	 * @param name The name of the profiled scope. ASCII-7 characters only.
+	 * The string is not copied so it must stay valid while
+	 * the program runs, in practice a string literal.
 	 */
 	explicit Profile( const char* name );
 
 	/** Ends scope profiling. */
 	~Profile();
 
-	/** 
-	 * Clears all profiling information. 
-	 * Profiling can't be in progress when this function is called.
+	/**
+	 * Collects profiled scopes and ends current frame.
+	 * Should be called once per frame by the thread running the main loop.
+	 */
+	static void				endFrame();
+
+	/**
+	 * Clears all profiling statistics and kept trace frames.
+	 * Scopes in progress are included when they end.
 	 */
 	static void				reset();
 
-	/** Returns number of profiled scopes. */
+	/**
+	 * Collects profiled scopes and returns number of them.
+	 * Scopes are in depth-first order, grouped by thread.
+	 */
 	static int				count();
 
-	/** Returns ith profiled scope. */
+	/**
+	 * Returns ith profiled scope.
+	 * Returned object stays valid while the program runs.
+	 */
 	static BlockInfo*		get( int index );
 
 	/** Sets profiling enabled/disabled. */
 	static void				setEnabled( bool enabled );
 
+	/**
+	 * Sets number of last frames kept for saveChromeTrace().
+	 * Default is 0, i.e. no trace is kept.
+	 */
+	static void				setTraceFrames( int frames );
+
+	/**
+	 * Saves kept frames in Chrome trace event format.
+	 * @return false if the file could not be written.
+	 */
+	static bool				saveChromeTrace( const char* filename );
+
 private:
 	class BlockInfoImpl;
 	class ProfileStaticData;
 	friend class ProfileStaticData;
 
 	static bool		sm_enabled;
-	BlockInfoImpl*	m_info;
-	TimeStamp		m_ticks;
-	long			m_allocBlocks;
-	long			m_allocBytes;
-	long			m_freedBlocks;
-	long			m_freedBytes;
+	const char*		m_name;
+
+#else
 
+	explicit Profile( const char* )											{}
+	static void				endFrame()										{}
+	static void				reset()											{}
+	static int				count()											{return 0;}
+	static BlockInfo*		get( int )										{return 0;}
+	static void				setEnabled( bool )								{}
+	static void				setTraceFrames( int )							{}
+	static bool				saveChromeTrace( const char* )					{return false;}
+
+#endif // DEV_NOPROFILE
+
+private:
 	Profile();
 	Profile( const Profile& );
 	Profile& operator=( const Profile& );
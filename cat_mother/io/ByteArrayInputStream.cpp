@@ -37,12 +37,19 @@ long ByteArrayInputStream::read( void* data, long size )
 	if ( left < count )
 		count = left;
 
-	const uint8_t*	src		= reinterpret_cast<const uint8_t*>( m_data ) + m_index;
-	uint8_t*		dest	= reinterpret_cast<uint8_t*>( data );
+	memcpy( data, m_data+m_index, count );
+	m_index += count;
+	return count;
+}
 
-	for ( long i = 0 ; i < count ; ++i )
-		dest[i] = src[i];
+long ByteArrayInputStream::readDirect( const void** data, long size )
+{
+	long left = available();
+	long count = size;
+	if ( left < count )
+		count = left;
 
+	*data = m_data + m_index;
 	m_index += count;
 	return count;
 }
@@ -43,6 +43,12 @@ public:
 	 */
 	long	available() const;
 
+	/**
+	 * Returns pointer to the next bytes of the stream without copying them.
+	 * @see InputStream::readDirect
+	 */
+	long	readDirect( const void** data, long size );
+
 	/** Returns byte array identifier. */
 	lang::String	toString() const;
 
@@ -42,6 +42,26 @@ ChunkInputStream::ChunkInputStream( InputStream* in ) :
 {
 }
 
+long ChunkInputStream::read( void* data, long size )
+{
+	return m_in.read( data, size );
+}
+
+long ChunkInputStream::skip( long n )
+{
+	return m_in.skip( n );
+}
+
+long ChunkInputStream::available() const
+{
+	return m_in.available();
+}
+
+long ChunkInputStream::readDirect( const void** data, long size )
+{
+	return m_in.readDirect( data, size );
+}
+
 void ChunkInputStream::beginChunk( String* name, long* end )
 {
 	*name = m_in.readUTF();
@@ -78,8 +98,7 @@ void ChunkInputStream::readFloatArray( float* array, int count )
 	assert( array );
 	assert( count >= 0 );
 
-	for ( int i = 0 ; i < count ; ++i )
-		array[i] = m_in.readFloat();
+	m_in.readFloatArray( array, count );
 }
 
 String ChunkInputStream::readString()
@@ -25,6 +25,33 @@ public:
 	///
 	explicit ChunkInputStream( InputStream* in );
 
+	/**
+	 * Tries to read specified number of bytes from the chunk data.
+	 * @return Number of bytes actually read.
+	 * @exception IOException
+	 */
+	long			read( void* data, long size );
+
+	/**
+	 * Tries to skip over n bytes from the chunk data.
+	 * @return Number of bytes actually skipped.
+	 * @exception IOException
+	 */
+	long			skip( long n );
+
+	/** 
+	 * Returns the number of bytes that can be read without blocking.
+	 * @exception IOException
+	 */
+	long			available() const;
+
+	/**
+	 * Returns pointer to the next bytes of the stream without copying them.
+	 * @see InputStream::readDirect
+	 * @exception IOException
+	 */
+	long			readDirect( const void** data, long size );
+
 	/** 
 	 * Begins reading a new chunk. 
 	 * @param name [out] Buffer for the chunk name.
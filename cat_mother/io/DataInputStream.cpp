@@ -3,8 +3,12 @@
 #include <lang/UTFConverter.h>
 #include <lang/UTF16.h>
 #include <assert.h>
+#include <string.h>
 #include <stdint.h>
 #include "config.h"
+#ifdef IO_SSE2
+#include <emmintrin.h>
+#endif
 
 //-----------------------------------------------------------------------------
 
@@ -22,16 +26,46 @@ static bool bigEndian()
 	return 0 == *reinterpret_cast<uint8_t*>(&x);
 }
 
-static void reverse( uint8_t* begin, uint8_t* end )
+/** Reverses byte order of count 32-bit values in place. */
+static void swap32( void* data, int count )
 {
-	for ( ; begin != end && begin != --end ; ++begin )
+	uint8_t* bytes = reinterpret_cast<uint8_t*>(data);
+	int i = 0;
+
+#ifdef IO_SSE2
+	for ( ; i+4 <= count ; i += 4 )
+	{
+		__m128i* p = reinterpret_cast<__m128i*>( bytes+i*4 );
+		__m128i x = _mm_loadu_si128( p );
+		x = _mm_or_si128( _mm_slli_epi16(x,8), _mm_srli_epi16(x,8) );
+		x = _mm_shufflelo_epi16( x, _MM_SHUFFLE(2,3,0,1) );
+		x = _mm_shufflehi_epi16( x, _MM_SHUFFLE(2,3,0,1) );
+		_mm_storeu_si128( p, x );
+	}
+#endif
+
+	for ( ; i < count ; ++i )
 	{
-		uint8_t b = *begin;
-		*begin = *end;
-		*end = b;
+		uint8_t* b = bytes+i*4;
+		uint8_t b0 = b[0];
+		uint8_t b1 = b[1];
+		b[0] = b[3];
+		b[1] = b[2];
+		b[2] = b1;
+		b[3] = b0;
 	}
 }
 
+static uint32_t getUInt32( const uint8_t* bytes )
+{
+	return (uint32_t(bytes[0])<<24) | (uint32_t(bytes[1])<<16) | (uint32_t(bytes[2])<<8) | uint32_t(bytes[3]);
+}
+
+static uint64_t getUInt64( const uint8_t* bytes )
+{
+	return (uint64_t(getUInt32(bytes))<<32) | uint64_t(getUInt32(bytes+4));
+}
+
 static void resizeBuffer( int newSize, void*& buffer, int& bufferSize )
 {
 	if ( bufferSize < newSize || !buffer )
@@ -64,32 +98,133 @@ DataInputStream::DataInputStream( InputStream* in ) :
 	m_inBuffer		= 0;
 	m_inBufferSize	= 0;
 	m_size			= 0;
+	m_buffer		= 0;
+	m_bufferPtr		= 0;
+	m_bufferEnd		= 0;
 }
 
 DataInputStream::~DataInputStream()
 {
 	if ( m_inBuffer )
 		freeBuffer( m_inBuffer );
+	delete[] m_buffer;
+}
+
+long DataInputStream::fill()
+{
+	// use source data directly if it is in memory
+	const void* data = 0;
+	long bytes = readDirectSource( &data, 0x7FFFFFFF );
+
+	if ( bytes <= 0 )
+	{
+		if ( !m_buffer )
+			m_buffer = new uint8_t[ BUFFER_SIZE ];
+		bytes = FilterInputStream::read( m_buffer, BUFFER_SIZE );
+		data = m_buffer;
+		if ( bytes < 0 )
+			bytes = 0;
+	}
+
+	m_bufferPtr = reinterpret_cast<const uint8_t*>(data);
+	m_bufferEnd = m_bufferPtr + bytes;
+	return bytes;
+}
+
+const uint8_t* DataInputStream::next( uint8_t* tmp, int bytes )
+{
+	if ( m_bufferEnd - m_bufferPtr >= bytes )
+	{
+		const uint8_t* data = m_bufferPtr;
+		m_bufferPtr += bytes;
+		m_size += bytes;
+		return data;
+	}
+
+	readFully( tmp, bytes );
+	return tmp;
 }
 
 long DataInputStream::skip( long n )
 {
-	long skipped = FilterInputStream::skip( n );
+	long skipped = m_bufferEnd - m_bufferPtr;
+	if ( skipped > n )
+		skipped = n;
+	m_bufferPtr += skipped;
+
+	if ( skipped < n )
+		skipped += FilterInputStream::skip( n-skipped );
 	m_size += skipped;
 	return skipped;
 }
 
 long DataInputStream::read( void* data, long size )
 {
-	long bytesRead = FilterInputStream::read( data, size );
+	uint8_t* dest = reinterpret_cast<uint8_t*>(data);
+	long bytesRead = 0;
+
+	while ( bytesRead < size )
+	{
+		long buffered = m_bufferEnd - m_bufferPtr;
+		long left = size - bytesRead;
+		if ( buffered > 0 )
+		{
+			if ( buffered > left )
+				buffered = left;
+			memcpy( dest+bytesRead, m_bufferPtr, buffered );
+			m_bufferPtr += buffered;
+			bytesRead += buffered;
+		}
+		else if ( left >= BUFFER_SIZE )
+		{
+			// large reads bypass the buffer
+			long bytes = FilterInputStream::read( dest+bytesRead, left );
+			if ( bytes <= 0 )
+				break;
+			bytesRead += bytes;
+		}
+		else if ( 0 == fill() )
+		{
+			break;
+		}
+	}
+
 	m_size += bytesRead;
 	return bytesRead;
 }
 
+bool DataInputStream::markSupported() const
+{
+	return false;
+}
+
+long DataInputStream::available() const
+{
+	return (m_bufferEnd - m_bufferPtr) + FilterInputStream::available();
+}
+
+long DataInputStream::readDirect( const void** data, long size )
+{
+	long bytes = m_bufferEnd - m_bufferPtr;
+	if ( bytes > 0 )
+	{
+		if ( bytes > size )
+			bytes = size;
+		*data = m_bufferPtr;
+		m_bufferPtr += bytes;
+	}
+	else
+	{
+		bytes = readDirectSource( data, size );
+	}
+
+	m_size += bytes;
+	return bytes;
+}
+
 void DataInputStream::readFully( void* data, long size )
 {
-	long bytesRead = FilterInputStream::read( data, size );
-	m_size += bytesRead;
+	long bytesRead = read( data, size );
 
 	if ( bytesRead != size )
 		throw EOFException( Format("Unexpected end of file in {0}.",toString()) );
@@ -97,26 +232,21 @@ void DataInputStream::readFully( void* data, long size )
 
 bool DataInputStream::readBoolean()
 {
-	uint8_t v;
-	readFully( &v, sizeof(v) );
-	return v != 0;
+	uint8_t tmp[1];
+	return *next( tmp, sizeof(tmp) ) != 0;
 }
 
 uint8_t DataInputStream::readByte()
 {
-	int8_t v;
-	readFully( &v, sizeof(v) );
-	return v;
+	uint8_t tmp[1];
+	return *next( tmp, sizeof(tmp) );
 }
 
 Char DataInputStream::readChar()
 {
-	uint8_t bytes[2];
-	readFully( bytes, sizeof(bytes) );
-	if ( !bigEndian() )
-		reverse( bytes, bytes+sizeof(bytes) );
-
-	uint16_t v = *reinterpret_cast<uint16_t*>(bytes);
+	uint8_t tmp[2];
+	const uint8_t* bytes = next( tmp, sizeof(tmp) );
+	uint16_t v = (uint16_t)( (bytes[0]<<8) | bytes[1] );
 	return (Char)v;
 }
 
@@ -143,56 +273,43 @@ String DataInputStream::readChars( int n )
 
 double DataInputStream::readDouble()
 {
-	uint8_t bytes[ sizeof(double) ];
-	readFully( bytes, sizeof(bytes) );
-	if ( !bigEndian() )
-		reverse( bytes, bytes+sizeof(bytes) );
+	uint8_t tmp[ sizeof(double) ];
+	uint64_t bits = getUInt64( next(tmp,sizeof(tmp)) );
 
-	double v = *reinterpret_cast<double*>(bytes);
+	double v;
+	memcpy( &v, &bits, sizeof(v) );
 	return v;
 }
 
 float DataInputStream::readFloat()
 {
-	uint8_t bytes[ sizeof(float) ];
-	readFully( bytes, sizeof(bytes) );
-	if ( !bigEndian() )
-		reverse( bytes, bytes+sizeof(bytes) );
+	uint8_t tmp[ sizeof(float) ];
+	uint32_t bits = getUInt32( next(tmp,sizeof(tmp)) );
 
-	float v = *reinterpret_cast<float*>(bytes);
+	float v;
+	memcpy( &v, &bits, sizeof(v) );
 	return v;
 }
 
 int DataInputStream::readInt()
 {
-	uint8_t bytes[ sizeof(int32_t) ];
-	readFully( bytes, sizeof(bytes) );
-	if ( !bigEndian() )
-		reverse( bytes, bytes+sizeof(bytes) );
-
-	int32_t v = *reinterpret_cast<int32_t*>(bytes);
+	uint8_t tmp[ sizeof(int32_t) ];
+	int32_t v = (int32_t)getUInt32( next(tmp,sizeof(tmp)) );
 	return (int)v;
 }
 
 long DataInputStream::readLong()
 {
-	uint8_t bytes[ sizeof(int64_t) ];
-	readFully( bytes, sizeof(bytes) );
-	if ( !bigEndian() )
-		reverse( bytes, bytes+sizeof(bytes) );
-
-	int64_t v = *reinterpret_cast<int64_t*>(bytes);
+	uint8_t tmp[ sizeof(int64_t) ];
+	int64_t v = (int64_t)getUInt64( next(tmp,sizeof(tmp)) );
 	return (long)v;
 }
 
 int DataInputStream::readShort()
 {
-	uint8_t bytes[ sizeof(int16_t) ];
-	readFully( bytes, sizeof(bytes) );
-	if ( !bigEndian() )
-		reverse( bytes, bytes+sizeof(bytes) );
-
-	int16_t v = *reinterpret_cast<int16_t*>(bytes);
+	uint8_t tmp[ sizeof(int16_t) ];
+	const uint8_t* bytes = next( tmp, sizeof(tmp) );
+	int16_t v = (int16_t)( (bytes[0]<<8) | bytes[1] );
 	return (int)v;
 }
 
@@ -209,10 +326,9 @@ String DataInputStream::readUTF()
 	if ( encodedBytes <= 0 )
 		throw IOException( Format("Invalid UTF-8 data in {0}.",toString()) );
 
-	// data
+	// data (decoded in place if buffered)
 	resizeBuffer( encodedBytes, m_inBuffer, m_inBufferSize );
-	uint8_t* inBuffer = reinterpret_cast<uint8_t*>(m_inBuffer);
-	readFully( inBuffer, encodedBytes );
+	const uint8_t* inBuffer = next( reinterpret_cast<uint8_t*>(m_inBuffer), encodedBytes );
 
 	// decode
 	int i = 0;
@@ -238,6 +354,26 @@ String DataInputStream::readUTF()
 	return str;
 }
 
+void DataInputStream::readIntArray( int* array, int count )
+{
+	assert( sizeof(int) == sizeof(int32_t) );
+	assert( count >= 0 );
+
+	readFully( array, count*sizeof(int32_t) );
+	if ( !bigEndian() )
+		swap32( array, count );
+}
+
+void DataInputStream::readFloatArray( float* array, int count )
+{
+	assert( sizeof(float) == sizeof(uint32_t) );
+	assert( count >= 0 );
+
+	readFully( array, count*sizeof(float) );
+	if ( !bigEndian() )
+		swap32( array, count );
+}
+
 long DataInputStream::size() const
 {
 	return m_size;
@@ -13,6 +13,10 @@ namespace io
 
 /**
  * Class for reading primitive types from the input stream in portable way.
+ * Reads ahead from the source stream in blocks, so the source stream
+ * should not be read directly while DataInputStream is used.
+ * If the source stream data is in memory (see InputStream::readDirect)
+ * then the data is decoded without intermediate copies.
  * @author Jani Kajala (jani.kajala@helsinki.fi)
  */
 class DataInputStream :
@@ -42,6 +46,25 @@ public:
 	 */
 	long read( void* data, long size );
 
+	/** 
+	 * Returns the number of bytes that can be read from the stream without blocking.
+	 * @exception IOException
+	 */
+	long available() const;
+
+	/**
+	 * Returns false, marking is not supported since
+	 * the stream reads ahead from the source stream.
+	 */
+	bool markSupported() const;
+
+	/**
+	 * Returns pointer to the next bytes of the stream without copying them.
+	 * @see InputStream::readDirect
+	 * @exception IOException
+	 */
+	long readDirect( const void** data, long size );
+
 	/**
 	 * Reads specified number of bytes from the stream.
 	 *
@@ -131,15 +154,39 @@ public:
 	 */
 	lang::String readUTF();
 
+	/**
+	 * Reads array of 32-bit signed integers from the stream.
+	 *
+	 * @exception EOFException
+	 * @exception IOException
+	 */
+	void readIntArray( int* array, int count );
+
+	/**
+	 * Reads array of floats from the stream.
+	 *
+	 * @exception EOFException
+	 * @exception IOException
+	 */
+	void readFloatArray( float* array, int count );
+
 	/**
 	 * Returns number of bytes read with this DataInputStream.
 	 */
 	long	size() const;
 
 private:
-	void*	m_inBuffer;
-	int		m_inBufferSize;
-	long	m_size;
+	enum { BUFFER_SIZE = 4096 };
+
+	void*			m_inBuffer;
+	int				m_inBufferSize;
+	long			m_size;
+	uint8_t*		m_buffer;
+	const uint8_t*	m_bufferPtr;
+	const uint8_t*	m_bufferEnd;
+
+	long			fill();
+	const uint8_t*	next( uint8_t* tmp, int bytes );
 
 	DataInputStream();
 	DataInputStream( const DataInputStream& );
@@ -131,8 +131,7 @@ public:
 
 		if ( !File(path).exists() )
 			throw FileNotFoundException( Format("File {0} is not in directories {1}", name, toString() ) );
-		m_inputStream = new FileInputStream( path );
-		return m_inputStream;
+		return new FileInputStream( path );
 	}
 
 	InputStream* getInputStream( int index )
@@ -141,8 +140,7 @@ public:
 			refreshEntries();
 
 		assert( index >= 0 && index < m_entries.size() );
-		m_inputStream = new FileInputStream( m_entries[index].getPath() );
-		return m_inputStream;
+		return new FileInputStream( m_entries[index].getPath() );
 	}
 
 	int size() const
@@ -169,7 +167,6 @@ private:
 	Array<String,1>			m_paths;
 	mutable Array<File,1>	m_entries;
 	mutable bool			m_entriesDirty;
-	P(InputStream)			m_inputStream;
 };
 
 //-----------------------------------------------------------------------------
@@ -34,6 +34,11 @@ long FilterInputStream::available() const
 	return m_source->available();
 }
 
+long FilterInputStream::readDirectSource( const void** data, long size )
+{
+	return m_source->readDirect(data,size);
+}
+
 lang::String FilterInputStream::toString() const
 {
 	return m_source->toString();
@@ -57,6 +57,17 @@ public:
 	/** Returns name of the source stream. */
 	lang::String	toString() const;
 
+protected:
+	/**
+	 * Returns pointer to the next bytes of the source stream without copying them.
+	 * readDirect() is not forwarded by default since filters may transform
+	 * the data, so filters which pass source data through unchanged
+	 * use this to implement it.
+	 * @see InputStream::readDirect
+	 * @exception IOException
+	 */
+	long	readDirectSource( const void** data, long size );
+
 private:
 	InputStream*	m_source;
 
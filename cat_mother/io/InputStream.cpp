@@ -58,5 +58,11 @@ bool InputStream::markSupported() const
 	return false;
 }
 
+long InputStream::readDirect( const void** data, long /*size*/ )
+{
+	*data = 0;
+	return 0;
+}
+
 
 } // io
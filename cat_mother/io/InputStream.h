@@ -71,6 +71,19 @@ public:
 	 */
 	virtual bool	markSupported() const;
 
+	/**
+	 * Returns pointer to the next bytes of the stream without copying them
+	 * and skips over the returned bytes. Works only if the stream data
+	 * is already in memory, otherwise returns 0. Default returns 0.
+	 * Returned data is valid until the stream is read again or closed.
+	 *
+	 * @param data [out] Receives pointer to the stream data.
+	 * @param size Maximum number of bytes to return.
+	 * @return Number of bytes available at *data.
+	 * @exception IOException
+	 */
+	virtual long	readDirect( const void** data, long size );
+
 	/** 
 	 * Returns the number of bytes that can be read from the stream without blocking.
 	 * @exception IOException
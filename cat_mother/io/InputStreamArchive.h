@@ -15,6 +15,10 @@ class InputStream;
 
 /** 
  * Abstract base to input stream archives. 
+ * getInputStream() returns a new stream on each call, so the
+ * caller must keep a reference to it while it is used.
+ * Opening streams by name does not modify the archive,
+ * so it can be done from several threads at the same time.
  * @author Jani Kajala (jani.kajala@helsinki.fi)
  */
 class InputStreamArchive :
@@ -1,3 +1,8 @@
 #ifdef _MSC_VER
 #include <config_msvc.h>
 #endif
+
+// Use SSE2 byte swapping if the compiler generates SSE2 code
+#if !defined(IO_NO_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define IO_SSE2
+#endif
@@ -0,0 +1,180 @@
+#include <tester/Test.h>
+#include <io/FileInputStream.h>
+#include <io/FileOutputStream.h>
+#include <io/ByteArrayInputStream.h>
+#include <io/DataOutputStream.h>
+#include <io/DataInputStream.h>
+#include <io/FilterInputStream.h>
+#include <lang/String.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+//-----------------------------------------------------------------------------
+
+using namespace io;
+using namespace lang;
+
+//-----------------------------------------------------------------------------
+
+const int VALUES = 100000;
+
+static double milliseconds( clock_t t0, clock_t t1 )
+{
+	return (double)(t1-t0) * 1e3 / CLOCKS_PER_SEC;
+}
+
+static void writeTest( const char* filename )
+{
+	P(FileOutputStream) fout = new FileOutputStream( filename );
+	P(DataOutputStream) dout = new DataOutputStream( fout );
+
+	// odd sized records so that values straddle read-ahead blocks
+	for ( int i = 0 ; i < VALUES ; ++i )
+	{
+		dout->writeByte( i & 0x7F );
+		dout->writeInt( i*7919 - VALUES );
+		dout->writeFloat( (float)i * .25f );
+		dout->writeShort( i & 0x7FFF );
+		if ( 0 == i % 1000 )
+			dout->writeUTF( "Hello!" );
+	}
+
+	for ( int i = 0 ; i < VALUES ; ++i )
+		dout->writeInt( -i );
+	for ( int i = 0 ; i < VALUES ; ++i )
+		dout->writeFloat( (float)i * .5f );
+	dout->close();
+}
+
+static void readTest( DataInputStream* din )
+{
+	long size = 0;
+	int i;
+	for ( i = 0 ; i < VALUES ; ++i )
+	{
+		assert( din->readByte() == (i & 0x7F) );
+		assert( din->readInt() == i*7919 - VALUES );
+		assert( din->readFloat() == (float)i * .25f );
+		assert( din->readShort() == (i & 0x7FFF) );
+		size += 11;
+		if ( 0 == i % 1000 )
+		{
+			assert( din->readUTF() == "Hello!" );
+			size += 8;
+		}
+	}
+	assert( din->size() == size );
+
+	// array lengths are not multiples of SIMD width
+	int* ints = new int[VALUES];
+	din->readIntArray( ints, 3 );
+	din->readIntArray( ints+3, VALUES-3 );
+	for ( i = 0 ; i < VALUES ; ++i )
+		assert( ints[i] == -i );
+	delete[] ints;
+
+	float* floats = new float[VALUES];
+	din->readFloatArray( floats, VALUES-1 );
+	floats[VALUES-1] = din->readFloat();
+	for ( i = 0 ; i < VALUES ; ++i )
+		assert( floats[i] == (float)i * .5f );
+	delete[] floats;
+
+	assert( 0 == din->available() );
+	assert( din->size() == size + VALUES*8 );
+}
+
+static void benchmark( const char* filename )
+{
+	P(FileInputStream) fin = new FileInputStream( filename );
+	long bytes = fin->available();
+	int count = bytes / 4;
+	char* data = new char[bytes];
+	fin->read( data, bytes );
+	fin->close();
+	float* floats = new float[count];
+
+	// per-value reads without read-ahead (previous implementation)
+	clock_t t0 = clock();
+	fin = new FileInputStream( filename );
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		char v[4];
+		fin->read( v, 4 );
+		char b = v[0]; v[0] = v[3]; v[3] = b;
+		b = v[1]; v[1] = v[2]; v[2] = b;
+		memcpy( floats+i, v, 4 );
+	}
+	fin->close();
+
+	// per-value reads with read-ahead
+	clock_t t1 = clock();
+	fin = new FileInputStream( filename );
+	P(DataInputStream) din = new DataInputStream( fin );
+	for ( int i = 0 ; i < count ; ++i )
+		floats[i] = din->readFloat();
+	din->close();
+
+	// bulk read from file
+	clock_t t2 = clock();
+	fin = new FileInputStream( filename );
+	din = new DataInputStream( fin );
+	din->readFloatArray( floats, count );
+	din->close();
+
+	// bulk read from memory
+	clock_t t3 = clock();
+	P(ByteArrayInputStream) bin = new ByteArrayInputStream( data, bytes );
+	clock_t t4 = clock();
+	din = new DataInputStream( bin );
+	din->readFloatArray( floats, count );
+	clock_t t5 = clock();
+
+	printf( "%s: %i floats: unbuffered %g ms, buffered %g ms, array %g ms, memory array %g ms\n",
+		filename, count, milliseconds(t0,t1), milliseconds(t1,t2), milliseconds(t2,t3), milliseconds(t4,t5) );
+
+	delete[] floats;
+	delete[] data;
+}
+
+static int test_DataStreams2()
+{
+	writeTest( "/tmp/out/dataout2.dat" );
+
+	P(FileInputStream) fin = new FileInputStream( "/tmp/out/dataout2.dat" );
+	P(DataInputStream) din = new DataInputStream( fin );
+	readTest( din );
+	din->close();
+
+	// in-memory source is decoded without copying
+	fin = new FileInputStream( "/tmp/out/dataout2.dat" );
+	long bytes = fin->available();
+	char* data = new char[bytes];
+	fin->read( data, bytes );
+	fin->close();
+	P(ByteArrayInputStream) bin = new ByteArrayInputStream( data, bytes );
+	din = new DataInputStream( bin );
+	readTest( din );
+	assert( !din->markSupported() );
+
+	// filters do not pass in-memory data through by default
+	bin = new ByteArrayInputStream( data, bytes );
+	delete[] data;
+	P(FilterInputStream) filter = new FilterInputStream( bin );
+	const void* direct = 0;
+	assert( 0 == filter->readDirect(&direct,4) );
+	din = new DataInputStream( filter );
+	readTest( din );
+
+	// IO_BENCHMARK_FILE can be used to benchmark real .sg/.gm files
+	const char* fname = getenv( "IO_BENCHMARK_FILE" );
+	benchmark( fname ? fname : "/tmp/out/dataout2.dat" );
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+static tester::Test reg( test_DataStreams2, __FILE__ );
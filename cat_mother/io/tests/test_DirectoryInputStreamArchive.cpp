@@ -22,6 +22,11 @@ static int test()
 	P(InputStream) testInputStream = arc.getInputStream( "all.dsp" );
 	assert( testInputStream );
 
+	// each call opens a new stream
+	P(InputStream) otherInputStream = arc.getInputStream( "all.dsp" );
+	assert( otherInputStream != testInputStream );
+	assert( otherInputStream->available() == testInputStream->available() );
+
 	char msg[1024];
 	arc.toString().getBytes( msg, sizeof(msg), "ASCII-7" );
 	printf( "Files (%s):\n", msg );
@@ -103,6 +103,10 @@ SOURCE=.\test_DataStreams1.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\test_DataStreams2.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\test_DirectoryInputStreamArchive.cpp
 # End Source File
 # Begin Source File
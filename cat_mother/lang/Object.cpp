@@ -1,6 +1,7 @@
 #include "Object.h"
 #include "Mutex.h"
 #include <mem/raw.h>
+#include <mem/Pool.h>
 #include <assert.h>
 #include "config.h"
 
@@ -10,6 +11,39 @@ namespace lang
 {
 
 
+#ifdef NDEBUG
+
+/** Bytes reserved before the object for its size, keeps objects 16-byte aligned. */
+const unsigned OBJECT_HEADER_SIZE = 16;
+
+/** 
+ * Allocates object from thread cached size class pools (release build). 
+ * Debug build uses memory groups instead to keep leak checks working.
+ */
+static void* allocateObject( unsigned n )
+{
+	char* mem = (char*)mem_Pool_allocate( n + OBJECT_HEADER_SIZE );
+	if ( !mem )
+		return 0;
+	*(unsigned*)mem = n;
+	return mem + OBJECT_HEADER_SIZE;
+}
+
+/** Frees object allocated with allocateObject. */
+static void freeObject( void* p )
+{
+	if ( p )
+	{
+		char* mem = (char*)p - OBJECT_HEADER_SIZE;
+		mem_Pool_free( mem, *(unsigned*)mem + OBJECT_HEADER_SIZE );
+	}
+}
+
+#endif // NDEBUG
+
+//-----------------------------------------------------------------------------
+
+
 Object::MutexLock::MutexLock( const Object& o )
 {
 	assert( o.m_mutex );	// initMutex has not been called
@@ -86,6 +120,30 @@ void Object::release()
 #undef new
 #endif
 
+#ifdef NDEBUG
+
+void* Object::operator new( unsigned n )
+{
+	return allocateObject( n );
+}
+
+void* Object::operator new( unsigned n, const char*, int )
+{
+	return allocateObject( n );
+}
+
+void Object::operator delete( void* p )
+{
+	freeObject( p );
+}
+
+void Object::operator delete( void* p, const char*, int )
+{
+	freeObject( p );
+}
+
+#else
+
 void* Object::operator new( unsigned n )
 {
 	return mem_allocate( n, __FILE__, __LINE__ );
@@ -106,6 +164,8 @@ void Object::operator delete( void* p, const char*, int )
 	mem_free( p );
 }
 
+#endif // NDEBUG
+
 
 } // lang
 
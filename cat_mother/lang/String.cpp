@@ -2,6 +2,7 @@
 #include "Mutex.h"
 #include "UTFConverter.h"
 #include <mem/raw.h>
+#include <mem/Pool.h>
 #include <dev/Profile.h>
 #include <assert.h>
 #include <stdio.h>
@@ -140,7 +141,11 @@ static Char* createDynamicString( int capacity )
 		capacity = 32;
 	
 	int bytes = sizeof(StringRep) + sizeof(Char)*unsigned(capacity);
+#ifdef NDEBUG
+	void* p = mem_Pool_allocate( bytes );
+#else
 	void* p = mem_alloc( bytes );
+#endif
 	memset( p, 0, bytes );
 
 	StringRep* s = reinterpret_cast<StringRep*>(p);
@@ -247,7 +252,13 @@ static void releaseString( Char* str )
 	if ( 0 == Mutex::decrementRC(&s->refs) )
 	{
 		if ( !s->autoalloc )
+		{
+#ifdef NDEBUG
+			mem_Pool_free( s, sizeof(StringRep) + sizeof(Char)*unsigned(s->capacity) );
+#else
 			mem_free( s );
+#endif
+		}
 	}
 }
 
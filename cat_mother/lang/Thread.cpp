@@ -3,6 +3,7 @@
 #include "Throwable.h"
 #include "Exception.h"
 #include "Semaphore.h"
+#include <mem/Pool.h>
 #include <assert.h>
 #include "config.h"
 
@@ -34,6 +35,16 @@ private:
 
 //-----------------------------------------------------------------------------
 
+/** Maximum number of thread exit hooks. */
+const int MAX_EXIT_HOOKS = 8;
+
+//-----------------------------------------------------------------------------
+
+static void		(*s_exitHooks[MAX_EXIT_HOOKS])() = {0};
+static int		s_exitHookCount = 0;
+
+//-----------------------------------------------------------------------------
+
 static void* runThread( void* arg )
 {
 	P(ThreadImpl) thread = reinterpret_cast<ThreadImpl*>(arg);
@@ -51,6 +62,13 @@ static void* runThread( void* arg )
 	thread->running = false;
 	thread->obj = 0;
 	thread = 0;
+
+	// release resources of the thread held by other libraries
+	for ( int i = 0 ; i < s_exitHookCount ; ++i )
+		s_exitHooks[i]();
+
+	// give memory cached by the thread back to other threads
+	mem_Pool_flush();
 	return 0;
 }
 
@@ -111,5 +129,14 @@ void Thread::sleep( long millis )
 	Thread_sleep( millis );
 }
 
+void Thread::addExitHook( void (*hook)() )
+{
+	assert( hook );
+	assert( s_exitHookCount < MAX_EXIT_HOOKS );
+
+	if ( s_exitHookCount < MAX_EXIT_HOOKS )
+		s_exitHooks[s_exitHookCount++] = hook;
+}
+
 
 } // lang
@@ -59,6 +59,14 @@ public:
 	 */
 	static void		sleep( long millis );
 
+	/**
+	 * Adds function which is called by every thread started
+	 * with start() before the thread exits. Lets libraries above lang
+	 * release resources of the exiting thread.
+	 * Not synchronized, so add hooks before starting threads.
+	 */
+	static void		addExitHook( void (*hook)() );
+
 private:
 	P(ThreadImpl) m_this;
 
@@ -0,0 +1,169 @@
+#include "Arena.h"
+#include <stddef.h>
+#include <string.h>
+#include <malloc.h>
+#include <assert.h>
+#include "config.h"
+
+//-----------------------------------------------------------------------------
+
+/* Block alignment. */
+#define ARENA_ALIGN			16
+
+/* Chunk header size, keeps chunk data aligned. */
+#define ARENA_HEADER_SIZE	32
+
+//-----------------------------------------------------------------------------
+
+typedef struct ArenaChunk
+{
+	struct ArenaChunk*	next;
+	char*				begin;
+	int					size;
+	int					used;
+} ArenaChunk_t;
+
+typedef struct Arena
+{
+	ArenaChunk_t*		chunks;
+	int					chunkSize;
+	int					bytesInUse;
+	int					blocksInUse;
+	int					bytesPeak;
+	int					bytesReserved;
+} Arena_t;
+
+//-----------------------------------------------------------------------------
+
+/** Allocates new chunk with at least n bytes of aligned data. */
+static ArenaChunk_t* createChunk( Arena_t* arena, int n )
+{
+	char*			mem		= NULL;
+	ArenaChunk_t*	chunk	= NULL;
+
+	assert( sizeof(ArenaChunk_t) <= ARENA_HEADER_SIZE );
+
+	mem = (char*)malloc( ARENA_HEADER_SIZE + n + ARENA_ALIGN );
+	if ( !mem )
+		return NULL;
+
+	chunk = (ArenaChunk_t*)mem;
+	chunk->next = NULL;
+	chunk->begin = (char*)( ((size_t)mem + ARENA_HEADER_SIZE + ARENA_ALIGN-1) & ~(size_t)(ARENA_ALIGN-1) );
+	chunk->size = n;
+	chunk->used = 0;
+	arena->bytesReserved += ARENA_HEADER_SIZE + n + ARENA_ALIGN;
+	return chunk;
+}
+
+/** Frees all chunks of the arena. */
+static void destroyChunks( Arena_t* arena )
+{
+	ArenaChunk_t* chunk = arena->chunks;
+	while ( chunk )
+	{
+		ArenaChunk_t* next = chunk->next;
+		free( chunk );
+		chunk = next;
+	}
+	arena->chunks = NULL;
+	arena->bytesReserved = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+MEM_API void* mem_Arena_create( int chunkSize )
+{
+	Arena_t* arena = NULL;
+
+	assert( chunkSize > 0 );
+
+	arena = (Arena_t*)malloc( sizeof(Arena_t) );
+	memset( arena, 0, sizeof(Arena_t) );
+	arena->chunkSize = chunkSize;
+	return arena;
+}
+
+MEM_API void mem_Arena_destroy( void* arena_ )
+{
+	Arena_t* arena = (Arena_t*)arena_;
+
+	if ( !arena )
+		return;
+
+	destroyChunks( arena );
+	free( arena );
+}
+
+MEM_API void* mem_Arena_allocate( void* arena_, int n )
+{
+	Arena_t*		arena	= (Arena_t*)arena_;
+	ArenaChunk_t*	chunk	= arena->chunks;
+	char*			block	= NULL;
+
+	assert( n >= 0 );
+	n = (n + ARENA_ALIGN-1) & ~(ARENA_ALIGN-1);
+
+	if ( !chunk || chunk->used + n > chunk->size )
+	{
+		chunk = createChunk( arena, n > arena->chunkSize ? n : arena->chunkSize );
+		if ( !chunk )
+			return NULL;
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+	}
+
+	block = chunk->begin + chunk->used;
+	chunk->used += n;
+
+	arena->bytesInUse += n;
+	arena->blocksInUse += 1;
+	if ( arena->bytesInUse > arena->bytesPeak )
+		arena->bytesPeak = arena->bytesInUse;
+	return block;
+}
+
+MEM_API void mem_Arena_reset( void* arena_ )
+{
+	Arena_t*	arena	= (Arena_t*)arena_;
+	int			size	= 0;
+
+	if ( arena->chunks && arena->chunks->next )
+	{
+		/* replace chunks with one which fits everything */
+		size = arena->bytesReserved;
+		destroyChunks( arena );
+		arena->chunks = createChunk( arena, size );
+	}
+	else if ( arena->chunks )
+	{
+		arena->chunks->used = 0;
+	}
+
+	arena->bytesInUse = 0;
+	arena->blocksInUse = 0;
+}
+
+MEM_API int mem_Arena_bytesInUse( void* arena_ )
+{
+	Arena_t* arena = (Arena_t*)arena_;
+	return arena->bytesInUse;
+}
+
+MEM_API int mem_Arena_blocksInUse( void* arena_ )
+{
+	Arena_t* arena = (Arena_t*)arena_;
+	return arena->blocksInUse;
+}
+
+MEM_API int mem_Arena_bytesPeak( void* arena_ )
+{
+	Arena_t* arena = (Arena_t*)arena_;
+	return arena->bytesPeak;
+}
+
+MEM_API int mem_Arena_bytesReserved( void* arena_ )
+{
+	Arena_t* arena = (Arena_t*)arena_;
+	return arena->bytesReserved;
+}
@@ -0,0 +1,69 @@
+#ifndef _MEM_ARENA_H
+#define _MEM_ARENA_H
+
+
+#ifdef MEM_EXPORTS
+	#ifdef __cplusplus
+	#define MEM_API extern "C" __declspec(dllexport)
+	#else
+	#define MEM_API __declspec(dllexport)
+	#endif
+#else
+	#ifdef __cplusplus
+	#define MEM_API extern "C" __declspec(dllimport)
+	#else
+	#define MEM_API __declspec(dllimport)
+	#endif
+#endif // MEM_EXPORTS
+
+
+/**
+ * Creates a linear allocator for short-lived (e.g. per-frame) memory.
+ * Blocks are allocated by incrementing a pointer in large heap chunks,
+ * individual blocks are never freed but all blocks are released at once
+ * by mem_Arena_reset. Arena is not thread safe, so
+ * each thread should use its own arena.
+ * @param chunkSize Minimum size of heap chunks allocated by the arena.
+ */
+MEM_API void*	mem_Arena_create( int chunkSize );
+
+/**
+ * Destroys the arena and frees all memory allocated from it.
+ */
+MEM_API void	mem_Arena_destroy( void* arena );
+
+/**
+ * Allocates 16-byte aligned n byte memory block from the arena.
+ * Block is valid until the arena is reset or destroyed.
+ */
+MEM_API void*	mem_Arena_allocate( void* arena, int n );
+
+/**
+ * Releases all blocks allocated from the arena.
+ * Heap memory is kept for reuse. If the blocks didn't fit to single
+ * heap chunk, the chunks are replaced with one big enough chunk.
+ */
+MEM_API void	mem_Arena_reset( void* arena );
+
+/**
+ * Returns number of bytes allocated from the arena since last reset.
+ */
+MEM_API int		mem_Arena_bytesInUse( void* arena );
+
+/**
+ * Returns number of blocks allocated from the arena since last reset.
+ */
+MEM_API int		mem_Arena_blocksInUse( void* arena );
+
+/**
+ * Returns maximum number of bytes in use between two resets.
+ */
+MEM_API int		mem_Arena_bytesPeak( void* arena );
+
+/**
+ * Returns number of bytes reserved by the arena from the heap.
+ */
+MEM_API int		mem_Arena_bytesReserved( void* arena );
+
+
+#endif // _MEM_ARENA_H
@@ -2,6 +2,7 @@
 #include "Group_t.h"
 #include "GroupItem_t.h"
 #include "testAndSet.h"
+#include "threadLocal.h"
 #include "error.h"
 #include <string.h>
 #include <malloc.h>
@@ -19,6 +20,20 @@
 
 #include "config.h"
 
+/*
+ * Release build blocks have no private header, only group statistics
+ * are updated (without locking) on allocation and free. Blocks don't reference
+ * their group so groups are never freed in release build.
+ */
+#ifdef NDEBUG
+#define BLOCK_OVERHEAD 0
+#else
+#define BLOCK_OVERHEAD BLOCK_HEADER_SIZE
+#endif
+
+/* Size of thread local group name lookup cache in release build. */
+#define GROUP_CACHE_SIZE 64
+
 //-----------------------------------------------------------------------------
 
 static long			s_spin		= 0;
@@ -27,6 +42,10 @@ static int			s_flags		= DEBUGMEM_LEAKCHECK;
 static int			s_blockID	= 1;
 static int			s_breakID	= -1;
 
+#ifdef NDEBUG
+static THREAD_LOCAL Group_t*	s_cache[GROUP_CACHE_SIZE];
+#endif
+
 //-----------------------------------------------------------------------------
 
 /** Increments group reference count. */
@@ -44,6 +63,7 @@ static void unref( Group_t* group )
 	assert( group->refs > 0 );
 
 	group->refs -= 1;
+#ifndef NDEBUG
 	if ( 0 == group->refs )
 	{
 		assert( !group->items );
@@ -60,6 +80,7 @@ static void unref( Group_t* group )
 
 		free( group );
 	}
+#endif
 }
 
 /** Computes hash code from the string. */
@@ -105,6 +126,9 @@ MEM_API void* mem_Group_create( const char* groupname, int groupid )
 	char* tmpstr = NULL;
 	Group_t* group = NULL;
 	int hash;
+#ifdef NDEBUG
+	Group_t** cached = NULL;
+#endif
 
 	/* remove everything before projects directory if found */
 	tmpstr = strstr(groupname,"\\projects\\");
@@ -118,6 +142,15 @@ MEM_API void* mem_Group_create( const char* groupname, int groupid )
 		groupname = groupname + strlen(groupname) - GROUP_MAX_NAME + 1;
 
 	assert( strlen(groupname) < GROUP_MAX_NAME );
+	hash = strhash(groupname);
+
+#ifdef NDEBUG
+	/* look up by name from the thread cache first, names of existing groups never change */
+	cached = &s_cache[ (unsigned)hash % GROUP_CACHE_SIZE ];
+	if ( *cached && (*cached)->hash == hash && !strcmp((*cached)->name,groupname) )
+		return *cached;
+#endif
+
 	while ( testAndSet(&s_spin,1) );
 
 	/* set default flags. */
@@ -125,7 +158,6 @@ MEM_API void* mem_Group_create( const char* groupname, int groupid )
 		refreshSystemFlags( s_flags );
 
 	/* find existing group */
-	hash = strhash(groupname);
 	group = s_groups;
 	for ( ; group ; group = group->next )
 	{
@@ -151,10 +183,16 @@ MEM_API void* mem_Group_create( const char* groupname, int groupid )
 		group->freedBlocks = Vector_create( sizeof(FreedBlock_t) );
 	}
 
-	/* reference group */
+	/* reference group (groups are never freed in release build) */
+#ifndef NDEBUG
 	ref( group );
+#endif
 
 	testAndSet(&s_spin,0);
+
+#ifdef NDEBUG
+	*cached = group;
+#endif
 	return group;
 }
 
@@ -165,9 +203,11 @@ MEM_API void mem_Group_release( void* group_ )
 	if ( !group )
 		return;
 
+#ifndef NDEBUG
 	while ( testAndSet(&s_spin,1) );
 	unref( group );
 	testAndSet(&s_spin,0);
+#endif
 }
 
 MEM_API void* mem_Group_copy( void* group_ )
@@ -177,12 +217,42 @@ MEM_API void* mem_Group_copy( void* group_ )
 	if ( !group )
 		return NULL;
 
+#ifndef NDEBUG
 	while ( testAndSet(&s_spin,1) );
 	ref( group );
 	testAndSet(&s_spin,0);
+#endif
 	return group;
 }
 
+#ifdef NDEBUG
+
+MEM_API void* mem_Group_allocate( void* group_, int n )
+{
+	Group_t* group = (Group_t*)group_;
+
+	assert( n >= 0 );
+	atomicAdd( &group->bytesInUse, n );
+	atomicAdd( &group->blocksInUse, 1 );
+	atomicAdd( &group->bytesTotal, n );
+	atomicAdd( &group->blocksTotal, 1 );
+	return malloc( n );
+}
+
+MEM_API void mem_Group_free( void* group_, void* p, int n )
+{
+	Group_t* group = (Group_t*)group_;
+
+	if ( !p )
+		return;
+
+	atomicAdd( &group->bytesInUse, -n );
+	atomicAdd( &group->blocksInUse, -1 );
+	free( p );
+}
+
+#else
+
 MEM_API void* mem_Group_allocate( void* group_, int n )
 {
 	Group_t*		group = (Group_t*)group_;
@@ -292,10 +362,12 @@ MEM_API void mem_Group_free( void* group_, void* p, int n )
 	testAndSet(&s_spin,0);
 }
 
+#endif // NDEBUG
+
 MEM_API int	mem_Group_bytesInUse( void* group_ )
 {
 	Group_t* group = (Group_t*)group_;
-	return group->bytesInUse + group->blocksInUse * BLOCK_HEADER_SIZE;
+	return group->bytesInUse + group->blocksInUse * BLOCK_OVERHEAD;
 }
 
 MEM_API int	mem_Group_blocksInUse( void* group_ )
@@ -307,7 +379,7 @@ MEM_API int	mem_Group_blocksInUse( void* group_ )
 MEM_API int	mem_Group_bytesTotal( void* group_ )
 {
 	Group_t* group = (Group_t*)group_;
-	return group->bytesTotal + group->blocksTotal * BLOCK_HEADER_SIZE;
+	return group->bytesTotal + group->blocksTotal * BLOCK_OVERHEAD;
 }
 
 MEM_API int	mem_Group_blocksTotal( void* group_ )
@@ -489,7 +561,7 @@ MEM_API int mem_printAllocatedBlocks()
 	for ( i = 0 ; i < groups ; ++i )
 	{
 		group = grouplist[i];
-		message( "Group (%5i blocks, %7i bytes): %s", group->blocksInUse, group->bytesInUse, group->name );
+		message( "Group (%5i blocks, %7i bytes): %s", (int)group->blocksInUse, (int)group->bytesInUse, group->name );
 	}
 
 	// print block info
@@ -500,7 +572,7 @@ MEM_API int mem_printAllocatedBlocks()
 	{
 		group = grouplist[i];
 		message( "" );
-		message( "Group (%5i blocks, %7i bytes): %s", group->blocksInUse, group->bytesInUse, group->name );
+		message( "Group (%5i blocks, %7i bytes): %s", (int)group->blocksInUse, (int)group->bytesInUse, group->name );
 		for ( item = group->items ; item ; item = item->next )
 		{
 			message( "Block (%7i bytes): id=%8i", item->size, item->id );
@@ -1,4 +1,7 @@
 #include <malloc.h>
+
+/* Group statistics are kept also in release build unless MEM_NOSTATS is defined. */
+#ifdef MEM_NOSTATS
 #define mem_Group_create( PARAM, PARAM2 ) 0; (PARAM); (PARAM2)
 #define mem_Group_release( PARAM ) (PARAM)
 #define mem_Group_copy( PARAM ) (PARAM)
@@ -10,11 +13,14 @@
 #define mem_Group_blocksInUse( PARAM ) -1
 #define mem_Group_bytesTotal( PARAM ) -1
 #define mem_Group_blocksTotal( PARAM ) -1
-#define mem_Group_findByName( PARAM ) 0; (PARAM)
 #define mem_Group_name( PARAM ) ((PARAM) ? "" : "")
-#define mem_Group_findByFreedBlock( PARAM ) (void*)((PARAM) ? 0 : 0)
 #define mem_bytesInUse() 0
 #define mem_blocksInUse() 0
+#endif // MEM_NOSTATS
+
+/* Debug checks are not available in release build. */
+#define mem_Group_findByName( PARAM ) 0; (PARAM)
+#define mem_Group_findByFreedBlock( PARAM ) (void*)((PARAM) ? 0 : 0)
 #define mem_setFlags( PARAM ) (PARAM)
 #define mem_flags() (0)
 #define mem_printAllocatedBlocks() (0)
@@ -0,0 +1,242 @@
+#include "Pool.h"
+#include "testAndSet.h"
+#include "threadLocal.h"
+#include <stddef.h>
+#include <malloc.h>
+#include <assert.h>
+#include "config.h"
+
+//-----------------------------------------------------------------------------
+
+/* Block size granularity and alignment. */
+#define POOL_ALIGN			16
+
+/* Largest pooled block size. */
+#define POOL_MAX_SIZE		512
+
+/* Number of size classes. */
+#define POOL_CLASSES		(POOL_MAX_SIZE/POOL_ALIGN)
+
+/* Size of heap memory chunks which are split to blocks. */
+#define POOL_CHUNK_SIZE		(16*1024)
+
+/* Approximate number of bytes moved between thread cache and shared pool at a time. */
+#define POOL_BATCH_BYTES	(4*1024)
+
+//-----------------------------------------------------------------------------
+
+typedef struct PoolBlock
+{
+	struct PoolBlock*	next;
+} PoolBlock_t;
+
+/* Shared free list of a size class. */
+typedef struct PoolClass
+{
+	long				spin;
+	PoolBlock_t*		free;
+	int					blocksInUse;
+	int					bytesReserved;
+} PoolClass_t;
+
+/* Thread cached free list of a size class. */
+typedef struct PoolCache
+{
+	PoolBlock_t*		free;
+	int					count;
+} PoolCache_t;
+
+//-----------------------------------------------------------------------------
+
+static PoolClass_t				s_classes[POOL_CLASSES];
+static THREAD_LOCAL PoolCache_t		s_cache[POOL_CLASSES];
+
+//-----------------------------------------------------------------------------
+
+/** Returns size class index of n byte block. */
+static int sizeClass( int n )
+{
+	return n > 0 ? (n-1) / POOL_ALIGN : 0;
+}
+
+/** Returns number of blocks moved between thread cache and shared pool at a time. */
+static int batchSize( int cls )
+{
+	int n = POOL_BATCH_BYTES / ((cls+1)*POOL_ALIGN);
+	if ( n > 64 )
+		n = 64;
+	return n;
+}
+
+/** Splits new heap chunk to the shared free list. Class must be locked. */
+static int grow( PoolClass_t* c, int size )
+{
+	char*	mem		= NULL;
+	char*	block	= NULL;
+	int		count	= 0;
+	int		i		= 0;
+
+	mem = (char*)malloc( POOL_CHUNK_SIZE + POOL_ALIGN );
+	if ( !mem )
+		return 0;
+
+	/* chunks are never returned to the heap */
+	block = (char*)( ((size_t)mem + POOL_ALIGN-1) & ~(size_t)(POOL_ALIGN-1) );
+	count = POOL_CHUNK_SIZE / size;
+	for ( i = count-1 ; i >= 0 ; --i )
+	{
+		PoolBlock_t* b = (PoolBlock_t*)( block + i*size );
+		b->next = c->free;
+		c->free = b;
+	}
+	c->bytesReserved += POOL_CHUNK_SIZE + POOL_ALIGN;
+	return count;
+}
+
+/** Moves a batch of blocks from the shared pool to the thread cache. */
+static void refill( int cls )
+{
+	PoolClass_t*	c		= &s_classes[cls];
+	PoolCache_t*	cache	= &s_cache[cls];
+	PoolBlock_t*	first	= NULL;
+	PoolBlock_t*	last	= NULL;
+	int				count	= 0;
+	int				batch	= batchSize( cls );
+
+	assert( !cache->free );
+	while ( testAndSet(&c->spin,1) );
+
+	if ( !c->free )
+		grow( c, (cls+1)*POOL_ALIGN );
+
+	first = last = c->free;
+	if ( first )
+	{
+		count = 1;
+		while ( count < batch && last->next )
+		{
+			last = last->next;
+			++count;
+		}
+		c->free = last->next;
+		last->next = NULL;
+		c->blocksInUse += count;
+	}
+
+	testAndSet(&c->spin,0);
+
+	cache->free = first;
+	cache->count = count;
+}
+
+/** Moves n blocks from the thread cache to the shared pool. */
+static void release( int cls, int n )
+{
+	PoolClass_t*	c		= &s_classes[cls];
+	PoolCache_t*	cache	= &s_cache[cls];
+	PoolBlock_t*	first	= cache->free;
+	PoolBlock_t*	last	= first;
+	int				count	= 1;
+
+	assert( n > 0 && n <= cache->count );
+	while ( count < n )
+	{
+		last = last->next;
+		++count;
+	}
+	cache->free = last->next;
+	cache->count -= count;
+
+	while ( testAndSet(&c->spin,1) );
+	last->next = c->free;
+	c->free = first;
+	c->blocksInUse -= count;
+	testAndSet(&c->spin,0);
+}
+
+//-----------------------------------------------------------------------------
+
+MEM_API void* mem_Pool_allocate( int n )
+{
+	PoolCache_t*	cache	= NULL;
+	PoolBlock_t*	b		= NULL;
+	int				cls		= 0;
+
+	assert( n >= 0 );
+	if ( n > POOL_MAX_SIZE )
+		return malloc( n );
+
+	cls = sizeClass( n );
+	cache = &s_cache[cls];
+	if ( !cache->free )
+	{
+		refill( cls );
+		if ( !cache->free )
+			return NULL;
+	}
+
+	b = cache->free;
+	cache->free = b->next;
+	cache->count -= 1;
+	return b;
+}
+
+MEM_API void mem_Pool_free( void* p, int n )
+{
+	PoolCache_t*	cache	= NULL;
+	PoolBlock_t*	b		= (PoolBlock_t*)p;
+	int				cls		= 0;
+	int				batch	= 0;
+
+	assert( n >= 0 );
+	if ( !p )
+		return;
+
+	if ( n > POOL_MAX_SIZE )
+	{
+		free( p );
+		return;
+	}
+
+	cls = sizeClass( n );
+	cache = &s_cache[cls];
+	b->next = cache->free;
+	cache->free = b;
+	cache->count += 1;
+
+	/* keep cache size bounded if thread frees more than it allocates */
+	batch = batchSize( cls );
+	if ( cache->count >= batch*2 )
+		release( cls, batch );
+}
+
+MEM_API void mem_Pool_flush()
+{
+	int cls;
+
+	for ( cls = 0 ; cls < POOL_CLASSES ; ++cls )
+	{
+		if ( s_cache[cls].count > 0 )
+			release( cls, s_cache[cls].count );
+	}
+}
+
+MEM_API int mem_Pool_blocksInUse()
+{
+	int count = 0;
+	int cls;
+
+	for ( cls = 0 ; cls < POOL_CLASSES ; ++cls )
+		count += s_classes[cls].blocksInUse;
+	return count;
+}
+
+MEM_API int mem_Pool_bytesReserved()
+{
+	int count = 0;
+	int cls;
+
+	for ( cls = 0 ; cls < POOL_CLASSES ; ++cls )
+		count += s_classes[cls].bytesReserved;
+	return count;
+}
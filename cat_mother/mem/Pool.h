@@ -0,0 +1,57 @@
+#ifndef _MEM_POOL_H
+#define _MEM_POOL_H
+
+
+#ifdef MEM_EXPORTS
+	#ifdef __cplusplus
+	#define MEM_API extern "C" __declspec(dllexport)
+	#else
+	#define MEM_API __declspec(dllexport)
+	#endif
+#else
+	#ifdef __cplusplus
+	#define MEM_API extern "C" __declspec(dllimport)
+	#else
+	#define MEM_API __declspec(dllimport)
+	#endif
+#endif // MEM_EXPORTS
+
+
+/**
+ * Allocates n byte memory block from size class pools.
+ * Blocks up to 512 bytes are 16-byte aligned and taken from a cache
+ * of the calling thread, so the allocation doesn't usually need locking.
+ * Larger blocks are allocated from the heap with malloc and have
+ * only the alignment guaranteed by malloc.
+ * Block must be freed with mem_Pool_free using the same size.
+ * Pools are not tracked by memory groups, so this is meant
+ * for release build allocations.
+ */
+MEM_API void*	mem_Pool_allocate( int n );
+
+/**
+ * Frees n byte memory block allocated with mem_Pool_allocate.
+ * Block can be freed by other thread than the one which allocated it.
+ */
+MEM_API void	mem_Pool_free( void* p, int n );
+
+/**
+ * Returns blocks cached by the calling thread to the shared pools.
+ * Should be called before a thread which has used the pools exits,
+ * otherwise the cached blocks are not reused.
+ */
+MEM_API void	mem_Pool_flush();
+
+/**
+ * Returns number of blocks handed out to threads,
+ * including blocks in thread caches.
+ */
+MEM_API int		mem_Pool_blocksInUse();
+
+/**
+ * Returns number of bytes reserved by the pools from the heap.
+ */
+MEM_API int		mem_Pool_bytesReserved();
+
+
+#endif // _MEM_POOL_H
@@ -14,9 +14,9 @@ typedef struct Group
 	int					hash;
 	int					id;
 	char				name[GROUP_MAX_NAME+1];
-	int					bytesInUse;
-	int					blocksInUse;
-	int					bytesTotal;
-	int					blocksTotal;
+	long				bytesInUse;
+	long				blocksInUse;
+	long				bytesTotal;
+	long				blocksTotal;
 	Vector_t*			freedBlocks;
 } Group_t;
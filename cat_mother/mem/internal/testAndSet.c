@@ -28,3 +28,24 @@ long testAndSet( long* value, long newValue )
 
 	#endif
 }
+
+long atomicAdd( long* value, long delta )
+{
+	#ifdef WIN32
+
+		return InterlockedExchangeAdd( value, delta );
+
+	#elif defined(__GNUC__)
+
+		return __sync_fetch_and_add( value, delta );
+
+	#else
+
+		pthread_mutex_lock( &s_refCountMutex );
+		long v = *value;
+		*value = v + delta;
+		pthread_mutex_unlock( &s_refCountMutex );
+		return v;
+
+	#endif
+}
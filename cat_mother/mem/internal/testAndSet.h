@@ -3,3 +3,8 @@
  * @author Jani Kajala (jani.kajala@helsinki.fi)
  */
 long testAndSet( long* value, long newValue );
+
+/** 
+ * Atomic addition. Returns old value. 
+ */
+long atomicAdd( long* value, long delta );
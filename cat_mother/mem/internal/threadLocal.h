@@ -0,0 +1,6 @@
+/** Thread local storage class specifier. */
+#ifdef _MSC_VER
+	#define THREAD_LOCAL __declspec(thread)
+#else
+	#define THREAD_LOCAL __thread
+#endif
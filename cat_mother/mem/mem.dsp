@@ -104,10 +104,18 @@ PostBuild_Cmds=copy $(TargetPath) ..\DLL
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=.\Arena.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\Group.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\Pool.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\raw.c
 # End Source File
 # End Group
@@ -116,6 +124,10 @@ SOURCE=.\raw.c
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=.\Arena.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Group.h
 # End Source File
 # Begin Source File
@@ -124,6 +136,10 @@ SOURCE=.\Group.inl
 # End Source File
 # Begin Source File
 
+SOURCE=.\Pool.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\raw.h
 # End Source File
 # Begin Source File
@@ -172,6 +188,10 @@ SOURCE=.\internal\testAndSet.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\internal\threadLocal.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\internal\Vector.c
 # End Source File
 # Begin Source File
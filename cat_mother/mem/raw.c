@@ -2,10 +2,27 @@
 #include "Group.h"
 #include "Group_t.h"
 #include "GroupItem_t.h"
+#include <malloc.h>
 #include "config.h"
 
 //-----------------------------------------------------------------------------
 
+#ifdef NDEBUG
+
+/* release build blocks have no header so group is not known by mem_free */
+MEM_API void* mem_allocate( int n, const char* file, int line )
+{
+	file = file; line = line;
+	return malloc( n );
+}
+
+MEM_API void mem_free( void* p )
+{
+	free( p );
+}
+
+#else
+
 MEM_API void* mem_allocate( int n, const char* file, int line )
 {
 	void* group = mem_Group_create( file, line );
@@ -22,3 +39,5 @@ MEM_API void mem_free( void* p )
 		mem_Group_free( item->group, p, item->size );
 	}
 }
+
+#endif // NDEBUG
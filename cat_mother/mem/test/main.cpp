@@ -1,8 +1,12 @@
 #include "Int.h"
 #include <mem/raw.h>
+#include <mem/Pool.h>
+#include <mem/Arena.h>
 #include <util/Allocator.h>
 #include <assert.h>
 #include <stdio.h>
+#include <stddef.h>
+#include <string.h>
 
 #if defined(_DEBUG) && defined(WIN32) && defined(_MSC_VER)
 	#define WIN32_LEAN_AND_MEAN
@@ -18,6 +22,71 @@ using namespace util;
 
 //-----------------------------------------------------------------------------
 
+static void testPool()
+{
+	void* small = mem_Pool_allocate( 24 );
+	void* small2 = mem_Pool_allocate( 24 );
+	void* big = mem_Pool_allocate( 4000 );
+	assert( small != small2 );
+	assert( 0 == ((size_t)small & 15) && 0 == ((size_t)small2 & 15) );
+	assert( mem_Pool_blocksInUse() > 0 );
+	memset( small, 0, 24 );
+	memset( big, 0, 4000 );
+
+	mem_Pool_free( small, 24 );
+	mem_Pool_free( small2, 24 );
+	mem_Pool_free( big, 4000 );
+
+	// freed blocks are reused from thread cache
+	void* small3 = mem_Pool_allocate( 20 );
+	assert( small3 == small || small3 == small2 );
+	mem_Pool_free( small3, 20 );
+
+	// lots of blocks go through shared pools
+	void* blocks[1000];
+	int i;
+	for ( i = 0 ; i < 1000 ; ++i )
+		blocks[i] = mem_Pool_allocate( i % 600 );
+	for ( i = 0 ; i < 1000 ; ++i )
+		mem_Pool_free( blocks[i], i % 600 );
+
+	mem_Pool_flush();
+	assert( mem_Pool_blocksInUse() == 0 );
+	printf( "Pools: %i bytes reserved\n", mem_Pool_bytesReserved() );
+}
+
+static void testArena()
+{
+	void* arena = mem_Arena_create( 256 );
+	Allocator<Int> scratch( arena, "Scratch" );
+	assert( scratch.arena() == arena );
+
+	// two frames, the first one needs more than one chunk
+	for ( int frame = 0 ; frame < 2 ; ++frame )
+	{
+		Int* a1 = scratch.allocate( 10 );
+		Int* a2 = scratch.allocate( 100 );
+		assert( 0 == ((size_t)a1 & 15) && 0 == ((size_t)a2 & 15) );
+		assert( mem_Arena_blocksInUse(arena) == 2 );
+		assert( mem_Arena_bytesInUse(arena) >= (int)sizeof(Int)*110 );
+		a1[9] = 1;
+		a2[99] = 2;
+		scratch.deallocate( a1, 10 );
+		scratch.deallocate( a2, 100 );
+		assert( scratch.blocksInUse() == 0 );
+
+		int reserved = mem_Arena_bytesReserved( arena );
+		mem_Arena_reset( arena );
+		assert( mem_Arena_bytesInUse(arena) == 0 );
+		assert( frame == 0 || mem_Arena_bytesReserved(arena) == reserved );
+	}
+	assert( mem_Arena_bytesPeak(arena) >= (int)sizeof(Int)*110 );
+
+	mem_Arena_destroy( arena );
+}
+
+//-----------------------------------------------------------------------------
+
 int main()
 {
 	// enabled exit-time leak check
@@ -58,6 +127,9 @@ int main()
 	assert( blocks == 0 );
 	bytes = alloc.bytesInUse();
 	assert( bytes == 0 );
+
+	testPool();
+	testArena();
 	printf( "ok\n" );
 	return 0;
 }
@@ -0,0 +1,1160 @@
+#include "DXTCompressor.h"
+#include "Surface.h"
+#include "SurfaceUtil.h"
+#include "SurfaceFormat.h"
+#include <lang/Thread.h>
+#include <util/Vector.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+#include "config.h"
+#ifdef PIX_SSE2
+#include <emmintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+
+/** Width and height of a tile in 4x4 pixel blocks. */
+#define TILE_BLOCKS 16
+
+/** Minimum number of 4x4 pixel blocks to compress per thread. */
+#define MIN_BLOCKS_PER_THREAD 1024
+
+//-----------------------------------------------------------------------------
+
+using namespace lang;
+using namespace util;
+
+//-----------------------------------------------------------------------------
+
+namespace pix
+{
+
+
+/** Pixels of a 4x4 block. Colors are stored as separate channel arrays. */
+struct BlockPixels
+{
+	float		r[16];
+	float		g[16];
+	float		b[16];
+	/** 0 for transparent DXT1 pixels, 1 otherwise. */
+	float		weight[16];
+	int			a[16];
+	bool		transparent;
+};
+
+/** Colors of a DXT color block as decoded by SurfaceUtil::getPixel. */
+struct Palette
+{
+	float		r[4];
+	float		g[4];
+	float		b[4];
+	/** 3 if the block uses 3-color mode, 4 otherwise. */
+	int			count;
+};
+
+/** Compressed DXT color block. */
+struct ColorBlock
+{
+	uint16_t	col0;
+	uint16_t	col1;
+	uint8_t		rows[4];
+};
+
+/** Compression of a surface to DXT blocks. */
+struct CompressJob
+{
+	const uint8_t*				src;
+	int							srcPitch;
+	int							width;
+	int							height;
+	uint8_t*					dst;
+	int							dstPitch;
+	SurfaceFormat::SurfaceFormatType	format;
+	DXTCompressor::Quality		quality;
+	int							blockBytes;
+	int							blocksX;
+	int							blocksY;
+	int							tilesX;
+	int							tiles;
+};
+
+//-----------------------------------------------------------------------------
+
+/** Returns 5-bit value in range [0,255] like SurfaceUtil decodes it. */
+static inline int expand5( int c )
+{
+	return c * 255 / 31;
+}
+
+/** Returns 6-bit value in range [0,255] like SurfaceUtil decodes it. */
+static inline int expand6( int c )
+{
+	return c * 255 / 63;
+}
+
+/** Returns 5-bit value which decodes closest to v in range [0,255]. */
+static inline int quantize5( float v )
+{
+	int c = (int)( v * (31.f/255.f) );
+	if ( c < 0 )
+		c = 0;
+	if ( c > 30 )
+		c = 30;
+	return fabsf(expand5(c+1)-v) < fabsf(expand5(c)-v) ? c+1 : c;
+}
+
+/** Returns 6-bit value which decodes closest to v in range [0,255]. */
+static inline int quantize6( float v )
+{
+	int c = (int)( v * (63.f/255.f) );
+	if ( c < 0 )
+		c = 0;
+	if ( c > 62 )
+		c = 62;
+	return fabsf(expand6(c+1)-v) < fabsf(expand6(c)-v) ? c+1 : c;
+}
+
+/** Returns v in range [0,255] rounded to nearest value representable with maxValue+1 levels. */
+static inline float snap( float v, int maxValue )
+{
+	int c = (int)( v * ((float)maxValue/255.f) + .5f );
+	if ( c < 0 )
+		c = 0;
+	if ( c > maxValue )
+		c = maxValue;
+	return (float)( c * 255 / maxValue );
+}
+
+/** Returns R5G6B5 color which decodes closest to the color. */
+static inline uint16_t quantize( float r, float g, float b )
+{
+	return (uint16_t)( (quantize5(r)<<11) + (quantize6(g)<<5) + quantize5(b) );
+}
+
+//-----------------------------------------------------------------------------
+
+/** Best endpoints of a 4-color block for single channel value. */
+struct SingleColorFit
+{
+	uint8_t		c0;
+	uint8_t		c1;
+};
+
+/** Endpoint tables for blocks of single color, indexed by channel value. */
+class SingleColorTables
+{
+public:
+	SingleColorFit	fit5[256];
+	SingleColorFit	fit6[256];
+
+	SingleColorTables()
+	{
+		init( fit5, 31 );
+		init( fit6, 63 );
+	}
+
+private:
+	/** Finds endpoints which give closest 2/3 interpolated value for each channel value. */
+	static void init( SingleColorFit* fit, int maxValue )
+	{
+		for ( int v = 0 ; v < 256 ; ++v )
+		{
+			int best = 1000;
+			for ( int c0 = 0 ; c0 <= maxValue ; ++c0 )
+			{
+				for ( int c1 = 0 ; c1 <= maxValue ; ++c1 )
+				{
+					int e0 = c0 * 255 / maxValue;
+					int e1 = c1 * 255 / maxValue;
+					int err = (2*e0 + e1 + 1)/3 - v;
+					if ( err < 0 )
+						err = -err;
+					if ( err < best )
+					{
+						best = err;
+						fit[v].c0 = (uint8_t)c0;
+						fit[v].c1 = (uint8_t)c1;
+					}
+				}
+			}
+		}
+	}
+};
+
+static const SingleColorTables s_singleColor;
+
+//-----------------------------------------------------------------------------
+
+/** Decodes block colors like SurfaceUtil::getPixel. */
+static void makePalette( uint16_t col0, uint16_t col1, Palette& pal )
+{
+	int r0 = expand5( col0>>11 );
+	int g0 = expand6( (col0>>5)&0x3F );
+	int b0 = expand5( col0&0x1F );
+	int r1 = expand5( col1>>11 );
+	int g1 = expand6( (col1>>5)&0x3F );
+	int b1 = expand5( col1&0x1F );
+
+	pal.r[0] = (float)r0; pal.g[0] = (float)g0; pal.b[0] = (float)b0;
+	pal.r[1] = (float)r1; pal.g[1] = (float)g1; pal.b[1] = (float)b1;
+
+	if ( col0 > col1 )
+	{
+		pal.r[2] = (float)( (2*r0 + r1 + 1)/3 );
+		pal.g[2] = (float)( (2*g0 + g1 + 1)/3 );
+		pal.b[2] = (float)( (2*b0 + b1 + 1)/3 );
+		pal.r[3] = (float)( (r0 + 2*r1 + 1)/3 );
+		pal.g[3] = (float)( (g0 + 2*g1 + 1)/3 );
+		pal.b[3] = (float)( (b0 + 2*b1 + 1)/3 );
+		pal.count = 4;
+	}
+	else
+	{
+		pal.r[2] = (float)( (r0 + r1)/2 );
+		pal.g[2] = (float)( (g0 + g1)/2 );
+		pal.b[2] = (float)( (b0 + b1)/2 );
+		pal.r[3] = pal.g[3] = pal.b[3] = 0.f;
+		pal.count = 3;
+	}
+}
+
+#ifdef PIX_SSE2
+
+/** Returns sum of the 4 elements. */
+static inline float sum4( __m128 v )
+{
+	float f[4];
+	_mm_storeu_ps( f, v );
+	return f[0] + f[1] + f[2] + f[3];
+}
+
+/**
+ * Selects closest palette color for each pixel, 4 pixels at a time.
+ * @return Sum of squared errors of non-transparent pixels.
+ */
+static float fitIndices( const BlockPixels& px, const Palette& pal, uint8_t* indices )
+{
+	__m128 sum = _mm_setzero_ps();
+	for ( int i = 0 ; i < 16 ; i += 4 )
+	{
+		__m128 r = _mm_loadu_ps( px.r+i );
+		__m128 g = _mm_loadu_ps( px.g+i );
+		__m128 b = _mm_loadu_ps( px.b+i );
+		__m128 best = _mm_set1_ps( 1e30f );
+		__m128 bestIndex = _mm_setzero_ps();
+
+		for ( int k = 0 ; k < pal.count ; ++k )
+		{
+			__m128 dr = _mm_sub_ps( r, _mm_set1_ps(pal.r[k]) );
+			__m128 dg = _mm_sub_ps( g, _mm_set1_ps(pal.g[k]) );
+			__m128 db = _mm_sub_ps( b, _mm_set1_ps(pal.b[k]) );
+			__m128 d = _mm_add_ps( _mm_add_ps(_mm_mul_ps(dr,dr), _mm_mul_ps(dg,dg)), _mm_mul_ps(db,db) );
+			__m128 less = _mm_cmplt_ps( d, best );
+			best = _mm_min_ps( d, best );
+			bestIndex = _mm_or_ps( _mm_andnot_ps(less,bestIndex), _mm_and_ps(less,_mm_set1_ps((float)k)) );
+		}
+
+		sum = _mm_add_ps( sum, _mm_mul_ps(best, _mm_loadu_ps(px.weight+i)) );
+
+		int index[4];
+		_mm_storeu_si128( reinterpret_cast<__m128i*>(index), _mm_cvttps_epi32(bestIndex) );
+		for ( int j = 0 ; j < 4 ; ++j )
+			indices[i+j] = (uint8_t)index[j];
+	}
+
+	return sum4( sum );
+}
+
+#else
+
+/**
+ * Selects closest palette color for each pixel.
+ * @return Sum of squared errors of non-transparent pixels.
+ */
+static float fitIndices( const BlockPixels& px, const Palette& pal, uint8_t* indices )
+{
+	float sum = 0.f;
+	for ( int i = 0 ; i < 16 ; ++i )
+	{
+		float best = 1e30f;
+		int bestIndex = 0;
+		for ( int k = 0 ; k < pal.count ; ++k )
+		{
+			float dr = px.r[i] - pal.r[k];
+			float dg = px.g[i] - pal.g[k];
+			float db = px.b[i] - pal.b[k];
+			float d = dr*dr + dg*dg + db*db;
+			if ( d < best )
+			{
+				best = d;
+				bestIndex = k;
+			}
+		}
+		sum += best * px.weight[i];
+		indices[i] = (uint8_t)bestIndex;
+	}
+	return sum;
+}
+
+#endif // PIX_SSE2
+
+/**
+ * Encodes color block with specified endpoints.
+ * Endpoints are ordered to select 3-color mode for blocks with transparent pixels
+ * and 4-color mode otherwise.
+ * @return Sum of squared errors of non-transparent pixels.
+ */
+static float encodeColors( const BlockPixels& px, uint16_t col0, uint16_t col1, ColorBlock& out )
+{
+	if ( px.transparent ? col0 > col1 : col0 < col1 )
+	{
+		uint16_t tmp = col0;
+		col0 = col1;
+		col1 = tmp;
+	}
+
+	Palette pal;
+	makePalette( col0, col1, pal );
+
+	uint8_t indices[16];
+	float err = fitIndices( px, pal, indices );
+
+	out.col0 = col0;
+	out.col1 = col1;
+	for ( int j = 0 ; j < 4 ; ++j )
+	{
+		uint8_t row = 0;
+		for ( int i = 0 ; i < 4 ; ++i )
+		{
+			int index = indices[j*4+i];
+			if ( px.weight[j*4+i] == 0.f )
+				index = 3;
+			row |= (uint8_t)( index << (i*2) );
+		}
+		out.rows[j] = row;
+	}
+	return err;
+}
+
+/** Computes mean and principal axis of non-transparent block colors. */
+static void computeAxis( const BlockPixels& px, float* mean, float* axis )
+{
+	float n = 0.f;
+	float cov[6];
+	int i;
+
+#ifdef PIX_SSE2
+	__m128 sumR = _mm_setzero_ps();
+	__m128 sumG = _mm_setzero_ps();
+	__m128 sumB = _mm_setzero_ps();
+	__m128 sumW = _mm_setzero_ps();
+	for ( i = 0 ; i < 16 ; i += 4 )
+	{
+		__m128 w = _mm_loadu_ps( px.weight+i );
+		sumR = _mm_add_ps( sumR, _mm_mul_ps(_mm_loadu_ps(px.r+i),w) );
+		sumG = _mm_add_ps( sumG, _mm_mul_ps(_mm_loadu_ps(px.g+i),w) );
+		sumB = _mm_add_ps( sumB, _mm_mul_ps(_mm_loadu_ps(px.b+i),w) );
+		sumW = _mm_add_ps( sumW, w );
+	}
+	n = sum4( sumW );
+	float invN = n > 0.f ? 1.f/n : 0.f;
+	mean[0] = sum4( sumR ) * invN;
+	mean[1] = sum4( sumG ) * invN;
+	mean[2] = sum4( sumB ) * invN;
+
+	// covariance matrix (rr,rg,rb,gg,gb,bb)
+	__m128 meanR = _mm_set1_ps( mean[0] );
+	__m128 meanG = _mm_set1_ps( mean[1] );
+	__m128 meanB = _mm_set1_ps( mean[2] );
+	__m128 c[6];
+	int k;
+	for ( k = 0 ; k < 6 ; ++k )
+		c[k] = _mm_setzero_ps();
+	for ( i = 0 ; i < 16 ; i += 4 )
+	{
+		__m128 w = _mm_loadu_ps( px.weight+i );
+		__m128 r = _mm_mul_ps( _mm_sub_ps(_mm_loadu_ps(px.r+i),meanR), w );
+		__m128 g = _mm_mul_ps( _mm_sub_ps(_mm_loadu_ps(px.g+i),meanG), w );
+		__m128 b = _mm_mul_ps( _mm_sub_ps(_mm_loadu_ps(px.b+i),meanB), w );
+		c[0] = _mm_add_ps( c[0], _mm_mul_ps(r,r) );
+		c[1] = _mm_add_ps( c[1], _mm_mul_ps(r,g) );
+		c[2] = _mm_add_ps( c[2], _mm_mul_ps(r,b) );
+		c[3] = _mm_add_ps( c[3], _mm_mul_ps(g,g) );
+		c[4] = _mm_add_ps( c[4], _mm_mul_ps(g,b) );
+		c[5] = _mm_add_ps( c[5], _mm_mul_ps(b,b) );
+	}
+	for ( k = 0 ; k < 6 ; ++k )
+		cov[k] = sum4( c[k] );
+
+#else
+	mean[0] = mean[1] = mean[2] = 0.f;
+	for ( i = 0 ; i < 16 ; ++i )
+	{
+		mean[0] += px.r[i] * px.weight[i];
+		mean[1] += px.g[i] * px.weight[i];
+		mean[2] += px.b[i] * px.weight[i];
+		n += px.weight[i];
+	}
+	if ( n > 0.f )
+	{
+		mean[0] /= n;
+		mean[1] /= n;
+		mean[2] /= n;
+	}
+
+	// covariance matrix (rr,rg,rb,gg,gb,bb)
+	for ( i = 0 ; i < 6 ; ++i )
+		cov[i] = 0.f;
+	for ( i = 0 ; i < 16 ; ++i )
+	{
+		float r = (px.r[i] - mean[0]) * px.weight[i];
+		float g = (px.g[i] - mean[1]) * px.weight[i];
+		float b = (px.b[i] - mean[2]) * px.weight[i];
+		cov[0] += r*r;
+		cov[1] += r*g;
+		cov[2] += r*b;
+		cov[3] += g*g;
+		cov[4] += g*b;
+		cov[5] += b*b;
+	}
+#endif // PIX_SSE2
+
+	// dominant eigenvector by power iteration, starting from (1,1,1).
+	// Colors varying only orthogonal to it (e.g. red/green) would give
+	// zero axis, so then start from the row with the largest variance
+	float v[3] = {1.f, 1.f, 1.f};
+	float sx = cov[0] + cov[1] + cov[2];
+	float sy = cov[1] + cov[3] + cov[4];
+	float sz = cov[2] + cov[4] + cov[5];
+	float diag = cov[0];
+	if ( cov[3] > diag )
+		diag = cov[3];
+	if ( cov[5] > diag )
+		diag = cov[5];
+	if ( sx*sx + sy*sy + sz*sz < diag*diag )
+	{
+		if ( cov[0] == diag )
+		{
+			v[0] = cov[0];
+			v[1] = cov[1];
+			v[2] = cov[2];
+		}
+		else if ( cov[3] == diag )
+		{
+			v[0] = cov[1];
+			v[1] = cov[3];
+			v[2] = cov[4];
+		}
+		else
+		{
+			v[0] = cov[2];
+			v[1] = cov[4];
+			v[2] = cov[5];
+		}
+	}
+	for ( int iter = 0 ; iter < 8 ; ++iter )
+	{
+		float x = cov[0]*v[0] + cov[1]*v[1] + cov[2]*v[2];
+		float y = cov[1]*v[0] + cov[3]*v[1] + cov[4]*v[2];
+		float z = cov[2]*v[0] + cov[4]*v[1] + cov[5]*v[2];
+		float m = fabsf(x);
+		if ( fabsf(y) > m )
+			m = fabsf(y);
+		if ( fabsf(z) > m )
+			m = fabsf(z);
+		if ( m <= 0.f )
+		{
+			v[0] = v[1] = v[2] = 0.f;
+			break;
+		}
+		v[0] = x / m;
+		v[1] = y / m;
+		v[2] = z / m;
+	}
+	axis[0] = v[0];
+	axis[1] = v[1];
+	axis[2] = v[2];
+}
+
+/** Selects endpoints from non-transparent pixels at the ends of the principal axis. */
+static void rangeFit( const BlockPixels& px, const float* axis, uint16_t& col0, uint16_t& col1 )
+{
+	int minIndex = -1;
+	int maxIndex = -1;
+	float minDot = 0.f;
+	float maxDot = 0.f;
+	for ( int i = 0 ; i < 16 ; ++i )
+	{
+		if ( px.weight[i] == 0.f )
+			continue;
+
+		float d = px.r[i]*axis[0] + px.g[i]*axis[1] + px.b[i]*axis[2];
+		if ( minIndex < 0 || d < minDot )
+		{
+			minDot = d;
+			minIndex = i;
+		}
+		if ( maxIndex < 0 || d > maxDot )
+		{
+			maxDot = d;
+			maxIndex = i;
+		}
+	}
+
+	if ( minIndex < 0 )
+	{
+		col0 = col1 = 0;
+		return;
+	}
+	col0 = quantize( px.r[maxIndex], px.g[maxIndex], px.b[maxIndex] );
+	col1 = quantize( px.r[minIndex], px.g[minIndex], px.b[minIndex] );
+}
+
+/**
+ * Finds endpoints which minimize error when pixels ordered along the principal
+ * axis are split to four consecutive clusters, one for each palette color.
+ * @return false if the pixels could not be split.
+ */
+static bool clusterFit( const BlockPixels& px, const float* axis, uint16_t& col0, uint16_t& col1 )
+{
+	// order pixels along the axis
+	int order[16];
+	float dots[16];
+	int n = 0;
+	int i;
+	for ( i = 0 ; i < 16 ; ++i )
+	{
+		if ( px.weight[i] == 0.f )
+			continue;
+
+		float d = px.r[i]*axis[0] + px.g[i]*axis[1] + px.b[i]*axis[2];
+		int k = n++;
+		for ( ; k > 0 && dots[k-1] > d ; --k )
+		{
+			dots[k] = dots[k-1];
+			order[k] = order[k-1];
+		}
+		dots[k] = d;
+		order[k] = i;
+	}
+	if ( n < 2 )
+		return false;
+
+	// prefix sums of ordered colors, padded for 4-wide loads
+	float sum[3][20];
+	for ( int k = 0 ; k < 3 ; ++k )
+	{
+		const float* c = ( k == 0 ? px.r : (k == 1 ? px.g : px.b) );
+		sum[k][0] = 0.f;
+		for ( i = 0 ; i < n ; ++i )
+			sum[k][i+1] = sum[k][i] + c[order[i]];
+		for ( i = n+1 ; i < 20 ; ++i )
+			sum[k][i] = sum[k][n];
+	}
+
+	// pixels [0,c0) use color 0, [c0,c1) color 2, [c1,c2) color 3 and [c2,n) color 1,
+	// endpoints solved by least squares and snapped to representable values
+	float bestError = 1e30f;
+	float bestA[3];
+	float bestB[3];
+	for ( int c0 = 0 ; c0 <= n ; ++c0 )
+	{
+		for ( int c1 = c0 ; c1 <= n ; ++c1 )
+		{
+			const int n2 = c1 - c0;
+
+#ifdef PIX_SSE2
+			// 4 splits at a time
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps( 1.f );
+			const __m128 lane = _mm_set_ps( 3.f, 2.f, 1.f, 0.f );
+			const __m128 maxValue[3] = {_mm_set1_ps(31.f), _mm_set1_ps(63.f), _mm_set1_ps(31.f)};
+			const __m128 toGrid[3] = {_mm_set1_ps(31.f/255.f), _mm_set1_ps(63.f/255.f), _mm_set1_ps(31.f/255.f)};
+			const __m128 fromGrid[3] = {_mm_set1_ps(255.f/31.f), _mm_set1_ps(255.f/63.f), _mm_set1_ps(255.f/31.f)};
+
+			for ( int c2 = c1 ; c2 <= n ; c2 += 4 )
+			{
+				__m128 split = _mm_add_ps( _mm_set1_ps((float)c2), lane );
+				__m128 n3 = _mm_sub_ps( split, _mm_set1_ps((float)c1) );
+				__m128 aa = _mm_add_ps( _mm_set1_ps((float)c0 + (float)n2*(4.f/9.f)), _mm_mul_ps(n3,_mm_set1_ps(1.f/9.f)) );
+				__m128 bb = _mm_add_ps( _mm_sub_ps(_mm_set1_ps((float)n + (float)n2*(1.f/9.f)), split), _mm_mul_ps(n3,_mm_set1_ps(4.f/9.f)) );
+				__m128 ab = _mm_mul_ps( _mm_add_ps(_mm_set1_ps((float)n2),n3), _mm_set1_ps(2.f/9.f) );
+				__m128 det = _mm_sub_ps( _mm_mul_ps(aa,bb), _mm_mul_ps(ab,ab) );
+				__m128 valid = _mm_and_ps( _mm_cmple_ps(split,_mm_set1_ps((float)n)), _mm_cmpgt_ps(det,_mm_set1_ps(1e-3f)) );
+				__m128 invDet = _mm_div_ps( one, _mm_or_ps(_mm_and_ps(valid,det), _mm_andnot_ps(valid,one)) );
+				__m128 err = zero;
+				float a[3][4];
+				float b[3][4];
+
+				for ( int k = 0 ; k < 3 ; ++k )
+				{
+					__m128 x = _mm_mul_ps( _mm_add_ps(_mm_set1_ps(sum[k][c0]+sum[k][c1]), _mm_loadu_ps(sum[k]+c2)), _mm_set1_ps(1.f/3.f) );
+					__m128 y = _mm_sub_ps( _mm_set1_ps(sum[k][n]), x );
+					__m128 ak = _mm_mul_ps( _mm_sub_ps(_mm_mul_ps(x,bb), _mm_mul_ps(y,ab)), invDet );
+					__m128 bk = _mm_mul_ps( _mm_sub_ps(_mm_mul_ps(y,aa), _mm_mul_ps(x,ab)), invDet );
+
+					// snap to grid, decoded value is c*255/maxValue rounded down
+					ak = _mm_min_ps( _mm_max_ps(_mm_mul_ps(ak,toGrid[k]), zero), maxValue[k] );
+					bk = _mm_min_ps( _mm_max_ps(_mm_mul_ps(bk,toGrid[k]), zero), maxValue[k] );
+					ak = _mm_cvtepi32_ps( _mm_cvttps_epi32(_mm_add_ps(ak,_mm_set1_ps(.5f))) );
+					bk = _mm_cvtepi32_ps( _mm_cvttps_epi32(_mm_add_ps(bk,_mm_set1_ps(.5f))) );
+					ak = _mm_cvtepi32_ps( _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(ak,fromGrid[k]),_mm_set1_ps(1e-3f))) );
+					bk = _mm_cvtepi32_ps( _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(bk,fromGrid[k]),_mm_set1_ps(1e-3f))) );
+
+					// error relative to sum of squared colors
+					__m128 e = _mm_add_ps( _mm_mul_ps(_mm_mul_ps(aa,ak),ak), _mm_mul_ps(_mm_mul_ps(bb,bk),bk) );
+					e = _mm_add_ps( e, _mm_mul_ps(_mm_add_ps(ab,ab), _mm_mul_ps(ak,bk)) );
+					e = _mm_sub_ps( e, _mm_add_ps(_mm_mul_ps(ak,x), _mm_mul_ps(bk,y)) );
+					e = _mm_sub_ps( e, _mm_add_ps(_mm_mul_ps(ak,x), _mm_mul_ps(bk,y)) );
+					err = _mm_add_ps( err, e );
+
+					_mm_storeu_ps( a[k], ak );
+					_mm_storeu_ps( b[k], bk );
+				}
+
+				float errors[4];
+				_mm_storeu_ps( errors, _mm_or_ps(_mm_and_ps(valid,err), _mm_andnot_ps(valid,_mm_set1_ps(1e30f))) );
+				for ( int j = 0 ; j < 4 ; ++j )
+				{
+					if ( errors[j] < bestError )
+					{
+						bestError = errors[j];
+						for ( int k = 0 ; k < 3 ; ++k )
+						{
+							bestA[k] = a[k][j];
+							bestB[k] = b[k][j];
+						}
+					}
+				}
+			}
+
+#else
+			for ( int c2 = c1 ; c2 <= n ; ++c2 )
+			{
+				// weight sums scaled by 9
+				int n3 = c2 - c1;
+				int aa9 = 9*c0 + 4*n2 + n3;
+				int bb9 = 9*(n-c2) + n2 + 4*n3;
+				int ab9 = 2*(n2 + n3);
+				int det81 = aa9*bb9 - ab9*ab9;
+				if ( det81 <= 0 )
+					continue;
+
+				const float aa = (float)aa9 * (1.f/9.f);
+				const float bb = (float)bb9 * (1.f/9.f);
+				const float ab = (float)ab9 * (1.f/9.f);
+				const float invDet = 81.f / (float)det81;
+				float a[3];
+				float b[3];
+				float x[3];
+				float y[3];
+				int k;
+				for ( k = 0 ; k < 3 ; ++k )
+				{
+					x[k] = (sum[k][c0] + sum[k][c1] + sum[k][c2]) * (1.f/3.f);
+					y[k] = sum[k][n] - x[k];
+					a[k] = (x[k]*bb - y[k]*ab) * invDet;
+					b[k] = (y[k]*aa - x[k]*ab) * invDet;
+				}
+
+				a[0] = snap( a[0], 31 );
+				a[1] = snap( a[1], 63 );
+				a[2] = snap( a[2], 31 );
+				b[0] = snap( b[0], 31 );
+				b[1] = snap( b[1], 63 );
+				b[2] = snap( b[2], 31 );
+
+				// error relative to sum of squared colors
+				float err = 0.f;
+				for ( k = 0 ; k < 3 ; ++k )
+					err += aa*a[k]*a[k] + bb*b[k]*b[k] + 2.f*ab*a[k]*b[k] - 2.f*a[k]*x[k] - 2.f*b[k]*y[k];
+
+				if ( err < bestError )
+				{
+					bestError = err;
+					for ( k = 0 ; k < 3 ; ++k )
+					{
+						bestA[k] = a[k];
+						bestB[k] = b[k];
+					}
+				}
+			}
+#endif // PIX_SSE2
+		}
+	}
+
+	if ( bestError >= 1e30f )
+		return false;
+
+	col0 = quantize( bestA[0], bestA[1], bestA[2] );
+	col1 = quantize( bestB[0], bestB[1], bestB[2] );
+	return true;
+}
+
+/** Compresses colors of a block. */
+static void compressColors( const BlockPixels& px, DXTCompressor::Quality quality, ColorBlock& out )
+{
+	float mean[3];
+	float axis[3];
+	computeAxis( px, mean, axis );
+
+	uint16_t col0;
+	uint16_t col1;
+	rangeFit( px, axis, col0, col1 );
+	float err = encodeColors( px, col0, col1, out );
+
+	if ( quality == DXTCompressor::QUALITY_HIGH && err > 0.f )
+	{
+		ColorBlock block;
+
+		if ( clusterFit(px, axis, col0, col1) )
+		{
+			float err2 = encodeColors( px, col0, col1, block );
+			if ( err2 < err )
+			{
+				err = err2;
+				out = block;
+			}
+		}
+
+		// flat areas are best approximated by interpolated color
+		if ( !px.transparent )
+		{
+			int r = (int)( mean[0] + .5f );
+			int g = (int)( mean[1] + .5f );
+			int b = (int)( mean[2] + .5f );
+			col0 = (uint16_t)( (s_singleColor.fit5[r].c0<<11) + (s_singleColor.fit6[g].c0<<5) + s_singleColor.fit5[b].c0 );
+			col1 = (uint16_t)( (s_singleColor.fit5[r].c1<<11) + (s_singleColor.fit6[g].c1<<5) + s_singleColor.fit5[b].c1 );
+			float err2 = encodeColors( px, col0, col1, block );
+			if ( err2 < err )
+			{
+				err = err2;
+				out = block;
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+#ifdef PIX_SSE2
+
+/** Selects closest alpha for each pixel, 8 pixels at a time. Returns sum of squared errors. */
+static int fitAlphaIndices( const int* a, const int* alphas, uint8_t* indices )
+{
+	__m128i sum = _mm_setzero_si128();
+	for ( int i = 0 ; i < 16 ; i += 8 )
+	{
+		const __m128i* src = reinterpret_cast<const __m128i*>( a+i );
+		__m128i v = _mm_packs_epi32( _mm_loadu_si128(src), _mm_loadu_si128(src+1) );
+		__m128i best = _mm_set1_epi16( 0x7FFF );
+		__m128i bestIndex = _mm_setzero_si128();
+
+		for ( int k = 0 ; k < 8 ; ++k )
+		{
+			__m128i p = _mm_set1_epi16( (short)alphas[k] );
+			__m128i d = _mm_max_epi16( _mm_sub_epi16(v,p), _mm_sub_epi16(p,v) );
+			__m128i less = _mm_cmplt_epi16( d, best );
+			best = _mm_min_epi16( d, best );
+			bestIndex = _mm_or_si128( _mm_andnot_si128(less,bestIndex), _mm_and_si128(less,_mm_set1_epi16((short)k)) );
+		}
+
+		sum = _mm_add_epi32( sum, _mm_madd_epi16(best,best) );
+		
+		short index[8];
+		_mm_storeu_si128( reinterpret_cast<__m128i*>(index), bestIndex );
+		for ( int j = 0 ; j < 8 ; ++j )
+			indices[i+j] = (uint8_t)index[j];
+	}
+
+	int sums[4];
+	_mm_storeu_si128( reinterpret_cast<__m128i*>(sums), sum );
+	return sums[0] + sums[1] + sums[2] + sums[3];
+}
+
+#else
+
+/** Selects closest alpha for each pixel. Returns sum of squared errors. */
+static int fitAlphaIndices( const int* a, const int* alphas, uint8_t* indices )
+{
+	int sum = 0;
+	for ( int i = 0 ; i < 16 ; ++i )
+	{
+		int best = 256*256;
+		for ( int k = 0 ; k < 8 ; ++k )
+		{
+			int d = a[i] - alphas[k];
+			d *= d;
+			if ( d < best )
+			{
+				best = d;
+				indices[i] = (uint8_t)k;
+			}
+		}
+		sum += best;
+	}
+	return sum;
+}
+
+#endif // PIX_SSE2
+
+/** Decodes DXT5 alpha block values like SurfaceUtil::getPixel. */
+static void makeAlphas( int a0, int a1, int* a )
+{
+	a[0] = a0;
+	a[1] = a1;
+	if ( a0 > a1 )
+	{
+		for ( int k = 1 ; k < 7 ; ++k )
+			a[k+1] = ((7-k)*a0 + k*a1 + 3) / 7;
+	}
+	else
+	{
+		for ( int k = 1 ; k < 5 ; ++k )
+			a[k+1] = ((5-k)*a0 + k*a1 + 2) / 5;
+		a[6] = 0;
+		a[7] = 255;
+	}
+}
+
+/** Encodes DXT5 alpha block with specified endpoints. */
+static int encodeAlphas( const BlockPixels& px, int a0, int a1, uint8_t* out )
+{
+	int alphas[8];
+	makeAlphas( a0, a1, alphas );
+
+	uint8_t indices[16];
+	int err = fitAlphaIndices( px.a, alphas, indices );
+
+	out[0] = (uint8_t)a0;
+	out[1] = (uint8_t)a1;
+	for ( int j = 0 ; j < 2 ; ++j )
+	{
+		uint32_t bits = 0;
+		for ( int i = 0 ; i < 8 ; ++i )
+			bits |= (uint32_t)indices[j*8+i] << (i*3);
+		out[2+j*3] = (uint8_t)bits;
+		out[3+j*3] = (uint8_t)(bits >> 8);
+		out[4+j*3] = (uint8_t)(bits >> 16);
+	}
+	return err;
+}
+
+/** Compresses interpolated alpha of a DXT5 block. */
+static void compressAlphaDXT5( const BlockPixels& px, DXTCompressor::Quality quality, uint8_t* out )
+{
+	int minAlpha = 255;
+	int maxAlpha = 0;
+	int minInner = 255;
+	int maxInner = 0;
+	for ( int i = 0 ; i < 16 ; ++i )
+	{
+		int a = px.a[i];
+		if ( a < minAlpha )
+			minAlpha = a;
+		if ( a > maxAlpha )
+			maxAlpha = a;
+		if ( a > 0 && a < 255 )
+		{
+			if ( a < minInner )
+				minInner = a;
+			if ( a > maxInner )
+				maxInner = a;
+		}
+	}
+
+	// 8-alpha block
+	int err = encodeAlphas( px, maxAlpha, minAlpha, out );
+
+	// 6-alpha block with explicit 0 and 255, better if range has outliers
+	if ( quality == DXTCompressor::QUALITY_HIGH && err > 0 )
+	{
+		if ( minInner > maxInner )
+			minInner = maxInner = 0;
+
+		uint8_t block[8];
+		int err2 = encodeAlphas( px, minInner, maxInner, block );
+		if ( err2 < err )
+			memcpy( out, block, 8 );
+	}
+}
+
+/** Compresses explicit alpha of a DXT3 block. */
+static void compressAlphaDXT3( const BlockPixels& px, uint8_t* out )
+{
+	for ( int j = 0 ; j < 4 ; ++j )
+	{
+		uint32_t row = 0;
+		for ( int i = 0 ; i < 4 ; ++i )
+			row |= (uint32_t)( (px.a[j*4+i]*15 + 127) / 255 ) << (i*4);
+		out[j*2] = (uint8_t)row;
+		out[j*2+1] = (uint8_t)(row >> 8);
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+/** Reads 4x4 pixel block, replicating edge pixels outside the image. */
+static void loadBlock( const CompressJob& job, int bx, int by, BlockPixels& px )
+{
+	const bool alphaMask = ( job.format == SurfaceFormat::SURFACE_DXT1 );
+	px.transparent = false;
+
+	for ( int j = 0 ; j < 4 ; ++j )
+	{
+		int y = by*4 + j;
+		if ( y >= job.height )
+			y = job.height - 1;
+
+		const uint32_t* row = reinterpret_cast<const uint32_t*>( job.src + job.srcPitch*y );
+		for ( int i = 0 ; i < 4 ; ++i )
+		{
+			int x = bx*4 + i;
+			if ( x >= job.width )
+				x = job.width - 1;
+
+			uint32_t c = row[x];
+			int k = j*4 + i;
+			px.r[k] = (float)( (c>>16) & 0xFF );
+			px.g[k] = (float)( (c>>8) & 0xFF );
+			px.b[k] = (float)( c & 0xFF );
+			px.a[k] = (int)( c >> 24 );
+			px.weight[k] = 1.f;
+			if ( alphaMask && px.a[k] < 128 )
+			{
+				px.weight[k] = 0.f;
+				px.transparent = true;
+			}
+		}
+	}
+}
+
+/** Writes color block in little endian byte order. */
+static void storeColors( const ColorBlock& block, uint8_t* out )
+{
+	out[0] = (uint8_t)block.col0;
+	out[1] = (uint8_t)(block.col0 >> 8);
+	out[2] = (uint8_t)block.col1;
+	out[3] = (uint8_t)(block.col1 >> 8);
+	memcpy( out+4, block.rows, 4 );
+}
+
+/** Compresses every nth tile of the image starting from specified tile. */
+static void compressTiles( const CompressJob& job, int first, int step )
+{
+	BlockPixels px;
+	ColorBlock colors;
+
+	for ( int tile = first ; tile < job.tiles ; tile += step )
+	{
+		int bx0 = (tile % job.tilesX) * TILE_BLOCKS;
+		int by0 = (tile / job.tilesX) * TILE_BLOCKS;
+		int bx1 = bx0 + TILE_BLOCKS < job.blocksX ? bx0 + TILE_BLOCKS : job.blocksX;
+		int by1 = by0 + TILE_BLOCKS < job.blocksY ? by0 + TILE_BLOCKS : job.blocksY;
+
+		for ( int by = by0 ; by < by1 ; ++by )
+		{
+			for ( int bx = bx0 ; bx < bx1 ; ++bx )
+			{
+				uint8_t* out = job.dst + job.dstPitch*by + job.blockBytes*bx;
+				loadBlock( job, bx, by, px );
+
+				if ( job.format == SurfaceFormat::SURFACE_DXT3 )
+				{
+					compressAlphaDXT3( px, out );
+					out += 8;
+				}
+				else if ( job.format == SurfaceFormat::SURFACE_DXT5 )
+				{
+					compressAlphaDXT5( px, job.quality, out );
+					out += 8;
+				}
+
+				compressColors( px, job.quality, colors );
+				storeColors( colors, out );
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+/** Compresses every nth tile of an image. */
+class CompressThread :
+	public Thread
+{
+public:
+	CompressThread() :
+		m_job(0), m_first(0), m_step(1)
+	{
+	}
+
+	void setWork( const CompressJob* job, int first, int step )
+	{
+		m_job = job;
+		m_first = first;
+		m_step = step;
+	}
+
+	void run()
+	{
+		compressTiles( *m_job, m_first, m_step );
+	}
+
+private:
+	const CompressJob*	m_job;
+	int					m_first;
+	int					m_step;
+
+	CompressThread( const CompressThread& );
+	CompressThread& operator=( const CompressThread& );
+};
+
+//-----------------------------------------------------------------------------
+
+/** Returns number of processors in the system. */
+static int processorCount()
+{
+#ifdef WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	int n = (int)info.dwNumberOfProcessors;
+#else
+	int n = (int)sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+	return n > 0 ? n : 1;
+}
+
+/** Returns size of compressed 4x4 pixel block in bytes. */
+static int blockBytes( const SurfaceFormat& format )
+{
+	assert( format.compressed() );
+	return format == SurfaceFormat::SURFACE_DXT1 ? 8 : 16;
+}
+
+//-----------------------------------------------------------------------------
+
+DXTCompressor::DXTCompressor( Quality quality ) :
+	m_quality( quality ),
+	m_threads( 0 )
+{
+}
+
+void DXTCompressor::compress( const SurfaceFormat& format, const Surface& src, Surface& dst ) const
+{
+	assert( src.format().bltSupported() );
+
+	const int	width	= src.width();
+	const int	height	= src.height();
+	const int	pitch	= compressedPitch( format, width );
+	Surface		surface( width, height, pitch, compressedSize(format,width,height), format );
+
+	if ( src.format() == SurfaceFormat::SURFACE_A8R8G8B8 )
+	{
+		compress( format, surface.data(), pitch, width, height, src.data(), src.pitch() );
+	}
+	else
+	{
+		Surface argb( width, height, SurfaceFormat::SURFACE_A8R8G8B8 );
+		SurfaceUtil::blt( argb.format(), width, height, argb.data(), argb.pitch(), src.format(), src.data(), src.pitch() );
+		compress( format, surface.data(), pitch, width, height, argb.data(), argb.pitch() );
+	}
+
+	dst.swap( surface );
+}
+
+void DXTCompressor::compress( const SurfaceFormat& format, void* dstData, int dstPitch,
+	int width, int height, const void* srcData, int srcPitch ) const
+{
+	assert( format.compressed() );
+	assert( width > 0 && height > 0 );
+
+	CompressJob job;
+	job.src = reinterpret_cast<const uint8_t*>( srcData );
+	job.srcPitch = srcPitch;
+	job.width = width;
+	job.height = height;
+	job.dst = reinterpret_cast<uint8_t*>( dstData );
+	job.dstPitch = dstPitch;
+	job.format = format.type();
+	job.quality = m_quality;
+	job.blockBytes = blockBytes( format );
+	job.blocksX = (width+3) / 4;
+	job.blocksY = (height+3) / 4;
+	job.tilesX = (job.blocksX + TILE_BLOCKS-1) / TILE_BLOCKS;
+	job.tiles = job.tilesX * ( (job.blocksY + TILE_BLOCKS-1) / TILE_BLOCKS );
+
+	int threads = this->threads();
+	if ( threads > job.blocksX*job.blocksY/MIN_BLOCKS_PER_THREAD )
+		threads = job.blocksX*job.blocksY/MIN_BLOCKS_PER_THREAD;
+	if ( threads > job.tiles )
+		threads = job.tiles;
+	if ( threads < 1 )
+		threads = 1;
+	Vector<P(CompressThread)> workers( Allocator<P(CompressThread)>(__FILE__,__LINE__) );
+	while ( workers.size() < threads-1 )
+		workers.add( new CompressThread );
+
+	// each thread takes every nth tile, calling thread takes the first share
+	int started = 0;
+	for ( ; started < threads-1 ; ++started )
+	{
+		CompressThread* worker = workers[started];
+		worker->setWork( &job, started+1, threads );
+		try
+		{
+			worker->start();
+		}
+		catch ( ... )
+		{
+			break;
+		}
+	}
+
+	// shares of the workers which failed to start are compressed here too
+	compressTiles( job, 0, threads );
+	for ( int share = started+1 ; share < threads ; ++share )
+		compressTiles( job, share, threads );
+
+	for ( int k = 0 ; k < started ; ++k )
+		workers[k]->join();
+}
+
+void DXTCompressor::setQuality( Quality quality )
+{
+	m_quality = quality;
+}
+
+void DXTCompressor::setThreads( int count )
+{
+	assert( count >= 0 );
+	m_threads = count;
+}
+
+int DXTCompressor::threads() const
+{
+	return m_threads > 0 ? m_threads : processorCount();
+}
+
+int DXTCompressor::compressedSize( const SurfaceFormat& format, int width, int height )
+{
+	return compressedPitch( format, width ) * ( (height+3) / 4 );
+}
+
+int DXTCompressor::compressedPitch( const SurfaceFormat& format, int width )
+{
+	return blockBytes( format ) * ( (width+3) / 4 );
+}
+
+
+} // pix
@@ -0,0 +1,97 @@
+#ifndef _PIX_DXTCOMPRESSOR_H
+#define _PIX_DXTCOMPRESSOR_H
+
+
+namespace pix
+{
+
+
+class Surface;
+class SurfaceFormat;
+
+
+/**
+ * Compresses pixel data to DXT1, DXT3 or DXT5 format.
+ *
+ * Image is split to tiles of 4x4 pixel blocks and the tiles
+ * are compressed in parallel, see setThreads().
+ * Result does not depend on number of threads used.
+ *
+ * Fast quality fits block colors to the principal axis of
+ * the block and is fast enough for run-time use. High quality
+ * searches best clustering of block pixels along the axis,
+ * which is several times slower but reduces error especially
+ * in smooth gradients.
+ *
+ * DXT1 uses 1-bit alpha (pixels with alpha less than 128 become
+ * transparent), DXT3 uses explicit 4-bit alpha and DXT5 interpolated alpha.
+ *
+ * @author Jani Kajala (jani.kajala@helsinki.fi)
+ */
+class DXTCompressor
+{
+public:
+	/** Compression quality. */
+	enum Quality
+	{
+		/** Range fit along principal axis of the block colors. */
+		QUALITY_FAST,
+		/** Cluster fit along principal axis of the block colors. */
+		QUALITY_HIGH
+	};
+
+	/** Creates compressor of specified quality using one thread per processor. */
+	explicit DXTCompressor( Quality quality=QUALITY_FAST );
+
+	/**
+	 * Compresses source surface to destination surface.
+	 * Destination surface is resized to match the source.
+	 * @param format Compressed format, DXT1, DXT3 or DXT5.
+	 * @param src Source surface, must be blittable format.
+	 */
+	void		compress( const SurfaceFormat& format, const Surface& src, Surface& dst ) const;
+
+	/**
+	 * Compresses 32-bit ARGB pixel data.
+	 * @param format Compressed format, DXT1, DXT3 or DXT5.
+	 * @param dstData Compressed data, see compressedSize().
+	 * @param dstPitch Distance (in bytes) between rows of blocks, see compressedPitch().
+	 * @param width Width of source data in pixels.
+	 * @param height Height of source data in pixels.
+	 * @param srcData 32-bit ARGB pixel data.
+	 * @param srcPitch Distance (in bytes) between source data rows.
+	 */
+	void		compress( const SurfaceFormat& format, void* dstData, int dstPitch,
+					int width, int height, const void* srcData, int srcPitch ) const;
+
+	/** Sets compression quality. */
+	void		setQuality( Quality quality );
+
+	/**
+	 * Sets number of threads used to compress large images.
+	 * Default is 0, which uses one thread per processor.
+	 */
+	void		setThreads( int count );
+
+	/** Returns compression quality. */
+	Quality		quality() const															{return m_quality;}
+
+	/** Returns number of threads used to compress large images. */
+	int			threads() const;
+
+	/** Returns number of bytes in compressed image of specified size. */
+	static int	compressedSize( const SurfaceFormat& format, int width, int height );
+
+	/** Returns number of bytes in a row of 4x4 pixel blocks in compressed image of specified width. */
+	static int	compressedPitch( const SurfaceFormat& format, int width );
+
+private:
+	Quality		m_quality;
+	int			m_threads;
+};
+
+
+} // pix
+
+
+#endif // _PIX_DXTCOMPRESSOR_H
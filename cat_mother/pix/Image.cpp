@@ -6,6 +6,8 @@
 #include "Surface.h"
 #include "SurfaceUtil.h"
 #include "SurfaceFormat.h"
+#include "DXTCompressor.h"
+#include "MipMapGenerator.h"
 #include <io/FileInputStream.h>
 #include <io/FileOutputStream.h>
 #include <io/IOException.h>
@@ -55,6 +57,10 @@ public:
 
 	void		swap( ImageImpl& other );
 
+	void		generateMipMaps( const MipMapGenerator& generator );
+
+	void		compress( const SurfaceFormat& format, const DXTCompressor& compressor );
+
 	Surface&	surface( int index )												{return m_surfaces[index];}
 
 	const Surface&	surface( int index ) const										{return m_surfaces[index];}
@@ -89,11 +95,15 @@ Image::ImageImpl::ImageImpl( InputStream* in, const lang::String& name )
 
 Image::ImageImpl::ImageImpl( int width, int height, const SurfaceFormat& format )
 {
+	m_mipMapLevels = 1;
+	m_type = TYPE_BITMAP;
 	allocate( width, height, 0, format );
 }
 
 Image::ImageImpl::ImageImpl( int width, int height, int subsurfaces, const SurfaceFormat& format )
 {
+	m_mipMapLevels = 1;
+	m_type = TYPE_CUSTOM;
 	m_surfaces.setSize( subsurfaces );
 	for ( int i = 0; i < m_surfaces.size(); ++i )
 		allocate( width, height, i, format );
@@ -103,6 +113,7 @@ Image::ImageImpl::ImageImpl( int width, int height, const ImageImpl* other )
 {
 	m_surfaces.setSize( other->m_surfaces.size() );
 	m_mipMapLevels = other->m_mipMapLevels;
+	m_type = other->m_type;
 	for ( int i = 0; i < m_surfaces.size(); ++i )
 	{
 		allocate( width, height, i, other->format() );
@@ -115,10 +126,20 @@ Image::ImageImpl::ImageImpl( const SurfaceFormat& format, const ImageImpl* other
 {
 	m_surfaces.setSize( other->m_surfaces.size() );
 	m_mipMapLevels = other->m_mipMapLevels;
-	for ( int i = 0; i < m_surfaces.size(); ++i )
+	m_type = other->m_type;
+	if ( format.compressed() )
 	{
-		allocate( other->m_surfaces[i].width(), other->m_surfaces[i].height(), i, format );
-		m_surfaces[i].blt( &other->m_surfaces[i] );
+		DXTCompressor compressor;
+		for ( int i = 0; i < m_surfaces.size(); ++i )
+			compressor.compress( format, other->m_surfaces[i], m_surfaces[i] );
+	}
+	else
+	{
+		for ( int i = 0; i < m_surfaces.size(); ++i )
+		{
+			allocate( other->m_surfaces[i].width(), other->m_surfaces[i].height(), i, format );
+			m_surfaces[i].blt( &other->m_surfaces[i] );
+		}
 	}
 	m_filename = other->m_filename;
 }
@@ -228,6 +249,8 @@ void Image::ImageImpl::save( OutputStream* out, const String& name )
 		ok = saveTGA( out, m_surfaces[0].data(), m_surfaces[0].width(), m_surfaces[0].height(), m_surfaces[0].format() );
 	else if ( lang::String(".jpg") == ext )
 		ok = saveJPEG( out, m_surfaces[0].data(), m_surfaces[0].width(), m_surfaces[0].height(), m_surfaces[0].format() );
+	else if ( lang::String(".dds") == ext )
+		ok = saveDDS( out, m_surfaces, m_mipMapLevels, m_type );
 
 	// image data saving failed?
 	if ( !ok )
@@ -237,6 +260,34 @@ void Image::ImageImpl::save( OutputStream* out, const String& name )
 	m_filename = name;
 }
 
+void Image::ImageImpl::generateMipMaps( const MipMapGenerator& generator )
+{
+	assert( format().bltSupported() );
+
+	const int faces = ( m_type == TYPE_CUBEMAP ? 6 : 1 );
+	Array<Surface> surfaces;
+	Array<Surface> levels;
+	for ( int i = 0 ; i < faces ; ++i )
+	{
+		generator.generate( m_surfaces[i*m_mipMapLevels], levels );
+		for ( int k = 0 ; k < levels.size() ; ++k )
+			surfaces.add( levels[k] );
+	}
+
+	m_surfaces = surfaces;
+	m_mipMapLevels = levels.size();
+	if ( m_type != TYPE_CUBEMAP )
+		m_type = TYPE_BITMAP;
+}
+
+void Image::ImageImpl::compress( const SurfaceFormat& format, const DXTCompressor& compressor )
+{
+	assert( this->format().bltSupported() );
+
+	for ( int i = 0 ; i < m_surfaces.size() ; ++i )
+		compressor.compress( format, m_surfaces[i], m_surfaces[i] );
+}
+
 //-----------------------------------------------------------------------------
 
 Image::Image( io::InputStream* in )
@@ -310,6 +361,16 @@ void Image::load( InputStream* in, const String& name )
 	m_this->load( in, name );
 }
 
+void Image::generateMipMaps( const MipMapGenerator& generator )
+{
+	m_this->generateMipMaps( generator );
+}
+
+void Image::compress( const SurfaceFormat& format, const DXTCompressor& compressor )
+{
+	m_this->compress( format, compressor );
+}
+
 Surface& Image::surface( int index )
 {
 	return m_this->surface( index );
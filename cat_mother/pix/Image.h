@@ -19,6 +19,8 @@ namespace pix
 
 class Surface;
 class SurfaceFormat;
+class DXTCompressor;
+class MipMapGenerator;
 
 
 /**
@@ -28,7 +30,8 @@ class SurfaceFormat;
  *
  * Supported image source file formats are JPG, TGA, BMP and DDS.
  * Both loading and saving is supported for the file formats.
- * For DDS no saving is implemented yet.
+ * DDS files are saved with all surfaces, other formats
+ * save only the main surface.
  * 
  * All coordinates used are expressed as pixels.
  * Origin is top left, x grows right and y grows down.
@@ -41,6 +44,13 @@ class SurfaceFormat;
  *	Image img( SurfaceFormat::SURFACE_A8R8G8B8, Image("test.bmp") );
  *	</pre>
  *
+ * To save compressed texture with mipmaps:
+ *	<pre>
+ *	img.generateMipMaps( MipMapGenerator(MipMapGenerator::FILTER_KAISER) );
+ *	img.compress( SurfaceFormat::SURFACE_DXT1, DXTCompressor(DXTCompressor::QUALITY_HIGH) );
+ *	img.save( new FileOutputStream("test.dds") );
+ *	</pre>
+ *
  * @author Jani Kajala (jani.kajala@helsinki.fi), Toni Aittoniemi
  */
 class Image :
@@ -82,6 +92,7 @@ public:
 	/** 
 	 * Creates image of specified format and copies Other image to it. 
 	 * Requires that the Other image has been initialized.
+	 * DXT formats are compressed with default DXTCompressor.
 	 */
 	Image( const SurfaceFormat& format, const Image* other );
 
@@ -141,6 +152,21 @@ public:
 	 */
 	void					save( io::OutputStream* out, const lang::String& name );
 
+	/** 
+	 * Replaces mipmaps of the image with ones generated from the main surface. 
+	 * Cube map faces get mipmaps of their own, other images 
+	 * become single face bitmaps.
+	 * Requires that the image is not compressed.
+	 */
+	void					generateMipMaps( const MipMapGenerator& generator );
+
+	/** 
+	 * Compresses all surfaces of the image. 
+	 * Requires that the image is not compressed.
+	 * @param format Compressed format, DXT1, DXT3 or DXT5.
+	 */
+	void					compress( const SurfaceFormat& format, const DXTCompressor& compressor );
+
 	/** Returns array of surfaces. */
 	Surface*				surfaceArray();
 
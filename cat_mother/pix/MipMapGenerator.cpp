@@ -0,0 +1,269 @@
+#include "MipMapGenerator.h"
+#include "Surface.h"
+#include "SurfaceUtil.h"
+#include "SurfaceFormat.h"
+#include <lang/Array.h>
+#include <math.h>
+#include <stdint.h>
+#include <assert.h>
+#include "config.h"
+
+//-----------------------------------------------------------------------------
+
+/** Half width of Kaiser filter in destination pixels. */
+#define KAISER_WIDTH 3.f
+
+/** Kaiser window shape parameter. */
+#define KAISER_ALPHA 4.f
+
+//-----------------------------------------------------------------------------
+
+using namespace lang;
+
+//-----------------------------------------------------------------------------
+
+namespace pix
+{
+
+
+/** Returns modified Bessel function of the first kind of order 0. */
+static float besselI0( float x )
+{
+	float sum = 1.f;
+	float term = 1.f;
+	float halfx = x * .5f;
+	for ( int k = 1 ; k < 32 && term > sum*1e-7f ; ++k )
+	{
+		term *= (halfx / (float)k) * (halfx / (float)k);
+		sum += term;
+	}
+	return sum;
+}
+
+/** Returns Kaiser windowed sinc at distance x (in destination pixels). */
+static float kaiser( float x )
+{
+	const float PI = 3.14159265f;
+
+	if ( x < 0.f )
+		x = -x;
+	if ( x >= KAISER_WIDTH )
+		return 0.f;
+
+	float sinc = x < 1e-6f ? 1.f : sinf(PI*x) / (PI*x);
+	float t = x / KAISER_WIDTH;
+	return sinc * besselI0( KAISER_ALPHA*sqrtf(1.f-t*t) ) / besselI0( KAISER_ALPHA );
+}
+
+//-----------------------------------------------------------------------------
+
+/** Filter weights of each destination pixel when resampling one dimension. */
+class FilterTaps
+{
+public:
+	FilterTaps( MipMapGenerator::Filter filter, int srcSize, int dstSize )
+	{
+		const float scale = (float)srcSize / (float)dstSize;
+		const float radius = ( filter == MipMapGenerator::FILTER_KAISER ? KAISER_WIDTH : .5f ) * scale;
+
+		m_taps = (int)ceilf( radius*2.f ) + 2;
+		m_index.setSize( dstSize * m_taps );
+		m_weight.setSize( dstSize * m_taps );
+
+		for ( int i = 0 ; i < dstSize ; ++i )
+		{
+			float center = ((float)i + .5f) * scale;
+			int left = (int)floorf( center - radius );
+			float sum = 0.f;
+			int k;
+
+			for ( k = 0 ; k < m_taps ; ++k )
+			{
+				int j = left + k;
+				float w = 0.f;
+				if ( filter == MipMapGenerator::FILTER_KAISER )
+				{
+					w = kaiser( ((float)j + .5f - center) / scale );
+				}
+				else
+				{
+					// overlap of source pixel with the box
+					float x0 = (float)j > center-radius ? (float)j : center-radius;
+					float x1 = (float)(j+1) < center+radius ? (float)(j+1) : center+radius;
+					if ( x1 > x0 )
+						w = x1 - x0;
+				}
+
+				m_index[i*m_taps+k] = j < 0 ? 0 : ( j >= srcSize ? srcSize-1 : j );
+				m_weight[i*m_taps+k] = w;
+				sum += w;
+			}
+
+			for ( k = 0 ; k < m_taps ; ++k )
+				m_weight[i*m_taps+k] /= sum;
+		}
+	}
+
+	/** Returns number of weights per destination pixel. */
+	int				taps() const				{return m_taps;}
+
+	/** Returns source pixel indices of ith destination pixel. */
+	const int*		index( int i ) const		{return m_index.begin() + i*m_taps;}
+
+	/** Returns weights of ith destination pixel. */
+	const float*	weight( int i ) const		{return m_weight.begin() + i*m_taps;}
+
+private:
+	Array<int>		m_index;
+	Array<float>	m_weight;
+	int				m_taps;
+};
+
+/**
+ * Resamples one dimension of 4-channel float image.
+ * @param srcStride Distance (in floats) between source pixels in the resampled dimension.
+ * @param srcLineStride Distance (in floats) between source lines.
+ */
+static void resample( const float* src, int srcStride, int srcLineStride,
+	float* dst, int dstStride, int dstLineStride,
+	int lines, int dstSize, const FilterTaps& taps )
+{
+	const int n = taps.taps();
+
+	for ( int line = 0 ; line < lines ; ++line )
+	{
+		const float* srcLine = src + line*srcLineStride;
+		float* dstLine = dst + line*dstLineStride;
+
+		for ( int i = 0 ; i < dstSize ; ++i )
+		{
+			const int* index = taps.index( i );
+			const float* weight = taps.weight( i );
+			float sum[4] = {0,0,0,0};
+
+			for ( int k = 0 ; k < n ; ++k )
+			{
+				const float* s = srcLine + index[k]*srcStride;
+				float w = weight[k];
+				sum[0] += s[0] * w;
+				sum[1] += s[1] * w;
+				sum[2] += s[2] * w;
+				sum[3] += s[3] * w;
+			}
+
+			float* d = dstLine + i*dstStride;
+			d[0] = sum[0];
+			d[1] = sum[1];
+			d[2] = sum[2];
+			d[3] = sum[3];
+		}
+	}
+}
+
+/** Returns linear [0,1] value in gamma space [0,255]. */
+static inline uint32_t toGamma( float v, float invGamma )
+{
+	if ( v <= 0.f )
+		return 0;
+	if ( v >= 1.f )
+		return 255;
+	if ( invGamma != 1.f )
+		v = powf( v, invGamma );
+	return (uint32_t)( v*255.f + .5f );
+}
+
+//-----------------------------------------------------------------------------
+
+MipMapGenerator::MipMapGenerator( Filter filter, float gamma ) :
+	m_filter( filter ),
+	m_gamma( gamma )
+{
+	assert( gamma > 0.f );
+}
+
+void MipMapGenerator::generate( const Surface& src, Array<Surface>& levels ) const
+{
+	assert( src.format().bltSupported() );
+
+	const SurfaceFormat argbFormat( SurfaceFormat::SURFACE_A8R8G8B8 );
+	const float invGamma = 1.f / m_gamma;
+	int w = src.width();
+	int h = src.height();
+	int i;
+
+	levels.clear();
+	levels.add( src );
+
+	// source image in linear space
+	float toLinear[256];
+	for ( i = 0 ; i < 256 ; ++i )
+		toLinear[i] = m_gamma != 1.f ? powf( (float)i/255.f, m_gamma ) : (float)i/255.f;
+
+	Surface argb( w, h, argbFormat );
+	SurfaceUtil::blt( argbFormat, w, h, argb.data(), argb.pitch(), src.format(), src.data(), src.pitch() );
+	Array<float> image( w*h*4 );
+	for ( i = 0 ; i < w*h ; ++i )
+	{
+		uint32_t c = reinterpret_cast<const uint32_t*>( argb.data() )[i];
+		image[i*4+0] = toLinear[ (c>>16) & 0xFF ];
+		image[i*4+1] = toLinear[ (c>>8) & 0xFF ];
+		image[i*4+2] = toLinear[ c & 0xFF ];
+		image[i*4+3] = (float)(c>>24) / 255.f;
+	}
+
+	// filter each level from the previous one
+	Array<float> tmp;
+	Array<float> next;
+	while ( w > 1 || h > 1 )
+	{
+		const int nw = w > 1 ? w/2 : 1;
+		const int nh = h > 1 ? h/2 : 1;
+
+		FilterTaps tapsX( m_filter, w, nw );
+		tmp.setSize( nw*h*4 );
+		resample( image.begin(), 4, w*4, tmp.begin(), 4, nw*4, h, nw, tapsX );
+
+		FilterTaps tapsY( m_filter, h, nh );
+		next.setSize( nw*nh*4 );
+		resample( tmp.begin(), nw*4, 4, next.begin(), nw*4, 4, nw, nh, tapsY );
+
+		// back to gamma space and source format
+		Surface level( nw, nh, argbFormat );
+		uint32_t* pixels = reinterpret_cast<uint32_t*>( level.data() );
+		for ( i = 0 ; i < nw*nh ; ++i )
+		{
+			const float* c = next.begin() + i*4;
+			pixels[i] = (toGamma(c[3],1.f)<<24) + (toGamma(c[0],invGamma)<<16) + (toGamma(c[1],invGamma)<<8) + toGamma(c[2],invGamma);
+		}
+
+		if ( src.format() == argbFormat )
+		{
+			levels.add( level );
+		}
+		else
+		{
+			Surface converted( nw, nh, src.format() );
+			SurfaceUtil::blt( converted.format(), nw, nh, converted.data(), converted.pitch(), argbFormat, level.data(), level.pitch() );
+			levels.add( converted );
+		}
+
+		image = next;
+		w = nw;
+		h = nh;
+	}
+}
+
+int MipMapGenerator::levels( int width, int height )
+{
+	int count = 1;
+	while ( width > 1 || height > 1 )
+	{
+		width = width > 1 ? width/2 : 1;
+		height = height > 1 ? height/2 : 1;
+		++count;
+	}
+	return count;
+}
+
+
+} // pix
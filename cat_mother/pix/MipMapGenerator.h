@@ -0,0 +1,72 @@
+#ifndef _PIX_MIPMAPGENERATOR_H
+#define _PIX_MIPMAPGENERATOR_H
+
+
+#include <lang/Array.h>
+
+
+namespace pix
+{
+
+
+class Surface;
+
+
+/**
+ * Generates mipmap chain of a surface.
+ *
+ * Each level is half the size of the previous level (rounded down,
+ * but at least 1 pixel) until the size is 1x1. Levels are filtered
+ * in linear color space, i.e. color channels are converted from gamma
+ * space before filtering and back after it, so that the
+ * brightness of the image is preserved in the smaller levels.
+ * Alpha channel is filtered as is.
+ *
+ * @author Jani Kajala (jani.kajala@helsinki.fi)
+ */
+class MipMapGenerator
+{
+public:
+	/** Downsampling filter. */
+	enum Filter
+	{
+		/** Average of the source pixels covered by the destination pixel. */
+		FILTER_BOX,
+		/** Kaiser windowed sinc, sharper than box filter. */
+		FILTER_KAISER
+	};
+
+	/**
+	 * Creates mipmap generator.
+	 * @param filter Downsampling filter.
+	 * @param gamma Gamma of source color channels, 1 filters colors as is.
+	 */
+	explicit MipMapGenerator( Filter filter=FILTER_BOX, float gamma=2.2f );
+
+	/**
+	 * Generates mipmap levels of the surface.
+	 * @param src Source surface, must be blittable format.
+	 * @param levels [out] Receives copy of the source surface followed by
+	 * generated levels in the source surface format.
+	 */
+	void		generate( const Surface& src, lang::Array<Surface>& levels ) const;
+
+	/** Returns downsampling filter. */
+	Filter		filter() const															{return m_filter;}
+
+	/** Returns gamma of source color channels. */
+	float		gamma() const															{return m_gamma;}
+
+	/** Returns number of mipmap levels, including the source level, for specified size. */
+	static int	levels( int width, int height );
+
+private:
+	Filter		m_filter;
+	float		m_gamma;
+};
+
+
+} // pix
+
+
+#endif // _PIX_MIPMAPGENERATOR_H
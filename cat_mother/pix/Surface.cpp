@@ -149,12 +149,12 @@ Surface& Surface::operator=( const Surface& other )
 	return *this;
 }
 
-void Surface::blt( const Surface* src )
+void Surface::blt( const Surface* src, bool dither )
 {
-	blt( 0, 0, width(), height(), src, 0, 0, src->width(), src->height() );
+	blt( 0, 0, width(), height(), src, 0, 0, src->width(), src->height(), dither );
 }
 
-void Surface::blt( int x, int y, int w, int h, const Surface* src, int srcX, int srcY, int srcW, int srcH )
+void Surface::blt( int x, int y, int w, int h, const Surface* src, int srcX, int srcY, int srcW, int srcH, bool dither )
 {
 	assert( src != this );
 	assert( src->format().bltSupported() );
@@ -162,30 +162,30 @@ void Surface::blt( int x, int y, int w, int h, const Surface* src, int srcX, int
 	assert( isInside(x,y,w,h) );
 	assert( src->isInside(srcX,srcY,srcW,srcH) );
 
-	SurfaceUtil::blt( format(), x, y, w, h, data(), pitch(), src->format(), srcX, srcY, srcW, srcH, src->data(), src->pitch() );
+	SurfaceUtil::blt( format(), x, y, w, h, data(), pitch(), src->format(), srcX, srcY, srcW, srcH, src->data(), src->pitch(), dither );
 }
 
 void Surface::blt( int x, int y, int w, int h, 
-	const void* src, int srcW, int srcH, int srcPitch, const SurfaceFormat& srcFormat )
+	const void* src, int srcW, int srcH, int srcPitch, const SurfaceFormat& srcFormat, bool dither )
 {
 	assert( format().bltSupported() );
 	assert( srcFormat.bltSupported() );
 	assert( isInside(x,y,w,h) );
 	assert( srcPitch >= srcFormat.pixelSize()*srcW );
 
-	blt( data(), x, y, w, h, pitch(), format(), src, srcW, srcH, srcPitch, srcFormat );
+	blt( data(), x, y, w, h, pitch(), format(), src, srcW, srcH, srcPitch, srcFormat, dither );
 }
 
 void Surface::blt( void* dst, int x, int y, int w, int h, 
 	int dstPitch, const SurfaceFormat& dstFormat,
 	const void* src, int srcW, int srcH, 
-	int srcPitch, const SurfaceFormat& srcFormat )
+	int srcPitch, const SurfaceFormat& srcFormat, bool dither )
 {
 	assert( srcFormat.bltSupported() );
 	assert( dstFormat.bltSupported() );
 
 	if ( dstFormat.bltSupported() )
-		SurfaceUtil::blt( dstFormat, x, y, w, h, dst, dstPitch, srcFormat, 0, 0, srcW, srcH, src, srcPitch );
+		SurfaceUtil::blt( dstFormat, x, y, w, h, dst, dstPitch, srcFormat, 0, 0, srcW, srcH, src, srcPitch, dither );
 }
 
 void Surface::copyData( const void* sourceData, int size ) 
@@ -37,23 +37,28 @@ public:
 	/** Copy by value. */
 	Surface&				operator=( const Surface& other );
 
-	/** Stretches a copy of Other image to this image. */
-	void			blt( const Surface* other );
+	/** 
+	 * Stretches a copy of Other image to this image. 
+	 * @param dither Use dithering if this image has less bits per channel, see SurfaceUtil::blt.
+	 */
+	void			blt( const Surface* other, bool dither=true );
 
 	/** 
 	 * Stretches a copy of a rectangle from Other image to this image. 
 	 * Both rectangles must be inside image bounds.
+	 * @param dither Use dithering if this image has less bits per channel, see SurfaceUtil::blt.
 	 */
 	void			blt( int x, int y, int w, int h, const Surface* other, 
-						int otherX, int otherY, int otherW, int otherH );
+						int otherX, int otherY, int otherW, int otherH, bool dither=true );
 
 	/** 
 	 * Stretches a copy of source pixel data to this image. 
 	 * Both rectangles must be inside image bounds.
+	 * @param dither Use dithering if this image has less bits per channel, see SurfaceUtil::blt.
 	 */
 	void			blt( int x, int y, int width, int height, 
 						const void* sourceData, int sourceWidth, int sourceHeight, 
-						int sourcePitch, const SurfaceFormat& sourceFormat );
+						int sourcePitch, const SurfaceFormat& sourceFormat, bool dither=true );
 
 	/**
 	 * Copies bits from source to this image.
@@ -103,11 +108,14 @@ public:
 	bool					isInside( int x, int y, int w, int h ) const;
 
 	// Static operations
-	/** Copies pixels from source to destination format. */
+	/** 
+	 * Copies pixels from source to destination format. 
+	 * @param dither Use dithering if destination has less bits per channel, see SurfaceUtil::blt.
+	 */
 	static void		blt( void* dst, int x, int y, int w, int h,
 						int dstPitch, const SurfaceFormat& dstFormat,
 						const void* src, int srcW, int srcH,
-						int srcPitch, const SurfaceFormat& srcFormat );
+						int srcPitch, const SurfaceFormat& srcFormat, bool dither=true );
 
 private:
 	char*			m_data;
@@ -1,9 +1,32 @@
 #include "SurfaceUtil.h"
 #include "SurfaceFormat.h"
+#include <lang/Thread.h>
+#include <util/Vector.h>
 #include <stdint.h>
 #include <string.h>
 #include <assert.h>
+
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
 #include "config.h"
+#ifdef PIX_SSE2
+#include <emmintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+
+/** Minimum number of pixels to convert per thread. */
+#define MIN_PIXELS_PER_THREAD 65536
+
+//-----------------------------------------------------------------------------
+
+using namespace lang;
+using namespace util;
 
 //-----------------------------------------------------------------------------
 
@@ -335,15 +358,509 @@ static inline long getPixelDXT5( int x, int y,
 
 //-----------------------------------------------------------------------------
 
+/** 
+ * Converts a row of pixels from one surface format to another.
+ * alpha has bits which are set in the ARGB8888 side of the conversion,
+ * i.e. in source pixels of 32-bit to 16-bit conversion and 
+ * in destination pixels of 16/24-bit to 32-bit conversion.
+ */
+typedef void (*BltRowFunc)( void* dst, const void* src, int pixels, uint32_t alpha );
+
+/** Specialized row conversion of source and destination format pair. */
+struct BltKernel
+{
+	SurfaceFormat::SurfaceFormatType	src;
+	SurfaceFormat::SurfaceFormatType	dst;
+	BltRowFunc							func;
+	uint32_t							alpha;
+};
+
+/** Row conversion job of a pixel block. */
+struct BltJob
+{
+	const SurfaceFormat*	dstFormat;
+	uint8_t*				dst;
+	int						dstPitch;
+	const SurfaceFormat*	srcFormat;
+	const uint8_t*			src;
+	int						srcPitch;
+	int						width;
+	BltRowFunc				func;		// 0 if generic conversion is used
+	uint32_t				alpha;
+	int						copyBytes;	// >0 if rows are copied as is
+};
+
+/** ARGB8888 to R5G6B5. */
+struct ToR5G6B5
+{
+	uint32_t operator()( uint32_t c ) const
+	{
+		return ((c>>8)&0xF800) | ((c>>5)&0x07E0) | ((c>>3)&0x001F);
+	}
+
+#ifdef PIX_SSE2
+	__m128i operator()( __m128i c ) const
+	{
+		__m128i r = _mm_and_si128( _mm_srli_epi32(c,8), _mm_set1_epi32(0xF800) );
+		__m128i g = _mm_and_si128( _mm_srli_epi32(c,5), _mm_set1_epi32(0x07E0) );
+		__m128i b = _mm_and_si128( _mm_srli_epi32(c,3), _mm_set1_epi32(0x001F) );
+		return _mm_or_si128( _mm_or_si128(r,g), b );
+	}
+#endif
+};
+
+/** ARGB8888 to A1R5G5B5. */
+struct ToA1R5G5B5
+{
+	uint32_t operator()( uint32_t c ) const
+	{
+		return ((c>>16)&0x8000) | ((c>>9)&0x7C00) | ((c>>6)&0x03E0) | ((c>>3)&0x001F);
+	}
+
+#ifdef PIX_SSE2
+	__m128i operator()( __m128i c ) const
+	{
+		__m128i a = _mm_and_si128( _mm_srli_epi32(c,16), _mm_set1_epi32(0x8000) );
+		__m128i r = _mm_and_si128( _mm_srli_epi32(c,9), _mm_set1_epi32(0x7C00) );
+		__m128i g = _mm_and_si128( _mm_srli_epi32(c,6), _mm_set1_epi32(0x03E0) );
+		__m128i b = _mm_and_si128( _mm_srli_epi32(c,3), _mm_set1_epi32(0x001F) );
+		return _mm_or_si128( _mm_or_si128(a,r), _mm_or_si128(g,b) );
+	}
+#endif
+};
+
+/** ARGB8888 to A4R4G4B4. */
+struct ToA4R4G4B4
+{
+	uint32_t operator()( uint32_t c ) const
+	{
+		return ((c>>16)&0xF000) | ((c>>12)&0x0F00) | ((c>>8)&0x00F0) | ((c>>4)&0x000F);
+	}
+
+#ifdef PIX_SSE2
+	__m128i operator()( __m128i c ) const
+	{
+		__m128i a = _mm_and_si128( _mm_srli_epi32(c,16), _mm_set1_epi32(0xF000) );
+		__m128i r = _mm_and_si128( _mm_srli_epi32(c,12), _mm_set1_epi32(0x0F00) );
+		__m128i g = _mm_and_si128( _mm_srli_epi32(c,8), _mm_set1_epi32(0x00F0) );
+		__m128i b = _mm_and_si128( _mm_srli_epi32(c,4), _mm_set1_epi32(0x000F) );
+		return _mm_or_si128( _mm_or_si128(a,r), _mm_or_si128(g,b) );
+	}
+#endif
+};
+
+/** R5G6B5 to ARGB8888, low bits are zero as in SurfaceFormat::copyPixels. */
+struct FromR5G6B5
+{
+	uint32_t operator()( uint32_t c ) const
+	{
+		return ((c&0xF800)<<8) | ((c&0x07E0)<<5) | ((c&0x001F)<<3);
+	}
+
+#ifdef PIX_SSE2
+	__m128i operator()( __m128i c ) const
+	{
+		__m128i r = _mm_slli_epi32( _mm_and_si128(c,_mm_set1_epi32(0xF800)), 8 );
+		__m128i g = _mm_slli_epi32( _mm_and_si128(c,_mm_set1_epi32(0x07E0)), 5 );
+		__m128i b = _mm_slli_epi32( _mm_and_si128(c,_mm_set1_epi32(0x001F)), 3 );
+		return _mm_or_si128( _mm_or_si128(r,g), b );
+	}
+#endif
+};
+
+/** A1R5G5B5 to ARGB8888. */
+struct FromA1R5G5B5
+{
+	uint32_t operator()( uint32_t c ) const
+	{
+		return ((c&0x8000)<<16) | ((c&0x7C00)<<9) | ((c&0x03E0)<<6) | ((c&0x001F)<<3);
+	}
+
+#ifdef PIX_SSE2
+	__m128i operator()( __m128i c ) const
+	{
+		__m128i a = _mm_slli_epi32( _mm_and_si128(c,_mm_set1_epi32(0x8000)), 16 );
+		__m128i r = _mm_slli_epi32( _mm_and_si128(c,_mm_set1_epi32(0x7C00)), 9 );
+		__m128i g = _mm_slli_epi32( _mm_and_si128(c,_mm_set1_epi32(0x03E0)), 6 );
+		__m128i b = _mm_slli_epi32( _mm_and_si128(c,_mm_set1_epi32(0x001F)), 3 );
+		return _mm_or_si128( _mm_or_si128(a,r), _mm_or_si128(g,b) );
+	}
+#endif
+};
+
+/** A4R4G4B4 to ARGB8888. */
+struct FromA4R4G4B4
+{
+	uint32_t operator()( uint32_t c ) const
+	{
+		return ((c&0xF000)<<16) | ((c&0x0F00)<<12) | ((c&0x00F0)<<8) | ((c&0x000F)<<4);
+	}
+
+#ifdef PIX_SSE2
+	__m128i operator()( __m128i c ) const
+	{
+		__m128i a = _mm_slli_epi32( _mm_and_si128(c,_mm_set1_epi32(0xF000)), 16 );
+		__m128i r = _mm_slli_epi32( _mm_and_si128(c,_mm_set1_epi32(0x0F00)), 12 );
+		__m128i g = _mm_slli_epi32( _mm_and_si128(c,_mm_set1_epi32(0x00F0)), 8 );
+		__m128i b = _mm_slli_epi32( _mm_and_si128(c,_mm_set1_epi32(0x000F)), 4 );
+		return _mm_or_si128( _mm_or_si128(a,r), _mm_or_si128(g,b) );
+	}
+#endif
+};
+
+/** Converts row of 32-bit pixels to 16-bit pixels. */
+template <class Op> static inline void convert32to16( void* dst, const void* src, int pixels, uint32_t alpha, Op op )
+{
+	const uint32_t*	s	= reinterpret_cast<const uint32_t*>( src );
+	uint16_t*		d	= reinterpret_cast<uint16_t*>( dst );
+	int				i	= 0;
+
+#ifdef PIX_SSE2
+	// 8 pixels at a time, 16-bit results are sign extended for signed pack
+	const __m128i alpha4 = _mm_set1_epi32( alpha );
+	for ( ; i+8 <= pixels ; i += 8 )
+	{
+		__m128i c0 = op( _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s+i)),alpha4) );
+		__m128i c1 = op( _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s+i+4)),alpha4) );
+		c0 = _mm_srai_epi32( _mm_slli_epi32(c0,16), 16 );
+		c1 = _mm_srai_epi32( _mm_slli_epi32(c1,16), 16 );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>(d+i), _mm_packs_epi32(c0,c1) );
+	}
+#endif
+
+	for ( ; i < pixels ; ++i )
+		d[i] = (uint16_t)op( s[i] | alpha );
+}
+
+/** Converts row of 16-bit pixels to 32-bit pixels. */
+template <class Op> static inline void convert16to32( void* dst, const void* src, int pixels, uint32_t alpha, Op op )
+{
+	const uint16_t*	s	= reinterpret_cast<const uint16_t*>( src );
+	uint32_t*		d	= reinterpret_cast<uint32_t*>( dst );
+	int				i	= 0;
+
+#ifdef PIX_SSE2
+	const __m128i alpha4 = _mm_set1_epi32( alpha );
+	const __m128i zero = _mm_setzero_si128();
+	for ( ; i+8 <= pixels ; i += 8 )
+	{
+		__m128i c = _mm_loadu_si128( reinterpret_cast<const __m128i*>(s+i) );
+		__m128i c0 = _mm_or_si128( op(_mm_unpacklo_epi16(c,zero)), alpha4 );
+		__m128i c1 = _mm_or_si128( op(_mm_unpackhi_epi16(c,zero)), alpha4 );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>(d+i), c0 );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>(d+i+4), c1 );
+	}
+#endif
+
+	for ( ; i < pixels ; ++i )
+		d[i] = op( s[i] ) | alpha;
+}
+
+static void bltRowToR5G6B5( void* dst, const void* src, int pixels, uint32_t alpha )
+{
+	convert32to16( dst, src, pixels, alpha, ToR5G6B5() );
+}
+
+static void bltRowToA1R5G5B5( void* dst, const void* src, int pixels, uint32_t alpha )
+{
+	convert32to16( dst, src, pixels, alpha, ToA1R5G5B5() );
+}
+
+static void bltRowToA4R4G4B4( void* dst, const void* src, int pixels, uint32_t alpha )
+{
+	convert32to16( dst, src, pixels, alpha, ToA4R4G4B4() );
+}
+
+static void bltRowFromR5G6B5( void* dst, const void* src, int pixels, uint32_t alpha )
+{
+	convert16to32( dst, src, pixels, alpha, FromR5G6B5() );
+}
+
+static void bltRowFromA1R5G5B5( void* dst, const void* src, int pixels, uint32_t alpha )
+{
+	convert16to32( dst, src, pixels, alpha, FromA1R5G5B5() );
+}
+
+static void bltRowFromA4R4G4B4( void* dst, const void* src, int pixels, uint32_t alpha )
+{
+	convert16to32( dst, src, pixels, alpha, FromA4R4G4B4() );
+}
+
+/** Copies 32-bit pixels and sets alpha bits. */
+static void bltRowSetAlpha32( void* dst, const void* src, int pixels, uint32_t alpha )
+{
+	const uint32_t*	s	= reinterpret_cast<const uint32_t*>( src );
+	uint32_t*		d	= reinterpret_cast<uint32_t*>( dst );
+	int				i	= 0;
+
+#ifdef PIX_SSE2
+	const __m128i alpha4 = _mm_set1_epi32( alpha );
+	for ( ; i+4 <= pixels ; i += 4 )
+		_mm_storeu_si128( reinterpret_cast<__m128i*>(d+i), _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s+i)),alpha4) );
+#endif
+
+	for ( ; i < pixels ; ++i )
+		d[i] = s[i] | alpha;
+}
+
+/** R8G8B8 to 32-bit pixels. */
+static void bltRowFromR8G8B8( void* dst, const void* src, int pixels, uint32_t alpha )
+{
+	const uint8_t*	s	= reinterpret_cast<const uint8_t*>( src );
+	uint32_t*		d	= reinterpret_cast<uint32_t*>( dst );
+
+	for ( int i = 0 ; i < pixels ; ++i )
+	{
+		d[i] = uint32_t(s[0]) | (uint32_t(s[1])<<8) | (uint32_t(s[2])<<16) | alpha;
+		s += 3;
+	}
+}
+
+/** 32-bit pixels to R8G8B8. */
+static void bltRowToR8G8B8( void* dst, const void* src, int pixels, uint32_t /*alpha*/ )
+{
+	const uint32_t*	s	= reinterpret_cast<const uint32_t*>( src );
+	uint8_t*		d	= reinterpret_cast<uint8_t*>( dst );
+
+	for ( int i = 0 ; i < pixels ; ++i )
+	{
+		uint32_t c = s[i];
+		d[0] = (uint8_t)c;
+		d[1] = (uint8_t)(c>>8);
+		d[2] = (uint8_t)(c>>16);
+		d += 3;
+	}
+}
+
+/** R8G8B8 to R5G6B5. */
+static void bltRowR8G8B8toR5G6B5( void* dst, const void* src, int pixels, uint32_t /*alpha*/ )
+{
+	const uint8_t*	s	= reinterpret_cast<const uint8_t*>( src );
+	uint16_t*		d	= reinterpret_cast<uint16_t*>( dst );
+	ToR5G6B5		op;
+
+	for ( int i = 0 ; i < pixels ; ++i )
+	{
+		d[i] = (uint16_t)op( uint32_t(s[0]) | (uint32_t(s[1])<<8) | (uint32_t(s[2])<<16) );
+		s += 3;
+	}
+}
+
+/** 
+ * Specialized conversions of common format pairs. 
+ * Formats without alpha channel have unused bits set, 
+ * so the alpha bits are forced on for them. 
+ */
+static const BltKernel s_kernels[] =
+{
+	{SurfaceFormat::SURFACE_R8G8B8,		SurfaceFormat::SURFACE_A8R8G8B8,	bltRowFromR8G8B8,		0xFF000000},
+	{SurfaceFormat::SURFACE_R8G8B8,		SurfaceFormat::SURFACE_X8R8G8B8,	bltRowFromR8G8B8,		0xFF000000},
+	{SurfaceFormat::SURFACE_R8G8B8,		SurfaceFormat::SURFACE_R5G6B5,		bltRowR8G8B8toR5G6B5,	0},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_R8G8B8,		bltRowToR8G8B8,			0},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_R8G8B8,		bltRowToR8G8B8,			0},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_X8R8G8B8,	bltRowSetAlpha32,		0xFF000000},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_A8R8G8B8,	bltRowSetAlpha32,		0xFF000000},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_X8R8G8B8,	bltRowSetAlpha32,		0xFF000000},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_R5G6B5,		bltRowToR5G6B5,			0},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_R5G6B5,		bltRowToR5G6B5,			0},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_A1R5G5B5,	bltRowToA1R5G5B5,		0},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_A1R5G5B5,	bltRowToA1R5G5B5,		0xFF000000},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_R5G5B5,		bltRowToA1R5G5B5,		0xFF000000},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_R5G5B5,		bltRowToA1R5G5B5,		0xFF000000},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_A4R4G4B4,	bltRowToA4R4G4B4,		0},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_A4R4G4B4,	bltRowToA4R4G4B4,		0xFF000000},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_X4R4G4B4,	bltRowToA4R4G4B4,		0xFF000000},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_X4R4G4B4,	bltRowToA4R4G4B4,		0xFF000000},
+	{SurfaceFormat::SURFACE_R5G6B5,		SurfaceFormat::SURFACE_A8R8G8B8,	bltRowFromR5G6B5,		0xFF000000},
+	{SurfaceFormat::SURFACE_R5G6B5,		SurfaceFormat::SURFACE_X8R8G8B8,	bltRowFromR5G6B5,		0xFF000000},
+	{SurfaceFormat::SURFACE_A1R5G5B5,	SurfaceFormat::SURFACE_A8R8G8B8,	bltRowFromA1R5G5B5,		0},
+	{SurfaceFormat::SURFACE_R5G5B5,		SurfaceFormat::SURFACE_A8R8G8B8,	bltRowFromA1R5G5B5,		0xFF000000},
+	{SurfaceFormat::SURFACE_A4R4G4B4,	SurfaceFormat::SURFACE_A8R8G8B8,	bltRowFromA4R4G4B4,		0},
+	{SurfaceFormat::SURFACE_X4R4G4B4,	SurfaceFormat::SURFACE_A8R8G8B8,	bltRowFromA4R4G4B4,		0xFF000000},
+};
+
+/** Number of specialized conversions. */
+const int KERNELS = sizeof(s_kernels)/sizeof(s_kernels[0]);
+
+/** Converts rows [y0,y1) of the pixel block. */
+static void bltRows( const BltJob& job, int y0, int y1 )
+{
+	for ( int j = y0 ; j < y1 ; ++j )
+	{
+		const uint8_t*	src		= job.src + job.srcPitch * j;
+		uint8_t*		dst		= job.dst + job.dstPitch * j;
+
+		if ( job.copyBytes > 0 )
+			memcpy( dst, src, job.copyBytes );
+		else if ( job.func )
+			job.func( dst, src, job.width, job.alpha );
+		else
+			job.dstFormat->copyPixels( dst, *job.srcFormat, src, job.width );
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+/** Converts share of rows of a pixel block. */
+class BltThread :
+	public Thread
+{
+public:
+	BltThread() :
+		m_job(0), m_y0(0), m_y1(0)
+	{
+	}
+
+	void setWork( const BltJob* job, int y0, int y1 )
+	{
+		m_job = job;
+		m_y0 = y0;
+		m_y1 = y1;
+	}
+
+	void run()
+	{
+		bltRows( *m_job, m_y0, m_y1 );
+	}
+
+private:
+	const BltJob*	m_job;
+	int				m_y0;
+	int				m_y1;
+
+	BltThread( const BltThread& );
+	BltThread& operator=( const BltThread& );
+};
+
+//-----------------------------------------------------------------------------
+
+/** Number of threads used by blt, 0 for processor count. */
+static int s_threads = 0;
+
+/** Returns number of processors in the system. */
+static int processorCount()
+{
+#ifdef WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	int n = (int)info.dwNumberOfProcessors;
+#else
+	int n = (int)sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+	return n > 0 ? n : 1;
+}
+
+/** Prepares row conversion job of a pixel block without dithering. */
+static void initBltJob( BltJob& job, 
+	const SurfaceFormat& dstFormat, int width, void* dstData, int dstPitch,
+	const SurfaceFormat& srcFormat, const void* srcData, int srcPitch )
+{
+	job.dstFormat = &dstFormat;
+	job.dst = reinterpret_cast<uint8_t*>( dstData );
+	job.dstPitch = dstPitch;
+	job.srcFormat = &srcFormat;
+	job.src = reinterpret_cast<const uint8_t*>( srcData );
+	job.srcPitch = srcPitch;
+	job.width = width;
+	job.func = 0;
+	job.alpha = 0;
+	job.copyBytes = 0;
+
+	// identical formats without unused bits can be copied as is
+	if ( dstFormat == srcFormat )
+	{
+		uint32_t usedBits = 0;
+		for ( int i = 0 ; i < 4 ; ++i )
+			usedBits |= (uint32_t)srcFormat.getChannelMask(i);
+		uint32_t pixelBits = 0xFFFFFFFF >> (32 - srcFormat.pixelSize()*8);
+		if ( usedBits == pixelBits )
+		{
+			job.copyBytes = width * srcFormat.pixelSize();
+			return;
+		}
+	}
+
+	for ( int i = 0 ; i < KERNELS ; ++i )
+	{
+		const BltKernel& kernel = s_kernels[i];
+		if ( kernel.src == srcFormat.type() && kernel.dst == dstFormat.type() )
+		{
+			job.func = kernel.func;
+			job.alpha = kernel.alpha;
+			break;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+
 void SurfaceUtil::blt( 
 	const SurfaceFormat& dstFormat, int dstWidth, int dstHeight, void* dstData, int dstPitch,
-	const SurfaceFormat& srcFormat, const void* srcData, int srcPitch )
+	const SurfaceFormat& srcFormat, const void* srcData, int srcPitch, bool dither )
 {
 	const int		width			= dstWidth;
 	const int		height			= dstHeight;
 	const int		srcPixelSize	= srcFormat.pixelSize();
 	const int		dstPixelSize	= dstFormat.pixelSize();
 
+	// is dithering needed?
+	if ( dither )
+	{
+		dither = false;
+		for ( int i = 0 ; i < 4 ; ++i )
+		{
+			if ( countBits(srcFormat.getChannelMask(i)) >
+				countBits(dstFormat.getChannelMask(i)) )
+			{
+				dither = true;
+				break;
+			}
+		}
+	}
+
+	// copy rows without dithering, calling thread takes the first share
+	if ( !dither )
+	{
+		BltJob job;
+		initBltJob( job, dstFormat, width, dstData, dstPitch, srcFormat, srcData, srcPitch );
+
+		int threads = SurfaceUtil::threads();
+		if ( threads > width*height/MIN_PIXELS_PER_THREAD )
+			threads = width*height/MIN_PIXELS_PER_THREAD;
+		if ( threads > height )
+			threads = height;
+		if ( threads < 1 )
+			threads = 1;
+		Vector<P(BltThread)> workers( Allocator<P(BltThread)>(__FILE__,__LINE__) );
+		while ( workers.size() < threads-1 )
+			workers.add( new BltThread );
+
+		int started = 0;
+		for ( ; started < threads-1 ; ++started )
+		{
+			BltThread* worker = workers[started];
+			int share = started + 1;
+			worker->setWork( &job, height*share/threads, height*(share+1)/threads );
+			try
+			{
+				worker->start();
+			}
+			catch ( ... )
+			{
+				break;
+			}
+		}
+
+		// shares of the workers which failed to start are converted here too
+		bltRows( job, 0, height/threads );
+		if ( started < threads-1 )
+			bltRows( job, height*(started+1)/threads, height );
+
+		for ( int k = 0 ; k < started ; ++k )
+			workers[k]->join();
+		return;
+	}
+
 	// error diffusion buffers (4 channels, 2 rows, 2 pixels extra)
 	const int CHANNELS = 4;
 	const int BUFFER_ROWS = 2;
@@ -361,18 +878,7 @@ void SurfaceUtil::blt(
 		}
 	}
 
-	// is dithering needed?
-	bool dither = false;
-	for ( int i = 0 ; i < CHANNELS ; ++i )
-		if ( countBits(srcFormat.getChannelMask(i)) >
-			countBits(dstFormat.getChannelMask(i)) )
-		{
-			dither = true;
-			break;
-		}
-
-	// copy pixel block
-	if ( dither )
+	// copy pixel block with dithering
 	{
 		// for each row
 		for ( int j = 0 ; j < height ; ++j )
@@ -523,22 +1029,11 @@ void SurfaceUtil::blt(
 			} // for each channel
 		}
 	} 
-	else // !dither
-	{
-		// for each row
-		for ( int j = 0 ; j < height ; ++j )
-		{
-			const uint8_t*	src		= reinterpret_cast<const uint8_t*>( srcData ) + srcPitch * j;
-			uint8_t*		dst		= reinterpret_cast<uint8_t*>( dstData ) + dstPitch * j;
-
-			dstFormat.copyPixels( dst, srcFormat, src, width );
-		}
-	}
 }
 
 void SurfaceUtil::blt( 
 	const SurfaceFormat& dstFormat, int dstX, int dstY, int dstWidth, int dstHeight, void* dstData, int dstPitch,
-	const SurfaceFormat& srcFormat, int srcX, int srcY, int srcWidth, int srcHeight, const void* srcData, int srcPitch )
+	const SurfaceFormat& srcFormat, int srcX, int srcY, int srcWidth, int srcHeight, const void* srcData, int srcPitch, bool dither )
 {
 	assert( dstX >= 0 );
 	assert( dstY >= 0 );
@@ -556,7 +1051,7 @@ void SurfaceUtil::blt(
 		uint8_t*		dst				= reinterpret_cast<uint8_t*>(dstData) + dstX * dstPixelSize + dstY * dstPitch;
 		const uint8_t*	src				= reinterpret_cast<const uint8_t*>(srcData) + srcX * srcPixelSize + srcY * srcPitch;
 
-		blt( dstFormat, dstWidth, dstHeight, dst, dstPitch, srcFormat, src, srcPitch );
+		blt( dstFormat, dstWidth, dstHeight, dst, dstPitch, srcFormat, src, srcPitch, dither );
 	}
 	else
 	{
@@ -587,10 +1082,21 @@ void SurfaceUtil::blt(
 		const int	dstPixelSize	= dstFormat.pixelSize();
 		uint8_t*	dst				= reinterpret_cast<uint8_t*>(dstData) + dstX * dstPixelSize + dstY * dstPitch;
 
-		blt( dstFormat, dstWidth, dstHeight, dst, dstPitch, srcFormat, buf.data(), bufPitch );
+		blt( dstFormat, dstWidth, dstHeight, dst, dstPitch, srcFormat, buf.data(), bufPitch, dither );
 	}
 }
 
+void SurfaceUtil::setThreads( int count )
+{
+	assert( count >= 0 );
+	s_threads = count;
+}
+
+int SurfaceUtil::threads()
+{
+	return s_threads > 0 ? s_threads : processorCount();
+}
+
 long SurfaceUtil::getPixel( int x, int y, 
 	int width, int height, 
 	const void* data, int pitch, 
@@ -27,21 +27,39 @@ public:
 
 	/** 
 	 * Copies block of pixels from one surface format to another. 
-	 * Uses Floyd-Steinberg dithering.
+	 * Common format pairs are converted with specialized row kernels
+	 * and large blocks are converted in parallel, see setThreads().
+	 * Results are identical to per pixel conversion with SurfaceFormat::copyPixels
+	 * unless the block is dithered.
+	 * @param dither If true (default) then Floyd-Steinberg dithering is used when 
+	 * destination format has less bits in some channel than source format.
 	 */
 	static void		blt( const SurfaceFormat& dstFormat, int dstWidth, int dstHeight, void* dstData, int dstPitch, 
-						const SurfaceFormat& srcFormat, const void* srcData, int srcPitch );
+						const SurfaceFormat& srcFormat, const void* srcData, int srcPitch,
+						bool dither=true );
 
 	/** 
 	 * Copies block of pixels from one surface format to another. 
-	 * Uses Floyd-Steinberg dithering. Stretches/shrinks source image if needed.
+	 * Stretches/shrinks source image if needed.
+	 * @param dither If true (default) then Floyd-Steinberg dithering is used when 
+	 * destination format has less bits in some channel than source format.
 	 */
 	static void		blt( const SurfaceFormat& dstFormat, 
 						int dstX, int dstY, int dstWidth, int dstHeight, 
 						void* dstData, int dstPitch, 
 						const SurfaceFormat& srcFormat, 
 						int srcX, int srcY, int srcWidth, int srcHeight, 
-						const void* srcData, int srcPitch );
+						const void* srcData, int srcPitch,
+						bool dither=true );
+
+	/** 
+	 * Sets number of threads used to convert large pixel blocks without dithering. 
+	 * Default is 0, which uses one thread per processor.
+	 */
+	static void		setThreads( int count );
+
+	/** Returns number of threads used to convert large pixel blocks. */
+	static int		threads();
 };
 
 
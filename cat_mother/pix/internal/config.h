@@ -1,3 +1,8 @@
 #ifdef _MSC_VER
 #include <config_msvc.h>
 #endif
+
+// Use SSE2 pixel conversion kernels if the compiler generates SSE2 code
+#if !defined(PIX_NO_SSE2) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define PIX_SSE2
+#endif
@@ -10,7 +10,6 @@
 #include <math.h>
 #include <string.h>
 #include <assert.h>
-#include <algorithm>
 #include "config.h"
 
 //-----------------------------------------------------------------------------
@@ -30,9 +29,9 @@ namespace pix
 	{
 		int pitch = -1;
 		if ( format == SurfaceFormat::SURFACE_DXT1 )
-			pitch = width * 2;
+			pitch = (width+3)/4 * 8;
 		else if ( format == SurfaceFormat::SURFACE_DXT3 || format == SurfaceFormat::SURFACE_DXT5 )
-			pitch = width * 4;
+			pitch = (width+3)/4 * 16;
 		else if ( format.bltSupported() )
 			pitch = width * format.pixelSize();
 		else
@@ -60,7 +59,7 @@ namespace pix
 			int mmdatasize = -1;
 			if ( format.compressed() )
 			{
-				mmdatasize = __max(1, w / 4) * __max(1, h / 4);
+				mmdatasize = (w+3)/4 * ((h+3)/4);
 				mmdatasize *= cellsize;
 			}
 			else
@@ -154,7 +153,7 @@ namespace pix
 		{
 			if ( *pfFlags & DDPF_FOURCC )
 			{
-				datasize = __max(1, *width / 4) * __max(1, *height / 4) * 8;
+				datasize = (*width+3)/4 * ((*height+3)/4) * 8;
 				if ( memcmp(pfFourCC, "DXT1", 4) != 0 ) 
 					datasize *= 2; 
 			}
@@ -187,19 +186,19 @@ namespace pix
 			if (memcmp(pfFourCC, "DXT1", 4) == 0 )
 			{
 				*format = SurfaceFormat( SurfaceFormat::SURFACE_DXT1 );
-				*pitch = *width * 2;
+				*pitch = (*width+3)/4 * 8;
 				mindatasize = 8;
 			}
 			else if (memcmp(pfFourCC, "DXT3", 4) == 0 )
 			{
 				*format = SurfaceFormat( SurfaceFormat::SURFACE_DXT3 );
-				*pitch = *width * 4;
+				*pitch = (*width+3)/4 * 16;
 				mindatasize = 16;
 			}
 			else if (memcmp(pfFourCC, "DXT5", 4) == 0 )
 			{
 				*format = SurfaceFormat( SurfaceFormat::SURFACE_DXT5 );
-				*pitch = *width * 4;
+				*pitch = (*width+3)/4 * 16;
 				mindatasize = 16;
 			}
 			else
@@ -256,5 +255,127 @@ namespace pix
 	}
 
 
-} // pix
+	bool saveDDS( io::OutputStream* file, const lang::Array<Surface>& surfaces, int mipmaplevels, Image::ImageType type )
+	{
+		const int faces = ( type == Image::TYPE_CUBEMAP ? 6 : 1 );
+		if ( mipmaplevels < 1 || surfaces.size() < faces*mipmaplevels )
+		{
+			Debug::printlnError( "saveDDS: Invalid surface count" );
+			return false;
+		}
+
+		const Surface&		surface		= surfaces[0];
+		const SurfaceFormat	format		= surface.format();
+		const int			width		= surface.width();
+		const int			height		= surface.height();
+
+		uint32_t header[31];
+		memset( header, 0, sizeof(header) );
+
+		uint32_t* dwSize		= &header[0];
+		uint32_t* dwFlags		= &header[1];
+		uint32_t* dwHeight		= &header[2];
+		uint32_t* dwWidth		= &header[3];
+		uint32_t* dwPitchOrSize	= &header[4];
+		uint32_t* dwMipMapCount	= &header[6];
+		uint32_t* pfSize		= &header[18];
+		uint32_t* pfFlags		= &header[19];
+		char* pfFourCC			= reinterpret_cast<char*>( &header[20] );
+		uint32_t* pfRGBBitCount	= &header[21];
+		uint32_t* pfBitMasks	= &header[22];
+		uint32_t* dwCaps1		= &header[26];
+		uint32_t* dwCaps2		= &header[27];
+
+		*dwSize = 124;
+		*dwFlags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT;
+		*dwHeight = (uint32_t)height;
+		*dwWidth = (uint32_t)width;
+		*dwMipMapCount = (uint32_t)mipmaplevels;
+		*pfSize = 32;
+
+		// translate pixelformat
+
+		int cellsize = 0;
+		if ( format == SurfaceFormat::SURFACE_DXT1 )
+		{
+			memcpy( pfFourCC, "DXT1", 4 );
+			cellsize = 8;
+		}
+		else if ( format == SurfaceFormat::SURFACE_DXT3 )
+		{
+			memcpy( pfFourCC, "DXT3", 4 );
+			cellsize = 16;
+		}
+		else if ( format == SurfaceFormat::SURFACE_DXT5 )
+		{
+			memcpy( pfFourCC, "DXT5", 4 );
+			cellsize = 16;
+		}
+		else if ( !format.bltSupported() )
+		{
+			Debug::printlnError( "saveDDS: Unsupported Pixelformat" );
+			return false;
+		}
 
+		if ( format.compressed() )
+		{
+			*dwFlags |= DDSD_LINEARSIZE;
+			*dwPitchOrSize = (uint32_t)( (width+3)/4 * ((height+3)/4) * cellsize );
+			*pfFlags = DDPF_FOURCC;
+		}
+		else
+		{
+			*dwFlags |= DDSD_PITCH;
+			*dwPitchOrSize = (uint32_t)( width * format.pixelSize() );
+			*pfFlags = DDPF_RGB;
+			*pfRGBBitCount = (uint32_t)( format.pixelSize() * 8 );
+			for ( int i = 0 ; i < 4 ; ++i )
+				pfBitMasks[i] = (uint32_t)format.getChannelMask( i );
+			if ( pfBitMasks[3] != 0 )
+				*pfFlags |= DDPF_ALPHAPIXELS;
+		}
+
+		*dwCaps1 = DDSCAPS_TEXTURE;
+		if ( mipmaplevels > 1 )
+			*dwCaps1 |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+		if ( type == Image::TYPE_CUBEMAP )
+		{
+			*dwCaps1 |= DDSCAPS_COMPLEX;
+			*dwCaps2 = DDSCAPS2_CUBEMAP | 
+				DDSCAPS2_CUBEMAP_POSITIVEX | DDSCAPS2_CUBEMAP_NEGATIVEX |
+				DDSCAPS2_CUBEMAP_POSITIVEY | DDSCAPS2_CUBEMAP_NEGATIVEY |
+				DDSCAPS2_CUBEMAP_POSITIVEZ | DDSCAPS2_CUBEMAP_NEGATIVEZ;
+		}
+
+		file->write( "DDS ", 4 );
+		file->write( header, sizeof(header) );
+
+		// write each face followed by its mipmaps, rows without padding
+
+		for ( int i = 0 ; i < faces*mipmaplevels ; ++i )
+		{
+			const Surface& s = surfaces[i];
+			if ( s.format() != format )
+			{
+				Debug::printlnError( "saveDDS: Surface formats differ" );
+				return false;
+			}
+
+			if ( format.compressed() )
+			{
+				int datasize = (s.width()+3)/4 * ((s.height()+3)/4) * cellsize;
+				assert( datasize <= s.dataSize() );
+				file->write( s.data(), datasize );
+			}
+			else
+			{
+				const uint8_t* data = reinterpret_cast<const uint8_t*>( s.data() );
+				for ( int j = 0 ; j < s.height() ; ++j )
+					file->write( data + j*s.pitch(), s.width()*format.pixelSize() );
+			}
+		}
+		return true;
+	}
+
+
+} // pix
@@ -59,5 +59,13 @@ enum DDS_dwCaps2 {
  */
 bool loadDDS( io::InputStream* file, int* width, int* height, int* pitch, int* mipMapLevels, SurfaceFormat* format, Image::ImageType* type, lang::Array<Surface>& surfaces );
 
+/** 
+ * Saves surfaces to a file in DDS format. 
+ * Surfaces are arranged like in Image: each face followed by its mipmaps.
+ * All surfaces must be in the same format.
+ * @return true if image saved ok.
+ */
+bool saveDDS( io::OutputStream* file, const lang::Array<Surface>& surfaces, int mipMapLevels, Image::ImageType type );
+
 
 }
@@ -93,10 +93,18 @@ SOURCE=.\Colorf.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\DXTCompressor.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\Image.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\MipMapGenerator.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\Surface.cpp
 # End Source File
 # Begin Source File
@@ -121,10 +129,18 @@ SOURCE=.\Colorf.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\DXTCompressor.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Image.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\MipMapGenerator.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Surface.h
 # End Source File
 # Begin Source File
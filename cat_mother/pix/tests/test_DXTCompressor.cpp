@@ -0,0 +1,229 @@
+#include <tester/Test.h>
+#include <pix/Image.h>
+#include <pix/Surface.h>
+#include <pix/SurfaceFormat.h>
+#include <pix/DXTCompressor.h>
+#include <pix/MipMapGenerator.h>
+#include <io/ByteArrayInputStream.h>
+#include <io/ByteArrayOutputStream.h>
+#include <dev/TimeStamp.h>
+#include <lang/Array.h>
+#include <lang/String.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+//-----------------------------------------------------------------------------
+
+using namespace io;
+using namespace dev;
+using namespace pix;
+using namespace lang;
+
+//-----------------------------------------------------------------------------
+
+/** Fills surface with gradients, hard edges, noise and alpha ramp. */
+static void fillTestImage( Surface& s )
+{
+	uint32_t seed = 12345;
+	for ( int y = 0 ; y < s.height() ; ++y )
+	{
+		for ( int x = 0 ; x < s.width() ; ++x )
+		{
+			seed = seed * 1664525 + 1013904223;
+			int noise = (int)(seed >> 28) - 8;
+
+			int r = x * 255 / s.width();
+			int g = y * 255 / s.height();
+			int b = ((x/32 + y/32) & 1) ? 200 : 40;
+			int a = (x + y) * 255 / (s.width() + s.height());
+			if ( (x/16 + y/16) % 3 == 0 )
+				a = (x & 2) ? 255 : 64 + ((x*37 + y*11) & 0x3F);
+			if ( x > s.width()/2 )
+			{
+				r += noise;
+				g += noise;
+				b += noise;
+			}
+			r = r < 0 ? 0 : (r > 255 ? 255 : r);
+			g = g < 0 ? 0 : (g > 255 ? 255 : g);
+			b = b < 0 ? 0 : (b > 255 ? 255 : b);
+			s.setPixel( x, y, (a<<24) + (r<<16) + (g<<8) + b );
+		}
+	}
+}
+
+/** Returns root mean square error of color (and alpha) channels of the compressed surface. */
+static double rmse( const Surface& src, const Surface& dxt, bool alpha )
+{
+	double sum = 0.0;
+	for ( int y = 0 ; y < src.height() ; ++y )
+	{
+		for ( int x = 0 ; x < src.width() ; ++x )
+		{
+			uint32_t c0 = (uint32_t)src.getPixel( x, y );
+			uint32_t c1 = (uint32_t)dxt.getPixel( x, y );
+			for ( int k = (alpha ? 24 : 0) ; k < (alpha ? 32 : 24) ; k += 8 )
+			{
+				int d = (int)((c0>>k)&0xFF) - (int)((c1>>k)&0xFF);
+				sum += d*d;
+			}
+		}
+	}
+	return sqrt( sum / (src.width()*src.height()*(alpha ? 1 : 3)) );
+}
+
+/** Compresses the surface, prints speed and error and checks results do not depend on threads. */
+static double testCompress( const Surface& src, const SurfaceFormat& format, DXTCompressor::Quality quality, const char* name )
+{
+	DXTCompressor compressor( quality );
+	Surface dxt;
+
+	TimeStamp t0;
+	compressor.compress( format, src, dxt );
+	TimeStamp t1;
+	double time = (t1-t0).seconds();
+
+	assert( dxt.format() == format );
+	assert( dxt.width() == src.width() && dxt.height() == src.height() );
+	assert( dxt.dataSize() == DXTCompressor::compressedSize(format,src.width(),src.height()) );
+
+	double colorError = rmse( src, dxt, false );
+	double alphaError = rmse( src, dxt, true );
+	printf( "%s %s: %.1f MPixels/s, RMSE color %.2f, alpha %.2f\n", name,
+		quality == DXTCompressor::QUALITY_HIGH ? "high" : "fast",
+		src.width()*src.height() / (time > 1e-6 ? time : 1e-6) / 1e6, colorError, alphaError );
+
+	for ( int threads = 1 ; threads <= 4 ; threads += 3 )
+	{
+		Surface dxt2;
+		compressor.setThreads( threads );
+		compressor.compress( format, src, dxt2 );
+		assert( !memcmp(dxt.data(),dxt2.data(),dxt.dataSize()) );
+	}
+
+	assert( colorError < 8.0 );
+	if ( format != SurfaceFormat::SURFACE_DXT1 )
+		assert( alphaError < 10.0 );
+	return colorError;
+}
+
+static int test()
+{
+	// compression speed and error
+	{
+		Surface src( 512, 512, SurfaceFormat::SURFACE_A8R8G8B8 );
+		fillTestImage( src );
+
+		// DXT1 compares to opaque source
+		Surface opaque( 512, 512, SurfaceFormat::SURFACE_R8G8B8 );
+		opaque.blt( &src );
+
+		double fast = testCompress( opaque, SurfaceFormat::SURFACE_DXT1, DXTCompressor::QUALITY_FAST, "DXT1" );
+		double high = testCompress( opaque, SurfaceFormat::SURFACE_DXT1, DXTCompressor::QUALITY_HIGH, "DXT1" );
+		assert( high < fast );
+		testCompress( src, SurfaceFormat::SURFACE_DXT3, DXTCompressor::QUALITY_FAST, "DXT3" );
+		testCompress( src, SurfaceFormat::SURFACE_DXT3, DXTCompressor::QUALITY_HIGH, "DXT3" );
+		fast = testCompress( src, SurfaceFormat::SURFACE_DXT5, DXTCompressor::QUALITY_FAST, "DXT5" );
+		high = testCompress( src, SurfaceFormat::SURFACE_DXT5, DXTCompressor::QUALITY_HIGH, "DXT5" );
+		assert( high < fast );
+	}
+
+	// colors varying only along an axis orthogonal to grey, e.g. red/green checker
+	{
+		Surface src( 4, 4, SurfaceFormat::SURFACE_A8R8G8B8 );
+		for ( int y = 0 ; y < src.height() ; ++y )
+			for ( int x = 0 ; x < src.width() ; ++x )
+				src.setPixel( x, y, (x+y) & 1 ? 0xFF00FF00 : 0xFFFF0000 );
+
+		for ( int q = 0 ; q < 2 ; ++q )
+		{
+			Surface dxt;
+			DXTCompressor( q ? DXTCompressor::QUALITY_HIGH : DXTCompressor::QUALITY_FAST ).compress( SurfaceFormat::SURFACE_DXT1, src, dxt );
+			assert( rmse(src,dxt,false) < 4.0 );
+		}
+	}
+
+	// partial blocks and 1-bit alpha
+	{
+		Surface src( 37, 5, SurfaceFormat::SURFACE_A8R8G8B8 );
+		for ( int y = 0 ; y < src.height() ; ++y )
+			for ( int x = 0 ; x < src.width() ; ++x )
+				src.setPixel( x, y, x < 20 ? 0xFF336699 : 0x10FFFFFF );
+
+		Surface dxt;
+		DXTCompressor().compress( SurfaceFormat::SURFACE_DXT1, src, dxt );
+		assert( dxt.pitch() == 10*8 );
+		for ( int y = 0 ; y < src.height() ; ++y )
+		{
+			for ( int x = 0 ; x < src.width() ; ++x )
+			{
+				uint32_t c = (uint32_t)dxt.getPixel( x, y );
+				if ( x < 20 )
+					assert( c>>24 == 0xFF && abs((int)((c>>8)&0xFF)-0x66) <= 4 );
+				else
+					assert( c>>24 == 0 );
+			}
+		}
+	}
+
+	// mipmap chain size and gamma correct filtering
+	{
+		Surface src( 37, 5, SurfaceFormat::SURFACE_R5G6B5 );
+		Array<Surface> levels;
+		MipMapGenerator().generate( src, levels );
+		assert( levels.size() == 6 && MipMapGenerator::levels(37,5) == 6 );
+		assert( levels[1].width() == 18 && levels[1].height() == 2 );
+		assert( levels[5].width() == 1 && levels[5].height() == 1 );
+		assert( levels[5].format() == SurfaceFormat::SURFACE_R5G6B5 );
+
+		Surface checker( 2, 2, SurfaceFormat::SURFACE_A8R8G8B8 );
+		checker.setPixel( 0, 0, 0xFFFFFFFF );
+		checker.setPixel( 1, 0, 0xFF000000 );
+		checker.setPixel( 0, 1, 0xFF000000 );
+		checker.setPixel( 1, 1, 0xFFFFFFFF );
+		MipMapGenerator(MipMapGenerator::FILTER_BOX,1.f).generate( checker, levels );
+		assert( (uint32_t)levels[1].getPixel(0,0) == 0xFF808080 );
+		MipMapGenerator(MipMapGenerator::FILTER_BOX,2.2f).generate( checker, levels );
+		assert( (uint32_t)levels[1].getPixel(0,0) == 0xFFBABABA );
+
+		Surface flat( 64, 32, SurfaceFormat::SURFACE_A8R8G8B8 );
+		for ( int y = 0 ; y < flat.height() ; ++y )
+			for ( int x = 0 ; x < flat.width() ; ++x )
+				flat.setPixel( x, y, 0x80406080 );
+		MipMapGenerator(MipMapGenerator::FILTER_KAISER).generate( flat, levels );
+		for ( int i = 0 ; i < levels.size() ; ++i )
+			assert( (uint32_t)levels[i].getPixel(0,0) == 0x80406080 );
+	}
+
+	// compressed DDS with mipmaps can be saved and loaded back
+	{
+		Image img( 64, 64, SurfaceFormat::SURFACE_A8R8G8B8 );
+		fillTestImage( img.surface() );
+		img.generateMipMaps( MipMapGenerator(MipMapGenerator::FILTER_KAISER) );
+		img.compress( SurfaceFormat::SURFACE_DXT5, DXTCompressor(DXTCompressor::QUALITY_HIGH) );
+		assert( img.mipMapLevels() == 7 && img.surfaces() == 7 );
+
+		P(ByteArrayOutputStream) out = new ByteArrayOutputStream;
+		img.save( out, "test.dds" );
+		P(ByteArrayInputStream) in = new ByteArrayInputStream( out->toByteArray(), out->size() );
+		Image img2( in, "test.dds" );
+		assert( img2.format() == SurfaceFormat::SURFACE_DXT5 );
+		assert( img2.mipMapLevels() == img.mipMapLevels() && img2.surfaces() == img.surfaces() );
+		for ( int i = 0 ; i < img.surfaces() ; ++i )
+		{
+			assert( img2.surface(i).width() == img.surface(i).width() );
+			assert( img2.surface(i).pitch() == img.surface(i).pitch() );
+			assert( !memcmp(img2.surface(i).data(),img.surface(i).data(),img.surface(i).dataSize()) );
+		}
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+static tester::Test reg( test, __FILE__ );
@@ -80,7 +80,7 @@ static int test()
 		img = new Image( SurfaceFormat::SURFACE_R5G6B5, image );
 		Surface& imgs = img->surface(0);
 		SurfaceUtil::blt( imgs.format(), imgs.width(), imgs.height(), imgs.data(), imgs.pitch(), 
-			image->surface(0).format(), image->surface(0).data(), image->surface(0).pitch() );
+			image->surface(0).format(), image->surface(0).data(), image->surface(0).pitch(), true );
 		saveImage( img, outDir + "/out_space2.bmp" );
 	}
 	{
@@ -0,0 +1,147 @@
+#include <tester/Test.h>
+#include <pix/Surface.h>
+#include <pix/SurfaceUtil.h>
+#include <pix/SurfaceFormat.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+//-----------------------------------------------------------------------------
+
+using namespace pix;
+
+//-----------------------------------------------------------------------------
+
+/** Format pairs which have specialized conversions. */
+static const SurfaceFormat::SurfaceFormatType s_pairs[][2] =
+{
+	{SurfaceFormat::SURFACE_R8G8B8,		SurfaceFormat::SURFACE_A8R8G8B8},
+	{SurfaceFormat::SURFACE_R8G8B8,		SurfaceFormat::SURFACE_X8R8G8B8},
+	{SurfaceFormat::SURFACE_R8G8B8,		SurfaceFormat::SURFACE_R5G6B5},
+	{SurfaceFormat::SURFACE_R8G8B8,		SurfaceFormat::SURFACE_R8G8B8},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_R8G8B8},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_R8G8B8},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_A8R8G8B8},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_X8R8G8B8},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_A8R8G8B8},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_X8R8G8B8},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_R5G6B5},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_R5G6B5},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_A1R5G5B5},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_A1R5G5B5},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_R5G5B5},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_R5G5B5},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_A4R4G4B4},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_A4R4G4B4},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_X4R4G4B4},
+	{SurfaceFormat::SURFACE_X8R8G8B8,	SurfaceFormat::SURFACE_X4R4G4B4},
+	{SurfaceFormat::SURFACE_R5G6B5,		SurfaceFormat::SURFACE_A8R8G8B8},
+	{SurfaceFormat::SURFACE_R5G6B5,		SurfaceFormat::SURFACE_X8R8G8B8},
+	{SurfaceFormat::SURFACE_R5G6B5,		SurfaceFormat::SURFACE_R5G6B5},
+	{SurfaceFormat::SURFACE_A1R5G5B5,	SurfaceFormat::SURFACE_A8R8G8B8},
+	{SurfaceFormat::SURFACE_R5G5B5,		SurfaceFormat::SURFACE_A8R8G8B8},
+	{SurfaceFormat::SURFACE_R5G5B5,		SurfaceFormat::SURFACE_R5G5B5},
+	{SurfaceFormat::SURFACE_A4R4G4B4,	SurfaceFormat::SURFACE_A8R8G8B8},
+	{SurfaceFormat::SURFACE_X4R4G4B4,	SurfaceFormat::SURFACE_A8R8G8B8},
+	// generic conversion
+	{SurfaceFormat::SURFACE_R3G3B2,		SurfaceFormat::SURFACE_A8R8G8B8},
+	{SurfaceFormat::SURFACE_A8R8G8B8,	SurfaceFormat::SURFACE_A8R3G2B3},
+};
+
+/** Number of tested format pairs. */
+const int PAIRS = sizeof(s_pairs)/sizeof(s_pairs[0]);
+
+//-----------------------------------------------------------------------------
+
+/** Fills buffer with pseudo-random bytes. */
+static void fillRandom( uint8_t* data, int size, uint32_t seed )
+{
+	for ( int i = 0 ; i < size ; ++i )
+	{
+		seed = seed * 1664525 + 1013904223;
+		data[i] = (uint8_t)( seed >> 24 );
+	}
+}
+
+/** 
+ * Converts the block with SurfaceUtil::blt and compares it
+ * to per pixel conversion with SurfaceFormat::copyPixels. 
+ */
+static void testBlt( const SurfaceFormat& dstFormat, const SurfaceFormat& srcFormat, int width, int height )
+{
+	// odd pitches to test unaligned rows
+	const int	srcPitch	= width*srcFormat.pixelSize() + 3;
+	const int	dstPitch	= width*dstFormat.pixelSize() + 5;
+	uint8_t*	src			= new uint8_t[ srcPitch*height + 1 ];
+	uint8_t*	dst			= new uint8_t[ dstPitch*height + 1 ];
+	uint8_t*	ref			= new uint8_t[ dstPitch*height + 1 ];
+
+	fillRandom( src, srcPitch*height+1, width+height );
+	memset( dst, 0xCD, dstPitch*height+1 );
+	memset( ref, 0xCD, dstPitch*height+1 );
+
+	for ( int j = 0 ; j < height ; ++j )
+		dstFormat.copyPixels( ref+1+dstPitch*j, srcFormat, src+1+srcPitch*j, width );
+
+	SurfaceUtil::blt( dstFormat, width, height, dst+1, dstPitch, srcFormat, src+1, srcPitch, false );
+	assert( !memcmp(dst,ref,dstPitch*height+1) );
+
+	delete[] ref;
+	delete[] dst;
+	delete[] src;
+}
+
+static int test()
+{
+	for ( int threads = 1 ; threads <= 4 ; threads += 3 )
+	{
+		SurfaceUtil::setThreads( threads );
+		assert( SurfaceUtil::threads() == threads );
+
+		for ( int i = 0 ; i < PAIRS ; ++i )
+		{
+			SurfaceFormat srcFormat = s_pairs[i][0];
+			SurfaceFormat dstFormat = s_pairs[i][1];
+			testBlt( dstFormat, srcFormat, 1, 1 );
+			testBlt( dstFormat, srcFormat, 37, 5 );
+			testBlt( dstFormat, srcFormat, 513, 300 );
+		}
+	}
+	SurfaceUtil::setThreads( 0 );
+
+	// dithering is used by default and can be disabled
+	{
+		const int width = 64;
+		const int height = 4;
+		uint32_t src[width*height];
+		uint16_t dst[width*height];
+		uint16_t ref[width*height];
+		for ( int i = 0 ; i < width*height ; ++i )
+			src[i] = 0xFF030303;
+
+		SurfaceFormat srcFormat = SurfaceFormat::SURFACE_A8R8G8B8;
+		SurfaceFormat dstFormat = SurfaceFormat::SURFACE_R5G6B5;
+		dstFormat.copyPixels( ref, srcFormat, src, width*height );
+		SurfaceUtil::blt( dstFormat, width, height, dst, width*2, srcFormat, src, width*4, false );
+		assert( !memcmp(dst,ref,sizeof(dst)) );
+
+		// dark grey truncates to black but dithering lights some pixels
+		SurfaceUtil::blt( dstFormat, width, height, dst, width*2, srcFormat, src, width*4 );
+		assert( 0 == ref[0] );
+		assert( memcmp(dst,ref,sizeof(dst)) );
+
+		// Surface passes dithering on to SurfaceUtil
+		memset( dst, 0, sizeof(dst) );
+		Surface::blt( dst, 0, 0, width, height, width*2, dstFormat, src, width, height, width*4, srcFormat );
+		assert( memcmp(dst,ref,sizeof(dst)) );
+		Surface::blt( dst, 0, 0, width, height, width*2, dstFormat, src, width, height, width*4, srcFormat, false );
+		assert( !memcmp(dst,ref,sizeof(dst)) );
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+static tester::Test reg( test, __FILE__ );
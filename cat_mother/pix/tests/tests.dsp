@@ -89,12 +89,20 @@ SOURCE=.\test_DDS.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\test_DXTCompressor.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\test_Image.cpp
 # End Source File
 # Begin Source File
 
 SOURCE=.\test_SurfaceFormat.cpp
 # End Source File
+# Begin Source File
+
+SOURCE=.\test_SurfaceUtil.cpp
+# End Source File
 # End Group
 # Begin Group "Header Files"
 
@@ -1,5 +1,5 @@
 #include "Box.h"
-#include <lang/Math.h>
+#include <util/Random.h>
 #include "config.h"
 
 //-----------------------------------------------------------------------------
@@ -19,12 +19,12 @@ Box::Box( const math::Vector3& minCorner, const math::Vector3& maxCorner )
 	m_max = maxCorner;
 }
 
-void Box::getRandomPoint( math::Vector3* point )
+void Box::getRandomPoint( util::Random* rng, math::Vector3* point )
 {
 	Vector3 d = m_max - m_min;
-	point->x = Math::random() * d.x + m_min.x;
-	point->y = Math::random() * d.y + m_min.y;
-	point->z = Math::random() * d.z + m_min.z;
+	point->x = rng->nextFloat() * d.x + m_min.x;
+	point->y = rng->nextFloat() * d.y + m_min.y;
+	point->z = rng->nextFloat() * d.z + m_min.z;
 }
 
 
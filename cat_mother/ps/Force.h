@@ -5,10 +5,6 @@
 #include <lang/Object.h>
 
 
-namespace math {
-	class Vector3;}
-
-
 namespace ps
 {
 
@@ -21,11 +17,18 @@ class Force :
 	public lang::Object
 {
 public:
-	/** Applies the force to the particles. */
+	/** 
+	 * Applies the force to the particles. 
+	 * Particle data is passed as x, y and z component streams.
+	 * Each stream is 16-byte aligned and has room for count 
+	 * rounded up to next multiple of 4 elements, so the last
+	 * group of four can be processed with SIMD instructions.
+	 * Forces are accumulated to the existing values.
+	 */
 	virtual void	apply( float time, float dt,
-						math::Vector3* positions, 
-						math::Vector3* velocities,
-						math::Vector3* forces,
+						const float* const* positions, 
+						const float* const* velocities,
+						float* const* forces,
 						int count ) = 0;
 };
 
@@ -3,6 +3,9 @@
 #include <lang/Math.h>
 #include <math/Vector3.h>
 #include "config.h"
+#ifdef PS_SSE
+#include <xmmintrin.h>
+#endif
 
 //-----------------------------------------------------------------------------
 
@@ -36,33 +39,80 @@ Gravity::Gravity( const math::Vector3& pos, float mass )
 }
 
 void Gravity::apply( float /*time*/, float /*dt*/,
-	Vector3* positions, 
-	Vector3* /*velocities*/,
-	Vector3* forces,
+	const float* const* positions, 
+	const float* const* /*velocities*/,
+	float* const* forces,
 	int count )
 {
+	const int n = (count+3) & ~3;
+
 	if ( m_std )
 	{
-		for ( int i = 0 ; i < count ; ++i )
-			forces[i].y -= m_g;
+		float* fy = forces[1];
+
+	#ifdef PS_SSE
+		const __m128 g4 = _mm_set1_ps( m_g );
+		for ( int i = 0 ; i < n ; i += 4 )
+			_mm_store_ps( fy+i, _mm_sub_ps(_mm_load_ps(fy+i),g4) );
+	#else
+		for ( int i = 0 ; i < n ; ++i )
+			fy[i] -= m_g;
+	#endif
 	}
 	else
 	{
 		const float G				= 6.672e-11f;	// gravitational constant
 		const float particleMass	= 1.f;
+		const float gm				= G * m_mass * particleMass;
+
+		const float* px = positions[0];
+		const float* py = positions[1];
+		const float* pz = positions[2];
+		float* fx = forces[0];
+		float* fy = forces[1];
+		float* fz = forces[2];
 
+	#ifdef PS_SSE
+		const __m128 cx = _mm_set1_ps( m_pos.x );
+		const __m128 cy = _mm_set1_ps( m_pos.y );
+		const __m128 cz = _mm_set1_ps( m_pos.z );
+		const __m128 gm4 = _mm_set1_ps( gm );
+		const __m128 one4 = _mm_set1_ps( 1.f );
+		const __m128 min4 = _mm_set1_ps( Float::MIN_VALUE );
+		for ( int i = 0 ; i < n ; i += 4 )
+		{
+			__m128 dx = _mm_sub_ps( cx, _mm_load_ps(px+i) );
+			__m128 dy = _mm_sub_ps( cy, _mm_load_ps(py+i) );
+			__m128 dz = _mm_sub_ps( cz, _mm_load_ps(pz+i) );
+			__m128 r2 = _mm_add_ps( _mm_add_ps(_mm_mul_ps(dx,dx),_mm_mul_ps(dy,dy)), _mm_mul_ps(dz,dz) );
+			__m128 valid = _mm_cmpgt_ps( r2, min4 );
+			
+			// avoid division by zero in skipped lanes
+			r2 = _mm_or_ps( _mm_and_ps(valid,r2), _mm_andnot_ps(valid,one4) );
+			__m128 invr2 = _mm_div_ps( one4, r2 );
+			__m128 f = _mm_mul_ps( gm4, invr2 );
+			__m128 scale = _mm_and_ps( valid, _mm_mul_ps(_mm_sqrt_ps(invr2),f) );
+
+			_mm_store_ps( fx+i, _mm_add_ps(_mm_load_ps(fx+i),_mm_mul_ps(dx,scale)) );
+			_mm_store_ps( fy+i, _mm_add_ps(_mm_load_ps(fy+i),_mm_mul_ps(dy,scale)) );
+			_mm_store_ps( fz+i, _mm_add_ps(_mm_load_ps(fz+i),_mm_mul_ps(dz,scale)) );
+		}
+	#else
 		for ( int i = 0 ; i < count ; ++i )
 		{
-			Vector3 d = m_pos - positions[i];
+			Vector3 d( m_pos.x-px[i], m_pos.y-py[i], m_pos.z-pz[i] );
 			float r2 = d.lengthSquared();
 			if ( r2 > Float::MIN_VALUE )
 			{
 				float invr2 = 1.f / r2;
-				float f = G * m_mass * particleMass * invr2;
+				float f = gm * invr2;
 				d *= Math::sqrt(invr2) * f;
-				forces[i] += d;
+				fx[i] += d.x;
+				fy[i] += d.y;
+				fz[i] += d.z;
 			}
 		}
+	#endif
 	}
 }
 
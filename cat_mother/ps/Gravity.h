@@ -41,9 +41,9 @@ public:
 
 	/** Applies the force to the particles. */
 	void	apply( float time, float dt,
-				math::Vector3* positions, 
-				math::Vector3* velocities,
-				math::Vector3* forces,
+				const float* const* positions, 
+				const float* const* velocities,
+				float* const* forces,
 				int count );
 
 private:
@@ -1,5 +1,6 @@
 #include "HalfSphere.h"
 #include <lang/Math.h>
+#include <util/Random.h>
 #include <assert.h>
 #include "config.h"
 
@@ -20,7 +21,7 @@ HalfSphere::HalfSphere( const Vector3& pos, float r )
 	m_r = r;
 }
 
-void HalfSphere::getRandomPoint( Vector3* point )
+void HalfSphere::getRandomPoint( util::Random* rng, Vector3* point )
 {
 	float r = m_r;
 	Vector3 p(0,0,0);
@@ -33,7 +34,7 @@ void HalfSphere::getRandomPoint( Vector3* point )
 		sqr = 0.f;
 		for ( int i = 0 ; i < 3 ; ++i )
 		{
-			float v = (Math::random()-0.5f) * twor;
+			float v = (rng->nextFloat()-0.5f) * twor;
 			sqr += v*v;
 			p[i] = v;
 		}
@@ -22,7 +22,7 @@ public:
 	HalfSphere( const math::Vector3& pos, float r );
 
 	/** Returns random point inside the shape. */
-	void			getRandomPoint( math::Vector3* point );
+	void			getRandomPoint( util::Random* rng, math::Vector3* point );
 
 private:
 	math::Vector3	m_pos;
@@ -1,11 +1,12 @@
 #include "ParticleSystem.h"
 #include "Shape.h"
 #include "Force.h"
-#include "swapRemove.h"
+#include "ParticleStreams.h"
 #include <sg/Camera.h>
 #include <lang/Math.h>
 #include <lang/Float.h>
 #include <util/Vector.h>
+#include <util/Random.h>
 #include <math/Vector3.h>
 #include <math/Matrix4x4.h>
 #include <assert.h>
@@ -49,21 +50,14 @@ public:
 	float							time;
 	float							newParticles;
 	int								particles;
-	Vector<float>					particleTimes;
-	Vector<float>					particleLifeTimes;
-	Vector<Vector3>					particlePositions;
-	Vector<Vector3>					particlePreviousPositions;
-	Vector<Vector3>					particleVelocities;
-	Vector<Vector3>					particleForces;
+	ParticleStreams					streams;
+	Vector<int>						deadParticles;
+	Random							rng;
 
 	ParticleSystemImpl() :
 		forces( Allocator<P(Force)>(__FILE__,__LINE__) ),
-		particleTimes( Allocator<float>(__FILE__,__LINE__) ),
-		particleLifeTimes( Allocator<float>(__FILE__,__LINE__) ),
-		particlePositions( Allocator<Vector3>(__FILE__,__LINE__) ),
-		particlePreviousPositions( Allocator<Vector3>(__FILE__,__LINE__) ),
-		particleVelocities( Allocator<Vector3>(__FILE__,__LINE__) ),
-		particleForces( Allocator<Vector3>(__FILE__,__LINE__) )
+		deadParticles( Allocator<int>(__FILE__,__LINE__) ),
+		rng( 1 )
 	{
 		emissionRate			= 100.f;
 		emissionTime			= 0.f;
@@ -136,6 +130,11 @@ void ParticleSystem::setKillType( KillType kill )
 	m_this->kill = kill;
 }
 
+void ParticleSystem::setRandomSeed( long seed )
+{
+	m_this->rng.setSeed( seed );
+}
+
 void ParticleSystem::addForce( Force* force )
 {
 	m_this->forces.add( force );
@@ -146,6 +145,11 @@ bool ParticleSystem::updateVisibility( sg::Camera* camera )
 	return camera->isInView( cachedWorldTransform().translation(), boundSphere() );
 }
 
+bool ParticleSystem::sphereCullable() const
+{
+	return true;
+}
+
 void ParticleSystem::update( float dt )
 {
 	// reset previous position
@@ -206,11 +210,7 @@ void ParticleSystem::reset()
 	m_this->newParticles = 0;
 
 	assert( m_this->particles == 0 );
-	assert( m_this->particleTimes.size() == 0 );
-	assert( m_this->particleLifeTimes.size() == 0 );
-	assert( m_this->particlePositions.size() == 0 );
-	assert( m_this->particlePreviousPositions.size() == 0 );
-	assert( m_this->particleVelocities.size() == 0 );
+	assert( m_this->streams.size() == 0 );
 
 	setTransform( Matrix4x4(1) );
   	setState( 0.f );
@@ -238,7 +238,7 @@ void ParticleSystem::killRandomParticle()
 {
 	assert( m_this->particles > 0 );
 
-	int i = (int)(Math::random() * m_this->particles);
+	int i = (int)(m_this->rng.nextFloat() * m_this->particles);
 	if ( i < 0 )
 		i = 0;
 	else if ( i >= m_this->particles )
@@ -252,12 +252,13 @@ void ParticleSystem::killOldestParticle()
 {
 	assert( m_this->particles > 0 );
 
+	const float* times = m_this->streams.stream( ParticleStreams::TIME );
 	int oldest = 0;
 	float oldestTime = 0.f;
 	int i = 0;
 	for ( i = 0 ; i < m_this->particles ; ++i )
 	{
-		float t = m_this->particleTimes[i];
+		float t = times[i];
 		if ( t > oldestTime )
 		{
 			oldestTime = t;
@@ -286,9 +287,9 @@ void ParticleSystem::addNewParticles( int n, const Matrix4x4& worldTransform )
 		Vector3 vel(0,0,0);
 
 		if ( m_this->posShape )
-			m_this->posShape->getRandomPoint( &pos );
+			m_this->posShape->getRandomPoint( &m_this->rng, &pos );
 		if ( m_this->velShape )
-			m_this->velShape->getRandomPoint( &vel );
+			m_this->velShape->getRandomPoint( &m_this->rng, &vel );
 
 		Vector4 pos4 = wtm * Vector4(pos.x,pos.y,pos.z,1);
 		Vector4 vel4 = wtm * Vector4(vel.x,vel.y,vel.z,0);
@@ -304,67 +305,69 @@ void ParticleSystem::addParticle( const Vector3& pos, const Vector3& vel, float
 {
 	assert( particles() < maxParticles() );
 
-	m_this->particleTimes.add( 0.f );
-	m_this->particleLifeTimes.add( lifeTime );
-	m_this->particlePositions.add( pos );
-	m_this->particlePreviousPositions.add( pos );
-	m_this->particleVelocities.add( vel );
+	ParticleStreams& s = m_this->streams;
+	int i = s.add();
+	s.stream(ParticleStreams::POSITION_X)[i] = pos.x;
+	s.stream(ParticleStreams::POSITION_Y)[i] = pos.y;
+	s.stream(ParticleStreams::POSITION_Z)[i] = pos.z;
+	s.stream(ParticleStreams::PREVIOUS_POSITION_X)[i] = pos.x;
+	s.stream(ParticleStreams::PREVIOUS_POSITION_Y)[i] = pos.y;
+	s.stream(ParticleStreams::PREVIOUS_POSITION_Z)[i] = pos.z;
+	s.stream(ParticleStreams::VELOCITY_X)[i] = vel.x;
+	s.stream(ParticleStreams::VELOCITY_Y)[i] = vel.y;
+	s.stream(ParticleStreams::VELOCITY_Z)[i] = vel.z;
+	s.stream(ParticleStreams::TIME)[i] = 0.f;
+	s.stream(ParticleStreams::LIFETIME)[i] = lifeTime;
 	m_this->particles += 1;
 }
 
 void ParticleSystem::removeParticle( int index )
 {
 	assert( index >= 0 && index < particles() );
-	assert( index < (int)m_this->particleTimes.size() );
-	assert( index < (int)m_this->particleLifeTimes.size() );
-	assert( index < (int)m_this->particlePositions.size() );
-	assert( index < (int)m_this->particlePreviousPositions.size() );
-	assert( index < (int)m_this->particleVelocities.size() );
-
-	swapRemove( m_this->particleTimes, index );
-	swapRemove( m_this->particleLifeTimes, index );
-	swapRemove( m_this->particlePositions, index );
-	swapRemove( m_this->particlePreviousPositions, index );
-	swapRemove( m_this->particleVelocities, index );
+	assert( index < m_this->streams.size() );
 
+	m_this->streams.swapRemove( index );
 	m_this->particles -= 1;
 }
 
+void ParticleSystem::removeParticles( const int* indices, int count )
+{
+	assert( count >= 0 && count <= particles() );
+
+	m_this->streams.compact( indices, count );
+	m_this->particles -= count;
+}
+
 void ParticleSystem::applyForces( float time, float dt )
 {
+	ParticleStreams& s = m_this->streams;
+	if ( m_this->particles == 0 )
+		return;
+
 	// collect forces
-	m_this->particleForces.clear();
-	m_this->particleForces.setSize( m_this->particles, Vector3(0,0,0) );
-	int i;
-	for ( i = 0 ; i < (int)m_this->forces.size() ; ++i )
-		m_this->forces[i]->apply( time, dt, m_this->particlePositions.begin(), m_this->particleVelocities.begin(), m_this->particleForces.begin(), m_this->particles );
+	s.zero( ParticleStreams::FORCE_X );
+	s.zero( ParticleStreams::FORCE_Y );
+	s.zero( ParticleStreams::FORCE_Z );
+	const float* const pos[3] = { s.stream(ParticleStreams::POSITION_X), s.stream(ParticleStreams::POSITION_Y), s.stream(ParticleStreams::POSITION_Z) };
+	const float* const vel[3] = { s.stream(ParticleStreams::VELOCITY_X), s.stream(ParticleStreams::VELOCITY_Y), s.stream(ParticleStreams::VELOCITY_Z) };
+	float* const force[3] = { s.stream(ParticleStreams::FORCE_X), s.stream(ParticleStreams::FORCE_Y), s.stream(ParticleStreams::FORCE_Z) };
+	for ( int i = 0 ; i < (int)m_this->forces.size() ; ++i )
+		m_this->forces[i]->apply( time, dt, pos, vel, force, m_this->particles );
 
 	// integrate forces
 	// (integration depends on framerate but thats *exactly* what we want
 	// since we don't want to spend time on 'accurate' particle effects
 	// in slow computers)
-	for ( i = 0 ; i < m_this->particles ; ++i )
-	{
-		Vector3& vel = m_this->particleVelocities[i];
-		vel += m_this->particleForces[i] * dt;
-		m_this->particlePreviousPositions[i] = m_this->particlePositions[i];
-		m_this->particlePositions[i] += vel * dt;
-	}
+	integrateParticles( s, dt );
 }
 
 void ParticleSystem::updateLife( float dt )
 {
-	for ( int i = 0 ; i < m_this->particles ; ++i )
-	{
-		float& t = m_this->particleTimes[i];
-		t += dt;
-
-		if ( t > m_this->particleLifeTimes[i] )
-		{
-			removeParticle( i );
-			--i;
-		}
-	}
+	// age particles and remove expired ones in a single batch
+	m_this->deadParticles.setSize( m_this->particles );
+	int dead = ageParticles( m_this->streams, dt, m_this->deadParticles.begin() );
+	if ( dead > 0 )
+		removeParticles( m_this->deadParticles.begin(), dead );
 }
 
 int ParticleSystem::particles() const
@@ -382,58 +385,57 @@ float ParticleSystem::time() const
 	return m_this->time;
 }
 
-const math::Vector3* ParticleSystem::particlePositions() const
+Vector3 ParticleSystem::particlePosition( int i ) const
 {
-	assert( particles() == (int)m_this->particlePositions.size() );
-	return m_this->particlePositions.begin();
+	assert( i >= 0 && i < particles() );
+	const ParticleStreams& s = m_this->streams;
+	return Vector3( s.stream(ParticleStreams::POSITION_X)[i], s.stream(ParticleStreams::POSITION_Y)[i], s.stream(ParticleStreams::POSITION_Z)[i] );
 }
 
-const math::Vector3* ParticleSystem::particlePreviousPositions() const
+Vector3 ParticleSystem::particleVelocity( int i ) const
 {
-	assert( particles() == (int)m_this->particlePreviousPositions.size() );
-	return m_this->particlePreviousPositions.begin();
+	assert( i >= 0 && i < particles() );
+	const ParticleStreams& s = m_this->streams;
+	return Vector3( s.stream(ParticleStreams::VELOCITY_X)[i], s.stream(ParticleStreams::VELOCITY_Y)[i], s.stream(ParticleStreams::VELOCITY_Z)[i] );
 }
 
-const math::Vector3* ParticleSystem::particleVelocities() const
+const float* ParticleSystem::particleStream( StreamType stream ) const
 {
-	assert( particles() == (int)m_this->particleVelocities.size() );
-	return m_this->particleVelocities.begin();
+	assert( stream >= 0 && stream < STREAM_COUNT );
+	assert( particles() == m_this->streams.size() );
+	return m_this->streams.stream( ParticleStreams::StreamType(stream) );
 }
 
-const float* ParticleSystem::particleTimes() const
+float* ParticleSystem::particleStream( StreamType stream )
 {
-	assert( particles() == (int)m_this->particleTimes.size() );
-	return m_this->particleTimes.begin();
+	assert( stream >= 0 && stream < STREAM_COUNT );
+	assert( particles() == m_this->streams.size() );
+	return m_this->streams.stream( ParticleStreams::StreamType(stream) );
 }
 
-const float* ParticleSystem::particleLifeTimes() const
+const float* ParticleSystem::particleTimes() const
 {
-	assert( particles() == (int)m_this->particleLifeTimes.size() );
-	return m_this->particleLifeTimes.begin();
+	return particleStream( STREAM_TIME );
 }
 
-math::Vector3* ParticleSystem::particlePositions()
+const float* ParticleSystem::particleLifeTimes() const
 {
-	assert( particles() == (int)m_this->particlePositions.size() );
-	return m_this->particlePositions.begin();
+	return particleStream( STREAM_LIFETIME );
 }
 
-math::Vector3* ParticleSystem::particleVelocities()
+float* ParticleSystem::particleTimes()
 {
-	assert( particles() == (int)m_this->particleVelocities.size() );
-	return m_this->particleVelocities.begin();
+	return particleStream( STREAM_TIME );
 }
 
-float* ParticleSystem::particleTimes()
+float* ParticleSystem::particleLifeTimes()
 {
-	assert( particles() == (int)m_this->particleTimes.size() );
-	return m_this->particleTimes.begin();
+	return particleStream( STREAM_LIFETIME );
 }
 
-float* ParticleSystem::particleLifeTimes()
+Random* ParticleSystem::randomGenerator()
 {
-	assert( particles() == (int)m_this->particleLifeTimes.size() );
-	return m_this->particleLifeTimes.begin();
+	return &m_this->rng;
 }
 
 void ParticleSystem::setLocalSpace( bool enabled )
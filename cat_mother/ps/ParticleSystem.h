@@ -18,6 +18,9 @@ namespace math {
 	class Vector3;
 	class Matrix4x4;}
 
+namespace util {
+	class Random;}
+
 
 namespace ps
 {
@@ -47,6 +50,38 @@ public:
 		KILL_RANDOM
 	};
 
+	/** 
+	 * Per-particle data streams. 
+	 * Each stream is a 16-byte aligned float array with particles() elements.
+	 */
+	enum StreamType
+	{
+		/** Particle position x-components. */
+		STREAM_POSITION_X,
+		/** Particle position y-components. */
+		STREAM_POSITION_Y,
+		/** Particle position z-components. */
+		STREAM_POSITION_Z,
+		/** Particle position x-components before the last update. */
+		STREAM_PREVIOUS_POSITION_X,
+		/** Particle position y-components before the last update. */
+		STREAM_PREVIOUS_POSITION_Y,
+		/** Particle position z-components before the last update. */
+		STREAM_PREVIOUS_POSITION_Z,
+		/** Particle velocity x-components. */
+		STREAM_VELOCITY_X,
+		/** Particle velocity y-components. */
+		STREAM_VELOCITY_Y,
+		/** Particle velocity z-components. */
+		STREAM_VELOCITY_Z,
+		/** Time elapsed since the particles were created. */
+		STREAM_TIME,
+		/** Time when the particles will be removed. */
+		STREAM_LIFETIME,
+		/** Number of particle data streams. */
+		STREAM_COUNT
+	};
+
 	/** Creates a default particle system. */
 	ParticleSystem();
 
@@ -71,6 +106,12 @@ public:
 	/** Computes object visibility in the view frustum. */
 	virtual bool		updateVisibility( sg::Camera* camera );
 
+	/** 
+	 * Returns true, visibility is tested with the bounding sphere only. 
+	 * Override to return false if updateVisibility() is overriden.
+	 */
+	virtual bool		sphereCullable() const;
+
 	/** 
 	 * Resets the system to initial state. Removes all particles.
 	 * Always call the base class implementation if you override this in derived classes.
@@ -91,6 +132,22 @@ public:
 	 */
 	virtual void		removeParticle( int index );
 
+	/**
+	 * Removes a set of particles from the system in one pass.
+	 * Order of the remaining particles is preserved.
+	 * Always call the base class implementation if you override this in derived classes.
+	 * @param indices Indices of the particles to remove in ascending order.
+	 * @param count Number of particles to remove.
+	 */
+	virtual void		removeParticles( const int* indices, int count );
+
+	/** 
+	 * Sets seed of the random number generator of the particle system. 
+	 * Each particle system has its own random number stream so the
+	 * simulation doesn't depend on the order in which systems are updated.
+	 */
+	void	setRandomSeed( long seed );
+
 	/** Kills particle system so that alive() will return false. */
 	void	kill();
 
@@ -160,14 +217,14 @@ public:
 	/** Returns true if the particle system is still alive. */
 	bool	alive() const;
 
-	/** Returns particle positions. */
-	const math::Vector3*	particlePositions() const;
+	/** Returns ith particle position. */
+	math::Vector3			particlePosition( int i ) const;
 
-	/** Returns previous particle positions. */
-	const math::Vector3*	particlePreviousPositions() const;
+	/** Returns ith particle velocity. */
+	math::Vector3			particleVelocity( int i ) const;
 
-	/** Returns particle velocities. */
-	const math::Vector3*	particleVelocities() const;
+	/** Returns specified per-particle data stream. */
+	const float*			particleStream( StreamType stream ) const;
 
 	/** Returns time elapsed since the particles were created. */
 	const float*			particleTimes() const;
@@ -176,11 +233,8 @@ public:
 	const float*			particleLifeTimes() const;
 
 protected:
-	/** Returns particle positions. */
-	math::Vector3*			particlePositions();
-
-	/** Returns particle velocities. */
-	math::Vector3*			particleVelocities();
+	/** Returns specified per-particle data stream. */
+	float*					particleStream( StreamType stream );
 
 	/** Returns time elapsed since the particles were created. */
 	float*					particleTimes();
@@ -188,6 +242,9 @@ protected:
 	/** Returns time when the particles will be removed. */
 	float*					particleLifeTimes();
 
+	/** Returns random number generator of this particle system. */
+	util::Random*			randomGenerator();
+
 private:
 	class ParticleSystemImpl;
 	P(ParticleSystemImpl) m_this;
@@ -3,12 +3,26 @@
 #include <sg/Node.h>
 #include <io/InputStream.h>
 #include <io/InputStreamArchive.h>
+#include <lang/Thread.h>
 #include <util/Vector.h>
 #include <util/Hashtable.h>
+
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
 #include "config.h"
 
 //-----------------------------------------------------------------------------
 
+/** Minimum number of particle systems to update per thread. */
+#define MIN_SYSTEMS_PER_THREAD 4
+
+//-----------------------------------------------------------------------------
+
 using namespace io;
 using namespace sg;
 using namespace lang;
@@ -20,6 +34,62 @@ namespace ps
 {
 
 
+/** Returns number of processors in the system. */
+static int processorCount()
+{
+#ifdef WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	int n = (int)info.dwNumberOfProcessors;
+#else
+	int n = (int)sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+	return n > 0 ? n : 1;
+}
+
+//-----------------------------------------------------------------------------
+
+/** 
+ * Updates every nth particle system of the list. 
+ * Particle systems are independent of each other so
+ * they can be updated in parallel.
+ */
+class ParticleUpdateThread :
+	public Thread
+{
+public:
+	ParticleUpdateThread() :
+		m_systems(0), m_first(0), m_step(1), m_dt(0.f)
+	{
+	}
+
+	void setWork( const Vector<ParticleSystem*>* systems, int first, int step, float dt )
+	{
+		m_systems = systems;
+		m_first = first;
+		m_step = step;
+		m_dt = dt;
+	}
+
+	void run()
+	{
+		const Vector<ParticleSystem*>& systems = *m_systems;
+		for ( int i = m_first ; i < systems.size() ; i += m_step )
+			systems[i]->update( m_dt );
+	}
+
+private:
+	const Vector<ParticleSystem*>*	m_systems;
+	int								m_first;
+	int								m_step;
+	float							m_dt;
+
+	ParticleUpdateThread( const ParticleUpdateThread& );
+	ParticleUpdateThread& operator=( const ParticleUpdateThread& );
+};
+
+//-----------------------------------------------------------------------------
+
 class ParticleSystemManager::ParticleSystemManagerImpl :
 	public Object
 {
@@ -37,7 +107,11 @@ public:
 		m_scene(0), m_arch(arch),
 		m_prototypes( Allocator< HashtablePair< String, P(ParticleSystem) > >(__FILE__) ),
 		m_freed( Allocator< HashtablePair< String, P(Vector< P(ParticleSystem) >) > >(__FILE__) ),
-		m_active( Allocator<ActiveParticleSystem>(__FILE__) )
+		m_active( Allocator<ActiveParticleSystem>(__FILE__) ),
+		m_updated( Allocator<ParticleSystem*>(__FILE__) ),
+		m_workers( Allocator<P(ParticleUpdateThread)>(__FILE__) ),
+		m_threads( 0 ),
+		m_seed( 0 )
 	{
 	}
 
@@ -66,14 +140,17 @@ public:
 			}
 		}
 
-		// update
+		// collect systems to update and validate their world transforms
+		// so that the update threads only read cached transforms
+		m_updated.clear();
 		for ( int i = 0 ; i < m_active.size() ; ++i )
 		{
 			ActiveParticleSystem& active = m_active[i];
-			P(ParticleSystem) obj = active.obj;
+			ParticleSystem* obj = active.obj;
 			if ( obj->renderedInLastFrame() )
 			{
-				obj->update( dt );
+				obj->worldTransform();
+				m_updated.add( obj );
 				active.inactive = 0.f;
 			}
 			else
@@ -81,8 +158,45 @@ public:
 				active.inactive += dt;
 			}
 		}
+
+		// update, calling thread takes the first share
+		int threads = this->threads();
+		if ( threads > m_updated.size()/MIN_SYSTEMS_PER_THREAD )
+			threads = m_updated.size()/MIN_SYSTEMS_PER_THREAD;
+		if ( threads < 1 )
+			threads = 1;
+		while ( m_workers.size() < threads-1 )
+			m_workers.add( new ParticleUpdateThread );
+
+		int started = 0;
+		for ( ; started < threads-1 ; ++started )
+		{
+			ParticleUpdateThread* worker = m_workers[started];
+			worker->setWork( &m_updated, started+1, threads, dt );
+			try
+			{
+				worker->start();
+			}
+			catch ( ... )
+			{
+				break;
+			}
+		}
+
+		// shares of the workers which failed to start are updated here too
+		for ( int i = 0 ; i < m_updated.size() ; ++i )
+		{
+			int share = i % threads;
+			if ( 0 == share || share > started )
+				m_updated[i]->update( dt );
+		}
+
+		for ( int k = 0 ; k < started ; ++k )
+			m_workers[k]->join();
 	}
 
+
+
 	void load( const String& name )
 	{
 		m_prototypes[name] = new SpriteParticleSystem( name, m_arch );
@@ -122,8 +236,9 @@ public:
 		else
 			obj->linkTo( m_scene );
 
-		// activate
+		// activate, each instance gets its own random number stream
 		obj->reset();
+		obj->setRandomSeed( (long)(++m_seed * 2654435761u & 0x7FFFFFFF) );
 		ActiveParticleSystem active( obj );
 		m_active.add( active );
 
@@ -168,12 +283,27 @@ public:
 		return count;
 	}
 
+	void setThreads( int count )
+	{
+		assert( count >= 0 );
+		m_threads = count;
+	}
+
+	int threads() const
+	{
+		return m_threads > 0 ? m_threads : processorCount();
+	}
+
 private:
 	P(Node)												m_scene;
 	P(InputStreamArchive)								m_arch;
 	Hashtable< String, P(ParticleSystem) >				m_prototypes;
 	Hashtable< String, P(Vector< P(ParticleSystem) >) >	m_freed;
 	Vector<ActiveParticleSystem>						m_active;
+	Vector<ParticleSystem*>								m_updated;
+	Vector<P(ParticleUpdateThread)>						m_workers;
+	int													m_threads;
+	unsigned long										m_seed;
 
 	ParticleSystemManagerImpl( const ParticleSystemManagerImpl& );
 	ParticleSystemManagerImpl& operator=( const ParticleSystemManagerImpl& );
@@ -220,6 +350,16 @@ int ParticleSystemManager::particles() const
 	return m_this->particles();
 }
 
+void ParticleSystemManager::setThreads( int count )
+{
+	m_this->setThreads( count );
+}
+
+int ParticleSystemManager::threads() const
+{
+	return m_this->threads();
+}
+
 int ParticleSystemManager::getActiveCount( const String& name, Node* refobj ) const
 {
 	return m_this->getActiveCount( name, refobj );
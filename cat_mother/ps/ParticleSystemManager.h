@@ -39,9 +39,21 @@ public:
 	/** Sets parent scene. */
 	void	setScene( sg::Node* scene );
 
-	/** Updates all active particle systems by specified time delta (seconds). */
+	/** 
+	 * Updates all active particle systems by specified time delta (seconds). 
+	 * Visible systems are updated in parallel by worker threads,
+	 * see setThreads(). Returns after all systems have been updated.
+	 */
 	void	update( float dt );
 
+	/** 
+	 * Sets number of threads used to update particle systems. 
+	 * 1 updates all systems serially on the calling thread.
+	 * 0 (default) uses one thread per processor.
+	 * Results are identical regardless of the number of threads.
+	 */
+	void	setThreads( int count );
+
 	/** Starts a new particle effect in reference object space. */
 	ParticleSystem*	play( const lang::String& name, sg::Node* refobj );
 
@@ -57,6 +69,9 @@ public:
 	/** Returns total number of active particles. */
 	int		particles() const;
 
+	/** Returns number of threads used to update particle systems. */
+	int		threads() const;
+
 private:
 	class ParticleSystemManagerImpl;
 	P(ParticleSystemManagerImpl) m_this;
@@ -7,8 +7,8 @@
 #include <lang/Float.h>
 #include <math/Vector3.h>
 #include <math/Matrix4x4.h>
+#include <util/Random.h>
 #include <assert.h>
-#include <stdlib.h>
 #include "config.h"
 
 //-----------------------------------------------------------------------------
@@ -46,6 +46,7 @@ public:
 	Vector<int>			particleHints;
 	Vector<int>			particlePaths;
 	Vector<float>		originalParticleSizes;
+	Vector<int>			deadParticles;
 	float				particleMinSpeed;
 	float				particleMaxSpeed;
 	float				particleStartScale;
@@ -94,7 +95,10 @@ void PathParticleSystem::update( float dt )
 	// update positions
 	int particles = this->particles();
 	const float* times = particleTimes();
-	Vector3* positions = particlePositions();
+	float* posx = particleStream( STREAM_POSITION_X );
+	float* posy = particleStream( STREAM_POSITION_Y );
+	float* posz = particleStream( STREAM_POSITION_Z );
+	m_this->deadParticles.clear();
 	int i;
 	for ( i = 0 ; i < particles ; ++i )
 	{
@@ -104,9 +108,7 @@ void PathParticleSystem::update( float dt )
 		bool alive = getParticlePosition( i, t, v );
 		if ( !alive )
 		{
-			removeParticle( i );
-			--particles;
-			--i;
+			m_this->deadParticles.add( i );
 			continue;
 		}
 
@@ -119,7 +121,16 @@ void PathParticleSystem::update( float dt )
 		//v1.y += wt(1,3);
 		//v1.z += wt(2,3);
 
-		positions[i] = v1;
+		posx[i] = v1.x;
+		posy[i] = v1.y;
+		posz[i] = v1.z;
+	}
+
+	// remove particles which reached end of path
+	if ( m_this->deadParticles.size() > 0 )
+	{
+		removeParticles( m_this->deadParticles.begin(), m_this->deadParticles.size() );
+		particles = this->particles();
 	}
 
 	// update sizes
@@ -145,7 +156,7 @@ void PathParticleSystem::addParticle( const Vector3& /*pos*/, const Vector3& vel
 	int path = 0;
 	if ( m_this->randomPathSelection )
 	{
-		path = rand() % paths();
+		path = (int)( randomGenerator()->nextFloat() * paths() );
 	}
 	else
 	{
@@ -158,7 +169,7 @@ void PathParticleSystem::addParticle( const Vector3& /*pos*/, const Vector3& vel
 	m_this->particleHints.add( 0 );
 
 	// randomize speed
-	float t = Math::random();
+	float t = randomGenerator()->nextFloat();
 	float speed = m_this->particleMinSpeed + t * (m_this->particleMaxSpeed - m_this->particleMinSpeed);
 	assert( speed >= Float::MIN_VALUE );
 	m_this->particleSpeeds.add( speed );
@@ -188,6 +199,16 @@ void PathParticleSystem::removeParticle( int index )
 	SpriteParticleSystem::removeParticle( index );
 }
 
+void PathParticleSystem::removeParticles( const int* indices, int count )
+{
+	compactRemove( m_this->particlePaths, indices, count );
+	compactRemove( m_this->particleHints, indices, count );
+	compactRemove( m_this->particleSpeeds, indices, count );
+	compactRemove( m_this->originalParticleSizes, indices, count );
+
+	SpriteParticleSystem::removeParticles( indices, count );
+}
+
 void PathParticleSystem::addPathPoint( float time, const Vector3& pos, int path )
 {
 	assert( path >= 0 && path < paths() );
@@ -50,6 +50,12 @@ public:
 	 */
 	void		removeParticle( int index );
 
+	/**
+	 * Removes particles in one pass preserving order of the remaining particles.
+	 * Always call the base class implementation if you override this in derived classes.
+	 */
+	void		removeParticles( const int* indices, int count );
+
 	/** Sets minimum particle speed (units/second). */
 	void		setParticleMinSpeed( float v );
 
@@ -8,6 +8,9 @@
 namespace math {
 	class Vector3;}
 
+namespace util {
+	class Random;}
+
 
 namespace ps
 {
@@ -21,8 +24,11 @@ class Shape :
 	public lang::Object
 {
 public:
-	/** Returns random point inside the shape. */
-	virtual void	getRandomPoint( math::Vector3* point ) = 0;
+	/** 
+	 * Returns random point inside the shape. 
+	 * @param rng Source of the random numbers.
+	 */
+	virtual void	getRandomPoint( util::Random* rng, math::Vector3* point ) = 0;
 };
 
 
@@ -1,5 +1,6 @@
 #include "Sphere.h"
 #include <lang/Math.h>
+#include <util/Random.h>
 #include <assert.h>
 #include "config.h"
 
@@ -20,21 +21,21 @@ Sphere::Sphere( const Vector3& pos, float r )
 	m_r = r;
 }
 
-void Sphere::getRandomPoint( Vector3* point )
+void Sphere::getRandomPoint( util::Random* rng, Vector3* point )
 {
 	// axis by axis
 	float r = m_r;
-	float x = Math::random()*2.f - 1.f;
+	float x = rng->nextFloat()*2.f - 1.f;
 	float d2 = 1.f - x*x;
 	if ( d2 < 0.f )
 		d2 = 0.f;
 	float d = Math::sqrt( d2 );
-	float y = (Math::random()*2.f - 1.f) * d;
+	float y = (rng->nextFloat()*2.f - 1.f) * d;
 	d2 = 1.f - x*x - y*y;
 	if ( d2 < 0.f )
 		d2 = 0.f;
 	d = Math::sqrt( d2 );
-	float z = (Math::random()*2.f - 1.f) * d;
+	float z = (rng->nextFloat()*2.f - 1.f) * d;
 	*point = m_pos;
 	*point += Vector3( x*r, y*r, z*r );
 
@@ -51,7 +52,7 @@ void Sphere::getRandomPoint( Vector3* point )
 		sqr = 0.f;
 		for ( int i = 0 ; i < 3 ; ++i )
 		{
-			float v = (Math::random()-0.5f) * twor;
+			float v = (rng->nextFloat()-0.5f) * twor;
 			sqr += v*v;
 			p[i] = v;
 		}
@@ -23,6 +23,8 @@
 #include <math/Noise.h>
 #include <math/Vector2.h>
 #include <math/FloatUtil.h>
+#include <util/Random.h>
+
 #include <assert.h>
 #include "config.h"
 
@@ -115,9 +117,9 @@ public:
 //-----------------------------------------------------------------------------
 
 /** Returns pseudo-random value in range [minv,maxv). */
-inline static float random( float minv, float maxv )
+inline static float random( Random* rng, float minv, float maxv )
 {
-	float t = Math::random();
+	float t = rng->nextFloat();
 	float v = minv + t * (maxv - minv);
 	return v;
 }
@@ -184,13 +186,14 @@ void SpriteParticleSystem::addParticle( const math::Vector3& pos, const math::Ve
 	m_this->particleAnims.add( 0 );
 
 	// randomize angles
-	float ang = random(m_this->minAngle,m_this->maxAngle);
+	Random* rng = randomGenerator();
+	float ang = random(rng,m_this->minAngle,m_this->maxAngle);
 	m_this->particleAngles.add( ang );
 	m_this->particleInitAngles.add( ang );
-	m_this->particleAngleSpeeds.add( random(m_this->minAngleSpeed,m_this->maxAngleSpeed) );
+	m_this->particleAngleSpeeds.add( random(rng,m_this->minAngleSpeed,m_this->maxAngleSpeed) );
 
 	// randomize size
-	m_this->particleSizes.add( random(m_this->minSize,m_this->maxSize) );
+	m_this->particleSizes.add( random(rng,m_this->minSize,m_this->maxSize) );
 }
 
 void SpriteParticleSystem::removeParticle( int index )
@@ -210,6 +213,17 @@ void SpriteParticleSystem::removeParticle( int index )
 	ParticleSystem::removeParticle( index );
 }
 
+void SpriteParticleSystem::removeParticles( const int* indices, int count )
+{
+	compactRemove( m_this->particleAnims, indices, count );
+	compactRemove( m_this->particleSizes, indices, count );
+	compactRemove( m_this->particleAngles, indices, count );
+	compactRemove( m_this->particleInitAngles, indices, count );
+	compactRemove( m_this->particleAngleSpeeds, indices, count );
+
+	ParticleSystem::removeParticles( indices, count );
+}
+
 void SpriteParticleSystem::setImage( Texture* tex )
 {
 	setImage( tex, 1, 1, 1, 1.f, BEHAVIOUR_LOOP );
@@ -299,8 +313,12 @@ void SpriteParticleSystem::prepare( Camera* camera )
 
 	TriangleList*	tri					= m_this->tri;
 	const int*		particleSources		= m_this->particleAnims.begin();
-	const Vector3*	particlePositions	= this->particlePositions();
-	const Vector3*	particleVelocities	= this->particleVelocities();
+	const float*	particlePosX		= particleStream( STREAM_POSITION_X );
+	const float*	particlePosY		= particleStream( STREAM_POSITION_Y );
+	const float*	particlePosZ		= particleStream( STREAM_POSITION_Z );
+	const float*	particleVelX		= particleStream( STREAM_VELOCITY_X );
+	const float*	particleVelY		= particleStream( STREAM_VELOCITY_Y );
+	const float*	particleVelZ		= particleStream( STREAM_VELOCITY_Z );
 	const float*	particleSizes		= m_this->particleSizes.begin();
 	const float*	particleAngles		= m_this->particleAngles.begin();
 	const int		particles			= this->particles();
@@ -322,7 +340,7 @@ void SpriteParticleSystem::prepare( Camera* camera )
 	{
 		// particle position in view space
 		Vector3 viewPos;
-		worldViewTm.transform( particlePositions[i], &viewPos );
+		worldViewTm.transform( Vector3(particlePosX[i],particlePosY[i],particlePosZ[i]), &viewPos );
 
 		// particle dimensions in screen space
 		Vector4 pdim = projTm * Vector4(particleSizes[i]*.5f, 0.f, viewPos.z, 1.f);
@@ -341,7 +359,7 @@ void SpriteParticleSystem::prepare( Camera* camera )
 
 		if ( m_this->speedScale > 0.f )
 		{
-			Vector3 viewVel = viewTm.rotate( particleVelocities[i] );
+			Vector3 viewVel = viewTm.rotate( Vector3(particleVelX[i],particleVelY[i],particleVelZ[i]) );
 			viewVel.z = 0.f;
 
 			// view space points
@@ -0,0 +1,219 @@
+#include "ParticleStreams.h"
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+#include "config.h"
+#ifdef PS_SSE
+#include <xmmintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+
+namespace ps
+{
+
+
+/** Returns p rounded up to next 16-byte boundary. */
+static float* align16( float* p )
+{
+	return (float*)( ((size_t)p + 15) & ~(size_t)15 );
+}
+
+//-----------------------------------------------------------------------------
+
+ParticleStreams::ParticleStreams() :
+	m_mem(0),
+	m_size(0),
+	m_capacity(0)
+{
+	for ( int i = 0 ; i < STREAM_COUNT ; ++i )
+		m_streams[i] = 0;
+}
+
+ParticleStreams::ParticleStreams( const ParticleStreams& other ) :
+	m_mem(0),
+	m_size(0),
+	m_capacity(0)
+{
+	for ( int i = 0 ; i < STREAM_COUNT ; ++i )
+		m_streams[i] = 0;
+	*this = other;
+}
+
+ParticleStreams::~ParticleStreams()
+{
+	delete[] m_mem;
+}
+
+ParticleStreams& ParticleStreams::operator=( const ParticleStreams& other )
+{
+	if ( this != &other )
+	{
+		clear();
+		reserve( other.m_size );
+		for ( int i = 0 ; i < STREAM_COUNT ; ++i )
+			if ( other.m_size > 0 )
+				memcpy( m_streams[i], other.m_streams[i], sizeof(float)*other.m_size );
+		m_size = other.m_size;
+	}
+	return *this;
+}
+
+void ParticleStreams::reserve( int n )
+{
+	if ( n <= m_capacity )
+		return;
+
+	int cap = m_capacity > 0 ? m_capacity : 16;
+	while ( cap < n )
+		cap *= 2;
+	assert( (cap & 3) == 0 );
+
+	// all streams share one zero-initialized block
+	float* mem = new float[ cap*STREAM_COUNT + 4 ];
+	memset( mem, 0, sizeof(float)*(cap*STREAM_COUNT+4) );
+	float* base = align16( mem );
+	for ( int i = 0 ; i < STREAM_COUNT ; ++i )
+	{
+		float* s = base + i*cap;
+		if ( m_size > 0 )
+			memcpy( s, m_streams[i], sizeof(float)*m_size );
+		m_streams[i] = s;
+	}
+
+	delete[] m_mem;
+	m_mem = mem;
+	m_capacity = cap;
+}
+
+int ParticleStreams::add()
+{
+	if ( m_size >= m_capacity )
+		reserve( m_size+1 );
+
+	// kernels may have written to padding elements
+	for ( int i = 0 ; i < STREAM_COUNT ; ++i )
+		m_streams[i][m_size] = 0.f;
+	return m_size++;
+}
+
+void ParticleStreams::swapRemove( int index )
+{
+	assert( index >= 0 && index < m_size );
+
+	int last = m_size - 1;
+	for ( int i = 0 ; i < STREAM_COUNT ; ++i )
+	{
+		float* s = m_streams[i];
+		s[index] = s[last];
+		s[last] = 0.f;
+	}
+	m_size = last;
+}
+
+void ParticleStreams::compact( const int* indices, int count )
+{
+	if ( count <= 0 )
+		return;
+	assert( count <= m_size );
+
+	// force accumulators are cleared before every use so they don't need to be moved
+	for ( int i = 0 ; i < FORCE_X ; ++i )
+	{
+		float* s = m_streams[i];
+		int dst = indices[0];
+		for ( int k = 0 ; k < count ; ++k )
+		{
+			assert( k == 0 || indices[k] > indices[k-1] );
+			int begin = indices[k] + 1;
+			int end = k+1 < count ? indices[k+1] : m_size;
+			if ( end > begin )
+			{
+				memmove( s+dst, s+begin, sizeof(float)*(end-begin) );
+				dst += end - begin;
+			}
+		}
+		memset( s+dst, 0, sizeof(float)*(m_size-dst) );
+	}
+	m_size -= count;
+}
+
+void ParticleStreams::clear()
+{
+	for ( int i = 0 ; i < STREAM_COUNT ; ++i )
+		if ( m_size > 0 )
+			memset( m_streams[i], 0, sizeof(float)*m_size );
+	m_size = 0;
+}
+
+void ParticleStreams::zero( StreamType stream )
+{
+	if ( m_size > 0 )
+		memset( m_streams[stream], 0, sizeof(float)*paddedSize() );
+}
+
+//-----------------------------------------------------------------------------
+
+void integrateParticles( ParticleStreams& streams, float dt )
+{
+	const int n = streams.paddedSize();
+	for ( int k = 0 ; k < 3 ; ++k )
+	{
+		float* pos = streams.stream( ParticleStreams::StreamType(ParticleStreams::POSITION_X+k) );
+		float* prev = streams.stream( ParticleStreams::StreamType(ParticleStreams::PREVIOUS_POSITION_X+k) );
+		float* vel = streams.stream( ParticleStreams::StreamType(ParticleStreams::VELOCITY_X+k) );
+		const float* force = streams.stream( ParticleStreams::StreamType(ParticleStreams::FORCE_X+k) );
+
+	#ifdef PS_SSE
+		const __m128 dt4 = _mm_set1_ps( dt );
+		for ( int i = 0 ; i < n ; i += 4 )
+		{
+			__m128 p = _mm_load_ps( pos+i );
+			__m128 v = _mm_add_ps( _mm_load_ps(vel+i), _mm_mul_ps(_mm_load_ps(force+i),dt4) );
+			_mm_store_ps( vel+i, v );
+			_mm_store_ps( prev+i, p );
+			_mm_store_ps( pos+i, _mm_add_ps(p,_mm_mul_ps(v,dt4)) );
+		}
+	#else
+		for ( int i = 0 ; i < n ; ++i )
+		{
+			vel[i] += force[i] * dt;
+			prev[i] = pos[i];
+			pos[i] += vel[i] * dt;
+		}
+	#endif
+	}
+}
+
+int ageParticles( ParticleStreams& streams, float dt, int* dead )
+{
+	const int n = streams.size();
+	float* time = streams.stream( ParticleStreams::TIME );
+	const float* lifeTime = streams.stream( ParticleStreams::LIFETIME );
+	int deadCount = 0;
+	int i = 0;
+
+#ifdef PS_SSE
+	const __m128 dt4 = _mm_set1_ps( dt );
+	for ( ; i+4 <= n ; i += 4 )
+	{
+		__m128 t = _mm_add_ps( _mm_load_ps(time+i), dt4 );
+		_mm_store_ps( time+i, t );
+		int mask = _mm_movemask_ps( _mm_cmpgt_ps(t,_mm_load_ps(lifeTime+i)) );
+		for ( int k = 0 ; mask != 0 ; ++k, mask >>= 1 )
+			if ( mask & 1 )
+				dead[deadCount++] = i+k;
+	}
+#endif
+
+	for ( ; i < n ; ++i )
+	{
+		time[i] += dt;
+		if ( time[i] > lifeTime[i] )
+			dead[deadCount++] = i;
+	}
+	return deadCount;
+}
+
+
+} // ps
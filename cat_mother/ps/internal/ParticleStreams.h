@@ -0,0 +1,113 @@
+#ifndef _PS_PARTICLESTREAMS_H
+#define _PS_PARTICLESTREAMS_H
+
+
+namespace ps
+{
+
+
+/**
+ * Structure-of-arrays particle storage.
+ * Every stream is a 16-byte aligned float array whose capacity
+ * is a multiple of 4 so that SIMD kernels can process
+ * the last partial group of particles without a scalar tail.
+ * Kernels may write to padding elements beyond size(),
+ * so add() clears the values of each new particle.
+ */
+class ParticleStreams
+{
+public:
+	/** Stream identifiers. The first ones match ParticleSystem::StreamType. */
+	enum StreamType
+	{
+		POSITION_X,
+		POSITION_Y,
+		POSITION_Z,
+		PREVIOUS_POSITION_X,
+		PREVIOUS_POSITION_Y,
+		PREVIOUS_POSITION_Z,
+		VELOCITY_X,
+		VELOCITY_Y,
+		VELOCITY_Z,
+		TIME,
+		LIFETIME,
+		FORCE_X,
+		FORCE_Y,
+		FORCE_Z,
+		STREAM_COUNT
+	};
+
+	///
+	ParticleStreams();
+
+	///
+	ParticleStreams( const ParticleStreams& other );
+
+	///
+	~ParticleStreams();
+
+	///
+	ParticleStreams& operator=( const ParticleStreams& other );
+
+	/** Makes sure there is room for at least n particles. */
+	void	reserve( int n );
+
+	/** Adds a particle with all values zero. Returns index of the particle. */
+	int		add();
+
+	/** Removes ith particle by moving the last particle to its place. */
+	void	swapRemove( int index );
+
+	/**
+	 * Removes particles in one pass. Order of the remaining particles is preserved.
+	 * Force streams are not moved since they are cleared before each use.
+	 * @param indices Indices of the particles to remove in ascending order.
+	 */
+	void	compact( const int* indices, int count );
+
+	/** Removes all particles. */
+	void	clear();
+
+	/** Sets all values of a stream to zero, including padding. */
+	void	zero( StreamType stream );
+
+	/** Returns number of particles. */
+	int		size() const											{return m_size;}
+
+	/** Returns number of particles rounded up to next multiple of 4. */
+	int		paddedSize() const										{return (m_size+3) & ~3;}
+
+	/** Returns specified stream. */
+	float*			stream( StreamType stream )						{return m_streams[stream];}
+
+	/** Returns specified stream. */
+	const float*	stream( StreamType stream ) const				{return m_streams[stream];}
+
+private:
+	float*	m_mem;
+	float*	m_streams[STREAM_COUNT];
+	int		m_size;
+	int		m_capacity;
+};
+
+
+/**
+ * Integrates particle velocities and positions over time step dt.
+ * Previous positions receive the positions before the update.
+ * Arrays must be 16-byte aligned and padded to a multiple of 4 elements.
+ */
+void	integrateParticles( ParticleStreams& streams, float dt );
+
+/**
+ * Advances particle times by dt and collects the indices
+ * of particles whose time exceeds their life time.
+ * @param dead [out] Receives dead particle indices in ascending order. Must have room for size() elements.
+ * @return Number of dead particles.
+ */
+int		ageParticles( ParticleStreams& streams, float dt, int* dead );
+
+
+} // ps
+
+
+#endif // _PS_PARTICLESTREAMS_H
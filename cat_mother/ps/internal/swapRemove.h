@@ -13,5 +13,28 @@ template <class T> void swapRemove( util::Vector<T>& arr, int index )
 	arr.setSize( arr.size() - 1 );
 }
 
+/** 
+ * Removes elements in one pass preserving order of the remaining elements. 
+ * @param indices Indices of the elements to remove in ascending order.
+ */
+template <class T> void compactRemove( util::Vector<T>& arr, const int* indices, int count )
+{
+	if ( count <= 0 )
+		return;
+	assert( count <= arr.size() );
+
+	const int n = arr.size();
+	int dst = indices[0];
+	for ( int k = 0 ; k < count ; ++k )
+	{
+		assert( indices[k] >= 0 && indices[k] < n );
+		assert( k == 0 || indices[k] > indices[k-1] );
+		int end = k+1 < count ? indices[k+1] : n;
+		for ( int i = indices[k]+1 ; i < end ; ++i )
+			arr[dst++] = arr[i];
+	}
+	arr.setSize( n - count );
+}
+
 
 } // ps
@@ -175,6 +175,14 @@ SOURCE=.\SpriteParticleSystem.h
 
 SOURCE=.\internal\config.h
 # End Source File
+# Begin Source File
+
+SOURCE=.\internal\ParticleStreams.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\internal\ParticleStreams.h
+# End Source File
 # End Group
 # Begin Group "docs"
 
@@ -0,0 +1,211 @@
+#include <tester/Test.h>
+#include <ps/Gravity.h>
+#include <util/Vector.h>
+#include <math/Vector3.h>
+#include "ParticleStreams.h"
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+//-----------------------------------------------------------------------------
+
+using namespace ps;
+using namespace lang;
+using namespace util;
+using namespace math;
+
+//-----------------------------------------------------------------------------
+
+/**
+ * Array-of-structures particle store matching the original
+ * ParticleSystem update: per particle force accumulation and
+ * integration, and swap-remove of each expired particle
+ * inside the aging loop.
+ */
+class ParticleArrays
+{
+public:
+	Vector<float>		times;
+	Vector<float>		lifeTimes;
+	Vector<Vector3>		positions;
+	Vector<Vector3>		previousPositions;
+	Vector<Vector3>		velocities;
+	Vector<Vector3>		forces;
+
+	ParticleArrays() :
+		times( Allocator<float>(__FILE__,__LINE__) ),
+		lifeTimes( Allocator<float>(__FILE__,__LINE__) ),
+		positions( Allocator<Vector3>(__FILE__,__LINE__) ),
+		previousPositions( Allocator<Vector3>(__FILE__,__LINE__) ),
+		velocities( Allocator<Vector3>(__FILE__,__LINE__) ),
+		forces( Allocator<Vector3>(__FILE__,__LINE__) )
+	{
+	}
+
+	void add( const Vector3& pos, const Vector3& vel, float lifeTime )
+	{
+		times.add( 0.f );
+		lifeTimes.add( lifeTime );
+		positions.add( pos );
+		previousPositions.add( pos );
+		velocities.add( vel );
+		forces.add( Vector3(0,0,0) );
+	}
+
+	void remove( int i )
+	{
+		int last = times.size()-1;
+		times[i] = times[last]; times.setSize( last );
+		lifeTimes[i] = lifeTimes[last]; lifeTimes.setSize( last );
+		positions[i] = positions[last]; positions.setSize( last );
+		previousPositions[i] = previousPositions[last]; previousPositions.setSize( last );
+		velocities[i] = velocities[last]; velocities.setSize( last );
+		forces[i] = forces[last]; forces.setSize( last );
+	}
+
+	void update( const Vector3& g, float dt )
+	{
+		int i;
+		for ( i = 0 ; i < forces.size() ; ++i )
+			forces[i] = Vector3(0,0,0);
+		for ( i = 0 ; i < forces.size() ; ++i )
+			forces[i] += g;
+		for ( i = 0 ; i < positions.size() ; ++i )
+		{
+			velocities[i] += forces[i] * dt;
+			previousPositions[i] = positions[i];
+			positions[i] += velocities[i] * dt;
+		}
+		for ( i = 0 ; i < times.size() ; ++i )
+		{
+			float& t = times[i];
+			t += dt;
+			if ( t > lifeTimes[i] )
+			{
+				remove( i );
+				--i;
+			}
+		}
+	}
+};
+
+//-----------------------------------------------------------------------------
+
+static void addParticle( ParticleStreams& s, const Vector3& pos, const Vector3& vel, float lifeTime )
+{
+	int i = s.add();
+	s.stream(ParticleStreams::POSITION_X)[i] = pos.x;
+	s.stream(ParticleStreams::POSITION_Y)[i] = pos.y;
+	s.stream(ParticleStreams::POSITION_Z)[i] = pos.z;
+	s.stream(ParticleStreams::PREVIOUS_POSITION_X)[i] = pos.x;
+	s.stream(ParticleStreams::PREVIOUS_POSITION_Y)[i] = pos.y;
+	s.stream(ParticleStreams::PREVIOUS_POSITION_Z)[i] = pos.z;
+	s.stream(ParticleStreams::VELOCITY_X)[i] = vel.x;
+	s.stream(ParticleStreams::VELOCITY_Y)[i] = vel.y;
+	s.stream(ParticleStreams::VELOCITY_Z)[i] = vel.z;
+	s.stream(ParticleStreams::LIFETIME)[i] = lifeTime;
+}
+
+static void update( ParticleStreams& s, Force* force, Vector<int>& dead, float dt )
+{
+	s.zero( ParticleStreams::FORCE_X );
+	s.zero( ParticleStreams::FORCE_Y );
+	s.zero( ParticleStreams::FORCE_Z );
+	const float* const pos[3] = { s.stream(ParticleStreams::POSITION_X), s.stream(ParticleStreams::POSITION_Y), s.stream(ParticleStreams::POSITION_Z) };
+	const float* const vel[3] = { s.stream(ParticleStreams::VELOCITY_X), s.stream(ParticleStreams::VELOCITY_Y), s.stream(ParticleStreams::VELOCITY_Z) };
+	float* const f[3] = { s.stream(ParticleStreams::FORCE_X), s.stream(ParticleStreams::FORCE_Y), s.stream(ParticleStreams::FORCE_Z) };
+	force->apply( 0.f, dt, pos, vel, f, s.size() );
+	integrateParticles( s, dt );
+
+	dead.setSize( s.size() );
+	int deadCount = ageParticles( s, dt, dead.begin() );
+	s.compact( dead.begin(), deadCount );
+}
+
+static double sum( const float* v, int n )
+{
+	double x = 0.0;
+	for ( int i = 0 ; i < n ; ++i )
+		x += v[i];
+	return x;
+}
+
+static void testCompact()
+{
+	ParticleStreams s;
+	int i;
+	for ( i = 0 ; i < 13 ; ++i )
+		addParticle( s, Vector3((float)i,0,0), Vector3(0,0,0), 1.f );
+
+	const int remove[] = {0,3,4,12};
+	s.compact( remove, 4 );
+	assert( s.size() == 9 );
+
+	const float expected[] = {1,2,5,6,7,8,9,10,11};
+	const float* x = s.stream( ParticleStreams::POSITION_X );
+	for ( i = 0 ; i < s.size() ; ++i )
+		assert( x[i] == expected[i] );
+	for ( ; i < s.paddedSize() ; ++i )
+		assert( x[i] == 0.f );
+}
+
+static void benchmark( int count, int frames )
+{
+	const float dt = 1.f / 60.f;
+	const Vector3 g( 0, -9.8f, 0 );
+	P(Force) gravity = new Gravity( 9.8f );
+
+	ParticleArrays aos;
+	ParticleStreams soa;
+	Vector<int> dead( Allocator<int>(__FILE__,__LINE__) );
+	srand( 1234 );
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		Vector3 pos( (float)(rand()%100), (float)(rand()%100), (float)(rand()%100) );
+		Vector3 vel( (float)(rand()%10), (float)(rand()%10), (float)(rand()%10) );
+		float lifeTime = (float)(rand()%1000) * 2e-3f * (float)frames * dt;
+		aos.add( pos, vel, lifeTime );
+		addParticle( soa, pos, vel, lifeTime );
+	}
+
+	clock_t t0 = clock();
+	int k;
+	for ( k = 0 ; k < frames ; ++k )
+		aos.update( g, dt );
+	clock_t t1 = clock();
+	for ( k = 0 ; k < frames ; ++k )
+		update( soa, gravity, dead, dt );
+	clock_t t2 = clock();
+
+	// order differs (swap-remove vs compaction) so compare only totals
+	assert( aos.positions.size() == soa.size() );
+	double aosy = 0.0;
+	for ( k = 0 ; k < aos.positions.size() ; ++k )
+		aosy += aos.positions[k].y;
+	double soay = sum( soa.stream(ParticleStreams::POSITION_Y), soa.size() );
+	double err = aosy - soay;
+	if ( err < 0.0 )
+		err = -err;
+	assert( err <= 1e-4 * (aosy < 0.0 ? -aosy : aosy) + 1e-3 );
+
+	printf( "  %d particles, %d frames: arrays %g ms, streams %g ms (%d left)\n",
+		count, frames,
+		(double)(t1-t0)*1e3/CLOCKS_PER_SEC,
+		(double)(t2-t1)*1e3/CLOCKS_PER_SEC,
+		soa.size() );
+}
+
+static int test()
+{
+	testCompact();
+
+	printf( "Particle update benchmark:\n" );
+	benchmark( 10000, 200 );
+	benchmark( 100000, 200 );
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+static tester::Test reg( test, __FILE__ );
@@ -2,7 +2,8 @@
 #include "Light.h"
 #include "Scene.h"
 #include "Context.h"
-#include "NodeDistanceToCameraLess.h"
+#include "RadixSort.h"
+#include "SphereTree.h"
 #include "BoundVolume.h"
 #include <gd/GraphicsDevice.h>
 #include <pix/Color.h>
@@ -14,8 +15,9 @@
 #include <util/Vector.h>
 #include <math/Vector4.h>
 #include <math/Matrix4x4.h>
-#include <algorithm>
 #include <time.h>
+#include <string.h>
+#include <stdint.h>
 #include <assert.h>
 #include "config.h"
 
@@ -33,12 +35,48 @@ namespace sg
 
 
 static Vector<Node*>	s_objs( Allocator<Node*>(__FILE__,__LINE__) );
+static Vector<Node*>	s_queue( Allocator<Node*>(__FILE__,__LINE__) );
+static Vector<uint32_t>	s_keys( Allocator<uint32_t>(__FILE__,__LINE__) );
+static Vector<int>		s_order( Allocator<int>(__FILE__,__LINE__) );
+static Vector<int>		s_temp( Allocator<int>(__FILE__,__LINE__) );
 static Vector<Light*>	s_lights( Allocator<Light*>(__FILE__,__LINE__) );
 static Object			s_globalMutex( Object::OBJECT_INITMUTEX );
 static int				s_cameras = 0;
 
 //-----------------------------------------------------------------------------
 
+/** 
+ * Bounding sphere hierarchy of sphere cullable nodes. 
+ * Tree is refitted as long as the same nodes are found in the same order.
+ */
+class Camera::CullData :
+	public Object
+{
+public:
+	SphereTree		tree;
+	Vector<Node*>	treeNodes;		// leaves of the tree
+	Vector<Node*>	nodes;			// sphere cullable nodes in this frame
+	Vector<float>	spheres;		// world space (x,y,z,radius) of each node
+	Vector<int>		visible;
+
+	CullData() :
+		treeNodes( Allocator<Node*>(__FILE__,__LINE__) ),
+		nodes( Allocator<Node*>(__FILE__,__LINE__) ),
+		spheres( Allocator<float>(__FILE__,__LINE__) ),
+		visible( Allocator<int>(__FILE__,__LINE__) )
+	{
+	}
+
+	/** Returns true if the tree was built for the current nodes. */
+	bool sameNodes() const
+	{
+		return nodes.size() == treeNodes.size() &&
+			( 0 == nodes.size() || 0 == memcmp(nodes.begin(), treeNodes.begin(), sizeof(Node*)*nodes.size()) );
+	}
+};
+
+//-----------------------------------------------------------------------------
+
 /** Converts scene fog mode to graphics device fog mode. */
 static gd::GraphicsDevice::FogMode togd( Scene::FogMode fog )
 {
@@ -77,13 +115,16 @@ static void setFog( gd::GraphicsDevice* dev, Scene* scene )
 Camera::Camera() 
 {
 	defaults();
+	m_cull = new CullData;
 	++s_cameras;
 }
 
 Camera::Camera( const Camera& other ) : 
 	Node(other)
 {
+	resetStatistics();
 	assign(other);
+	m_cull = new CullData;
 	++s_cameras;
 }
 
@@ -93,6 +134,14 @@ Camera::~Camera()
 	{
 		s_objs.clear();
 		s_objs.trimToSize();
+		s_queue.clear();
+		s_queue.trimToSize();
+		s_keys.clear();
+		s_keys.trimToSize();
+		s_order.clear();
+		s_order.trimToSize();
+		s_temp.clear();
+		s_temp.trimToSize();
 		s_lights.clear();
 		s_lights.trimToSize();
 	}
@@ -193,6 +242,7 @@ void Camera::prepareRender()
 	// - find out front and back plane distances
 	// - collect visible objects and lights
 	// - update node visibility
+	// - cull sphere cullable objects in bounding sphere hierarchy
 	// - sort visible objects by ascending distance
 	// - set viewport, view- and projection transformation
 	// - add affecting lights to rendering device
@@ -207,8 +257,11 @@ void Camera::prepareRender()
 	Vector3 camWorldDir = cachedWorldTransform().rotation().getColumn(2);
 	
 	// - collect visible objects and lights
+	CullData* cull = m_cull;
 	s_objs.clear();
 	s_lights.clear();
+	cull->nodes.clear();
+	cull->spheres.clear();
 
 	for ( Node* obj = root ; obj ; )
 	{
@@ -219,24 +272,36 @@ void Camera::prepareRender()
 		{
 			if ( obj->renderable() )
 			{
-				Light* light = dynamic_cast<Light*>( obj );
-
-				if ( light )
+				if ( obj->sphereCullable() )
 				{
-					s_lights.add( light );
-					++m_renderedLights;
+					// bound sphere scaled by the largest axis scale
+					const Matrix4x4& tm = obj->m_worldTransform;
+					float scale2 = 0.f;
+					for ( int k = 0 ; k < 3 ; ++k )
+					{
+						float s2 = tm(0,k)*tm(0,k) + tm(1,k)*tm(1,k) + tm(2,k)*tm(2,k);
+						if ( s2 > scale2 )
+							scale2 = s2;
+					}
+
+					cull->nodes.add( obj );
+					cull->spheres.add( tm(0,3) );
+					cull->spheres.add( tm(1,3) );
+					cull->spheres.add( tm(2,3) );
+					cull->spheres.add( obj->boundSphere() * Math::sqrt(scale2) );
 				}
 				else
 				{
-					obj->m_distanceToCamera = obj->boundSphere() + 
-						(obj->m_worldTransform.translation() 
-						- camWorldPos).dot( camWorldDir );
+					Light* light = dynamic_cast<Light*>( obj );
 
-					if ( obj->updateVisibility(this) )
+					if ( light )
+					{
+						s_lights.add( light );
+						++m_renderedLights;
+					}
+					else
 					{
-						obj->m_flags |= NODE_RENDEREDINLASTFRAME;
-						s_objs.add( obj );
-						++m_renderedObjects;
+						checkVisibility( obj, camWorldPos, camWorldDir );
 					}
 				}
 			}
@@ -246,8 +311,42 @@ void Camera::prepareRender()
 		obj = obj->nextInHierarchy( Node::NODE_ENABLED );
 	}
 
+	// - cull sphere cullable objects in bounding sphere hierarchy
+	const int cullable = cull->nodes.size();
+	if ( cull->sameNodes() && !cull->tree.degraded() )
+	{
+		cull->tree.refit( cull->spheres.begin() );
+	}
+	else
+	{
+		cull->tree.build( cull->spheres.begin(), cullable );
+		cull->treeNodes = cull->nodes;
+		++m_cullTreeRebuilds;
+	}
+
+	Vector4 planes[ViewFrustum::PLANE_COUNT];
+	getWorldFrustumPlanes( planes );
+	cull->visible.setSize( cullable );
+	int tests = 0;
+	int visible = cull->tree.cull( planes, ViewFrustum::PLANE_COUNT, cull->visible.begin(), &tests );
+	m_cullTests += tests;
+	m_culledObjects += cullable - visible;
+
+	int i;
+	for ( i = 0 ; i < visible ; ++i )
+		checkVisibility( cull->nodes[ cull->visible[i] ], camWorldPos, camWorldDir );
+
 	// - sort visible objects by ascending distance
-	std::sort( s_objs.begin(), s_objs.end(), NodeDistanceToCameraLess() );
+	const int objs = s_objs.size();
+	s_keys.setSize( objs );
+	s_order.setSize( objs );
+	s_temp.setSize( objs );
+	s_queue.setSize( objs );
+	for ( i = 0 ; i < objs ; ++i )
+		s_keys[i] = RadixSort::floatKey( s_objs[i]->m_distanceToCamera );
+	RadixSort::sort( s_keys.begin(), objs, s_order.begin(), s_temp.begin() );
+	for ( i = 0 ; i < objs ; ++i )
+		s_queue[i] = s_objs[ s_order[i] ];
 
 	// - set viewport, view- and projection transformation
 	gd::GraphicsDevice* dev = Context::device();
@@ -257,7 +356,7 @@ void Camera::prepareRender()
 
 	// - add affecting lights to rendering device
 	dev->removeLights();
-	for ( int i = 0 ; i < (int)s_lights.size() ; ++i )
+	for ( i = 0 ; i < (int)s_lights.size() ; ++i )
 		s_lights[i]->apply();
 
 	// - set fog and ambient if any
@@ -327,9 +426,9 @@ void Camera::render()
 	//Debug::println( "{0}({1})", __FILE__, __LINE__ );
 	{//dev::Profile pr( "Camera.render( pass 1 )" );
 	int i;
-	for ( i = 0 ; i < (int)s_objs.size() ; ++i )
+	for ( i = 0 ; i < (int)s_queue.size() ; ++i )
 	{
-		Node* obj = s_objs[i];
+		Node* obj = s_queue[i];
 		//Debug::println( "rendering {0}({1})", obj->name(), i );
 		obj->render( this, 1 );
 	}
@@ -340,9 +439,9 @@ void Camera::render()
 	{//dev::Profile pr( "Camera.render( other passes )" );
 	for ( int pass = 2 ; pass <= LAST_RENDERING_PASS ; pass <<= 1 )
 	{
-		for ( int i = (int)s_objs.size() ; i-- > 0 ; )
+		for ( int i = (int)s_queue.size() ; i-- > 0 ; )
 		{
-			Node* obj = s_objs[i];
+			Node* obj = s_queue[i];
 			obj->render( this, pass );
 		}
 	}
@@ -401,6 +500,10 @@ void Camera::resetStatistics()
 	m_renderedPrimitives	= 0;
 	m_renderedTriangles		= 0;
 	m_materialChanges		= 0;
+	m_culledObjects			= 0;
+	m_cullTests				= 0;
+	m_cullTreeRebuilds		= 0;
+	m_visibilityChecks		= 0;
 }
 
 float Camera::front() const															
@@ -453,6 +556,26 @@ int Camera::materialChanges() const
 	return m_materialChanges;
 }
 
+int Camera::culledObjects() const
+{
+	return m_culledObjects;
+}
+
+int Camera::cullTests() const
+{
+	return m_cullTests;
+}
+
+int Camera::cullTreeRebuilds() const
+{
+	return m_cullTreeRebuilds;
+}
+
+int Camera::visibilityChecks() const
+{
+	return m_visibilityChecks;
+}
+
 float Camera::getProjectedSize( float distanceZ, float size ) const
 {
 	assert( size >= 0.f );
@@ -510,6 +633,38 @@ bool Camera::isInView( const Vector3& center, float radius ) const
 		viewFrustum().planes(), ViewFrustum::PLANE_COUNT );
 }
 
+void Camera::checkVisibility( Node* obj, const Vector3& camWorldPos, const Vector3& camWorldDir )
+{
+	obj->m_distanceToCamera = obj->boundSphere() + 
+		(obj->m_worldTransform.translation() 
+		- camWorldPos).dot( camWorldDir );
+
+	++m_visibilityChecks;
+	if ( obj->updateVisibility(this) )
+	{
+		obj->m_flags |= NODE_RENDEREDINLASTFRAME;
+		s_objs.add( obj );
+		++m_renderedObjects;
+	}
+}
+
+void Camera::getWorldFrustumPlanes( Vector4* planes ) const
+{
+	// world->camera transform applied to camera space planes
+	const Matrix4x4& tm = m_worldToCamera;
+	const Vector4* cameraPlanes = m_viewFrustum.planes();
+	for ( int i = 0 ; i < ViewFrustum::PLANE_COUNT ; ++i )
+	{
+		const Vector4& p = cameraPlanes[i];
+		Vector4 plane( tm(0,0)*p.x + tm(1,0)*p.y + tm(2,0)*p.z,
+			tm(0,1)*p.x + tm(1,1)*p.y + tm(2,1)*p.z,
+			tm(0,2)*p.x + tm(1,2)*p.y + tm(2,2)*p.z,
+			tm(0,3)*p.x + tm(1,3)*p.y + tm(2,3)*p.z + p.w );
+		float len = Math::sqrt( plane.x*plane.x + plane.y*plane.y + plane.z*plane.z );
+		planes[i] = plane * (1.f/len);
+	}
+}
+
 void Camera::updateCachedTransforms()
 {
 	m_worldToCamera = worldTransform().inverse();
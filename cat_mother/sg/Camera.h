@@ -180,7 +180,21 @@ public:
 	/** Returns number of material changes. */
 	int		materialChanges() const;
 
+	/** Returns number of objects rejected by bounding sphere hierarchy. */
+	int		culledObjects() const;
+
+	/** Returns number of bounding spheres tested in bounding sphere hierarchy. */
+	int		cullTests() const;
+
+	/** Returns number of times bounding sphere hierarchy was rebuilt. */
+	int		cullTreeRebuilds() const;
+
+	/** Returns number of object visibility checks (Node::updateVisibility calls). */
+	int		visibilityChecks() const;
+
 private:
+	class CullData;
+
 	int						m_x;
 	int						m_y;
 	int						m_width;
@@ -199,6 +213,11 @@ private:
 	int						m_renderedPrimitives;
 	int						m_renderedTriangles;
 	int						m_materialChanges;
+	int						m_culledObjects;
+	int						m_cullTests;
+	int						m_cullTreeRebuilds;
+	int						m_visibilityChecks;
+	P(CullData)				m_cull;
 
 	void	defaults();
 	void	assign( const Camera& other );
@@ -213,6 +232,12 @@ private:
 	/** Prepares everything for rendering the scene, see Camera.cpp. */
 	void	prepareRender();
 
+	/** Updates object distance and visibility and adds visible object to the render queue. */
+	void	checkVisibility( Node* obj, const math::Vector3& camWorldPos, const math::Vector3& camWorldDir );
+
+	/** Returns view frustum planes in world space. */
+	void	getWorldFrustumPlanes( math::Vector4* planes ) const;
+
 	Camera& operator=( const Camera& other );
 };
 
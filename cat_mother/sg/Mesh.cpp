@@ -3,6 +3,9 @@
 #include "Shader.h"
 #include "Context.h"
 #include "Primitive.h"
+#include "Model.h"
+#include "TriangleList.h"
+#include "VertexFormat.h"
 #include <gd/GraphicsDevice.h>
 #include <dev/Profile.h>
 #include <lang/String.h>
@@ -60,12 +63,14 @@ public:
 	Vector<P(Primitive)>	primitives;
 	Vector<Bone>			bones;
 	float					boundSphere;
+	bool					boundStatic;
 	bool					boundDirty;
 
 	MeshImpl() :
 		primitives( Allocator<P(Primitive)>(__FILE__,__LINE__) ),
 		bones( Allocator<Bone>(__FILE__,__LINE__) ),
 		boundSphere(0.f),
+		boundStatic(false),
 		boundDirty(false)
 	{
 	}
@@ -73,13 +78,26 @@ public:
 	void refreshBoundSphere()
 	{
 		float maxr = 0.f;
+		bool stat = primitives.size() > 0;
 		for ( int i = 0 ; i < primitives.size() ; ++i )
 		{
-			float r = primitives[i]->boundSphere();
+			Primitive* prim = primitives[i];
+			float r = prim->boundSphere();
 			if ( r > maxr )
 				maxr = r;
+
+			// bound sphere of static models contains all vertices
+			// (dynamic triangle lists have infinite bound sphere)
+			Model* model = dynamic_cast<Model*>( prim );
+			if ( model )
+				stat = stat && Model::USAGE_STATIC == model->usage();
+			else if ( !dynamic_cast<TriangleList*>(prim) )
+				stat = false;
+			VertexFormat vf = prim->vertexFormat();
+			stat = stat && !vf.hasRHW() && 0 == vf.weights();
 		}
 		boundSphere = maxr;
+		boundStatic = stat;
 		boundDirty = false;
 	}
 };
@@ -345,6 +363,15 @@ float Mesh::boundSphere() const
 	return m_this->boundSphere;
 }
 
+bool Mesh::sphereCullable() const
+{
+	if ( m_this->bones.size() > 0 )
+		return false;
+	if ( m_this->boundDirty )
+		m_this->refreshBoundSphere();
+	return m_this->boundStatic;
+}
+
 void Mesh::restoreBones( Node* root )
 {
 	for ( int i = 0 ; i < m_this->bones.size() ; ++i )
@@ -101,6 +101,12 @@ public:
 	 */
 	float		boundSphere() const;
 
+	/** 
+	 * Returns true if the mesh has no bones and all primitives are static models or
+	 * triangle lists, i.e. the primitive vertices are inside the bounding sphere.
+	 */
+	bool		sphereCullable() const;
+
 private:
 	class MeshImpl;
 	P(MeshImpl) m_this;
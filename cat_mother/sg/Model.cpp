@@ -11,6 +11,7 @@
 #include "ViewFrustum.h"
 #include "LockException.h"
 #include "Material.h"
+#include "SkinningEngine.h"
 #include <gd/LockMode.h>
 #include <gd/Primitive.h>
 #include <gd/VertexFormat.h>
@@ -114,8 +115,13 @@ public:
 	gd::Primitive::UsageType			usage;
 	PolygonAdjacency					adj;
 	float								adjZeroDistance;
+	int									dataVersion;	// incremented when geometry is modified
 	bool								weightsDirty;
 	util::Vector<int>					usedBoneArray;	// update if weightsDirty
+	P(SkinningEngine)					skinning;
+	bool								skinningDirty;
+	int									skinningTangentLayer;
+	util::Vector<Vector3>				skinBuffer;
 
 	ModelImpl( int vertexCount, int indexCount, const VertexFormat& vf,
 		gd::Primitive::UsageType usage ) :
@@ -134,8 +140,13 @@ public:
 		usage( usage ),
 		adj(),
 		adjZeroDistance( -1.f ),
+		dataVersion( 0 ),
 		weightsDirty( true ),
-		usedBoneArray( Allocator<int>(__FILE__) )
+		usedBoneArray( Allocator<int>(__FILE__) ),
+		skinning( 0 ),
+		skinningDirty( true ),
+		skinningTangentLayer( -1 ),
+		skinBuffer( Allocator<Vector3>(__FILE__) )
 	{
 		createMesh();
 	}
@@ -211,6 +222,64 @@ public:
 		weightsDirty = false;
 	}
 
+	/** 
+	 * Returns skinning engine with rest pose of the vertices.
+	 * Engine is rebuilt if the vertices have been locked for writing
+	 * or requested streams are missing. Requires that the vertices are readable.
+	 */
+	SkinningEngine* getSkinningEngine( bool normals, int tangentLayer )
+	{
+		assert( canReadVertices() );
+
+		if ( !skinning )
+			skinning = new SkinningEngine;
+
+		normals = normals || skinning->hasNormals();
+		if ( tangentLayer < 0 )
+			tangentLayer = skinningTangentLayer;
+
+		if ( skinningDirty || skinning->vertices() != vertices ||
+			normals != skinning->hasNormals() || tangentLayer != skinningTangentLayer )
+		{
+			float* pos;
+			int pitch;
+			mesh->getVertexPositionData( &pos, &pitch );
+
+			skinBuffer.setSize( vertices*2 );
+			Vector3* norm = 0;
+			if ( normals )
+			{
+				norm = skinBuffer.begin();
+				mesh->getVertexNormals( 0, norm, vertices );
+			}
+			Vector3* tang = 0;
+			if ( tangentLayer >= 0 )
+			{
+				assert( vf.getTextureCoordinateSize(tangentLayer) == 3 );
+				tang = skinBuffer.begin() + vertices;
+				mesh->getVertexTextureCoordinates( 0, tangentLayer, 3, tang->begin(), vertices );
+			}
+
+			skinning->setVertices( vertices, pos, pitch,
+				norm ? norm->begin() : 0, 3, tang ? tang->begin() : 0, 3 );
+
+			if ( vf.weights() > 0 )
+			{
+				int boneIndices[MAX_BONES_PER_VERTEX];
+				float boneWeights[MAX_BONES_PER_VERTEX];
+				for ( int i = 0 ; i < vertices ; ++i )
+				{
+					int bones = mesh->getVertexWeights( i, boneIndices, boneWeights, MAX_BONES_PER_VERTEX );
+					skinning->setVertexWeights( i, boneIndices, boneWeights, bones );
+				}
+			}
+
+			skinningDirty = false;
+			skinningTangentLayer = tangentLayer;
+		}
+		return skinning;
+	}
+
 private:
 	void createMesh()
 	{
@@ -677,6 +746,8 @@ void Model::lockVertices( LockType lock )
 	{
 		m_this->boundSphereDirty = true;
 		m_this->boundBoxDirty = true;
+		m_this->skinningDirty = true;
+		++m_this->dataVersion;
 	}
 
 	getLockedData();
@@ -701,7 +772,10 @@ void Model::lockIndices( LockType lock )
 	m_this->indexlock = indexlock;
 
 	if ( lock != LOCK_READ )
+	{
 		m_this->adjZeroDistance = -1.f;
+		++m_this->dataVersion;
+	}
 
 	int indexSize;
 	m_this->mesh->getIndexData( (void**)&m_indexData, &indexSize );
@@ -996,6 +1070,12 @@ int Model::maxIndices() const
 	return m_this->maxIndices;
 }
 
+int Model::dataVersion() const
+{
+	assert( m_this );
+	return m_this->dataVersion;
+}
+
 void Model::setVertices( int count )
 {
 	assert( m_this );
@@ -1005,6 +1085,7 @@ void Model::setVertices( int count )
 
 	m_this->vertices = count;
 	m_this->weightsDirty = true;
+	++m_this->dataVersion;
 }
 
 void Model::setIndices( int count )
@@ -1016,6 +1097,7 @@ void Model::setIndices( int count )
 	
 	m_this->indices = count;
 	m_this->weightsDirty = true;
+	++m_this->dataVersion;
 }
 
 void Model::setMaxVertices( int count )
@@ -1273,11 +1355,62 @@ void Model::getVertexPositionData( float** data, int* pitch )
 }
 
 void Model::getTransformedVertexPositions( const Matrix4x4* tm, int tmcount,
-	const Matrix4x4& posttm, Vector3* v, int vcount, bool mostSignifigantBoneOnly ) const
+	const Matrix4x4& posttm, Vector3* v, int vcount, bool mostSignifigantBoneOnly )
+{
+	assert( m_this );
+	assert( canReadVertices() );
+	assert( vcount <= m_this->vertices );
+
+	if ( 0 == m_this->vf.weights() )
+	{
+		m_this->mesh->getTransformedVertexPositions( tm, tmcount, posttm, v, vcount, mostSignifigantBoneOnly );
+		return;
+	}
+
+	SkinningEngine* skin = m_this->getSkinningEngine( false, -1 );
+	if ( vcount == skin->vertices() )
+	{
+		skin->skin( tm, tmcount, posttm, v->begin(), 3, 0, 3, 0, 3, mostSignifigantBoneOnly );
+	}
+	else
+	{
+		Vector<Vector3>& buf = m_this->skinBuffer;
+		buf.setSize( skin->vertices() );
+		skin->skin( tm, tmcount, posttm, buf.begin()->begin(), 3, 0, 3, 0, 3, mostSignifigantBoneOnly );
+		for ( int i = 0 ; i < vcount ; ++i )
+			v[i] = buf[i];
+	}
+}
+
+void Model::skinVertices( const Matrix4x4* tm, int tmcount, const Matrix4x4& posttm, 
+	Model* target, int tangentLayer )
 {
 	assert( m_this );
 	assert( canReadVertices() );
-	m_this->mesh->getTransformedVertexPositions( tm, tmcount, posttm, v, vcount, mostSignifigantBoneOnly );
+	assert( target && target != this );
+	assert( target->canWriteVertices() );
+	assert( target->vertices() >= m_this->vertices );
+
+	const bool normals = m_this->vf.hasNormal() && target->vertexFormat().hasNormal();
+	SkinningEngine* skin = m_this->getSkinningEngine( normals, tangentLayer );
+	const int n = skin->vertices();
+
+	// positions go directly to the vertex data of the target
+	float* vdata;
+	int vpitch;
+	target->getVertexPositionData( &vdata, &vpitch );
+
+	Vector<Vector3>& buf = m_this->skinBuffer;
+	buf.setSize( n*2 );
+	Vector3* norm = normals ? buf.begin() : 0;
+	Vector3* tang = tangentLayer >= 0 ? buf.begin()+n : 0;
+	skin->skin( tm, tmcount, posttm, vdata, vpitch,
+		norm ? norm->begin() : 0, 3, tang ? tang->begin() : 0, 3 );
+
+	if ( norm )
+		target->setVertexNormals( 0, norm, n );
+	if ( tang )
+		target->setVertexTextureCoordinates( 0, tangentLayer, 3, tang->begin(), n );
 }
 
 Model::UsageType Model::usage() const
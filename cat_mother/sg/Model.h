@@ -276,7 +276,12 @@ public:
 	/** 
 	 * Returns transformed vertex positions when using specified transformation palette.
 	 * Vertices are first transformed to world space and then specified post transformation is applied.
-	 * Requires that the vertices are locked.
+	 * Skinned vertices are computed by SkinningEngine (at most 4 bones per vertex)
+	 * which is built from the vertex data when first needed and after 
+	 * the vertices have been locked for writing.
+	 * Requires that the vertices are locked for reading.
+	 * Not re-entrant: skinning uses the engine and buffers of this model,
+	 * so don't call concurrently for the same model.
 	 * @param tm Transformation palette. Used in skinning, tm 0 is normal world transform.
 	 * @param tmcount Number of transformations in the palette. Used only in skinning.
 	 * @param posttm Transformation to apply to world space vertices.
@@ -285,7 +290,23 @@ public:
 	 * @param mostSignifigantBoneOnly If true then only the most signifigantly influencing bone is used.
 	 */
 	void	getTransformedVertexPositions( const math::Matrix4x4* tm, int tmcount,
-				const math::Matrix4x4& posttm, math::Vector3* v, int vcount, bool mostSignifigantBoneOnly ) const;
+				const math::Matrix4x4& posttm, math::Vector3* v, int vcount, bool mostSignifigantBoneOnly );
+
+	/**
+	 * Writes skinned vertices of this model to another model.
+	 * Positions are written directly to the vertex data of the target.
+	 * Normals are written if both models have them and tangents if tangentLayer is specified.
+	 * Requires that the vertices of this model are locked for reading
+	 * and the vertices of the target are locked for writing.
+	 * Not re-entrant, see getTransformedVertexPositions.
+	 * @param tm Transformation palette. tm 0 is normal world transform.
+	 * @param tmcount Number of transformations in the palette.
+	 * @param posttm Transformation to apply to world space vertices.
+	 * @param target [out] Receives skinned vertices. Must have at least vertices() vertices.
+	 * @param tangentLayer 3-component texture coordinate layer with vertex tangents (see computeVertexTangents), or -1.
+	 */
+	void	skinVertices( const math::Matrix4x4* tm, int tmcount, const math::Matrix4x4& posttm,
+				Model* target, int tangentLayer=-1 );
 
 	/** Returns vertex normals. Requires that the vertices are locked. */
 	void	getVertexNormals( int firstVertex, math::Vector3* normals, int count=1 ) const;
@@ -330,6 +351,12 @@ public:
 	/** Returns maximum number of indices in the model. */
 	int		maxIndices() const;
 
+	/** 
+	 * Returns counter which is incremented whenever vertices or 
+	 * indices are locked for writing or their number changes.
+	 */
+	int		dataVersion() const;
+
 	/** Returns true if vertices are locked. */
 	bool	verticesLocked() const;
 
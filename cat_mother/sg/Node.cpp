@@ -514,5 +514,10 @@ float Node::boundSphere() const
 	return 0.f;
 }
 
+bool Node::sphereCullable() const
+{
+	return false;
+}
+
 
 } // sg
@@ -226,6 +226,14 @@ public:
 	/** Returns bounding radius of the node. Default is 0. */
 	virtual float			boundSphere() const;
 
+	/**
+	 * Returns true if the node is never visible when its bounding sphere
+	 * (boundSphere() around the node world position) is outside the view frustum.
+	 * Camera skips updateVisibility() of such nodes if the sphere is not in view.
+	 * Default is false.
+	 */
+	virtual bool			sphereCullable() const;
+
 	/**
 	 * Returns true if cached world transform is valid. 
 	 * Cached world transform is validated by calling validateHierarchy() for the root node.
@@ -1,4 +1,7 @@
 #include "ShadowVolume.h"
+#include "SkinningEngine.h"
+#include "ShadowFaces.h"
+#include "ShadowBuildCache.h"
 #include <sg/Model.h>
 #include <sg/PolygonAdjacency.h>
 #include <sg/TriangleList.h>
@@ -13,10 +16,20 @@
 #include <dev/Profile.h>
 #include <lang/Math.h>
 #include <lang/Float.h>
+#include <lang/Thread.h>
 #include <util/Vector.h>
 #include <math/Intersection.h>
 #include <math/OBBox.h>
 #include <algorithm>
+#include <stdint.h>
+
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
 #include "config.h"
 
 //-----------------------------------------------------------------------------
@@ -32,290 +45,160 @@ namespace sg
 {
 
 
-static int		s_volumeCapPolygons			= 0;
-static int		s_renderedShadows			= 0;
-static int		s_renderedShadowTriangles	= 0;
-
-static Vector<bool>		s_polylit( Allocator<bool>(__FILE__,__LINE__) );
-static Vector<bool>		s_polyvalid( Allocator<bool>(__FILE__,__LINE__) );
-static Vector<Vector3>	s_vertices( Allocator<Vector3>(__FILE__,__LINE__) );
-static Vector<Vector3>	s_triangles( Allocator<Vector3>(__FILE__,__LINE__) );
-static int				s_shadowVolumes = 0;
+/** Minimum number of shadow volumes to build per thread. */
+#define MIN_SHADOWS_PER_THREAD 2
 
 //-----------------------------------------------------------------------------
 
-/**
- * Adds a convex polygon to triangle list.
- * The polygon has vertices defined in clockwise order.
- * @param v Polygon points in clockwise order.
- * @param n Number of points in the polygon.
- * @param geom Triangle list to receive triangulated polygon.
- * @param firstVertex The first vertex of the polygon in triangle list.
- * @return Number of vertices added to the triangle list.
- */
-static inline int addPolygonToTriangleListCW( const Vector3* v, int n,
-	TriangleList* geom, int firstVertex )
-{
-	//Profile pr( "addpoly" );
-
-	int newVerts = 0;
-	if ( n > 2 )
-	{
-		// allocate more space to the output buffer if needed
-		newVerts = (unsigned)(n-2) * 3U;
-		if ( firstVertex+newVerts > geom->maxVertices() )
-		{
-			const int moreTriangles = 100;
-			geom->setMaxVertices( firstVertex + newVerts + moreTriangles*3 );
-		}
+static int						s_renderedShadows			= 0;
+static int						s_renderedShadowTriangles	= 0;
+static ShadowVolume::Statistics	s_statistics;
 
-		// store triangles
-		Vector3 buf[3];
-		int j = 2;
-		for ( ; j < n ; ++j )
-		{
-			buf[0] = v[0];
-			buf[1] = v[j-1];
-			buf[2] = v[j];
+//-----------------------------------------------------------------------------
 
-			geom->setVertexPositions( firstVertex, buf, 3 );
-			firstVertex += 3;
-		}
-	}
-	assert( (firstVertex+newVerts) % 3 == 0 );
-	return newVerts;
+/** Returns number of processors in the system. */
+static int processorCount()
+{
+#ifdef WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	int n = (int)info.dwNumberOfProcessors;
+#else
+	int n = (int)sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+	return n > 0 ? n : 1;
 }
 
-/**
- * Adds a convex polygon to triangle list.
- * The polygon has vertices defined in counter-clockwise order.
- * @param v Polygon points in clockwise order.
- * @param n Number of points in the polygon.
- * @param geom Triangle list to receive triangulated polygon.
- * @param firstVertex The first vertex of the polygon in triangle list.
- * @return Number of vertices added to the triangle list.
+/** 
+ * Writes triangles to a triangle list. 
+ * Creates the triangle list or grows it if needed.
  */
-static inline int addPolygonToTriangleListCCW( const Vector3* v, int n,
-	TriangleList* geom, int firstVertex )
+static void setTriangles( const Vector<Vector3>& verts, P(TriangleList)* geom )
 {
-	//Profile pr( "addpoly" );
-
-	int newVerts = 0;
-	if ( n > 2 )
-	{
-		// allocate more space to the output buffer if needed
-		newVerts = (unsigned)(n-2) * 3U;
-		if ( firstVertex+newVerts > geom->maxVertices() )
-		{
-			const int moreTriangles = 100;
-			geom->setMaxVertices( firstVertex + newVerts + moreTriangles*3 );
-		}
-
-		// store triangles
-		Vector3 buf[3];
-		int j = 2;
-		for ( ; j < n ; ++j )
-		{
-			buf[0] = v[0];
-			buf[1] = v[j];
-			buf[2] = v[j-1];
-
-			geom->setVertexPositions( firstVertex, buf, 3 );
-			firstVertex += 3;
-		}
-	}
-	assert( (firstVertex+newVerts) % 3 == 0 );
-	return newVerts;
+	const int moreTriangles = 100;
+	const int n = verts.size();
+	if ( !*geom )
+		*geom = new TriangleList( n + moreTriangles*3, VertexFormat() );
+	else if ( n > (*geom)->maxVertices() )
+		(*geom)->setMaxVertices( n + moreTriangles*3 );
+
+	VertexLock<TriangleList> lock( *geom, TriangleList::LOCK_WRITE );
+	if ( n > 0 )
+		(*geom)->setVertexPositions( 0, verts.begin(), n );
+	(*geom)->setVertices( n );
 }
 
+//-----------------------------------------------------------------------------
+
 /**
- * Creates a shadow volume from the model. Detects interior edges,
- * which cannot be shadow boundary. Produces silhuette and
- * list of triangles which face away from the light.
- * 
- * @param model Source geometry for the shadow volume.
- * @param dirWorld Direction and length of the shadow volume in world space.
- * @param worldTM Model to world transforms.
- * @param worldTMCount Number of model to world transforms.
- * @param oldSilhuette Old shadow silhuette if any.
- * @param oldVolume Old shadow volume generator if any.
- * @param shadowSilhuette [out] Receives new shadow silhuette if any.
- * @param shadowVolume [out] Receives new shadow volume generator if any.
- * @param capPlaneNormal [out] Receives shadow end cap plane normal.
- * @param capPlanePoint [out] Receives shadow end cap plane point.
+ * Dynamic shadow source geometry, work buffers and the last built shadow.
+ * Each shadow volume has its own so that volumes can be built in parallel.
  */
-static void createShadowVolume( 
-	Model* model, const Vector3& dirWorld, 
-	const Matrix4x4* worldTM, int worldTMCount,
-	P(TriangleList) oldSilhuette, P(TriangleList) oldVolume,
-	P(TriangleList)* shadowSilhuette, P(TriangleList)* shadowVolume,
-	Vector3* capPlaneNormal, Vector3* capPlanePoint )
-{
-	assert( model );
-	assert( worldTMCount > 0 ); worldTMCount = worldTMCount;
-
-	const Matrix4x4				inverseWorldTM = worldTM[0].inverse();
-	const int					indices = model->indices();
-	VertexAndIndexLock<Model>	lockModel( model, Model::LOCK_READ );
-	const PolygonAdjacency&		modelAdj = model->getPolygonAdjacency( 0.001f );
-	const Vector3				dirModel = inverseWorldTM.rotate( dirWorld );
-	const Vector3				unitDirModel = dirModel.normalize();
-	// volume cap plane distance along shadow direction
-	float						shadowEndPlaneDist = -Float::MAX_VALUE;
-
-	// poly state buffers (lit/valid)
-	s_polylit.setSize( indices/3 );
-	s_polyvalid.setSize( indices/3 );
-
-	// reuse old silhuette if possible
-	P(TriangleList) silhuette = oldSilhuette;
-	if ( !silhuette )
-	{
-		int tri = indices/2;
-		tri -= tri % 3;
-		silhuette = new TriangleList( tri, VertexFormat() );
-	}
-	int numVerts = 0;
-
-	// reuse old volume generator mesh if possible
-	P(TriangleList) volume = oldVolume;
-	if ( !volume )
-		volume = new TriangleList( (indices/3/2+1)*3, VertexFormat() );
-	int volumeVerts = 0;
-
-	// get triangles in geometry space
-	s_triangles.setSize( indices );
-	s_vertices.setSize( model->vertices() );
-	int	face[3];
-	Vector3 v0, v1;
-	if ( 0 == model->vertexFormat().weights() )
-	{
-		model->getVertexPositions( 0, s_vertices.begin(), s_vertices.size() );
-	}
-	else
-	{
-		//Profile pr( "ShadowVolume.skinning" );
-		bool mostSignifigantBoneOnly = false;
-		model->getTransformedVertexPositions( worldTM, worldTMCount, inverseWorldTM, s_vertices.begin(), s_vertices.size(), mostSignifigantBoneOnly );
-	}
-	for ( int i = 0 ; i < indices ; i += 3 )
+class ShadowVolume::BuildData :
+	public Object
+{
+public:
+	bool				prepared;
+	int					sourceVersion;	// Model::dataVersion() when prepared
+	P(SkinningEngine)	skin;			// null if the model is not skinned
+	Vector<Vector3>		restVertices;	// if not skinned
+	Vector<int>			indices;
+	Vector<int>			adjacency;		// 3 adjacent polygons per polygon
+	ShadowFaces			faces;
+	Vector<uint8_t>		flags;			// ShadowFaces::FaceFlags of each polygon
+	Vector<Vector3>		vertices;
+	Vector<Matrix4x4>	bones;
+	ShadowBuildCache	cache;
+	Vector<Vector3>		silhuette;
+	Vector<Vector3>		volume;
+	int					version;
+	int					uploadedVersion;
+
+	BuildData() :
+		prepared( false ),
+		sourceVersion( 0 ),
+		skin( 0 ),
+		restVertices( Allocator<Vector3>(__FILE__,__LINE__) ),
+		indices( Allocator<int>(__FILE__,__LINE__) ),
+		adjacency( Allocator<int>(__FILE__,__LINE__) ),
+		faces(),
+		flags( Allocator<uint8_t>(__FILE__,__LINE__) ),
+		vertices( Allocator<Vector3>(__FILE__,__LINE__) ),
+		bones( Allocator<Matrix4x4>(__FILE__,__LINE__) ),
+		cache(),
+		silhuette( Allocator<Vector3>(__FILE__,__LINE__) ),
+		volume( Allocator<Vector3>(__FILE__,__LINE__) ),
+		version( 0 ),
+		uploadedVersion( 0 )
 	{
-		model->getIndices( i, face, 3 );
-		for ( int j = 0 ; j < 3 ; ++j )
-			s_triangles[i+j] = s_vertices[ face[j] ];
 	}
 
-	// compute lit/unlit status of the polygons 
-	// add polygons generating the volume
-	Vector3						v[6];
-	int							adj[3];	
-	int							faceindex = 0;
-	VertexLock<TriangleList>	lockVolume( volume, TriangleList::LOCK_WRITE );
+private:
+	BuildData( const BuildData& );
+	BuildData& operator=( const BuildData& );
+};
 
-	for ( int i = 0 ; i < indices ; i += 3 )
-	{
-		const Vector3* verts = s_triangles.begin() + i;
-
-		// polygon lit/unlit or invalid?
-		Vector3 edge1 = verts[1] - verts[0];
-		Vector3 edge2 = verts[2] - verts[0];
-		Vector3 normal = edge1.cross( edge2 );
-		float n2 = normal.lengthSquared();
-		bool valid = n2 > 1e-10f;
-		bool lit = normal.dot(dirModel) < 0.f;
-
-		// set lit/validity status
-		s_polylit[faceindex] = lit;
-		s_polyvalid[faceindex] = valid;
-
-		// list polygons generating the volume
-		if ( valid )
-		{
-			if ( !lit )
-				volumeVerts += addPolygonToTriangleListCW( verts, 3, volume, volumeVerts );
-			//else
-			//	volumeVerts += addPolygonToTriangleListCCW( verts, 3, volume, volumeVerts );
+//-----------------------------------------------------------------------------
 
-			// move shadow cap plane distance if needed
-			for ( int k = 0 ; k < 3 ; ++k )
-			{
-				float dist = unitDirModel.dot( verts[k] + dirModel );
-				if ( dist > shadowEndPlaneDist )
-					shadowEndPlaneDist = dist;
-			}
-		}
+/** Builds every nth shadow volume of the list. */
+class ShadowBuildThread :
+	public Thread
+{
+public:
+	ShadowVolume::Statistics	stats;
 
-		++faceindex;
+	ShadowBuildThread() :
+		m_shadows(0), m_worldTMs(0), m_worldTMCounts(0), m_count(0), m_first(0), m_step(1)
+	{
 	}
-	volume->setVertices( volumeVerts );
 
-	// collect shadow silhuette edges
-	Vector3 shadowEndPlanePoint = unitDirModel * shadowEndPlaneDist;
-	VertexLock<TriangleList> lockSilhuette( silhuette, TriangleList::LOCK_WRITE );
-	faceindex = 0;
-	for ( int i = 0 ; i < indices ; i += 3 )
+	void setWork( ShadowVolume* const* shadows, const Matrix4x4* const* worldTMs, const int* worldTMCounts,
+		int count, int first, int step )
 	{
-		if ( s_polyvalid[faceindex] )
-		{
-			// allocate more silhuette space if needed
-			if ( numVerts+6*3 > silhuette->maxVertices() )
-			{
-				const int moreTriangles = 100;
-				silhuette->setMaxVertices( silhuette->maxVertices() + moreTriangles*3 );
-			}
+		m_shadows = shadows;
+		m_worldTMs = worldTMs;
+		m_worldTMCounts = worldTMCounts;
+		m_count = count;
+		m_first = first;
+		m_step = step;
+		stats = ShadowVolume::Statistics();
+	}
 
-			// add silhuette edges
-			modelAdj.getAdjacent( faceindex, adj, 3 );
-			const Vector3* verts = s_triangles.begin() + i;
-			int k = 2;
-			for ( int j = 0 ; j < 3 ; k = j++ )
-			{
-				int poly = adj[j];
-				if ( -1 == poly || /*s_polylit[poly] != s_polylit[faceindex]*/ s_polylit[poly] && !s_polylit[faceindex] )
-				{
-					const Vector3& v0 = verts[k];
-					const Vector3& v1 = verts[j];
-					
-					Vector3 v2 = v1 + dirModel;
-					Vector3 v3 = v0 + dirModel;
+	void run()
+	{
+		for ( int i = m_first ; i < m_count ; i += m_step )
+			m_shadows[i]->build( m_worldTMs[i], m_worldTMCounts[i], &stats );
+	}
 
-					v2 += unitDirModel * ( (shadowEndPlanePoint-v2).dot(unitDirModel) );
-					v3 += unitDirModel * ( (shadowEndPlanePoint-v3).dot(unitDirModel) );
+private:
+	ShadowVolume* const*		m_shadows;
+	const Matrix4x4* const*		m_worldTMs;
+	const int*					m_worldTMCounts;
+	int							m_count;
+	int							m_first;
+	int							m_step;
 
-					if ( !s_polylit[faceindex] )
-					{
-						v[0] = v0;
-						v[1] = v1;
-						v[2] = v2;
-						v[3] = v0;
-						v[4] = v2;
-						v[5] = v3;
-					}
-					else
-					{
-						v[0] = v0;
-						v[1] = v2;
-						v[2] = v1;
-						v[3] = v0;
-						v[4] = v3;
-						v[5] = v2;
-					}
-					
-					silhuette->setVertexPositions( numVerts, v, 6 );
-					numVerts += 6;
-				}
-			}
-		}
+	ShadowBuildThread( const ShadowBuildThread& );
+	ShadowBuildThread& operator=( const ShadowBuildThread& );
+};
 
-		++faceindex;
-	}
-	silhuette->setVertices( numVerts );
+//-----------------------------------------------------------------------------
+
+ShadowVolume::Statistics::Statistics() :
+	buildSilhuettes( 0 ),
+	cachedSilhuettes( 0 ),
+	silhuetteQuads( 0 ),
+	volumeCapPolygons( 0 )
+{
+}
 
-	// return results
-	*shadowSilhuette = silhuette;
-	*shadowVolume = volume;
-	*capPlanePoint = shadowEndPlanePoint;
-	*capPlaneNormal = -unitDirModel;
+ShadowVolume::Statistics& ShadowVolume::Statistics::operator+=( const Statistics& other )
+{
+	buildSilhuettes += other.buildSilhuettes;
+	cachedSilhuettes += other.cachedSilhuettes;
+	silhuetteQuads += other.silhuetteQuads;
+	volumeCapPolygons += other.volumeCapPolygons;
+	return *this;
 }
 
 //-----------------------------------------------------------------------------
@@ -330,9 +213,9 @@ ShadowVolume::ShadowVolume( Model* model, const Vector3& light, float shadowLeng
 	m_capPlaneNormal( 0, 0, 0 ),
 	m_capPlanePoint( 0, 0, 0 ),
 	m_rot( 1.f ),
-	m_viewOffset( 0.f )
+	m_viewOffset( 0.f ),
+	m_build( new BuildData )
 {
-	++s_shadowVolumes;
 }
 
 ShadowVolume::ShadowVolume( TriangleList* silhuette, TriangleList* volume,
@@ -346,10 +229,10 @@ ShadowVolume::ShadowVolume( TriangleList* silhuette, TriangleList* volume,
 	m_capPlaneNormal( endCap.x, endCap.y, endCap.z ),
 	m_capPlanePoint( Vector3(endCap.x,endCap.y,endCap.z) * -endCap.w ),
 	m_rot( 1.f ),
-	m_viewOffset( 0.f )
+	m_viewOffset( 0.f ),
+	m_build( 0 )
 {
 	assert( m_light.finite() && m_light.length() > Float::MIN_VALUE );
-	++s_shadowVolumes;
 }
 
 ShadowVolume::ShadowVolume( const ShadowVolume& other, int shareFlags ) :
@@ -363,24 +246,21 @@ ShadowVolume::ShadowVolume( const ShadowVolume& other, int shareFlags ) :
 	m_capPlaneNormal( other.m_capPlaneNormal ),
 	m_capPlanePoint( other.m_capPlanePoint ),
 	m_rot( other.m_rot ),
-	m_viewOffset( other.m_viewOffset )
+	m_viewOffset( other.m_viewOffset ),
+	m_build( 0 )
 {
-	++s_shadowVolumes;
+	// dynamic shadow geometry is per instance
+	if ( m_dynamicModel )
+	{
+		m_shadowSilhuette = 0;
+		m_shadowVolume = 0;
+		m_build = new BuildData;
+		m_build->cache.setTolerance( other.m_build->cache.tolerance() );
+	}
 }
 
 ShadowVolume::~ShadowVolume()
 {
-	if ( --s_shadowVolumes == 0 )
-	{
-		s_polylit.clear();
-		s_polylit.trimToSize();
-		s_polyvalid.clear();
-		s_polyvalid.trimToSize();
-		s_vertices.clear();
-		s_vertices.trimToSize();
-		s_triangles.clear();
-		s_triangles.trimToSize();
-	}
 }
 
 Primitive* ShadowVolume::clone( int shareFlags ) const
@@ -417,6 +297,260 @@ void ShadowVolume::setDynamicShadow( const math::Vector3& light, float shadowLen
 	m_shadowLength = shadowLength;
 }
 
+void ShadowVolume::setCacheTolerance( float tolerance )
+{
+	assert( dynamicShadow() );
+	assert( tolerance >= 0.f );
+
+	m_build->cache.setTolerance( tolerance );
+}
+
+void ShadowVolume::prepare()
+{
+	assert( dynamicShadow() );
+
+	BuildData*					b			= m_build;
+	Model*						model		= m_dynamicModel;
+	VertexAndIndexLock<Model>	lockModel( model, Model::LOCK_READ );
+	const PolygonAdjacency&		modelAdj	= model->getPolygonAdjacency( 0.001f );
+	const int					vertices	= model->vertices();
+	const int					indices		= model->indices();
+
+	// triangles and their neighbours
+	b->indices.setSize( indices );
+	if ( indices > 0 )
+		model->getIndices( 0, b->indices.begin(), indices );
+	b->adjacency.setSize( indices );
+	for ( int i = 0 ; i < indices/3 ; ++i )
+		modelAdj.getAdjacent( i, b->adjacency.begin()+i*3, 3 );
+
+	// vertices, skinned models keep rest pose in skinning engine
+	b->restVertices.setSize( vertices );
+	if ( vertices > 0 )
+		model->getVertexPositions( 0, b->restVertices.begin(), vertices );
+	b->skin = 0;
+	if ( model->vertexFormat().weights() > 0 )
+	{
+		b->skin = new SkinningEngine;
+		b->skin->setThreads( 1 );
+		b->skin->setVertices( vertices, b->restVertices.begin()->begin(), 3 );
+
+		int boneIndices[SkinningEngine::MAX_BONES_PER_VERTEX];
+		float boneWeights[SkinningEngine::MAX_BONES_PER_VERTEX];
+		for ( int i = 0 ; i < vertices ; ++i )
+		{
+			int bones = model->getVertexWeights( i, boneIndices, boneWeights, SkinningEngine::MAX_BONES_PER_VERTEX );
+			if ( bones > SkinningEngine::MAX_BONES_PER_VERTEX )
+				bones = SkinningEngine::MAX_BONES_PER_VERTEX;
+			b->skin->setVertexWeights( i, boneIndices, boneWeights, bones );
+		}
+
+		b->restVertices.clear();
+		b->restVertices.trimToSize();
+	}
+
+	b->prepared = true;
+	b->sourceVersion = model->dataVersion();
+	b->cache.invalidate();
+}
+
+bool ShadowVolume::build( const Matrix4x4* worldTM, int worldTMCount, Statistics* stats )
+{
+	assert( dynamicShadow() );
+	assert( worldTMCount > 0 );
+
+	BuildData* b = m_build;
+	if ( !b->prepared )
+		prepare();
+
+	const Matrix4x4 inverseWorldTM = worldTM[0].inverse();
+	const Vector3 dirModel = inverseWorldTM.rotate( m_light*m_shadowLength );
+	const Vector3 unitDirModel = dirModel.normalize();
+
+	// bone transforms relative to the model
+	const int bones = b->skin ? worldTMCount : 0;
+	b->bones.setSize( bones );
+	for ( int i = 0 ; i < bones ; ++i )
+		b->bones[i] = inverseWorldTM * worldTM[i];
+
+	// reuse previous silhuette if nothing has changed
+	if ( b->cache.unchanged(dirModel, b->bones.begin(), bones) )
+	{
+		if ( stats )
+			++stats->cachedSilhuettes;
+		return false;
+	}
+	b->cache.store( dirModel, b->bones.begin(), bones );
+
+	// get vertices in geometry space
+	const Vector3* verts = b->restVertices.begin();
+	if ( b->skin )
+	{
+		b->vertices.setSize( b->skin->vertices() );
+		b->skin->skin( b->bones.begin(), bones, Matrix4x4(1.f), b->vertices.begin()->begin(), 3 );
+		verts = b->vertices.begin();
+	}
+
+	// compute lit/unlit status of the polygons
+	const int polys = b->indices.size()/3;
+	const int* indices = b->indices.begin();
+	b->faces.setFaces( verts, indices, polys );
+	b->flags.setSize( b->faces.paddedSize() );
+	const uint8_t* flags = b->flags.begin();
+	float shadowEndPlaneDist = b->faces.computeFacing( dirModel, b->flags.begin() );
+	if ( shadowEndPlaneDist > -Float::MAX_VALUE )
+		shadowEndPlaneDist += dirModel.length();
+	Vector3 shadowEndPlanePoint = unitDirModel * shadowEndPlaneDist;
+
+	// add polygons generating the volume
+	Vector<Vector3>& volume = b->volume;
+	volume.clear();
+	int i;
+	for ( i = 0 ; i < polys ; ++i )
+	{
+		if ( ShadowFaces::FACE_VALID == (flags[i] & (ShadowFaces::FACE_VALID|ShadowFaces::FACE_LIT)) )
+		{
+			volume.add( verts[ indices[i*3] ] );
+			volume.add( verts[ indices[i*3+1] ] );
+			volume.add( verts[ indices[i*3+2] ] );
+		}
+	}
+
+	// collect shadow silhuette edges
+	Vector<Vector3>& silhuette = b->silhuette;
+	silhuette.clear();
+	for ( i = 0 ; i < polys ; ++i )
+	{
+		if ( flags[i] & ShadowFaces::FACE_VALID )
+		{
+			const int* adj = b->adjacency.begin() + i*3;
+			const int* face = indices + i*3;
+			const bool lit = 0 != (flags[i] & ShadowFaces::FACE_LIT);
+			int k = 2;
+			for ( int j = 0 ; j < 3 ; k = j++ )
+			{
+				int poly = adj[j];
+				if ( -1 == poly || (flags[poly] & ShadowFaces::FACE_LIT) && !lit )
+				{
+					const Vector3& v0 = verts[ face[k] ];
+					const Vector3& v1 = verts[ face[j] ];
+					
+					Vector3 v2 = v1 + dirModel;
+					Vector3 v3 = v0 + dirModel;
+
+					v2 += unitDirModel * ( (shadowEndPlanePoint-v2).dot(unitDirModel) );
+					v3 += unitDirModel * ( (shadowEndPlanePoint-v3).dot(unitDirModel) );
+
+					if ( !lit )
+					{
+						silhuette.add( v0 );
+						silhuette.add( v1 );
+						silhuette.add( v2 );
+						silhuette.add( v0 );
+						silhuette.add( v2 );
+						silhuette.add( v3 );
+					}
+					else
+					{
+						silhuette.add( v0 );
+						silhuette.add( v2 );
+						silhuette.add( v1 );
+						silhuette.add( v0 );
+						silhuette.add( v3 );
+						silhuette.add( v2 );
+					}
+				}
+			}
+		}
+	}
+
+	m_capPlanePoint = shadowEndPlanePoint;
+	m_capPlaneNormal = -unitDirModel;
+	++b->version;
+
+	if ( stats )
+	{
+		++stats->buildSilhuettes;
+		stats->silhuetteQuads += silhuette.size()/6;
+		stats->volumeCapPolygons += volume.size()/3 * 2;
+	}
+	return true;
+}
+
+void ShadowVolume::buildShadows( ShadowVolume* const* shadows, 
+	const Matrix4x4* const* worldTMs, const int* worldTMCounts, int count,
+	int threads, Vector<Statistics>* threadStatistics )
+{
+	assert( threads >= 0 );
+
+	// source models are locked when preparing so it is done here
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		if ( shadows[i]->sourceModified() )
+			shadows[i]->prepare();
+	}
+
+	// build, calling thread takes the first share
+	if ( 0 == threads )
+		threads = processorCount();
+	if ( threads > count/MIN_SHADOWS_PER_THREAD )
+		threads = count/MIN_SHADOWS_PER_THREAD;
+	if ( threads < 1 )
+		threads = 1;
+	Vector<P(ShadowBuildThread)> workers( Allocator<P(ShadowBuildThread)>(__FILE__,__LINE__) );
+	while ( workers.size() < threads-1 )
+		workers.add( new ShadowBuildThread );
+
+	int started = 0;
+	for ( ; started < threads-1 ; ++started )
+	{
+		ShadowBuildThread* worker = workers[started];
+		worker->setWork( shadows, worldTMs, worldTMCounts, count, started+1, threads );
+		try
+		{
+			worker->start();
+		}
+		catch ( ... )
+		{
+			break;
+		}
+	}
+
+	// shares of the workers which failed to start are built here too
+	Statistics stats;
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		int share = i % threads;
+		if ( 0 == share || share > started )
+			shadows[i]->build( worldTMs[i], worldTMCounts[i], &stats );
+	}
+
+	for ( int k = 0 ; k < started ; ++k )
+		workers[k]->join();
+
+	// collect statistics
+	if ( threadStatistics )
+		threadStatistics->clear();
+	for ( int k = -1 ; k < started ; ++k )
+	{
+		const Statistics& ts = k < 0 ? stats : workers[k]->stats;
+		s_statistics += ts;
+		if ( threadStatistics )
+			threadStatistics->add( ts );
+	}
+}
+
+void ShadowVolume::uploadShadow()
+{
+	BuildData* b = m_build;
+	if ( b->uploadedVersion != b->version || !m_shadowSilhuette || !m_shadowVolume )
+	{
+		setTriangles( b->silhuette, &m_shadowSilhuette );
+		setTriangles( b->volume, &m_shadowVolume );
+		b->uploadedVersion = b->version;
+	}
+}
+
 void ShadowVolume::draw()
 {
 	gd::GraphicsDevice* dev = Context::device();
@@ -431,12 +565,12 @@ void ShadowVolume::draw()
 			if ( m_shadowLength <= 0.f )
 				return;
 
-			createShadowVolume( m_dynamicModel,
-				m_light*m_shadowLength,
-				dev->worldTransforms(), dev->worldTransformCount(),
-				m_shadowSilhuette, m_shadowVolume, 
-				&m_shadowSilhuette, &m_shadowVolume,
-				&m_capPlaneNormal, &m_capPlanePoint );
+			if ( sourceModified() )
+				prepare();
+
+			assert( dev->worldTransformCount() >= buildTransforms() );
+			build( dev->worldTransforms(), buildTransforms(), &s_statistics );
+			uploadShadow();
 		}
 
 		// render shadow volume
@@ -499,9 +633,14 @@ float ShadowVolume::boundSphere() const
 		return 0.f;
 }
 
+const ShadowVolume::Statistics& ShadowVolume::statistics()
+{
+	return s_statistics;
+}
+
 int	ShadowVolume::buildSilhuettes()
 {
-	return 0;
+	return s_statistics.buildSilhuettes;
 }
 
 int	ShadowVolume::clippedSilhuettes()
@@ -521,7 +660,7 @@ int ShadowVolume::clippedTriangleVolumes()
 
 int ShadowVolume::volumeCapPolygons()
 {
-	return 0;
+	return s_statistics.volumeCapPolygons;
 }
 
 int ShadowVolume::clippedSilhuetteQuads()
@@ -595,5 +734,17 @@ int ShadowVolume::usedBones() const
 		return 0;
 }
 
+int ShadowVolume::buildTransforms() const
+{
+	int bones = usedBones();
+	return bones > 0 ? bones : 1;
+}
+
+bool ShadowVolume::sourceModified() const
+{
+	assert( dynamicShadow() );
+	return !m_build->prepared || m_build->sourceVersion != m_dynamicModel->dataVersion();
+}
+
 
 } // sg
@@ -3,6 +3,7 @@
 
 
 #include <sg/Primitive.h>
+#include <util/Vector.h>
 #include <math/Matrix4x4.h>
 
 
@@ -22,6 +23,26 @@ class ShadowVolume :
 	public Primitive
 {
 public:
+	/** Shadow building statistics. */
+	class Statistics
+	{
+	public:
+		/** Number of built shadow silhuettes. */
+		int		buildSilhuettes;
+		/** Number of builds which reused the previous silhuette. */
+		int		cachedSilhuettes;
+		/** Number of silhuette edge quads in built silhuettes. */
+		int		silhuetteQuads;
+		/** Number of cap polygons in built volumes. */
+		int		volumeCapPolygons;
+
+		///
+		Statistics();
+
+		/** Adds counters of other statistics to this. */
+		Statistics&	operator+=( const Statistics& other );
+	};
+
 	/** 
 	 * Creates a dynamic shadow volume.
 	 * Dynamic shadow volume must be rendered with the same
@@ -64,6 +85,36 @@ public:
 	/** Sets dynamic shadow parameters. */
 	void	setDynamicShadow( const math::Vector3& light, float shadowLength );
 
+	/**
+	 * Sets tolerance for reusing the previous dynamic shadow silhuette.
+	 * Silhuette is rebuilt only if light direction or bone transforms 
+	 * (relative to the model transform) differ more than the tolerance
+	 * (per component) from the ones used in the previous build.
+	 * 0 rebuilds the silhuette whenever anything changes. Default is 1e-4.
+	 */
+	void	setCacheTolerance( float tolerance );
+
+	/**
+	 * Copies source model geometry used to build the dynamic shadow.
+	 * Called automatically by build() before the first build and by
+	 * buildShadows() and draw() after the source model has been modified.
+	 * Locks the source model so it should be called from one thread
+	 * before building shadows in parallel.
+	 */
+	void	prepare();
+
+	/**
+	 * Builds dynamic shadow geometry. 
+	 * Geometry is uploaded to the rendering device by draw().
+	 * After prepare() the function doesn't access the source model
+	 * or the rendering device, so different shadow volumes can be built in parallel.
+	 * @param worldTM Model to world transforms, see Model::getTransformedVertexPositions.
+	 * @param worldTMCount Number of model to world transforms, see buildTransforms().
+	 * @param stats [out] Receives build statistics if not 0.
+	 * @return true if the silhuette was rebuilt, false if the previous one was reused.
+	 */
+	bool	build( const math::Matrix4x4* worldTM, int worldTMCount, Statistics* stats=0 );
+
 	/** Computes primitive visibility in the view frustum. */
 	bool	updateVisibility( const math::Matrix4x4& modelToCamera, 
 				const ViewFrustum& viewFrustum );
@@ -98,6 +149,30 @@ public:
 	 */
 	const int*	usedBoneArray() const;
 
+	/** 
+	 * Returns number of model to world transforms passed to build(), 
+	 * i.e. one per used bone or 1 if the shadow has no bones.
+	 */
+	int			buildTransforms() const;
+
+	/** 
+	 * Builds several dynamic shadows in parallel.
+	 * The calling thread prepares the shadows and takes the first share of the builds.
+	 * Returns after all shadows have been built. Totals are added to statistics().
+	 * @param shadows Dynamic shadow volumes to build.
+	 * @param worldTMs Model to world transforms of each shadow volume.
+	 * @param worldTMCounts Number of model to world transforms of each shadow volume.
+	 * @param count Number of shadow volumes.
+	 * @param threads Number of threads. 0 uses one thread per processor.
+	 * @param threadStatistics [out] If not 0, receives statistics of each used thread.
+	 */
+	static void	buildShadows( ShadowVolume* const* shadows, 
+					const math::Matrix4x4* const* worldTMs, const int* worldTMCounts, int count,
+					int threads=0, util::Vector<Statistics>* threadStatistics=0 );
+
+	/** Returns total shadow building statistics. */
+	static const Statistics&	statistics();
+
 	/** Returns total number of build shadow silhuettes. */
 	static int	buildSilhuettes();
 
@@ -123,6 +198,8 @@ public:
 	static int	renderedShadowTriangles();
 
 private:
+	class BuildData;
+
 	math::Vector3	m_light;
 	float			m_shadowLength;
 	P(TriangleList)	m_shadowSilhuette;
@@ -133,6 +210,10 @@ private:
 	math::Vector3	m_capPlanePoint;
 	math::Matrix3x3	m_rot;
 	float			m_viewOffset;
+	P(BuildData)	m_build;
+
+	void	uploadShadow();
+	bool	sourceModified() const;
 
 	ShadowVolume();
 	ShadowVolume( const ShadowVolume& );
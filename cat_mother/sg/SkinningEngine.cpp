@@ -0,0 +1,602 @@
+#include "SkinningEngine.h"
+#include <lang/Float.h>
+#include <lang/Math.h>
+#include <lang/Thread.h>
+#include <math/Matrix4x4.h>
+#include <util/Vector.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+#include "config.h"
+#ifdef SG_SSE
+#include <xmmintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+
+/** Minimum number of vertices to skin per thread. */
+#define MIN_VERTICES_PER_THREAD 4096
+
+//-----------------------------------------------------------------------------
+
+using namespace lang;
+using namespace util;
+using namespace math;
+
+//-----------------------------------------------------------------------------
+
+namespace sg
+{
+
+
+/** Returns number of processors in the system. */
+static int processorCount()
+{
+#ifdef WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	int n = (int)info.dwNumberOfProcessors;
+#else
+	int n = (int)sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+	return n > 0 ? n : 1;
+}
+
+/** Returns p rounded up to next 16-byte boundary. */
+static float* align16( float* p )
+{
+	return (float*)( ((size_t)p + 15) & ~(size_t)15 );
+}
+
+/** Copies 3-component vectors to 4-float stream elements with specified w. */
+static void copyStream( float* dst, const float* src, int pitch, int count, float w )
+{
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		dst[0] = src[0];
+		dst[1] = src[1];
+		dst[2] = src[2];
+		dst[3] = w;
+		dst += 4;
+		src += pitch;
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+/**
+ * Input and output streams of a skinning call.
+ * Palette has 16 floats per transform: the columns of the
+ * post transformed bone matrix.
+ */
+class SkinningJob
+{
+public:
+	const float*	palette;
+	const float*	srcPositions;
+	const float*	srcNormals;
+	const float*	srcTangents;
+	const uint32_t*	boneIndices;
+	const uint32_t*	boneWeights;
+	float*			positions;
+	int				positionPitch;
+	float*			normals;
+	int				normalPitch;
+	float*			tangents;
+	int				tangentPitch;
+	bool			mostSignifigantBoneOnly;
+};
+
+#ifdef SG_SSE
+
+/** Stores xyz components of v to unaligned d. */
+static inline void store3( float* d, __m128 v )
+{
+	_mm_storel_pi( reinterpret_cast<__m64*>(d), v );
+	_mm_store_ss( d+2, _mm_movehl_ps(v,v) );
+}
+
+/** Returns v scaled to unit length (xyz components). Zero vector stays zero. */
+static inline __m128 normalize3( __m128 v )
+{
+	__m128 sq = _mm_mul_ps( v, v );
+	__m128 len2 = _mm_add_ss( _mm_add_ss(sq, _mm_shuffle_ps(sq,sq,_MM_SHUFFLE(1,1,1,1))), _mm_movehl_ps(sq,sq) );
+	len2 = _mm_max_ss( len2, _mm_set_ss(Float::MIN_VALUE) );
+	__m128 s = _mm_div_ss( _mm_set_ss(1.f), _mm_sqrt_ss(len2) );
+	return _mm_mul_ps( v, _mm_shuffle_ps(s,s,_MM_SHUFFLE(0,0,0,0)) );
+}
+
+/** Returns v rotated by matrix columns c0, c1, c2. */
+static inline __m128 rotate3( __m128 c0, __m128 c1, __m128 c2, __m128 v )
+{
+	return _mm_add_ps( _mm_add_ps(
+		_mm_mul_ps(c0, _mm_shuffle_ps(v,v,_MM_SHUFFLE(0,0,0,0))),
+		_mm_mul_ps(c1, _mm_shuffle_ps(v,v,_MM_SHUFFLE(1,1,1,1))) ),
+		_mm_mul_ps(c2, _mm_shuffle_ps(v,v,_MM_SHUFFLE(2,2,2,2))) );
+}
+
+#else
+
+/** Returns v scaled to unit length. Zero vector stays zero. */
+static inline void normalize3( float* v )
+{
+	float len2 = v[0]*v[0] + v[1]*v[1] + v[2]*v[2];
+	if ( len2 < Float::MIN_VALUE )
+		len2 = Float::MIN_VALUE;
+	float s = 1.f / Math::sqrt( len2 );
+	v[0] *= s;
+	v[1] *= s;
+	v[2] *= s;
+}
+
+/** Stores v rotated by column-major matrix m to d. */
+static inline void rotate3( const float* m, const float* v, float* d )
+{
+	d[0] = m[0]*v[0] + m[4]*v[1] + m[8]*v[2];
+	d[1] = m[1]*v[0] + m[5]*v[1] + m[9]*v[2];
+	d[2] = m[2]*v[0] + m[6]*v[1] + m[10]*v[2];
+}
+
+#endif // SG_SSE
+
+/**
+ * Skins vertices [first,last).
+ * Blends the palette matrices of a vertex once
+ * and transforms all vertex attributes with the result.
+ */
+static void skinVertices( const SkinningJob& job, int first, int last )
+{
+	const float			wscale			= 1.f / 255.f;
+	const float*		palette			= job.palette;
+	const uint32_t*		boneIndices		= job.boneIndices;
+	const uint32_t*		boneWeights		= job.boneWeights;
+	const bool			single			= job.mostSignifigantBoneOnly;
+
+#ifdef SG_SSE
+	for ( int i = first ; i < last ; ++i )
+	{
+		uint32_t ix = boneIndices[i];
+		uint32_t w = boneWeights[i];
+		const float* m = palette + (ix & 0xFF)*16;
+		__m128 c0 = _mm_load_ps( m );
+		__m128 c1 = _mm_load_ps( m+4 );
+		__m128 c2 = _mm_load_ps( m+8 );
+		__m128 c3 = _mm_load_ps( m+12 );
+
+		// weights are sorted so the first zero weight ends the list
+		if ( (w & 0xFF) != 0xFF && !single )
+		{
+			__m128 w4 = _mm_set1_ps( (float)(w & 0xFF) * wscale );
+			c0 = _mm_mul_ps( c0, w4 );
+			c1 = _mm_mul_ps( c1, w4 );
+			c2 = _mm_mul_ps( c2, w4 );
+			c3 = _mm_mul_ps( c3, w4 );
+			for ( int k = 1 ; k < SkinningEngine::MAX_BONES_PER_VERTEX ; ++k )
+			{
+				ix >>= 8;
+				w >>= 8;
+				if ( 0 == (w & 0xFF) )
+					break;
+				m = palette + (ix & 0xFF)*16;
+				w4 = _mm_set1_ps( (float)(w & 0xFF) * wscale );
+				c0 = _mm_add_ps( c0, _mm_mul_ps(_mm_load_ps(m), w4) );
+				c1 = _mm_add_ps( c1, _mm_mul_ps(_mm_load_ps(m+4), w4) );
+				c2 = _mm_add_ps( c2, _mm_mul_ps(_mm_load_ps(m+8), w4) );
+				c3 = _mm_add_ps( c3, _mm_mul_ps(_mm_load_ps(m+12), w4) );
+			}
+		}
+
+		__m128 p = _mm_load_ps( job.srcPositions + i*4 );
+		store3( job.positions + i*job.positionPitch, _mm_add_ps(rotate3(c0,c1,c2,p), c3) );
+
+		if ( job.normals )
+		{
+			__m128 n = _mm_load_ps( job.srcNormals + i*4 );
+			store3( job.normals + i*job.normalPitch, normalize3(rotate3(c0,c1,c2,n)) );
+		}
+
+		if ( job.tangents )
+		{
+			__m128 t = _mm_load_ps( job.srcTangents + i*4 );
+			store3( job.tangents + i*job.tangentPitch, normalize3(rotate3(c0,c1,c2,t)) );
+		}
+	}
+#else
+	float blend[16];
+	for ( int i = first ; i < last ; ++i )
+	{
+		uint32_t ix = boneIndices[i];
+		uint32_t w = boneWeights[i];
+		const float* m = palette + (ix & 0xFF)*16;
+
+		// weights are sorted so the first zero weight ends the list
+		if ( (w & 0xFF) != 0xFF && !single )
+		{
+			float wf = (float)(w & 0xFF) * wscale;
+			int j;
+			for ( j = 0 ; j < 16 ; ++j )
+				blend[j] = m[j] * wf;
+			for ( int k = 1 ; k < SkinningEngine::MAX_BONES_PER_VERTEX ; ++k )
+			{
+				ix >>= 8;
+				w >>= 8;
+				if ( 0 == (w & 0xFF) )
+					break;
+				m = palette + (ix & 0xFF)*16;
+				wf = (float)(w & 0xFF) * wscale;
+				for ( j = 0 ; j < 16 ; ++j )
+					blend[j] += m[j] * wf;
+			}
+			m = blend;
+		}
+
+		float* d = job.positions + i*job.positionPitch;
+		rotate3( m, job.srcPositions + i*4, d );
+		d[0] += m[12];
+		d[1] += m[13];
+		d[2] += m[14];
+
+		if ( job.normals )
+		{
+			d = job.normals + i*job.normalPitch;
+			rotate3( m, job.srcNormals + i*4, d );
+			normalize3( d );
+		}
+
+		if ( job.tangents )
+		{
+			d = job.tangents + i*job.tangentPitch;
+			rotate3( m, job.srcTangents + i*4, d );
+			normalize3( d );
+		}
+	}
+#endif // SG_SSE
+}
+
+//-----------------------------------------------------------------------------
+
+/** Skins a continuous range of vertices. */
+class SkinningThread :
+	public Thread
+{
+public:
+	SkinningThread() :
+		m_job(0), m_first(0), m_last(0)
+	{
+	}
+
+	void setWork( const SkinningJob* job, int first, int last )
+	{
+		m_job = job;
+		m_first = first;
+		m_last = last;
+	}
+
+	void run()
+	{
+		skinVertices( *m_job, m_first, m_last );
+	}
+
+private:
+	const SkinningJob*	m_job;
+	int					m_first;
+	int					m_last;
+
+	SkinningThread( const SkinningThread& );
+	SkinningThread& operator=( const SkinningThread& );
+};
+
+//-----------------------------------------------------------------------------
+
+class SkinningEngine::SkinningEngineImpl :
+	public Object
+{
+public:
+	int							vertices;
+	int							bones;
+	float*						mem;
+	float*						positions;
+	float*						normals;
+	float*						tangents;
+	Vector<uint32_t>			boneIndices;
+	Vector<uint32_t>			boneWeights;
+	Vector<float>				palette;
+	Vector<P(SkinningThread)>	workers;
+	int							threads;
+
+	SkinningEngineImpl() :
+		vertices( 0 ),
+		bones( 1 ),
+		mem( 0 ),
+		positions( 0 ),
+		normals( 0 ),
+		tangents( 0 ),
+		boneIndices( Allocator<uint32_t>(__FILE__) ),
+		boneWeights( Allocator<uint32_t>(__FILE__) ),
+		palette( Allocator<float>(__FILE__) ),
+		workers( Allocator<P(SkinningThread)>(__FILE__) ),
+		threads( 0 )
+	{
+	}
+
+	~SkinningEngineImpl()
+	{
+		delete[] mem;
+	}
+
+	void setVertices( int count, const float* pos, int posPitch,
+		const float* norm, int normPitch, const float* tang, int tangPitch )
+	{
+		assert( count >= 0 );
+		assert( pos || count == 0 );
+
+		// streams share one block, each vertex attribute is 4 floats
+		const int streams = 1 + (norm ? 1 : 0) + (tang ? 1 : 0);
+		float* newmem = new float[ count*4*streams + 4 ];
+		delete[] mem;
+		mem = newmem;
+		float* base = align16( mem );
+
+		positions = base;
+		copyStream( positions, pos, posPitch, count, 1.f );
+		base += count*4;
+
+		normals = 0;
+		if ( norm )
+		{
+			normals = base;
+			copyStream( normals, norm, normPitch, count, 0.f );
+			base += count*4;
+		}
+
+		tangents = 0;
+		if ( tang )
+		{
+			tangents = base;
+			copyStream( tangents, tang, tangPitch, count, 0.f );
+		}
+
+		// every vertex follows transform 0
+		boneIndices.setSize( count );
+		boneWeights.setSize( count );
+		for ( int i = 0 ; i < count ; ++i )
+		{
+			boneIndices[i] = 0;
+			boneWeights[i] = 0xFF;
+		}
+
+		vertices = count;
+		bones = 1;
+	}
+
+	void setVertexWeights( int vertexIndex, const int* inIndices, const float* inWeights, int count )
+	{
+		assert( vertexIndex >= 0 && vertexIndex < vertices );
+		assert( count >= 0 );
+
+		// select most signifigant bones
+		int ix[MAX_BONES_PER_VERTEX];
+		float w[MAX_BONES_PER_VERTEX];
+		int n = 0;
+		for ( int i = 0 ; i < count ; ++i )
+		{
+			assert( inIndices[i] >= 0 && inIndices[i] < MAX_BONES );
+			float wi = inWeights[i];
+			if ( wi <= 0.f )
+				continue;
+
+			int k = n < MAX_BONES_PER_VERTEX ? n++ : MAX_BONES_PER_VERTEX;
+			for ( ; k > 0 && w[k-1] < wi ; --k )
+			{
+				if ( k < MAX_BONES_PER_VERTEX )
+				{
+					w[k] = w[k-1];
+					ix[k] = ix[k-1];
+				}
+			}
+			if ( k < MAX_BONES_PER_VERTEX )
+			{
+				w[k] = wi;
+				ix[k] = inIndices[i];
+			}
+		}
+
+		// vertices without weights follow transform 0
+		if ( 0 == n )
+		{
+			boneIndices[vertexIndex] = 0;
+			boneWeights[vertexIndex] = 0xFF;
+			return;
+		}
+
+		// quantize normalized weights, rounding error goes to the most signifigant bone
+		float sum = 0.f;
+		int i;
+		for ( i = 0 ; i < n ; ++i )
+			sum += w[i];
+
+		int q[MAX_BONES_PER_VERTEX];
+		int qsum = 0;
+		for ( i = 0 ; i < n ; ++i )
+		{
+			q[i] = (int)( w[i] / sum * 255.f + .5f );
+			qsum += q[i];
+		}
+		q[0] += 255 - qsum;
+
+		// pack, zero weights are dropped from the end of the list
+		uint32_t packedIndices = 0;
+		uint32_t packedWeights = 0;
+		int shift = 0;
+		for ( i = 0 ; i < n && q[i] > 0 ; ++i )
+		{
+			packedIndices |= (uint32_t)ix[i] << shift;
+			packedWeights |= (uint32_t)q[i] << shift;
+			if ( ix[i] >= bones )
+				bones = ix[i] + 1;
+			shift += 8;
+		}
+		boneIndices[vertexIndex] = packedIndices;
+		boneWeights[vertexIndex] = packedWeights;
+	}
+
+	void skin( const Matrix4x4* tm, int tmcount, const Matrix4x4& posttm,
+		float* outPositions, int positionPitch,
+		float* outNormals, int normalPitch,
+		float* outTangents, int tangentPitch,
+		bool mostSignifigantBoneOnly )
+	{
+		assert( tmcount >= bones ); tmcount = tmcount;
+		assert( outPositions || vertices == 0 );
+		assert( !outNormals || normals );
+		assert( !outTangents || tangents );
+
+		// combine post transform to the palette
+		palette.setSize( bones*16 + 4 );
+		float* pal = align16( palette.begin() );
+		for ( int i = 0 ; i < bones ; ++i )
+		{
+			Matrix4x4 m = posttm * tm[i];
+			float* d = pal + i*16;
+			for ( int j = 0 ; j < 4 ; ++j )
+				for ( int k = 0 ; k < 4 ; ++k )
+					d[j*4+k] = m(k,j);
+		}
+
+		SkinningJob job;
+		job.palette = pal;
+		job.srcPositions = positions;
+		job.srcNormals = normals;
+		job.srcTangents = tangents;
+		job.boneIndices = boneIndices.begin();
+		job.boneWeights = boneWeights.begin();
+		job.positions = outPositions;
+		job.positionPitch = positionPitch;
+		job.normals = outNormals;
+		job.normalPitch = normalPitch;
+		job.tangents = outTangents;
+		job.tangentPitch = tangentPitch;
+		job.mostSignifigantBoneOnly = mostSignifigantBoneOnly;
+
+		// skin, calling thread takes the first share
+		int threads = this->getThreads();
+		if ( threads > vertices/MIN_VERTICES_PER_THREAD )
+			threads = vertices/MIN_VERTICES_PER_THREAD;
+		if ( threads < 1 )
+			threads = 1;
+		while ( workers.size() < threads-1 )
+			workers.add( new SkinningThread );
+
+		int started = 0;
+		for ( ; started < threads-1 ; ++started )
+		{
+			SkinningThread* worker = workers[started];
+			int share = started + 1;
+			worker->setWork( &job, vertices*share/threads, vertices*(share+1)/threads );
+			try
+			{
+				worker->start();
+			}
+			catch ( ... )
+			{
+				break;
+			}
+		}
+
+		// shares of the workers which failed to start are skinned here too
+		skinVertices( job, 0, vertices/threads );
+		if ( started < threads-1 )
+			skinVertices( job, vertices*(started+1)/threads, vertices );
+
+		for ( int k = 0 ; k < started ; ++k )
+			workers[k]->join();
+	}
+
+	int getThreads() const
+	{
+		return threads > 0 ? threads : processorCount();
+	}
+
+private:
+	SkinningEngineImpl( const SkinningEngineImpl& );
+	SkinningEngineImpl& operator=( const SkinningEngineImpl& );
+};
+
+//-----------------------------------------------------------------------------
+
+SkinningEngine::SkinningEngine()
+{
+	m_this = new SkinningEngineImpl;
+}
+
+SkinningEngine::~SkinningEngine()
+{
+}
+
+void SkinningEngine::setVertices( int count, const float* positions, int positionPitch,
+	const float* normals, int normalPitch, const float* tangents, int tangentPitch )
+{
+	m_this->setVertices( count, positions, positionPitch, normals, normalPitch, tangents, tangentPitch );
+}
+
+void SkinningEngine::setVertexWeights( int vertexIndex, const int* boneIndices, const float* boneWeights, int bones )
+{
+	m_this->setVertexWeights( vertexIndex, boneIndices, boneWeights, bones );
+}
+
+void SkinningEngine::skin( const Matrix4x4* tm, int tmcount, const Matrix4x4& posttm,
+	float* positions, int positionPitch, float* normals, int normalPitch,
+	float* tangents, int tangentPitch, bool mostSignifigantBoneOnly )
+{
+	m_this->skin( tm, tmcount, posttm, positions, positionPitch, normals, normalPitch,
+		tangents, tangentPitch, mostSignifigantBoneOnly );
+}
+
+void SkinningEngine::setThreads( int count )
+{
+	assert( count >= 0 );
+	m_this->threads = count;
+}
+
+int SkinningEngine::vertices() const
+{
+	return m_this->vertices;
+}
+
+int SkinningEngine::bones() const
+{
+	return m_this->bones;
+}
+
+bool SkinningEngine::hasNormals() const
+{
+	return m_this->normals != 0;
+}
+
+bool SkinningEngine::hasTangents() const
+{
+	return m_this->tangents != 0;
+}
+
+int SkinningEngine::threads() const
+{
+	return m_this->getThreads();
+}
+
+int SkinningEngine::bytes() const
+{
+	const int streams = 1 + (m_this->normals ? 1 : 0) + (m_this->tangents ? 1 : 0);
+	return m_this->vertices * ( streams*4*sizeof(float) + 2*sizeof(uint32_t) );
+}
+
+
+} // sg
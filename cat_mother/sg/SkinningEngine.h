@@ -0,0 +1,135 @@
+#ifndef _SG_SKINNINGENGINE_H
+#define _SG_SKINNINGENGINE_H
+
+
+#include <lang/Object.h>
+
+
+namespace math {
+	class Matrix4x4;}
+
+
+namespace sg
+{
+
+
+/**
+ * CPU vertex skinning.
+ * Rest pose positions, normals and tangents are stored
+ * in separate 16-byte aligned streams (one 4-float element per vertex)
+ * and bone influences in two packed streams: four 8-bit transform
+ * indices and four 8-bit weights per vertex, sorted by weight
+ * and quantized so that the weights of each vertex sum to exactly 255.
+ * Skinning blends the (post transformed) palette matrices of
+ * each vertex once and uses the result for all vertex attributes.
+ * Large meshes are split between worker threads, see setThreads().
+ * The engine is independent of the rendering device, so output can be written
+ * directly to locked vertex data (see Model::getVertexPositionData).
+ */
+class SkinningEngine :
+	public lang::Object
+{
+public:
+	/** Engine limits. */
+	enum Constants
+	{
+		/** Maximum number of bones influencing a single vertex. */
+		MAX_BONES_PER_VERTEX	= 4,
+		/** Maximum number of transforms in the palette. */
+		MAX_BONES				= 256,
+	};
+
+	///
+	SkinningEngine();
+
+	///
+	~SkinningEngine();
+
+	/**
+	 * Sets rest pose vertex data.
+	 * Every vertex is initially influenced only by transform 0.
+	 * @param count Number of vertices.
+	 * @param positions Vertex positions, 3 floats per vertex.
+	 * @param positionPitch Number of floats from vertex position to the next.
+	 * @param normals Vertex normals, 3 floats per vertex. Can be 0 if the vertices have no normals.
+	 * @param normalPitch Number of floats from vertex normal to the next.
+	 * @param tangents Vertex tangents, 3 floats per vertex. Can be 0 if the vertices have no tangents.
+	 * @param tangentPitch Number of floats from vertex tangent to the next.
+	 */
+	void	setVertices( int count, const float* positions, int positionPitch,
+				const float* normals=0, int normalPitch=3,
+				const float* tangents=0, int tangentPitch=3 );
+
+	/**
+	 * Sets transforms influencing a vertex.
+	 * Only MAX_BONES_PER_VERTEX most signifigant bones are stored,
+	 * and their weights are normalized and quantized to 8 bits.
+	 * @param vertexIndex Index of the vertex.
+	 * @param boneIndices Array of transform indices.
+	 * @param boneWeights Weights of the transforms.
+	 * @param bones Number of bones influencing to the vertex.
+	 */
+	void	setVertexWeights( int vertexIndex, const int* boneIndices, const float* boneWeights, int bones );
+
+	/**
+	 * Computes skinned vertices.
+	 * Vertices are first transformed to world space and then specified post transformation is applied.
+	 * Normals and tangents are transformed with the rotation part of the
+	 * blended transform and normalized. Null output streams are skipped.
+	 * Returns after all vertices have been written.
+	 * @param tm Transformation palette. Must have at least bones() transforms.
+	 * @param tmcount Number of transformations in the palette.
+	 * @param posttm Transformation to apply to world space vertices.
+	 * @param positions [out] Receives 3 floats per vertex.
+	 * @param positionPitch Number of floats from output position to the next.
+	 * @param normals [out] Receives 3 floats per vertex if not 0. Requires that the engine has normals.
+	 * @param normalPitch Number of floats from output normal to the next.
+	 * @param tangents [out] Receives 3 floats per vertex if not 0. Requires that the engine has tangents.
+	 * @param tangentPitch Number of floats from output tangent to the next.
+	 * @param mostSignifigantBoneOnly If true then only the most signifigantly influencing bone is used.
+	 */
+	void	skin( const math::Matrix4x4* tm, int tmcount, const math::Matrix4x4& posttm,
+				float* positions, int positionPitch,
+				float* normals=0, int normalPitch=3,
+				float* tangents=0, int tangentPitch=3,
+				bool mostSignifigantBoneOnly=false );
+
+	/**
+	 * Sets number of threads used to skin large meshes.
+	 * 1 skins all vertices on the calling thread.
+	 * 0 (default) uses one thread per processor.
+	 * Results are identical regardless of the number of threads.
+	 */
+	void	setThreads( int count );
+
+	/** Returns number of vertices. */
+	int		vertices() const;
+
+	/** Returns number of transforms referenced by the vertices (largest index + 1). */
+	int		bones() const;
+
+	/** Returns true if the engine has vertex normals. */
+	bool	hasNormals() const;
+
+	/** Returns true if the engine has vertex tangents. */
+	bool	hasTangents() const;
+
+	/** Returns number of threads used to skin large meshes. */
+	int		threads() const;
+
+	/** Returns size of the stored vertex data in bytes. */
+	int		bytes() const;
+
+private:
+	class SkinningEngineImpl;
+	P(SkinningEngineImpl) m_this;
+
+	SkinningEngine( const SkinningEngine& );
+	SkinningEngine& operator=( const SkinningEngine& );
+};
+
+
+} // sg
+
+
+#endif // _SG_SKINNINGENGINE_H
@@ -0,0 +1,78 @@
+#include "RadixSort.h"
+#include <string.h>
+#include <assert.h>
+#include "config.h"
+
+//-----------------------------------------------------------------------------
+
+namespace sg
+{
+
+
+void RadixSort::sort( const uint32_t* keys, int count, int* order, int* temp )
+{
+	assert( count >= 0 );
+
+	if ( count < 2 )
+	{
+		if ( 1 == count )
+			order[0] = 0;
+		return;
+	}
+
+	// histograms of all digits in one pass over the keys
+	int hist[4][256];
+	memset( hist, 0, sizeof(hist) );
+	int i;
+	for ( i = 0 ; i < count ; ++i )
+	{
+		uint32_t key = keys[i];
+		++hist[0][key & 0xFF];
+		++hist[1][(key>>8) & 0xFF];
+		++hist[2][(key>>16) & 0xFF];
+		++hist[3][key>>24];
+		order[i] = i;
+	}
+
+	int* src = order;
+	int* dst = temp;
+	for ( int digit = 0 ; digit < 4 ; ++digit )
+	{
+		const int shift = digit*8;
+		int* h = hist[digit];
+		if ( h[(keys[0]>>shift) & 0xFF] == count )
+			continue;
+
+		int offset = 0;
+		for ( int k = 0 ; k < 256 ; ++k )
+		{
+			int n = h[k];
+			h[k] = offset;
+			offset += n;
+		}
+		for ( i = 0 ; i < count ; ++i )
+		{
+			int ix = src[i];
+			dst[ h[(keys[ix]>>shift) & 0xFF]++ ] = ix;
+		}
+
+		int* t = src;
+		src = dst;
+		dst = t;
+	}
+
+	if ( src != order )
+		memcpy( order, src, sizeof(int)*count );
+}
+
+uint32_t RadixSort::floatKey( float value )
+{
+	// flip all bits of negatives and sign bit of positives
+	union { float f; uint32_t u; } bits;
+	bits.f = value;
+	uint32_t mask = (uint32_t)( -(int32_t)(bits.u >> 31) ) | 0x80000000u;
+	return bits.u ^ mask;
+}
+
+
+} // sg
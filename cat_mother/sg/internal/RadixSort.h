@@ -0,0 +1,37 @@
+#ifndef _SG_RADIXSORT_H
+#define _SG_RADIXSORT_H
+
+
+#include <stdint.h>
+
+
+namespace sg
+{
+
+
+/** 
+ * LSD radix sort of 32-bit keys. 
+ * Sorting is stable and done in 8-bit digits, 
+ * digits which are equal in all keys are skipped.
+ */
+class RadixSort
+{
+public:
+	/**
+	 * Sorts indices by keys in ascending order.
+	 * @param keys Sort keys.
+	 * @param count Number of keys.
+	 * @param order [out] Receives indices of the keys in sorted order.
+	 * @param temp Temporary buffer of count elements.
+	 */
+	static void		sort( const uint32_t* keys, int count, int* order, int* temp );
+
+	/** Returns key which has the same order as the float value. */
+	static uint32_t	floatKey( float value );
+};
+
+
+} // sg
+
+
+#endif // _SG_RADIXSORT_H
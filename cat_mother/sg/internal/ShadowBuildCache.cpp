@@ -0,0 +1,83 @@
+#include "ShadowBuildCache.h"
+#include <assert.h>
+#include "config.h"
+
+//-----------------------------------------------------------------------------
+
+using namespace math;
+using namespace util;
+
+//-----------------------------------------------------------------------------
+
+namespace sg
+{
+
+
+/** Returns true if all components of a and b differ at most by tolerance. */
+static bool equal( const float* a, const float* b, int n, float tolerance )
+{
+	for ( int i = 0 ; i < n ; ++i )
+	{
+		float d = a[i] - b[i];
+		if ( d > tolerance || d < -tolerance )
+			return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+
+ShadowBuildCache::ShadowBuildCache() :
+	m_valid( false ),
+	m_tolerance( 1e-4f ),
+	m_dir( 0, 0, 0 ),
+	m_bones( Allocator<Matrix4x4>(__FILE__,__LINE__) )
+{
+}
+
+void ShadowBuildCache::setTolerance( float tolerance )
+{
+	assert( tolerance >= 0.f );
+
+	m_tolerance = tolerance;
+	m_valid = false;
+}
+
+void ShadowBuildCache::store( const Vector3& dir, const Matrix4x4* bones, int count )
+{
+	assert( count >= 0 );
+
+	m_dir = dir;
+	m_bones.setSize( count );
+	for ( int i = 0 ; i < count ; ++i )
+		m_bones[i] = bones[i];
+	m_valid = true;
+}
+
+void ShadowBuildCache::invalidate()
+{
+	m_valid = false;
+}
+
+bool ShadowBuildCache::unchanged( const Vector3& dir, const Matrix4x4* bones, int count ) const
+{
+	if ( !m_valid || count != m_bones.size() )
+		return false;
+	if ( !equal(dir.begin(), m_dir.begin(), 3, m_tolerance) )
+		return false;
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		// projective row is not used
+		for ( int j = 0 ; j < 3 ; ++j )
+		{
+			const float a[] = {bones[i](j,0), bones[i](j,1), bones[i](j,2), bones[i](j,3)};
+			const float b[] = {m_bones[i](j,0), m_bones[i](j,1), m_bones[i](j,2), m_bones[i](j,3)};
+			if ( !equal(a, b, 4, m_tolerance) )
+				return false;
+		}
+	}
+	return true;
+}
+
+
+} // sg
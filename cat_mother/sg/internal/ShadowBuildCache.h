@@ -0,0 +1,60 @@
+#ifndef _SG_SHADOWBUILDCACHE_H
+#define _SG_SHADOWBUILDCACHE_H
+
+
+#include <util/Vector.h>
+#include <math/Vector3.h>
+#include <math/Matrix4x4.h>
+
+
+namespace sg
+{
+
+
+/**
+ * Light direction and bone transforms (relative to the model)
+ * used in the last dynamic shadow build.
+ * Used to decide if the previous silhuette can be reused.
+ */
+class ShadowBuildCache
+{
+public:
+	///
+	ShadowBuildCache();
+
+	/**
+	 * Sets tolerance for reusing the previous build. Invalidates stored build.
+	 * @see ShadowVolume::setCacheTolerance
+	 */
+	void	setTolerance( float tolerance );
+
+	/** Stores light direction and bone transforms of a build. */
+	void	store( const math::Vector3& dir, const math::Matrix4x4* bones, int count );
+
+	/** Forgets stored build, so that the next build is never reused. */
+	void	invalidate();
+
+	/** Returns tolerance for reusing the previous build. */
+	float	tolerance() const											{return m_tolerance;}
+
+	/** 
+	 * Returns true if the light direction and bone transforms are within tolerance
+	 * of the stored ones. Number of bones must also match the stored build.
+	 */
+	bool	unchanged( const math::Vector3& dir, const math::Matrix4x4* bones, int count ) const;
+
+private:
+	bool						m_valid;
+	float						m_tolerance;
+	math::Vector3				m_dir;
+	util::Vector<math::Matrix4x4>	m_bones;
+
+	ShadowBuildCache( const ShadowBuildCache& );
+	ShadowBuildCache& operator=( const ShadowBuildCache& );
+};
+
+
+} // sg
+
+
+#endif // _SG_SHADOWBUILDCACHE_H
@@ -0,0 +1,186 @@
+#include "ShadowFaces.h"
+#include <lang/Float.h>
+#include <math/Vector3.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+#include "config.h"
+#ifdef SG_SSE
+#include <xmmintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+
+using namespace lang;
+using namespace math;
+
+//-----------------------------------------------------------------------------
+
+namespace sg
+{
+
+
+/** Squared face normal length limit for valid faces. */
+const float MIN_NORMAL_LENGTH_SQUARED = 1e-10f;
+
+//-----------------------------------------------------------------------------
+
+/** Returns p rounded up to next 16-byte boundary. */
+static float* align16( float* p )
+{
+	return (float*)( ((size_t)p + 15) & ~(size_t)15 );
+}
+
+//-----------------------------------------------------------------------------
+
+ShadowFaces::ShadowFaces() :
+	m_mem(0),
+	m_size(0),
+	m_capacity(0)
+{
+	for ( int i = 0 ; i < 9 ; ++i )
+		m_streams[i] = 0;
+}
+
+ShadowFaces::~ShadowFaces()
+{
+	delete[] m_mem;
+}
+
+void ShadowFaces::setFaces( const Vector3* vertices, const int* indices, int faces )
+{
+	assert( faces >= 0 );
+
+	const int padded = (faces+3) & ~3;
+	if ( padded > m_capacity )
+	{
+		float* mem = new float[ padded*9 + 4 ];
+		delete[] m_mem;
+		m_mem = mem;
+		m_capacity = padded;
+
+		float* base = align16( m_mem );
+		for ( int i = 0 ; i < 9 ; ++i )
+			m_streams[i] = base + i*padded;
+	}
+
+	for ( int k = 0 ; k < 3 ; ++k )
+	{
+		float* x = m_streams[k*3];
+		float* y = m_streams[k*3+1];
+		float* z = m_streams[k*3+2];
+		for ( int i = 0 ; i < faces ; ++i )
+		{
+			const Vector3& v = vertices[ indices[i*3+k] ];
+			x[i] = v.x;
+			y[i] = v.y;
+			z[i] = v.z;
+		}
+
+		// padding faces are degenerate
+		for ( int i = faces ; i < padded ; ++i )
+			x[i] = y[i] = z[i] = 0.f;
+	}
+
+	m_size = faces;
+}
+
+float ShadowFaces::computeFacing( const Vector3& dir, uint8_t* flags ) const
+{
+	const float* const* s = m_streams;
+	const int n = paddedSize();
+	const Vector3 unitDir = dir.normalize();
+
+#ifdef SG_SSE
+	const __m128 dx = _mm_set1_ps( dir.x );
+	const __m128 dy = _mm_set1_ps( dir.y );
+	const __m128 dz = _mm_set1_ps( dir.z );
+	const __m128 ux = _mm_set1_ps( unitDir.x );
+	const __m128 uy = _mm_set1_ps( unitDir.y );
+	const __m128 uz = _mm_set1_ps( unitDir.z );
+	const __m128 minn2 = _mm_set1_ps( MIN_NORMAL_LENGTH_SQUARED );
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 none = _mm_set1_ps( -Float::MAX_VALUE );
+	__m128 maxdist = none;
+
+	for ( int i = 0 ; i < n ; i += 4 )
+	{
+		__m128 x0 = _mm_load_ps( s[0]+i );
+		__m128 y0 = _mm_load_ps( s[1]+i );
+		__m128 z0 = _mm_load_ps( s[2]+i );
+		__m128 x1 = _mm_load_ps( s[3]+i );
+		__m128 y1 = _mm_load_ps( s[4]+i );
+		__m128 z1 = _mm_load_ps( s[5]+i );
+		__m128 x2 = _mm_load_ps( s[6]+i );
+		__m128 y2 = _mm_load_ps( s[7]+i );
+		__m128 z2 = _mm_load_ps( s[8]+i );
+
+		// face normal = (v1-v0) x (v2-v0)
+		__m128 e1x = _mm_sub_ps( x1, x0 );
+		__m128 e1y = _mm_sub_ps( y1, y0 );
+		__m128 e1z = _mm_sub_ps( z1, z0 );
+		__m128 e2x = _mm_sub_ps( x2, x0 );
+		__m128 e2y = _mm_sub_ps( y2, y0 );
+		__m128 e2z = _mm_sub_ps( z2, z0 );
+		__m128 nx = _mm_sub_ps( _mm_mul_ps(e1y,e2z), _mm_mul_ps(e1z,e2y) );
+		__m128 ny = _mm_sub_ps( _mm_mul_ps(e1z,e2x), _mm_mul_ps(e1x,e2z) );
+		__m128 nz = _mm_sub_ps( _mm_mul_ps(e1x,e2y), _mm_mul_ps(e1y,e2x) );
+		__m128 n2 = _mm_add_ps( _mm_add_ps(_mm_mul_ps(nx,nx),_mm_mul_ps(ny,ny)), _mm_mul_ps(nz,nz) );
+		__m128 nd = _mm_add_ps( _mm_add_ps(_mm_mul_ps(nx,dx),_mm_mul_ps(ny,dy)), _mm_mul_ps(nz,dz) );
+
+		__m128 valid = _mm_cmpgt_ps( n2, minn2 );
+		__m128 lit = _mm_cmplt_ps( nd, zero );
+
+		// furthest corner of valid faces along the shadow direction
+		__m128 d0 = _mm_add_ps( _mm_add_ps(_mm_mul_ps(x0,ux),_mm_mul_ps(y0,uy)), _mm_mul_ps(z0,uz) );
+		__m128 d1 = _mm_add_ps( _mm_add_ps(_mm_mul_ps(x1,ux),_mm_mul_ps(y1,uy)), _mm_mul_ps(z1,uz) );
+		__m128 d2 = _mm_add_ps( _mm_add_ps(_mm_mul_ps(x2,ux),_mm_mul_ps(y2,uy)), _mm_mul_ps(z2,uz) );
+		__m128 d = _mm_max_ps( _mm_max_ps(d0,d1), d2 );
+		d = _mm_or_ps( _mm_and_ps(valid,d), _mm_andnot_ps(valid,none) );
+		maxdist = _mm_max_ps( maxdist, d );
+
+		int vm = _mm_movemask_ps( valid );
+		int lm = _mm_movemask_ps( lit );
+		for ( int k = 0 ; k < 4 ; ++k )
+			flags[i+k] = (uint8_t)( ((vm>>k) & 1) * FACE_VALID + ((lm>>k) & 1) * FACE_LIT );
+	}
+
+	float maxd[4];
+	_mm_storeu_ps( maxd, maxdist );
+	float result = maxd[0];
+	for ( int k = 1 ; k < 4 ; ++k )
+		if ( maxd[k] > result )
+			result = maxd[k];
+	return result;
+#else
+	float result = -Float::MAX_VALUE;
+	for ( int i = 0 ; i < n ; ++i )
+	{
+		Vector3 v0( s[0][i], s[1][i], s[2][i] );
+		Vector3 v1( s[3][i], s[4][i], s[5][i] );
+		Vector3 v2( s[6][i], s[7][i], s[8][i] );
+
+		Vector3 normal = (v1-v0).cross( v2-v0 );
+		bool valid = normal.lengthSquared() > MIN_NORMAL_LENGTH_SQUARED;
+		bool lit = normal.dot(dir) < 0.f;
+		flags[i] = (uint8_t)( (valid ? FACE_VALID : 0) + (lit ? FACE_LIT : 0) );
+
+		if ( valid )
+		{
+			float d0 = unitDir.dot( v0 );
+			float d1 = unitDir.dot( v1 );
+			float d2 = unitDir.dot( v2 );
+			if ( d0 > result )
+				result = d0;
+			if ( d1 > result )
+				result = d1;
+			if ( d2 > result )
+				result = d2;
+		}
+	}
+	return result;
+#endif // SG_SSE
+}
+
+
+} // sg
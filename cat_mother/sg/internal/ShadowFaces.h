@@ -0,0 +1,78 @@
+#ifndef _SG_SHADOWFACES_H
+#define _SG_SHADOWFACES_H
+
+
+#include <stdint.h>
+
+
+namespace math {
+	class Vector3;}
+
+
+namespace sg
+{
+
+
+/**
+ * Triangle corners in structure-of-arrays order for shadow silhuette extraction.
+ * Corner coordinates are stored in 9 streams (x, y and z of each corner).
+ * Every stream is a 16-byte aligned float array whose capacity
+ * is a multiple of 4 so that SIMD kernels can process
+ * the last partial group of faces without a scalar tail.
+ * Padding faces are degenerate, i.e. never valid.
+ */
+class ShadowFaces
+{
+public:
+	/** Face state bits returned by computeFacing(). */
+	enum FaceFlags
+	{
+		/** Face has non-zero area. */
+		FACE_VALID	= 1,
+		/** Face front side points towards the light. */
+		FACE_LIT	= 2,
+	};
+
+	///
+	ShadowFaces();
+
+	///
+	~ShadowFaces();
+
+	/**
+	 * Sets triangles.
+	 * @param vertices Vertex positions.
+	 * @param indices Vertex index triplets.
+	 * @param faces Number of triangles.
+	 */
+	void	setFaces( const math::Vector3* vertices, const int* indices, int faces );
+
+	/**
+	 * Computes facing of the triangles with respect to the light.
+	 * @param dir Shadow direction in triangle space.
+	 * @param flags [out] Receives FaceFlags bits of each face. Must have room for paddedSize() elements.
+	 * @return Maximum distance of valid face corners along normalized dir, or -Float::MAX_VALUE if there are no valid faces.
+	 */
+	float	computeFacing( const math::Vector3& dir, uint8_t* flags ) const;
+
+	/** Returns number of faces. */
+	int		size() const											{return m_size;}
+
+	/** Returns number of faces rounded up to next multiple of 4. */
+	int		paddedSize() const										{return (m_size+3) & ~3;}
+
+private:
+	float*	m_mem;
+	float*	m_streams[9];
+	int		m_size;
+	int		m_capacity;
+
+	ShadowFaces( const ShadowFaces& );
+	ShadowFaces& operator=( const ShadowFaces& );
+};
+
+
+} // sg
+
+
+#endif // _SG_SHADOWFACES_H
@@ -0,0 +1,374 @@
+#include "SphereTree.h"
+#include "RadixSort.h"
+#include <lang/Math.h>
+#include <lang/Float.h>
+#include <math/Vector4.h>
+#include <assert.h>
+#include "config.h"
+#ifdef SG_SSE
+#include <xmmintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+
+using namespace lang;
+using namespace math;
+using namespace util;
+
+//-----------------------------------------------------------------------------
+
+namespace sg
+{
+
+
+/** Child index of an unused slot. */
+const int EMPTY_SLOT = 0x7FFFFFFF;
+
+/** Maximum depth of traversal stack. */
+const int MAX_STACK = 64;
+
+//-----------------------------------------------------------------------------
+
+/** Spreads 10 lowest bits of v to every third bit. */
+static uint32_t spreadBits( uint32_t v )
+{
+	v &= 0x3FF;
+	v = (v | (v << 16)) & 0x030000FF;
+	v = (v | (v << 8)) & 0x0300F00F;
+	v = (v | (v << 4)) & 0x030C30C3;
+	v = (v | (v << 2)) & 0x09249249;
+	return v;
+}
+
+//-----------------------------------------------------------------------------
+
+SphereTree::SphereTree() :
+	m_nodes( Allocator<Node4>(__FILE__,__LINE__) ),
+	m_order( Allocator<int>(__FILE__,__LINE__) ),
+	m_temp( Allocator<int>(__FILE__,__LINE__) ),
+	m_codes( Allocator<uint32_t>(__FILE__,__LINE__) ),
+	m_leaves( 0 ),
+	m_buildRadius( 0.f ),
+	m_radius( 0.f )
+{
+}
+
+void SphereTree::build( const float* spheres, int count )
+{
+	assert( count >= 0 );
+
+	m_leaves = count;
+	m_nodes.clear();
+
+	// sort leaves along Morton curve so that near leaves are consecutive
+	float minv[3] = { Float::MAX_VALUE, Float::MAX_VALUE, Float::MAX_VALUE };
+	float maxv[3] = { -Float::MAX_VALUE, -Float::MAX_VALUE, -Float::MAX_VALUE };
+	int i;
+	for ( i = 0 ; i < count ; ++i )
+	{
+		const float* s = spheres + i*4;
+		for ( int k = 0 ; k < 3 ; ++k )
+		{
+			if ( s[k] < minv[k] )
+				minv[k] = s[k];
+			if ( s[k] > maxv[k] )
+				maxv[k] = s[k];
+		}
+	}
+	float scale[3];
+	for ( int k = 0 ; k < 3 ; ++k )
+		scale[k] = maxv[k] > minv[k] ? 1023.f / (maxv[k]-minv[k]) : 0.f;
+
+	m_codes.setSize( count );
+	m_order.setSize( count );
+	m_temp.setSize( count );
+	for ( i = 0 ; i < count ; ++i )
+	{
+		const float* s = spheres + i*4;
+		uint32_t x = (uint32_t)( (s[0]-minv[0]) * scale[0] );
+		uint32_t y = (uint32_t)( (s[1]-minv[1]) * scale[1] );
+		uint32_t z = (uint32_t)( (s[2]-minv[2]) * scale[2] );
+		m_codes[i] = spreadBits(x) | (spreadBits(y) << 1) | (spreadBits(z) << 2);
+	}
+	RadixSort::sort( m_codes.begin(), count, m_order.begin(), m_temp.begin() );
+
+	if ( count > 0 )
+		buildNode( m_order.begin(), count );
+
+	refitNodes( spheres );
+	m_buildRadius = m_radius;
+}
+
+void SphereTree::refit( const float* spheres )
+{
+	refitNodes( spheres );
+}
+
+int SphereTree::cull( const Vector4* planes, int planeCount, int* leaves, int* tests ) const
+{
+	int stack[MAX_STACK];
+	int stackSize = 0;
+	int count = 0;
+	int nodeTests = 0;
+
+	if ( m_nodes.size() > 0 )
+		stack[stackSize++] = 0;
+
+	while ( stackSize > 0 )
+	{
+		const Node4& node = m_nodes[ stack[--stackSize] ];
+		++nodeTests;
+
+		// outside = outside of any plane, inside = inside of all planes
+#ifdef SG_SSE
+		const __m128 x = _mm_loadu_ps( node.x );
+		const __m128 y = _mm_loadu_ps( node.y );
+		const __m128 z = _mm_loadu_ps( node.z );
+		const __m128 r = _mm_loadu_ps( node.r );
+		const __m128 negr = _mm_sub_ps( _mm_setzero_ps(), r );
+		__m128 outside = _mm_setzero_ps();
+		__m128 crossing = _mm_setzero_ps();
+		for ( int i = 0 ; i < planeCount ; ++i )
+		{
+			const Vector4& p = planes[i];
+			__m128 d = _mm_add_ps( 
+				_mm_add_ps( _mm_mul_ps(x,_mm_set1_ps(p.x)), _mm_mul_ps(y,_mm_set1_ps(p.y)) ),
+				_mm_add_ps( _mm_mul_ps(z,_mm_set1_ps(p.z)), _mm_set1_ps(p.w) ) );
+			outside = _mm_or_ps( outside, _mm_cmpgt_ps(d,r) );
+			crossing = _mm_or_ps( crossing, _mm_cmpgt_ps(d,negr) );
+		}
+		const int outsideMask = _mm_movemask_ps( outside );
+		const int crossingMask = _mm_movemask_ps( crossing );
+#else
+		int outsideMask = 0;
+		int crossingMask = 0;
+		for ( int k = 0 ; k < 4 ; ++k )
+		{
+			for ( int i = 0 ; i < planeCount ; ++i )
+			{
+				const Vector4& p = planes[i];
+				float d = (node.x[k]*p.x + node.y[k]*p.y) + (node.z[k]*p.z + p.w);
+				if ( d > node.r[k] )
+					outsideMask |= 1<<k;
+				if ( d > -node.r[k] )
+					crossingMask |= 1<<k;
+			}
+		}
+#endif // SG_SSE
+
+		for ( int k = 0 ; k < 4 ; ++k )
+		{
+			if ( 0 == (outsideMask & (1<<k)) )
+			{
+				int child = node.child[k];
+				assert( child != EMPTY_SLOT );
+				if ( child < 0 )
+					leaves[count++] = ~child;
+				else if ( 0 == (crossingMask & (1<<k)) )
+					addLeaves( child, leaves, &count );
+				else
+				{
+					assert( stackSize < MAX_STACK );
+					stack[stackSize++] = child;
+				}
+			}
+		}
+	}
+
+	if ( tests )
+		*tests = nodeTests * 4;
+	return count;
+}
+
+int SphereTree::size() const
+{
+	return m_leaves;
+}
+
+bool SphereTree::degraded() const
+{
+	return m_radius > m_buildRadius * 2.f;
+}
+
+int SphereTree::buildNode( const int* leaves, int count )
+{
+	assert( count > 0 );
+
+	const int index = m_nodes.size();
+	m_nodes.add( Node4() );
+	for ( int k = 0 ; k < 4 ; ++k )
+		setSlot( &m_nodes[index], k, 0 );
+
+	if ( count <= 4 )
+	{
+		for ( int k = 0 ; k < count ; ++k )
+			m_nodes[index].child[k] = ~leaves[k];
+	}
+	else
+	{
+		// split to 4 consecutive groups along the curve
+		const int first[5] = { 0, count/4, count/2, count*3/4, count };
+
+		for ( int k = 0 ; k < 4 ; ++k )
+		{
+			const int n = first[k+1] - first[k];
+			int child;
+			if ( 1 == n )
+				child = ~leaves[first[k]];
+			else
+				child = buildNode( leaves+first[k], n );
+			m_nodes[index].child[k] = child;
+		}
+	}
+	return index;
+}
+
+void SphereTree::refitNodes( const float* spheres )
+{
+	// children have larger indices than their parents
+	m_radius = 0.f;
+	for ( int i = m_nodes.size() ; i-- > 0 ; )
+	{
+		Node4& node = m_nodes[i];
+		for ( int k = 0 ; k < 4 ; ++k )
+		{
+			int child = node.child[k];
+			if ( child == EMPTY_SLOT )
+				continue;
+
+			if ( child < 0 )
+			{
+				setSlot( &node, k, spheres + (~child)*4 );
+			}
+			else
+			{
+				float bound[4];
+				getBound( m_nodes[child], bound );
+				setSlot( &node, k, bound );
+				m_radius += bound[3];
+			}
+		}
+	}
+}
+
+void SphereTree::addLeaves( int node, int* leaves, int* count ) const
+{
+	for ( int k = 0 ; k < 4 ; ++k )
+	{
+		int child = m_nodes[node].child[k];
+		if ( child == EMPTY_SLOT )
+			continue;
+
+		if ( child < 0 )
+			leaves[(*count)++] = ~child;
+		else
+			addLeaves( child, leaves, count );
+	}
+}
+
+void SphereTree::setSlot( Node4* node, int slot, const float* sphere )
+{
+	if ( sphere )
+	{
+		node->x[slot] = sphere[0];
+		node->y[slot] = sphere[1];
+		node->z[slot] = sphere[2];
+		node->r[slot] = sphere[3];
+	}
+	else
+	{
+		// unused slot is outside of every plane
+		node->x[slot] = node->y[slot] = node->z[slot] = 0.f;
+		node->r[slot] = -Float::MAX_VALUE;
+		node->child[slot] = EMPTY_SLOT;
+	}
+}
+
+void SphereTree::getBound( const Node4& node, float* sphere )
+{
+#ifdef SG_SSE
+	const __m128 x = _mm_loadu_ps( node.x );
+	const __m128 y = _mm_loadu_ps( node.y );
+	const __m128 z = _mm_loadu_ps( node.z );
+	const __m128 r = _mm_loadu_ps( node.r );
+	const __m128 maxf = _mm_set1_ps( Float::MAX_VALUE );
+	const __m128 minf = _mm_set1_ps( -Float::MAX_VALUE );
+	const __m128 used = _mm_cmpgt_ps( r, minf );
+
+	// bounding box of the used child spheres
+	__m128 lox = _mm_or_ps( _mm_and_ps(used,_mm_sub_ps(x,r)), _mm_andnot_ps(used,maxf) );
+	__m128 loy = _mm_or_ps( _mm_and_ps(used,_mm_sub_ps(y,r)), _mm_andnot_ps(used,maxf) );
+	__m128 loz = _mm_or_ps( _mm_and_ps(used,_mm_sub_ps(z,r)), _mm_andnot_ps(used,maxf) );
+	__m128 hix = _mm_or_ps( _mm_and_ps(used,_mm_add_ps(x,r)), _mm_andnot_ps(used,minf) );
+	__m128 hiy = _mm_or_ps( _mm_and_ps(used,_mm_add_ps(y,r)), _mm_andnot_ps(used,minf) );
+	__m128 hiz = _mm_or_ps( _mm_and_ps(used,_mm_add_ps(z,r)), _mm_andnot_ps(used,minf) );
+	lox = _mm_min_ps( lox, _mm_shuffle_ps(lox,lox,_MM_SHUFFLE(2,3,0,1)) );
+	loy = _mm_min_ps( loy, _mm_shuffle_ps(loy,loy,_MM_SHUFFLE(2,3,0,1)) );
+	loz = _mm_min_ps( loz, _mm_shuffle_ps(loz,loz,_MM_SHUFFLE(2,3,0,1)) );
+	hix = _mm_max_ps( hix, _mm_shuffle_ps(hix,hix,_MM_SHUFFLE(2,3,0,1)) );
+	hiy = _mm_max_ps( hiy, _mm_shuffle_ps(hiy,hiy,_MM_SHUFFLE(2,3,0,1)) );
+	hiz = _mm_max_ps( hiz, _mm_shuffle_ps(hiz,hiz,_MM_SHUFFLE(2,3,0,1)) );
+	lox = _mm_min_ps( lox, _mm_shuffle_ps(lox,lox,_MM_SHUFFLE(1,0,3,2)) );
+	loy = _mm_min_ps( loy, _mm_shuffle_ps(loy,loy,_MM_SHUFFLE(1,0,3,2)) );
+	loz = _mm_min_ps( loz, _mm_shuffle_ps(loz,loz,_MM_SHUFFLE(1,0,3,2)) );
+	hix = _mm_max_ps( hix, _mm_shuffle_ps(hix,hix,_MM_SHUFFLE(1,0,3,2)) );
+	hiy = _mm_max_ps( hiy, _mm_shuffle_ps(hiy,hiy,_MM_SHUFFLE(1,0,3,2)) );
+	hiz = _mm_max_ps( hiz, _mm_shuffle_ps(hiz,hiz,_MM_SHUFFLE(1,0,3,2)) );
+
+	// center of the box, radius covers child spheres
+	const __m128 half = _mm_set1_ps( .5f );
+	const __m128 cx = _mm_mul_ps( _mm_add_ps(lox,hix), half );
+	const __m128 cy = _mm_mul_ps( _mm_add_ps(loy,hiy), half );
+	const __m128 cz = _mm_mul_ps( _mm_add_ps(loz,hiz), half );
+	const __m128 dx = _mm_sub_ps( x, cx );
+	const __m128 dy = _mm_sub_ps( y, cy );
+	const __m128 dz = _mm_sub_ps( z, cz );
+	__m128 d = _mm_add_ps( _mm_sqrt_ps( _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx,dx),_mm_mul_ps(dy,dy)),_mm_mul_ps(dz,dz)) ), r );
+	d = _mm_and_ps( used, d );
+	d = _mm_max_ps( d, _mm_shuffle_ps(d,d,_MM_SHUFFLE(2,3,0,1)) );
+	d = _mm_max_ps( d, _mm_shuffle_ps(d,d,_MM_SHUFFLE(1,0,3,2)) );
+
+	_mm_store_ss( sphere+0, cx );
+	_mm_store_ss( sphere+1, cy );
+	_mm_store_ss( sphere+2, cz );
+	_mm_store_ss( sphere+3, d );
+#else
+	float minv[3] = { Float::MAX_VALUE, Float::MAX_VALUE, Float::MAX_VALUE };
+	float maxv[3] = { -Float::MAX_VALUE, -Float::MAX_VALUE, -Float::MAX_VALUE };
+	int k;
+	for ( k = 0 ; k < 4 ; ++k )
+	{
+		if ( node.child[k] != EMPTY_SLOT )
+		{
+			const float c[3] = { node.x[k], node.y[k], node.z[k] };
+			for ( int j = 0 ; j < 3 ; ++j )
+			{
+				if ( c[j]-node.r[k] < minv[j] )
+					minv[j] = c[j]-node.r[k];
+				if ( c[j]+node.r[k] > maxv[j] )
+					maxv[j] = c[j]+node.r[k];
+			}
+		}
+	}
+
+	// center of the box, radius covers child spheres
+	sphere[0] = (minv[0]+maxv[0]) * .5f;
+	sphere[1] = (minv[1]+maxv[1]) * .5f;
+	sphere[2] = (minv[2]+maxv[2]) * .5f;
+	sphere[3] = 0.f;
+	for ( k = 0 ; k < 4 ; ++k )
+	{
+		if ( node.child[k] != EMPTY_SLOT )
+		{
+			float dx = node.x[k] - sphere[0];
+			float dy = node.y[k] - sphere[1];
+			float dz = node.z[k] - sphere[2];
+			float r = Math::sqrt( dx*dx + dy*dy + dz*dz ) + node.r[k];
+			if ( r > sphere[3] )
+				sphere[3] = r;
+		}
+	}
+#endif // SG_SSE
+}
+
+} // sg
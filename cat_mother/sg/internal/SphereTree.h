@@ -0,0 +1,97 @@
+#ifndef _SG_SPHERETREE_H
+#define _SG_SPHERETREE_H
+
+
+#include <util/Vector.h>
+#include <stdint.h>
+
+
+namespace math {
+	class Vector4;}
+
+
+namespace sg
+{
+
+
+/**
+ * Bounding sphere hierarchy for view frustum culling.
+ * Every tree node holds bounding spheres of up to 4 children
+ * in structure-of-arrays order so that a node is tested
+ * against a plane with a single SIMD operation.
+ * Leaf spheres are passed in as (x,y,z,radius) float quadruples.
+ * Topology is built by sorting the leaves along Morton curve
+ * and then refitted bottom-up when the spheres move, see degraded().
+ */
+class SphereTree
+{
+public:
+	///
+	SphereTree();
+
+	/** 
+	 * Builds tree topology for the spheres. 
+	 * @param spheres (x,y,z,radius) of each leaf.
+	 * @param count Number of leaves.
+	 */
+	void	build( const float* spheres, int count );
+
+	/** 
+	 * Updates bounding spheres of the tree without changing topology.
+	 * @param spheres (x,y,z,radius) of each leaf, same leaves in the same order as in build().
+	 */
+	void	refit( const float* spheres );
+
+	/**
+	 * Finds leaves which are (partially) inside volume.
+	 * Plane normals must be unit length and point away from the volume.
+	 * @param planes Volume planes in the same space as the spheres.
+	 * @param planeCount Number of planes defining the volume.
+	 * @param leaves [out] Receives indices of the found leaves. Must have room for size() elements.
+	 * @param tests [out] Receives number of tested spheres (4 per visited tree node).
+	 * @return Number of found leaves.
+	 */
+	int		cull( const math::Vector4* planes, int planeCount, int* leaves, int* tests ) const;
+
+	/** Returns number of leaves. */
+	int		size() const;
+
+	/** 
+	 * Returns true if refitted spheres have grown so much 
+	 * that the topology should be rebuilt. 
+	 */
+	bool	degraded() const;
+
+private:
+	/** Four child spheres. Child index is tree node index or ~leaf index if child is a leaf. */
+	struct Node4
+	{
+		float	x[4];
+		float	y[4];
+		float	z[4];
+		float	r[4];
+		int		child[4];
+		int		pad[4];
+	};
+
+	util::Vector<Node4>	m_nodes;
+	util::Vector<int>	m_order;
+	util::Vector<int>	m_temp;
+	util::Vector<uint32_t>	m_codes;
+	int					m_leaves;
+	float				m_buildRadius;
+	float				m_radius;
+
+	int		buildNode( const int* leaves, int count );
+	void	refitNodes( const float* spheres );
+	void	addLeaves( int node, int* leaves, int* count ) const;
+
+	static void	setSlot( Node4* node, int slot, const float* sphere );
+	static void	getBound( const Node4& node, float* sphere );
+};
+
+
+} // sg
+
+
+#endif // _SG_SPHERETREE_H
@@ -197,6 +197,10 @@ SOURCE=.\ShadowVolume.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\SkinningEngine.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\SpotLight.cpp
 # End Source File
 # Begin Source File
@@ -365,6 +369,10 @@ SOURCE=.\ShadowVolume.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\SkinningEngine.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\SpotLight.h
 # End Source File
 # Begin Source File
@@ -437,7 +445,35 @@ SOURCE=.\internal\GdUtil.h
 # End Source File
 # Begin Source File
 
-SOURCE=.\internal\NodeDistanceToCameraLess.h
+SOURCE=.\internal\RadixSort.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\internal\RadixSort.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\internal\ShadowBuildCache.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\internal\ShadowBuildCache.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\internal\ShadowFaces.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\internal\ShadowFaces.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\internal\SphereTree.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\internal\SphereTree.h
 # End Source File
 # Begin Source File
 
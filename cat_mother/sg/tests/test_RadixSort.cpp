@@ -0,0 +1,123 @@
+#include <tester/Test.h>
+#include "../internal/RadixSort.h"
+#include <lang/System.h>
+#include <util/Vector.h>
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+//-----------------------------------------------------------------------------
+
+using namespace sg;
+using namespace lang;
+using namespace util;
+
+//-----------------------------------------------------------------------------
+
+/** Current path: sorting node pointers by distance with std::sort. */
+class DistanceLess
+{
+public:
+	bool operator()( const float* a, const float* b ) const
+	{
+		return *a < *b;
+	}
+};
+
+static float frand()
+{
+	return (float)rand() / (float)RAND_MAX;
+}
+
+static void testSort( int count )
+{
+	Vector<float> values( Allocator<float>(__FILE__,__LINE__) );
+	Vector<uint32_t> keys( Allocator<uint32_t>(__FILE__,__LINE__) );
+	Vector<int> order( Allocator<int>(__FILE__,__LINE__) );
+	Vector<int> temp( Allocator<int>(__FILE__,__LINE__) );
+	values.setSize( count );
+	keys.setSize( count );
+	order.setSize( count );
+	temp.setSize( count );
+
+	// negative and positive values with duplicates
+	int i;
+	for ( i = 0 ; i < count ; ++i )
+	{
+		values[i] = (float)(rand() % 100) * (frand() - .3f) * 1e3f;
+		if ( 0 == i % 5 )
+			values[i] = 0.f;
+		keys[i] = RadixSort::floatKey( values[i] );
+	}
+
+	RadixSort::sort( keys.begin(), count, order.begin(), temp.begin() );
+	for ( i = 1 ; i < count ; ++i )
+	{
+		assert( values[order[i-1]] <= values[order[i]] );
+		// stable (-0 and +0 have different keys)
+		if ( keys[order[i-1]] == keys[order[i]] )
+			assert( order[i-1] < order[i] );
+	}
+}
+
+static void benchmark( int count )
+{
+	Vector<float> values( Allocator<float>(__FILE__,__LINE__) );
+	Vector<const float*> ptrs( Allocator<const float*>(__FILE__,__LINE__) );
+	Vector<uint32_t> keys( Allocator<uint32_t>(__FILE__,__LINE__) );
+	Vector<int> order( Allocator<int>(__FILE__,__LINE__) );
+	Vector<int> temp( Allocator<int>(__FILE__,__LINE__) );
+	values.setSize( count );
+	ptrs.setSize( count );
+	keys.setSize( count );
+	order.setSize( count );
+	temp.setSize( count );
+	int i;
+	for ( i = 0 ; i < count ; ++i )
+		values[i] = frand() * 1000.f;
+
+	const int rounds = 2000000 / count + 1;
+	int k;
+	long t0 = System::currentTimeMillis();
+	for ( k = 0 ; k < rounds ; ++k )
+	{
+		for ( i = 0 ; i < count ; ++i )
+			ptrs[i] = &values[(i*7919) % count];
+		std::sort( ptrs.begin(), ptrs.end(), DistanceLess() );
+	}
+	long t1 = System::currentTimeMillis();
+	for ( k = 0 ; k < rounds ; ++k )
+	{
+		for ( i = 0 ; i < count ; ++i )
+			keys[i] = RadixSort::floatKey( values[(i*7919) % count] );
+		RadixSort::sort( keys.begin(), count, order.begin(), temp.begin() );
+	}
+	long t2 = System::currentTimeMillis();
+
+	printf( "  %6d keys: std::sort %7.3f, radix sort %7.3f ms\n",
+		count, (float)(t1-t0)/rounds, (float)(t2-t1)/rounds );
+}
+
+static int test()
+{
+	const int counts[] = {0, 1, 2, 255, 1000, 30000};
+	for ( int i = 0 ; i < 6 ; ++i )
+		testSort( counts[i] );
+
+	assert( RadixSort::floatKey(-1.f) < RadixSort::floatKey(-.5f) );
+	assert( RadixSort::floatKey(-.5f) < RadixSort::floatKey(0.f) );
+	assert( RadixSort::floatKey(0.f) < RadixSort::floatKey(1e-20f) );
+	assert( RadixSort::floatKey(1.f) < RadixSort::floatKey(2.f) );
+
+	printf( "Radix sort benchmark:\n" );
+	benchmark( 100 );
+	benchmark( 1000 );
+	benchmark( 10000 );
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+static tester::Test reg( test, __FILE__ );
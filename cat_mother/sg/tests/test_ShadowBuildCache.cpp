@@ -0,0 +1,66 @@
+#include <tester/Test.h>
+#include "../internal/ShadowBuildCache.h"
+#include <math/Vector3.h>
+#include <math/Matrix4x4.h>
+#include <assert.h>
+
+//-----------------------------------------------------------------------------
+
+using namespace sg;
+using namespace math;
+
+//-----------------------------------------------------------------------------
+
+static int test()
+{
+	const int bones = 3;
+	Matrix4x4 tm[bones];
+	for ( int i = 0 ; i < bones ; ++i )
+	{
+		tm[i] = Matrix4x4( 1.f );
+		tm[i].setTranslation( Vector3((float)i,2.f,3.f) );
+	}
+	Vector3 dir( 0, -10.f, 1.f );
+
+	ShadowBuildCache cache;
+	assert( !cache.unchanged(dir,tm,bones) );
+
+	// second build with identical bones is skipped
+	cache.store( dir, tm, bones );
+	assert( cache.unchanged(dir,tm,bones) );
+
+	// bone count must be the one used in the build, not e.g. device palette size
+	Matrix4x4 palette[bones+2];
+	for ( int i = 0 ; i < bones+2 ; ++i )
+		palette[i] = i < bones ? tm[i] : Matrix4x4(1.f);
+	assert( !cache.unchanged(dir,palette,bones+2) );
+	assert( cache.unchanged(dir,palette,bones) );
+
+	// changes within tolerance are ignored
+	Matrix4x4 moved[bones];
+	for ( int i = 0 ; i < bones ; ++i )
+		moved[i] = tm[i];
+	moved[1].setTranslation( tm[1].translation() + Vector3(0,5e-5f,0) );
+	assert( cache.unchanged(dir,moved,bones) );
+	assert( cache.unchanged(dir+Vector3(5e-5f,0,0),tm,bones) );
+
+	// larger changes rebuild
+	moved[1].setTranslation( tm[1].translation() + Vector3(0,1e-2f,0) );
+	assert( !cache.unchanged(dir,moved,bones) );
+	assert( !cache.unchanged(dir+Vector3(1e-2f,0,0),tm,bones) );
+
+	// unskinned models store no bones
+	cache.store( dir, 0, 0 );
+	assert( cache.unchanged(dir,0,0) );
+
+	cache.setTolerance( 0.f );
+	assert( !cache.unchanged(dir,0,0) );
+	cache.store( dir, tm, bones );
+	cache.invalidate();
+	assert( !cache.unchanged(dir,tm,bones) );
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+static tester::Test reg( test, __FILE__ );
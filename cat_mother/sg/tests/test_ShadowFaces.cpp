@@ -0,0 +1,188 @@
+#include <tester/Test.h>
+#include "../internal/ShadowFaces.h"
+#include <lang/Math.h>
+#include <lang/Float.h>
+#include <lang/System.h>
+#include <util/Vector.h>
+#include <math/Vector3.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+//-----------------------------------------------------------------------------
+
+using namespace sg;
+using namespace lang;
+using namespace util;
+using namespace math;
+
+//-----------------------------------------------------------------------------
+
+/**
+ * Current path: per triangle facing and cap distance 
+ * like ShadowVolume used to compute them.
+ */
+static float computeFacing( const Vector3* vertices, const int* indices, int faces,
+	const Vector3& dir, uint8_t* flags )
+{
+	const Vector3 unitDir = dir.normalize();
+	float maxd = -Float::MAX_VALUE;
+
+	for ( int i = 0 ; i < faces ; ++i )
+	{
+		const Vector3 verts[3] = { vertices[indices[i*3]], vertices[indices[i*3+1]], vertices[indices[i*3+2]] };
+		Vector3 edge1 = verts[1] - verts[0];
+		Vector3 edge2 = verts[2] - verts[0];
+		Vector3 normal = edge1.cross( edge2 );
+		bool valid = normal.lengthSquared() > 1e-10f;
+		bool lit = normal.dot(dir) < 0.f;
+		flags[i] = (uint8_t)( (valid ? ShadowFaces::FACE_VALID : 0) + (lit ? ShadowFaces::FACE_LIT : 0) );
+
+		if ( valid )
+		{
+			for ( int k = 0 ; k < 3 ; ++k )
+			{
+				float d = unitDir.dot( verts[k] );
+				if ( d > maxd )
+					maxd = d;
+			}
+		}
+	}
+	return maxd;
+}
+
+static float frand()
+{
+	return (float)rand() / (float)RAND_MAX;
+}
+
+/** Creates random triangles, every 7th is degenerate. */
+static void createFaces( int faces, Vector<Vector3>& vertices, Vector<int>& indices )
+{
+	const int count = faces/2 + 3;
+	vertices.setSize( count );
+	for ( int i = 0 ; i < count ; ++i )
+		vertices[i] = Vector3( frand()*2.f-1.f, frand()*2.f-1.f, frand()*2.f-1.f );
+
+	indices.setSize( faces*3 );
+	for ( int i = 0 ; i < faces ; ++i )
+	{
+		int* face = indices.begin() + i*3;
+		face[0] = rand() % count;
+		face[1] = rand() % count;
+		face[2] = rand() % count;
+		if ( 0 == i % 7 )
+			face[2] = face[rand() % 2];
+	}
+}
+
+static void check( int faces, const Vector3& dir )
+{
+	Vector<Vector3> vertices( Allocator<Vector3>(__FILE__,__LINE__) );
+	Vector<int> indices( Allocator<int>(__FILE__,__LINE__) );
+	createFaces( faces, vertices, indices );
+
+	Vector<uint8_t> ref( Allocator<uint8_t>(__FILE__,__LINE__) );
+	Vector<uint8_t> flags( Allocator<uint8_t>(__FILE__,__LINE__) );
+	ref.setSize( faces );
+	float refd = computeFacing( vertices.begin(), indices.begin(), faces, dir, ref.begin() );
+
+	ShadowFaces sf;
+	sf.setFaces( vertices.begin(), indices.begin(), faces );
+	assert( sf.size() == faces );
+	assert( sf.paddedSize() % 4 == 0 && sf.paddedSize() >= faces );
+	flags.setSize( sf.paddedSize() );
+	float d = sf.computeFacing( dir, flags.begin() );
+
+	for ( int i = 0 ; i < faces ; ++i )
+		assert( flags[i] == ref[i] );
+	for ( int i = faces ; i < sf.paddedSize() ; ++i )
+		assert( 0 == (flags[i] & ShadowFaces::FACE_VALID) );
+	if ( refd == -Float::MAX_VALUE )
+		assert( d == -Float::MAX_VALUE );
+	else
+		assert( Math::abs(d-refd) < 1e-5f );
+}
+
+static void testDegenerate()
+{
+	const Vector3 vertices[] = { Vector3(0,0,0), Vector3(1,0,0), Vector3(2,0,0), Vector3(0,1,0) };
+	const int indices[] = { 0,1,2, 0,0,3, 0,1,3, 0,3,1 };
+	uint8_t flags[4];
+
+	ShadowFaces sf;
+	sf.setFaces( vertices, indices, 1 );
+	assert( sf.computeFacing(Vector3(0,0,1), flags) == -Float::MAX_VALUE );
+	assert( 0 == (flags[0] & ShadowFaces::FACE_VALID) );
+
+	// reusing the buffers
+	sf.setFaces( vertices, indices, 4 );
+	float d = sf.computeFacing( Vector3(0,0,-2), flags );
+	assert( Math::abs(d) < 1e-6f );
+	assert( 0 == (flags[0] & ShadowFaces::FACE_VALID) );
+	assert( 0 == (flags[1] & ShadowFaces::FACE_VALID) );
+	assert( (ShadowFaces::FACE_VALID|ShadowFaces::FACE_LIT) == flags[2] );
+	assert( (ShadowFaces::FACE_VALID) == flags[3] );
+}
+
+/** Returns faces processed per millisecond. */
+static float rate( int faces, int rounds, long time )
+{
+	if ( time < 1 )
+		time = 1;
+	return (float)faces * (float)rounds / (float)time;
+}
+
+static void benchmark( int faces )
+{
+	Vector<Vector3> vertices( Allocator<Vector3>(__FILE__,__LINE__) );
+	Vector<int> indices( Allocator<int>(__FILE__,__LINE__) );
+	Vector<uint8_t> flags( Allocator<uint8_t>(__FILE__,__LINE__) );
+	createFaces( faces, vertices, indices );
+	flags.setSize( faces+3 );
+	const Vector3 dir( .3f, -1.f, .2f );
+	ShadowFaces sf;
+
+	const int rounds = 4000000 / faces;
+	float sum = 0.f;
+	int k;
+	long t0 = System::currentTimeMillis();
+	for ( k = 0 ; k < rounds ; ++k )
+		sum += computeFacing( vertices.begin(), indices.begin(), faces, dir, flags.begin() );
+	long t1 = System::currentTimeMillis();
+	for ( k = 0 ; k < rounds ; ++k )
+	{
+		sf.setFaces( vertices.begin(), indices.begin(), faces );
+		sum += sf.computeFacing( dir, flags.begin() );
+	}
+	long t2 = System::currentTimeMillis();
+	for ( k = 0 ; k < rounds ; ++k )
+		sum += sf.computeFacing( dir, flags.begin() );
+	long t3 = System::currentTimeMillis();
+
+	printf( "  %6d faces: current %6.0f, gather+facing %6.0f, facing %6.0f faces/ms (%g)\n",
+		faces, rate(faces,rounds,t1-t0), rate(faces,rounds,t2-t1), rate(faces,rounds,t3-t2), sum );
+}
+
+static int test()
+{
+	testDegenerate();
+
+	const int faces[] = {1, 3, 4, 5, 63, 1001, 20000};
+	for ( int i = 0 ; i < 7 ; ++i )
+	{
+		check( faces[i], Vector3(0,0,1) );
+		check( faces[i], Vector3(.3f,-1.f,.2f) * 10.f );
+	}
+
+	printf( "Shadow facing benchmark:\n" );
+	benchmark( 1000 );
+	benchmark( 10000 );
+	benchmark( 100000 );
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+static tester::Test reg( test, __FILE__ );
@@ -0,0 +1,283 @@
+#include <tester/Test.h>
+#include <sg/SkinningEngine.h>
+#include <lang/Math.h>
+#include <lang/System.h>
+#include <util/Vector.h>
+#include <math/Vector3.h>
+#include <math/Matrix3x3.h>
+#include <math/Matrix4x4.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+//-----------------------------------------------------------------------------
+
+using namespace sg;
+using namespace lang;
+using namespace util;
+using namespace math;
+
+//-----------------------------------------------------------------------------
+
+/**
+ * Interleaved skinned vertex as stored by the rendering device:
+ * position, 3 blend weights (4th is implicit), packed bone indices and normal.
+ */
+const int VERTEX_PITCH	= 10;
+const int WEIGHTS		= 3;
+
+/**
+ * Current path: per vertex and per bone transform of interleaved vertex data,
+ * like gd::Primitive::getTransformedVertexPositions.
+ */
+static void getTransformedVertexPositions( const float* vpos, int vpitch,
+	const Matrix4x4* tm, const Matrix4x4& posttm, Vector3* v, int vcount )
+{
+	const int weights = WEIGHTS;
+	const int bones = weights + 1;
+	Vector3 v1;
+
+	for ( int i = 0 ; i < vcount ; ++i )
+	{
+		const float* boneWeights = vpos+3;
+		uint32_t combinedBoneIndex = *reinterpret_cast<const uint32_t*>(boneWeights+weights);
+		float sumWeight = 0.f;
+		int boneShift = 0;
+
+		v1.z = v1.y = v1.x = 0.f;
+		for ( int k = 0 ; k < bones ; ++k )
+		{
+			int boneIndex = ((combinedBoneIndex>>boneShift) & 0xFF);
+			boneShift += 8;
+
+			float w;
+			if ( k < weights )
+			{
+				w = boneWeights[k];
+				sumWeight += w;
+			}
+			else
+			{
+				w = 1.f - sumWeight;
+			}
+
+			const Matrix4x4& m = tm[boneIndex];
+			v1.x += (m(0,0)*vpos[0] + m(0,1)*vpos[1] + m(0,2)*vpos[2] + m(0,3))*w;
+			v1.y += (m(1,0)*vpos[0] + m(1,1)*vpos[1] + m(1,2)*vpos[2] + m(1,3))*w;
+			v1.z += (m(2,0)*vpos[0] + m(2,1)*vpos[1] + m(2,2)*vpos[2] + m(2,3))*w;
+		}
+
+		posttm.transform( v1, v+i );
+		vpos += vpitch;
+	}
+}
+
+static float frand()
+{
+	return (float)rand() / (float)RAND_MAX;
+}
+
+/** Creates interleaved vertices with 4 bone influences each and copies them to the engine. */
+static void createVertices( int count, int bones, Vector<float>& vdata, SkinningEngine* skin, bool tangents )
+{
+	vdata.setSize( count*VERTEX_PITCH );
+	Vector<float> tdata( Allocator<float>(__FILE__,__LINE__) );
+	tdata.setSize( count*3 );
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		float* v = vdata.begin() + i*VERTEX_PITCH;
+		v[0] = frand()*2.f - 1.f;
+		v[1] = frand()*2.f - 1.f;
+		v[2] = frand()*2.f - 1.f;
+
+		Vector3 n( v[0], v[1], v[2]+.1f );
+		n = n.normalize();
+		v[7] = n.x;
+		v[8] = n.y;
+		v[9] = n.z;
+
+		Vector3 t = n.cross( Vector3(0,1,0) );
+		if ( t.length() < 1e-3f )
+			t = Vector3(1,0,0);
+		t = t.normalize();
+		tdata[i*3+0] = t.x;
+		tdata[i*3+1] = t.y;
+		tdata[i*3+2] = t.z;
+	}
+
+	skin->setVertices( count, vdata.begin(), VERTEX_PITCH, vdata.begin()+7, VERTEX_PITCH,
+		tangents ? tdata.begin() : 0, 3 );
+
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		float* v = vdata.begin() + i*VERTEX_PITCH;
+		int boneIndices[4];
+		float boneWeights[4];
+		float sum = 0.f;
+		int k;
+		for ( k = 0 ; k < 4 ; ++k )
+		{
+			boneIndices[k] = rand() % bones;
+			boneWeights[k] = .05f + frand();
+			sum += boneWeights[k];
+		}
+		uint32_t packed = 0;
+		for ( k = 0 ; k < 4 ; ++k )
+		{
+			boneWeights[k] /= sum;
+			packed |= (uint32_t)boneIndices[k] << (k*8);
+		}
+		v[3] = boneWeights[0];
+		v[4] = boneWeights[1];
+		v[5] = boneWeights[2];
+		*reinterpret_cast<uint32_t*>(v+6) = packed;
+
+		skin->setVertexWeights( i, boneIndices, boneWeights, 4 );
+	}
+}
+
+static void createPalette( int bones, Vector<Matrix4x4>& palette )
+{
+	palette.setSize( bones );
+	for ( int i = 0 ; i < bones ; ++i )
+	{
+		Vector3 axis( frand()-.5f, frand()-.5f, frand()+.1f );
+		Matrix3x3 rot( axis.normalize(), frand()*.5f );
+		Vector3 t( frand()*.2f, frand()*.2f, frand()*.2f );
+		palette[i] = Matrix4x4( rot, t );
+	}
+}
+
+static float maxError( const Vector3* a, const float* b, int pitch, int count )
+{
+	float err = 0.f;
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		for ( int k = 0 ; k < 3 ; ++k )
+		{
+			float d = Math::abs( a[i][k] - b[i*pitch+k] );
+			if ( d > err )
+				err = d;
+		}
+	}
+	return err;
+}
+
+/** Returns vertices skinned per millisecond. */
+static float rate( int vertices, int rounds, long time )
+{
+	if ( time < 1 )
+		time = 1;
+	return (float)vertices * (float)rounds / (float)time;
+}
+
+static void benchmark( int vertices, int bones )
+{
+	Vector<float> vdata( Allocator<float>(__FILE__,__LINE__) );
+	Vector<Matrix4x4> palette( Allocator<Matrix4x4>(__FILE__,__LINE__) );
+	P(SkinningEngine) skin = new SkinningEngine;
+	createVertices( vertices, bones, vdata, skin, true );
+	createPalette( bones, palette );
+	const Matrix4x4 posttm( Matrix3x3(Vector3(0,1,0),.3f), Vector3(1,2,3) );
+	assert( skin->bones() <= bones );
+
+	Vector<Vector3> ref( Allocator<Vector3>(__FILE__,__LINE__) );
+	Vector<float> out( Allocator<float>(__FILE__,__LINE__) );
+	ref.setSize( vertices );
+	out.setSize( vertices*9 );
+	float* pos = out.begin();
+	float* norm = pos + vertices*3;
+	float* tang = norm + vertices*3;
+
+	// accuracy against current path, quantized weights bound the error
+	getTransformedVertexPositions( vdata.begin(), VERTEX_PITCH, palette.begin(), posttm, ref.begin(), vertices );
+	skin->setThreads( 1 );
+	skin->skin( palette.begin(), bones, posttm, pos, 3 );
+	float err = maxError( ref.begin(), pos, 3, vertices );
+	assert( err < 2e-2f );
+
+	// results don't depend on thread count
+	Vector<float> out1( Allocator<float>(__FILE__,__LINE__) );
+	skin->skin( palette.begin(), bones, posttm, pos, 3, norm, 3, tang, 3 );
+	out1 = out;
+	skin->setThreads( 0 );
+	skin->skin( palette.begin(), bones, posttm, pos, 3, norm, 3, tang, 3 );
+	for ( int i = 0 ; i < vertices*9 ; ++i )
+		assert( out[i] == out1[i] );
+	for ( int i = 0 ; i < vertices ; ++i )
+	{
+		Vector3 n( norm[i*3], norm[i*3+1], norm[i*3+2] );
+		assert( Math::abs(n.length()-1.f) < 1e-4f );
+	}
+
+	// throughput
+	const int rounds = 2000000 / vertices;
+	int k;
+	long t0 = System::currentTimeMillis();
+	for ( k = 0 ; k < rounds ; ++k )
+		getTransformedVertexPositions( vdata.begin(), VERTEX_PITCH, palette.begin(), posttm, ref.begin(), vertices );
+	long t1 = System::currentTimeMillis();
+	skin->setThreads( 1 );
+	for ( k = 0 ; k < rounds ; ++k )
+		skin->skin( palette.begin(), bones, posttm, pos, 3 );
+	long t2 = System::currentTimeMillis();
+	for ( k = 0 ; k < rounds ; ++k )
+		skin->skin( palette.begin(), bones, posttm, pos, 3, norm, 3, tang, 3 );
+	long t3 = System::currentTimeMillis();
+	skin->setThreads( 0 );
+	for ( k = 0 ; k < rounds ; ++k )
+		skin->skin( palette.begin(), bones, posttm, pos, 3, norm, 3, tang, 3 );
+	long t4 = System::currentTimeMillis();
+
+	printf( "  %5d vertices, %2d bones: current %6.0f, engine %6.0f, engine+n+t %6.0f, %d threads %6.0f vertices/ms (max error %g)\n",
+		vertices, bones,
+		rate(vertices,rounds,t1-t0), rate(vertices,rounds,t2-t1),
+		rate(vertices,rounds,t3-t2), skin->threads(), rate(vertices,rounds,t4-t3), err );
+}
+
+static void testWeights()
+{
+	const float v[] = {1,0,0, 0,1,0};
+	P(SkinningEngine) skin = new SkinningEngine;
+	skin->setVertices( 2, v, 3 );
+	assert( skin->bones() == 1 );
+
+	// 6 influences, two smallest are dropped and rest renormalized
+	const int ix[] = {1,2,3,4,5,6};
+	const float w[] = {.05f,.3f,.1f,.2f,.3f,.05f};
+	skin->setVertexWeights( 0, ix, w, 6 );
+	assert( skin->bones() == 6 );
+
+	// each bone translates by its index along z
+	Matrix4x4 tm[7];
+	for ( int i = 0 ; i < 7 ; ++i )
+		tm[i] = Matrix4x4( Matrix3x3(1.f), Vector3(0,0,(float)i) );
+
+	float out[6];
+	skin->skin( tm, 7, Matrix4x4(1.f), out, 3 );
+	const float z = (.3f*2 + .1f*3 + .2f*4 + .3f*5) / .9f;
+	assert( Math::abs(out[0]-1.f) < 1e-6f && Math::abs(out[1]) < 1e-6f );
+	assert( Math::abs(out[2]-z) < 3.f/255.f );
+	assert( out[3] == 0.f && out[4] == 1.f && out[5] == 0.f );
+
+	skin->skin( tm, 7, Matrix4x4(1.f), out, 3, 0, 3, 0, 3, true );
+	assert( out[2] == 2.f || out[2] == 5.f );
+}
+
+static int test()
+{
+	testWeights();
+
+	printf( "Skinning benchmark:\n" );
+	const int vertices[] = {1000, 10000, 50000};
+	const int bones[] = {4, 32, 64};
+	for ( int i = 0 ; i < 3 ; ++i )
+		for ( int j = 0 ; j < 3 ; ++j )
+			benchmark( vertices[i], bones[j] );
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+static tester::Test reg( test, __FILE__ );
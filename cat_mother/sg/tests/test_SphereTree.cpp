@@ -0,0 +1,178 @@
+#include <tester/Test.h>
+#include "../internal/SphereTree.h"
+#include <lang/Math.h>
+#include <lang/System.h>
+#include <util/Vector.h>
+#include <math/Vector3.h>
+#include <math/Vector4.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+//-----------------------------------------------------------------------------
+
+using namespace sg;
+using namespace lang;
+using namespace util;
+using namespace math;
+
+//-----------------------------------------------------------------------------
+
+/** Current path: sphere against planes like BoundVolume::testSphereVolume. */
+static bool testSphereVolume( const float* sphere, const Vector4* planes, int planeCount )
+{
+	for ( int i = 0 ; i < planeCount ; ++i )
+	{
+		Vector4 p( sphere[0] - planes[i].x * sphere[3],
+			sphere[1] - planes[i].y * sphere[3],
+			sphere[2] - planes[i].z * sphere[3], 1.f );
+
+		if ( p.dot(planes[i]) > 0.f )
+			return false;
+	}
+	return true;
+}
+
+static float frand()
+{
+	return (float)rand() / (float)RAND_MAX;
+}
+
+static void createSpheres( int count, float size, Vector<float>& spheres )
+{
+	spheres.setSize( count*4 );
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		spheres[i*4+0] = (frand()*2.f-1.f) * size;
+		spheres[i*4+1] = (frand()*2.f-1.f) * size * .1f;
+		spheres[i*4+2] = (frand()*2.f-1.f) * size;
+		spheres[i*4+3] = frand()*2.f + .1f;
+	}
+}
+
+/** Creates box volume (6 planes, normals out) around center. */
+static void createBox( const Vector3& center, float size, Vector4* planes )
+{
+	const Vector3 normals[6] = { Vector3(1,0,0), Vector3(-1,0,0), Vector3(0,1,0), Vector3(0,-1,0), Vector3(0,0,1), Vector3(0,0,-1) };
+	for ( int i = 0 ; i < 6 ; ++i )
+	{
+		const Vector3& n = normals[i];
+		planes[i] = Vector4( n.x, n.y, n.z, -(n.dot(center) + size) );
+	}
+}
+
+/** Checks that the tree finds exactly the leaves found by brute force. */
+static void check( const SphereTree& tree, const Vector<float>& spheres, const Vector4* planes )
+{
+	const int count = spheres.size()/4;
+	Vector<int> leaves( Allocator<int>(__FILE__,__LINE__) );
+	Vector<int> found( Allocator<int>(__FILE__,__LINE__) );
+	leaves.setSize( count );
+	found.setSize( count );
+	int tests = 0;
+	int n = tree.cull( planes, 6, leaves.begin(), &tests );
+
+	int i;
+	for ( i = 0 ; i < count ; ++i )
+		found[i] = 0;
+	for ( i = 0 ; i < n ; ++i )
+		++found[ leaves[i] ];
+	for ( i = 0 ; i < count ; ++i )
+	{
+		// boundary cases could be classified differently by different evaluation order
+		bool ref = testSphereVolume( spheres.begin()+i*4, planes, 6 );
+		assert( found[i] <= 1 );
+		assert( ref == (1 == found[i]) );
+	}
+}
+
+static void testCull()
+{
+	const int counts[] = {0, 1, 3, 4, 5, 17, 64, 1000};
+	for ( int k = 0 ; k < 8 ; ++k )
+	{
+		Vector<float> spheres( Allocator<float>(__FILE__,__LINE__) );
+		createSpheres( counts[k], 50.f, spheres );
+		SphereTree tree;
+		tree.build( spheres.begin(), counts[k] );
+		assert( tree.size() == counts[k] );
+
+		Vector4 planes[6];
+		for ( int j = 0 ; j < 20 ; ++j )
+		{
+			createBox( Vector3(frand()*60.f-30.f, 0.f, frand()*60.f-30.f), frand()*20.f+1.f, planes );
+			check( tree, spheres, planes );
+		}
+
+		// move spheres and refit
+		for ( int i = 0 ; i < counts[k] ; ++i )
+			spheres[i*4] += 2.f;
+		tree.refit( spheres.begin() );
+		assert( !tree.degraded() );
+		createBox( Vector3(10,0,10), 15.f, planes );
+		check( tree, spheres, planes );
+
+		// scatter spheres, tree needs rebuilding
+		if ( counts[k] > 16 )
+		{
+			createSpheres( counts[k], 500.f, spheres );
+			tree.refit( spheres.begin() );
+			assert( tree.degraded() );
+			check( tree, spheres, planes );
+			tree.build( spheres.begin(), counts[k] );
+			assert( !tree.degraded() );
+			check( tree, spheres, planes );
+		}
+	}
+}
+
+static void benchmark( int count )
+{
+	Vector<float> spheres( Allocator<float>(__FILE__,__LINE__) );
+	Vector<int> leaves( Allocator<int>(__FILE__,__LINE__) );
+	createSpheres( count, 1000.f, spheres );
+	leaves.setSize( count );
+	SphereTree tree;
+	Vector4 planes[6];
+	createBox( Vector3(100,0,100), 100.f, planes );
+
+	const int rounds = 2000000 / count + 1;
+	int visible = 0;
+	int tests = 0;
+	int k;
+	long t0 = System::currentTimeMillis();
+	for ( k = 0 ; k < rounds ; ++k )
+	{
+		for ( int i = 0 ; i < count ; ++i )
+			visible += testSphereVolume( spheres.begin()+i*4, planes, 6 );
+	}
+	long t1 = System::currentTimeMillis();
+	for ( k = 0 ; k < rounds/10+1 ; ++k )
+		tree.build( spheres.begin(), count );
+	long t2 = System::currentTimeMillis();
+	for ( k = 0 ; k < rounds ; ++k )
+		tree.refit( spheres.begin() );
+	long t3 = System::currentTimeMillis();
+	for ( k = 0 ; k < rounds ; ++k )
+		visible += tree.cull( planes, 6, leaves.begin(), &tests );
+	long t4 = System::currentTimeMillis();
+
+	printf( "  %6d spheres: current %7.3f, build %7.3f, refit %7.3f, cull %7.3f ms (%d spheres tested, %d)\n",
+		count, (float)(t1-t0)/rounds, (float)(t2-t1)/(rounds/10+1),
+		(float)(t3-t2)/rounds, (float)(t4-t3)/rounds, tests, visible );
+}
+
+static int test()
+{
+	testCull();
+
+	printf( "Sphere tree benchmark:\n" );
+	benchmark( 1000 );
+	benchmark( 10000 );
+	benchmark( 50000 );
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+static tester::Test reg( test, __FILE__ );
@@ -0,0 +1,409 @@
+#include "AssetLoader.h"
+#include "AssetInputStream.h"
+#include <io/InputStream.h>
+#include <io/InputStreamArchive.h>
+#include <lang/Debug.h>
+#include <lang/System.h>
+#include <lang/Thread.h>
+#include <lang/Throwable.h>
+#include <util/Hashtable.h>
+#include <assert.h>
+
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+#include "config.h"
+
+//-----------------------------------------------------------------------------
+
+/** Time loader threads sleep when there is nothing to load. */
+#define IDLE_SLEEP_MILLIS 5
+
+/** Size of read blocks if the stream size is not known. */
+#define READ_BLOCK_SIZE 65536
+
+//-----------------------------------------------------------------------------
+
+using namespace io;
+using namespace lang;
+using namespace util;
+
+//-----------------------------------------------------------------------------
+
+namespace sgu
+{
+
+
+static int processorCount()
+{
+#ifdef WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	int n = (int)info.dwNumberOfProcessors;
+#else
+	int n = (int)sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+	return n > 0 ? n : 1;
+}
+
+//-----------------------------------------------------------------------------
+
+class AssetLoader::AssetLoaderImpl :
+	public Object
+{
+public:
+	P(InputStreamArchive)				arch;
+	Vector< P(AssetRequest) >			queue;
+	Hashtable< String, P(AssetRequest) >	active;
+	Statistics							stats;
+	int									serial;
+	bool								stopped;
+
+	AssetLoaderImpl( InputStreamArchive* arch ) :
+		Object( OBJECT_INITMUTEX ),
+		arch( arch ),
+		queue( Allocator< P(AssetRequest) >(__FILE__,__LINE__) ),
+		active( Allocator< HashtablePair<String,P(AssetRequest)> >(__FILE__,__LINE__) ),
+		serial( 0 ),
+		stopped( false ),
+		m_threads( Allocator< P(LoaderThread) >(__FILE__,__LINE__) )
+	{
+	}
+
+	void start( int threads )
+	{
+		for ( int i = 0 ; i < threads ; ++i )
+		{
+			P(LoaderThread) thread = new LoaderThread( this );
+			try
+			{
+				thread->start();
+			}
+			catch ( ... )
+			{
+				// requests are loaded on wait() if no thread could be started
+				break;
+			}
+			m_threads.add( thread );
+		}
+	}
+
+	void stop()
+	{
+		{
+			synchronized( this );
+			stopped = true;
+		}
+		for ( int i = 0 ; i < m_threads.size() ; ++i )
+			m_threads[i]->join();
+		m_threads.clear();
+	}
+
+	int threads() const
+	{
+		return m_threads.size();
+	}
+
+	AssetRequest* request( const String& name, int priority )
+	{
+		synchronized( this );
+
+		String key = name.toLowerCase();
+		P(AssetRequest) req = active[key];
+		if ( !req )
+		{
+			req = new AssetRequest( name, priority, serial++ );
+			active[key] = req;
+			queue.add( req );
+			stats.queued += 1;
+		}
+		else if ( priority > req->m_priority )
+		{
+			synchronized( req );
+			req->m_priority = priority;
+		}
+		return req;
+	}
+
+	/** Removes highest priority (oldest first) request from the queue. Mutex must be locked. */
+	P(AssetRequest) pop()
+	{
+		int best = -1;
+		for ( int i = 0 ; i < queue.size() ; ++i )
+		{
+			AssetRequest* req = queue[i];
+			if ( best < 0 || req->m_priority > queue[best]->m_priority ||
+				(req->m_priority == queue[best]->m_priority && req->m_serial < queue[best]->m_serial) )
+				best = i;
+		}
+		if ( best < 0 )
+			return 0;
+
+		P(AssetRequest) req = queue[best];
+		queue.remove( best );
+		beginLoad( req );
+		return req;
+	}
+
+	/** Removes specified request from the queue if it is still queued. */
+	bool take( AssetRequest* req )
+	{
+		synchronized( this );
+		for ( int i = 0 ; i < queue.size() ; ++i )
+		{
+			if ( queue[i] == req )
+			{
+				queue.remove( i );
+				beginLoad( req );
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/** Loads the request data from the archive. */
+	void load( AssetRequest* req )
+	{
+		// request data is not accessed by other threads before the request is ready
+		long time0 = System::currentTimeMillis();
+		Vector<uint8_t>& data = req->m_data;
+		String error;
+		bool failed = false;
+
+		try
+		{
+			P(InputStream) in = arch->getInputStream( req->name() );
+			long size = in->available();
+			for (;;)
+			{
+				long begin = data.size();
+				long bytes = size > begin ? size-begin : READ_BLOCK_SIZE;
+				data.setSize( begin+bytes );
+				bytes = in->read( data.begin()+begin, bytes );
+				data.setSize( begin+bytes );
+				if ( 0 == bytes )
+					break;
+			}
+			in->close();
+		}
+		catch ( Throwable& e )
+		{
+			failed = true;
+			data.clear();
+			error = e.getMessage().format();
+			Debug::printlnError( "sgu.AssetLoader: Failed to load {0}: {1}", req->name(), error );
+		}
+
+		long time1 = System::currentTimeMillis();
+		{
+			synchronized( req );
+			req->m_error = error;
+			req->m_state = failed ? AssetRequest::STATE_FAILED : AssetRequest::STATE_READY;
+		}
+
+		synchronized( this );
+		active.remove( req->name().toLowerCase() );
+		stats.loading -= 1;
+		stats.completed += 1;
+		if ( failed )
+			stats.failed += 1;
+		stats.bytes += (double)req->m_data.size();
+		stats.loadTime += (double)(time1-time0) * 1e-3;
+		stats.readyTime += (double)(time1-req->m_requestTime) * 1e-3;
+	}
+
+	/** Executes requests until the loader is stopped. */
+	void work()
+	{
+		for (;;)
+		{
+			P(AssetRequest) req = 0;
+			{
+				synchronized( this );
+				if ( stopped )
+					break;
+				req = pop();
+			}
+
+			if ( req )
+				load( req );
+			else
+				Thread::sleep( IDLE_SLEEP_MILLIS );
+		}
+	}
+
+private:
+	class LoaderThread :
+		public Thread
+	{
+	public:
+		explicit LoaderThread( AssetLoaderImpl* impl ) :
+			m_impl(impl)
+		{
+		}
+
+		void run()
+		{
+			m_impl->work();
+		}
+
+	private:
+		AssetLoaderImpl*	m_impl;
+
+		LoaderThread( const LoaderThread& );
+		LoaderThread& operator=( const LoaderThread& );
+	};
+
+	Vector< P(LoaderThread) >	m_threads;
+
+	/** Marks the request being loaded. Mutex must be locked. */
+	void beginLoad( AssetRequest* req )
+	{
+		synchronized( req );
+		req->m_state = AssetRequest::STATE_LOADING;
+		stats.queued -= 1;
+		stats.loading += 1;
+	}
+
+	AssetLoaderImpl( const AssetLoaderImpl& );
+	AssetLoaderImpl& operator=( const AssetLoaderImpl& );
+};
+
+//-----------------------------------------------------------------------------
+
+AssetRequest::AssetRequest( const String& name, int priority, int serial ) :
+	Object( OBJECT_INITMUTEX ),
+	m_name( name ),
+	m_priority( priority ),
+	m_serial( serial ),
+	m_state( STATE_QUEUED ),
+	m_data( Allocator<uint8_t>(__FILE__,__LINE__) ),
+	m_error( "" ),
+	m_requestTime( System::currentTimeMillis() )
+{
+}
+
+bool AssetRequest::ready() const
+{
+	synchronized( this );
+	return STATE_READY == m_state || STATE_FAILED == m_state;
+}
+
+bool AssetRequest::failed() const
+{
+	synchronized( this );
+	return STATE_FAILED == m_state;
+}
+
+const String& AssetRequest::name() const
+{
+	return m_name;
+}
+
+int AssetRequest::priority() const
+{
+	synchronized( this );
+	return m_priority;
+}
+
+long AssetRequest::size() const
+{
+	assert( ready() );
+	return m_data.size();
+}
+
+const void* AssetRequest::data() const
+{
+	assert( ready() );
+	return m_data.begin();
+}
+
+const String& AssetRequest::error() const
+{
+	assert( ready() );
+	return m_error;
+}
+
+InputStream* AssetRequest::getInputStream()
+{
+	assert( ready() && !failed() );
+	return new AssetInputStream( this );
+}
+
+//-----------------------------------------------------------------------------
+
+AssetLoader::Statistics::Statistics() :
+	queued( 0 ),
+	loading( 0 ),
+	completed( 0 ),
+	failed( 0 ),
+	bytes( 0.0 ),
+	loadTime( 0.0 ),
+	readyTime( 0.0 )
+{
+}
+
+float AssetLoader::Statistics::bytesPerSecond() const
+{
+	return loadTime > 0.0 ? (float)(bytes/loadTime) : 0.f;
+}
+
+float AssetLoader::Statistics::averageTimeToReady() const
+{
+	return completed > 0 ? (float)(readyTime/completed) : 0.f;
+}
+
+//-----------------------------------------------------------------------------
+
+AssetLoader::AssetLoader( InputStreamArchive* arch, int threads )
+{
+	assert( arch );
+	assert( threads >= 0 );
+
+	m_this = new AssetLoaderImpl( arch );
+	m_this->start( threads > 0 ? threads : processorCount() );
+}
+
+AssetLoader::~AssetLoader()
+{
+	m_this->stop();
+}
+
+AssetRequest* AssetLoader::request( const String& name, int priority )
+{
+	return m_this->request( name, priority );
+}
+
+void AssetLoader::wait( AssetRequest* request )
+{
+	assert( request );
+
+	if ( m_this->take(request) )
+		m_this->load( request );
+
+	while ( !request->ready() )
+		Thread::sleep( 1 );
+}
+
+InputStreamArchive* AssetLoader::archive() const
+{
+	return m_this->arch;
+}
+
+int AssetLoader::threads() const
+{
+	return m_this->threads();
+}
+
+AssetLoader::Statistics AssetLoader::statistics() const
+{
+	synchronized( m_this );
+	return m_this->stats;
+}
+
+
+} // sgu
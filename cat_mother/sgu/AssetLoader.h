@@ -0,0 +1,171 @@
+#ifndef _SGU_ASSETLOADER_H
+#define _SGU_ASSETLOADER_H
+
+
+#include <lang/Object.h>
+#include <lang/String.h>
+#include <util/Vector.h>
+#include <stdint.h>
+
+
+namespace io {
+	class InputStream;
+	class InputStreamArchive;}
+
+
+namespace sgu
+{
+
+
+class AssetLoader;
+
+
+/**
+ * Handle to an archive entry being loaded in the background by AssetLoader.
+ * Entry data can be accessed after ready() returns true.
+ */
+class AssetRequest :
+	public lang::Object
+{
+public:
+	/** Returns true if the request has been completed (either loaded or failed). */
+	bool					ready() const;
+
+	/** Returns true if the entry could not be loaded. */
+	bool					failed() const;
+
+	/** Returns name of the requested entry. */
+	const lang::String&		name() const;
+
+	/** Returns priority of the request. */
+	int						priority() const;
+
+	/** Returns size of loaded data in bytes. Request must be ready. */
+	long					size() const;
+
+	/** Returns loaded data. Request must be ready. */
+	const void*				data() const;
+
+	/** Returns error message if the request failed. */
+	const lang::String&		error() const;
+
+	/** 
+	 * Returns input stream to the loaded data. Request must be ready and not failed.
+	 * Stream keeps reference to the request.
+	 */
+	io::InputStream*		getInputStream();
+
+private:
+	friend class AssetLoader;
+
+	enum State
+	{
+		STATE_QUEUED,
+		STATE_LOADING,
+		STATE_READY,
+		STATE_FAILED
+	};
+
+	lang::String			m_name;
+	int						m_priority;
+	int						m_serial;
+	State					m_state;
+	util::Vector<uint8_t>	m_data;
+	lang::String			m_error;
+	long					m_requestTime;
+
+	AssetRequest( const lang::String& name, int priority, int serial );
+
+	AssetRequest( const AssetRequest& );
+	AssetRequest& operator=( const AssetRequest& );
+};
+
+
+/**
+ * Loads archive entries to memory with a pool of background threads.
+ * Requests are served in priority order and requests to the same entry
+ * share the same handle while the entry is being loaded.
+ * Parsing the loaded data is left to the caller, see
+ * ModelFileCache::requestModel and SceneManager::requestScene.
+ * Entries are opened by name from the loader threads while the
+ * archive may be used by other threads, see io::InputStreamArchive.
+ */
+class AssetLoader :
+	public lang::Object
+{
+public:
+	/** Loading statistics. */
+	class Statistics
+	{
+	public:
+		/** Number of requests waiting in the queue. */
+		int		queued;
+		/** Number of requests being loaded. */
+		int		loading;
+		/** Number of completed requests. */
+		int		completed;
+		/** Number of failed requests. */
+		int		failed;
+		/** Total number of bytes loaded. */
+		double	bytes;
+		/** Total time spent loading (summed over threads) in seconds. */
+		double	loadTime;
+		/** Total time from request to completion in seconds. */
+		double	readyTime;
+
+		Statistics();
+
+		/** Returns average loading speed in bytes per second. */
+		float	bytesPerSecond() const;
+
+		/** Returns average time from request to completion in seconds. */
+		float	averageTimeToReady() const;
+	};
+
+	/**
+	 * Starts loader threads.
+	 * @param arch Archive to load entries from.
+	 * @param threads Number of loader threads. 0 uses one thread per processor.
+	 */
+	explicit AssetLoader( io::InputStreamArchive* arch, int threads=1 );
+
+	/** Stops loader threads. Queued requests are left unfinished. */
+	~AssetLoader();
+
+	/** 
+	 * Requests loading of an archive entry.
+	 * If the entry is already being loaded then the existing request is returned
+	 * and its priority is raised if needed.
+	 * @param name Name of the archive entry.
+	 * @param priority Requests with higher priority are loaded first.
+	 */
+	AssetRequest*			request( const lang::String& name, int priority=0 );
+
+	/** 
+	 * Waits until the request is ready. 
+	 * If the request is still queued then it is loaded by the calling thread.
+	 */
+	void					wait( AssetRequest* request );
+
+	/** Returns archive used for loading. */
+	io::InputStreamArchive*	archive() const;
+
+	/** Returns number of loader threads. */
+	int						threads() const;
+
+	/** Returns loading statistics. */
+	Statistics				statistics() const;
+
+private:
+	class AssetLoaderImpl;
+	P(AssetLoaderImpl) m_this;
+
+	AssetLoader( const AssetLoader& );
+	AssetLoader& operator=( const AssetLoader& );
+};
+
+
+} // sgu
+
+
+#endif // _SGU_ASSETLOADER_H
@@ -1,8 +1,10 @@
 #include "ModelFile.h"
 #include "ChunkUtil.h"
+#include "CookedModelFormat.h"
 #include "ModelFileCache.h"
 #include <io/File.h>
 #include <io/ChunkInputStream.h>
+#include <io/ByteArrayInputStream.h>
 #include <io/IOException.h>
 #include <io/DataInputStream.h>
 #include <io/InputStreamArchive.h>
@@ -27,14 +29,11 @@
 #include <anim/VectorInterpolator.h>
 #include <algorithm>
 #include <assert.h>
+#include <memory.h>
 #include "config.h"
 
 //-----------------------------------------------------------------------------
 
-#define GM_FILE_VER 0x100
-
-//-----------------------------------------------------------------------------
-
 using namespace io;
 using namespace sg;
 using namespace pix;
@@ -49,6 +48,22 @@ namespace sgu
 {
 
 
+/** Reads specified number of bytes from the stream. */
+static void readFully( InputStream* in, void* data, long size )
+{
+	uint8_t* dst = reinterpret_cast<uint8_t*>( data );
+	while ( size > 0 )
+	{
+		long bytes = in->read( dst, size );
+		if ( bytes <= 0 )
+			throw IOException( Format("Unexpected end of file while reading {0}", in->toString()) );
+		dst += bytes;
+		size -= bytes;
+	}
+}
+
+//-----------------------------------------------------------------------------
+
 class ModelFile::ModelFileImpl :
 	public lang::Object
 {
@@ -71,19 +86,34 @@ public:
 		m_loadFlags( loadFlags ),
 		m_ambient( ambientColor ),
 		m_path( File(modelName).getParent() ),
-		m_materials( Allocator<P(Shader)>(__FILE__,__LINE__) )
+		m_materials( Allocator<P(Shader)>(__FILE__,__LINE__) ),
+		m_body( 0 ),
+		m_bodySize( 0 )
 	{
 		assert( arch );
 
+		// cooked files begin with magic bytes and geometry files with "gm" chunk name
 		P(InputStream) in = m_arch->getInputStream( name );
-		ChunkInputStream reader( in );
-		String chunk;
-		long end;
-		reader.beginChunk( &chunk, &end );
-		if ( chunk != "gm" )
-			throw IOException( Format("Invalid header in geometry file: {0}",name) );
-		readMain( &reader, end );
-		reader.endChunk( end );
+		uint8_t magic[COOKED_MAGIC_SIZE];
+		readFully( in, magic, sizeof(magic) );
+		if ( !memcmp(magic,COOKED_MAGIC,sizeof(magic)) )
+		{
+			readCooked( in );
+		}
+		else
+		{
+			const uint8_t GM_CHUNK_NAME[COOKED_MAGIC_SIZE] = {0,2,'g','m'};
+			if ( memcmp(magic,GM_CHUNK_NAME,sizeof(magic)) )
+				throw IOException( Format("Invalid header in geometry file: {0}",name) );
+
+			ChunkInputStream reader( in );
+			long size = reader.readInt();
+			if ( size < 0 )
+				throw IOException( Format("Invalid header in geometry file: {0}",name) );
+			long end = reader.size() + size;
+			readMain( &reader, end );
+			reader.endChunk( end );
+		}
 
 		// reset temporaries
 		in->close();
@@ -119,26 +149,263 @@ public:
 		while ( in->size() < end )
 		{
 			in->beginChunk( &subname, &subend );
-			
-			if ( subname == "material" && (m_loadFlags&ModelFile::LOAD_GEOMETRY) )
-				readMaterial( in, subend );
-			if ( subname == "effect" && (m_loadFlags&ModelFile::LOAD_GEOMETRY) )
-				readEffect( in, subend );
-			else if ( subname == "model" && (m_loadFlags&ModelFile::LOAD_GEOMETRY) )
-				readModel( in, subend );
-			else if ( subname == "patchlist" && (m_loadFlags&ModelFile::LOAD_GEOMETRY) )
-				readPatchList( in, subend );
-			else if ( subname == "morphtarget" && (m_loadFlags&ModelFile::LOAD_MORPH) )
-				readMorphTarget( in, subend );
-			else if ( subname == "morpher" && (m_loadFlags&ModelFile::LOAD_MORPH) )
-				readMorpher( in, subend );
-			else if ( subname == "linelist" && (m_loadFlags&ModelFile::LOAD_GEOMETRY) )
-				readLineList( in, subend );
-
+			readChunk( in, subname, subend );
 			in->endChunk( subend );
 		}
 	}
 
+	void readChunk( ChunkInputStream* in, const String& subname, long subend )
+	{
+		if ( subname == "material" && (m_loadFlags&ModelFile::LOAD_GEOMETRY) )
+			readMaterial( in, subend );
+		if ( subname == "effect" && (m_loadFlags&ModelFile::LOAD_GEOMETRY) )
+			readEffect( in, subend );
+		else if ( subname == "model" && (m_loadFlags&ModelFile::LOAD_GEOMETRY) )
+			readModel( in, subend );
+		else if ( subname == "patchlist" && (m_loadFlags&ModelFile::LOAD_GEOMETRY) )
+			readPatchList( in, subend );
+		else if ( subname == "morphtarget" && (m_loadFlags&ModelFile::LOAD_MORPH) )
+			readMorphTarget( in, subend );
+		else if ( subname == "morpher" && (m_loadFlags&ModelFile::LOAD_MORPH) )
+			readMorpher( in, subend );
+		else if ( subname == "linelist" && (m_loadFlags&ModelFile::LOAD_GEOMETRY) )
+			readLineList( in, subend );
+	}
+
+	void readCooked( InputStream* in )
+	{
+		// body is used in place if the stream has it in memory already
+		Vector<uint8_t> buffer( Allocator<uint8_t>(__FILE__,__LINE__) );
+		const void* data = 0;
+		long size = in->available();
+		long bytes = size > 0 ? in->readDirect( &data, size ) : 0;
+		if ( bytes <= 0 || bytes < size )
+		{
+			buffer.setSize( bytes );
+			if ( bytes > 0 )
+				memcpy( buffer.begin(), data, bytes );
+
+			for (;;)
+			{
+				long begin = buffer.size();
+				long count = size > begin ? size-begin : 65536;
+				buffer.setSize( begin+count );
+				count = in->read( buffer.begin()+begin, count );
+				buffer.setSize( begin+count );
+				if ( 0 == count )
+					break;
+			}
+			data = buffer.begin();
+			size = buffer.size();
+		}
+
+		// check header
+		if ( size < (long)sizeof(CookedModelHeader) )
+			throw IOException( Format("Truncated cooked geometry file: {0}", name) );
+		const CookedModelHeader* header = reinterpret_cast<const CookedModelHeader*>( data );
+		if ( header->byteOrder != COOKED_BYTE_ORDER )
+			throw IOException( Format("Cooked geometry file has different byte order: {0}", name) );
+		if ( header->version != COOKED_VERSION )
+			throw IOException( Format("Invalid cooked geometry file version (expected {1,x}, got {2,x}): {0}", name, COOKED_VERSION, header->version) );
+		if ( header->sourceVersion != GM_FILE_VER )
+			throw IOException( Format("Invalid geometry file version (expected {1,x}, got {2,x}): {0}", name, GM_FILE_VER, header->sourceVersion) );
+		if ( header->bodySize < (long)sizeof(CookedModelHeader) || header->bodySize > size )
+			throw IOException( Format("Truncated cooked geometry file: {0}", name) );
+		m_body = reinterpret_cast<const uint8_t*>( data );
+		m_bodySize = header->bodySize;
+
+		// read sections
+		const CookedSection* sections = reinterpret_cast<const CookedSection*>( 
+			cookedData(header->sectionTable, header->sections, sizeof(CookedSection)) );
+
+		for ( int i = 0 ; i < header->sections ; ++i )
+		{
+			const CookedSection& section = sections[i];
+			const void* sectionData = cookedData( section.offset, section.size );
+
+			if ( COOKED_MODEL == section.type && (m_loadFlags&ModelFile::LOAD_GEOMETRY) )
+			{
+				if ( section.size != sizeof(CookedModel) )
+					throw IOException( Format("Invalid model section in cooked geometry file: {0}", name) );
+				readCookedModel( *reinterpret_cast<const CookedModel*>(sectionData) );
+			}
+			else if ( COOKED_MORPHTARGET == section.type && (m_loadFlags&ModelFile::LOAD_MORPH) )
+			{
+				if ( section.size != sizeof(CookedMorphTarget) )
+					throw IOException( Format("Invalid morphtarget section in cooked geometry file: {0}", name) );
+				readCookedMorphTarget( *reinterpret_cast<const CookedMorphTarget*>(sectionData) );
+			}
+			else if ( COOKED_CHUNK == section.type )
+			{
+				// parse other chunks as in geometry files
+				P(InputStream) chunkIn = new ByteArrayInputStream( sectionData, section.size );
+				ChunkInputStream reader( chunkIn );
+				readChunk( &reader, cookedString(section.name), section.size );
+				reader.endChunk( section.size );
+			}
+		}
+
+		m_body = 0;
+		m_bodySize = 0;
+	}
+
+	void readCookedModel( const CookedModel& cm )
+	{
+		const int vertices = cm.vertices;
+		if ( vertices < 1 || vertices > 65534 || 
+			cm.triangles < 0 || cm.triangles > m_bodySize/int(3*sizeof(uint16_t)) || 
+			cm.texCoordLayers < 0 || cm.texCoordLayers > COOKED_MAX_LAYERS ||
+			cm.texCoordLayersRead < 0 || cm.texCoordLayersRead > cm.texCoordLayers ||
+			cm.vertexColorDim < 0 || cm.vertexColorDim > 4 )
+			throw IOException( Format("Invalid model section in cooked geometry file: {0}", name) );
+		const int indices = cm.triangles*3;
+
+		// create the model
+		int tangentLayer = -1;
+		bool needsTangentSpaceU = (0 != cm.tangentSpaceU);
+		P(Model) model = createModel( vertices, cm.triangles, cm.weightsPerVertex, cm.texCoordLayers, cm.texCoordSizes, cm.vertexColorDim, needsTangentSpaceU, &tangentLayer );
+		VertexFormat vf = model->vertexFormat();
+		VertexAndIndexLock<Model> lock( model, Model::LOCK_READWRITE );
+
+		setModelMaterial( model, cm.material, cm.vertexColorDim );
+
+		// vertex data arrays are used directly from the file
+		const Vector3* points = reinterpret_cast<const Vector3*>( cookedData(cm.points, vertices, sizeof(Vector3)) );
+		model->setVertexPositions( 0, points, vertices );
+
+		bool normalsRead = (cm.normals >= 0);
+		if ( normalsRead && vf.hasNormal() )
+		{
+			const Vector3* normals = reinterpret_cast<const Vector3*>( cookedData(cm.normals, vertices, sizeof(Vector3)) );
+			model->setVertexNormals( 0, normals, vertices );
+		}
+
+		int texCoordLayer = 0;
+		for ( ; texCoordLayer < cm.texCoordLayersRead && texCoordLayer < vf.textureCoordinates() ; ++texCoordLayer )
+		{
+			int dim = cm.texCoordSizes[texCoordLayer];
+			if ( dim == vf.getTextureCoordinateSize(texCoordLayer) )
+			{
+				const float* tc = reinterpret_cast<const float*>( cookedData(cm.texCoords[texCoordLayer], vertices, dim*sizeof(float)) );
+				model->setVertexTextureCoordinates( 0, texCoordLayer, dim, tc, vertices );
+			}
+		}
+		if ( texCoordLayer != cm.texCoordLayers )
+			throw IOException( Format("Missing texture coordinate layer subchunk in model chunk of a geometry file: {0}",name) );
+
+		if ( cm.colors >= 0 && vf.hasDiffuse() )
+		{
+			const uint8_t* colors = reinterpret_cast<const uint8_t*>( cookedData(cm.colors, vertices, cm.vertexColorDim) );
+			setVertexColors( model, 0, colors, cm.vertexColorDim, vertices );
+		}
+
+		// indices are copied as is after range check
+		const uint16_t* ind = reinterpret_cast<const uint16_t*>( cookedData(cm.indices, indices, sizeof(uint16_t)) );
+		uint16_t maxIndex = 0;
+		for ( int i = 0 ; i < indices ; ++i )
+			maxIndex = ind[i] > maxIndex ? ind[i] : maxIndex;
+		if ( indices > 0 && maxIndex >= vertices )
+			throw IOException( Format("Invalid vertex index ({1,#}) in a geometry file: {0}", name, maxIndex) );
+		void* indexData;
+		int indexSize;
+		model->getIndexData( &indexData, &indexSize );
+		assert( sizeof(uint16_t) == indexSize );
+		memcpy( indexData, ind, indices*sizeof(uint16_t) );
+
+		// map skin bones and set vertex weights
+		if ( cm.vertexBones >= 0 && vf.weights() > 0 )
+		{
+			const int MAX_BONES = COOKED_MAX_BONES;
+			int bones = cm.skinBones;
+			if ( bones < 0 || bones > MAX_BONES )
+				throw IOException( Format("Too many bones ({1,#}) in a geometry file: {0}", name, bones) );
+			const int32_t* boneNameOffsets = reinterpret_cast<const int32_t*>( cookedData(cm.skinBoneNames, bones, sizeof(int32_t)) );
+			String boneNames[MAX_BONES];
+			for ( int i = 0 ; i < bones ; ++i )
+				boneNames[i] = cookedString( boneNameOffsets[i] );
+
+			int meshBoneIndices[MAX_BONES];
+			getMeshBoneIndices( boneNames, bones, meshBoneIndices );
+
+			const int32_t* vertexBones = reinterpret_cast<const int32_t*>( cookedData(cm.vertexBones, vertices, sizeof(int32_t)) );
+			int weights = 0;
+			for ( int i = 0 ; i < vertices ; ++i )
+			{
+				if ( vertexBones[i] < 0 || vertexBones[i] > MAX_BONES )
+					throw IOException( Format("Invalid skin in cooked geometry file: {0}", name) );
+				weights += vertexBones[i];
+			}
+			const CookedBoneWeight* boneWeight = reinterpret_cast<const CookedBoneWeight*>( cookedData(cm.boneWeights, weights, sizeof(CookedBoneWeight)) );
+
+			int		boneIndices[MAX_BONES];
+			float	boneWeights[MAX_BONES];
+			for ( int i = 0 ; i < vertices ; ++i )
+			{
+				int usedBones = vertexBones[i];
+				for ( int k = 0 ; k < usedBones ; ++k )
+				{
+					int bi = boneWeight[k].bone;
+					if ( bi < 0 || bi >= bones )
+						throw IOException( Format("Invalid bone index ({1,#}) in geometry file: {0}", name, bi) );
+					boneIndices[k] = 1+meshBoneIndices[bi];
+					boneWeights[k] = boneWeight[k].weight;
+				}
+				boneWeight += usedBones;
+
+				usedBones = Model::sortVertexWeights( boneIndices, boneWeights, usedBones, boneIndices, boneWeights );
+				model->setVertexWeights( i, boneIndices, boneWeights, usedBones );
+			}
+
+			model->optimizeBoneIndices();
+			Debug::println( "Geometry {0} using material {1} uses {2} bones.", name, model->shader() ? model->shader()->name() : "(none)", model->usedBones() );
+		}
+
+		completeModel( model, normalsRead, needsTangentSpaceU, tangentLayer );
+		primitives.add( model.ptr() );
+	}
+
+	void readCookedMorphTarget( const CookedMorphTarget& ct )
+	{
+		P(MorphTarget) morphtarget = new MorphTarget;
+		morphtarget->setName( cookedString(ct.name) );
+		morphtarget->setMaterialName( cookedString(ct.materialName) );
+
+		if ( ct.deltas > 0 )
+		{
+			const MorphTarget::Delta* deltas = reinterpret_cast<const MorphTarget::Delta*>( cookedData(ct.deltaData, ct.deltas, sizeof(MorphTarget::Delta)) );
+			morphtarget->addDeltas( const_cast<MorphTarget::Delta*>(deltas), ct.deltas, ct.scale );
+		}
+
+		primitives.add( morphtarget.ptr() );
+	}
+
+	/** 
+	 * Returns pointer to an array in cooked file body. Checks that the array is inside the body.
+	 * Count is compared to the space left before multiplying so corrupted counts cannot overflow.
+	 */
+	const void* cookedData( int offset, int count, int elementSize ) const
+	{
+		if ( offset < 0 || count < 0 || elementSize < 0 || (offset&3) != 0 || offset > m_bodySize || 
+			(elementSize > 0 && count > (m_bodySize-offset)/elementSize) )
+			throw IOException( Format("Corrupted cooked geometry file: {0}", name) );
+		return m_body + offset;
+	}
+
+	/** Returns pointer to data in cooked file body. Checks that the data is inside the body. */
+	const void* cookedData( int offset, int bytes ) const
+	{
+		return cookedData( offset, bytes, 1 );
+	}
+
+	/** Returns string stored in cooked file body. */
+	String cookedString( int offset ) const
+	{
+		const int32_t* length = reinterpret_cast<const int32_t*>( cookedData(offset, sizeof(int32_t)) );
+		const void* chars = cookedData( offset+sizeof(int32_t), *length );
+		return String( chars, *length, "UTF-8" );
+	}
+
+
 	void readMorpher( ChunkInputStream* in, long end )
 	{
 		String subname;
@@ -472,7 +739,6 @@ public:
 			vertexColorDim = in->readInt();
 		if ( 0 != vertexColorDim && 3 != vertexColorDim && 4 != vertexColorDim )
 			throw IOException( Format( "Invalid vertex color size ({1}) in geometry file: {0}", name, vertexColorDim) );
-		bool lit = (0 == vertexColorDim);
 
 		// read if tangent space U-axis is needed (for bump mapping)
 		bool needsTangentSpaceU = false;
@@ -481,34 +747,10 @@ public:
 
 		in->endChunk( subend );
 
-		// check for texcoord count limits
-		if ( texCoordLayers + 
-			(needsTangentSpaceU?1:0) + 
-			(weightsPerVertex>0?2:0) > VertexFormat::MAX_LAYERS )
-		{
-			throw IOException( Format("Too many texture coordinate layers in {0}", name) );
-		}
-
-		// find out vertex format
-		VertexFormat vf;
-		vf.setWeights( weightsPerVertex );
-		for ( int i = 0 ; i < texCoordLayers ; ++i )
-			vf.addTextureCoordinate( texCoordSizes[i] );
-		if ( vertexColorDim > 0 )
-			vf.addDiffuse();
-		vf.addNormal();
-		int tangentLayer = -1;
-		if ( needsTangentSpaceU )
-		{
-			tangentLayer = vf.textureCoordinates();
-			vf.addTextureCoordinate( 3 );
-		}
-
 		// create the model
-		P(Model) model = new Model( vertices, triangles*3, vf );
-		if ( vf.textureCoordinates() > model->vertexFormat().textureCoordinates() )
-			throw IOException( Format("Too many texture coordinates in {0}", name) );
-		vf = model->vertexFormat();
+		int tangentLayer = -1;
+		P(Model) model = createModel( vertices, triangles, weightsPerVertex, texCoordLayers, texCoordSizes, vertexColorDim, needsTangentSpaceU, &tangentLayer );
+		VertexFormat vf = model->vertexFormat();
 		VertexAndIndexLock<Model> lock( model, Model::LOCK_READWRITE );
 
 		// read subchunks
@@ -525,52 +767,28 @@ public:
 
 			if ( subname == "material" )
 			{
-				int ix = in->readInt();
-				if ( ix < 0 || ix >= (int)m_materials.size() )
-					throw IOException( Format("Undefined material (index {1,#}) used in the geometry file: {0}", name, ix) );
-				
-				P(Shader) mat = m_materials[ix]->clone();
-				mat->setVertexFormat( model->vertexFormat() );
-				model->setShader( mat );
+				setModelMaterial( model, in->readInt(), vertexColorDim );
 				materialRead = true;
-
-				Material* mtl = dynamic_cast<Material*>( mat.ptr() );
-				if ( mtl )
-				{
-					// enable vertex color usage if needed
-					if ( vertexColorDim > 0 )
-					{
-						mtl->setVertexColor( true );
-						mtl->setEmissiveColorSource( Material::MCS_COLOR1 );
-					}
-
-					// disable lighting if the mesh is unlit
-					if ( !lit ) 
-						mtl->setLighting( false );
-				}
 			}
 			else if ( subname == "points" )
 			{
-				for ( int i = 0 ; i < vertices ; ++i )
+				if ( vertices > 0 )
 				{
-					Vector3 v;
-					for ( int k = 0 ; k < 3 ; ++k )
-						v[k] = in->readFloat();
-					model->setVertexPositions( i, &v );
+					Vector<Vector3> v( Allocator<Vector3>(__FILE__,__LINE__) );
+					v.setSize( vertices );
+					in->readFloatArray( &v[0].x, vertices*3 );
+					model->setVertexPositions( 0, v.begin(), vertices );
 				}
 				pointsRead = true;
 			}
 			else if ( subname == "vertexnormalsf" )
 			{
-				if ( vf.hasNormal() )
+				if ( vf.hasNormal() && vertices > 0 )
 				{
-					for ( int i = 0 ; i < vertices ; ++i )
-					{
-						Vector3 v;
-						for ( int k = 0 ; k < 3 ; ++k )
-							v[k] = in->readFloat();
-						model->setVertexNormals( i, &v );
-					}
+					Vector<Vector3> v( Allocator<Vector3>(__FILE__,__LINE__) );
+					v.setSize( vertices );
+					in->readFloatArray( &v[0].x, vertices*3 );
+					model->setVertexNormals( 0, v.begin(), vertices );
 				}
 				normalsRead = true;
 			}
@@ -599,29 +817,12 @@ public:
 					int dim = vertexColorDim;
 					assert( dim > 0 && dim <= 4 );
 
-					// base color for vertices (=emissive+ambient)
-					Colorf vertexBaseColor(0,0,0);
-					Material* mat = dynamic_cast<Material*>( model->shader() );
-					float alpha = 1.f;
-					if ( mat )
-					{
-						alpha = mat->diffuseColor().alpha();
-						vertexBaseColor.setAlpha( 0 );
-					}
-
 					for ( int i = 0 ; i < vertices ; ++i )
 					{
-						float v[4] = {1.f,1.f,1.f,alpha};
-
-						for ( int i = 0 ; i < dim ; ++i )
-						{
-							v[i] = in->readByte();
-							v[i] *= 1.f / 255.f;
-						}
-
-						Colorf color = vertexBaseColor + Colorf( v[0], v[1], v[2], v[3] );
-						Color vcolor( color );
-						model->setVertexDiffuseColors( i, &vcolor, 1 );
+						uint8_t v[4];
+						for ( int k = 0 ; k < dim ; ++k )
+							v[k] = in->readByte();
+						setVertexColors( model, i, v, dim, 1 );
 					}
 				}
 			}
@@ -635,8 +836,7 @@ public:
 					{
 						for ( int i = 0 ; i < vertices ; ++i )
 						{
-							for ( int k = 0 ; k < dim ; ++k )
-								tc[k] = in->readFloat();
+							in->readFloatArray( tc, dim );
 							model->setVertexTextureCoordinates( i, texCoordLayer, dim, tc );
 						}
 					}
@@ -658,14 +858,7 @@ public:
 
 					// build mapping from affecting bone to mesh bone index
 					int meshBoneIndices[MAX_BONES];
-					const String* meshBoneNamesEnd = m_meshBoneNames+m_meshBones;
-					for ( int i = 0 ; i < bones ; ++i )
-					{
-						const String* meshBone = std::find( m_meshBoneNames, meshBoneNamesEnd, boneNames[i] );
-						if ( meshBone == meshBoneNamesEnd )
-							throw IOException( Format("Model file {0} has weights defined for bone {1} but the mesh does not have a such bone.", name, boneNames[i]) );
-						meshBoneIndices[i] = meshBone-m_meshBoneNames;
-					}
+					getMeshBoneIndices( boneNames, bones, meshBoneIndices );
 
 					// read weights
 					const int	maxBonesPerVertex = MAX_BONES;
@@ -764,6 +957,121 @@ public:
 			}
 		}
 
+		completeModel( model, normalsRead, needsTangentSpaceU, tangentLayer );
+		primitives.add( model.ptr() );
+	}
+
+	/** Creates model and vertex format described by the model info chunk. */
+	P(Model) createModel( int vertices, int triangles, int weightsPerVertex, 
+		int texCoordLayers, const int* texCoordSizes, int vertexColorDim, 
+		bool needsTangentSpaceU, int* tangentLayer )
+	{
+		// check for texcoord count limits
+		if ( texCoordLayers + 
+			(needsTangentSpaceU?1:0) + 
+			(weightsPerVertex>0?2:0) > VertexFormat::MAX_LAYERS )
+		{
+			throw IOException( Format("Too many texture coordinate layers in {0}", name) );
+		}
+
+		// find out vertex format
+		VertexFormat vf;
+		vf.setWeights( weightsPerVertex );
+		for ( int i = 0 ; i < texCoordLayers ; ++i )
+			vf.addTextureCoordinate( texCoordSizes[i] );
+		if ( vertexColorDim > 0 )
+			vf.addDiffuse();
+		vf.addNormal();
+		*tangentLayer = -1;
+		if ( needsTangentSpaceU )
+		{
+			*tangentLayer = vf.textureCoordinates();
+			vf.addTextureCoordinate( 3 );
+		}
+
+		// create the model
+		P(Model) model = new Model( vertices, triangles*3, vf );
+		if ( vf.textureCoordinates() > model->vertexFormat().textureCoordinates() )
+			throw IOException( Format("Too many texture coordinates in {0}", name) );
+		return model;
+	}
+
+	/** Sets a clone of ith material of the file to the model. */
+	void setModelMaterial( Model* model, int ix, int vertexColorDim )
+	{
+		if ( ix < 0 || ix >= (int)m_materials.size() )
+			throw IOException( Format("Undefined material (index {1,#}) used in the geometry file: {0}", name, ix) );
+		
+		P(Shader) mat = m_materials[ix]->clone();
+		mat->setVertexFormat( model->vertexFormat() );
+		model->setShader( mat );
+
+		Material* mtl = dynamic_cast<Material*>( mat.ptr() );
+		if ( mtl )
+		{
+			// enable vertex color usage if needed
+			if ( vertexColorDim > 0 )
+			{
+				mtl->setVertexColor( true );
+				mtl->setEmissiveColorSource( Material::MCS_COLOR1 );
+			}
+
+			// disable lighting if the mesh is unlit
+			bool lit = (0 == vertexColorDim);
+			if ( !lit ) 
+				mtl->setLighting( false );
+		}
+	}
+
+	/** Sets vertex colors from 8-bit color components, dim components per vertex. */
+	void setVertexColors( Model* model, int firstVertex, const uint8_t* colors, int dim, int count )
+	{
+		assert( dim > 0 && dim <= 4 );
+
+		// base color for vertices (=emissive+ambient)
+		Colorf vertexBaseColor(0,0,0);
+		Material* mat = dynamic_cast<Material*>( model->shader() );
+		float alpha = 1.f;
+		if ( mat )
+		{
+			alpha = mat->diffuseColor().alpha();
+			vertexBaseColor.setAlpha( 0 );
+		}
+
+		for ( int i = 0 ; i < count ; ++i )
+		{
+			float v[4] = {1.f,1.f,1.f,alpha};
+
+			for ( int k = 0 ; k < dim ; ++k )
+			{
+				v[k] = colors[i*dim+k];
+				v[k] *= 1.f / 255.f;
+			}
+
+			Colorf color = vertexBaseColor + Colorf( v[0], v[1], v[2], v[3] );
+			Color vcolor( color );
+			model->setVertexDiffuseColors( firstVertex+i, &vcolor, 1 );
+		}
+	}
+
+	/** Maps names of the bones affecting the model to mesh bone indices. */
+	void getMeshBoneIndices( const String* boneNames, int bones, int* meshBoneIndices )
+	{
+		const String* meshBoneNamesEnd = m_meshBoneNames+m_meshBones;
+		for ( int i = 0 ; i < bones ; ++i )
+		{
+			const String* meshBone = std::find( m_meshBoneNames, meshBoneNamesEnd, boneNames[i] );
+			if ( meshBone == meshBoneNamesEnd )
+				throw IOException( Format("Model file {0} has weights defined for bone {1} but the mesh does not have a such bone.", name, boneNames[i]) );
+			meshBoneIndices[i] = meshBone-m_meshBoneNames;
+		}
+	}
+
+	/** Generates vertex normals and tangents if needed. */
+	void completeModel( Model* model, bool normalsRead, bool needsTangentSpaceU, int tangentLayer )
+	{
+		VertexFormat vf = model->vertexFormat();
+
 		// generate vertex normals if needed
 		if ( !normalsRead && vf.hasNormal() )
 			model->computeVertexNormals();
@@ -780,8 +1088,6 @@ public:
 			}
 			model->computeVertexTangents( 0, tangentLayer );
 		}
-
-		primitives.add( model.ptr() );
 	}
 
 	void readMaterial( ChunkInputStream* in, long end )
@@ -1145,6 +1451,8 @@ private:
 	Colorf					m_ambient;
 	String					m_path;
 	Vector< P(Shader) >		m_materials;
+	const uint8_t*			m_body;
+	int						m_bodySize;
 
 	ModelFileImpl();
 	ModelFileImpl( const ModelFileImpl& );
@@ -1,8 +1,12 @@
 #include "ModelFileCache.h"
+#include "PrefetchArchive.h"
 #include <io/FileInputStream.h>
 #include <io/InputStreamArchive.h>
 #include <sgu/ModelFile.h>
+#include <sgu/AssetLoader.h>
+#include <lang/Debug.h>
 #include <lang/String.h>
+#include <lang/Throwable.h>
 #include <math/Vector3.h>
 #include <util/Hashtable.h>
 #include <assert.h>
@@ -25,18 +29,62 @@ class ModelFileCache::ModelFileCacheImpl :
 	public lang::Object
 {
 public:
-	Hashtable< String, P(ModelFile) >	files;
-	P(InputStreamArchive)				zip;
+	Hashtable< String, P(ModelFile) >			files;
+	P(InputStreamArchive)						zip;
+	P(AssetLoader)								loader;
+	Vector< P(ModelFileRequest) >				pending;
+	Hashtable< String, P(ModelFileRequest) >	requests;
 
 	ModelFileCacheImpl() :
 		files( Allocator< HashtablePair<String,P(ModelFile)> >(__FILE__,__LINE__) ),
-		zip(0)
+		zip(0),
+		loader(0),
+		pending( Allocator< P(ModelFileRequest) >(__FILE__,__LINE__) ),
+		requests( Allocator< HashtablePair<String,P(ModelFileRequest)> >(__FILE__,__LINE__) )
 	{
 	}
 };
 
 //-----------------------------------------------------------------------------
 
+ModelFileRequest::ModelFileRequest( const String& name, 
+	const String* boneNames, int bones,
+	const pix::Colorf& ambient, int loadFlags ) :
+	m_asset( 0 ),
+	m_name( name ),
+	m_boneNames( Allocator<String>(__FILE__,__LINE__) ),
+	m_ambient( ambient ),
+	m_loadFlags( loadFlags ),
+	m_model( 0 ),
+	m_ready( false ),
+	m_failed( false )
+{
+	for ( int i = 0 ; i < bones ; ++i )
+		m_boneNames.add( boneNames[i] );
+}
+
+bool ModelFileRequest::ready() const
+{
+	return m_ready;
+}
+
+bool ModelFileRequest::failed() const
+{
+	return m_failed;
+}
+
+ModelFile* ModelFileRequest::modelFile() const
+{
+	return m_model;
+}
+
+const String& ModelFileRequest::name() const
+{
+	return m_name;
+}
+
+//-----------------------------------------------------------------------------
+
 ModelFileCache::ModelFileCache( InputStreamArchive* zip )
 {
 	assert( zip );
@@ -55,6 +103,17 @@ ModelFile* ModelFileCache::getByName( const String& name,
 	String fname = name.toLowerCase();
 	P(ModelFile) model = m_this->files[fname];
 	if ( !model )
+	{
+		// finish pending background request first
+		P(ModelFileRequest) req = m_this->requests[fname];
+		if ( req )
+		{
+			m_this->loader->wait( req->m_asset );
+			finalize( req );
+			model = m_this->files[fname];
+		}
+	}
+	if ( !model )
 	{
 		model = new ModelFile( name, boneNames, bones, ambient, m_this->zip, this, loadFlags );
 		m_this->files[fname] = model;
@@ -62,6 +121,117 @@ ModelFile* ModelFileCache::getByName( const String& name,
 	return model;
 }
 
+ModelFileRequest* ModelFileCache::requestModel( const String& name,
+	const String* boneNames, int bones, const pix::Colorf& ambient, 
+	int loadFlags, int priority )
+{
+	String fname = name.toLowerCase();
+	P(ModelFileRequest) req = m_this->requests[fname];
+	if ( !req )
+	{
+		req = new ModelFileRequest( name, boneNames, bones, ambient, loadFlags );
+
+		P(ModelFile) model = m_this->files[fname];
+		if ( model )
+		{
+			req->m_model = model;
+			req->m_ready = true;
+		}
+		else
+		{
+			req->m_asset = loader()->request( name, priority );
+			m_this->requests[fname] = req;
+			m_this->pending.add( req );
+		}
+	}
+	else
+	{
+		// raises priority of the queued request
+		loader()->request( name, priority );
+	}
+	return req;
+}
+
+int ModelFileCache::finalize( int maxModels )
+{
+	int count = 0;
+	for ( int i = 0 ; i < m_this->pending.size() && count != maxModels ; )
+	{
+		P(ModelFileRequest) req = m_this->pending[i];
+		if ( req->m_asset->ready() )
+		{
+			finalize( req );
+			++count;
+		}
+		else
+		{
+			++i;
+		}
+	}
+	return count;
+}
+
+void ModelFileCache::finalize( ModelFileRequest* req )
+{
+	assert( req->m_asset && req->m_asset->ready() );
+
+	String fname = req->m_name.toLowerCase();
+	if ( req->m_asset->failed() )
+	{
+		req->m_failed = true;
+	}
+	else
+	{
+		try
+		{
+			P(ModelFile) model = m_this->files[fname];
+			if ( !model )
+			{
+				P(PrefetchArchive) arch = new PrefetchArchive( m_this->zip, req->m_asset );
+				model = new ModelFile( req->m_name, req->m_boneNames.begin(), req->m_boneNames.size(), 
+					req->m_ambient, arch, this, req->m_loadFlags );
+				arch->close();
+				m_this->files[fname] = model;
+			}
+			req->m_model = model;
+		}
+		catch ( Throwable& e )
+		{
+			Debug::printlnError( "sgu.ModelFileCache: Failed to create model {0}: {1}", req->m_name, e.getMessage().format() );
+			req->m_failed = true;
+		}
+	}
+
+	req->m_asset = 0;
+	req->m_ready = true;
+	m_this->requests.remove( fname );
+	for ( int i = 0 ; i < m_this->pending.size() ; ++i )
+	{
+		if ( m_this->pending[i] == req )
+		{
+			m_this->pending.remove( i );
+			break;
+		}
+	}
+}
+
+int ModelFileCache::pendingRequests() const
+{
+	return m_this->pending.size();
+}
+
+void ModelFileCache::setLoader( AssetLoader* loader )
+{
+	m_this->loader = loader;
+}
+
+AssetLoader* ModelFileCache::loader()
+{
+	if ( !m_this->loader )
+		m_this->loader = new AssetLoader( m_this->zip );
+	return m_this->loader;
+}
+
 void ModelFileCache::clear()
 {
 	m_this->files.clear();
@@ -4,17 +4,14 @@
 
 #include <sgu/ModelFile.h>
 #include <lang/Object.h>
+#include <lang/String.h>
+#include <util/Vector.h>
+#include <pix/Colorf.h>
 
 
 namespace io {
 	class InputStreamArchive;}
 
-namespace pix {
-	class Colorf;}
-
-namespace lang {
-	class String;}
-
 namespace math {
 	class Vector3;}
 
@@ -24,6 +21,50 @@ namespace sgu
 
 
 class ModelFile;
+class AssetLoader;
+class AssetRequest;
+class ModelFileCache;
+
+
+/**
+ * Handle to a model file being loaded in the background.
+ * See ModelFileCache::requestModel.
+ */
+class ModelFileRequest :
+	public lang::Object
+{
+public:
+	/** Returns true if the model file has been finalized (either created or failed). */
+	bool				ready() const;
+
+	/** Returns true if the model file could not be loaded. */
+	bool				failed() const;
+
+	/** Returns loaded model file or 0 if not ready or failed. */
+	ModelFile*			modelFile() const;
+
+	/** Returns name of the model file. */
+	const lang::String&	name() const;
+
+private:
+	friend class ModelFileCache;
+
+	P(AssetRequest)					m_asset;
+	lang::String					m_name;
+	util::Vector<lang::String>		m_boneNames;
+	pix::Colorf						m_ambient;
+	int								m_loadFlags;
+	P(ModelFile)					m_model;
+	bool							m_ready;
+	bool							m_failed;
+
+	ModelFileRequest( const lang::String& name, 
+		const lang::String* boneNames, int bones,
+		const pix::Colorf& ambient, int loadFlags );
+
+	ModelFileRequest( const ModelFileRequest& );
+	ModelFileRequest& operator=( const ModelFileRequest& );
+};
 
 
 /** 
@@ -54,13 +95,54 @@ public:
 					const lang::String* boneNames, int bones,
 					const pix::Colorf& ambient, int loadFlags=ModelFile::LOAD_ALL );
 
-	/** Removes all loaded model files from the cache. */
+	/** 
+	 * Requests loading of model file in the background.
+	 * Model file data is read from the archive by loader threads,
+	 * the model file itself is created by finalize() since
+	 * creating rendering resources must be done by the main thread.
+	 * If the model file has already been loaded then returned request is ready immediately.
+	 * @param name Name of the model file.
+	 * @param boneNames Names of the available mesh bones. Copied by the request.
+	 * @param bones Number of bones available in the mesh.
+	 * @param ambient Ambient vertex color for unlit objects.
+	 * @param loadFlags See ModelFile::LoadFlags.
+	 * @param priority Requests with higher priority are loaded first.
+	 */
+	ModelFileRequest*	requestModel( const lang::String& name,
+							const lang::String* boneNames, int bones,
+							const pix::Colorf& ambient, int loadFlags=ModelFile::LOAD_ALL, 
+							int priority=0 );
+
+	/** 
+	 * Creates model files of the requests which have been loaded by the background threads.
+	 * Must be called from the main thread, for example once per frame.
+	 * Loading errors are reported with Debug::printlnError and the requests are marked failed.
+	 * @param maxModels Maximum number of model files to create, -1 if no limit.
+	 * @return Number of requests finalized.
+	 */
+	int			finalize( int maxModels=-1 );
+
+	/** Returns number of requests waiting to be finalized. */
+	int			pendingRequests() const;
+
+	/** 
+	 * Sets background loader used by the cache. 
+	 * By default a loader with single thread is created on first request.
+	 */
+	void		setLoader( AssetLoader* loader );
+
+	/** Returns background loader used by the cache. */
+	AssetLoader*	loader();
+
+	/** Removes all loaded model files from the cache. Pending requests are not affected. */
 	void		clear();
 
 private:
 	class ModelFileCacheImpl;
 	P(ModelFileCacheImpl) m_this;
 
+	void	finalize( ModelFileRequest* req );
+
 	ModelFileCache( const ModelFileCache& );
 	ModelFileCache& operator=( const ModelFileCache& );
 };
@@ -0,0 +1,480 @@
+#include "ModelFileCooker.h"
+#include "CookedModelFormat.h"
+#include <io/IOException.h>
+#include <io/InputStream.h>
+#include <io/OutputStream.h>
+#include <io/ChunkInputStream.h>
+#include <io/DataInputStream.h>
+#include <io/ByteArrayInputStream.h>
+#include <sg/MorphTarget.h>
+#include <lang/Debug.h>
+#include <lang/Format.h>
+#include <lang/String.h>
+#include <math/Vector3.h>
+#include <math/Vector4.h>
+#include <util/Vector.h>
+#include <assert.h>
+#include <memory.h>
+#include "config.h"
+
+//-----------------------------------------------------------------------------
+
+using namespace io;
+using namespace sg;
+using namespace lang;
+using namespace util;
+using namespace math;
+
+//-----------------------------------------------------------------------------
+
+namespace sgu
+{
+
+
+/** Body of cooked file under construction. */
+class CookedBody
+{
+public:
+	Vector<uint8_t>		data;
+
+	CookedBody() :
+		data( Allocator<uint8_t>(__FILE__,__LINE__) )
+	{
+	}
+
+	/** Reserves zero initialized space for data and returns offset to it. */
+	int reserve( int bytes )
+	{
+		int offset = data.size();
+		data.setSize( offset + ((bytes+3)&~3), 0 );
+		return offset;
+	}
+
+	/** Adds data and returns offset to it. */
+	int add( const void* src, int bytes )
+	{
+		int offset = reserve( bytes );
+		if ( bytes > 0 )
+			memcpy( data.begin()+offset, src, bytes );
+		return offset;
+	}
+
+	/** Adds string and returns offset to it. */
+	int addString( const String& str )
+	{
+		Vector<char> buf( Allocator<char>(__FILE__,__LINE__) );
+		buf.setSize( str.length()*4+1 );
+		int32_t length = str.getBytes( buf.begin(), buf.size(), "UTF-8" );
+		int offset = add( &length, sizeof(length) );
+		add( buf.begin(), length );
+		return offset;
+	}
+
+	/** Returns pointer to data at offset. Pointer is valid until more data is added. */
+	uint8_t* at( int offset )
+	{
+		return data.begin() + offset;
+	}
+};
+
+//-----------------------------------------------------------------------------
+
+/** Reads raw chunk data to the body and returns offset to it. */
+static int cookChunk( ChunkInputStream* in, long end, CookedBody& body )
+{
+	long size = end - in->size();
+	int offset = body.reserve( size );
+	uint8_t* data = body.at( offset );
+	while ( size > 0 )
+	{
+		long bytes = in->read( data, size );
+		if ( bytes <= 0 )
+			throw IOException( Format("Unexpected end of file while reading {0}", in->toString()) );
+		data += bytes;
+		size -= bytes;
+	}
+	return offset;
+}
+
+/** Returns name of material or effect defined in raw chunk data. */
+static String getMaterialName( const String& chunk, const uint8_t* data, int size )
+{
+	P(InputStream) bin = new ByteArrayInputStream( data, size );
+	DataInputStream in( bin );
+	String str = in.readUTF();
+	if ( chunk == "effect" )
+		str = in.readUTF();
+	return str;
+}
+
+static void checkDegeneratePolygons( const CookedModel& cm, const CookedBody& body, 
+	const String& materialName, const String& name )
+{
+	const Vector3* points = reinterpret_cast<const Vector3*>( body.data.begin()+cm.points );
+	const uint16_t* indices = reinterpret_cast<const uint16_t*>( body.data.begin()+cm.indices );
+	const float* texCoords = cm.texCoordLayers > 0 ? reinterpret_cast<const float*>( body.data.begin()+cm.texCoords[0] ) : 0;
+	const int texCoordSize = cm.texCoordLayers > 0 ? cm.texCoordSizes[0] : 0;
+
+	bool once1 = true;
+	bool once2 = true;
+	for ( int i = 0 ; i < cm.triangles*3 ; i += 3 )
+	{
+		const int n = 3;
+
+		Vector3 v[n];
+		Vector4 texc[n];
+		for ( int k = 0 ; k < n ; ++k )
+		{
+			int ind = indices[i+k];
+			v[k] = points[ind];
+			texc[k] = Vector4(0,0,0,0);
+			for ( int d = 0 ; d < texCoordSize ; ++d )
+				texc[k][d] = texCoords[ind*texCoordSize+d];
+		}
+
+		int j = n-1;
+		for ( int k = 0 ; k < n ; j = k++ )
+		{
+			Vector3 edge = v[k] - v[j];
+			if ( edge.length() < 1e-9f && once1 )
+			{
+				Debug::printlnWarning( "Degenerate polygon {0} in model {1} using material {2}", i/3, name, materialName );
+				once1 = false;
+				break;
+			}
+
+			if ( texCoordSize > 0 )
+			{
+				Vector4 tedge = texc[k] - texc[j];
+				if ( tedge.length() < 1e-9f && once2 )
+				{
+					Debug::printlnWarning( "Degenerate texture polygon {0} in model {1} using material {2}", i/3, name, materialName );
+					once2 = false;
+					break;
+				}
+			}
+		}
+	}
+}
+
+static int cookModel( ChunkInputStream* in, long end, CookedBody& body, 
+	const Vector<String>& materialNames, const String& name )
+{
+	String subname;
+	long subend;
+
+	CookedModel cm;
+	memset( &cm, 0xFF, sizeof(cm) );
+	cm.texCoordLayersRead = 0;
+
+	// read info chunk
+	in->beginChunk( &subname, &subend );
+	if ( subname != "info" )
+		throw IOException( Format("The geometry file model chunk must begin with info subchunk: {0}",name) );
+
+	cm.vertices			= in->readInt();
+	cm.triangles		= in->readInt();
+	cm.weightsPerVertex	= in->readInt();
+	cm.texCoordLayers	= in->readInt();
+	const int vertices	= cm.vertices;
+
+	if ( vertices < 1 )
+		throw IOException( Format("Invalid vertex count ({1}) in geometry file: {0}", name, vertices) );
+	if ( vertices > 65534 )
+		throw IOException( Format("Too many vertices ({1}) in a single batch: {0}", name, vertices) );
+	if ( cm.triangles < 0 )
+		throw IOException( Format("Invalid triangle count ({1}) in geometry file: {0}", name, cm.triangles) );
+	if ( cm.weightsPerVertex < 0 )
+		throw IOException( Format("Invalid per vertex weight count ({1}) in geometry file: {0}", name, cm.weightsPerVertex) );
+	if ( cm.texCoordLayers < 0 || cm.texCoordLayers > COOKED_MAX_LAYERS )
+		throw IOException( Format("Too many texture coordinate layers in {0}", name) );
+
+	for ( int i = 0 ; i < cm.texCoordLayers ; ++i )
+	{
+		cm.texCoordSizes[i] = in->readInt();
+		if ( cm.texCoordSizes[i] < 1 || cm.texCoordSizes[i] > 4 )
+			throw IOException( Format("Invalid texture coordinate layer dimension ({1}) in geometry file: {0}", name, cm.texCoordSizes[i]) );
+	}
+
+	cm.vertexColorDim = 0;
+	if ( in->size() < subend )
+		cm.vertexColorDim = in->readInt();
+	if ( 0 != cm.vertexColorDim && 3 != cm.vertexColorDim && 4 != cm.vertexColorDim )
+		throw IOException( Format( "Invalid vertex color size ({1}) in geometry file: {0}", name, cm.vertexColorDim) );
+
+	cm.tangentSpaceU = 0;
+	if ( in->size() < subend )
+		cm.tangentSpaceU = in->readInt() != 0 ? 1 : 0;
+
+	in->endChunk( subend );
+
+	// read subchunks
+	while ( in->size() < end )
+	{
+		in->beginChunk( &subname, &subend );
+
+		if ( subname == "material" )
+		{
+			cm.material = in->readInt();
+			if ( cm.material < 0 || cm.material >= materialNames.size() )
+				throw IOException( Format("Undefined material (index {1,#}) used in the geometry file: {0}", name, cm.material) );
+		}
+		else if ( subname == "points" )
+		{
+			cm.points = body.reserve( vertices*sizeof(Vector3) );
+			in->readFloatArray( reinterpret_cast<float*>(body.at(cm.points)), vertices*3 );
+		}
+		else if ( subname == "vertexnormalsf" )
+		{
+			cm.normals = body.reserve( vertices*sizeof(Vector3) );
+			in->readFloatArray( reinterpret_cast<float*>(body.at(cm.normals)), vertices*3 );
+		}
+		else if ( subname == "faces" )
+		{
+			int indices = cm.triangles*3;
+			cm.indices = body.reserve( indices*sizeof(uint16_t) );
+			for ( int i = 0 ; i < indices ; ++i )
+			{
+				int ix = in->readInt();
+				if ( ix < 0 || ix >= vertices )
+					throw IOException( Format("Invalid vertex index ({1,#}) in a geometry file: {0}", name, ix) );
+				reinterpret_cast<uint16_t*>( body.at(cm.indices) )[i] = (uint16_t)ix;
+			}
+		}
+		else if ( subname == "vertexcolors" )
+		{
+			if ( cm.vertexColorDim > 0 )
+			{
+				int bytes = vertices*cm.vertexColorDim;
+				cm.colors = body.reserve( bytes );
+				for ( int i = 0 ; i < bytes ; ++i )
+					body.at(cm.colors)[i] = in->readByte();
+			}
+		}
+		else if ( subname == "texcoordlayer" )
+		{
+			int layer = cm.texCoordLayersRead;
+			if ( layer >= cm.texCoordLayers )
+				throw IOException( Format("Too many texture coordinate layers in {0}", name) );
+			int count = vertices*cm.texCoordSizes[layer];
+			cm.texCoords[layer] = body.reserve( count*sizeof(float) );
+			in->readFloatArray( reinterpret_cast<float*>(body.at(cm.texCoords[layer])), count );
+			++cm.texCoordLayersRead;
+		}
+		else if ( subname == "skin" )
+		{
+			// affecting bones
+			int bones = in->readInt();
+			if ( bones < 0 || bones > COOKED_MAX_BONES )
+				throw IOException( Format("Too many bones ({1,#}) in a geometry file: {0}", name, bones) );
+			cm.skinBones = bones;
+			int boneNames[COOKED_MAX_BONES];
+			for ( int i = 0 ; i < bones ; ++i )
+				boneNames[i] = body.addString( in->readString() );
+			cm.skinBoneNames = body.add( boneNames, bones*sizeof(int32_t) );
+
+			// weights, at most COOKED_MAX_BONES per vertex
+			cm.vertexBones = body.reserve( vertices*sizeof(int32_t) );
+			cm.boneWeights = body.data.size();
+			for ( int i = 0 ; i < vertices ; ++i )
+			{
+				int vertexBones = in->readInt();
+				int usedBones = vertexBones < COOKED_MAX_BONES ? vertexBones : COOKED_MAX_BONES;
+				reinterpret_cast<int32_t*>( body.at(cm.vertexBones) )[i] = usedBones > 0 ? usedBones : 0;
+
+				for ( int k = 0 ; k < vertexBones ; ++k )
+				{
+					CookedBoneWeight bw;
+					bw.bone = in->readInt();
+					bw.weight = in->readFloat();
+					if ( bw.bone < 0 || bw.bone >= bones )
+						throw IOException( Format("Invalid bone index ({1,#}) in geometry file: {0}", name, bw.bone) );
+					if ( k < usedBones )
+						body.add( &bw, sizeof(bw) );
+				}
+			}
+		}
+
+		if ( in->size() > subend )
+			throw IOException( Format("Chunk read overflow in model chunk of a geometry file: {0}",name) );
+		in->endChunk( subend );
+	}
+
+	// check subchunk read ok
+	if ( cm.texCoordLayersRead != cm.texCoordLayers )
+		throw IOException( Format("Missing texture coordinate layer subchunk in model chunk of a geometry file: {0}",name) );
+	if ( cm.material < 0 )
+		throw IOException( Format("Missing material subchunk in model chunk of a geometry file: {0}",name) );
+	if ( cm.points < 0 )
+		throw IOException( Format("Missing points subchunk in model chunk of a geometry file: {0}",name) );
+	if ( cm.indices < 0 )
+		throw IOException( Format("Missing faces subchunk in model chunk of a geometry file: {0}",name) );
+	if ( cm.vertexBones < 0 && cm.weightsPerVertex > 0 )
+		throw IOException( Format("Missing skin subchunk in model chunk of a geometry file: {0}",name) );
+	if ( cm.vertexBones < 0 )
+		cm.skinBones = 0;
+
+	checkDegeneratePolygons( cm, body, materialNames[cm.material], name );
+	return body.add( &cm, sizeof(cm) );
+}
+
+static int cookMorphTarget( ChunkInputStream* in, long end, CookedBody& body, const String& name )
+{
+	String subname;
+	long subend;
+
+	// read info chunk
+	in->beginChunk( &subname, &subend );
+	if ( subname != "info" )
+		throw IOException( Format("The geometry file morphtarget chunk must begin with info subchunk: {0}",name) );
+
+	String	chnName	= in->readString();
+	int		type	= in->readInt();
+
+	if ( type != 0 )
+		throw IOException( Format("Invalid morphtarget type ({1}) in geometry file: {0}", name, type) );
+	if ( chnName == "" )
+		throw IOException( Format("Invalid morphtarget channel name ({1}) in geometry file: {0}", name, chnName) );
+
+	in->endChunk( subend );
+
+	CookedMorphTarget ct;
+	ct.name = body.addString( chnName );
+	ct.materialName = -1;
+	ct.deltas = -1;
+	ct.scale = 0.f;
+	ct.deltaData = -1;
+
+	// read subchunks
+	while ( in->size() < end )
+	{
+		in->beginChunk( &subname, &subend );
+
+		if ( subname == "material" )
+		{
+			in->readInt(); // skip materials -- morph targets are not rendered directly
+			ct.materialName = body.addString( in->readString() );
+		}
+		else if ( subname == "deltas" )
+		{
+			// encode deltas as MorphTarget::addDelta does
+			int count = in->readInt();
+			if ( count < 0 )
+				throw IOException( Format("Invalid morphtarget delta count ({1}) in geometry file: {0}", name, count) );
+			ct.deltas = count;
+			ct.scale = in->readFloat();
+			ct.deltaData = body.reserve( count*sizeof(MorphTarget::Delta) );
+
+			const float scale = ct.scale*(1.f/16383.f);
+			const float inverseScale = 1.f / scale;
+			for ( int i = 0 ; i < count ; ++i )
+			{
+				int vertexIndex = in->readInt();
+				float dx = in->readFloat();
+				float dy = in->readFloat();
+				float dz = in->readFloat();
+				if ( vertexIndex < 0 || vertexIndex >= 32768 )
+					throw IOException( Format("Invalid morphtarget vertex index ({1}) in geometry file: {0}", name, vertexIndex) );
+
+				MorphTarget::Delta d;
+				d.vertexIndex = (uint16_t)vertexIndex;
+				d.dx = (uint16_t)(dx*inverseScale + 16384.f);
+				d.dy = (uint16_t)(dy*inverseScale + 16384.f);
+				d.dz = (uint16_t)(dz*inverseScale + 16384.f);
+				reinterpret_cast<MorphTarget::Delta*>( body.at(ct.deltaData) )[i] = d;
+			}
+		}
+
+		if ( in->size() > subend )
+			throw IOException( Format("Chunk read overflow in morphtarget chunk of a geometry file: {0}",name) );
+		in->endChunk( subend );
+	}
+
+	// check subchunk read ok
+	if ( ct.deltas < 0 )
+		throw IOException( Format("Missing deltas subchunk in morphtarget chunk of a geometry file: {0}",name) );
+	if ( ct.materialName < 0 )
+		throw IOException( Format("Missing material subchunk in morphtarget chunk of a geometry file: {0}",name) );
+
+	return body.add( &ct, sizeof(ct) );
+}
+
+//-----------------------------------------------------------------------------
+
+void ModelFileCooker::cook( InputStream* in, OutputStream* out, const String& name )
+{
+	assert( in );
+	assert( out );
+
+	ChunkInputStream reader( in );
+	String chunk;
+	long end;
+	reader.beginChunk( &chunk, &end );
+	if ( chunk != "gm" )
+		throw IOException( Format("Invalid header in geometry file: {0}",name) );
+
+	int ver = reader.readInt();
+	if ( ver != GM_FILE_VER )
+		throw IOException( Format("Invalid geometry file version (expected {1,x}, got {2,x}): {0}", name, GM_FILE_VER, ver) );
+
+	CookedBody body;
+	int header = body.reserve( sizeof(CookedModelHeader) );
+	Vector<CookedSection> sections( Allocator<CookedSection>(__FILE__,__LINE__) );
+	Vector<String> materialNames( Allocator<String>(__FILE__,__LINE__) );
+
+	while ( reader.size() < end )
+	{
+		String subname;
+		long subend;
+		reader.beginChunk( &subname, &subend );
+
+		CookedSection section;
+		section.name = body.addString( subname );
+
+		if ( subname == "model" )
+		{
+			section.type = COOKED_MODEL;
+			section.offset = cookModel( &reader, subend, body, materialNames, name );
+			section.size = sizeof(CookedModel);
+		}
+		else if ( subname == "morphtarget" )
+		{
+			section.type = COOKED_MORPHTARGET;
+			section.offset = cookMorphTarget( &reader, subend, body, name );
+			section.size = sizeof(CookedMorphTarget);
+		}
+		else
+		{
+			section.type = COOKED_CHUNK;
+			section.size = subend - reader.size();
+			section.offset = cookChunk( &reader, subend, body );
+			if ( subname == "material" || subname == "effect" )
+				materialNames.add( getMaterialName(subname, body.at(section.offset), section.size) );
+		}
+		sections.add( section );
+
+		reader.endChunk( subend );
+	}
+	reader.endChunk( end );
+
+	int sectionTable = body.add( sections.begin(), sections.size()*sizeof(CookedSection) );
+	CookedModelHeader* h = reinterpret_cast<CookedModelHeader*>( body.at(header) );
+	h->byteOrder = COOKED_BYTE_ORDER;
+	h->version = COOKED_VERSION;
+	h->sourceVersion = GM_FILE_VER;
+	h->bodySize = body.data.size();
+	h->sections = sections.size();
+	h->sectionTable = sectionTable;
+
+	out->write( COOKED_MAGIC, sizeof(COOKED_MAGIC) );
+	out->write( body.data.begin(), body.data.size() );
+}
+
+bool ModelFileCooker::isCooked( const void* data, int size )
+{
+	return size >= (int)sizeof(COOKED_MAGIC) && 
+		!memcmp( data, COOKED_MAGIC, sizeof(COOKED_MAGIC) );
+}
+
+
+} // sgu
@@ -0,0 +1,50 @@
+#ifndef _SGU_MODELFILECOOKER_H
+#define _SGU_MODELFILECOOKER_H
+
+
+namespace io {
+	class InputStream;
+	class OutputStream;}
+
+namespace lang {
+	class String;}
+
+
+namespace sgu
+{
+
+
+/** 
+ * Converts geometry files (.gm) to cooked form which ModelFile
+ * can load without parsing. Vertex, index, skin and morph target data
+ * is stored in the final in-memory layout and used in place by the loader,
+ * other chunks (materials, effects, morphers, etc.) are stored as is.
+ * Cooked files use native byte order of the cooking platform.
+ * Source data is validated while cooking so ModelFile needs to perform
+ * only range checks when loading.
+ */
+class ModelFileCooker
+{
+public:
+	/** 
+	 * Reads geometry file and writes it in cooked form.
+	 * @param in Geometry file input stream.
+	 * @param out Cooked geometry file output stream.
+	 * @param name Name of the geometry file used in error messages.
+	 * @exception IOException
+	 */
+	static void		cook( io::InputStream* in, io::OutputStream* out, const lang::String& name );
+
+	/** 
+	 * Returns true if the data begins with cooked geometry file header.
+	 * @param data First bytes of the file.
+	 * @param size Number of bytes available.
+	 */
+	static bool		isCooked( const void* data, int size );
+};
+
+
+} // sgu
+
+
+#endif // _SGU_MODELFILECOOKER_H
@@ -42,7 +42,7 @@ void NodeGroupSet::addGroup( const String& group, Node* root )
 Node* NodeGroupSet::getGroup( const String& group )
 {
 	//dev::Profile pr( "NodeGroupSet.getNode" );
-	NodeSetType* grp = m_groups[group];
+	NodeSetType* grp = findGroup( group );
 	if ( grp )
 	{
 		for ( NodeSetIteratorType it = grp->begin() ; it != grp->end() ; ++it )
@@ -57,17 +57,26 @@ Node* NodeGroupSet::getGroup( const String& group )
 Node* NodeGroupSet::getNode( const String& group, const String& name )
 {
 	//dev::Profile pr( "NodeGroupSet.getNode" );
-	NodeSetType* grp = m_groups[group];
-	if ( grp )
-		return (*grp)[name];
+	NodeSetType* grp = findGroup( group );
+	if ( grp && grp->containsKey(name) )
+		return grp->get( name );
 	return 0;
 }
 
 bool NodeGroupSet::hasGroup( const String& group ) const
 {
-	NodeSetType* grp = m_groups[group];
+	NodeSetType* grp = findGroup( group );
 	return 0 != grp;
 }
 
+NodeGroupSet::NodeSetType* NodeGroupSet::findGroup( const String& group ) const
+{
+	// Hashtable inserts missing keys on lookup, so check existence first
+	// to keep lookups free of side effects
+	if ( m_groups.containsKey(group) )
+		return m_groups.get( group );
+	return 0;
+}
+
 
 } // sgu
@@ -17,6 +17,8 @@ namespace sgu
 
 /** 
  * Set of (animated) node groups. 
+ * Lookups do not modify the set, so they can be made 
+ * from multiple threads as long as no groups are added at the same time.
  * @author Jani Kajala (jani.kajala@helsinki.fi)
  */
 class NodeGroupSet :
@@ -50,6 +52,8 @@ private:
 
 	util::Hashtable< lang::String, P(NodeSetType) > m_groups;
 
+	NodeSetType*	findGroup( const lang::String& group ) const;
+
 	NodeGroupSet( const NodeGroupSet& );
 	NodeGroupSet& operator=( const NodeGroupSet& );
 };
@@ -403,17 +403,14 @@ public:
 	Vector3 readVector3( ChunkInputStream* in )
 	{
 		Vector3 v;
-		for ( int i = 0 ; i < 3 ; ++i )
-			v[i] = in->readFloat();
+		in->readFloatArray( &v.x, 3 );
 		return v;
 	}
 
 	Matrix4x4 readMatrix4x4( ChunkInputStream* in )
 	{
 		Matrix4x4 m;
-		for ( int j = 0 ; j < 4 ; ++j )
-			for ( int i = 0 ; i < 4 ; ++i )
-				m(j,i) = in->readFloat();
+		in->readFloatArray( &m(0,0), 16 );
 		return m;
 	}
 
@@ -438,16 +435,16 @@ public:
 		P(TriangleList) tri = new TriangleList( verts, vf );
 		VertexLock<TriangleList> trilock( tri, TriangleList::LOCK_WRITE );
 
-		Vector3 v;
+		// positions
+		Vector<Vector3> v( Allocator<Vector3>(__FILE__,__LINE__) );
+		v.setSize( verts );
+		in->readFloatArray( &v[0].x, verts*3 );
 		for ( int i = 0 ; i < verts ; ++i )
 		{
-			// position
-			for ( int k = 0 ; k < 3 ; ++k )
-				v[k] = in->readFloat();
-			if ( !v.finite() )
+			if ( !v[i].finite() )
 				throw IOException( Format( "Invalid triangle list data in {0}", in->toString() ) );
-			tri->setVertexPositions( i, &v, 1 );
 		}
+		tri->setVertexPositions( 0, v.begin(), verts );
 
 		return tri;
 	}
@@ -455,8 +452,7 @@ public:
 	Vector4 readVector4( ChunkInputStream* in )
 	{
 		Vector4 v;
-		for ( int i = 0 ; i < 4 ; ++i )
-			v[i] = in->readFloat();
+		in->readFloatArray( &v.x, 4 );
 		return v;
 	}
 
@@ -1,9 +1,14 @@
 #include "SceneManager.h"
+#include "PrefetchArchive.h"
 #include <sg/Node.h>
 #include <io/InputStreamArchive.h>
 #include <sgu/SceneFile.h>
+#include <sgu/AssetLoader.h>
 #include <sgu/ModelFileCache.h>
+#include <lang/Debug.h>
+#include <lang/Throwable.h>
 #include <util/Hashtable.h>
+#include <assert.h>
 #include "config.h"
 
 //-----------------------------------------------------------------------------
@@ -23,20 +28,56 @@ class SceneManager::SceneManagerImpl :
 	public Object
 {
 public:
-	P(InputStreamArchive)		arch;
-	P(ModelFileCache)			modelCache;
-	Hashtable<String,P(Node)>	nodes;
+	P(InputStreamArchive)				arch;
+	P(ModelFileCache)					modelCache;
+	Hashtable<String,P(Node)>			nodes;
+	Vector< P(SceneRequest) >			pending;
+	Hashtable<String,P(SceneRequest)>	requests;
 
 	SceneManagerImpl() :
 		arch(0),
 		modelCache(0),
-		nodes( Allocator< HashtablePair<String,P(Node)> >(__FILE__,__LINE__) )
+		nodes( Allocator< HashtablePair<String,P(Node)> >(__FILE__,__LINE__) ),
+		pending( Allocator< P(SceneRequest) >(__FILE__,__LINE__) ),
+		requests( Allocator< HashtablePair<String,P(SceneRequest)> >(__FILE__,__LINE__) )
 	{
 	}
 };
 
 //-----------------------------------------------------------------------------
 
+SceneRequest::SceneRequest( const String& name, int flags ) :
+	m_asset( 0 ),
+	m_name( name ),
+	m_flags( flags ),
+	m_scene( 0 ),
+	m_ready( false ),
+	m_failed( false )
+{
+}
+
+bool SceneRequest::ready() const
+{
+	return m_ready;
+}
+
+bool SceneRequest::failed() const
+{
+	return m_failed;
+}
+
+Node* SceneRequest::scene() const
+{
+	return m_scene;
+}
+
+const String& SceneRequest::name() const
+{
+	return m_name;
+}
+
+//-----------------------------------------------------------------------------
+
 SceneManager::SceneManager( InputStreamArchive* arch )
 {
 	m_this = new SceneManagerImpl;
@@ -52,6 +93,17 @@ Node* SceneManager::getScene( const String& file, int flags )
 {
 	P(Node) node = m_this->nodes[file];
 	if ( !node )
+	{
+		// finish pending background request first
+		P(SceneRequest) req = m_this->requests[file];
+		if ( req )
+		{
+			loader()->wait( req->m_asset );
+			finalize( req );
+			node = m_this->nodes[file];
+		}
+	}
+	if ( !node )
 	{
 		SceneFile playerSceneFile( file, m_this->modelCache, m_this->arch, flags );
 		node = playerSceneFile.scene();
@@ -60,6 +112,110 @@ Node* SceneManager::getScene( const String& file, int flags )
 	return node;
 }
 
+SceneRequest* SceneManager::requestScene( const String& file, int flags, int priority )
+{
+	P(SceneRequest) req = m_this->requests[file];
+	if ( !req )
+	{
+		req = new SceneRequest( file, flags );
+
+		P(Node) node = m_this->nodes[file];
+		if ( node )
+		{
+			req->m_scene = node;
+			req->m_ready = true;
+		}
+		else
+		{
+			req->m_asset = loader()->request( file, priority );
+			m_this->requests[file] = req;
+			m_this->pending.add( req );
+		}
+	}
+	else
+	{
+		// raises priority of the queued request
+		loader()->request( file, priority );
+	}
+	return req;
+}
+
+ModelFileRequest* SceneManager::requestModelFile( const String& name,
+	const String* boneNames, int bones, const pix::Colorf& ambient, 
+	int loadFlags, int priority )
+{
+	return m_this->modelCache->requestModel( name, boneNames, bones, ambient, loadFlags, priority );
+}
+
+int SceneManager::finalize( int maxItems )
+{
+	// scenes may use the model files so create them first
+	int count = m_this->modelCache->finalize( maxItems );
+
+	for ( int i = 0 ; i < m_this->pending.size() && count != maxItems ; )
+	{
+		P(SceneRequest) req = m_this->pending[i];
+		if ( req->m_asset->ready() )
+		{
+			finalize( req );
+			++count;
+		}
+		else
+		{
+			++i;
+		}
+	}
+	return count;
+}
+
+void SceneManager::finalize( SceneRequest* req )
+{
+	assert( req->m_asset && req->m_asset->ready() );
+
+	if ( req->m_asset->failed() )
+	{
+		req->m_failed = true;
+	}
+	else
+	{
+		try
+		{
+			P(Node) node = m_this->nodes[req->m_name];
+			if ( !node )
+			{
+				P(PrefetchArchive) arch = new PrefetchArchive( m_this->arch, req->m_asset );
+				SceneFile sceneFile( req->m_name, m_this->modelCache, arch, req->m_flags );
+				arch->close();
+				node = sceneFile.scene();
+				m_this->nodes[req->m_name] = node;
+			}
+			req->m_scene = node;
+		}
+		catch ( Throwable& e )
+		{
+			Debug::printlnError( "sgu.SceneManager: Failed to create scene {0}: {1}", req->m_name, e.getMessage().format() );
+			req->m_failed = true;
+		}
+	}
+
+	req->m_asset = 0;
+	req->m_ready = true;
+	m_this->requests.remove( req->m_name );
+	for ( int i = 0 ; i < m_this->pending.size() ; ++i )
+	{
+		if ( m_this->pending[i] == req )
+		{
+			m_this->pending.remove( i );
+			break;
+		}
+	}
+}
+
+int SceneManager::pendingRequests() const
+{
+	return m_this->pending.size() + m_this->modelCache->pendingRequests();
+}
+
 ModelFile* SceneManager::getModelFile( const String& file,
 	const lang::String* boneNames, int bones,
 	const pix::Colorf& ambient, int loadFlags )
@@ -67,5 +223,10 @@ ModelFile* SceneManager::getModelFile( const String& file,
 	return m_this->modelCache->getByName( file, boneNames, bones, ambient, loadFlags );
 }
 
+AssetLoader* SceneManager::loader()
+{
+	return m_this->modelCache->loader();
+}
+
 
 } // sgu
@@ -4,6 +4,7 @@
 
 #include <sgu/SceneFile.h>
 #include <sgu/ModelFile.h>
+#include <sgu/ModelFileCache.h>
 
 
 namespace io {
@@ -24,6 +25,47 @@ namespace sgu
 
 
 class ModelFile;
+class AssetLoader;
+class AssetRequest;
+class ModelFileCache;
+class SceneManager;
+
+
+/**
+ * Handle to a scene being loaded in the background.
+ * See SceneManager::requestScene.
+ */
+class SceneRequest :
+	public lang::Object
+{
+public:
+	/** Returns true if the scene has been finalized (either created or failed). */
+	bool				ready() const;
+
+	/** Returns true if the scene could not be loaded. */
+	bool				failed() const;
+
+	/** Returns loaded scene or 0 if not ready or failed. */
+	sg::Node*			scene() const;
+
+	/** Returns name of the scene file. */
+	const lang::String&	name() const;
+
+private:
+	friend class SceneManager;
+
+	P(AssetRequest)		m_asset;
+	lang::String		m_name;
+	int					m_flags;
+	P(sg::Node)			m_scene;
+	bool				m_ready;
+	bool				m_failed;
+
+	SceneRequest( const lang::String& name, int flags );
+
+	SceneRequest( const SceneRequest& );
+	SceneRequest& operator=( const SceneRequest& );
+};
 
 
 /** 
@@ -43,6 +85,38 @@ public:
 	/** Loads scene. */
 	sg::Node*	getScene( const lang::String& file, int flags=SceneFile::LOAD_ALL );
 
+	/** 
+	 * Requests loading of scene in the background.
+	 * Scene file data is read from the archive by loader threads,
+	 * the scene itself is created by finalize().
+	 * If the scene has already been loaded then returned request is ready immediately.
+	 * @param priority Requests with higher priority are loaded first.
+	 */
+	SceneRequest*	requestScene( const lang::String& file, int flags=SceneFile::LOAD_ALL, int priority=0 );
+
+	/**
+	 * Requests loading of model file in the background.
+	 * @see ModelFileCache::requestModel
+	 */
+	ModelFileRequest*	requestModelFile( const lang::String& name,
+							const lang::String* boneNames, int bones,
+							const pix::Colorf& ambient, int loadFlags=ModelFile::LOAD_ALL,
+							int priority=0 );
+
+	/** 
+	 * Creates model files and scenes of the requests which have been 
+	 * loaded by the background threads. Must be called from the main thread.
+	 * @param maxItems Maximum number of model files and scenes to create, -1 if no limit.
+	 * @return Number of requests finalized.
+	 */
+	int			finalize( int maxItems=-1 );
+
+	/** Returns number of model file and scene requests waiting to be finalized. */
+	int			pendingRequests() const;
+
+	/** Returns background loader used by the manager. */
+	AssetLoader*	loader();
+
 	/** 
 	 * Gets model file by name. 
 	 * @param name Name of the model file.
@@ -59,6 +133,8 @@ private:
 	class SceneManagerImpl;
 	P(SceneManagerImpl) m_this;
 
+	void	finalize( SceneRequest* req );
+
 	SceneManager( const SceneManager& );
 	SceneManager& operator=( const SceneManager& );
 };
@@ -7,13 +7,16 @@
 #include <sg/ShadowShader.h>
 #include <sg/VertexFormat.h>
 #include <sg/TriangleList.h>
+#include <util/Vector.h>
 #include <math/Vector4.h>
+#include <math/Matrix4x4.h>
 #include "config.h"
 
 //-----------------------------------------------------------------------------
 
 using namespace sg;
 using namespace pix;
+using namespace util;
 using namespace math;
 
 //-----------------------------------------------------------------------------
@@ -144,5 +147,54 @@ void ShadowUtil::setShadowRenderPass( sg::Node* root, int passShadow )
 	}
 }
 
+void ShadowUtil::buildDynamicShadows( sg::Node* root, int threads, 
+	Vector<ShadowVolume::Statistics>* threadStatistics )
+{
+	Vector<ShadowVolume*> shadows( Allocator<ShadowVolume*>(__FILE__,__LINE__) );
+	Vector<int> tmOffsets( Allocator<int>(__FILE__,__LINE__) );
+	Vector<int> tmCounts( Allocator<int>(__FILE__,__LINE__) );
+	Vector<Matrix4x4> tms( Allocator<Matrix4x4>(__FILE__,__LINE__) );
+
+	// collect shadows and their world transforms like Mesh::render
+	for ( Node* node = root ; node ; node = node->nextInHierarchy() )
+	{
+		Mesh* mesh = dynamic_cast<Mesh*>( node );
+		if ( mesh )
+		{
+			for ( int i = 0 ; i < mesh->primitives() ; ++i )
+			{
+				ShadowVolume* shadow = dynamic_cast<ShadowVolume*>( mesh->getPrimitive(i) );
+				if ( shadow && shadow->dynamicShadow() )
+				{
+					const int* usedBoneArray = shadow->usedBoneArray();
+					int usedBones = shadow->usedBones();
+					shadows.add( shadow );
+					tmOffsets.add( tms.size() );
+					tmCounts.add( shadow->buildTransforms() );
+
+					if ( 0 == usedBones )
+						tms.add( mesh->worldTransform() );
+					for ( int k = 0 ; k < usedBones ; ++k )
+					{
+						int ix = usedBoneArray[k];
+						assert( ix >= 0 && ix <= mesh->bones() );
+						if ( 0 == ix )
+							tms.add( mesh->worldTransform() );
+						else
+							tms.add( mesh->getBone(ix-1)->worldTransform() * mesh->getBoneInverseRestTransform(ix-1) );
+					}
+				}
+			}
+		}
+	}
+
+	Vector<const Matrix4x4*> tmPtrs( Allocator<const Matrix4x4*>(__FILE__,__LINE__) );
+	tmPtrs.setSize( shadows.size() );
+	for ( int i = 0 ; i < shadows.size() ; ++i )
+		tmPtrs[i] = tms.begin() + tmOffsets[i];
+
+	ShadowVolume::buildShadows( shadows.begin(), tmPtrs.begin(), tmCounts.begin(), shadows.size(), threads, threadStatistics );
+}
+
 
 } // sgu
@@ -3,6 +3,7 @@
 
 
 #include <sg/Primitive.h>
+#include <sg/ShadowVolume.h>
 #include <pix/Color.h>
 
 
@@ -58,6 +59,17 @@ public:
 	 * @param passShadow Rendering pass for shadow volumes.
 	 */
 	static void		setShadowRenderPass( sg::Node* root, int passShadow );
+
+	/**
+	 * Builds all dynamic shadow volumes in hierarchy in parallel.
+	 * Call before rendering the scene, rendering then only uploads
+	 * the built shadow geometry to the device.
+	 * @param threads Number of threads. 0 uses one thread per processor.
+	 * @param threadStatistics [out] If not 0, receives build statistics of each used thread.
+	 * @see ShadowVolume::buildShadows
+	 */
+	static void		buildDynamicShadows( sg::Node* root, int threads=0,
+						util::Vector<sg::ShadowVolume::Statistics>* threadStatistics=0 );
 };
 
 
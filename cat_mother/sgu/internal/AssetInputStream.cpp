@@ -0,0 +1,73 @@
+#include "AssetInputStream.h"
+#include <sgu/AssetLoader.h>
+#include <memory.h>
+#include "config.h"
+
+//-----------------------------------------------------------------------------
+
+using namespace lang;
+
+//-----------------------------------------------------------------------------
+
+namespace sgu
+{
+
+
+AssetInputStream::AssetInputStream( AssetRequest* request ) :
+	m_request( request ),
+	m_data( reinterpret_cast<const char*>(request->data()) ),
+	m_ptr( 0 ),
+	m_size( request->size() ),
+	m_mark( 0 )
+{
+}
+
+long AssetInputStream::read( void* data, long size )
+{
+	long left = m_size - m_ptr;
+	if ( size > left )
+		size = left;
+
+	memcpy( data, m_data+m_ptr, size );
+	m_ptr += size;
+	return size;
+}
+
+void AssetInputStream::mark( int /*readlimit*/ )
+{
+	m_mark = m_ptr;
+}
+
+void AssetInputStream::reset()
+{
+	m_ptr = m_mark;
+}
+
+bool AssetInputStream::markSupported() const
+{
+	return true;
+}
+
+long AssetInputStream::available() const
+{
+	return m_size - m_ptr;
+}
+
+long AssetInputStream::readDirect( const void** data, long size )
+{
+	long left = m_size - m_ptr;
+	if ( size > left )
+		size = left;
+
+	*data = m_data+m_ptr;
+	m_ptr += size;
+	return size;
+}
+
+String AssetInputStream::toString() const
+{
+	return m_request->name();
+}
+
+
+} // sgu
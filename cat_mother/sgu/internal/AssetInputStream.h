@@ -0,0 +1,49 @@
+#ifndef _SGU_ASSETINPUTSTREAM_H
+#define _SGU_ASSETINPUTSTREAM_H
+
+
+#include <io/InputStream.h>
+#include <lang/String.h>
+
+
+namespace sgu
+{
+
+
+class AssetRequest;
+
+
+/**
+ * Input stream reading data loaded by AssetLoader. 
+ * Keeps reference to the request.
+ */
+class AssetInputStream :
+	public io::InputStream
+{
+public:
+	explicit AssetInputStream( AssetRequest* request );
+
+	long			read( void* data, long size );
+	void			mark( int readlimit );
+	void			reset();
+	bool			markSupported() const;
+	long			available() const;
+	long			readDirect( const void** data, long size );
+	lang::String	toString() const;
+
+private:
+	P(AssetRequest)		m_request;
+	const char*			m_data;
+	long				m_ptr;
+	long				m_size;
+	long				m_mark;
+
+	AssetInputStream( const AssetInputStream& );
+	AssetInputStream& operator=( const AssetInputStream& );
+};
+
+
+} // sgu
+
+
+#endif // _SGU_ASSETINPUTSTREAM_H
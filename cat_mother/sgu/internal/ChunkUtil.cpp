@@ -37,8 +37,7 @@ void ChunkUtil::readAnim( ChunkInputStream* in, Interpolator* anim, const String
 		float time = in->readFloat();
 		float* value = anim->getTempBuffer( channels );
 		
-		for ( int k = 0 ; k < channels ; ++k )
-			value[k] = in->readFloat();
+		in->readFloatArray( value, channels );
 
 		anim->setKeyTime( i, time );
 		anim->setKeyValue( i, value, channels );
@@ -0,0 +1,135 @@
+#ifndef _SGU_COOKEDMODELFORMAT_H
+#define _SGU_COOKEDMODELFORMAT_H
+
+
+#include <stdint.h>
+
+
+/** Version of geometry files (.gm). */
+#define GM_FILE_VER 0x100
+
+
+namespace sgu
+{
+
+
+/**
+ * Layout of cooked geometry files written by ModelFileCooker and 
+ * read by ModelFile. File begins with 4 magic bytes 'GMC1' which are
+ * followed by the body. All integers and floats in the body are 32-bit
+ * in native byte order, offsets are relative to the beginning of the body
+ * and all data is aligned to 4 bytes, so the body can be used in place.
+ *
+ * Body begins with CookedModelHeader which refers to a table
+ * of CookedSection records. Sections are in the same order as 
+ * the chunks of the source file:
+ *   COOKED_CHUNK sections contain source chunk data as is (materials, effects, etc.)
+ *   COOKED_MODEL sections contain CookedModel
+ *   COOKED_MORPHTARGET sections contain CookedMorphTarget
+ *
+ * Strings are stored as byte count followed by UTF-8 bytes.
+ * Unused offsets are -1.
+ */
+enum CookedModelFormat
+{
+	COOKED_MAGIC_SIZE		= 4,
+	COOKED_VERSION			= 1,
+	COOKED_BYTE_ORDER		= 0x01020304,
+	COOKED_MAX_LAYERS		= 8,
+	COOKED_MAX_BONES		= 256,
+	COOKED_CHUNK			= 0,
+	COOKED_MODEL			= 1,
+	COOKED_MORPHTARGET		= 2
+};
+
+/** Magic bytes in the beginning of cooked files. */
+const uint8_t COOKED_MAGIC[COOKED_MAGIC_SIZE] = {'G','M','C','1'};
+
+/** Cooked file body header. */
+struct CookedModelHeader
+{
+	/** COOKED_BYTE_ORDER in the byte order of the cooking platform. */
+	int32_t		byteOrder;
+	/** COOKED_VERSION. */
+	int32_t		version;
+	/** Version of the source geometry file. */
+	int32_t		sourceVersion;
+	/** Size of the body in bytes. */
+	int32_t		bodySize;
+	/** Number of sections. */
+	int32_t		sections;
+	/** Offset of CookedSection table. */
+	int32_t		sectionTable;
+};
+
+/** Cooked file section. */
+struct CookedSection
+{
+	/** COOKED_CHUNK, COOKED_MODEL or COOKED_MORPHTARGET. */
+	int32_t		type;
+	/** Offset of source chunk name string. */
+	int32_t		name;
+	/** Offset of section data. */
+	int32_t		offset;
+	/** Size of section data in bytes. */
+	int32_t		size;
+};
+
+/** Cooked model with vertex data in final form. */
+struct CookedModel
+{
+	int32_t		vertices;
+	int32_t		triangles;
+	int32_t		weightsPerVertex;
+	int32_t		texCoordLayers;
+	int32_t		texCoordSizes[COOKED_MAX_LAYERS];
+	/** Number of texture coordinate layers present in the source file. */
+	int32_t		texCoordLayersRead;
+	/** 0, 3 or 4. */
+	int32_t		vertexColorDim;
+	int32_t		tangentSpaceU;
+	/** Material index. */
+	int32_t		material;
+	/** float[3] per vertex. */
+	int32_t		points;
+	/** float[3] per vertex or -1 if normals need to be computed. */
+	int32_t		normals;
+	/** float[texCoordSizes[i]] per vertex. */
+	int32_t		texCoords[COOKED_MAX_LAYERS];
+	/** uint8_t[vertexColorDim] per vertex. */
+	int32_t		colors;
+	/** uint16_t[3] per triangle. */
+	int32_t		indices;
+	/** Number of bones in skin. */
+	int32_t		skinBones;
+	/** Offsets of bone name strings. */
+	int32_t		skinBoneNames;
+	/** Number of bones affecting each vertex. */
+	int32_t		vertexBones;
+	/** CookedBoneWeight list of all vertices. */
+	int32_t		boneWeights;
+};
+
+/** Bone weight in cooked model skin. */
+struct CookedBoneWeight
+{
+	int32_t		bone;
+	float		weight;
+};
+
+/** Cooked morph target with deltas in sg::MorphTarget::Delta format. */
+struct CookedMorphTarget
+{
+	int32_t		name;
+	int32_t		materialName;
+	int32_t		deltas;
+	float		scale;
+	/** sg::MorphTarget::Delta list. */
+	int32_t		deltaData;
+};
+
+
+} // sgu
+
+
+#endif // _SGU_COOKEDMODELFORMAT_H
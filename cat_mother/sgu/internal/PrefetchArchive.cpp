@@ -0,0 +1,73 @@
+#include "PrefetchArchive.h"
+#include <sgu/AssetLoader.h>
+#include <io/InputStream.h>
+#include <lang/String.h>
+#include <assert.h>
+#include "config.h"
+
+//-----------------------------------------------------------------------------
+
+using namespace io;
+using namespace lang;
+
+//-----------------------------------------------------------------------------
+
+namespace sgu
+{
+
+
+PrefetchArchive::PrefetchArchive( InputStreamArchive* arch, AssetRequest* request ) :
+	m_arch( arch ),
+	m_request( request )
+{
+	assert( arch );
+	assert( request && request->ready() );
+}
+
+PrefetchArchive::~PrefetchArchive()
+{
+}
+
+void PrefetchArchive::close()
+{
+	m_request = 0;
+	m_arch = 0;
+}
+
+InputStream* PrefetchArchive::getInputStream( const String& name )
+{
+	assert( m_arch );
+
+	if ( m_request && !m_request->failed() && 
+		name.toLowerCase() == m_request->name().toLowerCase() )
+		return m_request->getInputStream();
+
+	return m_arch->getInputStream( name );
+}
+
+InputStream* PrefetchArchive::getInputStream( int index )
+{
+	assert( m_arch );
+	return m_arch->getInputStream( index );
+}
+
+String PrefetchArchive::getEntry( int index ) const
+{
+	assert( m_arch );
+	return m_arch->getEntry( index );
+}
+
+int PrefetchArchive::size() const
+{
+	assert( m_arch );
+	return m_arch->size();
+}
+
+String PrefetchArchive::toString() const
+{
+	assert( m_arch );
+	return m_arch->toString();
+}
+
+
+} // sgu
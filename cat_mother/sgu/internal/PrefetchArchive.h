@@ -0,0 +1,50 @@
+#ifndef _SGU_PREFETCHARCHIVE_H
+#define _SGU_PREFETCHARCHIVE_H
+
+
+#include <io/InputStreamArchive.h>
+
+
+namespace sgu
+{
+
+
+class AssetRequest;
+
+
+/**
+ * Archive which serves an entry loaded by AssetLoader from memory 
+ * and forwards all other requests to the source archive.
+ */
+class PrefetchArchive :
+	public io::InputStreamArchive
+{
+public:
+	/** Keeps references to the archive and to the loaded request. */
+	PrefetchArchive( io::InputStreamArchive* arch, AssetRequest* request );
+
+	///
+	~PrefetchArchive();
+
+	/** Releases the references, does not close the source archive. */
+	void				close();
+
+	io::InputStream*	getInputStream( const lang::String& name );
+	io::InputStream*	getInputStream( int index );
+	lang::String		getEntry( int index ) const;
+	int					size() const;
+	lang::String		toString() const;
+
+private:
+	P(io::InputStreamArchive)	m_arch;
+	P(AssetRequest)				m_request;
+
+	PrefetchArchive( const PrefetchArchive& );
+	PrefetchArchive& operator=( const PrefetchArchive& );
+};
+
+
+} // sgu
+
+
+#endif // _SGU_PREFETCHARCHIVE_H
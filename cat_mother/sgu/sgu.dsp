@@ -85,6 +85,10 @@ LIB32=link.exe -lib
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=.\AssetLoader.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\CameraUtil.cpp
 # End Source File
 # Begin Source File
@@ -113,6 +117,10 @@ SOURCE=.\ModelFileCache.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\ModelFileCooker.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\NodeGroupSet.cpp
 # End Source File
 # Begin Source File
@@ -141,6 +149,10 @@ SOURCE=.\TextureUtil.cpp
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=.\AssetLoader.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\CameraUtil.h
 # End Source File
 # Begin Source File
@@ -169,6 +181,10 @@ SOURCE=.\ModelFileCache.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\ModelFileCooker.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\NodeGroupSet.h
 # End Source File
 # Begin Source File
@@ -197,6 +213,14 @@ SOURCE=.\TextureUtil.h
 # PROP Default_Filter ""
 # Begin Source File
 
+SOURCE=.\internal\AssetInputStream.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\internal\AssetInputStream.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\internal\ChunkUtil.cpp
 # End Source File
 # Begin Source File
@@ -205,8 +229,20 @@ SOURCE=.\internal\ChunkUtil.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\internal\CookedModelFormat.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\internal\config.h
 # End Source File
+# Begin Source File
+
+SOURCE=.\internal\PrefetchArchive.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\internal\PrefetchArchive.h
+# End Source File
 # End Group
 # Begin Group "docs"
 
@@ -389,6 +389,9 @@ void CSgviewerView::draw()
 	int processedObjects = 0;
 	int renderedLights = 0;
 	int renderedObjects = 0;
+	int culledObjects = 0;
+	int cullTests = 0;
+	int visibilityChecks = 0;
 	int renderedPrimitives = 0;
 	int	renderedTriangles = 0;
 	int totalPrimitives = 0;
@@ -629,6 +632,9 @@ void CSgviewerView::draw()
 				processedObjects = camera->processedObjects();
 				renderedLights = camera->renderedLights();
 				renderedObjects = camera->renderedObjects();
+				culledObjects = camera->culledObjects();
+				cullTests = camera->cullTests();
+				visibilityChecks = camera->visibilityChecks();
 				renderedPrimitives = camera->renderedPrimitives();
 				renderedTriangles = camera->renderedTriangles();
 				
@@ -690,6 +696,7 @@ void CSgviewerView::draw()
 			font->drawText( x, y, Format("tri {0,#} / {1,#}", renderedTriangles, totalTriangles).format(), 0, &y );
 			font->drawText( x, y, Format("pri {0,#} / {1,#}", renderedPrimitives, totalPrimitives).format(), 0, &y );
 			font->drawText( x, y, Format("obj {0,#} / {1,#}", renderedObjects, processedObjects).format(), 0, &y );
+			font->drawText( x, y, Format("cull {0,#} / vis {1,#} / sph {2,#}", culledObjects, visibilityChecks, cullTests).format(), 0, &y );
 			font->drawText( x, y, Format("lts {0,#}", renderedLights).format(), 0, &y );
 			for ( int k = 0 ; k < MAX_LOD_LEVEL ; ++k )
 			{
@@ -0,0 +1,116 @@
+/*
+ * Geometry file (.gm) cooker. 
+ * Converts geometry files to the form which sgu::ModelFile loads in place.
+ */
+#include <io/File.h>
+#include <io/FileInputStream.h>
+#include <io/FileOutputStream.h>
+#include <io/ByteArrayInputStream.h>
+#include <io/ByteArrayOutputStream.h>
+#include <lang/String.h>
+#include <lang/Throwable.h>
+#include <util/Vector.h>
+#include <sgu/ModelFileCooker.h>
+#include <stdint.h>
+#include <stdio.h>
+#ifdef _MSC_VER
+#include <config_msvc.h>
+#endif
+
+//-----------------------------------------------------------------------------
+
+using namespace io;
+using namespace sgu;
+using namespace lang;
+using namespace util;
+
+//-----------------------------------------------------------------------------
+
+const char* cstr( String str )
+{
+	const int COUNT = 8;
+	static char buf[COUNT][512];
+	static int i = 0;
+	i = (i+1)%COUNT;
+	str.getBytes( buf[i], sizeof(buf[0]), "ASCII-7" );
+	return buf[i];
+}
+
+void listFiles( String dir, Vector<File>& files )
+{
+	Vector<String> fnames( Allocator<String>(__FILE__) );
+	fnames.setSize( File(dir).list(0,0) );
+	int n = File(dir).list( fnames.begin(), fnames.size() );
+	if ( fnames.size() > n )
+		fnames.setSize( n );
+
+	for ( int i = 0 ; i < fnames.size() ; ++i )
+	{
+		String fname = fnames[i];
+		File file( dir, fname );
+		if ( file.isFile() && fname.toLowerCase().endsWith(".gm") )
+			files.add( file );
+		else if ( file.isDirectory() )
+			listFiles( file.getPath(), files );
+	}
+}
+
+void cookFile( String inputName, String outputName )
+{
+	// read
+	FileInputStream fin( inputName );
+	Vector<uint8_t> bytes( Allocator<uint8_t>(__FILE__) );
+	bytes.setSize( fin.available() );
+	fin.read( bytes.begin(), bytes.size() );
+	fin.close();
+
+	if ( ModelFileCooker::isCooked(bytes.begin(),bytes.size()) )
+	{
+		printf( "skipping %s (already cooked)\n", cstr(inputName) );
+		return;
+	}
+	printf( "cooking %s\n", cstr(inputName) );
+
+	// cook
+	P(ByteArrayInputStream) in = new ByteArrayInputStream( bytes.begin(), bytes.size() );
+	P(ByteArrayOutputStream) out = new ByteArrayOutputStream;
+	ModelFileCooker::cook( in, out, inputName );
+
+	// write
+	FileOutputStream fout( outputName );
+	fout.write( out->toByteArray(), out->size() );
+	fout.close();
+}
+
+int main( int argc, char* argv[] )
+{
+	try
+	{
+		if ( argc < 2 || argc > 3 )
+		{
+			printf( "usage:\n" );
+			printf( "gmcook <input.gm> [<output.gm>]   cook single file (in place if no output)\n" );
+			printf( "gmcook -r <dir>                   cook all .gm files in place, recursive\n" );
+			return 0;
+		}
+
+		String arg1 = argv[1];
+		if ( arg1 == "-r" )
+		{
+			Vector<File> files( Allocator<File>(__FILE__) );
+			listFiles( argc > 2 ? String(argv[2]) : String(""), files );
+			for ( int i = 0 ; i < files.size() ; ++i )
+				cookFile( files[i].getPath(), files[i].getPath() );
+		}
+		else
+		{
+			cookFile( arg1, argc > 2 ? String(argv[2]) : arg1 );
+		}
+	}
+	catch ( Throwable& e )
+	{
+		printf( "Error: %s\n", cstr(e.getMessage().format()) );
+		return 1;
+	}
+	return 0;
+}
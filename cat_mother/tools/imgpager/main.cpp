@@ -7,6 +7,8 @@
 #include <pix/Image.h>
 #include <pix/Surface.h>
 #include <pix/SurfaceFormat.h>
+#include <pix/DXTCompressor.h>
+#include <pix/MipMapGenerator.h>
 #include <lang/Math.h>
 #include <lang/String.h>
 #include <lang/Exception.h>
@@ -68,7 +70,7 @@ int main( int argc, char* argv[] )
 
 		// read output file name
 		char outfname[2048];
-		printf( "Output file name (tga, jpg, bmp): " );
+		printf( "Output file name (tga, jpg, bmp, dds): " );
 		n = scanf( "%s", outfname );
 		if ( n != 1 )
 		{
@@ -76,6 +78,40 @@ int main( int argc, char* argv[] )
 			return 1;
 		}
 
+		// read DDS compression options
+		int dxt = 0;
+		int quality = 0;
+		int mipmaps = 0;
+		if ( String(outfname).toLowerCase().endsWith(".dds") )
+		{
+			printf( "DDS format (0=uncompressed, 1=DXT1, 3=DXT3, 5=DXT5): " );
+			n = scanf( "%i", &dxt );
+			if ( n != 1 || (dxt != 0 && dxt != 1 && dxt != 3 && dxt != 5) )
+			{
+				printf( "Invalid DDS format, must be 0, 1, 3 or 5\n" );
+				return 1;
+			}
+
+			if ( dxt != 0 )
+			{
+				printf( "Compression quality (0=fast, 1=high): " );
+				n = scanf( "%i", &quality );
+				if ( n != 1 || quality < 0 || quality > 1 )
+				{
+					printf( "Invalid compression quality, must be 0 or 1\n" );
+					return 1;
+				}
+			}
+
+			printf( "Mipmaps (0=none, 1=box filter, 2=Kaiser filter): " );
+			n = scanf( "%i", &mipmaps );
+			if ( n != 1 || mipmaps < 0 || mipmaps > 2 )
+			{
+				printf( "Invalid mipmap option, must be 0, 1 or 2\n" );
+				return 1;
+			}
+		}
+
 		// load images
 		int width = 0;
 		int height = 0;
@@ -136,6 +172,19 @@ int main( int argc, char* argv[] )
 			++rows;
 		}
 
+		// generate mipmaps and compress DDS output
+		if ( mipmaps > 0 )
+			img->generateMipMaps( MipMapGenerator(mipmaps == 2 ? MipMapGenerator::FILTER_KAISER : MipMapGenerator::FILTER_BOX) );
+		if ( dxt != 0 )
+		{
+			SurfaceFormat format = SurfaceFormat::SURFACE_DXT1;
+			if ( dxt == 3 )
+				format = SurfaceFormat::SURFACE_DXT3;
+			else if ( dxt == 5 )
+				format = SurfaceFormat::SURFACE_DXT5;
+			img->compress( format, DXTCompressor(quality ? DXTCompressor::QUALITY_HIGH : DXTCompressor::QUALITY_FAST) );
+		}
+
 		// save output
 		P(FileOutputStream) out = new FileOutputStream( outfname );
 		img->save( out );
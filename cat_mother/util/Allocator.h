@@ -3,6 +3,7 @@
 
 
 #include <mem/Group.h>
+#include <mem/Arena.h>
 #include <new>
 
 
@@ -12,7 +13,8 @@ namespace util
 
 /** 
  * Manager for storage allocation of objects of type T. 
- * Supports named memory block groups (for memory statistics).
+ * Supports named memory block groups (for memory statistics)
+ * and arena allocation for short-lived (e.g. per-frame) data.
  * @author Jani Kajala (jani.kajala@helsinki.fi)
  */
 template <class T> class Allocator
@@ -24,6 +26,14 @@ public:
 	/** Creates allocator of specified user. */
 	explicit Allocator( const char* file, int line=-1 );
 
+	/** 
+	 * Creates allocator which allocates memory from an arena (see mem_Arena_create).
+	 * Memory is not freed by deallocate but when the arena is reset, so the arena
+	 * must not be reset or destroyed while the allocated objects are in use.
+	 * Arena memory is not included in group statistics.
+	 */
+	Allocator( void* arena, const char* file, int line=-1 );
+
 	/** Releases allocator. */
 	~Allocator();
 
@@ -54,8 +64,12 @@ public:
 	/** Returns name of the allocator group. */
 	const char* 	name() const;
 
+	/** Returns arena used by the allocator or 0 if memory is allocated to the group. */
+	void*			arena() const;
+
 private:
 	void* m_group;
+	void* m_arena;
 };
 
 
@@ -1,11 +1,19 @@
 template <class T> Allocator<T>::Allocator()
 {
 	m_group = mem_Group_create(__FILE__,__LINE__);
+	m_arena = 0;
 }
 
 template <class T> Allocator<T>::Allocator( const char* file, int line )
 {
 	m_group = mem_Group_create(file,line);
+	m_arena = 0;
+}
+
+template <class T> Allocator<T>::Allocator( void* arena, const char* file, int line )
+{
+	m_group = mem_Group_create(file,line);
+	m_arena = arena;
 }
 
 template <class T> Allocator<T>::~Allocator()
@@ -16,6 +24,7 @@ template <class T> Allocator<T>::~Allocator()
 template <class T> Allocator<T>::Allocator( const Allocator<T>& other )
 {
 	m_group = mem_Group_copy( other.m_group );
+	m_arena = other.m_arena;
 }
 
 template <class T> Allocator<T>& Allocator<T>::operator=( const Allocator<T>& other )
@@ -23,12 +32,13 @@ template <class T> Allocator<T>& Allocator<T>::operator=( const Allocator<T>& ot
 	void* group = mem_Group_copy( other.m_group );
 	mem_Group_release(m_group);
 	m_group = group;
+	m_arena = other.m_arena;
 	return *this;
 }
 
 template <class T> T* Allocator<T>::allocate( int n, void* )
 {
-	void* mem = mem_Group_allocate( m_group, sizeof(T)*n );
+	void* mem = m_arena ? mem_Arena_allocate( m_arena, sizeof(T)*n ) : mem_Group_allocate( m_group, sizeof(T)*n );
 	T* item0 = reinterpret_cast<T*>(mem); 
 	int i = 0;
 
@@ -52,7 +62,8 @@ template <class T> T* Allocator<T>::allocate( int n, void* )
 			item->~T();
 			--item;
 		} 
-		mem_Group_free( m_group, mem, sizeof(T)*n );
+		if ( !m_arena )
+			mem_Group_free( m_group, mem, sizeof(T)*n );
 		throw;
 	}
 }
@@ -66,7 +77,8 @@ template <class T> void Allocator<T>::deallocate( T* p, int n )
 		p->~T(); 
 		--p;
 	}
-	mem_Group_free( m_group, mem, sizeof(T)*n );
+	if ( !m_arena )
+		mem_Group_free( m_group, mem, sizeof(T)*n );
 }
 
 template <class T> T* Allocator<T>::construct( void* p, const T& v )
@@ -94,3 +106,8 @@ template <class T> int Allocator<T>::blocksInUse() const
 {
 	return mem_Group_blocksInUse( m_group );
 }
+
+template <class T> void* Allocator<T>::arena() const
+{
+	return m_arena;
+}
@@ -0,0 +1,268 @@
+#ifndef _UTIL_FLATHASHTABLE_H
+#define _UTIL_FLATHASHTABLE_H
+
+
+#include <lang/Object.h>
+#include <util/Hash.h>
+#include <util/Equal.h>
+#include <util/Allocator.h>
+#include <util/HashtableIterator.h>
+#include <util/internal/HashtablePair.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+namespace util
+{
+
+
+/**
+ * Open addressing hash table with the same interface as Hashtable.
+ * Elements are stored in a single power-of-two sized slot array.
+ * Every slot has a control byte which is either empty, deleted
+ * or 7 bits of the key hash. Lookups compare control bytes of
+ * 8 consecutive slots at a time using 64-bit integer arithmetic
+ * and compare keys only in slots with matching hash bits,
+ * so probing rarely branches and never chases pointers.
+ * Hash function results are scrambled by Fibonacci hashing so
+ * weak hash functions (like identity for ints) work well.
+ *
+ * Lookup by other than key type (e.g. const char* for String keys)
+ * is supported by find() and containsKey() if the hash function and
+ * equality compare function have overloads for the other type and
+ * the hash values are consistent with the key type.
+ *
+ * Iterators are HashtableIterator, so call sites can switch
+ * between Hashtable and FlatHashtable by changing a typedef.
+ * Unlike with Hashtable, references to the values are
+ * invalidated when keys are added.
+ *
+ * @param K Key type.
+ * @param T Data type.
+ * @param F Key hash function type.
+ * @param E Key equality compare function type.
+ * @param A Allocator of HashtablePair<K,T>.
+ */
+template < class K, class T, class F=Hash<K>, class E=Equal<K>, class A=Allocator< HashtablePair<K,T> > >
+class FlatHashtable :
+	public lang::Object
+{
+public:
+	/** Constructs an empty hash table with load factor of 75/100. */
+	explicit FlatHashtable( const A& alloc );
+
+	/**
+	 * Constructs an empty hash table with specified
+	 * initial capacity, load factor, default value and hash function.
+	 * Capacity is rounded up to next power of two.
+	 */
+	explicit FlatHashtable( int initialCapacity, float loadFactor,
+		const T& defaultValue, const F& hashFunc, const E& equalFunc,
+		const A& alloc );
+
+	/** Copy by value. */
+	FlatHashtable( const FlatHashtable<K,T,F,E,A>& other );
+
+	///
+	~FlatHashtable();
+
+	/** Copy by value. */
+	FlatHashtable<K,T,F,E,A>& operator=( const FlatHashtable<K,T,F,E,A>& other );
+
+	/** Returns the value of specified key. Puts the key to the map if not exist. */
+	T&			operator[]( const K& key );
+
+	/**
+	 * Returns the value of specified key.
+	 * Returns default value if the key was not in the table.
+	 */
+	T&			get( const K& key );
+
+	/**
+	 * Puts the value at specified key to the container.
+	 * If there is already old value with the same key it is overwritten.
+	 */
+	void		put( const K& key, const T& value );
+
+	/**
+	 * Removes value at specified key.
+	 * Does nothing if the key is not in the table.
+	 */
+	void		remove( const K& key );
+
+	/** Removes all keys from the container. Capacity is not changed. */
+	void		clear();
+
+	/**
+	 * Makes sure that specified number of keys can be
+	 * stored without rehashing the table.
+	 */
+	void		reserve( int entries );
+
+	/**
+	 * Rehashes the table to at least specified capacity.
+	 * Capacity is rounded up to next power of two and is never
+	 * made smaller than needed by the current keys.
+	 * rehash(0) shrinks the table to fit the current keys.
+	 */
+	void		rehash( int cap );
+
+	/**
+	 * Returns pointer to the value of specified key or 0 if the key is not in the table.
+	 * Q can be any type accepted by both the hash and the equality compare function.
+	 */
+	template <class Q> T*	find( const Q& key )				{int i = findSlot(key); return i >= 0 ? &m_data[i].value : 0;}
+
+	/** Returns the value of specified key. Puts the key to the map if not exist. */
+	const T&	operator[]( const K& key ) const;
+
+	/**
+	 * Returns the value of specified key.
+	 * Returns default value if the key is not in the table.
+	 */
+	const T&	get( const K& key ) const;
+
+	/** Returns number of distinct keys. */
+	int			size() const;
+
+	/** Returns true if there is no elements in the table. */
+	bool		isEmpty() const;
+
+	/** Returns true if the hash table contains specific key. */
+	bool		containsKey( const K& key ) const;
+
+	/**
+	 * Returns true if the hash table contains specific key.
+	 * Q can be any type accepted by both the hash and the equality compare function.
+	 */
+	template <class Q> bool	containsKey( const Q& key ) const	{return findSlot(key) >= 0;}
+
+	/**
+	 * Returns pointer to the value of specified key or 0 if the key is not in the table.
+	 * Q can be any type accepted by both the hash and the equality compare function.
+	 */
+	template <class Q> const T*	find( const Q& key ) const		{int i = findSlot(key); return i >= 0 ? &m_data[i].value : 0;}
+
+	/** Returns number of slots in the table. */
+	int			capacity() const;
+
+	/**
+	 * Returns number of keys which are not stored in their home slot.
+	 * Can be used for debugging hash functions.
+	 */
+	int			collisions() const;
+
+	/**
+	 * Returns iterator to the first element.
+	 * Behaviour is undefined if the table is changed during the traversal.
+	 */
+	HashtableIterator<K,T>	begin() const;
+
+	/**
+	 * Returns iterator to one beyond the last element.
+	 * Behaviour is undefined if the table is changed during the traversal.
+	 */
+	HashtableIterator<K,T>	end() const;
+
+private:
+	enum Constants
+	{
+		/** Number of control bytes compared at a time. */
+		GROUP			= 8,
+		/** Control byte of a slot which has not been used since last rehash. */
+		CTRL_EMPTY		= 0x80,
+		/** Control byte of a slot whose key has been removed. */
+		CTRL_DELETED	= 0xFE,
+		/** Smallest allocated capacity. */
+		MIN_CAPACITY	= 8,
+		/** Largest capacity, leaves 7 hash bits below the slot index bits for the control byte. */
+		MAX_CAPACITY	= 1<<25,
+	};
+
+	int						m_cap;
+	int						m_shift;
+	HashtablePair<K,T>*		m_data;
+	uint8_t*				m_ctrl;
+	float					m_loadFactor;
+	int						m_entries;
+	int						m_deleted;
+	int						m_entryLimit;
+	T						m_defaultValue;
+	T						m_missValue;
+	int						m_collisions;
+	F						m_hashFunc;
+	E						m_equalFunc;
+	mutable A				m_alloc;
+
+	void				defaults();
+	void				destroy();
+	void				resize( int cap );
+	int					insertNew( const K& key, uint32_t hash );
+	int					getSlot( const K& key );
+	void				removeSlot( int i, uint32_t hash );
+	void				setCtrl( int i, uint8_t ctrl );
+
+	/** Scrambles hash function result. */
+	static uint32_t		mix( int hash )								{return (uint32_t)hash * 0x9E3779B9u;}
+
+	/** 
+	 * Returns control byte of a key. The byte is taken from the 7 hash bits
+	 * right below the bits used as slot index so that slots in the same group
+	 * don't share control bytes by construction. Requires capacity <= MAX_CAPACITY.
+	 */
+	uint8_t				hashCtrl( uint32_t hash ) const				{assert( m_shift >= 7 ); return (uint8_t)( (hash >> (m_shift-7)) & 0x7F );}
+
+	/** Returns control bytes of GROUP slots starting from specified one, first slot in the lowest byte. */
+	static uint64_t		loadGroup( const uint8_t* ctrl )			{uint64_t g; memcpy( &g, ctrl, sizeof(g) ); return g;}
+
+	/** Returns high bits set in bytes equal to the control byte. May have false positives above a match. */
+	static uint64_t		matchCtrl( uint64_t g, uint8_t ctrl )		{uint64_t x = g ^ (ctrl * UINT64_C(0x0101010101010101)); return (x - UINT64_C(0x0101010101010101)) & ~x & UINT64_C(0x8080808080808080);}
+
+	/** Returns high bits set in bytes of empty slots. */
+	static uint64_t		matchEmpty( uint64_t g )					{return g & ~(g<<1) & UINT64_C(0x8080808080808080);}
+
+	/** Returns high bits set in bytes of empty and deleted slots. */
+	static uint64_t		matchFree( uint64_t g )						{return g & UINT64_C(0x8080808080808080);}
+
+	/** Returns index of the lowest byte with high bit set. Match must be non-zero. */
+	static int			firstMatch( uint64_t m )					{return (int)( (((m & (0-m)) >> 7) * UINT64_C(0x0001020304050607)) >> 56 );}
+
+	/** Returns slot index of a key or -1 if the key is not in the table. */
+	template <class Q> int findSlot( const Q& key ) const
+	{
+		if ( 0 == m_entries )
+			return -1;
+		return findSlot( key, mix(m_hashFunc(key)) );
+	}
+
+	/** Returns slot index of a key with specified scrambled hash or -1 if the key is not in the table. */
+	template <class Q> int findSlot( const Q& key, uint32_t hash ) const
+	{
+		if ( 0 == m_entries )
+			return -1;
+
+		const int mask = m_cap - 1;
+		const uint8_t ctrl = hashCtrl( hash );
+		for ( int i = (int)(hash >> m_shift) ;; i = (i+GROUP) & mask )
+		{
+			const uint64_t g = loadGroup( m_ctrl+i );
+			for ( uint64_t m = matchCtrl(g,ctrl) ; m ; m &= m-1 )
+			{
+				const int slot = (i + firstMatch(m)) & mask;
+				if ( m_ctrl[slot] == ctrl && m_equalFunc(m_data[slot].key,key) )
+					return slot;
+			}
+			if ( matchEmpty(g) )
+				return -1;
+		}
+	}
+};
+
+
+#include "FlatHashtable.inl"
+
+
+} // util
+
+
+#endif // _UTIL_FLATHASHTABLE_H
@@ -0,0 +1,360 @@
+template <class K, class T, class F, class E, class A> FlatHashtable<K,T,F,E,A>::FlatHashtable( const A& alloc ) :
+	m_alloc(alloc)
+{
+	defaults();
+}
+
+template <class K, class T, class F, class E, class A> FlatHashtable<K,T,F,E,A>::FlatHashtable(
+	int initialCapacity, float loadFactor,
+	const T& defaultValue, const F& hashFunc, const E& equalFunc, const A& alloc ) :
+	m_alloc(alloc)
+{
+	assert( loadFactor >= 0.01f && loadFactor <= 0.99f );
+	assert( initialCapacity > 0 );
+
+	defaults();
+	m_loadFactor = loadFactor;
+	m_defaultValue = defaultValue;
+	m_hashFunc = hashFunc;
+	m_equalFunc = equalFunc;
+	rehash( initialCapacity );
+}
+
+template <class K, class T, class F, class E, class A> FlatHashtable<K,T,F,E,A>::FlatHashtable( const FlatHashtable<K,T,F,E,A>& other ) :
+	m_alloc(other.m_alloc)
+{
+	defaults();
+	*this = other;
+}
+
+template <class K, class T, class F, class E, class A> FlatHashtable<K,T,F,E,A>::~FlatHashtable()
+{
+	destroy();
+}
+
+template <class K, class T, class F, class E, class A> FlatHashtable<K,T,F,E,A>& FlatHashtable<K,T,F,E,A>::operator=( const FlatHashtable<K,T,F,E,A>& other )
+{
+	if ( this != &other )
+	{
+		destroy();
+		m_alloc = other.m_alloc;
+		m_loadFactor = other.m_loadFactor;
+		m_defaultValue = other.m_defaultValue;
+		m_hashFunc = other.m_hashFunc;
+		m_equalFunc = other.m_equalFunc;
+
+		if ( other.m_cap > 0 )
+		{
+			int cap = other.m_cap;
+			m_data = m_alloc.allocate( cap );
+			m_ctrl = new uint8_t[cap+GROUP];
+			memcpy( m_ctrl, other.m_ctrl, cap+GROUP );
+			for ( int i = 0 ; i < cap ; ++i )
+			{
+				if ( other.m_data[i].used )
+				{
+					m_data[i].key = other.m_data[i].key;
+					m_data[i].value = other.m_data[i].value;
+					m_data[i].used = true;
+				}
+			}
+			m_cap = cap;
+			m_shift = other.m_shift;
+			m_entries = other.m_entries;
+			m_deleted = other.m_deleted;
+			m_entryLimit = other.m_entryLimit;
+			m_collisions = other.m_collisions;
+		}
+	}
+	return *this;
+}
+
+template <class K, class T, class F, class E, class A> T& FlatHashtable<K,T,F,E,A>::operator[]( const K& key )
+{
+	int i = getSlot( key );
+	return m_data[i].value;
+}
+
+template <class K, class T, class F, class E, class A> T& FlatHashtable<K,T,F,E,A>::get( const K& key )
+{
+	int i = findSlot( key );
+	if ( i >= 0 )
+		return m_data[i].value;
+
+	// modifying returned value must not change the default value
+	m_missValue = m_defaultValue;
+	return m_missValue;
+}
+
+template <class K, class T, class F, class E, class A> void FlatHashtable<K,T,F,E,A>::put( const K& key, const T& value )
+{
+	int i = getSlot( key );
+	m_data[i].value = value;
+}
+
+template <class K, class T, class F, class E, class A> void FlatHashtable<K,T,F,E,A>::remove( const K& key )
+{
+	if ( 0 == m_entries )
+		return;
+
+	const uint32_t hash = mix( m_hashFunc(key) );
+	int i = findSlot( key, hash );
+	if ( i >= 0 )
+		removeSlot( i, hash );
+}
+
+template <class K, class T, class F, class E, class A> void FlatHashtable<K,T,F,E,A>::clear()
+{
+	for ( int i = 0 ; i < m_cap ; ++i )
+	{
+		HashtablePair<K,T>& pair = m_data[i];
+		if ( pair.used )
+		{
+			pair.key = K();
+			pair.value = T();
+			pair.used = false;
+		}
+	}
+	if ( m_ctrl )
+		memset( m_ctrl, CTRL_EMPTY, m_cap+GROUP );
+	m_entries = 0;
+	m_deleted = 0;
+	m_collisions = 0;
+}
+
+template <class K, class T, class F, class E, class A> void FlatHashtable<K,T,F,E,A>::reserve( int entries )
+{
+	assert( entries >= 0 );
+
+	if ( entries+m_deleted > m_entryLimit )
+		rehash( (int)(entries/m_loadFactor) + 1 );
+}
+
+template <class K, class T, class F, class E, class A> void FlatHashtable<K,T,F,E,A>::rehash( int cap )
+{
+	assert( cap >= 0 );
+
+	if ( 0 == cap && 0 == m_entries )
+	{
+		destroy();
+		return;
+	}
+
+	int newCap = MIN_CAPACITY;
+	while ( newCap < cap || (int)(newCap*m_loadFactor) < m_entries || newCap <= m_entries )
+		newCap <<= 1;
+	if ( newCap != m_cap || m_deleted > 0 )
+		resize( newCap );
+}
+
+template <class K, class T, class F, class E, class A> const T& FlatHashtable<K,T,F,E,A>::operator[]( const K& key ) const
+{
+	return const_cast< FlatHashtable<K,T,F,E,A>* >(this)->operator[]( key );
+}
+
+template <class K, class T, class F, class E, class A> const T& FlatHashtable<K,T,F,E,A>::get( const K& key ) const
+{
+	int i = findSlot( key );
+	if ( i >= 0 )
+		return m_data[i].value;
+	return m_defaultValue;
+}
+
+template <class K, class T, class F, class E, class A> int FlatHashtable<K,T,F,E,A>::size() const
+{
+	return m_entries;
+}
+
+template <class K, class T, class F, class E, class A> bool FlatHashtable<K,T,F,E,A>::isEmpty() const
+{
+	return 0 == m_entries;
+}
+
+template <class K, class T, class F, class E, class A> bool FlatHashtable<K,T,F,E,A>::containsKey( const K& key ) const
+{
+	return findSlot( key ) >= 0;
+}
+
+template <class K, class T, class F, class E, class A> int FlatHashtable<K,T,F,E,A>::capacity() const
+{
+	return m_cap;
+}
+
+template <class K, class T, class F, class E, class A> int FlatHashtable<K,T,F,E,A>::collisions() const
+{
+	return m_collisions;
+}
+
+template <class K, class T, class F, class E, class A> HashtableIterator<K,T> FlatHashtable<K,T,F,E,A>::begin() const
+{
+	return HashtableIterator<K,T>( m_data, m_cap, 0 );
+}
+
+template <class K, class T, class F, class E, class A> HashtableIterator<K,T> FlatHashtable<K,T,F,E,A>::end() const
+{
+	return HashtableIterator<K,T>();
+}
+
+template <class K, class T, class F, class E, class A> void FlatHashtable<K,T,F,E,A>::resize( int cap )
+{
+	assert( cap >= MIN_CAPACITY && cap <= MAX_CAPACITY && 0 == (cap & (cap-1)) );
+	assert( cap > m_entries );
+
+	HashtablePair<K,T>* oldData = m_data;
+	uint8_t* oldCtrl = m_ctrl;
+	int oldCap = m_cap;
+
+	m_data = m_alloc.allocate( cap );
+	m_ctrl = new uint8_t[cap+GROUP];
+	memset( m_ctrl, CTRL_EMPTY, cap+GROUP );
+	m_cap = cap;
+	m_shift = 32;
+	for ( int n = cap ; n > 1 ; n >>= 1 )
+		--m_shift;
+	m_entryLimit = (int)(cap * m_loadFactor);
+	if ( m_entryLimit >= cap )
+		m_entryLimit = cap-1;
+	m_entries = 0;
+	m_deleted = 0;
+	m_collisions = 0;
+
+	for ( int i = 0 ; i < oldCap ; ++i )
+	{
+		if ( oldData[i].used )
+		{
+			const K& key = oldData[i].key;
+			int slot = insertNew( key, mix(m_hashFunc(key)) );
+			m_data[slot].value = oldData[i].value;
+		}
+	}
+
+	if ( oldData )
+	{
+		m_alloc.deallocate( oldData, oldCap );
+		delete[] oldCtrl;
+	}
+}
+
+template <class K, class T, class F, class E, class A> int FlatHashtable<K,T,F,E,A>::insertNew( const K& key, uint32_t hash )
+{
+	const int mask = m_cap - 1;
+	const int home = (int)(hash >> m_shift);
+
+	int slot = home;
+	for ( int i = home ;; i = (i+GROUP) & mask )
+	{
+		uint64_t m = matchFree( loadGroup(m_ctrl+i) );
+		if ( m )
+		{
+			slot = (i + firstMatch(m)) & mask;
+			break;
+		}
+	}
+
+	if ( CTRL_DELETED == m_ctrl[slot] )
+		--m_deleted;
+	setCtrl( slot, hashCtrl(hash) );
+
+	HashtablePair<K,T>& pair = m_data[slot];
+	pair.key = key;
+	pair.value = m_defaultValue;
+	pair.used = true;
+	++m_entries;
+	if ( slot != home )
+		++m_collisions;
+	return slot;
+}
+
+template <class K, class T, class F, class E, class A> int FlatHashtable<K,T,F,E,A>::getSlot( const K& key )
+{
+	const uint32_t hash = mix( m_hashFunc(key) );
+	int i = findSlot( key, hash );
+	if ( i >= 0 )
+		return i;
+
+	if ( m_entries+m_deleted+1 > m_entryLimit )
+	{
+		// purge deleted slots if that makes enough room, grow otherwise
+		if ( 0 == m_cap )
+			resize( MIN_CAPACITY );
+		else if ( m_entries*2 < m_entryLimit )
+			resize( m_cap );
+		else
+			resize( m_cap*2 );
+	}
+	return insertNew( key, hash );
+}
+
+template <class K, class T, class F, class E, class A> void FlatHashtable<K,T,F,E,A>::removeSlot( int i, uint32_t hash )
+{
+	const int mask = m_cap - 1;
+
+	// slot can be marked empty if no probe has ever passed it,
+	// i.e. it isn't part of GROUP consecutive non-empty slots
+	int run = 1;
+	int k;
+	for ( k = 1 ; k < GROUP && CTRL_EMPTY != m_ctrl[(i-k) & mask] ; ++k )
+		++run;
+	for ( k = 1 ; k < GROUP && CTRL_EMPTY != m_ctrl[(i+k) & mask] ; ++k )
+		++run;
+
+	if ( run < GROUP )
+	{
+		setCtrl( i, CTRL_EMPTY );
+	}
+	else
+	{
+		setCtrl( i, CTRL_DELETED );
+		++m_deleted;
+	}
+
+	HashtablePair<K,T>& pair = m_data[i];
+	pair.key = K();
+	pair.value = T();
+	pair.used = false;
+	--m_entries;
+	if ( i != (int)(hash >> m_shift) )
+		--m_collisions;
+}
+
+template <class K, class T, class F, class E, class A> void FlatHashtable<K,T,F,E,A>::setCtrl( int i, uint8_t ctrl )
+{
+	m_ctrl[i] = ctrl;
+
+	// first group is mirrored after the last slot for loads which wrap around
+	if ( i < GROUP )
+		m_ctrl[m_cap+i] = ctrl;
+}
+
+template <class K, class T, class F, class E, class A> void FlatHashtable<K,T,F,E,A>::destroy()
+{
+	if ( m_data )
+	{
+		m_alloc.deallocate( m_data, m_cap );
+		delete[] m_ctrl;
+	}
+	m_cap = 0;
+	m_shift = 32;
+	m_data = 0;
+	m_ctrl = 0;
+	m_entries = 0;
+	m_deleted = 0;
+	m_entryLimit = 0;
+	m_collisions = 0;
+}
+
+template <class K, class T, class F, class E, class A> void FlatHashtable<K,T,F,E,A>::defaults()
+{
+	m_cap			= 0;
+	m_shift			= 32;
+	m_data			= 0;
+	m_ctrl			= 0;
+	m_loadFactor	= 0.75f;
+	m_entries		= 0;
+	m_deleted		= 0;
+	m_entryLimit	= 0;
+	m_defaultValue	= T();
+	m_collisions	= 0;
+	m_hashFunc		= F();
+	m_equalFunc		= E();
+}
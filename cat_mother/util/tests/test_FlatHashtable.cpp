@@ -0,0 +1,338 @@
+#include <tester/Test.h>
+#include <util/FlatHashtable.h>
+#include <util/Hashtable.h>
+#include <util/Vector.h>
+#include <lang/String.h>
+#include <lang/System.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "Int.h"
+
+//-----------------------------------------------------------------------------
+
+using namespace lang;
+using namespace util;
+
+//-----------------------------------------------------------------------------
+
+/** String hash and compare which accept also C-strings. */
+class StrHash
+{
+public:
+	int operator()( const String& x ) const
+	{
+		return x.hashCode();
+	}
+
+	int operator()( const char* x ) const
+	{
+		int code = 0;
+		for ( ; *x ; ++x )
+			code = code*31 + (unsigned char)*x;
+		return code;
+	}
+
+	bool operator()( const String& a, const String& b ) const
+	{
+		return a == b;
+	}
+
+	bool operator()( const String& a, const char* b ) const
+	{
+		int len = a.length();
+		for ( int i = 0 ; i < len ; ++i )
+			if ( a.charAt(i) != (unsigned char)b[i] )
+				return false;
+		return 0 == b[len];
+	}
+};
+
+//-----------------------------------------------------------------------------
+
+static String fmt( int x )
+{
+	char ch[16];
+	sprintf( ch, "%i", x );
+	String str = ch;
+	return str;
+}
+
+/** Same as test_Hashtable but with the open addressing table. */
+static void testInterface()
+{
+	Allocator< HashtablePair<String,Int> > alloc(__FILE__,__LINE__);
+	FlatHashtable<String,Int> a( alloc );
+
+	int i;
+	for ( i = 0 ; i < 100 ; ++i )
+	{
+		String str = fmt(i);
+		a[str] = i;
+		assert( a[str] == i );
+	}
+	assert( a.size() == 100 );
+
+	FlatHashtable<String,Int> b( a );
+	FlatHashtable<String,Int> c( alloc );
+	c = b;
+	a = c;
+
+	for ( i = 0 ; i < 100 ; ++i )
+	{
+		String str = fmt(i);
+		assert( a[str] == i );
+	}
+
+	FlatHashtable<Int,String> d( 1, 0.75f, "-1", Hash<Int>(), Equal<Int>(), Allocator< HashtablePair<Int,String> >(__FILE__,__LINE__) );
+	for ( i = 0 ; i < 100 ; ++i )
+	{
+		String str = fmt(i);
+		d[i] = str;
+		assert( d[i] == str );
+	}
+	assert( d.collisions() >= 75 );	// Int::hashCode() returns i&~3
+
+	for ( i = 1 ; i < 100 ; i += 2 )
+		d.remove( i );
+	assert( d.size() == 50 );
+
+	int count = 0;
+	for ( HashtableIterator<Int,String> it = d.begin() ; it != d.end() ; ++it )
+	{
+		int k = it.key();
+		assert( 0 == (k & 1) );
+		assert( it.value() == fmt(k) );
+		++count;
+	}
+	assert( count == 50 );
+
+	assert( d.get(1) == "-1" );
+	d.get(1) = "x";
+	assert( d.get(3) == "-1" );
+	assert( !d.containsKey(1) );
+	assert( d[101] == "-1" );
+	assert( d.size() == 51 );
+
+	d.clear();
+	assert( d.isEmpty() );
+	assert( d.begin() == d.end() );
+}
+
+/** Random inserts and removes compared to the chained table. */
+static void testChurn()
+{
+	Hashtable<int,int> ref( Allocator< HashtablePair<int,int> >(__FILE__,__LINE__) );
+	FlatHashtable<int,int> flat( Allocator< HashtablePair<int,int> >(__FILE__,__LINE__) );
+
+	srand( 123 );
+	int i;
+	for ( i = 0 ; i < 200000 ; ++i )
+	{
+		int key = rand() % 3000;
+		if ( rand() & 1 )
+		{
+			ref[key] = i;
+			flat[key] = i;
+		}
+		else
+		{
+			ref.remove( key );
+			flat.remove( key );
+		}
+		assert( ref.size() == flat.size() );
+	}
+
+	for ( i = 0 ; i < 3000 ; ++i )
+	{
+		assert( ref.containsKey(i) == flat.containsKey(i) );
+		if ( flat.containsKey(i) )
+			assert( ref[i] == flat[i] );
+	}
+
+	int count = 0;
+	for ( HashtableIterator<int,int> it = flat.begin() ; it != flat.end() ; ++it )
+	{
+		assert( ref[it.key()] == it.value() );
+		++count;
+	}
+	assert( count == flat.size() );
+}
+
+static void testCapacity()
+{
+	FlatHashtable<int,int> a( Allocator< HashtablePair<int,int> >(__FILE__,__LINE__) );
+	assert( a.capacity() == 0 );
+	assert( !a.containsKey(0) );
+
+	a.reserve( 1000 );
+	int cap = a.capacity();
+	assert( cap >= 1000 && 0 == (cap & (cap-1)) );
+	int i;
+	for ( i = 0 ; i < 1000 ; ++i )
+		a[i*7] = i;
+	assert( a.capacity() == cap );
+
+	a.rehash( 10000 );
+	assert( a.capacity() >= 10000 );
+	for ( i = 0 ; i < 1000 ; ++i )
+		assert( a[i*7] == i );
+
+	for ( i = 10 ; i < 1000 ; ++i )
+		a.remove( i*7 );
+	a.rehash( 0 );
+	assert( a.capacity() == 16 );
+	for ( i = 0 ; i < 10 ; ++i )
+		assert( a[i*7] == i );
+	assert( a.size() == 10 );
+
+	a.clear();
+	a.rehash( 0 );
+	assert( a.capacity() == 0 );
+}
+
+static void testHeterogeneousLookup()
+{
+	FlatHashtable<String,int,StrHash,StrHash> a( 16, 0.75f, -1, StrHash(), StrHash(), Allocator< HashtablePair<String,int> >(__FILE__,__LINE__) );
+	a["alpha"] = 1;
+	a["beta"] = 2;
+
+	assert( a.containsKey("alpha") );
+	assert( !a.containsKey("alph") );
+	assert( *a.find("beta") == 2 );
+	assert( a.find("gamma") == 0 );
+	*a.find("beta") = 3;
+	assert( a[String("beta")] == 3 );
+}
+
+//-----------------------------------------------------------------------------
+
+/** Returns milliseconds elapsed since t0. */
+static long elapsed( long t0 )
+{
+	return System::currentTimeMillis() - t0;
+}
+
+template <class H, class K> static void benchmark( H& table, const Vector<K>& keys, const Vector<K>& misses, int rounds, const char* name )
+{
+	const int n = keys.size();
+	int i, j, k;
+	int found = 0;
+
+	long t0 = System::currentTimeMillis();
+	for ( k = 0 ; k < rounds ; ++k )
+	{
+		table.clear();
+		for ( i = 0 ; i < n ; ++i )
+			table.put( keys[i], i );
+	}
+	long insert = elapsed( t0 );
+
+	t0 = System::currentTimeMillis();
+	for ( k = 0 ; k < rounds ; ++k )
+	{
+		// start from different key every round
+		j = k % n;
+		for ( i = 0 ; i < n ; ++i )
+		{
+			found += table.containsKey( keys[j] );
+			if ( ++j == n )
+				j = 0;
+		}
+	}
+	long hit = elapsed( t0 );
+
+	t0 = System::currentTimeMillis();
+	for ( k = 0 ; k < rounds ; ++k )
+	{
+		// start from different key every round
+		j = k % n;
+		for ( i = 0 ; i < n ; ++i )
+		{
+			found += table.containsKey( misses[j] );
+			if ( ++j == n )
+				j = 0;
+		}
+	}
+	long miss = elapsed( t0 );
+	assert( found == n*rounds );
+
+	// half of the keys are removed and put back every round
+	t0 = System::currentTimeMillis();
+	for ( k = 0 ; k < rounds ; ++k )
+	{
+		for ( i = k&1 ; i < n ; i += 2 )
+			table.remove( keys[i] );
+		for ( i = k&1 ; i < n ; i += 2 )
+			table.put( keys[i], i );
+	}
+	long churn = elapsed( t0 );
+	assert( table.size() == n );
+
+	printf( "  %-22s %7d keys: insert %5ld, hit %5ld, miss %5ld, churn %5ld ms (found %d)\n",
+		name, n, insert, hit, miss, churn, found/rounds );
+}
+
+template <class K> static void swap( Vector<K>& v, int i, int j )
+{
+	K tmp = v[i];
+	v[i] = v[j];
+	v[j] = tmp;
+}
+
+static void benchmark( int n )
+{
+	const int rounds = 2000000 / n;
+	int i;
+
+	Vector<int> ikeys( Allocator<int>(__FILE__,__LINE__) );
+	Vector<int> imisses( Allocator<int>(__FILE__,__LINE__) );
+	Vector<String> skeys( Allocator<String>(__FILE__,__LINE__) );
+	Vector<String> smisses( Allocator<String>(__FILE__,__LINE__) );
+	for ( i = 0 ; i < n ; ++i )
+	{
+		ikeys.add( i*16 );
+		imisses.add( i*16+8 );
+		skeys.add( "object_" + fmt(i) );
+		smisses.add( "object_" + fmt(i) + "x" );
+	}
+
+	// access in random order so that sequential keys don't favor either table
+	srand( n );
+	for ( i = n-1 ; i > 0 ; --i )
+	{
+		int j = rand() % (i+1);
+		swap( ikeys, i, j );
+		swap( imisses, i, j );
+		swap( skeys, i, j );
+		swap( smisses, i, j );
+	}
+
+	Hashtable<int,int> ih( Allocator< HashtablePair<int,int> >(__FILE__,__LINE__) );
+	FlatHashtable<int,int> ifh( Allocator< HashtablePair<int,int> >(__FILE__,__LINE__) );
+	Hashtable<String,int> sh( Allocator< HashtablePair<String,int> >(__FILE__,__LINE__) );
+	FlatHashtable<String,int> sfh( Allocator< HashtablePair<String,int> >(__FILE__,__LINE__) );
+
+	benchmark( ih, ikeys, imisses, rounds, "Hashtable<int>" );
+	benchmark( ifh, ikeys, imisses, rounds, "FlatHashtable<int>" );
+	benchmark( sh, skeys, smisses, rounds, "Hashtable<String>" );
+	benchmark( sfh, skeys, smisses, rounds, "FlatHashtable<String>" );
+}
+
+static int test()
+{
+	testInterface();
+	testChurn();
+	testCapacity();
+	testHeterogeneousLookup();
+
+	printf( "Hashtable benchmark:\n" );
+	benchmark( 100 );
+	benchmark( 10000 );
+	benchmark( 200000 );
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+static tester::Test reg( test, __FILE__ );
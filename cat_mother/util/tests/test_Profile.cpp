@@ -2,9 +2,8 @@
 #include <dev/Profile.h>
 #include <dev/TimeStamp.h>
 #include <lang/Thread.h>
-#include <lang/String.h>
 #include <assert.h>
-#include <time.h>
+#include <string.h>
 #include <stdio.h>
 
 //-----------------------------------------------------------------------------
@@ -14,21 +13,59 @@ using namespace lang;
 
 //-----------------------------------------------------------------------------
 
+/** Runs busy loop for specified number of seconds. */
+static void spin( double seconds )
+{
+	TimeStamp t0;
+	while ( (TimeStamp()-t0).seconds() < seconds );
+}
+
+/** Returns profiled scope by name or 0 if not found. */
+static Profile::BlockInfo* find( const char* name )
+{
+	for ( int i = 0 ; i < Profile::count() ; ++i )
+	{
+		Profile::BlockInfo* bl = Profile::get(i);
+		if ( !strcmp(bl->name(),name) )
+			return bl;
+	}
+	return 0;
+}
+
+/** Returns total count of profiled scopes by name and updates largest thread index which executed them. */
+static int countAll( const char* name, int* maxThread )
+{
+	int count = 0;
+	for ( int i = 0 ; i < Profile::count() ; ++i )
+	{
+		Profile::BlockInfo* bl = Profile::get(i);
+		if ( !strcmp(bl->name(),name) )
+		{
+			count += bl->count();
+			if ( bl->thread() > *maxThread )
+				*maxThread = bl->thread();
+		}
+	}
+	return count;
+}
+
+static void check( double x, double y )
+{
+	// reference timer accuracy isn't too great so allow some error
+	const double margin = 0.05;
+	assert( (x-y) < margin && (x-y) > -margin );
+}
+
+//-----------------------------------------------------------------------------
+
 class Th1 :
 	public Thread
 {
 public:
 	void run()
 	{
-		TimeStamp c0 = TimeStamp::currentTime();
-		{
-			Profile pr("Th1");
-			clock_t clock0 = clock();
-			while ( double(clock()-clock0)/double(CLOCKS_PER_SEC) < 1.0 );
-		}
-		TimeStamp c1 = TimeStamp::currentTime();
-		printf( "Th1 run %f seconds\n", (c1-c0).seconds() );
-		fflush( stdout );
+		Profile pr("testProfileTh1");
+		spin( 0.1 );
 	}
 };
 
@@ -38,57 +75,128 @@ class Th2 :
 public:
 	void run()
 	{
-		TimeStamp c0 = TimeStamp::currentTime();
-		{
-			Profile pr("Th2");
-			clock_t clock0 = clock();
-			while ( double(clock()-clock0)/double(CLOCKS_PER_SEC) < 2.0 );
-		}
-		TimeStamp c1 = TimeStamp::currentTime();
-		printf( "Th2 run %f seconds\n", (c1-c0).seconds() );
-		fflush( stdout );
+		Profile pr("testProfileTh2");
+		spin( 0.2 );
 	}
 };
 
 //-----------------------------------------------------------------------------
 
-static void check( double x, double y )
+static void testNesting()
 {
-	// reference clock() accuracy isn't too great so allow some error
-	const float margin = 0.5f;
-	assert( (x-y) < margin && (x-y) > -margin );
-}
+	Profile::reset();
 
-//-----------------------------------------------------------------------------
+	const int frames = 10;
+	for ( int i = 0 ; i < frames ; ++i )
+	{
+		{
+			Profile pr1("testProfileOuter");
+			{
+				Profile pr2("testProfileInner");
+				spin( i == frames-1 ? 0.05 : 0.01 );
+			}
+		}
+		Profile::endFrame();
+	}
 
-static int test()
+	Profile::BlockInfo* outer = find("testProfileOuter");
+	Profile::BlockInfo* inner = find("testProfileInner");
+	assert( outer && inner );
+	assert( outer->count() == frames && inner->count() == frames );
+	assert( inner->depth() == outer->depth()+1 );
+	assert( inner->thread() == outer->thread() );
+	assert( outer->time() >= inner->time() );
+	check( inner->time(), 0.01*(frames-1)+0.05 );
+
+	// last frame is a spike
+	check( inner->percentile(50), 0.01 );
+	check( inner->percentile(100), 0.05 );
+	check( inner->frameTime(), 0.05 );
+	assert( inner->percentile(50) <= inner->percentile(95) );
+	assert( inner->percentile(95) <= inner->percentile(100) );
+
+	Profile::reset();
+	assert( 0 == inner->count() && 0.0 == inner->time() );
+	assert( 0.0 == inner->percentile(50) );
+}
+
+static void testThreads()
 {
-	{Profile pr("init");}		// force timer initialization
-	
+	{Profile pr("testProfileMain");}
+
 	P(Th1) th1 = new Th1;
 	P(Th2) th2 = new Th2;
 	th1->start();
 	th2->start();
 	th1->join();
 	th2->join();
+	th1 = new Th1;
+	th2 = new Th2;
 	th1->start();
 	th2->start();
 	th2->join();
 	th1->join();
 
-	for ( int i = 0 ; i < Profile::count() ; ++i )
+	Profile::BlockInfo* bl0 = find("testProfileMain");
+	Profile::BlockInfo* bl1 = find("testProfileTh1");
+	Profile::BlockInfo* bl2 = find("testProfileTh2");
+	assert( bl0 && bl1 && bl2 );
+	assert( bl1->depth() == 0 && bl2->depth() == 0 );
+	assert( bl1->thread() != bl0->thread() && bl2->thread() != bl0->thread() );
+	assert( bl1->time() > 0.0 && bl2->time() > 0.0 );
+
+	// second pair reuses buffers of the exited threads
+	int maxThread = bl0->thread();
+	assert( 2 == countAll("testProfileTh1",&maxThread) );
+	assert( 2 == countAll("testProfileTh2",&maxThread) );
+	assert( maxThread <= bl0->thread()+2 );
+
+	// threads restarted every frame don't add buffers
+	for ( int i = 0 ; i < 10 ; ++i )
 	{
-		Profile::BlockInfo* bl = Profile::get(i);
+		th1 = new Th1;
+		th1->start();
+		th1->join();
+	}
+	assert( 12 == countAll("testProfileTh1",&maxThread) );
+	assert( maxThread <= bl0->thread()+2 );
+}
 
-		if ( String(bl->name()) == "Th1" )
-		{
-			check( bl->time(), 2 );
-		}
-		else if ( String(bl->name()) == "Th2" )
-		{
-			check( bl->time(), 4 );
-		}
+static void testChromeTrace()
+{
+	Profile::setTraceFrames( 2 );
+	for ( int i = 0 ; i < 3 ; ++i )
+	{
+		{Profile pr("testProfile\"Trace\"");}
+		Profile::endFrame();
 	}
+
+	const char* filename = "test_Profile.json";
+	bool saved = Profile::saveChromeTrace( filename );
+	assert( saved );
+	Profile::setTraceFrames( 0 );
+
+	FILE* fh = fopen( filename, "rt" );
+	assert( fh );
+	char buf[4096];
+	int len = fread( buf, 1, sizeof(buf)-1, fh );
+	buf[len] = 0;
+	fclose( fh );
+	remove( filename );
+
+	// only kept frames are saved and names are escaped
+	assert( !strncmp(buf,"{\"traceEvents\":[",16) );
+	int events = 0;
+	for ( const char* s = buf ; 0 != (s = strstr(s,"testProfile\\\"Trace\\\"")) ; ++s )
+		++events;
+	assert( 2 == events );
+}
+
+static int test()
+{
+	testNesting();
+	testThreads();
+	testChromeTrace();
 	return 0;
 }
 
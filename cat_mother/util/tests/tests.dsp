@@ -89,6 +89,10 @@ SOURCE=.\test_ExProperties.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\test_FlatHashtable.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\test_Hashtable.cpp
 # End Source File
 # Begin Source File
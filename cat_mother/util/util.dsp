@@ -101,6 +101,14 @@ SOURCE=.\Random.cpp
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=.\FlatHashtable.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\FlatHashtable.inl
+# End Source File
+# Begin Source File
+
 SOURCE=.\Hashtable.h
 # End Source File
 # Begin Source File
@@ -0,0 +1,252 @@
+#include "MappedArchive.h"
+#include "MappedFile.h"
+#include "ArchiveFormat.h"
+#include "MemoryInputStream.h"
+#include "InflateInputStream.h"
+#include <io/IOException.h>
+#include <io/FileInputStream.h>
+#include <lang/Debug.h>
+#include <lang/String.h>
+#include <util/Vector.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include "config.h"
+
+//-----------------------------------------------------------------------------
+
+using namespace io;
+using namespace lang;
+using namespace util;
+
+//-----------------------------------------------------------------------------
+
+namespace util
+{
+namespace zip
+{
+
+
+//-----------------------------------------------------------------------------
+
+class MappedArchive::MappedArchiveImpl :
+	public Object
+{
+public:
+	/** Decoded directory entry. */
+	struct Entry
+	{
+		uint32_t		hash;
+		int				next;
+		const char*		name;
+		int				nameLength;
+		const uint8_t*	data;
+		long			size;
+		long			packedSize;
+		int				method;
+	};
+
+	P(MappedFile)		file;
+	Vector<int>			buckets;
+	Vector<Entry>		entries;
+	Vector<uint8_t>		used;
+	String				name;
+
+	MappedArchiveImpl() :
+		Object( OBJECT_INITMUTEX ),
+		buckets( Allocator<int>(__FILE__,__LINE__) ),
+		entries( Allocator<Entry>(__FILE__,__LINE__) ),
+		used( Allocator<uint8_t>(__FILE__,__LINE__) ),
+		name( "" )
+	{
+	}
+
+	void markUsed( int index )
+	{
+		synchronized( this );
+		used[index] = 1;
+	}
+
+private:
+	MappedArchiveImpl( const MappedArchiveImpl& );
+	MappedArchiveImpl& operator=( const MappedArchiveImpl& );
+};
+
+//-----------------------------------------------------------------------------
+
+static String stripPath( const String& name )
+{
+	String str;
+	int end = name.lastIndexOf('/');
+	int end2 = name.lastIndexOf('\\');
+	if ( end2 > end )
+		end = end2;
+	if ( end >= 0 && end+1 < name.length() )
+		str = name.substring( end+1 );
+	else
+		str = name;
+	return str;
+}
+
+/** Returns true if [begin,begin+size) is inside [0,limit). Uses 64-bit arithmetic since long may be 32-bit. */
+static bool inside( int64_t begin, int64_t size, int64_t limit )
+{
+	return begin >= 0 && size >= 0 && begin <= limit && size <= limit-begin;
+}
+
+//-----------------------------------------------------------------------------
+
+MappedArchive::MappedArchive( const String& name )
+{
+	m_this = new MappedArchiveImpl;
+	m_this->name = name;
+	m_this->file = new MappedFile( name );
+
+	const uint8_t* data = reinterpret_cast<const uint8_t*>( m_this->file->data() );
+	const long size = m_this->file->size();
+	const Format err( "Invalid archive file: {0}", name );
+
+	// header
+	if ( size < ARCHIVE_HEADER_SIZE || ARCHIVE_MAGIC != readArchiveInt(data) )
+		throw IOException( err );
+	if ( ARCHIVE_VERSION != readArchiveInt(data+4) )
+		throw IOException( Format("Unsupported archive version in {0}",name) );
+	const int entries = readArchiveInt( data+8 );
+	const int buckets = readArchiveInt( data+12 );
+	const long namesOffset = readArchiveInt( data+16 );
+	const long namesSize = readArchiveInt( data+20 );
+	if ( entries < 0 || buckets <= 0 || 0 != (buckets & (buckets-1)) ||
+		!inside(namesOffset,namesSize,size) ||
+		!inside(ARCHIVE_HEADER_SIZE,buckets*(int64_t)4+entries*(int64_t)ARCHIVE_ENTRY_SIZE,size) )
+		throw IOException( err );
+
+	// hash buckets
+	const uint8_t* bucket = data + ARCHIVE_HEADER_SIZE;
+	m_this->buckets.setSize( buckets );
+	int i;
+	for ( i = 0 ; i < buckets ; ++i )
+	{
+		int first = readArchiveInt( bucket+i*4 );
+		if ( first < -1 || first >= entries )
+			throw IOException( err );
+		m_this->buckets[i] = first;
+	}
+
+	// directory entries (data itself is not touched)
+	const uint8_t* dir = bucket + buckets*4;
+	m_this->entries.setSize( entries );
+	for ( i = 0 ; i < entries ; ++i )
+	{
+		const uint8_t* p = dir + i*ARCHIVE_ENTRY_SIZE;
+		MappedArchiveImpl::Entry& entry = m_this->entries[i];
+		entry.hash = (uint32_t)readArchiveInt( p );
+		entry.next = readArchiveInt( p+4 );
+		long nameOffset = readArchiveInt( p+8 );
+		entry.nameLength = readArchiveInt( p+12 );
+		long dataOffset = readArchiveInt( p+16 );
+		entry.size = readArchiveInt( p+20 );
+		entry.packedSize = readArchiveInt( p+24 );
+		entry.method = readArchiveInt( p+28 );
+
+		if ( entry.next < -1 || entry.next >= entries || entry.size < 0 ||
+			!inside(nameOffset,entry.nameLength,namesSize) ||
+			!inside(dataOffset,entry.packedSize,size) ||
+			(ARCHIVE_STORED == entry.method && entry.packedSize != entry.size) ||
+			(ARCHIVE_STORED != entry.method && ARCHIVE_DEFLATED != entry.method) )
+			throw IOException( err );
+
+		entry.name = reinterpret_cast<const char*>( data + namesOffset + nameOffset );
+		entry.data = data + dataOffset;
+	}
+
+	m_this->used.setSize( entries );
+	for ( i = 0 ; i < entries ; ++i )
+		m_this->used[i] = 0;
+}
+
+void MappedArchive::close()
+{
+	Debug::println( "Unused zip entries in {0}:", m_this->name );
+	for ( int i = 0 ; i < (int)m_this->entries.size() ; ++i )
+	{
+		if ( !m_this->used[i] )
+			Debug::println( "  {0}", getEntry(i) );
+	}
+	Debug::println( "<end of unused zip entries>" );
+}
+
+int MappedArchive::findEntry( const String& name ) const
+{
+	char namebuff[1024];
+	int len = stripPath(name).toLowerCase().getBytes( namebuff, sizeof(namebuff), "ASCII-7" );
+	if ( len >= (int)sizeof(namebuff) )
+		return -1;
+
+	uint32_t hash = archiveHash( namebuff, len );
+	int index = m_this->buckets[ hash & (m_this->buckets.size()-1) ];
+	while ( index >= 0 )
+	{
+		const MappedArchiveImpl::Entry& entry = m_this->entries[index];
+		if ( entry.hash == hash && entry.nameLength == len && 0 == memcmp(entry.name,namebuff,len) )
+			return index;
+		index = entry.next;
+	}
+	return -1;
+}
+
+InputStream* MappedArchive::getInputStream( const String& name )
+{
+	int index = findEntry( name );
+	if ( index >= 0 )
+		return getInputStream( index );
+
+	return new FileInputStream( name );
+}
+
+InputStream* MappedArchive::getInputStream( int index )
+{
+	assert( index >= 0 && index < size() );
+	const MappedArchiveImpl::Entry& entry = m_this->entries[index];
+	m_this->markUsed( index );
+
+	// streams keep the mapping alive
+	String streamName = m_this->name + "/" + getEntry(index);
+	if ( ARCHIVE_STORED == entry.method )
+		return new MemoryInputStream( m_this->file, entry.data, entry.size, streamName );
+	else
+		return new InflateInputStream( m_this->file, entry.data, entry.packedSize, entry.size, streamName );
+}
+
+lang::String MappedArchive::getEntry( int index ) const
+{
+	assert( index >= 0 && index < size() );
+	const MappedArchiveImpl::Entry& entry = m_this->entries[index];
+	return String( entry.name, entry.nameLength );
+}
+
+int MappedArchive::size() const
+{
+	return m_this->entries.size();
+}
+
+String MappedArchive::toString() const
+{
+	return m_this->name;
+}
+
+long MappedArchive::getEntrySize( int index ) const
+{
+	assert( index >= 0 && index < size() );
+	return m_this->entries[index].size;
+}
+
+const void* MappedArchive::getEntryData( int index ) const
+{
+	assert( index >= 0 && index < size() );
+	const MappedArchiveImpl::Entry& entry = m_this->entries[index];
+	return ARCHIVE_STORED == entry.method ? entry.data : 0;
+}
+
+
+} // zip
+} // util
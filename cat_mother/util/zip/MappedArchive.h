@@ -0,0 +1,94 @@
+#ifndef _UTIL_ZIP_MAPPEDARCHIVE_H
+#define _UTIL_ZIP_MAPPEDARCHIVE_H
+
+
+#include <io/InputStreamArchive.h>
+
+
+namespace io {
+	class InputStream;}
+
+namespace lang {
+	class String;}
+
+
+namespace util 
+{ 
+namespace zip
+{
+
+
+/** 
+ * Indexed archive (written by zar) mapped to memory.
+ * Opening the archive only validates the directory,
+ * entry data is paged in when it is read. Entries are found
+ * by hashed name lookup. Stored entries are read directly
+ * from the mapping and deflated entries are decompressed
+ * incrementally while the returned stream is read.
+ * The archive can be used from multiple threads at the same time.
+ * @see ArchiveFormat
+ */
+class MappedArchive :
+	public io::InputStreamArchive
+{
+public:
+	/** 
+	 * Opens an archive file. 
+	 * @exception IOException
+	 */
+	explicit MappedArchive( const lang::String& name );
+
+	/** Closes the archive and lists entries which were not used. */
+	void				close();
+
+	/** 
+	 * Returns input stream to specified entry. 
+	 * If the entry is not in the archive then the name is opened as a file.
+	 * @exception IOException
+	 */
+	io::InputStream*	getInputStream( const lang::String& name );
+
+	/** 
+	 * Returns input stream to ith entry. 
+	 * @exception IOException
+	 */
+	io::InputStream*	getInputStream( int index );
+
+	/** Returns ith entry. */
+	lang::String		getEntry( int index ) const;
+
+	/** Returns number of entries in the archive. */
+	int					size() const;
+
+	/** Returns name of the archive. */
+	lang::String		toString() const;
+
+	/** 
+	 * Returns index of specified entry or -1 if not found.
+	 * Path and case of the name are ignored.
+	 */
+	int					findEntry( const lang::String& name ) const;
+
+	/** Returns uncompressed size of ith entry in bytes. */
+	long				getEntrySize( int index ) const;
+
+	/** 
+	 * Returns pointer to data of ith entry or 0 if the entry is compressed. 
+	 * The data is valid as long as the archive object exists.
+	 */
+	const void*			getEntryData( int index ) const;
+
+private:
+	class MappedArchiveImpl;
+	P(MappedArchiveImpl) m_this;
+
+	MappedArchive( const MappedArchive& );
+	MappedArchive& operator=( const MappedArchive& );
+};
+
+
+} // zip
+} // util
+
+
+#endif // _UTIL_ZIP_MAPPEDARCHIVE_H
@@ -0,0 +1,70 @@
+#ifndef _UTIL_ZIP_ARCHIVEFORMAT_H
+#define _UTIL_ZIP_ARCHIVEFORMAT_H
+
+
+#include <stdint.h>
+
+
+namespace util
+{
+namespace zip
+{
+
+
+/**
+ * Layout of the indexed archive written by zar and read by MappedArchive.
+ * All integers are 32-bit big-endian.
+ *
+ * Header (ARCHIVE_HEADER_SIZE bytes):
+ *   magic, version, entry count, hash bucket count (power of two),
+ *   names offset, names size
+ *
+ * Hash buckets (4 bytes each): index of the first entry in the bucket or -1.
+ *
+ * Entries (ARCHIVE_ENTRY_SIZE bytes each):
+ *   name hash, next entry in the same bucket (or -1),
+ *   name offset, name length, data offset, data size (uncompressed),
+ *   packed size, compression method
+ *
+ * Names are lowercase ASCII without path and without terminating zero.
+ * Entry data is aligned to ARCHIVE_ALIGNMENT bytes from the start of the file.
+ * Deflated entries are in zlib format.
+ */
+enum ArchiveFormat
+{
+	/** 'ZAR2' */
+	ARCHIVE_MAGIC			= 0x5A415232,
+	ARCHIVE_VERSION			= 1,
+	ARCHIVE_HEADER_SIZE		= 24,
+	ARCHIVE_ENTRY_SIZE		= 32,
+	ARCHIVE_ALIGNMENT		= 16,
+	/** Entry data is stored as is. */
+	ARCHIVE_STORED			= 0,
+	/** Entry data is compressed with deflate. */
+	ARCHIVE_DEFLATED		= 1
+};
+
+/** Returns FNV-1a hash of the (lowercase) entry name. */
+inline uint32_t archiveHash( const char* name, int len )
+{
+	uint32_t h = 2166136261U;
+	for ( int i = 0 ; i < len ; ++i )
+	{
+		h ^= (uint8_t)name[i];
+		h *= 16777619U;
+	}
+	return h;
+}
+
+/** Reads 32-bit big-endian integer. */
+inline int32_t readArchiveInt( const uint8_t* p )
+{
+	return (int32_t)( (uint32_t(p[0])<<24) | (uint32_t(p[1])<<16) | (uint32_t(p[2])<<8) | uint32_t(p[3]) );
+}
+
+
+} // zip
+} // util
+
+
+#endif // _UTIL_ZIP_ARCHIVEFORMAT_H
@@ -0,0 +1,103 @@
+#include "InflateInputStream.h"
+#include <io/IOException.h>
+#include <memory.h>
+#include <stdint.h>
+#include "config.h"
+
+//-----------------------------------------------------------------------------
+
+using namespace io;
+using namespace lang;
+
+//-----------------------------------------------------------------------------
+
+namespace util
+{
+
+
+InflateInputStream::InflateInputStream( Object* dataOwner, const void* data, long packedSize, long size, const String& name )
+{
+	m_dataOwner		= dataOwner;
+	m_data			= data;
+	m_packedSize	= packedSize;
+	m_size			= size;
+	m_ptr			= 0;
+	m_mark			= 0;
+	m_name			= name;
+
+	memset( &m_stream, 0, sizeof(m_stream) );
+	m_stream.next_in = reinterpret_cast<Bytef*>( const_cast<void*>(data) );
+	m_stream.avail_in = packedSize;
+	if ( Z_OK != inflateInit(&m_stream) )
+		throw IOException( Format("Failed to decompress {0}",m_name) );
+}
+
+InflateInputStream::~InflateInputStream()
+{
+	inflateEnd( &m_stream );
+}
+
+long InflateInputStream::read( void* data, long size )
+{
+	long left = m_size - m_ptr;
+	if ( size > left )
+		size = left;
+	if ( size <= 0 )
+		return 0;
+
+	m_stream.next_out = reinterpret_cast<Bytef*>( data );
+	m_stream.avail_out = size;
+	while ( m_stream.avail_out > 0 )
+	{
+		int err = inflate( &m_stream, Z_SYNC_FLUSH );
+		if ( Z_STREAM_END == err )
+			break;
+		if ( Z_OK != err )
+			throw IOException( Format("Failed to decompress {0}",m_name) );
+	}
+
+	long bytes = size - m_stream.avail_out;
+	if ( bytes != size )
+		throw IOException( Format("Failed to decompress {0}",m_name) );
+	m_ptr += bytes;
+	return bytes;
+}
+
+void InflateInputStream::mark( int /*readlimit*/ )
+{
+	m_mark = m_ptr;
+}
+
+void InflateInputStream::reset()
+{
+	// deflate streams can't be rewound, so decompress again up to the mark
+	restart();
+	skip( m_mark );
+}
+
+bool InflateInputStream::markSupported() const
+{
+	return true;
+}
+
+long InflateInputStream::available() const
+{
+	return m_size - m_ptr;
+}
+
+String InflateInputStream::toString() const
+{
+	return m_name;
+}
+
+void InflateInputStream::restart()
+{
+	if ( Z_OK != inflateReset(&m_stream) )
+		throw IOException( Format("Failed to decompress {0}",m_name) );
+	m_stream.next_in = reinterpret_cast<Bytef*>( const_cast<void*>(m_data) );
+	m_stream.avail_in = m_packedSize;
+	m_ptr = 0;
+}
+
+
+} // util
@@ -0,0 +1,63 @@
+#ifndef _INFLATEINPUTSTREAM_H
+#define _INFLATEINPUTSTREAM_H
+
+
+#include <io/InputStream.h>
+#include <lang/String.h>
+#include <zlib.h>
+
+
+namespace util
+{
+
+
+/**
+ * Class for reading deflated (zlib format) data from memory.
+ * Data is decompressed incrementally as it is read.
+ */
+class InflateInputStream :
+	public io::InputStream
+{
+public:
+	/**
+	 * Starts decompressing the data.
+	 * @param dataOwner Object which keeps the compressed data alive.
+	 * @param data Compressed data.
+	 * @param packedSize Size of the compressed data in bytes.
+	 * @param size Size of the decompressed data in bytes.
+	 * @param name Name of the stream.
+	 * @exception IOException
+	 */
+	InflateInputStream( lang::Object* dataOwner, const void* data, long packedSize, long size, const lang::String& name );
+
+	///
+	~InflateInputStream();
+
+	long			read( void* data, long size );
+	void			mark( int readlimit );
+	void			reset();
+	bool			markSupported() const;
+	long			available() const;
+	lang::String	toString() const;
+
+private:
+	P(lang::Object)		m_dataOwner;
+	const void*			m_data;
+	long				m_packedSize;
+	long				m_ptr;
+	long				m_size;
+	long				m_mark;
+	lang::String		m_name;
+	z_stream			m_stream;
+
+	void	restart();
+
+	InflateInputStream( const InflateInputStream& );
+	InflateInputStream& operator=( const InflateInputStream& );
+};
+
+
+} // util
+
+
+#endif // _INFLATEINPUTSTREAM_H
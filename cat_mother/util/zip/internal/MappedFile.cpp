@@ -0,0 +1,111 @@
+#include "MappedFile.h"
+#include <io/IOException.h>
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "config.h"
+
+//-----------------------------------------------------------------------------
+
+using namespace io;
+using namespace lang;
+
+//-----------------------------------------------------------------------------
+
+namespace util
+{
+
+
+MappedFile::MappedFile( const String& name ) :
+	m_data( 0 ),
+	m_size( 0 ),
+	m_file( 0 ),
+	m_mapping( 0 )
+{
+	char namebuff[2048];
+	name.getBytes( namebuff, sizeof(namebuff), "ASCII-7" );
+
+#ifdef WIN32
+	HANDLE file = CreateFile( namebuff, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL|FILE_FLAG_RANDOM_ACCESS, 0 );
+	if ( INVALID_HANDLE_VALUE == file )
+		throw IOException( Format("Failed to open file: {0}",name) );
+	m_file = file;
+	m_size = (long)GetFileSize( file, 0 );
+
+	if ( m_size > 0 )
+	{
+		HANDLE mapping = CreateFileMapping( file, 0, PAGE_READONLY, 0, 0, 0 );
+		if ( !mapping )
+		{
+			unmap();
+			throw IOException( Format("Failed to map file: {0}",name) );
+		}
+		m_mapping = mapping;
+
+		m_data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+		if ( !m_data )
+		{
+			unmap();
+			throw IOException( Format("Failed to map file: {0}",name) );
+		}
+	}
+#else
+	int fd = open( namebuff, O_RDONLY );
+	if ( fd < 0 )
+		throw IOException( Format("Failed to open file: {0}",name) );
+
+	struct stat st;
+	if ( 0 != fstat(fd,&st) )
+	{
+		::close( fd );
+		throw IOException( Format("Failed to open file: {0}",name) );
+	}
+	m_size = (long)st.st_size;
+
+	if ( m_size > 0 )
+	{
+		void* data = mmap( 0, m_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if ( MAP_FAILED == data )
+		{
+			::close( fd );
+			throw IOException( Format("Failed to map file: {0}",name) );
+		}
+		m_data = data;
+	}
+
+	// mapping stays valid after the descriptor is closed
+	::close( fd );
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	unmap();
+}
+
+void MappedFile::unmap()
+{
+#ifdef WIN32
+	if ( m_data )
+		UnmapViewOfFile( m_data );
+	if ( m_mapping )
+		CloseHandle( m_mapping );
+	if ( m_file )
+		CloseHandle( m_file );
+#else
+	if ( m_data )
+		munmap( const_cast<void*>(m_data), m_size );
+#endif
+	m_data = 0;
+	m_mapping = 0;
+	m_file = 0;
+}
+
+
+} // util
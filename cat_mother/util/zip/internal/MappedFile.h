@@ -0,0 +1,53 @@
+#ifndef _MAPPEDFILE_H
+#define _MAPPEDFILE_H
+
+
+#include <lang/Object.h>
+#include <lang/String.h>
+
+
+namespace util
+{
+
+
+/**
+ * Read-only view of a whole file mapped to memory.
+ * Pages are loaded by the OS on demand, so opening
+ * a large file doesn't read it.
+ */
+class MappedFile :
+	public lang::Object
+{
+public:
+	/**
+	 * Maps specified file to memory.
+	 * @exception IOException
+	 */
+	explicit MappedFile( const lang::String& name );
+
+	///
+	~MappedFile();
+
+	/** Returns pointer to the beginning of the file data. */
+	const void*		data() const				{return m_data;}
+
+	/** Returns size of the file in bytes. */
+	long			size() const				{return m_size;}
+
+private:
+	const void*		m_data;
+	long			m_size;
+	void*			m_file;
+	void*			m_mapping;
+
+	void	unmap();
+
+	MappedFile( const MappedFile& );
+	MappedFile& operator=( const MappedFile& );
+};
+
+
+} // util
+
+
+#endif // _MAPPEDFILE_H
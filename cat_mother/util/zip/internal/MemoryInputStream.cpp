@@ -54,6 +54,17 @@ long MemoryInputStream::available() const
 	return m_size - m_ptr;
 }
 
+long MemoryInputStream::readDirect( const void** data, long size )
+{
+	long left = m_size - m_ptr;
+	if ( size > left )
+		size = left;
+
+	*data = reinterpret_cast<const uint8_t*>(m_data)+m_ptr;
+	m_ptr += size;
+	return size;
+}
+
 String MemoryInputStream::toString() const
 {
 	return m_name;
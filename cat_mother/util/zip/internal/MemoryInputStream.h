@@ -25,6 +25,7 @@ public:
 	void			reset();
 	bool			markSupported() const;
 	long			available() const;
+	long			readDirect( const void** data, long size );
 	lang::String	toString() const;
 
 private:
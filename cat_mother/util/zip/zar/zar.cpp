@@ -2,8 +2,10 @@
  * Small in-house command line zip file utility.
  * @author Jani Kajala (jani.kajala@helsinki.fi)
  */
+#include "../internal/ArchiveFormat.h"
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
 #include <direct.h>
 #include <io.h>
 #include <string>
@@ -97,35 +99,6 @@ static void reverse( uint8_t* begin, uint8_t* end )
 	}
 }
 
-static void writeInt( gzFile file, int value )
-{
-	int32_t v = value;
-	uint8_t* bytes = reinterpret_cast<uint8_t*>( &v );
-	if ( !bigEndian() )
-		reverse( bytes, bytes+sizeof(v) );
-	gzwrite( file, bytes, sizeof(int32_t) );
-}
-
-static void writeString( gzFile file, const char* str )
-{
-	int len = strlen(str);
-	writeInt( file, len );
-
-	int i;
-	for ( i = 0 ; i < len ; ++i )
-	{
-		char ch = str[i];
-		ch &= 0x7F;
-		gzwrite( file, &ch, 1 );
-	}
-}
-
-static void writeBytes( gzFile file, const uint8_t* bytes, int count )
-{
-	writeInt( file, count );
-	gzwrite( file, (void*)bytes, count );
-}
-
 static int readInt( gzFile file )
 {
 	int32_t v = 0;
@@ -156,6 +129,206 @@ static void readBytes( gzFile file, std::vector<uint8_t>& bytes )
 	gzread( file, bytes.begin(), count );
 }
 
+static std::string toLower( const std::string& str )
+{
+	std::string s = str;
+	for ( int i = 0 ; i < (int)s.size() ; ++i )
+		s[i] = (char)tolower( s[i] & 0x7F );
+	return s;
+}
+
+static void putInt( std::vector<uint8_t>& buf, int offset, int value )
+{
+	uint32_t v = (uint32_t)value;
+	buf[offset+0] = (uint8_t)(v >> 24);
+	buf[offset+1] = (uint8_t)(v >> 16);
+	buf[offset+2] = (uint8_t)(v >> 8);
+	buf[offset+3] = (uint8_t)v;
+}
+
+/** Reads files from old gzipped archive. */
+static bool readGzipArchive( const char* name, std::vector<File>& files )
+{
+	gzFile zip = gzopen( name, "rb" );
+	if ( !zip )
+		return false;
+
+	int count = readInt( zip );
+	files.resize( count );
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		File& file = files[i];
+		readString( zip, file.name );
+		readBytes( zip, file.data );
+	}
+	gzclose( zip );
+	return true;
+}
+
+/** Reads files from indexed archive or old gzipped archive. */
+static bool readArchive( const char* name, std::vector<File>& files )
+{
+	using namespace util::zip;
+
+	FILE* fh = fopen( name, "rb" );
+	if ( !fh )
+		return false;
+	std::vector<uint8_t> buf;
+	fseek( fh, 0, SEEK_END );
+	buf.resize( ftell( fh ) );
+	fseek( fh, 0, SEEK_SET );
+	fread( buf.begin(), 1, buf.size(), fh );
+	bool ok = !ferror(fh);
+	fclose( fh );
+	if ( !ok )
+		return false;
+
+	if ( buf.size() < ARCHIVE_HEADER_SIZE || ARCHIVE_MAGIC != readArchiveInt(buf.begin()) )
+		return readGzipArchive( name, files );
+
+	const uint8_t* data = buf.begin();
+	int count = readArchiveInt( data+8 );
+	int buckets = readArchiveInt( data+12 );
+	int namesOffset = readArchiveInt( data+16 );
+	const uint8_t* dir = data + ARCHIVE_HEADER_SIZE + buckets*4;
+
+	files.resize( count );
+	for ( int i = 0 ; i < count ; ++i )
+	{
+		const uint8_t* p = dir + i*ARCHIVE_ENTRY_SIZE;
+		int nameOffset = readArchiveInt( p+8 );
+		int nameLength = readArchiveInt( p+12 );
+		int dataOffset = readArchiveInt( p+16 );
+		int size = readArchiveInt( p+20 );
+		int packedSize = readArchiveInt( p+24 );
+		int method = readArchiveInt( p+28 );
+
+		File& file = files[i];
+		file.name.assign( reinterpret_cast<const char*>(data+namesOffset+nameOffset), nameLength );
+		file.data.resize( size );
+		if ( ARCHIVE_STORED == method )
+		{
+			memcpy( file.data.begin(), data+dataOffset, size );
+		}
+		else
+		{
+			uLongf destLen = size;
+			if ( Z_OK != uncompress(file.data.begin(), &destLen, data+dataOffset, packedSize) || (int)destLen != size )
+			{
+				printf( "Failed to decompress %s\n", file.name.c_str() );
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/** 
+ * Writes files to indexed archive. 
+ * Each file is deflated unless it doesn't compress well enough.
+ */
+static bool writeArchive( const char* name, const std::vector<File>& files )
+{
+	using namespace util::zip;
+
+	const int count = files.size();
+	int buckets = 1;
+	while ( buckets < count )
+		buckets <<= 1;
+
+	// names
+	std::vector<std::string> names( count );
+	std::vector<int> nameOffsets( count );
+	int namesSize = 0;
+	int i;
+	for ( i = 0 ; i < count ; ++i )
+	{
+		names[i] = toLower( files[i].name );
+		nameOffsets[i] = namesSize;
+		namesSize += names[i].size();
+	}
+
+	// hash chains, entries in a bucket are kept in file order
+	std::vector<int> first( buckets, -1 );
+	std::vector<int> last( buckets, -1 );
+	std::vector<int> next( count, -1 );
+	std::vector<uint32_t> hashes( count );
+	for ( i = 0 ; i < count ; ++i )
+	{
+		hashes[i] = archiveHash( names[i].c_str(), names[i].size() );
+		int b = hashes[i] & (buckets-1);
+		if ( last[b] < 0 )
+			first[b] = i;
+		else
+			next[last[b]] = i;
+		last[b] = i;
+	}
+
+	const int dirSize = ARCHIVE_HEADER_SIZE + buckets*4 + count*ARCHIVE_ENTRY_SIZE;
+	const int namesOffset = dirSize;
+	std::vector<uint8_t> buf( dirSize+namesSize );
+	putInt( buf, 0, ARCHIVE_MAGIC );
+	putInt( buf, 4, ARCHIVE_VERSION );
+	putInt( buf, 8, count );
+	putInt( buf, 12, buckets );
+	putInt( buf, 16, namesOffset );
+	putInt( buf, 20, namesSize );
+	for ( i = 0 ; i < buckets ; ++i )
+		putInt( buf, ARCHIVE_HEADER_SIZE+i*4, first[i] );
+	for ( i = 0 ; i < count ; ++i )
+		memcpy( buf.begin()+namesOffset+nameOffsets[i], names[i].c_str(), names[i].size() );
+
+	// entry data
+	std::vector<uint8_t> packed;
+	int stored = 0;
+	for ( i = 0 ; i < count ; ++i )
+	{
+		const File& file = files[i];
+		const int size = file.data.size();
+		printf( "Compressing %s...\n", file.name.c_str() );
+
+		while ( buf.size() % ARCHIVE_ALIGNMENT != 0 )
+			buf.push_back( 0 );
+		const int dataOffset = buf.size();
+
+		// store if deflate saves less than 1/8
+		uLongf packedSize = size + size/1000 + 12;
+		packed.resize( packedSize );
+		int method = ARCHIVE_DEFLATED;
+		if ( size < 64 || Z_OK != compress2(packed.begin(), &packedSize, file.data.begin(), size, Z_BEST_COMPRESSION) ||
+			(int)packedSize > size - size/8 )
+		{
+			method = ARCHIVE_STORED;
+			packedSize = size;
+			buf.insert( buf.end(), file.data.begin(), file.data.end() );
+			++stored;
+		}
+		else
+		{
+			buf.insert( buf.end(), packed.begin(), packed.begin()+packedSize );
+		}
+
+		const int entry = ARCHIVE_HEADER_SIZE + buckets*4 + i*ARCHIVE_ENTRY_SIZE;
+		putInt( buf, entry+0, hashes[i] );
+		putInt( buf, entry+4, next[i] );
+		putInt( buf, entry+8, nameOffsets[i] );
+		putInt( buf, entry+12, names[i].size() );
+		putInt( buf, entry+16, dataOffset );
+		putInt( buf, entry+20, size );
+		putInt( buf, entry+24, packedSize );
+		putInt( buf, entry+28, method );
+	}
+
+	printf( "Writing %s (%i entries, %i stored)...\n", name, count, stored );
+	FILE* fh = fopen( name, "wb" );
+	if ( !fh )
+		return false;
+	fwrite( buf.begin(), 1, buf.size(), fh );
+	bool ok = !ferror(fh);
+	fclose( fh );
+	return ok;
+}
+
 //-----------------------------------------------------------------------------
 
 int main( int argc, char* argv[] )
@@ -197,7 +370,7 @@ int main( int argc, char* argv[] )
 		{
 			for ( int j = i+1 ; j < (int)files.size() ; ++j )
 			{
-				if ( files[i].name == files[j].name )
+				if ( toLower(files[i].name) == toLower(files[j].name) )
 				{
 					printf( "Warning: Two files have identical names (%s). Paths:\n", files[i].name.c_str() );
 					printf( "%s\n", files[i].path.c_str() );
@@ -209,38 +382,23 @@ int main( int argc, char* argv[] )
 			}
 		}
 
-		// write zip
-		printf( "Writing %s...\n", name );
-		gzFile zip = gzopen( name, "wb" );
-		writeInt( zip, files.size() );
-		for ( i = 0 ; i < (int)files.size() ; ++i )
+		// write archive
+		if ( !writeArchive(name,files) )
 		{
-			File& file = files[i];
-			writeString( zip, file.name.c_str() );
-			writeBytes( zip, file.data.begin(), file.data.size() );
+			printf( "Failed to write %s.", name );
+			return 1;
 		}
-		gzclose( zip );
 	}
 	else if ( std::string(opt) == "-x" )
 	{
-		// read zip
+		// read archive
 		printf( "Reading %s...\n", name );
-		gzFile zip = gzopen( name, "rb" );
-		if ( !zip )
+		std::vector<File> files;
+		if ( !readArchive(name,files) )
 		{
 			printf( "Failed to open %s.", name );
 			return 1;
 		}
-		std::vector<File> files;
-		int count = readInt( zip );
-		files.resize( count );
-		for ( int i = 0 ; i < count ; ++i )
-		{
-			File& file = files[i];
-			readString( zip, file.name );
-			readBytes( zip, file.data );
-		}
-		gzclose( zip );
 
 		// write files
 		if ( -1 != _chdir(dir) )
@@ -270,24 +428,14 @@ int main( int argc, char* argv[] )
 	}
 	else if ( std::string(opt) == "-d" )
 	{
-		// read zip
+		// read archive
 		printf( "Reading %s...\n", name );
-		gzFile zip = gzopen( name, "rb" );
-		if ( !zip )
+		std::vector<File> files;
+		if ( !readArchive(name,files) )
 		{
 			printf( "Failed to open %s.", name );
 			return 1;
 		}
-		std::vector<File> files;
-		int count = readInt( zip );
-		files.resize( count );
-		for ( int i = 0 ; i < count ; ++i )
-		{
-			File& file = files[i];
-			readString( zip, file.name );
-			readBytes( zip, file.data );
-		}
-		gzclose( zip );
 
 		// read file list
 		printf( "Reading list %s...\n", dir );
@@ -320,17 +468,12 @@ int main( int argc, char* argv[] )
 			}
 		}
 
-		// write zip
-		printf( "Writing %s...\n", name );
-		zip = gzopen( name, "wb" );
-		writeInt( zip, files.size() );
-		for ( int i = 0 ; i < (int)files.size() ; ++i )
+		// write archive
+		if ( !writeArchive(name,files) )
 		{
-			File& file = files[i];
-			writeString( zip, file.name.c_str() );
-			writeBytes( zip, file.data.begin(), file.data.size() );
+			printf( "Failed to write %s.", name );
+			return 1;
 		}
-		gzclose( zip );
 	}
 	else
 	{
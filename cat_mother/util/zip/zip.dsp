@@ -95,6 +95,10 @@ PostBuild_Cmds=lib $(TargetPath) ../../external/zlib/lib/zlibd.lib
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=.\MappedArchive.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\ZipFile.cpp
 # End Source File
 # End Group
@@ -103,6 +107,10 @@ SOURCE=.\ZipFile.cpp
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=.\MappedArchive.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\ZipFile.h
 # End Source File
 # End Group
@@ -111,10 +119,30 @@ SOURCE=.\ZipFile.h
 # PROP Default_Filter ""
 # Begin Source File
 
+SOURCE=.\internal\ArchiveFormat.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\internal\config.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\internal\InflateInputStream.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\internal\InflateInputStream.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\internal\MappedFile.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\internal\MappedFile.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\internal\MemoryInputStream.cpp
 # End Source File
 # Begin Source File
@@ -74,6 +74,24 @@ extern int isatty();
 /* True if the timer is enabled */
 static int enableTimer = 0;
 
+/*
+** Return the current wall-clock time in milliseconds, as reported by
+** the default VFS.
+*/
+static sqlite3_int64 timeOfDay(void){
+  static sqlite3_vfs *clockVfs = 0;
+  sqlite3_int64 t;
+  if( clockVfs==0 ) clockVfs = sqlite3_vfs_find(0);
+  if( clockVfs->iVersion>=2 && clockVfs->xCurrentTimeInt64!=0 ){
+    clockVfs->xCurrentTimeInt64(clockVfs, &t);
+  }else{
+    double r;
+    clockVfs->xCurrentTime(clockVfs, &r);
+    t = (sqlite3_int64)(r*86400000.0);
+  }
+  return t;
+}
+
 #if !defined(_WIN32) && !defined(WIN32) && !defined(__OS2__) && !defined(__RTP__) && !defined(_WRS_KERNEL)
 #include <sys/time.h>
 #include <sys/resource.h>
@@ -191,6 +209,26 @@ static void endTimer(void){
 #define HAS_TIMER 0
 #endif
 
+/*
+** Return the current wall clock time in nanoseconds, for use by the
+** ".profile" command.  The resolution depends on the platform.
+*/
+static sqlite3_int64 profileClock(void){
+#if !defined(_WIN32) && !defined(WIN32) && !defined(__OS2__) && !defined(__RTP__) && !defined(_WRS_KERNEL)
+  struct timeval sNow;
+  gettimeofday(&sNow, 0);
+  return sNow.tv_sec*(sqlite3_int64)1000000000 + sNow.tv_usec*1000;
+#elif defined(_WIN32) || defined(WIN32)
+  LARGE_INTEGER f, t;
+  if( QueryPerformanceFrequency(&f) && QueryPerformanceCounter(&t) ){
+    return (sqlite3_int64)(t.QuadPart*(1.0e9/(double)f.QuadPart));
+  }
+  return timeOfDay()*1000000;
+#else
+  return timeOfDay()*1000000;
+#endif
+}
+
 /*
 ** Used to prevent warnings about unused parameters
 */
@@ -419,6 +457,8 @@ struct callback_data {
   const char *zVfs;           /* Name of VFS to use */
   sqlite3_stmt *pStmt;   /* Current statement if any. */
   FILE *pLog;            /* Write log output here */
+  struct DumpPlan *pDumpPlan; /* Jobs of a parallel .dump, if any */
+  struct ShellProfile *pProfile; /* Statement profile, if .profile is on */
 };
 
 /*
@@ -1050,6 +1090,529 @@ static int display_stats(
   return 0;
 }
 
+/*
+** The ".profile" command keeps one ProfileEntry for each distinct
+** statement it sees.  Statements are grouped by their normalized SQL
+** text, in which literals are replaced by "?", comments are removed
+** and tokens are separated by exactly one space, except next to
+** parentheses, dots, commas and semicolons.  So the same statement run
+** with different values or spacing is counted once.
+**
+** aHist[] is a latency histogram.  Bucket 0 counts runs that took less
+** than 1 microsecond and bucket i>0 counts runs that took at least
+** 2^(i-1) but less than 2^i microseconds.
+**
+** VM instructions are counted by a progress handler that runs once every
+** PROFILE_STEP_PERIOD instructions, so nVmStep is a multiple of it and a
+** run shorter than the period adds nothing.  Calling the handler for
+** every instruction would slow down the statements being measured.
+*/
+#define PROFILE_NHIST   32    /* Buckets in the latency histogram */
+#define PROFILE_TOP     10    /* Statements shown by the default report */
+#define PROFILE_STEP_PERIOD 1000  /* VM instructions per progress callback */
+
+typedef struct ProfileEntry ProfileEntry;
+struct ProfileEntry {
+  char *zSql;                 /* Normalized SQL text */
+  unsigned int h;             /* Hash of zSql */
+  ProfileEntry *pNext;        /* Next entry with the same hash */
+  sqlite3_int64 nRun;         /* Number of times the statement ran */
+  sqlite3_int64 nsTotal;      /* Total run time in nanoseconds */
+  sqlite3_int64 nsMin;        /* Fastest run */
+  sqlite3_int64 nsMax;        /* Slowest run */
+  sqlite3_int64 nVmStep;      /* VM instructions, see PROFILE_STEP_PERIOD */
+  sqlite3_int64 nSort;        /* SQLITE_STMTSTATUS_SORT */
+  sqlite3_int64 nFullscan;    /* SQLITE_STMTSTATUS_FULLSCAN_STEP */
+  sqlite3_int64 nAutoindex;   /* SQLITE_STMTSTATUS_AUTOINDEX */
+  sqlite3_int64 nCacheHit;    /* Page cache hits */
+  sqlite3_int64 nCacheMiss;   /* Page cache misses */
+  sqlite3_int64 aHist[PROFILE_NHIST];  /* Latency histogram */
+};
+
+/*
+** State of the ".profile" command.  The trace hook marks the start of
+** each statement and the profile hook records it when it finishes.
+*/
+struct ShellProfile {
+  ProfileEntry **aHash;       /* Hash table of entries */
+  int nHash;                  /* Number of slots in aHash[] */
+  int nEntry;                 /* Number of entries */
+  char *zJson;                /* Write a JSON report here.  May be NULL */
+  sqlite3_int64 nsStart;      /* When the current statement started */
+  sqlite3_int64 nVmStep;      /* Instructions run by the current statement */
+  sqlite3_int64 nHitStart;    /* Cache hits when the statement started */
+  sqlite3_int64 nMissStart;   /* Cache misses when the statement started */
+  ProfileEntry *pPending;     /* Entry for the statement just finished */
+};
+
+/*
+** Page cache hit and miss counters.  This version of SQLite has no
+** sqlite3_db_status() verbs for them, so the shell counts them by
+** wrapping the xFetch method of the page cache.  The page cache can
+** only be replaced before SQLite is initialized, so the wrapper is
+** installed by the -profile option, or by ".profile on" if no database
+** has been opened yet.  Otherwise the counts are not available and no
+** shell session pays for the wrapper.  The counters are only updated
+** while profiling is on, and never while worker threads are running.
+*/
+static int profileCacheInstalled = 0;
+static int profileCacheOn = 0;
+static sqlite3_int64 profileCacheHit = 0;
+static sqlite3_int64 profileCacheMiss = 0;
+static sqlite3_pcache_methods profileBaseCache;
+
+static void *profileCacheFetch(sqlite3_pcache *pCache, unsigned key, int eCr){
+  void *pPage;
+  if( !profileCacheOn ){
+    return profileBaseCache.xFetch(pCache, key, eCr);
+  }
+  pPage = profileBaseCache.xFetch(pCache, key, 0);
+  if( pPage ){
+    profileCacheHit++;
+  }else if( eCr ){
+    profileCacheMiss++;
+    pPage = profileBaseCache.xFetch(pCache, key, eCr);
+  }
+  return pPage;
+}
+
+/*
+** Install the counting page cache if it is not installed yet.  This
+** fails, leaving the counts unavailable, once SQLite is initialized.
+*/
+static void profileCacheInit(void){
+  sqlite3_pcache_methods m;
+  if( profileCacheInstalled ) return;
+  if( sqlite3_config(SQLITE_CONFIG_GETPCACHE, &profileBaseCache)==SQLITE_OK
+   && profileBaseCache.xFetch!=0
+  ){
+    m = profileBaseCache;
+    m.xFetch = profileCacheFetch;
+    profileCacheInstalled =
+        sqlite3_config(SQLITE_CONFIG_PCACHE, &m)==SQLITE_OK;
+  }
+}
+
+/*
+** Return a hash of the nul-terminated string z.
+*/
+static unsigned int profileHash(const char *z){
+  unsigned int h = 0;
+  while( *z ){ h = (h<<3) ^ h ^ (unsigned char)*(z++); }
+  return h;
+}
+
+/*
+** Return true if c can be part of an identifier or keyword.
+*/
+#define profileIdChar(c) \
+    (isalnum((unsigned char)(c)) || (c)=='_' || (c)=='$' || ((c)&0x80))
+
+/*
+** Return a copy of zSql normalized as described above, in memory
+** obtained from sqlite3_malloc().  Return NULL on OOM.
+*/
+static char *profile_normalize(const char *zSql){
+  int n = strlen30(zSql);
+  char *zOut = sqlite3_malloc(2*n+1);   /* Each token adds at most a space */
+  int i, j;
+
+  if( zOut==0 ) return 0;
+  for(i=j=0; i<n; ){
+    char c = zSql[i];
+    if( isspace((unsigned char)c) ){
+      i++;
+      continue;
+    }
+    if( c=='-' && zSql[i+1]=='-' ){
+      while( i<n && zSql[i]!='\n' ) i++;
+      continue;
+    }
+    if( c=='/' && zSql[i+1]=='*' ){
+      for(i+=2; i<n && (zSql[i]!='*' || zSql[i+1]!='/'); i++){}
+      i += 2;
+      continue;
+    }
+    if( j>0 && zOut[j-1]!='(' && zOut[j-1]!='.'
+     && c!='(' && c!=')' && c!=',' && c!=';'
+     && (c!='.' || isdigit((unsigned char)zSql[i+1]))
+    ){
+      zOut[j++] = ' ';
+    }
+    if( c=='\'' || ((c=='x' || c=='X') && zSql[i+1]=='\'') ){
+      /* A string or blob literal */
+      if( c!='\'' ) i++;
+      for(i++; i<n; i++){
+        if( zSql[i]=='\'' ){
+          if( zSql[i+1]!='\'' ) break;
+          i++;
+        }
+      }
+      i++;
+      zOut[j++] = '?';
+    }else if( c=='"' || c=='`' || c=='[' ){
+      /* A quoted identifier.  Copy it unchanged. */
+      char cEnd = c=='[' ? ']' : c;
+      zOut[j++] = zSql[i++];
+      while( i<n ){
+        zOut[j++] = zSql[i++];
+        if( zSql[i-1]==cEnd ){
+          if( cEnd==']' || zSql[i]!=cEnd ) break;
+          zOut[j++] = zSql[i++];
+        }
+      }
+    }else if( isdigit((unsigned char)c)
+           || (c=='.' && isdigit((unsigned char)zSql[i+1])) ){
+      /* A numeric literal */
+      if( c=='0' && (zSql[i+1]=='x' || zSql[i+1]=='X') ) i += 2;
+      while( i<n && (isalnum((unsigned char)zSql[i]) || zSql[i]=='.'
+             || ((zSql[i]=='+' || zSql[i]=='-')
+                 && (zSql[i-1]=='e' || zSql[i-1]=='E'))) ){
+        i++;
+      }
+      zOut[j++] = '?';
+    }else if( profileIdChar(c) || c=='?' || c==':' || c=='@' ){
+      /* An identifier, keyword or parameter */
+      zOut[j++] = zSql[i++];
+      while( i<n && profileIdChar(zSql[i]) ) zOut[j++] = zSql[i++];
+    }else{
+      /* An operator or punctuation.  Two character operators are kept
+      ** together so that "a<=b" and "a <= b" give the same text. */
+      static const char zOp2[] = "<=>=<>!===||<<>>";
+      int k;
+      zOut[j++] = zSql[i++];
+      for(k=0; zOp2[k]; k+=2){
+        if( zOp2[k]==c && zOp2[k+1]==zSql[i] ){
+          zOut[j++] = zSql[i++];
+          break;
+        }
+      }
+    }
+  }
+  while( j>0 && (zOut[j-1]==';' || zOut[j-1]==' ') ) j--;
+  zOut[j] = 0;
+  return zOut;
+}
+
+/*
+** Return the entry for normalized SQL text zSql, creating it if it
+** does not already exist.  Return NULL on OOM.
+*/
+static ProfileEntry *profile_entry(struct ShellProfile *pProf, char *zSql){
+  unsigned int h = profileHash(zSql);
+  ProfileEntry *pEntry;
+
+  if( pProf->nHash>0 ){
+    for(pEntry=pProf->aHash[h%pProf->nHash]; pEntry; pEntry=pEntry->pNext){
+      if( pEntry->h==h && strcmp(pEntry->zSql, zSql)==0 ) return pEntry;
+    }
+  }
+  if( pProf->nEntry>=pProf->nHash ){
+    int nNew = pProf->nHash ? pProf->nHash*2 : 64;
+    ProfileEntry **aNew = sqlite3_malloc(nNew*sizeof(aNew[0]));
+    int i;
+    if( aNew==0 ) return 0;
+    memset(aNew, 0, nNew*sizeof(aNew[0]));
+    for(i=0; i<pProf->nHash; i++){
+      while( (pEntry = pProf->aHash[i])!=0 ){
+        pProf->aHash[i] = pEntry->pNext;
+        pEntry->pNext = aNew[pEntry->h%nNew];
+        aNew[pEntry->h%nNew] = pEntry;
+      }
+    }
+    sqlite3_free(pProf->aHash);
+    pProf->aHash = aNew;
+    pProf->nHash = nNew;
+  }
+  pEntry = sqlite3_malloc(sizeof(*pEntry));
+  if( pEntry==0 ) return 0;
+  memset(pEntry, 0, sizeof(*pEntry));
+  pEntry->zSql = zSql;
+  pEntry->h = h;
+  pEntry->nsMin = -1;
+  pEntry->pNext = pProf->aHash[h%pProf->nHash];
+  pProf->aHash[h%pProf->nHash] = pEntry;
+  pProf->nEntry++;
+  return pEntry;
+}
+
+/*
+** sqlite3_trace() callback.  Called when a statement starts running.
+*/
+static void profileTrace(void *pArg, const char *zSql){
+  struct ShellProfile *pProf = (struct ShellProfile*)pArg;
+  if( zSql[0]=='-' && zSql[1]=='-' ) return;   /* A trigger */
+  pProf->nVmStep = 0;
+  pProf->nHitStart = profileCacheHit;
+  pProf->nMissStart = profileCacheMiss;
+  pProf->nsStart = profileClock();
+}
+
+/*
+** sqlite3_profile() callback.  Called when a statement finishes.
+*/
+static void profileDone(void *pArg, const char *zSql, sqlite3_uint64 ns){
+  struct ShellProfile *pProf = (struct ShellProfile*)pArg;
+  ProfileEntry *pEntry;
+  char *zNorm;
+  sqlite3_int64 us;
+  int i;
+
+  if( pProf->nsStart ){
+    ns = profileClock() - pProf->nsStart;
+    pProf->nsStart = 0;
+  }
+  zNorm = profile_normalize(zSql);
+  pEntry = zNorm ? profile_entry(pProf, zNorm) : 0;
+  pProf->pPending = pEntry;
+  if( pEntry==0 ){
+    sqlite3_free(zNorm);
+    return;
+  }
+  if( pEntry->zSql!=zNorm ) sqlite3_free(zNorm);
+  pEntry->nRun++;
+  pEntry->nsTotal += ns;
+  if( pEntry->nsMin<0 || (sqlite3_int64)ns<pEntry->nsMin ) pEntry->nsMin = ns;
+  if( (sqlite3_int64)ns>pEntry->nsMax ) pEntry->nsMax = ns;
+  pEntry->nVmStep += pProf->nVmStep;
+  pEntry->nCacheHit += profileCacheHit - pProf->nHitStart;
+  pEntry->nCacheMiss += profileCacheMiss - pProf->nMissStart;
+  for(i=0, us=ns/1000; us>0 && i<PROFILE_NHIST-1; i++, us>>=1){}
+  pEntry->aHist[i]++;
+  pProf->nVmStep = 0;
+  pProf->nHitStart = profileCacheHit;
+  pProf->nMissStart = profileCacheMiss;
+}
+
+/*
+** Progress handler.  Invoked every PROFILE_STEP_PERIOD VM instructions
+** while profiling.
+*/
+static int profileStep(void *pArg){
+  ((struct ShellProfile*)pArg)->nVmStep += PROFILE_STEP_PERIOD;
+  return 0;
+}
+
+/*
+** Add the counters of statement pStmt, which has just finished running,
+** to the entry recorded for it by profileDone().
+*/
+static void profile_stmt_status(struct ShellProfile *pProf, sqlite3_stmt *pStmt){
+  ProfileEntry *pEntry = pProf->pPending;
+  if( pEntry ){
+    pEntry->nSort +=
+        sqlite3_stmt_status(pStmt, SQLITE_STMTSTATUS_SORT, 0);
+    pEntry->nFullscan +=
+        sqlite3_stmt_status(pStmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 0);
+    pEntry->nAutoindex +=
+        sqlite3_stmt_status(pStmt, SQLITE_STMTSTATUS_AUTOINDEX, 0);
+    pProf->pPending = 0;
+  }
+}
+
+/*
+** Turn the profiling hooks on database connection db on or off.
+*/
+static void profile_hooks(sqlite3 *db, struct ShellProfile *pProf){
+  if( db==0 ) return;
+  sqlite3_trace(db, pProf ? profileTrace : 0, pProf);
+  sqlite3_profile(db, pProf ? profileDone : 0, pProf);
+  sqlite3_progress_handler(db, pProf ? PROFILE_STEP_PERIOD : 0,
+                           pProf ? profileStep : 0, pProf);
+  profileCacheOn = pProf!=0;
+}
+
+/*
+** Return the upper bound, in microseconds, of the histogram bucket
+** that holds the rPct percentile of the runs of pEntry.
+*/
+static sqlite3_int64 profile_percentile(ProfileEntry *pEntry, double rPct){
+  sqlite3_int64 nSeen = 0;
+  sqlite3_int64 nWant = (sqlite3_int64)(pEntry->nRun*rPct + 0.5);
+  int i;
+  if( nWant<1 ) nWant = 1;
+  for(i=0; i<PROFILE_NHIST-1; i++){
+    nSeen += pEntry->aHist[i];
+    if( nSeen>=nWant ) break;
+  }
+  return ((sqlite3_int64)1)<<i;
+}
+
+/*
+** qsort() comparison function.  Sort entries by decreasing total time.
+*/
+static int profile_cmp(const void *pA, const void *pB){
+  const ProfileEntry *a = *(const ProfileEntry**)pA;
+  const ProfileEntry *b = *(const ProfileEntry**)pB;
+  if( a->nsTotal!=b->nsTotal ) return a->nsTotal<b->nsTotal ? 1 : -1;
+  return strcmp(a->zSql, b->zSql);
+}
+
+/*
+** Return an array of all entries, most expensive first, in memory
+** obtained from sqlite3_malloc().  Return NULL if there are no entries.
+*/
+static ProfileEntry **profile_sorted(struct ShellProfile *pProf){
+  ProfileEntry **aEntry;
+  ProfileEntry *pEntry;
+  int i, j;
+  if( pProf->nEntry==0 ) return 0;
+  aEntry = sqlite3_malloc(pProf->nEntry*sizeof(aEntry[0]));
+  if( aEntry==0 ) return 0;
+  for(i=j=0; i<pProf->nHash; i++){
+    for(pEntry=pProf->aHash[i]; pEntry; pEntry=pEntry->pNext){
+      aEntry[j++] = pEntry;
+    }
+  }
+  qsort(aEntry, pProf->nEntry, sizeof(aEntry[0]), profile_cmp);
+  return aEntry;
+}
+
+/*
+** Print the nTop most expensive statements to out.
+*/
+static void profile_report(struct ShellProfile *pProf, FILE *out, int nTop){
+  ProfileEntry **aEntry = profile_sorted(pProf);
+  sqlite3_int64 nRun = 0;
+  sqlite3_int64 nsTotal = 0;
+  int i;
+
+  for(i=0; i<pProf->nEntry && aEntry; i++){
+    nRun += aEntry[i]->nRun;
+    nsTotal += aEntry[i]->nsTotal;
+  }
+  fprintf(out, "Profile: %d statements, %lld runs, %.3f s\n",
+          pProf->nEntry, nRun, nsTotal*1e-9);
+  if( !profileCacheInstalled ){
+    fprintf(out, "Page cache counts need -profile or .profile before"
+                 " the database is opened\n");
+  }
+  if( aEntry==0 ) return;
+  if( nTop>pProf->nEntry ) nTop = pProf->nEntry;
+  fprintf(out, "%8s %11s %10s %10s %10s %12s %6s %10s %10s %8s  %s\n",
+          "runs", "total(ms)", "avg(us)", "p95(us)", "max(us)", "vm-steps",
+          "sorts", "fullscans", "cache-hit", "miss", "sql");
+  for(i=0; i<nTop; i++){
+    ProfileEntry *p = aEntry[i];
+    fprintf(out, "%8lld %11.3f %10.1f %10lld %10.1f %12lld %6lld %10lld"
+                 " %10lld %8lld  %.200s\n",
+            p->nRun, p->nsTotal*1e-6, p->nsTotal*1e-3/p->nRun,
+            profile_percentile(p, 0.95), p->nsMax*1e-3, p->nVmStep,
+            p->nSort, p->nFullscan, p->nCacheHit, p->nCacheMiss, p->zSql);
+  }
+  sqlite3_free(aEntry);
+}
+
+/*
+** Output z as a JSON string.
+*/
+static void output_json_string(FILE *out, const char *z){
+  fputc('"', out);
+  for(; *z; z++){
+    unsigned char c = (unsigned char)*z;
+    if( c=='"' || c=='\\' ){
+      fputc('\\', out);
+      fputc(c, out);
+    }else if( c<0x20 ){
+      fprintf(out, "\\u%04x", c);
+    }else{
+      fputc(c, out);
+    }
+  }
+  fputc('"', out);
+}
+
+/*
+** Write every entry to file zFile as JSON.  Return non-zero on error.
+*/
+static int profile_write_json(struct ShellProfile *pProf, const char *zFile){
+  ProfileEntry **aEntry;
+  FILE *out;
+  int i, k, nHist;
+
+  out = fopen(zFile, "wb");
+  if( out==0 ){
+    fprintf(stderr, "Error: cannot open \"%s\"\n", zFile);
+    return 1;
+  }
+  aEntry = profile_sorted(pProf);
+  fprintf(out, "{\"sqlite_version\":\"%s\",\"vm_step_period\":%d,"
+               "\"statements\":[", sqlite3_libversion(), PROFILE_STEP_PERIOD);
+  for(i=0; i<pProf->nEntry && aEntry; i++){
+    ProfileEntry *p = aEntry[i];
+    fprintf(out, "%s\n {\"sql\":", i ? "," : "");
+    output_json_string(out, p->zSql);
+    fprintf(out, ",\"runs\":%lld,\"total_ns\":%lld,\"min_ns\":%lld,"
+                 "\"max_ns\":%lld,\"vm_steps\":%lld,\"sorts\":%lld,"
+                 "\"fullscan_steps\":%lld,\"autoindex_inserts\":%lld,",
+            p->nRun, p->nsTotal, p->nsMin, p->nsMax, p->nVmStep, p->nSort,
+            p->nFullscan, p->nAutoindex);
+    if( profileCacheInstalled ){
+      fprintf(out, "\"cache_hits\":%lld,\"cache_misses\":%lld,",
+              p->nCacheHit, p->nCacheMiss);
+    }else{
+      fprintf(out, "\"cache_hits\":null,\"cache_misses\":null,");
+    }
+    fprintf(out, "\"histogram_us\":[");
+    for(nHist=PROFILE_NHIST; nHist>0 && p->aHist[nHist-1]==0; nHist--){}
+    for(k=0; k<nHist; k++){
+      fprintf(out, "%s%lld", k ? "," : "", p->aHist[k]);
+    }
+    fprintf(out, "]}");
+  }
+  fprintf(out, "\n]}\n");
+  sqlite3_free(aEntry);
+  return fclose(out)!=0;
+}
+
+/*
+** Start profiling.  If zJson is not NULL, a JSON report is written to
+** that file when profiling ends.
+*/
+static void profile_begin(struct callback_data *p, const char *zJson){
+  struct ShellProfile *pProf = p->pProfile;
+  if( pProf==0 ){
+    pProf = sqlite3_malloc(sizeof(*pProf));
+    if( pProf==0 ){
+      fprintf(stderr, "Error: out of memory\n");
+      return;
+    }
+    memset(pProf, 0, sizeof(*pProf));
+    p->pProfile = pProf;
+  }
+  if( zJson ){
+    sqlite3_free(pProf->zJson);
+    pProf->zJson = sqlite3_mprintf("%s", zJson);
+  }
+  profileCacheInit();
+  profile_hooks(p->db, pProf);
+}
+
+/*
+** Stop profiling.  Print the report to stderr, write the JSON file if
+** one was requested and discard the collected data.
+*/
+static void profile_end(struct callback_data *p){
+  struct ShellProfile *pProf = p->pProfile;
+  int i;
+  if( pProf==0 ) return;
+  profile_hooks(p->db, 0);
+  profile_report(pProf, stderr, PROFILE_TOP);
+  if( pProf->zJson ) profile_write_json(pProf, pProf->zJson);
+  for(i=0; i<pProf->nHash; i++){
+    ProfileEntry *pEntry;
+    while( (pEntry = pProf->aHash[i])!=0 ){
+      pProf->aHash[i] = pEntry->pNext;
+      sqlite3_free(pEntry->zSql);
+      sqlite3_free(pEntry);
+    }
+  }
+  sqlite3_free(pProf->aHash);
+  sqlite3_free(pProf->zJson);
+  sqlite3_free(pProf);
+  p->pProfile = 0;
+}
+
 /*
 ** Execute a statement or set of statements.  Print 
 ** any result rows/columns depending on the current mode 
@@ -1095,6 +1658,11 @@ static int shell_exec(
         pArg->cnt = 0;
       }
 
+      if( pArg && pArg->pProfile ){
+        pArg->pProfile->pPending = 0;
+        pArg->pProfile->nsStart = profileClock();
+      }
+
       /* echo the sql statement if echo on */
       if( pArg && pArg->echoOn ){
         const char *zStmtSql = sqlite3_sql(pStmt);
@@ -1154,6 +1722,11 @@ static int shell_exec(
         }
       }
 
+      /* record the statement counters if profiling */
+      if( pArg && pArg->pProfile ){
+        profile_stmt_status(pArg->pProfile, pStmt);
+      }
+
       /* print usage stats if stats on */
       if( pArg && pArg->statsOn ){
         display_stats(db, pArg, 0);
@@ -1181,6 +1754,379 @@ static int shell_exec(
 }
 
 
+/*
+** Worker threads are used by ".dump -jobs N".  They are available
+** unless the library is built without thread-safety or the platform
+** has no thread support.
+*/
+#ifndef SHELL_THREADS
+# if defined(SQLITE_THREADSAFE) && SQLITE_THREADSAFE==0
+#  define SHELL_THREADS 0
+# elif defined(_WIN32_WCE) || defined(__OS2__) || defined(__RTP__) \
+    || defined(_WRS_KERNEL)
+#  define SHELL_THREADS 0
+# else
+#  define SHELL_THREADS 1
+# endif
+#endif
+
+#if SHELL_THREADS
+# if defined(_WIN32) || defined(WIN32)
+#  include <windows.h>
+# else
+#  include <pthread.h>
+# endif
+
+/*
+** A thread started by shellThreadCreate().  The thread runs xTask(pArg).
+*/
+typedef struct ShellThread ShellThread;
+struct ShellThread {
+  void (*xTask)(void*);  /* Routine run by the thread */
+  void *pArg;            /* Argument passed to xTask */
+#if defined(_WIN32) || defined(WIN32)
+  HANDLE hThread;        /* The thread */
+#else
+  pthread_t tid;         /* The thread */
+#endif
+};
+
+#if defined(_WIN32) || defined(WIN32)
+static DWORD WINAPI shellThreadMain(LPVOID pArg){
+  ShellThread *p = (ShellThread*)pArg;
+  p->xTask(p->pArg);
+  return 0;
+}
+#else
+static void *shellThreadMain(void *pArg){
+  ShellThread *p = (ShellThread*)pArg;
+  p->xTask(p->pArg);
+  return 0;
+}
+#endif
+
+/*
+** Start a new thread running xTask(pArg).  Return SQLITE_OK on success
+** or SQLITE_ERROR if the thread cannot be created.
+*/
+static int shellThreadCreate(ShellThread *p, void (*xTask)(void*), void *pArg){
+  p->xTask = xTask;
+  p->pArg = pArg;
+#if defined(_WIN32) || defined(WIN32)
+  p->hThread = CreateThread(0, 0, shellThreadMain, p, 0, 0);
+  return p->hThread ? SQLITE_OK : SQLITE_ERROR;
+#else
+  return pthread_create(&p->tid, 0, shellThreadMain, p) ? SQLITE_ERROR : SQLITE_OK;
+#endif
+}
+
+/*
+** Wait for a thread started by shellThreadCreate() to finish.
+*/
+static void shellThreadJoin(ShellThread *p){
+#if defined(_WIN32) || defined(WIN32)
+  WaitForSingleObject(p->hThread, INFINITE);
+  CloseHandle(p->hThread);
+#else
+  pthread_join(p->tid, 0);
+#endif
+}
+#endif /* SHELL_THREADS */
+
+/*
+** A growable text buffer.  Space is obtained from malloc() and is
+** doubled whenever it runs out, so that appending N bytes one row at
+** a time costs O(N) rather than a realloc() per row.
+*/
+typedef struct ShellText ShellText;
+struct ShellText {
+  char *z;               /* The text.  Not NUL-terminated */
+  sqlite3_int64 n;       /* Number of bytes of text in z[] */
+  sqlite3_int64 nAlloc;  /* Bytes allocated for z[] */
+};
+
+/*
+** Append n bytes of z[] to the buffer.  Return SQLITE_OK or SQLITE_NOMEM.
+*/
+static int shellTextAppend(ShellText *p, const char *z, sqlite3_int64 n){
+  if( p->n+n>p->nAlloc ){
+    sqlite3_int64 nNew = p->nAlloc ? p->nAlloc*2 : 4096;
+    char *zNew;
+    while( nNew<p->n+n ) nNew *= 2;
+    zNew = realloc(p->z, (size_t)nNew);
+    if( zNew==0 ) return SQLITE_NOMEM;
+    p->z = zNew;
+    p->nAlloc = nNew;
+  }
+  memcpy(&p->z[p->n], z, (size_t)n);
+  p->n += n;
+  return SQLITE_OK;
+}
+
+/*
+** Release all memory held by a ShellText buffer.
+*/
+static void shellTextFree(ShellText *p){
+  free(p->z);
+  memset(p, 0, sizeof(*p));
+}
+
+/*
+** Tables whose rowids span more than this many values are dumped by
+** ".dump -jobs N" in several rowid ranges that are processed in
+** parallel.
+*/
+#define DUMP_CHUNK_ROWS  100000
+
+/*
+** One unit of work for a parallel ".dump".  Each job writes the literal
+** text zPre followed by the output of the zSelect query, if any.  A
+** large table is split into nChunk consecutive jobs, each covering one
+** rowid range.  Jobs are always written out in the order they appear
+** in the plan, so the output is the same as for a serial dump.
+*/
+typedef struct DumpJob DumpJob;
+struct DumpJob {
+  ShellText pre;         /* Literal text written before any rows */
+  char *zSelect;         /* Query that generates INSERT statements, or NULL */
+  char *zTableSelect;    /* Query over the whole table.  First chunk only */
+  const char *zFirstRow; /* Written before the first row, if not NULL */
+  int nChunk;            /* Number of jobs for this table.  First chunk only */
+  int eState;            /* One of the DUMPJOB_* values below */
+  int rc;                /* Result of running zSelect */
+  ShellText out;         /* Rows generated by zSelect */
+};
+
+#define DUMPJOB_PENDING  0   /* Not yet started */
+#define DUMPJOB_RUNNING  1   /* Claimed by a thread */
+#define DUMPJOB_DONE     2   /* Output is in DumpJob.out */
+
+/*
+** The set of jobs for a parallel ".dump".  While a plan is attached to
+** the callback_data, dump_callback() records jobs instead of writing.
+*/
+typedef struct DumpPlan DumpPlan;
+struct DumpPlan {
+  DumpJob *aJob;         /* All jobs, in output order */
+  int nJob;              /* Number of entries in aJob[] */
+  int nAlloc;            /* Slots allocated for aJob[] */
+  ShellText pending;     /* Literal text not yet attached to a job */
+  int nThread;           /* Number of connections reading in parallel */
+  int iWrite;            /* Index of the next job to be written out */
+  sqlite3_mutex *mutex;  /* Protects eState and iWrite */
+};
+
+/*
+** Write text generated by a dump.  The text goes directly to the output
+** file during a serial dump, or into the plan for a parallel dump.
+*/
+static void dump_emit(struct callback_data *p, const char *zText){
+  if( p->pDumpPlan ){
+    ShellText *pPending = &p->pDumpPlan->pending;
+    shellTextAppend(pPending, zText, strlen30(zText));
+  }else{
+    fprintf(p->out, "%s", zText);
+  }
+}
+
+/*
+** Add a new job to the plan.  The pending literal text becomes the text
+** written before the job.  Return a pointer to the job or NULL if out
+** of memory.
+*/
+static DumpJob *dump_plan_append(DumpPlan *pPlan){
+  DumpJob *pJob;
+  if( pPlan->nJob>=pPlan->nAlloc ){
+    int nNew = pPlan->nAlloc ? pPlan->nAlloc*2 : 32;
+    DumpJob *aNew = realloc(pPlan->aJob, nNew*sizeof(DumpJob));
+    if( aNew==0 ) return 0;
+    pPlan->aJob = aNew;
+    pPlan->nAlloc = nNew;
+  }
+  pJob = &pPlan->aJob[pPlan->nJob++];
+  memset(pJob, 0, sizeof(*pJob));
+  pJob->pre = pPlan->pending;
+  memset(&pPlan->pending, 0, sizeof(pPlan->pending));
+  return pJob;
+}
+
+/*
+** Add jobs to the plan for dumping the content of table zTable.  zSelect
+** is the query that generates the INSERT statements for every row of
+** the table.  Ownership of zSelect passes to the plan.  If bSplit is true
+** and the table is large, it is divided into several rowid ranges.
+*/
+static int dump_plan_add_table(
+  struct callback_data *p,
+  const char *zTable,     /* Name of the table */
+  char *zSelect,          /* SELECT statement to extract content */
+  const char *zFirstRow,  /* Print before first row, if not NULL */
+  int bSplit              /* True if the table may be split by rowid */
+){
+  DumpPlan *pPlan = p->pDumpPlan;
+  DumpJob *pJob;
+  sqlite3_int64 iMin = 0, iMax = 0;
+  sqlite3_uint64 nSpan = 0;
+  int nChunk = 1;
+  int i;
+
+  if( bSplit ){
+    sqlite3_stmt *pStmt = 0;
+    char *zSql = sqlite3_mprintf("SELECT min(rowid), max(rowid) FROM \"%w\"",
+                                 zTable);
+    if( zSql && sqlite3_prepare(p->db, zSql, -1, &pStmt, 0)==SQLITE_OK
+     && sqlite3_step(pStmt)==SQLITE_ROW
+     && sqlite3_column_type(pStmt, 0)==SQLITE_INTEGER
+    ){
+      iMin = sqlite3_column_int64(pStmt, 0);
+      iMax = sqlite3_column_int64(pStmt, 1);
+      nSpan = (sqlite3_uint64)iMax - (sqlite3_uint64)iMin;
+      if( nSpan>=DUMP_CHUNK_ROWS ){
+        sqlite3_uint64 n = nSpan/DUMP_CHUNK_ROWS + 1;
+        nChunk = n>(sqlite3_uint64)pPlan->nThread*4 ? pPlan->nThread*4 : (int)n;
+      }
+    }
+    sqlite3_finalize(pStmt);
+    sqlite3_free(zSql);
+  }
+
+  for(i=0; i<nChunk; i++){
+    pJob = dump_plan_append(pPlan);
+    if( pJob==0 ){
+      if( i==0 ) free(zSelect);
+      return SQLITE_NOMEM;
+    }
+    if( nChunk==1 ){
+      pJob->zSelect = sqlite3_mprintf("%s", zSelect);
+    }else{
+      sqlite3_uint64 nStep = nSpan/nChunk;
+      sqlite3_int64 iLo = (sqlite3_int64)((sqlite3_uint64)iMin + nStep*i);
+      sqlite3_int64 iHi = i==nChunk-1 ? iMax :
+                 (sqlite3_int64)((sqlite3_uint64)iMin + nStep*(i+1) - 1);
+      pJob->zSelect = sqlite3_mprintf("%s WHERE rowid BETWEEN %lld AND %lld",
+                                      zSelect, iLo, iHi);
+    }
+    if( i==0 ){
+      pJob->zTableSelect = zSelect;
+      pJob->zFirstRow = zFirstRow;
+      pJob->nChunk = nChunk;
+    }
+  }
+  return SQLITE_OK;
+}
+
+/*
+** Run the query of a single dump job using database connection db and
+** store the generated text in the job's output buffer.  This is the
+** equivalent of run_table_dump_query() for a parallel dump.
+*/
+static void dump_job_run(sqlite3 *db, DumpJob *pJob){
+  sqlite3_stmt *pSelect;
+  const char *zFirstRow = pJob->zFirstRow;
+  int rc;
+  rc = sqlite3_prepare(db, pJob->zSelect, -1, &pSelect, 0);
+  if( rc!=SQLITE_OK || !pSelect ){
+    pJob->rc = rc;
+    return;
+  }
+  rc = sqlite3_step(pSelect);
+  while( rc==SQLITE_ROW ){
+    const char *z = (const char*)sqlite3_column_text(pSelect, 0);
+    int n = sqlite3_column_bytes(pSelect, 0);
+    if( zFirstRow ){
+      shellTextAppend(&pJob->out, zFirstRow, strlen30(zFirstRow));
+      zFirstRow = 0;
+    }
+    if( shellTextAppend(&pJob->out, z ? z : "(null)", z ? n : 6)
+     || shellTextAppend(&pJob->out, ";\n", 2)
+    ){
+      sqlite3_finalize(pSelect);
+      pJob->rc = SQLITE_NOMEM;
+      return;
+    }
+    rc = sqlite3_step(pSelect);
+  }
+  pJob->rc = sqlite3_finalize(pSelect);
+}
+
+/*
+** Claim the next job that has not been started, or return NULL if there
+** is none.  Jobs too far ahead of the writer are not handed out, which
+** bounds the amount of output held in memory.  The window is larger
+** than the number of chunks a single table can be split into.
+*/
+static DumpJob *dump_plan_claim(DumpPlan *pPlan, int *pbFinished){
+  DumpJob *pJob = 0;
+  int i, iEnd;
+  sqlite3_mutex_enter(pPlan->mutex);
+  iEnd = pPlan->iWrite + pPlan->nThread*8;
+  if( iEnd>pPlan->nJob ) iEnd = pPlan->nJob;
+  for(i=pPlan->iWrite; i<iEnd; i++){
+    if( pPlan->aJob[i].zSelect && pPlan->aJob[i].eState==DUMPJOB_PENDING ){
+      pJob = &pPlan->aJob[i];
+      pJob->eState = DUMPJOB_RUNNING;
+      break;
+    }
+  }
+  if( pbFinished ) *pbFinished = pJob==0 && iEnd==pPlan->nJob;
+  sqlite3_mutex_leave(pPlan->mutex);
+  return pJob;
+}
+
+/*
+** Run zSelect on job pJob and mark it done.
+*/
+static void dump_plan_work(DumpPlan *pPlan, sqlite3 *db, DumpJob *pJob){
+  dump_job_run(db, pJob);
+  sqlite3_mutex_enter(pPlan->mutex);
+  pJob->eState = DUMPJOB_DONE;
+  sqlite3_mutex_leave(pPlan->mutex);
+}
+
+#if SHELL_THREADS
+/*
+** State for one worker thread of a parallel dump.
+*/
+typedef struct DumpWorker DumpWorker;
+struct DumpWorker {
+  DumpPlan *pPlan;       /* The plan being executed */
+  sqlite3 *db;           /* Read-only connection used by this worker */
+  ShellThread thread;    /* The thread running dump_worker_main() */
+};
+
+/*
+** Main routine of a worker thread.  Run jobs until none remain.
+*/
+static void dump_worker_main(void *pArg){
+  DumpWorker *pWorker = (DumpWorker*)pArg;
+  int bFinished = 0;
+  while( !bFinished ){
+    DumpJob *pJob = dump_plan_claim(pWorker->pPlan, &bFinished);
+    if( pJob ){
+      dump_plan_work(pWorker->pPlan, pWorker->db, pJob);
+    }else if( !bFinished ){
+      sqlite3_sleep(1);
+    }
+  }
+}
+#endif /* SHELL_THREADS */
+
+/*
+** Return true if jobs iFirst through iEnd-1 have all been completed.
+** Jobs that only write literal text are always complete.
+*/
+static int dump_jobs_done(DumpPlan *pPlan, int iFirst, int iEnd){
+  int i;
+  int bDone = 1;
+  sqlite3_mutex_enter(pPlan->mutex);
+  for(i=iFirst; bDone && i<iEnd; i++){
+    DumpJob *pJob = &pPlan->aJob[i];
+    bDone = pJob->zSelect==0 || pJob->eState==DUMPJOB_DONE;
+  }
+  sqlite3_mutex_leave(pPlan->mutex);
+  return bDone;
+}
+
 /*
 ** This is a different callback routine used for dumping the database.
 ** Each row received by this callback consists of a table name,
@@ -1204,24 +2150,25 @@ static int dump_callback(void *pArg, int nArg, char **azArg, char **azCol){
   if( strcmp(zTable, "sqlite_sequence")==0 ){
     zPrepStmt = "DELETE FROM sqlite_sequence;\n";
   }else if( strcmp(zTable, "sqlite_stat1")==0 ){
-    fprintf(p->out, "ANALYZE sqlite_master;\n");
+    dump_emit(p, "ANALYZE sqlite_master;\n");
   }else if( strncmp(zTable, "sqlite_", 7)==0 ){
     return 0;
   }else if( strncmp(zSql, "CREATE VIRTUAL TABLE", 20)==0 ){
     char *zIns;
     if( !p->writableSchema ){
-      fprintf(p->out, "PRAGMA writable_schema=ON;\n");
+      dump_emit(p, "PRAGMA writable_schema=ON;\n");
       p->writableSchema = 1;
     }
     zIns = sqlite3_mprintf(
        "INSERT INTO sqlite_master(type,name,tbl_name,rootpage,sql)"
-       "VALUES('table','%q','%q',0,'%q');",
+       "VALUES('table','%q','%q',0,'%q');\n",
        zTable, zTable, zSql);
-    fprintf(p->out, "%s\n", zIns);
+    if( zIns ) dump_emit(p, zIns);
     sqlite3_free(zIns);
     return 0;
   }else{
-    fprintf(p->out, "%s;\n", zSql);
+    dump_emit(p, zSql);
+    dump_emit(p, ";\n");
   }
 
   if( strcmp(zType, "table")==0 ){
@@ -1230,6 +2177,7 @@ static int dump_callback(void *pArg, int nArg, char **azArg, char **azCol){
     char *zTableInfo = 0;
     char *zTmp = 0;
     int nRow = 0;
+    int bSplit = zPrepStmt==0; /* True if no column hides the rowid */
    
     zTableInfo = appendText(zTableInfo, "PRAGMA table_info(", 0);
     zTableInfo = appendText(zTableInfo, zTable, '"');
@@ -1250,6 +2198,9 @@ static int dump_callback(void *pArg, int nArg, char **azArg, char **azCol){
     rc = sqlite3_step(pTableInfo);
     while( rc==SQLITE_ROW ){
       const char *zText = (const char *)sqlite3_column_text(pTableInfo, 1);
+      if( sqlite3_strnicmp(zText, "rowid", 6)==0 ){
+        bSplit = 0;
+      }
       zSelect = appendText(zSelect, "quote(", 0);
       zSelect = appendText(zSelect, zText, '"');
       rc = sqlite3_step(pTableInfo);
@@ -1267,6 +2218,10 @@ static int dump_callback(void *pArg, int nArg, char **azArg, char **azCol){
     }
     zSelect = appendText(zSelect, "|| ')' FROM  ", 0);
     zSelect = appendText(zSelect, zTable, '"');
+    if( p->pDumpPlan && zSelect ){
+      dump_plan_add_table(p, zTable, zSelect, zPrepStmt, bSplit);
+      return 0;
+    }
 
     rc = run_table_dump_query(p->out, p->db, zSelect, zPrepStmt);
     if( rc==SQLITE_CORRUPT ){
@@ -1305,6 +2260,140 @@ static int run_schema_dump_query(
   return rc;
 }
 
+/*
+** Return true if the database of p can be dumped by several connections
+** in parallel with the same result as a serial dump.  This requires a
+** thread-safe library and a database file that other connections can
+** open.  WAL databases are excluded because each reader would see its
+** own snapshot.
+*/
+static int dump_parallel_ok(struct callback_data *p){
+  int bOk = 0;
+#if SHELL_THREADS
+  if( sqlite3_threadsafe() && p->zDbFilename && p->zDbFilename[0]
+   && strcmp(p->zDbFilename, ":memory:")!=0
+  ){
+    sqlite3_stmt *pStmt = 0;
+    if( sqlite3_prepare(p->db, "PRAGMA journal_mode", -1, &pStmt, 0)==SQLITE_OK
+     && sqlite3_step(pStmt)==SQLITE_ROW
+    ){
+      const char *zMode = (const char*)sqlite3_column_text(pStmt, 0);
+      bOk = zMode && sqlite3_strnicmp(zMode, "wal", 4)!=0;
+    }
+    sqlite3_finalize(pStmt);
+  }
+#else
+  UNUSED_PARAMETER(p);
+#endif
+  return bOk;
+}
+
+/*
+** Execute the jobs recorded in the plan attached to p and write their
+** output in plan order.  Up to nThread-1 additional read-only connections
+** are opened, each in its own thread, and the main connection runs jobs
+** as well while it waits.  The caller must hold a read transaction on
+** p->db so that every connection sees the same database content.
+*/
+static void dump_plan_run(struct callback_data *p){
+  DumpPlan *pPlan = p->pDumpPlan;
+  int nWorker = 0;
+  int bCacheOn;
+  int i, j, k;
+#if SHELL_THREADS
+  DumpWorker *aWorker;
+#endif
+
+  p->pDumpPlan = 0;
+  if( pPlan->pending.n>0 ) dump_plan_append(pPlan);
+  /* The page cache counters are not thread-safe */
+  bCacheOn = profileCacheOn;
+  profileCacheOn = 0;
+  pPlan->mutex = sqlite3_mutex_alloc(SQLITE_MUTEX_FAST);
+#if SHELL_THREADS
+  aWorker = malloc( sizeof(DumpWorker)*pPlan->nThread );
+  if( aWorker && pPlan->mutex ){
+    for(i=0; i<pPlan->nThread-1; i++){
+      DumpWorker *pWorker = &aWorker[nWorker];
+      pWorker->pPlan = pPlan;
+      pWorker->db = 0;
+      if( sqlite3_open_v2(p->zDbFilename, &pWorker->db,
+                          SQLITE_OPEN_READONLY, 0)!=SQLITE_OK
+       || sqlite3_exec(pWorker->db,
+                "BEGIN; SELECT count(*) FROM sqlite_master", 0, 0, 0)
+       || shellThreadCreate(&pWorker->thread, dump_worker_main, pWorker)
+      ){
+        sqlite3_close(pWorker->db);
+        break;
+      }
+      nWorker++;
+    }
+  }
+#endif
+
+  for(i=0; i<pPlan->nJob; i=j){
+    DumpJob *pJob = &pPlan->aJob[i];
+    int bCorrupt = 0;
+    j = i + (pJob->zSelect ? pJob->nChunk : 1);
+
+    /* Help out on the main connection until every chunk of this table
+    ** has been completed by some thread. */
+    while( !dump_jobs_done(pPlan, i, j) ){
+      DumpJob *pNext = dump_plan_claim(pPlan, 0);
+      if( pNext ){
+        dump_plan_work(pPlan, p->db, pNext);
+      }else{
+        sqlite3_sleep(1);
+      }
+    }
+
+    fwrite(pJob->pre.z, 1, (size_t)pJob->pre.n, p->out);
+    if( pJob->zSelect ){
+      for(k=i; k<j; k++){
+        if( pPlan->aJob[k].rc==SQLITE_CORRUPT ) bCorrupt = 1;
+      }
+      if( bCorrupt ){
+        /* Redo the whole table serially so that the recovery output is
+        ** the same as for a serial dump. */
+        int rc = run_table_dump_query(p->out, p->db, pJob->zTableSelect,
+                                      pJob->zFirstRow);
+        if( rc==SQLITE_CORRUPT ){
+          pJob->zTableSelect = appendText(pJob->zTableSelect,
+                                          " ORDER BY rowid DESC", 0);
+          run_table_dump_query(p->out, p->db, pJob->zTableSelect, 0);
+        }
+      }
+    }
+    for(k=i; k<j; k++){
+      DumpJob *pDone = &pPlan->aJob[k];
+      if( !bCorrupt ) fwrite(pDone->out.z, 1, (size_t)pDone->out.n, p->out);
+      shellTextFree(&pDone->pre);
+      shellTextFree(&pDone->out);
+      sqlite3_free(pDone->zSelect);
+      free(pDone->zTableSelect);
+    }
+    sqlite3_mutex_enter(pPlan->mutex);
+    pPlan->iWrite = j;
+    sqlite3_mutex_leave(pPlan->mutex);
+  }
+
+#if SHELL_THREADS
+  for(i=0; i<nWorker; i++){
+    shellThreadJoin(&aWorker[i].thread);
+    sqlite3_exec(aWorker[i].db, "COMMIT", 0, 0, 0);
+    sqlite3_close(aWorker[i].db);
+  }
+  free(aWorker);
+#endif
+  profileCacheOn = bCacheOn;
+  sqlite3_mutex_free(pPlan->mutex);
+  free(pPlan->aJob);
+  pPlan->aJob = 0;
+  pPlan->nJob = pPlan->nAlloc = 0;
+  pPlan->iWrite = 0;
+  pPlan->mutex = 0;
+}
+
 /*
 ** Text of a help message
 */
@@ -1312,16 +2401,19 @@ static char zHelp[] =
   ".backup ?DB? FILE      Backup DB (default \"main\") to FILE\n"
   ".bail ON|OFF           Stop after hitting an error.  Default OFF\n"
   ".databases             List names and files of attached databases\n"
-  ".dump ?TABLE? ...      Dump the database in an SQL text format\n"
+  ".dump ?-jobs N? ?TABLE? ...  Dump the database in an SQL text format\n"
   "                         If TABLE specified, only dump tables matching\n"
-  "                         LIKE pattern TABLE.\n"
+  "                         LIKE pattern TABLE.  With -jobs N, table\n"
+  "                         content is read by N connections in parallel.\n"
   ".echo ON|OFF           Turn command echo on or off\n"
   ".exit                  Exit this program\n"
   ".explain ?ON|OFF?      Turn output mode suitable for EXPLAIN on or off.\n"
   "                         With no args, it turns EXPLAIN on.\n"
   ".header(s) ON|OFF      Turn display of headers on or off\n"
   ".help                  Show this message\n"
-  ".import FILE TABLE     Import data from FILE into TABLE\n"
+  ".import ?OPTS? FILE TABLE  Import data from FILE into TABLE\n"
+  "                         -bulk     Honor \"quoted\" fields\n"
+  "                         -batch N  Commit after every N rows\n"
   ".indices ?TABLE?       Show names of all indices\n"
   "                         If TABLE specified, only show indices for tables\n"
   "                         matching LIKE pattern TABLE.\n"
@@ -1344,6 +2436,10 @@ static char zHelp[] =
   ".nullvalue STRING      Print STRING in place of NULL values\n"
   ".output FILENAME       Send output to FILENAME\n"
   ".output stdout         Send output to the screen\n"
+  ".profile ON ?FILE?     Collect timings and counters for each statement\n"
+  "                         FILE gets a JSON report when profiling stops\n"
+  ".profile OFF           Print the profile report and stop profiling\n"
+  ".profile report ?N?    Print the N most expensive statements so far\n"
   ".prompt MAIN CONTINUE  Replace the standard prompts\n"
   ".quit                  Exit this program\n"
   ".read FILENAME         Execute SQL in FILENAME\n"
@@ -1388,6 +2484,9 @@ static void open_db(struct callback_data *p){
 #ifndef SQLITE_OMIT_LOAD_EXTENSION
     sqlite3_enable_load_extension(p->db, 1);
 #endif
+    if( p->pProfile ){
+      profile_hooks(p->db, p->pProfile);
+    }
   }
 }
 
@@ -1446,6 +2545,202 @@ static int booleanValue(char *zArg){
   return val;
 }
 
+/*
+** An instance of the following structure holds the state of the input
+** file while it is being read by the ".import" command.  Input is read
+** in large blocks into a single buffer that is reused for every row, so
+** that no memory is allocated per row of input.  Fields are split and
+** NUL-terminated in place.
+*/
+typedef struct ImportReader ImportReader;
+struct ImportReader {
+  FILE *in;              /* Read input from this file */
+  char *zBuf;            /* Buffer holding input text */
+  int nAlloc;            /* Bytes allocated for zBuf[] */
+  int nData;             /* Bytes of valid input in zBuf[] */
+  int iStart;            /* Offset of the first unconsumed byte in zBuf[] */
+  int bEof;              /* True once the input file is exhausted */
+  int lineno;            /* Line number of the current row */
+  int nLine;             /* Number of input lines in the current row */
+  const char *zSep;      /* The field separator */
+  int nSep;              /* Number of bytes in zSep[] */
+  int bQuote;            /* True to honor RFC-4180 quoted fields */
+};
+
+/*
+** Initial size of the ".import" read buffer.  The buffer grows if a
+** single row of input is larger than this.
+*/
+#define IMPORT_BUFSZ  (1024*1024)
+
+/*
+** Discard the input consumed so far and read more data from the file.
+** Enlarge the buffer first if the unconsumed input already fills it.
+** Return SQLITE_OK on success or SQLITE_NOMEM if the buffer cannot be
+** enlarged.  The bEof flag is set once the end of the file is reached.
+*/
+static int import_fill(ImportReader *p){
+  int nGot;
+  if( p->iStart>0 ){
+    p->nData -= p->iStart;
+    memmove(p->zBuf, &p->zBuf[p->iStart], p->nData);
+    p->iStart = 0;
+  }
+  if( p->nData+1>=p->nAlloc ){
+    int nNew = p->nAlloc*2;
+    char *zNew = realloc(p->zBuf, nNew);
+    if( zNew==0 ) return SQLITE_NOMEM;
+    p->zBuf = zNew;
+    p->nAlloc = nNew;
+  }
+  /* Always leave room for one byte past the end of the data so that the
+  ** final row of a file with no trailing newline can be NUL-terminated. */
+  nGot = (int)fread(&p->zBuf[p->nData], 1, p->nAlloc - p->nData - 1, p->in);
+  p->nData += nGot;
+  if( nGot==0 ) p->bEof = 1;
+  return SQLITE_OK;
+}
+
+/*
+** Scan the unconsumed input for the end of the current row.  Return the
+** offset of the newline that terminates the row, the offset of the end
+** of the data if the file ends without a newline, or -1 if more input
+** must be read before the end of the row can be found.
+**
+** Unquoted rows are located with memchr(), which most C libraries
+** implement with vector instructions.  A character-at-a-time scan is
+** only needed for rows that contain a quoted field, since a newline
+** inside quotes does not end the row.
+*/
+static int import_find_eol(ImportReader *p){
+  char *zStart = &p->zBuf[p->iStart];
+  int n = p->nData - p->iStart;
+  char *zEol = memchr(zStart, '\n', n);
+  int i, nEol;
+  int inQuote = 0;
+  int atFieldStart = 1;
+
+  p->nLine = 1;
+  nEol = zEol ? (int)(zEol - zStart) : n;
+  if( !p->bQuote || memchr(zStart, '"', nEol)==0 ){
+    if( zEol ) return p->iStart + nEol;
+    return p->bEof ? p->nData : -1;
+  }
+  for(i=0; i<n; i++){
+    char c = zStart[i];
+    if( inQuote ){
+      if( c=='"' ){
+        if( i+1<n && zStart[i+1]=='"' ){
+          i++;
+        }else if( i+1>=n && !p->bEof ){
+          return -1;   /* Cannot yet tell "" from a closing quote */
+        }else{
+          inQuote = 0;
+        }
+      }else if( c=='\n' ){
+        p->nLine++;
+      }
+    }else if( c=='\n' ){
+      return p->iStart + i;
+    }else if( c=='"' && atFieldStart ){
+      inQuote = 1;
+    }else{
+      atFieldStart = c==p->zSep[0] && strncmp(&zStart[i], p->zSep, p->nSep)==0;
+      if( atFieldStart ) i += p->nSep-1;
+    }
+  }
+  return p->bEof ? p->nData : -1;
+}
+
+/*
+** Remove the quotes from a quoted field in place.  z[] points at the
+** opening quote and zEnd is the end of the row.  Return a pointer to
+** the first character following the closing quote.  The unquoted text
+** is written starting at z[] and its length is stored in *pn.
+*/
+static char *import_dequote(char *z, char *zEnd, int *pn){
+  char *zIn = z+1;
+  char *zOut = z;
+  while( zIn<zEnd ){
+    if( zIn[0]=='"' ){
+      if( zIn+1<zEnd && zIn[1]=='"' ){
+        *zOut++ = '"';
+        zIn += 2;
+        continue;
+      }
+      zIn++;
+      break;
+    }
+    *zOut++ = *zIn++;
+  }
+  *pn = (int)(zOut - z);
+  return zIn;
+}
+
+/*
+** Read the next row of input and split it into fields.  Up to nCol
+** fields are stored in azCol[] with their lengths in anCol[].  Every
+** field is NUL-terminated.  The total number of fields found on the row
+** is written into *pnField.
+**
+** Return 1 if a row was read, 0 at end of input, or -1 if a memory
+** allocation fails.
+*/
+static int import_next_row(
+  ImportReader *p,       /* The input being imported */
+  int nCol,              /* Number of columns in the destination table */
+  char **azCol,          /* OUT: Field values */
+  int *anCol,            /* OUT: Field lengths in bytes */
+  int *pnField           /* OUT: Number of fields on the row */
+){
+  int iEol;
+  int nField = 0;
+  char *z, *zEnd;
+
+  while( (iEol = import_find_eol(p))<0 ){
+    if( import_fill(p) ) return -1;
+  }
+  if( iEol==p->iStart && iEol==p->nData ){
+    assert( p->bEof );
+    return 0;
+  }
+  p->lineno += p->nLine;
+  z = &p->zBuf[p->iStart];
+  zEnd = &p->zBuf[iEol];
+  p->iStart = iEol<p->nData ? iEol+1 : iEol;
+  if( zEnd>z && zEnd[-1]=='\r' ) zEnd--;
+  *zEnd = 0;
+
+  for(;;){
+    char *zField = z;
+    int nByte;
+    if( p->bQuote && *z=='"' ){
+      z = import_dequote(z, zEnd, &nByte);
+      while( z<zEnd && !(*z==p->zSep[0] && strncmp(z, p->zSep, p->nSep)==0) ){
+        z++;
+      }
+    }else{
+      for(;;){
+        z = memchr(z, p->zSep[0], zEnd - z);
+        if( z==0 ){ z = zEnd; break; }
+        if( strncmp(z, p->zSep, p->nSep)==0 ) break;
+        z++;
+      }
+      nByte = (int)(z - zField);
+    }
+    if( nField<nCol ){
+      azCol[nField] = zField;
+      anCol[nField] = nByte;
+    }
+    zField[nByte] = 0;
+    nField++;
+    if( z>=zEnd ) break;
+    z += p->nSep;
+  }
+  *pnField = nField;
+  return 1;
+}
+
 /*
 ** If an input line begins with "." then invoke this routine to
 ** process that line.
@@ -1544,9 +2839,31 @@ static int do_meta_command(char *zLine, struct callback_data *p){
     }
   }else
 
-  if( c=='d' && strncmp(azArg[0], "dump", n)==0 && nArg<3 ){
+  if( c=='d' && strncmp(azArg[0], "dump", n)==0
+   && (nArg<3 || (nArg<5 && strcmp(azArg[1], "-jobs")==0))
+  ){
     char *zErrMsg = 0;
+    int iArg = 1;               /* First TABLE argument */
+    int nJobs = 1;              /* Number of connections to dump with */
+    DumpPlan sPlan;             /* Jobs for a parallel dump */
+    if( nArg>=2 && strcmp(azArg[1], "-jobs")==0 ){
+      int realnum = 0;
+      if( nArg<3 || !isNumber(azArg[2], &realnum) || realnum
+       || (nJobs = atoi(azArg[2]))<1 ){
+        fprintf(stderr, "Error: -jobs requires a positive integer argument\n");
+        return 1;
+      }
+      iArg = 3;
+    }
     open_db(p);
+    memset(&sPlan, 0, sizeof(sPlan));
+    if( nJobs>1 && dump_parallel_ok(p) ){
+      /* Hold a read transaction for the whole dump.  No other connection
+      ** can commit a change while it is open, so all of the worker
+      ** connections see the same content. */
+      sqlite3_exec(p->db, "BEGIN; SELECT count(*) FROM sqlite_master", 0, 0, 0);
+      sPlan.nThread = nJobs;
+    }
     /* When playing back a "dump", the content might appear in an order
     ** which causes immediate foreign key constraints to be violated.
     ** So disable foreign-key constraint enforcement to prevent problems. */
@@ -1554,7 +2871,8 @@ static int do_meta_command(char *zLine, struct callback_data *p){
     fprintf(p->out, "BEGIN TRANSACTION;\n");
     p->writableSchema = 0;
     sqlite3_exec(p->db, "PRAGMA writable_schema=ON", 0, 0, 0);
-    if( nArg==1 ){
+    if( nArg==iArg ){
+      if( sPlan.nThread ) p->pDumpPlan = &sPlan;
       run_schema_dump_query(p, 
         "SELECT name, type, sql FROM sqlite_master "
         "WHERE sql NOT NULL AND type=='table' AND name!='sqlite_sequence'", 0
@@ -1563,18 +2881,21 @@ static int do_meta_command(char *zLine, struct callback_data *p){
         "SELECT name, type, sql FROM sqlite_master "
         "WHERE name=='sqlite_sequence'", 0
       );
+      if( p->pDumpPlan ) dump_plan_run(p);
       run_table_dump_query(p->out, p->db,
         "SELECT sql FROM sqlite_master "
         "WHERE sql NOT NULL AND type IN ('index','trigger','view')", 0
       );
     }else{
       int i;
-      for(i=1; i<nArg; i++){
+      for(i=iArg; i<nArg; i++){
         zShellStatic = azArg[i];
+        if( sPlan.nThread ) p->pDumpPlan = &sPlan;
         run_schema_dump_query(p,
           "SELECT name, type, sql FROM sqlite_master "
           "WHERE tbl_name LIKE shellstatic() AND type=='table'"
           "  AND sql NOT NULL", 0);
+        if( p->pDumpPlan ) dump_plan_run(p);
         run_table_dump_query(p->out, p->db,
           "SELECT sql FROM sqlite_master "
           "WHERE sql NOT NULL"
@@ -1589,6 +2910,9 @@ static int do_meta_command(char *zLine, struct callback_data *p){
       p->writableSchema = 0;
     }
     sqlite3_exec(p->db, "PRAGMA writable_schema=OFF", 0, 0, 0);
+    if( sPlan.nThread ){
+      sqlite3_exec(p->db, "COMMIT", 0, 0, 0);
+    }
     if( zErrMsg ){
       fprintf(stderr,"Error: %s\n", zErrMsg);
       sqlite3_free(zErrMsg);
@@ -1652,21 +2976,37 @@ static int do_meta_command(char *zLine, struct callback_data *p){
     }
   }else
 
-  if( c=='i' && strncmp(azArg[0], "import", n)==0 && nArg==3 ){
-    char *zTable = azArg[2];    /* Insert data into this table */
-    char *zFile = azArg[1];     /* The file from which to extract data */
+  if( c=='i' && strncmp(azArg[0], "import", n)==0 && nArg>=3 ){
+    char *zTable;               /* Insert data into this table */
+    char *zFile;                /* The file from which to extract data */
     sqlite3_stmt *pStmt = NULL; /* A statement */
     int nCol;                   /* Number of columns in the table */
     int nByte;                  /* Number of bytes in an SQL string */
     int i, j;                   /* Loop counters */
     int nSep;                   /* Number of bytes in p->separator[] */
     char *zSql;                 /* An SQL statement */
-    char *zLine;                /* A single line of input from the file */
-    char **azCol;               /* zLine[] broken up into columns */
+    char **azCol;               /* A row of input broken up into columns */
+    int *anCol;                 /* Length of each azCol[] entry */
+    int nField;                 /* Number of fields found on a row */
     char *zCommit;              /* How to commit changes */   
-    FILE *in;                   /* The input file */
-    int lineno = 0;             /* Line number of input file */
-
+    ImportReader sIn;           /* The input file */
+    int bBulk = 0;              /* True for -bulk: honor quoted fields */
+    int nBatch = 0;             /* Commit every nBatch rows.  0 means never */
+    sqlite3_int64 nRow = 0;     /* Number of rows inserted */
+    sqlite3_int64 iBegin = 0;   /* Wall-clock start time in milliseconds */
+
+    for(j=1; j<nArg-2; j++){
+      if( strcmp(azArg[j], "-bulk")==0 ){
+        bBulk = 1;
+      }else if( strcmp(azArg[j], "-batch")==0 && j+1<nArg-2 ){
+        nBatch = atoi(azArg[++j]);
+      }else{
+        fprintf(stderr, "Error: unknown option for import: \"%s\"\n", azArg[j]);
+        return 1;
+      }
+    }
+    zFile = azArg[nArg-2];
+    zTable = azArg[nArg-1];
     open_db(p);
     nSep = strlen30(p->separator);
     if( nSep==0 ){
@@ -1710,63 +3050,73 @@ static int do_meta_command(char *zLine, struct callback_data *p){
       if (pStmt) sqlite3_finalize(pStmt);
       return 1;
     }
-    in = fopen(zFile, "rb");
-    if( in==0 ){
+    memset(&sIn, 0, sizeof(sIn));
+    sIn.zSep = p->separator;
+    sIn.nSep = nSep;
+    sIn.bQuote = bBulk;
+    sIn.in = fopen(zFile, "rb");
+    if( sIn.in==0 ){
       fprintf(stderr, "Error: cannot open \"%s\"\n", zFile);
       sqlite3_finalize(pStmt);
       return 1;
     }
-    azCol = malloc( sizeof(azCol[0])*(nCol+1) );
-    if( azCol==0 ){
+    sIn.nAlloc = IMPORT_BUFSZ;
+    sIn.zBuf = malloc( sIn.nAlloc );
+    azCol = malloc( (sizeof(azCol[0])+sizeof(anCol[0]))*(nCol+1) );
+    if( azCol==0 || sIn.zBuf==0 ){
       fprintf(stderr, "Error: out of memory\n");
-      fclose(in);
+      free(azCol);
+      free(sIn.zBuf);
+      fclose(sIn.in);
       sqlite3_finalize(pStmt);
       return 1;
     }
+    anCol = (int*)&azCol[nCol+1];
+    if( enableTimer ) iBegin = timeOfDay();
     sqlite3_exec(p->db, "BEGIN", 0, 0, 0);
     zCommit = "COMMIT";
-    while( (zLine = local_getline(0, in))!=0 ){
-      char *z;
-      i = 0;
-      lineno++;
-      azCol[0] = zLine;
-      for(i=0, z=zLine; *z && *z!='\n' && *z!='\r'; z++){
-        if( *z==p->separator[0] && strncmp(z, p->separator, nSep)==0 ){
-          *z = 0;
-          i++;
-          if( i<nCol ){
-            azCol[i] = &z[nSep];
-            z += nSep-1;
-          }
-        }
-      } /* end for */
-      *z = 0;
-      if( i+1!=nCol ){
+    while( (i = import_next_row(&sIn, nCol, azCol, anCol, &nField))!=0 ){
+      if( i<0 ){
+        fprintf(stderr, "Error: out of memory\n");
+        zCommit = "ROLLBACK";
+        rc = 1;
+        break; /* from while */
+      }
+      if( nField!=nCol ){
         fprintf(stderr,
                 "Error: %s line %d: expected %d columns of data but found %d\n",
-                zFile, lineno, nCol, i+1);
+                zFile, sIn.lineno, nCol, nField);
         zCommit = "ROLLBACK";
-        free(zLine);
         rc = 1;
         break; /* from while */
       }
       for(i=0; i<nCol; i++){
-        sqlite3_bind_text(pStmt, i+1, azCol[i], -1, SQLITE_STATIC);
+        sqlite3_bind_text(pStmt, i+1, azCol[i], anCol[i], SQLITE_STATIC);
       }
       sqlite3_step(pStmt);
       rc = sqlite3_reset(pStmt);
-      free(zLine);
       if( rc!=SQLITE_OK ){
         fprintf(stderr,"Error: %s\n", sqlite3_errmsg(db));
         zCommit = "ROLLBACK";
         rc = 1;
         break; /* from while */
       }
+      nRow++;
+      if( nBatch>0 && (nRow % nBatch)==0 ){
+        sqlite3_exec(p->db, "COMMIT", 0, 0, 0);
+        sqlite3_exec(p->db, "BEGIN", 0, 0, 0);
+      }
     } /* end while */
     free(azCol);
-    fclose(in);
+    free(sIn.zBuf);
+    fclose(sIn.in);
     sqlite3_finalize(pStmt);
     sqlite3_exec(p->db, zCommit, 0, 0, 0);
+    if( enableTimer && rc==0 ){
+      double rElapsed = (timeOfDay() - iBegin)*0.001;
+      printf("Imported %lld rows in %.3f s (%.0f rows/sec)\n",
+             nRow, rElapsed, rElapsed>0.0 ? nRow/rElapsed : 0.0);
+    }
   }else
 
   if( c=='i' && strncmp(azArg[0], "indices", n)==0 && nArg<3 ){
@@ -1936,6 +3286,25 @@ static int do_meta_command(char *zLine, struct callback_data *p){
     }
   }else
 
+  if( c=='p' && n>=4 && strncmp(azArg[0], "profile", n)==0 && nArg>1 && nArg<4 ){
+    if( strcmp(azArg[1], "report")==0 ){
+      if( p->pProfile ){
+        profile_report(p->pProfile, p->out,
+                       nArg>2 ? atoi(azArg[2]) : PROFILE_TOP);
+      }else{
+        fprintf(stderr, "Error: profiling is off\n");
+        rc = 1;
+      }
+    }else if( booleanValue(azArg[1]) ){
+      profile_begin(p, nArg>2 ? azArg[2] : 0);
+    }else if( nArg==2 ){
+      profile_end(p);
+    }else{
+      fprintf(stderr, "Error: unknown argument: %s\n", azArg[2]);
+      rc = 1;
+    }
+  }else
+
   if( c=='p' && strncmp(azArg[0], "prompt", n)==0 && (nArg==2 || nArg==3)){
     if( nArg >= 2) {
       strncpy(mainPrompt,azArg[1],(int)ArraySize(mainPrompt)-1);
@@ -2099,6 +3468,7 @@ static int do_meta_command(char *zLine, struct callback_data *p){
     fprintf(p->out,"%9.9s: ", "separator");
       output_c_string(p->out, p->separator);
       fprintf(p->out, "\n");
+    fprintf(p->out,"%9.9s: %s\n","profile", p->pProfile ? "on" : "off");
     fprintf(p->out,"%9.9s: %s\n","stats", p->statsOn ? "on" : "off");
     fprintf(p->out,"%9.9s: ","width");
     for (i=0;i<(int)ArraySize(p->colWidth) && p->colWidth[i] != 0;i++) {
@@ -2620,6 +3990,7 @@ static const char zOptions[] =
   "   -line                set output mode to 'line'\n"
   "   -list                set output mode to 'list'\n"
   "   -separator 'x'       set output field separator (|)\n"
+  "   -profile FILE        profile each statement and write JSON to FILE\n"
   "   -stats               print memory stats before each finalize\n"
   "   -nullvalue 'text'    set text string for NULL values\n"
   "   -version             show SQLite version\n"
@@ -2652,7 +4023,12 @@ static void main_init(struct callback_data *data) {
   sqlite3_config(SQLITE_CONFIG_LOG, shellLog, data);
   sqlite3_snprintf(sizeof(mainPrompt), mainPrompt,"sqlite> ");
   sqlite3_snprintf(sizeof(continuePrompt), continuePrompt,"   ...> ");
+#if SHELL_THREADS
+  /* A parallel .dump uses one connection per thread */
+  sqlite3_config(SQLITE_CONFIG_MULTITHREAD);
+#else
   sqlite3_config(SQLITE_CONFIG_SINGLETHREAD);
+#endif
 }
 
 int main(int argc, char **argv){
@@ -2686,6 +4062,11 @@ int main(int argc, char **argv){
     if( z[0]=='-' && z[1]=='-' ) z++;
     if( strcmp(argv[i],"-separator")==0 || strcmp(argv[i],"-nullvalue")==0 ){
       i++;
+    }else if( strcmp(argv[i],"-profile")==0 ){
+      /* The page cache counters must be installed before the database
+      ** is opened. */
+      profileCacheInit();
+      i++;
     }else if( strcmp(argv[i],"-init")==0 ){
       i++;
       zInitFile = argv[i];
@@ -2827,6 +4208,14 @@ int main(int argc, char **argv){
       data.echoOn = 1;
     }else if( strcmp(z,"-stats")==0 ){
       data.statsOn = 1;
+    }else if( strcmp(z,"-profile")==0 ){
+      i++;
+      if(i>=argc){
+        fprintf(stderr,"%s: Error: missing argument for option: %s\n", Argv0, z);
+        fprintf(stderr,"Use -help for a list of options.\n");
+        return 1;
+      }
+      profile_begin(&data, argv[i]);
     }else if( strcmp(z,"-bail")==0 ){
       bail_on_error = 1;
     }else if( strcmp(z,"-version")==0 ){
@@ -2861,9 +4250,11 @@ int main(int argc, char **argv){
       rc = shell_exec(data.db, zFirstCmd, shell_callback, &data, &zErrMsg);
       if( zErrMsg!=0 ){
         fprintf(stderr,"Error: %s\n", zErrMsg);
+        profile_end(&data);
         return rc!=0 ? rc : 1;
       }else if( rc!=0 ){
         fprintf(stderr,"Error: unable to process SQL \"%s\"\n", zFirstCmd);
+        profile_end(&data);
         return rc;
       }
     }
@@ -2901,6 +4292,7 @@ int main(int argc, char **argv){
       rc = process_input(&data, stdin);
     }
   }
+  profile_end(&data);
   set_table_name(&data, 0);
   if( data.db ){
     sqlite3_close(data.db);
@@ -0,0 +1,54 @@
+#
+# Compare the row rate of [db eval -columnar] against the row callback
+# and flat list forms of [db eval].
+#
+# Usage:  tclsh eval-columnar.tcl ?NROW? ?DATABASE?
+#
+# If DATABASE is omitted an in-memory database is used.  A table "bench"
+# with NROW rows (default 1000000) of integer, real, text and NULL
+# columns is created if it does not already exist.
+#
+package require sqlite3
+
+set nRow [expr {$argc>0 ? [lindex $argv 0] : 1000000}]
+set zDb  [expr {$argc>1 ? [lindex $argv 1] : ":memory:"}]
+
+sqlite3 db $zDb
+if {![db exists {SELECT 1 FROM sqlite_master WHERE name='bench'}]} {
+  db transaction {
+    db eval {CREATE TABLE bench(id INTEGER PRIMARY KEY, grp, price, label, note)}
+    for {set i 0} {$i<$nRow} {incr i} {
+      set grp [expr {$i % 16}]
+      set price [expr {($i % 100) * 0.25}]
+      set label "item-$i"
+      db eval {INSERT INTO bench VALUES($i, $grp, $price, $label, NULL)}
+    }
+  }
+}
+set nRow [db one {SELECT count(*) FROM bench}]
+set sql {SELECT id, grp, price, label, note FROM bench}
+
+proc report {name us} {
+  global nRow
+  set s [expr {$us/1000000.0}]
+  puts [format "%-12s %8.3f s %12.0f rows/sec" $name $s [expr {$nRow/$s}]]
+}
+
+# Warm the page cache and the statement cache.
+db eval $sql {}
+
+report callback [lindex [time {
+  db eval $sql r { }
+}] 0]
+
+report list [lindex [time {
+  set res [db eval $sql]
+}] 0]
+unset res
+
+report columnar [lindex [time {
+  set res [db eval -columnar $sql]
+}] 0]
+unset res
+
+db close
@@ -56,7 +56,7 @@
 #endif /* BUILD_sqlite */
 
 #define NUM_PREPARED_STMTS 10
-#define MAX_PREPARED_STMTS 100
+#define MAX_PREPARED_STMTS 10000
 
 /*
 ** If TCL uses UTF-8 and SQLite is configured to use iso8859, then we
@@ -100,11 +100,16 @@ typedef struct SqlPreparedStmt SqlPreparedStmt;
 struct SqlPreparedStmt {
   SqlPreparedStmt *pNext;  /* Next in linked list */
   SqlPreparedStmt *pPrev;  /* Previous on the list */
+  SqlPreparedStmt *pHashNext; /* Next in the same SqliteDb.aStmtHash slot */
+  unsigned int iHash;      /* Hash of zSql[], from stmtHashStep() */
+  int nByte;               /* Approximate memory used by this statement */
   sqlite3_stmt *pStmt;     /* The prepared statement */
   int nSql;                /* chars in zSql[] */
   const char *zSql;        /* Text of the SQL statement */
   int nParm;               /* Size of apParm array */
   Tcl_Obj **apParm;        /* Array of referenced object pointers */
+  int nColName;            /* Number of entries in apColName[] */
+  Tcl_Obj **apColName;     /* Cached column names, or NULL */
 };
 
 typedef struct IncrblobChannel IncrblobChannel;
@@ -137,6 +142,13 @@ struct SqliteDb {
   SqlPreparedStmt *stmtLast; /* Last statement in the list */
   int maxStmt;               /* The next maximum number of stmtList */
   int nStmt;                 /* Number of statements in stmtList */
+  SqlPreparedStmt **aStmtHash; /* Hash table of statements in stmtList */
+  int nStmtHash;             /* Number of slots in aStmtHash[] */
+  int maxStmtBytes;          /* Memory limit for stmtList.  0 for no limit */
+  int nStmtBytes;            /* Memory used by statements in stmtList */
+  Tcl_WideInt nStmtHit;      /* Statements found in the cache */
+  Tcl_WideInt nStmtMiss;     /* Statements that had to be prepared */
+  Tcl_WideInt nStmtEvict;    /* Statements removed to satisfy the limits */
   IncrblobChannel *pIncrblob;/* Linked list of open incrblob channels */
   int nStep, nSort, nIndex;  /* Statistics for most recent operation */
   int nTransaction;          /* Number of nested [transaction] methods */
@@ -434,6 +446,22 @@ static SqlFunc *findSqlFunc(SqliteDb *pDb, const char *zName){
   return pNew;
 }
 
+/*
+** Finalize a prepared statement and free the SqlPreparedStmt structure
+** along with its cached column names.
+*/
+static void dbFreeStmt(SqlPreparedStmt *pPreStmt){
+  int i;
+  sqlite3_finalize(pPreStmt->pStmt);
+  if( pPreStmt->apColName ){
+    for(i=0; i<pPreStmt->nColName; i++){
+      Tcl_DecrRefCount(pPreStmt->apColName[i]);
+    }
+    Tcl_Free((char*)pPreStmt->apColName);
+  }
+  Tcl_Free((char*)pPreStmt);
+}
+
 /*
 ** Finalize and free a list of prepared statements
 */
@@ -441,13 +469,93 @@ static void flushStmtCache( SqliteDb *pDb ){
   SqlPreparedStmt *pPreStmt;
 
   while(  pDb->stmtList ){
-    sqlite3_finalize( pDb->stmtList->pStmt );
     pPreStmt = pDb->stmtList;
     pDb->stmtList = pDb->stmtList->pNext;
-    Tcl_Free( (char*)pPreStmt );
+    dbFreeStmt(pPreStmt);
   }
   pDb->nStmt = 0;
+  pDb->nStmtBytes = 0;
   pDb->stmtLast = 0;
+  if( pDb->aStmtHash ){
+    memset(pDb->aStmtHash, 0, pDb->nStmtHash*sizeof(SqlPreparedStmt*));
+  }
+}
+
+/*
+** Add the next byte of SQL text to the hash value h.  The statement
+** cache is keyed on a hash of the SQL text that is built up one byte
+** at a time, so that the hash of every prefix of a multi-statement
+** script is available in a single pass.
+*/
+#define stmtHashStep(h, c) (((h)<<5) + (h) + (unsigned char)(c))
+
+/*
+** Remove pPreStmt from the statement cache of pDb.  This unlinks it from
+** both the LRU list and the hash table.
+*/
+static void stmtCacheRemove(SqliteDb *pDb, SqlPreparedStmt *pPreStmt){
+  SqlPreparedStmt **pp;
+  if( pPreStmt->pPrev ){
+    pPreStmt->pPrev->pNext = pPreStmt->pNext;
+  }else{
+    pDb->stmtList = pPreStmt->pNext;
+  }
+  if( pPreStmt->pNext ){
+    pPreStmt->pNext->pPrev = pPreStmt->pPrev;
+  }else{
+    pDb->stmtLast = pPreStmt->pPrev;
+  }
+  pp = &pDb->aStmtHash[pPreStmt->iHash & (pDb->nStmtHash-1)];
+  while( *pp!=pPreStmt ){
+    assert( *pp );
+    pp = &(*pp)->pHashNext;
+  }
+  *pp = pPreStmt->pHashNext;
+  pDb->nStmt--;
+  pDb->nStmtBytes -= pPreStmt->nByte;
+}
+
+/*
+** Enlarge the statement cache hash table of pDb so that it has at least
+** one slot per cached statement.  The number of slots is always a power
+** of two.  If the allocation fails the old table is kept, which only
+** makes the hash chains longer.
+*/
+static void stmtCacheRehash(SqliteDb *pDb){
+  int nNew = pDb->nStmtHash ? pDb->nStmtHash*2 : 16;
+  SqlPreparedStmt **aNew;
+  SqlPreparedStmt *p;
+
+  aNew = (SqlPreparedStmt**)Tcl_AttemptAlloc(nNew*sizeof(SqlPreparedStmt*));
+  if( aNew==0 ) return;
+  memset(aNew, 0, nNew*sizeof(SqlPreparedStmt*));
+  for(p=pDb->stmtList; p; p=p->pNext){
+    p->pHashNext = aNew[p->iHash & (nNew-1)];
+    aNew[p->iHash & (nNew-1)] = p;
+  }
+  if( pDb->aStmtHash ) Tcl_Free((char*)pDb->aStmtHash);
+  pDb->aStmtHash = aNew;
+  pDb->nStmtHash = nNew;
+}
+
+/*
+** Search the statement cache of pDb for a statement with the n bytes
+** of text in zSql[] and hash value h.  Return the statement or NULL.
+*/
+static SqlPreparedStmt *stmtCacheFind(
+  SqliteDb *pDb,
+  const char *zSql,
+  int n,
+  unsigned int h
+){
+  SqlPreparedStmt *p;
+  if( pDb->nStmtHash==0 ) return 0;
+  for(p=pDb->aStmtHash[h & (pDb->nStmtHash-1)]; p; p=p->pHashNext){
+    if( p->iHash==h && p->nSql==n && memcmp(p->zSql, zSql, n)==0 ){
+      return p;
+    }
+  }
+  return 0;
 }
 
 /*
@@ -457,6 +565,9 @@ static void flushStmtCache( SqliteDb *pDb ){
 static void DbDeleteCmd(void *db){
   SqliteDb *pDb = (SqliteDb*)db;
   flushStmtCache(pDb);
+  if( pDb->aStmtHash ){
+    Tcl_Free((char*)pDb->aStmtHash);
+  }
   closeIncrblobChannels(pDb);
   sqlite3_close(pDb->db);
   while( pDb->pFunc ){
@@ -938,53 +1049,321 @@ static Tcl_Obj *dbTextToObj(char const *zText){
 }
 
 /*
-** This routine reads a line of text from FILE in, stores
-** the text in memory obtained from malloc() and returns a pointer
-** to the text.  NULL is returned at end of file, or if malloc()
-** fails.
-**
-** The interface is like "readline" but no command-line editing
-** is done.
-**
-** copied from shell.c from '.import' command
+** The [db copy] command reads its input through a pipeline.  A reader
+** thread reads the file in large chunks that each end on a line
+** boundary.  A pool of parser threads splits each chunk into lines and
+** fields.  The thread that owns the interpreter binds and inserts the
+** parsed rows in file order, so that all SQLite and Tcl calls are made
+** from one thread.  If threads are not available, the same steps run
+** one after another on the calling thread.
+*/
+#define COPY_CHUNK_SIZE  (1024*1024)  /* Bytes of input per chunk */
+
+#define COPY_CHUNK_READ     0         /* Chunk waiting to be parsed */
+#define COPY_CHUNK_PARSING  1         /* Chunk being parsed */
+#define COPY_CHUNK_PARSED   2         /* Chunk ready to be inserted */
+
+/*
+** One chunk of input.  After parsing, line i starts at azLine[i] and is
+** anLine[i] bytes long, not counting the newline.  It has anField[i]
+** fields, the first nCol of which are described by the azField[] and
+** anFieldLen[] entries starting at index i*nCol.  The input text is not
+** modified, so a rejected line can be written out exactly as read.
+*/
+typedef struct CopyChunk CopyChunk;
+struct CopyChunk {
+  char *z;                 /* Input text */
+  int n;                   /* Bytes of text in z[] */
+  int eState;              /* One of the COPY_CHUNK_* values */
+  int nLine;               /* Lines in the chunk.  -1 if parsing failed */
+  char **azLine;           /* Start of each line */
+  int *anLine;             /* Length of each line */
+  int *anField;            /* Number of fields found on each line */
+  char **azField;          /* Start of each field */
+  int *anFieldLen;         /* Length of each field */
+  CopyChunk *pNext;        /* Next chunk in file order */
+};
+
+/*
+** State shared by the threads of one [db copy] command.  All fields
+** below "mutex" are protected by it.
+*/
+typedef struct CopyPipe CopyPipe;
+struct CopyPipe {
+  FILE *in;                /* The input file.  Used only by the reader */
+  const char *zSep;        /* Field separator */
+  int nSep;                /* Bytes in zSep[] */
+  int nCol;                /* Columns in the destination table */
+  char *zCarry;            /* Partial line left over from the last read */
+  int nCarry;              /* Bytes in zCarry[] */
+  int bThreads;            /* True if a reader thread is running */
+  Tcl_Mutex mutex;         /* Mutex protecting the fields below */
+  Tcl_Condition cond;      /* Signalled whenever any field below changes */
+  CopyChunk *pFirst;       /* Oldest chunk not yet taken by the writer */
+  CopyChunk *pLast;        /* Newest chunk */
+  int nChunk;              /* Number of chunks in the pFirst list */
+  int mxChunk;             /* Maximum chunks held in memory at once */
+  int bEof;                /* True once the reader has finished */
+  int bNoMem;              /* True if the reader ran out of memory */
+  int bAbort;              /* True if the writer has stopped */
+};
+
+/*
+** Free a chunk and everything it owns.
+*/
+static void copyFreeChunk(CopyChunk *p){
+  if( p ){
+    free(p->z);
+    free(p->azLine);
+    free(p);
+  }
+}
+
+/*
+** Read the next chunk of input.  The chunk holds at least
+** COPY_CHUNK_SIZE bytes, or whatever remains of the file, and ends
+** on a line boundary.  Return NULL at end of file or if a memory
+** allocation fails, in which case *pbNoMem is set.
+*/
+static CopyChunk *copyReadChunk(CopyPipe *p, int *pbNoMem){
+  CopyChunk *pChunk;
+  char *z;
+  char *zNew;
+  int nAlloc = COPY_CHUNK_SIZE;
+  int n = 0;
+  int bEof = 0;
+  int iEnd;
+
+  while( nAlloc<p->nCarry*2 ) nAlloc *= 2;
+  z = malloc(nAlloc);
+  if( z==0 ){ *pbNoMem = 1; return 0; }
+  if( p->nCarry ){
+    memcpy(z, p->zCarry, p->nCarry);
+    n = p->nCarry;
+  }
+  for(;;){
+    n += (int)fread(&z[n], 1, nAlloc-n, p->in);
+    if( n<nAlloc ) bEof = 1;
+    for(iEnd=n; iEnd>0 && z[iEnd-1]!='\n'; iEnd--){}
+    if( iEnd>0 || bEof ) break;
+    /* A single line longer than the buffer.  Enlarge it and read on. */
+    if( nAlloc>0x3fffffff ){ free(z); *pbNoMem = 1; return 0; }
+    nAlloc *= 2;
+    zNew = realloc(z, nAlloc);
+    if( zNew==0 ){ free(z); *pbNoMem = 1; return 0; }
+    z = zNew;
+  }
+  if( bEof ) iEnd = n;
+  if( iEnd==0 ){
+    free(z);
+    p->nCarry = 0;
+    return 0;
+  }
+
+  /* Save the partial line at the end of the buffer for the next chunk. */
+  free(p->zCarry);
+  p->zCarry = 0;
+  p->nCarry = n - iEnd;
+  if( p->nCarry ){
+    p->zCarry = malloc(p->nCarry);
+    if( p->zCarry==0 ){ free(z); *pbNoMem = 1; return 0; }
+    memcpy(p->zCarry, &z[iEnd], p->nCarry);
+  }
+
+  pChunk = (CopyChunk*)malloc(sizeof(CopyChunk));
+  if( pChunk==0 ){ free(z); *pbNoMem = 1; return 0; }
+  memset(pChunk, 0, sizeof(CopyChunk));
+  pChunk->z = z;
+  pChunk->n = iEnd;
+  return pChunk;
+}
+
+/*
+** Split a chunk into lines and fields.  This is the same splitting
+** that the line-at-a-time [db copy] used to do: a line ends at '\n' and
+** fields are separated by the complete zSep string.
 */
-static char *local_getline(char *zPrompt, FILE *in){
+static void copyParseChunk(CopyPipe *p, CopyChunk *pChunk){
+  char *z = pChunk->z;
+  char *zEnd = &z[pChunk->n];
+  int nCol = p->nCol;
+  int nLine = 0;
+  sqlite3_int64 nByte;
   char *zLine;
-  int nLine;
-  int n;
-  int eol;
-
-  nLine = 100;
-  zLine = malloc( nLine );
-  if( zLine==0 ) return 0;
-  n = 0;
-  eol = 0;
-  while( !eol ){
-    if( n+100>nLine ){
-      nLine = nLine*2 + 100;
-      zLine = realloc(zLine, nLine);
-      if( zLine==0 ) return 0;
-    }
-    if( fgets(&zLine[n], nLine - n, in)==0 ){
-      if( n==0 ){
-        free(zLine);
-        return 0;
-      }
-      zLine[n] = 0;
-      eol = 1;
+  char *x;
+
+  for(x=z; x<zEnd && (x = memchr(x, '\n', zEnd-x))!=0; x++){ nLine++; }
+  if( pChunk->n>0 && zEnd[-1]!='\n' ) nLine++;
+
+  /* All of the per-line and per-field arrays share one allocation.
+  ** The size is computed in 64 bits and a chunk with too many fields for
+  ** one allocation is treated as an out-of-memory error. */
+  nByte = nLine*(sqlite3_int64)(sizeof(char*) + 2*sizeof(int))
+        + nLine*(sqlite3_int64)nCol*(sizeof(char*) + sizeof(int));
+  pChunk->azLine = 0;
+  if( nByte<=0x7fffffff ){
+    pChunk->azLine = (char**)malloc(nByte>0 ? (size_t)nByte : 1);
+  }
+  if( pChunk->azLine==0 ){
+    pChunk->nLine = -1;
+    return;
+  }
+  pChunk->azField = &pChunk->azLine[nLine];
+  pChunk->anLine = (int*)&pChunk->azField[nLine*nCol];
+  pChunk->anField = &pChunk->anLine[nLine];
+  pChunk->anFieldLen = &pChunk->anField[nLine];
+  pChunk->nLine = nLine;
+
+  nLine = 0;
+  for(zLine=z; zLine<zEnd; nLine++){
+    char **azCol = &pChunk->azField[nLine*nCol];
+    int *anCol = &pChunk->anFieldLen[nLine*nCol];
+    char *zEol = memchr(zLine, '\n', zEnd-zLine);
+    char *zField = zLine;
+    int i = 0;
+    if( zEol==0 ) zEol = zEnd;
+    for(x=zLine; x<zEol; x++){
+      if( *x==p->zSep[0] && x+p->nSep<=zEol
+       && strncmp(x, p->zSep, p->nSep)==0
+      ){
+        if( i<nCol ){
+          azCol[i] = zField;
+          anCol[i] = (int)(x - zField);
+        }
+        i++;
+        x += p->nSep-1;
+        zField = x+1;
+      }
+    }
+    if( i<nCol ){
+      azCol[i] = zField;
+      anCol[i] = (int)(zEol - zField);
+    }
+    pChunk->azLine[nLine] = zLine;
+    pChunk->anLine[nLine] = (int)(zEol - zLine);
+    pChunk->anField[nLine] = i+1;
+    zLine = zEol+1;
+  }
+}
+
+/*
+** Claim the oldest chunk that has not yet been parsed.  Return NULL if
+** there is none.  The caller must hold the mutex.
+*/
+static CopyChunk *copyClaimChunk(CopyPipe *p){
+  CopyChunk *pChunk;
+  for(pChunk=p->pFirst; pChunk; pChunk=pChunk->pNext){
+    if( pChunk->eState==COPY_CHUNK_READ ){
+      pChunk->eState = COPY_CHUNK_PARSING;
+      return pChunk;
+    }
+  }
+  return 0;
+}
+
+#ifdef TCL_THREADS
+/*
+** Main routine of the reader thread.
+*/
+static Tcl_ThreadCreateType copyReaderThread(ClientData pArg){
+  CopyPipe *p = (CopyPipe*)pArg;
+  int bNoMem = 0;
+  for(;;){
+    CopyChunk *pChunk;
+    Tcl_MutexLock(&p->mutex);
+    while( p->nChunk>=p->mxChunk && !p->bAbort ){
+      Tcl_ConditionWait(&p->cond, &p->mutex, 0);
+    }
+    if( p->bAbort ){
+      Tcl_MutexUnlock(&p->mutex);
       break;
     }
-    while( zLine[n] ){ n++; }
-    if( n>0 && zLine[n-1]=='\n' ){
-      n--;
-      zLine[n] = 0;
-      eol = 1;
+    Tcl_MutexUnlock(&p->mutex);
+    pChunk = copyReadChunk(p, &bNoMem);
+    if( pChunk==0 ) break;
+    Tcl_MutexLock(&p->mutex);
+    if( p->pLast ){
+      p->pLast->pNext = pChunk;
+    }else{
+      p->pFirst = pChunk;
+    }
+    p->pLast = pChunk;
+    p->nChunk++;
+    Tcl_ConditionNotify(&p->cond);
+    Tcl_MutexUnlock(&p->mutex);
+  }
+  Tcl_MutexLock(&p->mutex);
+  p->bEof = 1;
+  p->bNoMem = bNoMem;
+  Tcl_ConditionNotify(&p->cond);
+  Tcl_MutexUnlock(&p->mutex);
+  TCL_THREAD_CREATE_RETURN;
+}
+
+/*
+** Main routine of a parser thread.
+*/
+static Tcl_ThreadCreateType copyParserThread(ClientData pArg){
+  CopyPipe *p = (CopyPipe*)pArg;
+  Tcl_MutexLock(&p->mutex);
+  for(;;){
+    CopyChunk *pChunk = copyClaimChunk(p);
+    if( pChunk ){
+      Tcl_MutexUnlock(&p->mutex);
+      copyParseChunk(p, pChunk);
+      Tcl_MutexLock(&p->mutex);
+      pChunk->eState = COPY_CHUNK_PARSED;
+      Tcl_ConditionNotify(&p->cond);
+    }else if( p->bEof || p->bAbort ){
+      break;
+    }else{
+      Tcl_ConditionWait(&p->cond, &p->mutex, 0);
     }
   }
-  zLine = realloc( zLine, n+1 );
-  return zLine;
+  Tcl_MutexUnlock(&p->mutex);
+  TCL_THREAD_CREATE_RETURN;
 }
+#endif /* TCL_THREADS */
 
+/*
+** Return the next parsed chunk in file order, or NULL at the end of the
+** input.  The caller becomes responsible for freeing the chunk.  While
+** waiting, the calling thread parses chunks itself if none of the
+** parser threads has claimed them.
+*/
+static CopyChunk *copyNextChunk(CopyPipe *p){
+  CopyChunk *pChunk = 0;
+  if( !p->bThreads ){
+    pChunk = copyReadChunk(p, &p->bNoMem);
+    if( pChunk ) copyParseChunk(p, pChunk);
+    return pChunk;
+  }
+  Tcl_MutexLock(&p->mutex);
+  for(;;){
+    CopyChunk *pWork;
+    if( p->pFirst && p->pFirst->eState==COPY_CHUNK_PARSED ){
+      pChunk = p->pFirst;
+      p->pFirst = pChunk->pNext;
+      if( p->pFirst==0 ) p->pLast = 0;
+      p->nChunk--;
+      Tcl_ConditionNotify(&p->cond);
+      break;
+    }
+    if( p->pFirst==0 && p->bEof ) break;
+    pWork = copyClaimChunk(p);
+    if( pWork ){
+      Tcl_MutexUnlock(&p->mutex);
+      copyParseChunk(p, pWork);
+      Tcl_MutexLock(&p->mutex);
+      pWork->eState = COPY_CHUNK_PARSED;
+      Tcl_ConditionNotify(&p->cond);
+    }else{
+      Tcl_ConditionWait(&p->cond, &p->mutex, 0);
+    }
+  }
+  Tcl_MutexUnlock(&p->mutex);
+  return pChunk;
+}
 
 /*
 ** This function is part of the implementation of the command:
@@ -1071,40 +1450,42 @@ static int dbPrepareAndBind(
   while( isspace(zSql[0]) ){ zSql++; }
   nSql = strlen30(zSql);
 
-  for(pPreStmt = pDb->stmtList; pPreStmt; pPreStmt=pPreStmt->pNext){
-    int n = pPreStmt->nSql;
-    if( nSql>=n 
-        && memcmp(pPreStmt->zSql, zSql, n)==0
-        && (zSql[n]==0 || zSql[n-1]==';')
-    ){
-      pStmt = pPreStmt->pStmt;
-      *pzOut = &zSql[pPreStmt->nSql];
-
-      /* When a prepared statement is found, unlink it from the
-      ** cache list.  It will later be added back to the beginning
-      ** of the cache list in order to implement LRU replacement.
-      */
-      if( pPreStmt->pPrev ){
-        pPreStmt->pPrev->pNext = pPreStmt->pNext;
-      }else{
-        pDb->stmtList = pPreStmt->pNext;
-      }
-      if( pPreStmt->pNext ){
-        pPreStmt->pNext->pPrev = pPreStmt->pPrev;
-      }else{
-        pDb->stmtLast = pPreStmt->pPrev;
+  /* Look for a cached statement whose text is either all of zSql or a
+  ** prefix of zSql that ends with a semicolon.  The hash of each such
+  ** prefix is computed incrementally as zSql is scanned.
+  */
+  pPreStmt = 0;
+  if( pDb->nStmt>0 ){
+    unsigned int h = 0;
+    for(i=0; i<nSql && pPreStmt==0; i++){
+      h = stmtHashStep(h, zSql[i]);
+      if( zSql[i]==';' || i==nSql-1 ){
+        pPreStmt = stmtCacheFind(pDb, zSql, i+1, h);
       }
-      pDb->nStmt--;
-      nVar = sqlite3_bind_parameter_count(pStmt);
-      break;
     }
   }
+  if( pPreStmt ){
+    pStmt = pPreStmt->pStmt;
+    *pzOut = &zSql[pPreStmt->nSql];
+
+    /* When a prepared statement is found, unlink it from the cache.
+    ** It will later be added back to the beginning of the cache list
+    ** in order to implement LRU replacement.
+    */
+    stmtCacheRemove(pDb, pPreStmt);
+    pDb->nStmtHit++;
+    nVar = sqlite3_bind_parameter_count(pStmt);
+  }
   
   /* If no prepared statement was found. Compile the SQL text. Also allocate
   ** a new SqlPreparedStmt structure.  */
   if( pPreStmt==0 ){
     int nByte;
+    int nStmtUsed = 0;            /* Statement memory before the prepare */
+    int nStmtNow = 0;             /* Statement memory after the prepare */
+    int nHiwtr;
 
+    sqlite3_db_status(pDb->db, SQLITE_DBSTATUS_STMT_USED, &nStmtUsed,&nHiwtr,0);
     if( SQLITE_OK!=sqlite3_prepare_v2(pDb->db, zSql, -1, &pStmt, pzOut) ){
       Tcl_SetObjResult(interp, dbTextToObj(sqlite3_errmsg(pDb->db)));
       return TCL_ERROR;
@@ -1123,6 +1504,7 @@ static int dbPrepareAndBind(
     }
 
     assert( pPreStmt==0 );
+    pDb->nStmtMiss++;
     nVar = sqlite3_bind_parameter_count(pStmt);
     nByte = sizeof(SqlPreparedStmt) + nVar*sizeof(Tcl_Obj *);
     pPreStmt = (SqlPreparedStmt*)Tcl_Alloc(nByte);
@@ -1132,6 +1514,15 @@ static int dbPrepareAndBind(
     pPreStmt->nSql = (*pzOut - zSql);
     pPreStmt->zSql = sqlite3_sql(pStmt);
     pPreStmt->apParm = (Tcl_Obj **)&pPreStmt[1];
+    for(i=0; i<pPreStmt->nSql; i++){
+      pPreStmt->iHash = stmtHashStep(pPreStmt->iHash, zSql[i]);
+    }
+
+    /* Charge the statement with the growth in statement memory reported
+    ** by the connection, plus the space used by this structure. */
+    sqlite3_db_status(pDb->db, SQLITE_DBSTATUS_STMT_USED, &nStmtNow, &nHiwtr,0);
+    pPreStmt->nByte = nByte + pPreStmt->nSql;
+    if( nStmtNow>nStmtUsed ) pPreStmt->nByte += nStmtNow - nStmtUsed;
   }
   assert( pPreStmt );
   assert( strlen30(pPreStmt->zSql)==pPreStmt->nSql );
@@ -1210,9 +1601,20 @@ static void dbReleaseStmt(
 
   if( pDb->maxStmt<=0 || discard ){
     /* If the cache is turned off, deallocated the statement */
-    sqlite3_finalize(pPreStmt->pStmt);
-    Tcl_Free((char *)pPreStmt);
+    dbFreeStmt(pPreStmt);
   }else{
+    int iSlot;
+
+    /* Grow the hash table first if required.  If it cannot be allocated,
+    ** do not cache the statement. */
+    if( pDb->nStmt>=pDb->nStmtHash ){
+      stmtCacheRehash(pDb);
+      if( pDb->nStmtHash==0 ){
+        dbFreeStmt(pPreStmt);
+        return;
+      }
+    }
+
     /* Add the prepared statement to the beginning of the cache list. */
     pPreStmt->pNext = pDb->stmtList;
     pPreStmt->pPrev = 0;
@@ -1227,15 +1629,22 @@ static void dbReleaseStmt(
       assert( pDb->nStmt>0 );
     }
     pDb->nStmt++;
+    pDb->nStmtBytes += pPreStmt->nByte;
+
+    /* And to the hash table. */
+    iSlot = pPreStmt->iHash & (pDb->nStmtHash-1);
+    pPreStmt->pHashNext = pDb->aStmtHash[iSlot];
+    pDb->aStmtHash[iSlot] = pPreStmt;
    
-    /* If we have too many statement in cache, remove the surplus from 
-    ** the end of the cache list.  */
-    while( pDb->nStmt>pDb->maxStmt ){
-      sqlite3_finalize(pDb->stmtLast->pStmt);
-      pDb->stmtLast = pDb->stmtLast->pPrev;
-      Tcl_Free((char*)pDb->stmtLast->pNext);
-      pDb->stmtLast->pNext = 0;
-      pDb->nStmt--;
+    /* If we have too many statement in cache, or they use too much
+    ** memory, remove the surplus from the end of the cache list.  */
+    while( pDb->nStmt>pDb->maxStmt
+        || (pDb->maxStmtBytes>0 && pDb->nStmtBytes>pDb->maxStmtBytes)
+    ){
+      SqlPreparedStmt *pLast = pDb->stmtLast;
+      stmtCacheRemove(pDb, pLast);
+      dbFreeStmt(pLast);
+      pDb->nStmtEvict++;
     }
   }
 }
@@ -1261,19 +1670,52 @@ struct DbEvalContext {
 };
 
 /*
-** Release any cache of column names currently held as part of
-** the DbEvalContext structure passed as the first argument.
+** Forget the column names of the current statement.  The names belong
+** to the SqlPreparedStmt, which keeps them for as long as the statement
+** stays in the cache.
 */
 static void dbReleaseColumnNames(DbEvalContext *p){
-  if( p->apColName ){
-    int i;
-    for(i=0; i<p->nCol; i++){
-      Tcl_DecrRefCount(p->apColName[i]);
+  p->apColName = 0;
+  p->nCol = 0;
+}
+
+/*
+** Return the array of column name objects for prepared statement
+** pPreStmt, creating it if required.  The names are cached with the
+** statement so that they are only created once no matter how many
+** times the statement is run.  They are checked against the statement
+** on each call, since a schema change may cause the statement to be
+** reprepared with different column names.
+*/
+static Tcl_Obj **dbStmtColumnNames(SqlPreparedStmt *pPreStmt, int *pnCol){
+  sqlite3_stmt *pStmt = pPreStmt->pStmt;
+  int nCol = sqlite3_column_count(pStmt);
+  int i;
+
+  if( pPreStmt->apColName ){
+    for(i=0; i<nCol && i<pPreStmt->nColName; i++){
+      if( strcmp(Tcl_GetString(pPreStmt->apColName[i]),
+                 sqlite3_column_name(pStmt, i)) ) break;
+    }
+    if( i<nCol || nCol!=pPreStmt->nColName ){
+      for(i=0; i<pPreStmt->nColName; i++){
+        Tcl_DecrRefCount(pPreStmt->apColName[i]);
+      }
+      Tcl_Free((char*)pPreStmt->apColName);
+      pPreStmt->apColName = 0;
+      pPreStmt->nColName = 0;
     }
-    Tcl_Free((char *)p->apColName);
-    p->apColName = 0;
   }
-  p->nCol = 0;
+  if( pPreStmt->apColName==0 && nCol>0 ){
+    pPreStmt->apColName = (Tcl_Obj**)Tcl_Alloc( sizeof(Tcl_Obj*)*nCol );
+    for(i=0; i<nCol; i++){
+      pPreStmt->apColName[i] = dbTextToObj(sqlite3_column_name(pStmt,i));
+      Tcl_IncrRefCount(pPreStmt->apColName[i]);
+    }
+    pPreStmt->nColName = nCol;
+  }
+  *pnCol = nCol;
+  return pPreStmt->apColName;
 }
 
 /*
@@ -1321,15 +1763,13 @@ static void dbEvalRowInfo(
     int nCol;                     /* Number of columns returned by pStmt */
     Tcl_Obj **apColName = 0;      /* Array of column names */
 
-    p->nCol = nCol = sqlite3_column_count(pStmt);
-    if( nCol>0 && (papColName || p->pArray) ){
-      apColName = (Tcl_Obj**)Tcl_Alloc( sizeof(Tcl_Obj*)*nCol );
-      for(i=0; i<nCol; i++){
-        apColName[i] = dbTextToObj(sqlite3_column_name(pStmt,i));
-        Tcl_IncrRefCount(apColName[i]);
-      }
+    if( papColName || p->pArray ){
+      apColName = dbStmtColumnNames(p->pPreStmt, &nCol);
       p->apColName = apColName;
+    }else{
+      nCol = sqlite3_column_count(pStmt);
     }
+    p->nCol = nCol;
 
     /* If results are being stored in an array variable, then create
     ** the array(*) entry for that array
@@ -1462,6 +1902,147 @@ static Tcl_Obj *dbEvalColumnValue(DbEvalContext *p, int iCol){
   return dbTextToObj((char *)sqlite3_column_text(pStmt, iCol));
 }
 
+/*
+** One output column of a [db eval -columnar] command.  pList accumulates
+** the values of the column.  pPrev is the most recent value appended,
+** which is reused for the next row if it holds the same INTEGER or REAL,
+** so that runs of equal numbers share a single Tcl_Obj.
+*/
+typedef struct DbColumnarCol DbColumnarCol;
+struct DbColumnarCol {
+  Tcl_Obj *pName;                 /* Column name */
+  Tcl_Obj *pList;                 /* Values of this column */
+  Tcl_Obj *pPrev;                 /* Last value appended to pList */
+  int ePrev;                      /* Type of pPrev: SQLITE_INTEGER or FLOAT */
+  sqlite3_int64 iPrev;            /* Value of pPrev if SQLITE_INTEGER */
+  double rPrev;                   /* Value of pPrev if SQLITE_FLOAT */
+};
+
+/*
+** Implementation of:
+**
+**     $db eval -columnar $sql
+**
+** Run the SQL and return a list of alternating column names and value
+** lists, one value list per result column, built in a single pass over
+** the rows.  Each statement in the script that returns columns adds its
+** own name and value list pairs, in statement order, even if it returns
+** no rows.  This avoids the per-row variable and script overhead of the
+** row callback form.
+*/
+static int dbEvalColumnar(SqliteDb *pDb, Tcl_Obj *pSql){
+  Tcl_Interp *interp = pDb->interp;
+  DbEvalContext sEval;
+  DbColumnarCol *aCol = 0;        /* Output columns of current statement */
+  int nAlloc = 0;                 /* Allocated size of aCol[] */
+  Tcl_Obj *pNull;                 /* Shared value for SQL NULL */
+  Tcl_Obj *pRet;                  /* Result list */
+  int rc = TCL_OK;
+  int i;
+
+  pNull = dbTextToObj(pDb->zNull);
+  Tcl_IncrRefCount(pNull);
+  pRet = Tcl_NewObj();
+  Tcl_IncrRefCount(pRet);
+  dbEvalInit(&sEval, pDb, pSql, 0);
+  while( rc==TCL_OK && sEval.zSql[0] ){
+    SqlPreparedStmt *pPreStmt;
+    sqlite3_stmt *pStmt;
+    Tcl_Obj **apColName;
+    int nCol;
+    int rcs;
+
+    rc = dbPrepareAndBind(pDb, sEval.zSql, &sEval.zSql, &sEval.pPreStmt);
+    if( rc!=TCL_OK || sEval.pPreStmt==0 ) continue;
+    pPreStmt = sEval.pPreStmt;
+    pStmt = pPreStmt->pStmt;
+
+    apColName = dbStmtColumnNames(pPreStmt, &nCol);
+    if( nCol>nAlloc ){
+      aCol = (DbColumnarCol*)Tcl_Realloc((char*)aCol, nCol*sizeof(aCol[0]));
+      nAlloc = nCol;
+    }
+    for(i=0; i<nCol; i++){
+      memset(&aCol[i], 0, sizeof(aCol[i]));
+      aCol[i].pName = apColName[i];
+      aCol[i].pList = Tcl_NewObj();
+      Tcl_IncrRefCount(aCol[i].pList);
+    }
+
+    while( sqlite3_step(pStmt)==SQLITE_ROW ){
+      for(i=0; i<nCol; i++){
+        DbColumnarCol *pCol = &aCol[i];
+        Tcl_Obj *pVal;
+        switch( sqlite3_column_type(pStmt, i) ){
+          case SQLITE_INTEGER: {
+            sqlite3_int64 v = sqlite3_column_int64(pStmt, i);
+            if( pCol->ePrev==SQLITE_INTEGER && pCol->iPrev==v ){
+              pVal = pCol->pPrev;
+            }else{
+              pVal = dbEvalColumnValue(&sEval, i);
+              pCol->ePrev = SQLITE_INTEGER;
+              pCol->iPrev = v;
+              pCol->pPrev = pVal;
+            }
+            break;
+          }
+          case SQLITE_FLOAT: {
+            double r = sqlite3_column_double(pStmt, i);
+            if( pCol->ePrev==SQLITE_FLOAT
+             && memcmp(&pCol->rPrev, &r, sizeof(r))==0 ){
+              pVal = pCol->pPrev;
+            }else{
+              pVal = Tcl_NewDoubleObj(r);
+              pCol->ePrev = SQLITE_FLOAT;
+              pCol->rPrev = r;
+              pCol->pPrev = pVal;
+            }
+            break;
+          }
+          case SQLITE_NULL: {
+            pVal = pNull;
+            break;
+          }
+          default: {
+            pVal = dbEvalColumnValue(&sEval, i);
+            break;
+          }
+        }
+        /* pPrev is always referenced by pList, so it stays valid. */
+        Tcl_ListObjAppendElement(interp, pCol->pList, pVal);
+      }
+    }
+    rcs = sqlite3_reset(pStmt);
+
+    pDb->nStep = sqlite3_stmt_status(pStmt,SQLITE_STMTSTATUS_FULLSCAN_STEP,1);
+    pDb->nSort = sqlite3_stmt_status(pStmt,SQLITE_STMTSTATUS_SORT,1);
+    pDb->nIndex = sqlite3_stmt_status(pStmt,SQLITE_STMTSTATUS_AUTOINDEX,1);
+    sEval.pPreStmt = 0;
+
+    if( rcs!=SQLITE_OK ){
+      Tcl_SetObjResult(interp, dbTextToObj(sqlite3_errmsg(pDb->db)));
+      rc = TCL_ERROR;
+    }
+    for(i=0; i<nCol; i++){
+      if( rc==TCL_OK ){
+        Tcl_ListObjAppendElement(interp, pRet, aCol[i].pName);
+        Tcl_ListObjAppendElement(interp, pRet, aCol[i].pList);
+      }
+      Tcl_DecrRefCount(aCol[i].pList);
+    }
+    dbReleaseStmt(pDb, pPreStmt, rc!=TCL_OK);
+  }
+  dbEvalFinalize(&sEval);
+
+  if( rc==TCL_OK ){
+    Tcl_SetObjResult(interp, pRet);
+  }
+  Tcl_DecrRefCount(pRet);
+  Tcl_Free((char*)aCol);
+  Tcl_DecrRefCount(pNull);
+  return rc;
+}
+
 /*
 ** If using Tcl version 8.6 or greater, use the NR functions to avoid
 ** recursive evalution of scripts by the [db eval] and [db trans]
@@ -1753,9 +2334,15 @@ static int DbObjCmd(void *cd, Tcl_Interp *interp, int objc,Tcl_Obj *const*objv){
 
   /*     $db cache flush
   **     $db cache size n
+  **     $db cache bytes n
+  **     $db cache stats ?-reset?
   **
-  ** Flush the prepared statement cache, or set the maximum number of
-  ** cached statements.
+  ** Flush the prepared statement cache, set the maximum number of
+  ** cached statements, or set the maximum number of bytes of memory they
+  ** may use (0 for no limit).  The "stats" option returns a list of
+  ** name/value pairs: the number of cache hits, misses and evictions,
+  ** and the number of statements and bytes currently cached.  With
+  ** -reset the hit, miss and eviction counters are zeroed afterwards.
   */
   case DB_CACHE: {
     char *subCmd;
@@ -1792,9 +2379,49 @@ static int DbObjCmd(void *cd, Tcl_Interp *interp, int objc,Tcl_Obj *const*objv){
           pDb->maxStmt = n;
         }
       }
+    }else if( *subCmd=='b' && strcmp(subCmd,"bytes")==0 ){
+      if( objc!=4 ){
+        Tcl_WrongNumArgs(interp, 2, objv, "bytes n");
+        return TCL_ERROR;
+      }else{
+        if( TCL_ERROR==Tcl_GetIntFromObj(interp, objv[3], &n) ){
+          Tcl_AppendResult( interp, "cannot convert \"", 
+               Tcl_GetStringFromObj(objv[3],0), "\" to integer", 0);
+          return TCL_ERROR;
+        }else{
+          if( n<0 ){
+            flushStmtCache( pDb );
+            n = 0;
+          }
+          pDb->maxStmtBytes = n;
+        }
+      }
+    }else if( *subCmd=='s' && strcmp(subCmd,"stats")==0 ){
+      Tcl_Obj *pRet;
+      if( objc>4 || (objc==4 
+          && strcmp(Tcl_GetStringFromObj(objv[3], 0), "-reset")!=0) ){
+        Tcl_WrongNumArgs(interp, 2, objv, "stats ?-reset?");
+        return TCL_ERROR;
+      }
+      pRet = Tcl_NewObj();
+      Tcl_ListObjAppendElement(interp, pRet, Tcl_NewStringObj("hit", -1));
+      Tcl_ListObjAppendElement(interp, pRet, Tcl_NewWideIntObj(pDb->nStmtHit));
+      Tcl_ListObjAppendElement(interp, pRet, Tcl_NewStringObj("miss", -1));
+      Tcl_ListObjAppendElement(interp, pRet, Tcl_NewWideIntObj(pDb->nStmtMiss));
+      Tcl_ListObjAppendElement(interp, pRet, Tcl_NewStringObj("evict", -1));
+      Tcl_ListObjAppendElement(interp, pRet, Tcl_NewWideIntObj(pDb->nStmtEvict));
+      Tcl_ListObjAppendElement(interp, pRet, Tcl_NewStringObj("count", -1));
+      Tcl_ListObjAppendElement(interp, pRet, Tcl_NewIntObj(pDb->nStmt));
+      Tcl_ListObjAppendElement(interp, pRet, Tcl_NewStringObj("bytes", -1));
+      Tcl_ListObjAppendElement(interp, pRet, Tcl_NewIntObj(pDb->nStmtBytes));
+      Tcl_SetObjResult(interp, pRet);
+      if( objc==4 ){
+        pDb->nStmtHit = pDb->nStmtMiss = pDb->nStmtEvict = 0;
+      }
     }else{
       Tcl_AppendResult( interp, "bad option \"", 
-          Tcl_GetStringFromObj(objv[2],0), "\": must be flush or size", 0);
+          Tcl_GetStringFromObj(objv[2],0),
+          "\": must be bytes, flush, size or stats", 0);
       return TCL_ERROR;
     }
     break;
@@ -1937,7 +2564,7 @@ static int DbObjCmd(void *cd, Tcl_Interp *interp, int objc,Tcl_Obj *const*objv){
     break;
   }
 
-  /*    $db copy conflict-algorithm table filename ?SEPARATOR? ?NULLINDICATOR?
+  /*    $db copy ?OPTIONS? conflict-algorithm table filename ?SEPARATOR? ?NULLINDICATOR?
   **
   ** Copy data into table from filename, optionally using SEPARATOR
   ** as column separators.  If a column contains a null string, or the
@@ -1947,6 +2574,21 @@ static int DbObjCmd(void *cd, Tcl_Interp *interp, int objc,Tcl_Obj *const*objv){
   ** On success, return the number of lines processed, not necessarily same
   ** as 'db changes' due to conflict-algorithm selected.
   **
+  ** OPTIONS may be any of the following:
+  **
+  **    -batch N          Commit after every N lines instead of once at
+  **                      the end.  An error rolls back only the current
+  **                      batch.
+  **    -progress SCRIPT  After each chunk of input is inserted, invoke
+  **                      SCRIPT with the number of lines processed so
+  **                      far appended.  An error in SCRIPT stops the copy.
+  **    -rejects CHANNEL  Write lines with the wrong number of columns to
+  **                      CHANNEL, which must be writable, and carry on.
+  **                      Without this option such a line stops the copy.
+  **    -threads N        Split lines into fields using N worker threads.
+  **                      The default is 2.  With 0, the file is read and
+  **                      parsed by the calling thread.
+  **
   ** This code is basically an implementation/enhancement of
   ** the sqlite3 shell.c ".import" command.
   **
@@ -1965,34 +2607,74 @@ static int DbObjCmd(void *cd, Tcl_Interp *interp, int objc,Tcl_Obj *const*objv){
     int nSep;                   /* Number of bytes in zSep[] */
     int nNull;                  /* Number of bytes in zNull[] */
     char *zSql;                 /* An SQL statement */
-    char *zLine;                /* A single line of input from the file */
-    char **azCol;               /* zLine[] broken up into columns */
     char *zCommit;              /* How to commit changes */
     FILE *in;                   /* The input file */
     int lineno = 0;             /* Line number of input file */
     char zLineNum[80];          /* Line number print buffer */
     Tcl_Obj *pResult;           /* interp result */
+    int nBatch = 0;             /* Lines per transaction.  0 for all */
+    int nInBatch = 0;           /* Lines inserted by the current transaction */
+    Tcl_Obj *pProgress = 0;     /* Progress script, or NULL */
+    Tcl_Channel rejects = 0;    /* Channel for malformed lines, or NULL */
+    int nThread = 2;            /* Number of parser threads */
+    int nWorker = 0;            /* Number of threads started */
+    Tcl_ThreadId *aThread = 0;  /* Reader thread, then parser threads */
+    CopyPipe pipe;              /* State shared with the worker threads */
+    CopyChunk *pChunk;          /* Chunk currently being inserted */
+    int iArg;                   /* Index of the conflict-algorithm argument */
 
     char *zSep;
     char *zNull;
-    if( objc<5 || objc>7 ){
+    for(i=2; i<objc-3; i+=2){
+      const char *zOpt = Tcl_GetString(objv[i]);
+      if( zOpt[0]!='-' ) break;
+      if( i+1>=objc-3 ){
+        Tcl_AppendResult(interp, "option requires an argument: ", zOpt, 0);
+        return TCL_ERROR;
+      }
+      if( strcmp(zOpt, "-batch")==0 ){
+        if( Tcl_GetIntFromObj(interp, objv[i+1], &nBatch) ) return TCL_ERROR;
+        if( nBatch<0 ) nBatch = 0;
+      }else if( strcmp(zOpt, "-progress")==0 ){
+        pProgress = objv[i+1];
+      }else if( strcmp(zOpt, "-rejects")==0 ){
+        int mode;
+        rejects = Tcl_GetChannel(interp, Tcl_GetString(objv[i+1]), &mode);
+        if( rejects==0 ) return TCL_ERROR;
+        if( (mode & TCL_WRITABLE)==0 ){
+          Tcl_AppendResult(interp, "channel \"", Tcl_GetString(objv[i+1]),
+              "\" wasn't opened for writing", 0);
+          return TCL_ERROR;
+        }
+      }else if( strcmp(zOpt, "-threads")==0 ){
+        if( Tcl_GetIntFromObj(interp, objv[i+1], &nThread) ) return TCL_ERROR;
+        if( nThread<0 ) nThread = 0;
+      }else{
+        Tcl_AppendResult(interp, "bad option \"", zOpt, "\": must be "
+            "-batch, -progress, -rejects or -threads", 0);
+        return TCL_ERROR;
+      }
+    }
+    iArg = i;
+    if( objc-iArg<3 || objc-iArg>5 ){
       Tcl_WrongNumArgs(interp, 2, objv, 
-         "CONFLICT-ALGORITHM TABLE FILENAME ?SEPARATOR? ?NULLINDICATOR?");
+         "?OPTIONS? CONFLICT-ALGORITHM TABLE FILENAME ?SEPARATOR? "
+         "?NULLINDICATOR?");
       return TCL_ERROR;
     }
-    if( objc>=6 ){
-      zSep = Tcl_GetStringFromObj(objv[5], 0);
+    if( objc-iArg>=4 ){
+      zSep = Tcl_GetStringFromObj(objv[iArg+3], 0);
     }else{
       zSep = "\t";
     }
-    if( objc>=7 ){
-      zNull = Tcl_GetStringFromObj(objv[6], 0);
+    if( objc-iArg>=5 ){
+      zNull = Tcl_GetStringFromObj(objv[iArg+4], 0);
     }else{
       zNull = "";
     }
-    zConflict = Tcl_GetStringFromObj(objv[2], 0);
-    zTable = Tcl_GetStringFromObj(objv[3], 0);
-    zFile = Tcl_GetStringFromObj(objv[4], 0);
+    zConflict = Tcl_GetStringFromObj(objv[iArg], 0);
+    zTable = Tcl_GetStringFromObj(objv[iArg+1], 0);
+    zFile = Tcl_GetStringFromObj(objv[iArg+2], 0);
     nSep = strlen30(zSep);
     nNull = strlen30(zNull);
     if( nSep==0 ){
@@ -2054,63 +2736,134 @@ static int DbObjCmd(void *cd, Tcl_Interp *interp, int objc,Tcl_Obj *const*objv){
       sqlite3_finalize(pStmt);
       return TCL_ERROR;
     }
-    azCol = malloc( sizeof(azCol[0])*(nCol+1) );
-    if( azCol==0 ) {
-      Tcl_AppendResult(interp, "Error: can't malloc()", 0);
-      fclose(in);
-      return TCL_ERROR;
+
+    /* Start the reader thread and nThread parser threads.  If a thread
+    ** cannot be started, or if Tcl was built without thread support, the
+    ** work it would have done falls back to this thread.
+    */
+    memset(&pipe, 0, sizeof(pipe));
+    pipe.in = in;
+    pipe.zSep = zSep;
+    pipe.nSep = nSep;
+    pipe.nCol = nCol;
+    pipe.mxChunk = nThread + 2;
+#ifdef TCL_THREADS
+    if( nThread>0 ){
+      aThread = (Tcl_ThreadId*)Tcl_Alloc(sizeof(Tcl_ThreadId)*(nThread+1));
+      if( Tcl_CreateThread(&aThread[0], copyReaderThread, (ClientData)&pipe,
+              TCL_THREAD_STACK_DEFAULT, TCL_THREAD_JOINABLE)==TCL_OK ){
+        pipe.bThreads = 1;
+        for(nWorker=1; nWorker<=nThread; nWorker++){
+          if( Tcl_CreateThread(&aThread[nWorker], copyParserThread,
+                  (ClientData)&pipe, TCL_THREAD_STACK_DEFAULT,
+                  TCL_THREAD_JOINABLE)!=TCL_OK ){
+            break;
+          }
+        }
+      }
     }
+#endif
+
     (void)sqlite3_exec(pDb->db, "BEGIN", 0, 0, 0);
     zCommit = "COMMIT";
-    while( (zLine = local_getline(0, in))!=0 ){
-      char *z;
-      i = 0;
-      lineno++;
-      azCol[0] = zLine;
-      for(i=0, z=zLine; *z; z++){
-        if( *z==zSep[0] && strncmp(z, zSep, nSep)==0 ){
-          *z = 0;
-          i++;
-          if( i<nCol ){
-            azCol[i] = &z[nSep];
-            z += nSep-1;
+    while( zCommit[0]=='C' && (pChunk = copyNextChunk(&pipe))!=0 ){
+      if( pChunk->nLine<0 ){
+        copyFreeChunk(pChunk);
+        pipe.bNoMem = 1;
+        break;
+      }
+      for(j=0; j<pChunk->nLine; j++){
+        char **azCol = &pChunk->azField[j*nCol];
+        int *anCol = &pChunk->anFieldLen[j*nCol];
+        lineno++;
+        if( pChunk->anField[j]!=nCol ){
+          char *zErr;
+          int nErr;
+          if( rejects ){
+            if( Tcl_Write(rejects, pChunk->azLine[j], pChunk->anLine[j])<0
+             || Tcl_Write(rejects, "\n", 1)<0
+            ){
+              Tcl_AppendResult(interp, "Error: cannot write to rejects "
+                  "channel: ", Tcl_ErrnoMsg(Tcl_GetErrno()), 0);
+              zCommit = "ROLLBACK";
+              break;
+            }
+            continue;
           }
+          nErr = strlen30(zFile) + 200;
+          zErr = malloc(nErr);
+          if( zErr ){
+            sqlite3_snprintf(nErr, zErr,
+               "Error: %s line %d: expected %d columns of data but found %d",
+               zFile, lineno, nCol, pChunk->anField[j]);
+            Tcl_AppendResult(interp, zErr, 0);
+            free(zErr);
+          }
+          zCommit = "ROLLBACK";
+          break;
         }
-      }
-      if( i+1!=nCol ){
-        char *zErr;
-        int nErr = strlen30(zFile) + 200;
-        zErr = malloc(nErr);
-        if( zErr ){
-          sqlite3_snprintf(nErr, zErr,
-             "Error: %s line %d: expected %d columns of data but found %d",
-             zFile, lineno, nCol, i+1);
-          Tcl_AppendResult(interp, zErr, 0);
-          free(zErr);
+        for(i=0; i<nCol; i++){
+          /* check for null data, if so, bind as null */
+          if( anCol[i]==0
+           || (nNull>0 && anCol[i]==nNull
+                       && memcmp(azCol[i], zNull, nNull)==0)
+          ){
+            sqlite3_bind_null(pStmt, i+1);
+          }else{
+            sqlite3_bind_text(pStmt, i+1, azCol[i], anCol[i], SQLITE_STATIC);
+          }
+        }
+        sqlite3_step(pStmt);
+        rc = sqlite3_reset(pStmt);
+        if( rc!=SQLITE_OK ){
+          Tcl_AppendResult(interp,"Error: ", sqlite3_errmsg(pDb->db), 0);
+          zCommit = "ROLLBACK";
+          break;
+        }
+        if( nBatch>0 && ++nInBatch>=nBatch ){
+          (void)sqlite3_exec(pDb->db, "COMMIT", 0, 0, 0);
+          (void)sqlite3_exec(pDb->db, "BEGIN", 0, 0, 0);
+          nInBatch = 0;
         }
-        zCommit = "ROLLBACK";
-        break;
       }
-      for(i=0; i<nCol; i++){
-        /* check for null data, if so, bind as null */
-        if( (nNull>0 && strcmp(azCol[i], zNull)==0)
-          || strlen30(azCol[i])==0 
-        ){
-          sqlite3_bind_null(pStmt, i+1);
+      copyFreeChunk(pChunk);
+      if( zCommit[0]=='C' && pProgress ){
+        Tcl_Obj *pCmd = Tcl_DuplicateObj(pProgress);
+        Tcl_IncrRefCount(pCmd);
+        Tcl_ListObjAppendElement(interp, pCmd, Tcl_NewIntObj(lineno));
+        rc = Tcl_EvalObjEx(interp, pCmd, TCL_EVAL_DIRECT);
+        Tcl_DecrRefCount(pCmd);
+        if( rc!=TCL_OK ){
+          zCommit = "ROLLBACK";
         }else{
-          sqlite3_bind_text(pStmt, i+1, azCol[i], -1, SQLITE_STATIC);
+          Tcl_ResetResult(interp);
         }
       }
-      sqlite3_step(pStmt);
-      rc = sqlite3_reset(pStmt);
-      free(zLine);
-      if( rc!=SQLITE_OK ){
-        Tcl_AppendResult(interp,"Error: ", sqlite3_errmsg(pDb->db), 0);
-        zCommit = "ROLLBACK";
-        break;
+    }
+    if( zCommit[0]=='C' && pipe.bNoMem ){
+      Tcl_AppendResult(interp, "Error: can't malloc()", 0);
+      zCommit = "ROLLBACK";
+    }
+
+    /* Stop the worker threads and release whatever they left behind. */
+    if( pipe.bThreads ){
+      Tcl_MutexLock(&pipe.mutex);
+      pipe.bAbort = 1;
+      Tcl_ConditionNotify(&pipe.cond);
+      Tcl_MutexUnlock(&pipe.mutex);
+      for(i=0; i<nWorker; i++){
+        Tcl_JoinThread(aThread[i], 0);
       }
+      Tcl_MutexFinalize(&pipe.mutex);
+      Tcl_ConditionFinalize(&pipe.cond);
     }
-    free(azCol);
+    while( pipe.pFirst ){
+      pChunk = pipe.pFirst;
+      pipe.pFirst = pChunk->pNext;
+      copyFreeChunk(pChunk);
+    }
+    free(pipe.zCarry);
+    if( aThread ) Tcl_Free((char*)aThread);
     fclose(in);
     sqlite3_finalize(pStmt);
     (void)sqlite3_exec(pDb->db, zCommit, 0, 0, 0);
@@ -2199,12 +2952,16 @@ static int DbObjCmd(void *cd, Tcl_Interp *interp, int objc,Tcl_Obj *const*objv){
    
   /*
   **    $db eval $sql ?array? ?{  ...code... }?
+  **    $db eval -columnar $sql
   **
   ** The SQL statement in $sql is evaluated.  For each row, the values are
   ** placed in elements of the array named "array" and ...code... is executed.
   ** If "array" and "code" are omitted, then no callback is every invoked.
   ** If "array" is an empty string, then the values are placed in variables
   ** that have the same name as the fields extracted by the query.
+  **
+  ** With -columnar, the result is a list of column names each followed
+  ** by the list of values in that column, for each statement in $sql.
   */
   case DB_EVAL: {
     if( objc<3 || objc>5 ){
@@ -2212,7 +2969,9 @@ static int DbObjCmd(void *cd, Tcl_Interp *interp, int objc,Tcl_Obj *const*objv){
       return TCL_ERROR;
     }
 
-    if( objc==3 ){
+    if( objc==4 && strcmp(Tcl_GetString(objv[2]), "-columnar")==0 ){
+      rc = dbEvalColumnar(pDb, objv[3]);
+    }else if( objc==3 ){
       DbEvalContext sEval;
       Tcl_Obj *pRet = Tcl_NewObj();
       Tcl_IncrRefCount(pRet);